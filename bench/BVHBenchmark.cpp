@@ -0,0 +1,243 @@
+/*
+ * Copyright (c) 2025-present Henri Michelon
+ *
+ * This software is released under the MIT License.
+ * https://opensource.org/licenses/MIT
+*/
+import std;
+import lysa.aabb;
+import lysa.benchmark;
+import lysa.bvh;
+import lysa.frustum;
+import lysa.math;
+
+using namespace lysa;
+
+// Queries of the scene instances BVH compared to the brute force scan of the AABBs it replaced.
+// The instances are boxes of 0.5 to 2 units spread with one box per 1000 cubic units, so the
+// number of results of a query does not depend on the number of instances.
+namespace {
+
+    constexpr auto FRUSTUM_QUERIES{256};
+    constexpr auto RAY_QUERIES{4096};
+    constexpr auto SPHERE_QUERIES{4096};
+    // The brute force queries of the largest scenes are slow, fewer are timed
+    constexpr auto BRUTE_FORCE_QUERIES{64};
+
+    struct Scene {
+        std::vector<AABB> boxes;
+        float size;
+    };
+
+    Scene createScene(const uint32 count, std::mt19937& random) {
+        auto scene = Scene{ {}, std::cbrt(static_cast<float>(count) * 1000.0f) };
+        auto position = std::uniform_real_distribution{0.0f, scene.size};
+        auto extent = std::uniform_real_distribution{0.25f, 1.0f};
+        scene.boxes.resize(count);
+        for (auto& box : scene.boxes) {
+            const auto center = float3{position(random), position(random), position(random)};
+            const auto half = float3{extent(random), extent(random), extent(random)};
+            box = AABB{center - half, center + half};
+        }
+        return scene;
+    }
+
+    // Same test as the BVH : the box corner the farthest along the normal of each plane
+    bool isInFrustum(const AABB& box, const Frustum::Plane planes[6]) {
+        for (auto i = 0; i < 6; i++) {
+            const float4& plane = planes[i].data;
+            const float3 normal = plane.xyz;
+            const float3 positive = select(normal >= 0.0f, box.max, box.min);
+            if (static_cast<float>(dot(normal, positive)) + static_cast<float>(plane.w) < 0.0f) {
+                return false;
+            }
+        }
+        return true;
+    }
+
+    std::vector<std::array<Frustum::Plane, 6>> createFrustums(const Scene& scene, std::mt19937& random) {
+        auto position = std::uniform_real_distribution{0.0f, scene.size};
+        const auto projection = perspective(radians(60.0f), 16.0f / 9.0f, 0.1f, 100.0f);
+        auto frustums = std::vector<std::array<Frustum::Plane, 6>>(FRUSTUM_QUERIES);
+        for (auto& planes : frustums) {
+            const auto eye = float3{position(random), position(random), position(random)};
+            const auto center = float3{position(random), position(random), position(random)};
+            Frustum::extractPlanes(planes.data(), mul(look_at(eye, center, AXIS_UP), projection));
+        }
+        return frustums;
+    }
+
+    std::vector<Ray> createRays(const Scene& scene, std::mt19937& random) {
+        auto position = std::uniform_real_distribution{0.0f, scene.size};
+        auto direction = std::uniform_real_distribution{-1.0f, 1.0f};
+        auto rays = std::vector<Ray>(RAY_QUERIES);
+        for (auto& ray : rays) {
+            ray = Ray{
+                float3{position(random), position(random), position(random)},
+                float3{direction(random), direction(random), direction(random)}};
+        }
+        return rays;
+    }
+
+    std::vector<float3> createPoints(const Scene& scene, std::mt19937& random) {
+        auto position = std::uniform_real_distribution{0.0f, scene.size};
+        auto points = std::vector<float3>(SPHERE_QUERIES);
+        for (auto& point : points) {
+            point = float3{position(random), position(random), position(random)};
+        }
+        return points;
+    }
+
+    // Results of the brute force queries, read so the compiler keeps them
+    volatile uint64 sink{0};
+
+    std::string microseconds(const double milliseconds, const uint32 queries) {
+        return std::format("{:.2f} us", milliseconds * 1000.0 / queries);
+    }
+
+}
+
+int main() {
+    auto random = std::mt19937{42};
+    auto buildRows = std::vector<std::vector<std::string>>{};
+    auto queryRows = std::vector<std::vector<std::string>>{};
+    for (const auto count : { 10'000u, 100'000u, 1'000'000u }) {
+        const auto scene = createScene(count, random);
+        const auto label = count >= 1'000'000 ? std::format("{}M", count / 1'000'000) : std::format("{}k", count / 1000);
+
+        // Construction, then 10% of the instances moving out of their fat AABB
+        auto tree = BVH{};
+        auto proxies = std::vector<int32>(count);
+        const auto insertTime = Benchmark::measure([&] {
+            for (auto i = 0; i < scene.boxes.size(); i++) {
+                proxies[i] = tree.insert(scene.boxes[i], &scene.boxes[i]);
+            }
+        }, 1);
+        const auto insertCost = tree.getCost();
+        const auto rebuildTime = Benchmark::measure([&] { tree.rebuild(); }, 3);
+        const auto rebuildCost = tree.getCost();
+        const auto moved = count / 10;
+        const auto updateTime = Benchmark::measure([&] {
+            for (auto i = 0u; i < moved; i++) {
+                const auto offset = float3{1.0f, 0.0f, 0.0f};
+                tree.update(proxies[i], AABB{scene.boxes[i].min + offset, scene.boxes[i].max + offset});
+            }
+        }, 1);
+        buildRows.push_back({
+            label,
+            std::format("{:.1f} ms", insertTime),
+            std::format("{:.1f}", insertCost),
+            std::format("{:.1f} ms", rebuildTime),
+            std::format("{:.1f}", rebuildCost),
+            std::format("{:.1f} ms", updateTime),
+        });
+        tree.rebuild();
+
+        // Frustum queries
+        const auto frustums = createFrustums(scene, random);
+        auto visible = uint64{0};
+        const auto frustumTime = Benchmark::measure([&] {
+            visible = 0;
+            for (const auto& planes : frustums) {
+                tree.queryFrustum(planes.data(), [&](const void*) { visible += 1; return true; });
+            }
+        });
+        const auto frustumBruteForceTime = Benchmark::measure([&] {
+            auto bruteForceVisible = uint64{0};
+            for (auto i = 0; i < BRUTE_FORCE_QUERIES; i++) {
+                for (const auto& box : scene.boxes) {
+                    bruteForceVisible += isInFrustum(box, frustums[i].data()) ? 1 : 0;
+                }
+            }
+            sink = sink + bruteForceVisible;
+        }, 1);
+        queryRows.push_back({
+            label, "frustum",
+            std::format("{}", visible / FRUSTUM_QUERIES),
+            microseconds(frustumTime, FRUSTUM_QUERIES),
+            Benchmark::throughput(FRUSTUM_QUERIES, frustumTime),
+            microseconds(frustumBruteForceTime, BRUTE_FORCE_QUERIES),
+            std::format("{:.0f}x", (frustumBruteForceTime / BRUTE_FORCE_QUERIES) / (frustumTime / FRUSTUM_QUERIES)),
+        });
+
+        // Closest hit ray casts
+        const auto rays = createRays(scene, random);
+        auto hits = uint64{0};
+        const auto rayTime = Benchmark::measure([&] {
+            hits = 0;
+            for (const auto& ray : rays) {
+                auto closest = std::numeric_limits<float>::max();
+                const auto invDirection = float3{1.0f / ray.direction};
+                tree.raycast(ray, 100.0f, [&](const void* userData, const float maxDistance) {
+                    float distance;
+                    if (BVH::intersects(ray.origin, invDirection, *static_cast<const AABB*>(userData), maxDistance, distance)) {
+                        closest = distance;
+                        return distance;
+                    }
+                    return maxDistance;
+                });
+                hits += closest < 100.0f ? 1 : 0;
+            }
+        });
+        const auto rayBruteForceTime = Benchmark::measure([&] {
+            auto bruteForceHits = uint64{0};
+            for (auto i = 0; i < BRUTE_FORCE_QUERIES; i++) {
+                const auto invDirection = float3{1.0f / rays[i].direction};
+                auto closest = 100.0f;
+                for (const auto& box : scene.boxes) {
+                    float distance;
+                    if (BVH::intersects(rays[i].origin, invDirection, box, closest, distance)) {
+                        closest = distance;
+                    }
+                }
+                bruteForceHits += closest < 100.0f ? 1 : 0;
+            }
+            sink = sink + bruteForceHits;
+        }, 1);
+        queryRows.push_back({
+            label, "ray, closest hit",
+            std::format("{:.0f}% hit", 100.0 * static_cast<double>(hits) / RAY_QUERIES),
+            microseconds(rayTime, RAY_QUERIES),
+            Benchmark::throughput(RAY_QUERIES, rayTime),
+            microseconds(rayBruteForceTime, BRUTE_FORCE_QUERIES),
+            std::format("{:.0f}x", (rayBruteForceTime / BRUTE_FORCE_QUERIES) / (rayTime / RAY_QUERIES)),
+        });
+
+        // "What is near the player" : spheres of 10 units
+        const auto points = createPoints(scene, random);
+        auto near = uint64{0};
+        const auto sphereTime = Benchmark::measure([&] {
+            near = 0;
+            for (const auto& point : points) {
+                tree.querySphere(point, 10.0f, [&](const void*) { near += 1; return true; });
+            }
+        });
+        const auto sphereBruteForceTime = Benchmark::measure([&] {
+            auto bruteForceNear = uint64{0};
+            for (auto i = 0; i < BRUTE_FORCE_QUERIES; i++) {
+                for (const auto& box : scene.boxes) {
+                    bruteForceNear += BVH::distanceSquared(box, points[i]) <= 100.0f ? 1 : 0;
+                }
+            }
+            sink = sink + bruteForceNear;
+        }, 1);
+        queryRows.push_back({
+            label, "sphere, radius 10",
+            std::format("{}", near / SPHERE_QUERIES),
+            microseconds(sphereTime, SPHERE_QUERIES),
+            Benchmark::throughput(SPHERE_QUERIES, sphereTime),
+            microseconds(sphereBruteForceTime, BRUTE_FORCE_QUERIES),
+            std::format("{:.0f}x", (sphereBruteForceTime / BRUTE_FORCE_QUERIES) / (sphereTime / SPHERE_QUERIES)),
+        });
+    }
+
+    Benchmark::print(
+        "BVH construction, SAH cost and update of 10% of the instances",
+        { "Instances", "Inserts", "SAH cost", "Rebuild", "SAH cost", "Updates" },
+        buildRows);
+    Benchmark::print(
+        "BVH queries compared to the brute force scan",
+        { "Instances", "Query", "Results", "BVH", "Throughput", "Brute force", "Speedup" },
+        queryRows);
+    return 0;
+}
@@ -0,0 +1,50 @@
+/*
+ * Copyright (c) 2025-present Henri Michelon
+ *
+ * This software is released under the MIT License.
+ * https://opensource.org/licenses/MIT
+*/
+module lysa.benchmark;
+
+namespace lysa {
+
+    std::string Benchmark::throughput(const double count, const double milliseconds) {
+        const auto perSecond = count * 1000.0 / std::max(milliseconds, 1e-6);
+        if (perSecond >= 1e6) { return std::format("{:.1f} M/s", perSecond / 1e6); }
+        if (perSecond >= 1e3) { return std::format("{:.1f} K/s", perSecond / 1e3); }
+        return std::format("{:.1f} /s", perSecond);
+    }
+
+    void Benchmark::print(
+        const std::string& title,
+        const std::vector<std::string>& header,
+        const std::vector<std::vector<std::string>>& rows) {
+        auto widths = std::vector<size_t>(header.size());
+        for (auto i = 0; i < header.size(); i++) {
+            widths[i] = header[i].size();
+            for (const auto& row : rows) {
+                widths[i] = std::max(widths[i], row[i].size());
+            }
+        }
+        const auto printRow = [&](const std::vector<std::string>& cells) {
+            auto line = std::string{"|"};
+            for (auto i = 0; i < cells.size(); i++) {
+                line += i == 0 ?
+                    std::format(" {:<{}} |", cells[i], widths[i]) :
+                    std::format(" {:>{}} |", cells[i], widths[i]);
+            }
+            std::println("{}", line);
+        };
+        std::println("\n{}\n", title);
+        printRow(header);
+        auto separator = std::string{"|"};
+        for (auto i = 0; i < widths.size(); i++) {
+            separator += std::string(widths[i] + 1, '-') + (i == 0 ? "-|" : ":|");
+        }
+        std::println("{}", separator);
+        for (const auto& row : rows) {
+            printRow(row);
+        }
+    }
+
+}
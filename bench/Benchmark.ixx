@@ -0,0 +1,60 @@
+/*
+ * Copyright (c) 2025-present Henri Michelon
+ *
+ * This software is released under the MIT License.
+ * https://opensource.org/licenses/MIT
+*/
+export module lysa.benchmark;
+
+import std;
+import lysa.math;
+
+export namespace lysa {
+
+    /**
+     * Timing and reporting helpers shared by the benchmarks.
+     *
+     * The benchmarks print their results as tables in the format of the manual, so they can
+     * be pasted in the documentation and in the pull requests.
+     */
+    class Benchmark {
+    public:
+        /** Returned by the benchmarks needing a device when there is none. */
+        static constexpr int SKIPPED{77};
+
+        /**
+         * Returns the fastest of several runs of a function, in milliseconds.
+         * @param function Function to time
+         * @param runs Number of runs
+         */
+        template<typename Function>
+        static double measure(Function&& function, const uint32 runs = 5) {
+            auto best = std::numeric_limits<double>::max();
+            for (auto i = 0u; i < runs; i++) {
+                const auto start = std::chrono::steady_clock::now();
+                function();
+                best = std::min(best, std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count());
+            }
+            return best;
+        }
+
+        /**
+         * Formats a number of operations per second, with a K or M suffix.
+         * @param count Number of operations
+         * @param milliseconds Duration of the operations
+         */
+        static std::string throughput(double count, double milliseconds);
+
+        /**
+         * Prints a table, the first column aligned on the left and the others on the right.
+         * @param title Title printed above the table
+         * @param header Names of the columns
+         * @param rows Cells of the rows, as many as the columns
+         */
+        static void print(
+            const std::string& title,
+            const std::vector<std::string>& header,
+            const std::vector<std::vector<std::string>>& rows);
+    };
+
+}
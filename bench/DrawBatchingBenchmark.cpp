@@ -0,0 +1,118 @@
+/*
+ * Copyright (c) 2025-present Henri Michelon
+ *
+ * This software is released under the MIT License.
+ * https://opensource.org/licenses/MIT
+*/
+import std;
+import lysa.benchmark;
+import lysa.draw_batches;
+import lysa.math;
+
+using namespace lysa;
+
+// Draw commands of a foliage-like pipeline with the automatic instancing disabled and enabled.
+// The scene is made of a few grass and tree meshes of two surfaces with three materials, plus
+// unique props, and 40% of the draw commands pass the culling. With the automatic instancing
+// disabled each culled draw command is drawn, enabled each batch with visible instances is
+// drawn once. The CPU cost of the automatic instancing is the build of the batches, when the
+// instances of the pipeline change, the gathering itself runs in `draw_batching.comp` : its
+// CPU reference is timed to compare the work per frame.
+namespace {
+
+    constexpr auto FOLIAGE_MESHES{8u};
+    constexpr auto FOLIAGE_MATERIALS{3u};
+    constexpr auto PROPS{500u};
+
+    struct Surface {
+        uint32 meshSurfaceIndex;
+        uint32 materialIndex;
+        uint32 indexCount;
+        uint32 firstIndex;
+        int32  vertexOffset;
+    };
+
+    std::vector<Surface> createScene(const uint32 instances, std::mt19937& random) {
+        auto mesh = std::uniform_int_distribution{0u, FOLIAGE_MESHES - 1};
+        auto material = std::uniform_int_distribution{0u, FOLIAGE_MATERIALS - 1};
+        auto surfaces = std::vector<Surface>{};
+        surfaces.reserve(instances * 2 + PROPS);
+        for (auto i = 0u; i < instances; i++) {
+            // Leaves and trunk or blades and roots
+            const auto index = mesh(random);
+            for (auto surface = 0u; surface < 2; surface++) {
+                const auto meshSurfaceIndex = index * 2 + surface;
+                surfaces.push_back({
+                    meshSurfaceIndex,
+                    surface == 0 ? material(random) : FOLIAGE_MATERIALS,
+                    300 * (meshSurfaceIndex + 1),
+                    10000 * meshSurfaceIndex,
+                    static_cast<int32>(5000 * index) });
+            }
+        }
+        for (auto i = 0u; i < PROPS; i++) {
+            const auto meshSurfaceIndex = FOLIAGE_MESHES * 2 + i;
+            surfaces.push_back({ meshSurfaceIndex, FOLIAGE_MATERIALS + 1 + i % 10, 3000, 10000 * meshSurfaceIndex, 0 });
+        }
+        std::ranges::shuffle(surfaces, random);
+        return surfaces;
+    }
+
+    void addCommands(DrawBatches& batches, const std::vector<Surface>& surfaces) {
+        batches.clear();
+        for (auto i = 0u; i < surfaces.size(); i++) {
+            const auto& surface = surfaces[i];
+            batches.add(surface.meshSurfaceIndex, surface.materialIndex, i,
+                surface.indexCount, surface.firstIndex, surface.vertexOffset);
+        }
+        batches.updateRanges();
+    }
+
+}
+
+int main() {
+    auto random = std::mt19937{42};
+    auto visible = std::bernoulli_distribution{0.4};
+    auto rows = std::vector<std::vector<std::string>>{};
+    for (const auto count : { 10'000u, 100'000u, 500'000u }) {
+        const auto surfaces = createScene(count, random);
+        auto culled = std::vector<DrawBatches::Command>{};
+        for (auto i = 0u; i < surfaces.size(); i++) {
+            if (visible(random)) {
+                const auto& surface = surfaces[i];
+                culled.push_back({
+                    .instanceIndex = i,
+                    .indexCount = surface.indexCount,
+                    .instanceCount = 1,
+                    .firstIndex = surface.firstIndex,
+                    .vertexOffset = surface.vertexOffset,
+                    .firstInstance = i,
+                });
+            }
+        }
+
+        auto batches = DrawBatches{};
+        const auto buildTime = Benchmark::measure([&] { addCommands(batches, surfaces); });
+        auto output = std::vector<DrawBatches::Command>{};
+        auto instanceIndices = std::vector<uint32>{};
+        const auto compactTime = Benchmark::measure([&] { batches.compact(culled, output, instanceIndices); });
+
+        rows.push_back({
+            count >= 1'000'000 ? std::format("{}M", count / 1'000'000) : std::format("{}k", count / 1000),
+            std::format("{}", surfaces.size()),
+            std::format("{}", culled.size()),
+            std::format("{}", output.size()),
+            std::format("{}", batches.getBatches().size()),
+            std::format("{:.0f}x", static_cast<double>(culled.size()) / static_cast<double>(output.size())),
+            std::format("{:.2f} ms", buildTime),
+            std::format("{:.2f} ms", compactTime),
+            Benchmark::throughput(static_cast<double>(culled.size()), compactTime),
+        });
+    }
+
+    Benchmark::print(
+        "Draw commands of a foliage-like pipeline, automatic instancing disabled (off) and enabled (on)",
+        { "Instances", "Draw commands", "Draws off", "Draws on", "Batches", "Reduction", "Batches build", "Gathering (CPU reference)", "Throughput" },
+        rows);
+    return 0;
+}
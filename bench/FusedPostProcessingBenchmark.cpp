@@ -0,0 +1,248 @@
+/*
+ * Copyright (c) 2025-present Henri Michelon
+ *
+ * This software is released under the MIT License.
+ * https://opensource.org/licenses/MIT
+*/
+import lysa;
+import lysa.benchmark;
+
+using namespace lysa;
+
+// Renders a scene with a chain of three post-processing passes (Reinhard tone mapping, greyscale
+// and gamma correction) drawn as separate passes then fused in one draw, and compares the two
+// images. The two first passes write their attachment in 8 bits UNORM, 16 bits UNORM or 16 bits
+// float, to check the rounding of the fused shader to each format. The last pass writes a 16 bits
+// UNORM attachment in both paths, read back before the overlay and the gamma correction pass of
+// the renderer, which are not fused.
+// Needs a Vulkan device and a video driver, a software driver like lavapipe and the SDL
+// offscreen driver (SDL_VIDEODRIVER=offscreen) are enough. Skipped when there is none.
+namespace {
+
+    constexpr auto WIDTH{640u};
+    constexpr auto HEIGHT{360u};
+    // The first frames compile the pipelines
+    constexpr auto WARMUP_FRAMES{10u};
+    constexpr auto FRAMES{30u};
+    // Maximum difference of a color channel, in 1/255
+    constexpr auto TOLERANCE{1.0};
+
+    struct Capture {
+        std::vector<uint16> pixels;
+        double frameTime{0.0};
+    };
+
+    struct GammaCorrectionData {
+        float gamma;
+        float exposure;
+    };
+
+    // Unit cube of a color centered on the origin, four vertices per face for the normals
+    Mesh& createCube(const float4& color) {
+        auto& material = ctx().res.get<MaterialManager>().create();
+        material.setAlbedoColor(color);
+        auto vertices = std::vector<Vertex>{};
+        auto indices = std::vector<uint32>{};
+        const auto normals = std::array{
+            AXIS_X, -AXIS_X, AXIS_Y, -AXIS_Y, AXIS_Z, -AXIS_Z,
+        };
+        for (const auto& normal : normals) {
+            // Two axis perpendicular to the normal, counterclockwise seen from the outside
+            const float3 u = std::fabs(static_cast<float>(normal.y)) > 0.5f ? AXIS_X : AXIS_Y;
+            const float3 v = cross(normal, u);
+            const auto first = static_cast<uint32>(vertices.size());
+            for (const auto& [s, t] : { std::pair{-0.5f, -0.5f}, std::pair{0.5f, -0.5f}, std::pair{0.5f, 0.5f}, std::pair{-0.5f, 0.5f} }) {
+                vertices.push_back({
+                    .position = normal * 0.5f + u * s + v * t,
+                    .normal = normal,
+                    .uv = float2{s + 0.5f, t + 0.5f},
+                    .tangent = float4{u, 1.0f},
+                });
+            }
+            indices.insert(indices.end(), { first, first + 1, first + 2, first, first + 2, first + 3 });
+        }
+        auto& mesh = ctx().res.get<MeshManager>().create(
+            vertices,
+            indices,
+            { MeshSurface{0, static_cast<uint32>(indices.size())} },
+            "cube");
+        mesh.setSurfaceMaterial(0, material.id);
+        return mesh;
+    }
+
+    std::unique_ptr<MeshInstance> createInstance(Scene& scene, const float4& color, const float3& position, const float3& size) {
+        const auto& mesh = createCube(color);
+        auto instance = std::make_unique<MeshInstance>(mesh);
+        const auto transform = mul(float4x4::scale(size), float4x4::translation(position));
+        instance->setTransform(transform);
+        instance->setAABB(mesh.getAABB().toGlobal(transform));
+        scene.addInstance(*instance);
+        return instance;
+    }
+
+    // Copies the color attachment of the last frame, after the post-processing passes
+    std::vector<uint16> readColorAttachment(const RenderTarget& target) {
+        const auto frameIndex = (target.getCurrentFrameIndex() + target.getFramesInFlight() - 1) % target.getFramesInFlight();
+        const auto attachment = target.getRenderer().getCurrentColorAttachment(frameIndex);
+        const auto image = attachment->getImage();
+        const auto buffer = ctx().vireo->createBuffer(vireo::BufferType::IMAGE_DOWNLOAD, image->getAlignedImageSize());
+        ctx().graphicQueue->waitIdle();
+        const auto commandAllocator = ctx().vireo->createCommandAllocator(vireo::CommandType::GRAPHIC);
+        const auto commandList = commandAllocator->createCommandList();
+        commandList->begin();
+        commandList->barrier(attachment, vireo::ResourceState::UNDEFINED, vireo::ResourceState::COPY_SRC);
+        commandList->copy(image, buffer);
+        commandList->barrier(attachment, vireo::ResourceState::COPY_SRC, vireo::ResourceState::UNDEFINED);
+        commandList->end();
+        ctx().graphicQueue->submit({commandList});
+        ctx().graphicQueue->waitIdle();
+
+        buffer->map();
+        const auto rowPitch = image->getRowPitch();
+        const auto alignedRowPitch = image->getAlignedRowPitch();
+        auto pixels = std::vector<uint16>(image->getImageSize() / sizeof(uint16));
+        const auto* source = static_cast<uint8*>(buffer->getMappedAddress());
+        for (auto y = 0; y < image->getHeight(); y++) {
+            std::memcpy(reinterpret_cast<uint8*>(pixels.data()) + y * rowPitch, &source[y * alignedRowPitch], rowPitch);
+        }
+        buffer->unmap();
+        return pixels;
+    }
+
+    Capture render(Lysa& lysa, Scene& scene, const Camera& camera, const vireo::ImageFormat intermediateFormat, const bool fused) {
+        auto config = RenderingWindowConfiguration{
+            .title = "Fused post-processing",
+            .width = WIDTH,
+            .height = HEIGHT,
+        };
+        auto& rendererConfiguration = config.renderTargetConfiguration.rendererConfiguration;
+        // HDR colors for the tone mapping
+        rendererConfiguration.colorRenderingFormat = vireo::ImageFormat::R16G16B16A16_SFLOAT;
+        // Only the passes of the benchmark between the scene and the overlay
+        rendererConfiguration.bloomEnabled = false;
+        rendererConfiguration.antiAliasingType = AntiAliasingType::NONE;
+        rendererConfiguration.pipelineCompilationThreads = 0;
+        rendererConfiguration.postProcessingFusionEnabled = fused;
+        auto window = RenderingWindow{config};
+        auto& target = window.getRenderTarget();
+        auto view = RenderView{camera, scene};
+        target.addView(view);
+
+        auto toneMappingData = GammaCorrectionData{ .gamma = 1.0f, .exposure = 3.0f };
+        auto gammaCorrectionData = GammaCorrectionData{ .gamma = 2.2f, .exposure = 1.0f };
+        auto toneMapping = PostProcessing{
+            rendererConfiguration, intermediateFormat, "reinhard", &toneMappingData, sizeof(toneMappingData) };
+        auto greyscale = PostProcessing{ rendererConfiguration, intermediateFormat, "greyscale" };
+        auto gammaCorrection = PostProcessing{
+            rendererConfiguration, vireo::ImageFormat::R16G16B16A16_UNORM, "gamma_correction",
+            &gammaCorrectionData, sizeof(gammaCorrectionData) };
+        auto& renderer = target.getRenderer();
+        renderer.addPostprocessing(toneMapping);
+        renderer.addPostprocessing(greyscale);
+        renderer.addPostprocessing(gammaCorrection);
+
+        auto frames = 0u;
+        auto start = std::chrono::steady_clock::now();
+        const auto handler = ctx().events.subscribe(MainLoopEvent::PROCESS, [&](Event&) {
+            target.render();
+            frames += 1;
+            if (frames == WARMUP_FRAMES) {
+                start = std::chrono::steady_clock::now();
+            } else if (frames == WARMUP_FRAMES + FRAMES) {
+                ctx().exit = true;
+            }
+        });
+        ctx().exit = false;
+        lysa.run();
+        const auto elapsed = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+        ctx().events.unsubscribe(handler);
+
+        auto capture = Capture{ readColorAttachment(target), elapsed / FRAMES };
+        ctx().graphicQueue->waitIdle();
+        renderer.removePostprocessing("gamma_correction");
+        renderer.removePostprocessing("greyscale");
+        renderer.removePostprocessing("reinhard");
+        target.removeView(view);
+        return capture;
+    }
+
+}
+
+int main() {
+    auto config = ContextConfiguration{};
+    config.virtualFsConfiguration.appDirectory = LYSA_APP_DIRECTORY;
+    auto lysa = std::unique_ptr<Lysa>{};
+    try {
+        lysa = std::make_unique<Lysa>(config);
+    } catch (const std::exception& e) {
+        std::println(std::cerr, "No Vulkan device : {}", e.what());
+        return Benchmark::SKIPPED;
+    }
+
+    // Declared before the scene, which keeps pointers to them
+    const auto sun = Light{
+        LightType::LIGHT_DIRECTIONAL, float3{1.0f}, 2.0f,
+        inverse(look_at(float3{2.0f, 5.0f, 3.0f}, float3{0.0f}, AXIS_UP)) };
+    auto instances = std::vector<std::unique_ptr<MeshInstance>>{};
+    auto scene = Scene{};
+    instances.push_back(createInstance(scene, float4{0.8f, 0.8f, 0.8f, 1.0f}, float3{0.0f, -0.1f, 0.0f}, float3{30.0f, 0.2f, 30.0f}));
+    // Dark to over-exposed colors, to use the whole range of the tone mapping
+    for (auto i = 0; i < 8; i++) {
+        const auto angle = radians(45.0f * static_cast<float>(i));
+        const auto intensity = 0.05f + 0.3f * static_cast<float>(i);
+        const auto color = float4{intensity, intensity * 0.6f, 1.0f - 0.1f * static_cast<float>(i), 1.0f};
+        const auto position = float3{3.0f * std::cos(angle), 1.0f, 3.0f * std::sin(angle)};
+        instances.push_back(createInstance(scene, color, position, float3{1.0f, 2.0f, 1.0f}));
+    }
+    scene.addLight(sun);
+    const auto camera = Camera{
+        inverse(look_at(float3{0.0f, 6.0f, 8.0f}, float3{0.0f}, AXIS_UP)),
+        perspective(radians(60.0f), static_cast<float>(WIDTH) / HEIGHT, 0.1f, 100.0f),
+        0.1f, 100.0f };
+
+    const auto formats = std::array{
+        std::pair{vireo::ImageFormat::R8G8B8A8_UNORM, "UNORM 8"},
+        std::pair{vireo::ImageFormat::R16G16B16A16_UNORM, "UNORM 16"},
+        std::pair{vireo::ImageFormat::R16G16B16A16_SFLOAT, "FLOAT 16"},
+    };
+    auto rows = std::vector<std::vector<std::string>>{};
+    auto failed = false;
+    for (const auto& [format, name] : formats) {
+        auto separate = Capture{};
+        auto fused = Capture{};
+        try {
+            separate = render(*lysa, scene, camera, format, false);
+            fused = render(*lysa, scene, camera, format, true);
+        } catch (const std::exception& e) {
+            std::println(std::cerr, "No video driver : {}", e.what());
+            return Benchmark::SKIPPED;
+        }
+
+        auto maxDifference = 0.0;
+        auto differentPixels = 0u;
+        for (auto i = 0; i < separate.pixels.size(); i += 4) {
+            auto difference = 0.0;
+            for (auto channel = 0; channel < 3; channel++) {
+                difference = std::max(difference, std::abs(
+                    static_cast<double>(separate.pixels[i + channel]) -
+                    static_cast<double>(fused.pixels[i + channel])) * 255.0 / 65535.0);
+            }
+            maxDifference = std::max(maxDifference, difference);
+            differentPixels += difference > 0.0 ? 1 : 0;
+        }
+        failed |= maxDifference > TOLERANCE;
+        rows.push_back({
+            name,
+            std::format("{:.2f} ms", separate.frameTime),
+            std::format("{:.2f} ms", fused.frameTime),
+            std::format("{:.2f}/255", maxDifference),
+            std::format("{} ({:.3f}%)", differentPixels, 100.0 * differentPixels / (WIDTH * HEIGHT)),
+        });
+    }
+
+    Benchmark::print(
+        "Chain of three post-processing passes drawn separately compared to fused in one draw",
+        { "Intermediate format", "Separate passes", "Fused", "Max difference", "Different pixels" },
+        rows);
+    return failed ? 1 : 0;
+}
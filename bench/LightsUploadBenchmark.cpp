@@ -0,0 +1,114 @@
+/*
+ * Copyright (c) 2025-present Henri Michelon
+ *
+ * This software is released under the MIT License.
+ * https://opensource.org/licenses/MIT
+*/
+import lysa;
+import lysa.benchmark;
+
+using namespace lysa;
+
+// Bytes of light data uploaded per frame for 1000 lights, with 0 to 1000 of them moving each
+// frame, compared to the upload of all the lights each frame done before the persistent slots.
+// The lights do not cast shadows : a moving shadow caster adds sizeof(ShadowData).
+// Needs a Vulkan device, a software driver like lavapipe is enough. Skipped when there is none.
+namespace {
+
+    constexpr auto LIGHTS{1000u};
+    constexpr auto FRAMES{100u};
+    // LightData with the matrices and the tiles of six shadow maps, uploaded for every light
+    // every frame before the split of ShadowData
+    constexpr auto FULL_LIGHT_DATA_SIZE{576u};
+
+    struct Result {
+        double uploadSize{0.0};
+        double updateTime{0.0};
+    };
+
+    // Updates the scene data of each frame with `moving` lights changing position every frame
+    Result update(Scene& scene, std::vector<Light>& lights, const uint32 moving) {
+        const auto camera = Camera{
+            float4x4::identity(),
+            perspective(radians(60.0f), 16.0f / 9.0f, 0.1f, 100.0f),
+            0.1f, 100.0f };
+        const auto config = RendererConfiguration{};
+        const auto framesInFlight = ctx().config.framesInFlight;
+        const auto commandAllocator = ctx().vireo->createCommandAllocator(vireo::CommandType::GRAPHIC);
+        const auto commandList = commandAllocator->createCommandList();
+
+        auto result = Result{};
+        // The first update of each frame in flight uploads all the lights
+        for (auto frame = 0u; frame < framesInFlight + FRAMES; frame++) {
+            const auto frameIndex = frame % framesInFlight;
+            for (auto i = 0u; i < moving; i++) {
+                lights[i].transform = float4x4::translation(float3{
+                    static_cast<float>(i % 32) * 2.0f,
+                    1.0f + 0.01f * static_cast<float>(frame),
+                    static_cast<float>(i / 32) * 2.0f});
+            }
+            auto& data = scene.get(frameIndex);
+            commandAllocator->reset();
+            commandList->begin();
+            const auto start = std::chrono::steady_clock::now();
+            data.update(*commandList, camera, config, frameIndex);
+            const auto elapsed = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+            commandList->end();
+            ctx().graphicQueue->submit({commandList});
+            ctx().graphicQueue->waitIdle();
+            if (frame >= framesInFlight) {
+                result.uploadSize += static_cast<double>(data.getLightsUploadSize()) / FRAMES;
+                result.updateTime += elapsed / FRAMES;
+            }
+        }
+        return result;
+    }
+
+    std::string bytes(const double size) {
+        return size >= 1024.0 ? std::format("{:.1f} KiB", size / 1024.0) : std::format("{:.0f} B", size);
+    }
+
+}
+
+int main() {
+    auto config = ContextConfiguration{};
+    config.virtualFsConfiguration.appDirectory = LYSA_APP_DIRECTORY;
+    auto lysa = std::unique_ptr<Lysa>{};
+    try {
+        lysa = std::make_unique<Lysa>(config);
+    } catch (const std::exception& e) {
+        std::println(std::cerr, "No Vulkan device : {}", e.what());
+        return Benchmark::SKIPPED;
+    }
+
+    // Declared before the scene, which keeps pointers to them
+    auto lights = std::vector<Light>{};
+    for (auto i = 0u; i < LIGHTS; i++) {
+        lights.push_back(Light{
+            LightType::LIGHT_OMNI, float3{1.0f}, 1.0f,
+            float4x4::translation(float3{static_cast<float>(i % 32) * 2.0f, 1.0f, static_cast<float>(i / 32) * 2.0f}),
+            3.0f });
+    }
+    auto scene = Scene{};
+    for (const auto& light : lights) {
+        scene.addLight(light);
+    }
+
+    auto rows = std::vector<std::vector<std::string>>{};
+    const auto fullUploadSize = static_cast<double>(LIGHTS) * FULL_LIGHT_DATA_SIZE;
+    for (const auto moving : { 0u, 10u, 100u, 1000u }) {
+        const auto result = update(scene, lights, moving);
+        rows.push_back({
+            std::format("{}", moving),
+            bytes(fullUploadSize),
+            bytes(result.uploadSize),
+            std::format("{:.1f}%", 100.0 * (1.0 - result.uploadSize / fullUploadSize)),
+            std::format("{:.3f} ms", result.updateTime),
+        });
+    }
+    Benchmark::print(
+        std::format("Light data uploaded per frame for {} lights compared to the upload of all the lights", LIGHTS),
+        { "Moving lights", "All the lights", "Changed lights", "Saved", "Scene update" },
+        rows);
+    return 0;
+}
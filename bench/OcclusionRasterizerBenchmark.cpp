@@ -0,0 +1,216 @@
+/*
+ * Copyright (c) 2025-present Henri Michelon
+ *
+ * This software is released under the MIT License.
+ * https://opensource.org/licenses/MIT
+*/
+import std;
+import lysa.aabb;
+import lysa.benchmark;
+import lysa.bvh;
+import lysa.math;
+import lysa.occlusion_rasterizer;
+import lysa.triangle_bvh;
+
+using namespace lysa;
+
+// Occluders rasterization and AABB tests of the software occlusion culling, and accuracy of the
+// results compared to ray casts. The occluders are the buildings of a city block, the occludees
+// small boxes spread between them. A box is visible for the reference when a ray from the camera
+// reaches one of the points sampled on its faces inside the screen without hitting an occluder.
+namespace {
+
+    constexpr auto VIEWS{4};
+    constexpr auto OCCLUDEES{5000};
+    // Points sampled on each face of an occludee for the reference
+    constexpr auto SAMPLES_PER_SIDE{4};
+    constexpr auto ASPECT_RATIO{2.0f};
+
+    struct Occluder {
+        float4x4 transform;
+    };
+
+    enum class Visibility { OFFSCREEN, VISIBLE, HIDDEN };
+
+    struct View {
+        float3 eye;
+        float4x4 viewProjection;
+        std::vector<Visibility> visibility;
+    };
+
+    // Unit cube centered on the origin
+    const auto boxPositions = std::vector<float3>{
+        {-0.5f, -0.5f, -0.5f}, { 0.5f, -0.5f, -0.5f}, { 0.5f,  0.5f, -0.5f}, {-0.5f,  0.5f, -0.5f},
+        {-0.5f, -0.5f,  0.5f}, { 0.5f, -0.5f,  0.5f}, { 0.5f,  0.5f,  0.5f}, {-0.5f,  0.5f,  0.5f},
+    };
+    const auto boxIndices = std::vector<uint32>{
+        0, 2, 1, 0, 3, 2,  4, 5, 6, 4, 6, 7,  0, 1, 5, 0, 5, 4,
+        3, 6, 2, 3, 7, 6,  0, 4, 7, 0, 7, 3,  1, 2, 6, 1, 6, 5,
+    };
+
+    // Grid of 6 x 6 buildings of 6 x 6 units and 4 to 12 units high
+    std::vector<Occluder> createOccluders(std::mt19937& random) {
+        auto height = std::uniform_real_distribution{4.0f, 12.0f};
+        auto occluders = std::vector<Occluder>{};
+        for (auto z = 0; z < 6; z++) {
+            for (auto x = 0; x < 6; x++) {
+                const auto size = float3{6.0f, height(random), 6.0f};
+                const auto center = float3{-25.0f + x * 10.0f, static_cast<float>(size.y) * 0.5f, 10.0f + z * 10.0f};
+                occluders.push_back({ mul(float4x4::scale(size), float4x4::translation(center)) });
+            }
+        }
+        return occluders;
+    }
+
+    std::vector<AABB> createOccludees(std::mt19937& random) {
+        auto x = std::uniform_real_distribution{-30.0f, 30.0f};
+        auto y = std::uniform_real_distribution{0.0f, 10.0f};
+        auto z = std::uniform_real_distribution{5.0f, 70.0f};
+        auto extent = std::uniform_real_distribution{0.25f, 1.0f};
+        auto occludees = std::vector<AABB>(OCCLUDEES);
+        for (auto& box : occludees) {
+            const auto center = float3{x(random), y(random), z(random)};
+            const auto half = float3{extent(random), extent(random), extent(random)};
+            box = AABB{center - half, center + half};
+        }
+        return occludees;
+    }
+
+    // All the occluders in world space for the reference ray casts
+    TriangleBVH createReference(const std::vector<Occluder>& occluders) {
+        auto positions = std::vector<float3>{};
+        auto indices = std::vector<uint32>{};
+        auto surfaces = std::vector<std::pair<uint32, uint32>>{};
+        for (const auto& occluder : occluders) {
+            const auto firstVertex = static_cast<uint32>(positions.size());
+            surfaces.push_back({ static_cast<uint32>(indices.size()), static_cast<uint32>(boxIndices.size()) });
+            for (const auto& position : boxPositions) {
+                positions.push_back(float3{mul(float4{position, 1.0f}, occluder.transform).xyz});
+            }
+            for (const auto index : boxIndices) {
+                indices.push_back(firstVertex + index);
+            }
+        }
+        return TriangleBVH{positions, indices, surfaces};
+    }
+
+    bool isOnScreen(const float3& point, const float4x4& viewProjection) {
+        const float4 clip = mul(float4{point, 1.0f}, viewProjection);
+        const float w = clip.w;
+        if (w <= 1e-5f) { return false; }
+        const float x = clip.x / w;
+        const float y = clip.y / w;
+        return x >= -1.0f && x <= 1.0f && y >= -1.0f && y <= 1.0f;
+    }
+
+    Visibility getVisibility(const AABB& box, const View& view, const TriangleBVH& reference) {
+        auto onScreen = false;
+        const float3 size = box.max - box.min;
+        for (auto axis = 0; axis < 3; axis++) {
+            for (auto side = 0; side < 2; side++) {
+                for (auto i = 0; i < SAMPLES_PER_SIDE; i++) {
+                    for (auto j = 0; j < SAMPLES_PER_SIDE; j++) {
+                        // Grid of points on the face, including its edges
+                        const auto u = static_cast<float>(i) / (SAMPLES_PER_SIDE - 1);
+                        const auto v = static_cast<float>(j) / (SAMPLES_PER_SIDE - 1);
+                        auto offset = std::array<float, 3>{};
+                        offset[axis] = static_cast<float>(side);
+                        offset[(axis + 1) % 3] = u;
+                        offset[(axis + 2) % 3] = v;
+                        const float3 point = box.min + float3{offset[0], offset[1], offset[2]} * size;
+                        if (!isOnScreen(point, view.viewProjection)) { continue; }
+                        onScreen = true;
+                        const float distance = length(point - view.eye);
+                        if (!reference.raycast(Ray{view.eye, point - view.eye}, distance * 0.999f)) {
+                            return Visibility::VISIBLE;
+                        }
+                    }
+                }
+            }
+        }
+        return onScreen ? Visibility::HIDDEN : Visibility::OFFSCREEN;
+    }
+
+    std::vector<View> createViews(
+        const std::vector<AABB>& occludees,
+        const TriangleBVH& reference,
+        std::mt19937& random) {
+        auto x = std::uniform_real_distribution{-20.0f, 20.0f};
+        auto y = std::uniform_real_distribution{1.5f, 6.0f};
+        const auto projection = perspective(radians(60.0f), ASPECT_RATIO, 0.1f, 200.0f);
+        auto views = std::vector<View>(VIEWS);
+        for (auto& view : views) {
+            view.eye = float3{x(random), y(random), -5.0f};
+            const auto center = float3{x(random), static_cast<float>(view.eye.y), 40.0f};
+            view.viewProjection = mul(look_at(view.eye, center, AXIS_UP), projection);
+            for (const auto& box : occludees) {
+                view.visibility.push_back(getVisibility(box, view, reference));
+            }
+        }
+        return views;
+    }
+
+    std::string percent(const double value, const double total) {
+        return std::format("{:.1f}%", total > 0.0 ? 100.0 * value / total : 0.0);
+    }
+
+}
+
+int main() {
+    auto random = std::mt19937{42};
+    const auto occluders = createOccluders(random);
+    const auto occludees = createOccludees(random);
+    const auto reference = createReference(occluders);
+    const auto views = createViews(occludees, reference, random);
+
+    auto rows = std::vector<std::vector<std::string>>{};
+    for (const auto width : { 128u, 256u, 512u }) {
+        auto rasterizer = OcclusionRasterizer{width, static_cast<uint32>(width / ASPECT_RATIO)};
+        auto renderTime = 0.0;
+        auto testTime = 0.0;
+        auto triangles = 0.0;
+        auto hidden = 0u;
+        auto culled = 0u;
+        auto wrong = 0u;
+        for (const auto& view : views) {
+            renderTime += Benchmark::measure([&] {
+                rasterizer.begin(view.viewProjection);
+                for (const auto& occluder : occluders) {
+                    rasterizer.renderOccluder(boxPositions, boxIndices, occluder.transform);
+                }
+                rasterizer.end();
+            });
+            triangles += rasterizer.getStatistics().trianglesRasterized;
+
+            auto occluded = std::vector<bool>(occludees.size());
+            testTime += Benchmark::measure([&] {
+                for (auto i = 0; i < occludees.size(); i++) {
+                    occluded[i] = rasterizer.isOccluded(occludees[i]);
+                }
+            });
+            for (auto i = 0; i < occludees.size(); i++) {
+                if (view.visibility[i] == Visibility::HIDDEN) {
+                    hidden += 1;
+                    culled += occluded[i] ? 1 : 0;
+                } else if (view.visibility[i] == Visibility::VISIBLE && occluded[i]) {
+                    wrong += 1;
+                }
+            }
+        }
+        rows.push_back({
+            std::format("{}x{}", rasterizer.getWidth(), rasterizer.getHeight()),
+            std::format("{:.3f} ms", renderTime / VIEWS),
+            Benchmark::throughput(triangles, renderTime),
+            std::format("{:.3f} ms", testTime / VIEWS),
+            Benchmark::throughput(static_cast<double>(OCCLUDEES) * VIEWS, testTime),
+            percent(hidden, static_cast<double>(OCCLUDEES) * VIEWS),
+            percent(culled, hidden),
+            std::format("{}", wrong),
+        });
+    }
+    Benchmark::print(
+        std::format("Occlusion culling of {} boxes behind {} buildings, compared to ray casts", OCCLUDEES, occluders.size()),
+        { "Depth buffer", "Occluders", "Triangles", "AABB tests", "Tests", "Hidden", "Culled", "Wrongly culled" },
+        rows);
+    return 0;
+}
@@ -0,0 +1,219 @@
+/*
+ * Copyright (c) 2025-present Henri Michelon
+ *
+ * This software is released under the MIT License.
+ * https://opensource.org/licenses/MIT
+*/
+import lysa;
+import lysa.benchmark;
+
+using namespace lysa;
+
+// Renders a scene lit by a shadow casting omni light with the six faces of the shadow map in
+// one pass, then one pass per face, and compares the two images. The pillars around the light
+// are placed every 45 degrees so their shadows cross the edges of the cube faces.
+// Needs a Vulkan device and a video driver, a software driver like lavapipe and the SDL
+// offscreen driver (SDL_VIDEODRIVER=offscreen) are enough. Skipped when there is none.
+namespace {
+
+    constexpr auto WIDTH{640u};
+    constexpr auto HEIGHT{360u};
+    // The first frames compile the pipelines and allocate the shadow atlas
+    constexpr auto WARMUP_FRAMES{10u};
+    constexpr auto FRAMES{30u};
+    // Difference of a color channel ignored, in 1/255
+    constexpr auto TOLERANCE{2.0};
+    // Maximum ratio of different pixels
+    constexpr auto MAX_DIFFERENT_PIXELS{0.001};
+
+    struct Capture {
+        std::vector<uint16> pixels;
+        double frameTime{0.0};
+    };
+
+    // Unit cube centered on the origin, four vertices per face for the normals
+    Mesh& createCube(StandardMaterial& material) {
+        auto vertices = std::vector<Vertex>{};
+        auto indices = std::vector<uint32>{};
+        const auto normals = std::array{
+            AXIS_X, -AXIS_X, AXIS_Y, -AXIS_Y, AXIS_Z, -AXIS_Z,
+        };
+        for (const auto& normal : normals) {
+            // Two axis perpendicular to the normal, counterclockwise seen from the outside
+            const float3 u = std::fabs(static_cast<float>(normal.y)) > 0.5f ? AXIS_X : AXIS_Y;
+            const float3 v = cross(normal, u);
+            const auto first = static_cast<uint32>(vertices.size());
+            for (const auto& [s, t] : { std::pair{-0.5f, -0.5f}, std::pair{0.5f, -0.5f}, std::pair{0.5f, 0.5f}, std::pair{-0.5f, 0.5f} }) {
+                vertices.push_back({
+                    .position = normal * 0.5f + u * s + v * t,
+                    .normal = normal,
+                    .uv = float2{s + 0.5f, t + 0.5f},
+                    .tangent = float4{u, 1.0f},
+                });
+            }
+            indices.insert(indices.end(), { first, first + 1, first + 2, first, first + 2, first + 3 });
+        }
+        auto& mesh = ctx().res.get<MeshManager>().create(
+            vertices,
+            indices,
+            { MeshSurface{0, static_cast<uint32>(indices.size())} },
+            "cube");
+        mesh.setSurfaceMaterial(0, material.id);
+        return mesh;
+    }
+
+    std::unique_ptr<MeshInstance> createInstance(Scene& scene, const Mesh& mesh, const float3& position, const float3& size) {
+        auto instance = std::make_unique<MeshInstance>(mesh);
+        const auto transform = mul(float4x4::scale(size), float4x4::translation(position));
+        instance->setTransform(transform);
+        instance->setAABB(mesh.getAABB().toGlobal(transform));
+        instance->setCastShadows(true);
+        scene.addInstance(*instance);
+        return instance;
+    }
+
+    // Copies the color attachment of the last frame, before the post-processing
+    std::vector<uint16> readColorAttachment(const RenderTarget& target) {
+        const auto frameIndex = (target.getCurrentFrameIndex() + target.getFramesInFlight() - 1) % target.getFramesInFlight();
+        const auto attachment = target.getRenderer().getColorAttachment(frameIndex);
+        const auto image = attachment->getImage();
+        const auto buffer = ctx().vireo->createBuffer(vireo::BufferType::IMAGE_DOWNLOAD, image->getAlignedImageSize());
+        ctx().graphicQueue->waitIdle();
+        const auto commandAllocator = ctx().vireo->createCommandAllocator(vireo::CommandType::GRAPHIC);
+        const auto commandList = commandAllocator->createCommandList();
+        commandList->begin();
+        commandList->barrier(attachment, vireo::ResourceState::UNDEFINED, vireo::ResourceState::COPY_SRC);
+        commandList->copy(image, buffer);
+        commandList->barrier(attachment, vireo::ResourceState::COPY_SRC, vireo::ResourceState::UNDEFINED);
+        commandList->end();
+        ctx().graphicQueue->submit({commandList});
+        ctx().graphicQueue->waitIdle();
+
+        buffer->map();
+        const auto rowPitch = image->getRowPitch();
+        const auto alignedRowPitch = image->getAlignedRowPitch();
+        auto pixels = std::vector<uint16>(image->getImageSize() / sizeof(uint16));
+        const auto* source = static_cast<uint8*>(buffer->getMappedAddress());
+        for (auto y = 0; y < image->getHeight(); y++) {
+            std::memcpy(reinterpret_cast<uint8*>(pixels.data()) + y * rowPitch, &source[y * alignedRowPitch], rowPitch);
+        }
+        buffer->unmap();
+        return pixels;
+    }
+
+    Capture render(Lysa& lysa, Scene& scene, const Camera& camera, const bool singlePass) {
+        auto config = RenderingWindowConfiguration{
+            .title = "Omni shadow maps",
+            .width = WIDTH,
+            .height = HEIGHT,
+        };
+        auto& rendererConfiguration = config.renderTargetConfiguration.rendererConfiguration;
+        // Read back as four 16 bits channels
+        rendererConfiguration.colorRenderingFormat = vireo::ImageFormat::R16G16B16A16_UNORM;
+        // All the instances drawn from the first frame
+        rendererConfiguration.pipelineCompilationThreads = 0;
+        rendererConfiguration.shadowMapsCacheEnabled = false;
+        rendererConfiguration.omniShadowMapsSinglePassEnabled = singlePass;
+        auto window = RenderingWindow{config};
+        auto& target = window.getRenderTarget();
+        auto view = RenderView{camera, scene};
+        target.addView(view);
+
+        auto frames = 0u;
+        auto start = std::chrono::steady_clock::now();
+        const auto handler = ctx().events.subscribe(MainLoopEvent::PROCESS, [&](Event&) {
+            target.render();
+            frames += 1;
+            if (frames == WARMUP_FRAMES) {
+                start = std::chrono::steady_clock::now();
+            } else if (frames == WARMUP_FRAMES + FRAMES) {
+                ctx().exit = true;
+            }
+        });
+        ctx().exit = false;
+        lysa.run();
+        const auto elapsed = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+        ctx().events.unsubscribe(handler);
+
+        auto capture = Capture{ readColorAttachment(target), elapsed / FRAMES };
+        target.removeView(view);
+        return capture;
+    }
+
+}
+
+int main() {
+    auto config = ContextConfiguration{};
+    config.virtualFsConfiguration.appDirectory = LYSA_APP_DIRECTORY;
+    auto lysa = std::unique_ptr<Lysa>{};
+    try {
+        lysa = std::make_unique<Lysa>(config);
+    } catch (const std::exception& e) {
+        std::println(std::cerr, "No Vulkan device : {}", e.what());
+        return Benchmark::SKIPPED;
+    }
+
+    // Declared before the scene, which keeps pointers to them
+    const auto light = Light{
+        LightType::LIGHT_OMNI, float3{1.0f}, 4.0f,
+        float4x4::translation(float3{0.0f, 1.5f, 0.0f}),
+        20.0f, 1.3f, 1.4f, true, 1024 };
+    auto instances = std::vector<std::unique_ptr<MeshInstance>>{};
+    auto scene = Scene{};
+    auto& material = ctx().res.get<MaterialManager>().create();
+    material.setAlbedoColor(float4{0.8f, 0.8f, 0.8f, 1.0f});
+    const auto& cube = createCube(material);
+    instances.push_back(createInstance(scene, cube, float3{0.0f, -0.1f, 0.0f}, float3{30.0f, 0.2f, 30.0f}));
+    for (auto i = 0; i < 8; i++) {
+        const auto angle = radians(45.0f * static_cast<float>(i));
+        const auto position = float3{3.0f * std::cos(angle), 1.0f, 3.0f * std::sin(angle)};
+        instances.push_back(createInstance(scene, cube, position, float3{0.6f, 2.0f, 0.6f}));
+    }
+    scene.addLight(light);
+    const auto camera = Camera{
+        inverse(look_at(float3{0.0f, 10.0f, 10.0f}, float3{0.0f}, AXIS_UP)),
+        perspective(radians(60.0f), static_cast<float>(WIDTH) / HEIGHT, 0.1f, 100.0f),
+        0.1f, 100.0f };
+
+    auto singlePass = Capture{};
+    auto perFace = Capture{};
+    try {
+        singlePass = render(*lysa, scene, camera, true);
+        if (!ShadowMapPass::isSinglePassSupported()) {
+            std::println(std::cerr, "Single pass omni shadow maps not supported by the device");
+            return Benchmark::SKIPPED;
+        }
+        perFace = render(*lysa, scene, camera, false);
+    } catch (const std::exception& e) {
+        std::println(std::cerr, "No video driver : {}", e.what());
+        return Benchmark::SKIPPED;
+    }
+
+    auto maxDifference = 0.0;
+    auto differentPixels = 0u;
+    for (auto i = 0; i < singlePass.pixels.size(); i += 4) {
+        auto difference = 0.0;
+        for (auto channel = 0; channel < 3; channel++) {
+            difference = std::max(difference, std::abs(
+                static_cast<double>(singlePass.pixels[i + channel]) -
+                static_cast<double>(perFace.pixels[i + channel])) * 255.0 / 65535.0);
+        }
+        maxDifference = std::max(maxDifference, difference);
+        differentPixels += difference > TOLERANCE ? 1 : 0;
+    }
+    const auto ratio = static_cast<double>(differentPixels) / (WIDTH * HEIGHT);
+
+    Benchmark::print(
+        "Omni shadow maps rendered in one pass compared to one pass per face",
+        { "Mode", "Frame time", "Max difference", "Different pixels" },
+        {
+            { "per face", std::format("{:.2f} ms", perFace.frameTime), "", "" },
+            {
+                "single pass",
+                std::format("{:.2f} ms", singlePass.frameTime),
+                std::format("{:.1f}/255", maxDifference),
+                std::format("{} ({:.3f}%)", differentPixels, ratio * 100.0),
+            },
+        });
+    return ratio > MAX_DIFFERENT_PIXELS ? 1 : 0;
+}
@@ -0,0 +1,109 @@
+/*
+ * Copyright (c) 2025-present Henri Michelon
+ *
+ * This software is released under the MIT License.
+ * https://opensource.org/licenses/MIT
+*/
+import lysa;
+import lysa.benchmark;
+
+using namespace lysa;
+
+// Recording time of the shadow maps jobs of 50 omni lights by the RecordingScheduler on 1, 2, 4
+// and 8 threads. Each job records the commands of one light : for each face a barrier and 100
+// small buffer copies standing for the draws, the copies being valid outside a render pass.
+// Needs a Vulkan device, a software driver like lavapipe is enough. Skipped when there is none.
+namespace {
+
+    constexpr auto LIGHTS{50u};
+    constexpr auto FACES{6u};
+    constexpr auto DRAWS_PER_FACE{100u};
+    constexpr auto COPY_SIZE{64u};
+    constexpr auto WARMUP_FRAMES{3u};
+    constexpr auto FRAMES{50u};
+
+    struct Result {
+        double recordingTime{0.0};
+        double maxRecordingTime{0.0};
+    };
+
+    Result record(
+        const uint32 threads,
+        const std::vector<RecordingScheduler::Job>& jobs) {
+        auto scheduler = RecordingScheduler{threads, vireo::CommandType::GRAPHIC};
+        const auto framesInFlight = ctx().config.framesInFlight;
+        auto result = Result{};
+        for (auto frame = 0u; frame < WARMUP_FRAMES + FRAMES; frame++) {
+            const auto& commandLists = scheduler.record(frame % framesInFlight, jobs);
+            ctx().graphicQueue->submit(commandLists);
+            ctx().graphicQueue->waitIdle();
+            if (frame >= WARMUP_FRAMES) {
+                result.recordingTime += scheduler.getRecordingTime() / FRAMES;
+                result.maxRecordingTime = std::max(result.maxRecordingTime, scheduler.getRecordingTime());
+            }
+        }
+        return result;
+    }
+
+}
+
+int main() {
+    auto config = ContextConfiguration{};
+    config.virtualFsConfiguration.appDirectory = LYSA_APP_DIRECTORY;
+    auto lysa = std::unique_ptr<Lysa>{};
+    try {
+        lysa = std::make_unique<Lysa>(config);
+    } catch (const std::exception& e) {
+        std::println(std::cerr, "No Vulkan device : {}", e.what());
+        return Benchmark::SKIPPED;
+    }
+
+    // One source and one destination buffer per light, as the lights write their own tiles
+    auto sources = std::vector<std::shared_ptr<vireo::Buffer>>{};
+    auto destinations = std::vector<std::shared_ptr<vireo::Buffer>>{};
+    for (auto i = 0u; i < LIGHTS; i++) {
+        sources.push_back(ctx().vireo->createBuffer(vireo::BufferType::BUFFER_UPLOAD, DRAWS_PER_FACE * COPY_SIZE));
+        destinations.push_back(ctx().vireo->createBuffer(vireo::BufferType::STORAGE, FACES * DRAWS_PER_FACE * COPY_SIZE));
+    }
+    // Built once, the jobs only read them
+    auto regions = std::vector<std::vector<vireo::BufferCopyRegion>>{};
+    for (auto i = 0u; i < FACES * DRAWS_PER_FACE; i++) {
+        regions.push_back({ { (i % DRAWS_PER_FACE) * COPY_SIZE, i * COPY_SIZE, COPY_SIZE } });
+    }
+
+    auto jobs = std::vector<RecordingScheduler::Job>{};
+    for (auto light = 0u; light < LIGHTS; light++) {
+        jobs.push_back([&, light](vireo::CommandList& commandList) {
+            const auto& destination = destinations[light];
+            commandList.barrier(*destination, vireo::ResourceState::UNDEFINED, vireo::ResourceState::COPY_DST);
+            for (auto face = 0u; face < FACES; face++) {
+                for (auto draw = 0u; draw < DRAWS_PER_FACE; draw++) {
+                    commandList.copy(sources[light], destination, regions[face * DRAWS_PER_FACE + draw]);
+                }
+            }
+            commandList.barrier(*destination, vireo::ResourceState::COPY_DST, vireo::ResourceState::SHADER_READ);
+        });
+    }
+
+    auto rows = std::vector<std::vector<std::string>>{};
+    auto singleThreadTime = 0.0;
+    for (const auto threads : { 1u, 2u, 4u, 8u }) {
+        const auto result = record(threads, jobs);
+        if (threads == 1) {
+            singleThreadTime = result.recordingTime;
+        }
+        rows.push_back({
+            std::format("{}", threads),
+            std::format("{:.3f} ms", result.recordingTime),
+            std::format("{:.3f} ms", result.maxRecordingTime),
+            Benchmark::throughput(LIGHTS * FACES * DRAWS_PER_FACE, result.recordingTime),
+            std::format("{:.2f}x", singleThreadTime / result.recordingTime),
+        });
+    }
+    Benchmark::print(
+        std::format("Recording of the shadow maps of {} omni lights, {} commands per face",
+            LIGHTS, DRAWS_PER_FACE),
+        { "Threads", "Recording", "Slowest frame", "Commands", "Speedup" },
+        rows);
+    return 0;
+}
@@ -0,0 +1,141 @@
+/*
+ * Copyright (c) 2025-present Henri Michelon
+ *
+ * This software is released under the MIT License.
+ * https://opensource.org/licenses/MIT
+*/
+import lysa;
+import lysa.benchmark;
+
+using namespace lysa;
+
+// Time from the creation of the context to the end of the first frame without pipeline cache,
+// then with an empty cache directory (cold start) and with the cache file saved by the cold
+// start (warm start). Each start creates a new context, window and scene.
+// The drivers keep their own on-disk caches, disable them to measure the pipeline cache of the
+// engine alone (MESA_SHADER_CACHE_DISABLE=true with Mesa, __GL_SHADER_DISK_CACHE=0 with NVIDIA).
+// Needs a Vulkan device and a video driver, a software driver like lavapipe and the SDL
+// offscreen driver (SDL_VIDEODRIVER=offscreen) are enough. Skipped when there is none.
+namespace {
+
+    constexpr auto WIDTH{640u};
+    constexpr auto HEIGHT{360u};
+
+    // Unit cube of a color centered on the origin, four vertices per face for the normals
+    Mesh& createCube(const float4& color) {
+        auto& material = ctx().res.get<MaterialManager>().create();
+        material.setAlbedoColor(color);
+        auto vertices = std::vector<Vertex>{};
+        auto indices = std::vector<uint32>{};
+        const auto normals = std::array{
+            AXIS_X, -AXIS_X, AXIS_Y, -AXIS_Y, AXIS_Z, -AXIS_Z,
+        };
+        for (const auto& normal : normals) {
+            // Two axis perpendicular to the normal, counterclockwise seen from the outside
+            const float3 u = std::fabs(static_cast<float>(normal.y)) > 0.5f ? AXIS_X : AXIS_Y;
+            const float3 v = cross(normal, u);
+            const auto first = static_cast<uint32>(vertices.size());
+            for (const auto& [s, t] : { std::pair{-0.5f, -0.5f}, std::pair{0.5f, -0.5f}, std::pair{0.5f, 0.5f}, std::pair{-0.5f, 0.5f} }) {
+                vertices.push_back({
+                    .position = normal * 0.5f + u * s + v * t,
+                    .normal = normal,
+                    .uv = float2{s + 0.5f, t + 0.5f},
+                    .tangent = float4{u, 1.0f},
+                });
+            }
+            indices.insert(indices.end(), { first, first + 1, first + 2, first, first + 2, first + 3 });
+        }
+        auto& mesh = ctx().res.get<MeshManager>().create(
+            vertices,
+            indices,
+            { MeshSurface{0, static_cast<uint32>(indices.size())} },
+            "cube");
+        mesh.setSurfaceMaterial(0, material.id);
+        return mesh;
+    }
+
+    // Starts the engine, renders one frame and returns the startup report
+    StartupReport start(const std::filesystem::path& cacheDirectory) {
+        auto config = ContextConfiguration{};
+        config.virtualFsConfiguration.appDirectory = LYSA_APP_DIRECTORY;
+        config.cacheDirectory = cacheDirectory;
+        auto lysa = Lysa{config};
+
+        // Declared before the scene, which keeps pointers to them
+        const auto light = Light{
+            LightType::LIGHT_OMNI, float3{1.0f}, 4.0f,
+            float4x4::translation(float3{0.0f, 1.5f, 0.0f}),
+            20.0f, 1.3f, 1.4f, true, 1024 };
+        auto instances = std::vector<std::unique_ptr<MeshInstance>>{};
+        auto scene = Scene{};
+        for (auto i = 0; i < 8; i++) {
+            const auto angle = radians(45.0f * static_cast<float>(i));
+            const auto& mesh = createCube(float4{0.1f * static_cast<float>(i), 0.5f, 0.8f, 1.0f});
+            auto instance = std::make_unique<MeshInstance>(mesh);
+            const auto transform = float4x4::translation(float3{3.0f * std::cos(angle), 0.5f, 3.0f * std::sin(angle)});
+            instance->setTransform(transform);
+            instance->setAABB(mesh.getAABB().toGlobal(transform));
+            instance->setCastShadows(true);
+            scene.addInstance(*instance);
+            instances.push_back(std::move(instance));
+        }
+        scene.addLight(light);
+        const auto camera = Camera{
+            inverse(look_at(float3{0.0f, 6.0f, 8.0f}, float3{0.0f}, AXIS_UP)),
+            perspective(radians(60.0f), static_cast<float>(WIDTH) / HEIGHT, 0.1f, 100.0f),
+            0.1f, 100.0f };
+
+        auto windowConfig = RenderingWindowConfiguration{
+            .title = "Startup",
+            .width = WIDTH,
+            .height = HEIGHT,
+        };
+        // All the pipelines compiled before the end of the first frame
+        windowConfig.renderTargetConfiguration.rendererConfiguration.pipelineCompilationThreads = 0;
+        auto window = RenderingWindow{windowConfig};
+        auto& target = window.getRenderTarget();
+        auto view = RenderView{camera, scene};
+        target.addView(view);
+        const auto handler = ctx().events.subscribe(MainLoopEvent::PROCESS, [&](Event&) {
+            target.render();
+            ctx().exit = true;
+        });
+        lysa.run();
+        ctx().events.unsubscribe(handler);
+        target.removeView(view);
+        return ctx().shaders.getStartupReport();
+    }
+
+}
+
+int main() {
+    const auto cacheDirectory = std::filesystem::temp_directory_path() / "lysa_startup_benchmark";
+    auto error = std::error_code{};
+    std::filesystem::remove_all(cacheDirectory, error);
+
+    auto rows = std::vector<std::vector<std::string>>{};
+    try {
+        for (const auto& [name, directory] : {
+                std::pair{"no cache", std::filesystem::path{}},
+                std::pair{"cold", cacheDirectory},
+                std::pair{"warm", cacheDirectory} }) {
+            const auto report = start(directory);
+            rows.push_back({
+                name,
+                std::format("{}", report.pipelineCacheSize),
+                std::format("{:.2f} ms", report.shadersLoadTime),
+                std::format("{:.2f} ms", report.startupTime),
+            });
+        }
+    } catch (const std::exception& e) {
+        std::println(std::cerr, "No Vulkan device or video driver : {}", e.what());
+        return Benchmark::SKIPPED;
+    }
+    std::filesystem::remove_all(cacheDirectory, error);
+
+    Benchmark::print(
+        "Startup time to the end of the first frame without and with the pipeline cache",
+        { "Start", "Pipeline cache loaded (bytes)", "Shaders load", "Startup time" },
+        rows);
+    return 0;
+}
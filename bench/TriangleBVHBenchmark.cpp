@@ -0,0 +1,153 @@
+/*
+ * Copyright (c) 2025-present Henri Michelon
+ *
+ * This software is released under the MIT License.
+ * https://opensource.org/licenses/MIT
+*/
+import std;
+import lysa.benchmark;
+import lysa.bvh;
+import lysa.math;
+import lysa.triangle_bvh;
+
+using namespace lysa;
+
+// Construction of the triangles BVH and closest hit ray casts, compared to the test of all the
+// triangles of the mesh. The meshes are height fields of 10k, 100k and 1M triangles in two surfaces.
+namespace {
+
+    constexpr auto RAYS{16384};
+    // The brute force ray casts of the largest meshes are slow, fewer are timed
+    constexpr auto BRUTE_FORCE_RAYS{64};
+
+    struct Mesh {
+        std::vector<float3> positions;
+        std::vector<uint32> indices;
+        std::vector<std::pair<uint32, uint32>> surfaces;
+    };
+
+    // Grid of size x size quads in [-1, 1] on X and Z with waves on Y
+    Mesh createMesh(const uint32 size) {
+        auto mesh = Mesh{};
+        const auto step = 2.0f / static_cast<float>(size);
+        for (auto z = 0u; z <= size; z++) {
+            for (auto x = 0u; x <= size; x++) {
+                const auto px = -1.0f + static_cast<float>(x) * step;
+                const auto pz = -1.0f + static_cast<float>(z) * step;
+                mesh.positions.push_back(float3{px, 0.1f * std::sin(px * 10.0f) * std::cos(pz * 10.0f), pz});
+            }
+        }
+        for (auto z = 0u; z < size; z++) {
+            for (auto x = 0u; x < size; x++) {
+                const auto i = z * (size + 1) + x;
+                mesh.indices.insert(mesh.indices.end(), { i, i + size + 1, i + 1, i + 1, i + size + 1, i + size + 2 });
+            }
+        }
+        const auto half = static_cast<uint32>(mesh.indices.size() / 6 * 3);
+        mesh.surfaces = { { 0, half }, { half, static_cast<uint32>(mesh.indices.size()) - half } };
+        return mesh;
+    }
+
+    // Rays from a sphere around the mesh to random points of the mesh bounds
+    std::vector<Ray> createRays(std::mt19937& random) {
+        auto angle = std::uniform_real_distribution{0.0f, 2.0f * std::numbers::pi_v<float>};
+        auto height = std::uniform_real_distribution{0.2f, 1.0f};
+        auto target = std::uniform_real_distribution{-1.0f, 1.0f};
+        auto rays = std::vector<Ray>(RAYS);
+        for (auto& ray : rays) {
+            const auto a = angle(random);
+            const auto origin = float3{3.0f * std::cos(a), 3.0f * height(random), 3.0f * std::sin(a)};
+            const auto to = float3{target(random), 0.0f, target(random)};
+            ray = Ray{origin, to - origin};
+        }
+        return rays;
+    }
+
+    // Möller–Trumbore, one triangle at a time
+    std::optional<float> intersect(const Ray& ray, const float3& v0, const float3& v1, const float3& v2) {
+        const float3 edge1 = v1 - v0;
+        const float3 edge2 = v2 - v0;
+        const float3 p = cross(ray.direction, edge2);
+        const float determinant = dot(edge1, p);
+        if (std::fabs(determinant) < 1e-8f) { return std::nullopt; }
+        const auto invDeterminant = 1.0f / determinant;
+        const float3 t = ray.origin - v0;
+        const float u = dot(t, p) * invDeterminant;
+        if (u < 0.0f || u > 1.0f) { return std::nullopt; }
+        const float3 q = cross(t, edge1);
+        const float v = dot(ray.direction, q) * invDeterminant;
+        if (v < 0.0f || u + v > 1.0f) { return std::nullopt; }
+        const float distance = dot(edge2, q) * invDeterminant;
+        if (distance < 0.0f) { return std::nullopt; }
+        return distance;
+    }
+
+    std::optional<float> raycast(const Mesh& mesh, const Ray& ray) {
+        auto closest = std::optional<float>{};
+        for (auto i = 0; i < mesh.indices.size(); i += 3) {
+            const auto distance = intersect(
+                ray,
+                mesh.positions[mesh.indices[i]],
+                mesh.positions[mesh.indices[i + 1]],
+                mesh.positions[mesh.indices[i + 2]]);
+            if (distance && (!closest || *distance < *closest)) {
+                closest = distance;
+            }
+        }
+        return closest;
+    }
+
+}
+
+int main() {
+    auto random = std::mt19937{42};
+    const auto rays = createRays(random);
+    auto rows = std::vector<std::vector<std::string>>{};
+    for (const auto [label, size] : { std::pair{"10k", 71u}, std::pair{"100k", 224u}, std::pair{"1M", 707u} }) {
+        const auto mesh = createMesh(size);
+
+        auto tree = std::unique_ptr<TriangleBVH>{};
+        const auto buildTime = Benchmark::measure([&] {
+            tree = std::make_unique<TriangleBVH>(mesh.positions, mesh.indices, mesh.surfaces);
+        }, 3);
+
+        auto hits = 0u;
+        const auto rayTime = Benchmark::measure([&] {
+            hits = 0;
+            for (const auto& ray : rays) {
+                hits += tree->raycast(ray) ? 1 : 0;
+            }
+        });
+
+        // Same closest hits as the test of all the triangles
+        auto mismatches = 0u;
+        const auto bruteForceTime = Benchmark::measure([&] {
+            mismatches = 0;
+            for (auto i = 0; i < BRUTE_FORCE_RAYS; i++) {
+                const auto expected = raycast(mesh, rays[i]);
+                const auto hit = tree->raycast(rays[i]);
+                if (expected.has_value() != hit.has_value() ||
+                    (expected && std::fabs(*expected - hit->distance) > 1e-4f * *expected)) {
+                    mismatches += 1;
+                }
+            }
+        }, 1);
+
+        rows.push_back({
+            label,
+            std::format("{}", tree->getNodesCount()),
+            std::format("{:.1f} ms", buildTime),
+            std::format("{:.0f}%", 100.0 * hits / RAYS),
+            std::format("{:.2f} us", rayTime * 1000.0 / RAYS),
+            Benchmark::throughput(RAYS, rayTime),
+            std::format("{:.1f} us", bruteForceTime * 1000.0 / BRUTE_FORCE_RAYS),
+            std::format("{:.0f}x", (bruteForceTime / BRUTE_FORCE_RAYS) / (rayTime / RAYS)),
+            std::format("{}", mismatches),
+        });
+    }
+    Benchmark::print(
+        "Triangles BVH construction and closest hit ray casts compared to the test of all the triangles",
+        { "Triangles", "Nodes", "Build", "Hits", "Ray cast", "Throughput", "All triangles", "Speedup", "Mismatches" },
+        rows);
+    return 0;
+}
@@ -38,4 +38,21 @@ namespace lysa {
         return { newVmin, newVmax };
     }
 
+    AABB AABB::merge(const AABB& other) const {
+        return { lysa::min(min, other.min), lysa::max(max, other.max) };
+    }
+
+    bool AABB::contains(const AABB& other) const {
+        return all(min <= other.min) && all(other.max <= max);
+    }
+
+    bool AABB::intersects(const AABB& other) const {
+        return all(min <= other.max) && all(other.min <= max);
+    }
+
+    float AABB::getSurfaceArea() const {
+        const float3 d = max - min;
+        return 2.0f * (d.x * d.y + d.y * d.z + d.z * d.x);
+    }
+
 }
\ No newline at end of file
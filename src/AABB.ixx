@@ -66,5 +66,34 @@ export namespace lysa {
          * @return The transformed, axis-aligned bounding box.
          */
         AABB toGlobal(const float4x4& transform) const;
+
+        /**
+         * Returns the smallest box enclosing both this box and another one.
+         * @param other Box to merge with.
+         */
+        AABB merge(const AABB& other) const;
+
+        /**
+         * Returns true if the other box is fully inside this box (boundaries included).
+         * @param other Box to test.
+         */
+        bool contains(const AABB& other) const;
+
+        /**
+         * Returns true if the two boxes overlap (touching boxes are considered overlapping).
+         * @param other Box to test.
+         */
+        bool intersects(const AABB& other) const;
+
+        /**
+         * Returns the center of the box.
+         */
+        float3 getCenter() const { return (min + max) * 0.5f; }
+
+        /**
+         * Returns the total area of the six faces of the box, used as the cost metric
+         * by the surface area heuristic (SAH) of the bounding volume hierarchies.
+         */
+        float getSurfaceArea() const;
     };
 }
\ No newline at end of file
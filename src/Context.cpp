@@ -65,11 +65,18 @@ namespace  lysa {
         config(config),
         vireo(vireo::Vireo::create(config.backend, vireoDebugCallback)),
         fs(config.virtualFsConfiguration, vireo),
+        shaders(vireo, fs, config.backend == vireo::Backend::VULKAN ? config.cacheDirectory : std::filesystem::path{}),
         events(config.eventsReserveCapacity),
         defer(config.commandsReserveCapacity),
         samplers(vireo, config.resourcesCapacity.samplers),
         graphicQueue(vireo->createSubmitQueue(vireo::CommandType::GRAPHIC, "Main graphic queue")),
         transferQueue(vireo->createSubmitQueue(vireo::CommandType::TRANSFER, "Main transfer queue")),
+        // The light clusters stay in a compute state while read by the fragment shaders, allowed by Vulkan only
+        computeQueue(config.asyncComputeEnabled &&
+            config.backend == vireo::Backend::VULKAN &&
+            vireo->getDevice()->haveDedicatedComputeQueue() ?
+            vireo->createSubmitQueue(vireo::CommandType::COMPUTE, "Async compute queue") :
+            nullptr),
         asyncQueue(vireo, transferQueue, graphicQueue) {
     }
 
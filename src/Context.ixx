@@ -13,6 +13,7 @@ import lysa.async_pool;
 import lysa.command_buffer;
 import lysa.event;
 import lysa.log;
+import lysa.shader_cache;
 import lysa.virtual_fs;
 import lysa.types;
 import lysa.resources.samplers;
@@ -50,12 +51,20 @@ export namespace  lysa {
         uint32 framesInFlight{2};
         //! Maximum number of shadow maps per scene
         uint32 maxShadowMapsPerScene{20};
+        //! Size of the shadow atlas of each scene holding all its shadow maps, the shadow maps memory budget
+        uint32 shadowAtlasSize{4096};
+        //! Size of the smallest shadow maps in the shadow atlas
+        uint32 shadowAtlasMinTileSize{128};
         //! Enable shadowed colors for transparency objects
         // bool shadowTransparencyColorEnabled{true};
         //! Resource capacity configuration
         ResourcesCapacity resourcesCapacity;
         size_t eventsReserveCapacity{100};
         size_t commandsReserveCapacity{1000};
+        //! Submit the compute work independent of the shadow maps to a dedicated compute queue, if any
+        bool asyncComputeEnabled{true};
+        //! Directory of the persistent pipeline cache of the Vulkan backend, disabled if empty
+        std::filesystem::path cacheDirectory{};
         //! Display FPS in log
         bool displayFPS{false};
         //! Virtual file system configuration
@@ -93,6 +102,11 @@ export namespace  lysa {
          */
         const VirtualFS fs;
 
+        /**
+         * Shader modules shared by all the renderers, with the persistent pipeline cache
+         */
+        ShaderCache shaders;
+
         /**
          * Central event dispatcher for the application.
          */
@@ -128,6 +142,12 @@ export namespace  lysa {
          */
         const std::shared_ptr<vireo::SubmitQueue> transferQueue;
 
+        /**
+         * Submit queue used for asynchronous compute work, nullptr without a dedicated compute
+         * queue or with ContextConfiguration::asyncComputeEnabled set to false.
+         */
+        const std::shared_ptr<vireo::SubmitQueue> computeQueue;
+
         /**
          * Asynchronous submissions of submit queues
          */
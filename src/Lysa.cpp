@@ -47,9 +47,16 @@ namespace lysa {
 
     Lysa::~Lysa() {
         ctx().graphicQueue->waitIdle();
+        if (ctx().computeQueue) {
+            ctx().computeQueue->waitIdle();
+        }
         SceneFrameData::destroyDescriptorLayouts();
-        Renderpass::destroyShaderModules();
+        ctx().shaders.clear();
         FrustumCulling::cleanup();
+        DrawBatching::cleanup();
+        LightClustering::cleanup();
+        OcclusionCulling::cleanup();
+        DepthPyramidBuilder::cleanup();
     }
 
     void Lysa::uploadData() {
@@ -62,6 +69,7 @@ namespace lysa {
     }
 
     void Lysa::run() {
+        auto firstFrame = true;
         while (!ctx().exit) {
             uploadData();
             ctx().defer._process();
@@ -99,6 +107,10 @@ namespace lysa {
             }
             auto event = Event{MainLoopEvent::PROCESS,accumulator / fixedDeltaTime };
             ctx().events.fire(event);
+            if (firstFrame) {
+                ctx().shaders.endStartup();
+                firstFrame = false;
+            }
         }
         ctx().defer._process();
         auto event = Event{ MainLoopEvent::QUIT };
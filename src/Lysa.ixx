@@ -12,11 +12,22 @@ export import vireo;
 export import lysa.aabb;
 export import lysa.assets_pack;
 export import lysa.async_queue;
+export import lysa.async_updates_budget;
+export import lysa.buffer_capacity;
 export import lysa.blur_data;
+export import lysa.bvh;
 export import lysa.context;
+export import lysa.culling_view;
+export import lysa.depth_pyramid;
 export import lysa.directory_watcher;
+export import lysa.draw_batches;
 export import lysa.event;
 export import lysa.exception;
+export import lysa.frustum;
+export import lysa.light_clusters;
+export import lysa.occlusion_rasterizer;
+export import lysa.render_graph;
+export import lysa.shadow_atlas_allocator;
 export import lysa.utils;
 #ifndef LYSA_CONSOLE
 export import lysa.input;
@@ -24,12 +35,16 @@ export import lysa.input_event;
 #endif
 export import lysa.log;
 export import lysa.math;
+export import lysa.pipeline_cache;
 export import lysa.rect;
+export import lysa.shader_cache;
+export import lysa.triangle_bvh;
 export import lysa.types;
 export import lysa.virtual_fs;
 
 #ifdef DEFERRED_RENDERER
 export import lysa.renderers.deferred_renderer;
+export import lysa.renderers.renderpasses.downsampled_ssao_pass;
 export import lysa.renderers.renderpasses.gbuffer_pass;
 export import lysa.renderers.renderpasses.lighting_pass;
 export import lysa.renderers.renderpasses.ssao_pass;
@@ -39,16 +54,28 @@ export import lysa.renderers.forward_renderer;
 export import lysa.renderers.renderpasses.forward_color_pass;
 #endif
 export import lysa.renderers.configuration;
+export import lysa.renderers.dynamic_resolution;
 export import lysa.renderers.global_descriptor_set;
+export import lysa.renderers.gpu_telemetry;
 export import lysa.renderers.graphic_pipeline_data;
+export import lysa.renderers.pipeline_compiler;
+export import lysa.renderers.pipeline_manifest;
+export import lysa.renderers.recording_scheduler;
 export import lysa.renderers.renderer;
 export import lysa.renderers.scene_frame_data;
+export import lysa.renderers.scene_shared_data;
 export import lysa.renderers.vector_2d;
 export import lysa.renderers.vector_3d;
+export import lysa.renderers.pipelines.depth_pyramid_builder;
+export import lysa.renderers.pipelines.draw_batching;
 export import lysa.renderers.pipelines.frustum_culling;
+export import lysa.renderers.pipelines.light_clustering;
+export import lysa.renderers.pipelines.occlusion_culling;
+export import lysa.renderers.renderpasses.bloom_mip_chain_pass;
 export import lysa.renderers.renderpasses.bloom_pass;
 export import lysa.renderers.renderpasses.depth_prepass;
 export import lysa.renderers.renderpasses.display_attachment;
+export import lysa.renderers.renderpasses.fused_post_processing;
 export import lysa.renderers.renderpasses.fxaa_pass;
 export import lysa.renderers.renderpasses.gamma_correction_pass;
 export import lysa.renderers.renderpasses.post_processing;
@@ -57,6 +84,7 @@ export import lysa.renderers.renderpasses.shader_material_pass;
 export import lysa.renderers.renderpasses.shadow_map_pass;
 export import lysa.renderers.renderpasses.smaa_pass;
 export import lysa.renderers.renderpasses.transparency_pass;
+export import lysa.renderers.renderpasses.upscaling_pass;
 
 export import lysa.resources.animation;
 export import lysa.resources.animation_library;
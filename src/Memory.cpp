@@ -68,15 +68,23 @@ namespace lysa {
         const size_t instanceCount,
         const size_t stagingInstanceCount,
         const vireo::BufferType bufferType,
-        const std::string& name) :
-        MemoryArray{vireo, instanceSize, instanceCount, bufferType, name},
-        stagingBuffer{vireo->createBuffer(vireo::BufferType::BUFFER_UPLOAD, instanceSize * stagingInstanceCount, 1, "Staging " + name)} {
+        const std::string& name,
+        const uint32 stagingBuffersCount) :
+        MemoryArray{vireo, instanceSize, instanceCount, bufferType, name} {
         assert([&]{ return bufferType == vireo::BufferType::VERTEX ||
             bufferType == vireo::BufferType::INDEX ||
             bufferType == vireo::BufferType::INDIRECT ||
             bufferType == vireo::BufferType::DEVICE_STORAGE ||
             bufferType == vireo::BufferType::READWRITE_STORAGE;}, "Invalid buffer type for device memory array");
-        stagingBuffer->map();
+        for (auto i = 0; i < std::max(stagingBuffersCount, 1u); i++) {
+            stagingBuffers.push_back(vireo->createBuffer(
+                vireo::BufferType::BUFFER_UPLOAD,
+                instanceSize * stagingInstanceCount,
+                1,
+                "Staging " + name + (stagingBuffersCount > 1 ? ":" + std::to_string(i) : "")));
+            stagingBuffers.back()->map();
+        }
+        stagingBuffer = stagingBuffers.front();
     }
 
     void DeviceMemoryArray::write(const MemoryBlock& destination, const void* source) {
@@ -97,9 +105,19 @@ namespace lysa {
             commandList.copy(stagingBuffer, buffer, pendingWrites);
             pendingWrites.clear();
             stagingBufferCurrentOffset = 0;
+            // The next writes go to the staging buffer used by the oldest flush
+            currentStagingBuffer = (currentStagingBuffer + 1) % stagingBuffers.size();
+            stagingBuffer = stagingBuffers[currentStagingBuffer];
         }
     }
 
+    void DeviceMemoryArray::preBarrier(const vireo::CommandList& commandList) const {
+        commandList.barrier(
+           *buffer,
+           vireo::ResourceState::SHADER_READ,
+           vireo::ResourceState::COPY_DST);
+    }
+
     void DeviceMemoryArray::postBarrier(const vireo::CommandList& commandList) const {
         commandList.barrier(
            *buffer,
@@ -109,6 +127,72 @@ namespace lysa {
 
     DeviceMemoryArray::~DeviceMemoryArray() {
         stagingBuffer.reset();
+        stagingBuffers.clear();
+    }
+
+    BufferPool::BufferPool(
+        const std::shared_ptr<vireo::Vireo>& vireo,
+        const uint32 framesInFlight,
+        const size_t freeBudget) :
+        vireo{vireo},
+        freeBudget{freeBudget},
+        releasedBuffers(std::max(framesInFlight, 1u)) {
+    }
+
+    std::shared_ptr<vireo::Buffer> BufferPool::acquire(
+        const vireo::BufferType bufferType,
+        const size_t size,
+        const std::string& name) {
+        assert([&]{ return size > 0; }, "Buffer size must be > 0");
+        auto lock = std::lock_guard{mutex};
+        const auto rounded = std::bit_ceil(size);
+        for (auto it = freeBuffers.find(rounded); it != freeBuffers.end() && it->first == rounded; ++it) {
+            if (it->second.bufferType == bufferType) {
+                auto buffer = std::move(it->second.buffer);
+                freeBuffers.erase(it);
+                freeSize -= rounded;
+                acquiredBuffers[buffer.get()] = {bufferType, rounded};
+                return buffer;
+            }
+        }
+        auto buffer = vireo->createBuffer(bufferType, rounded, 1, name);
+        allocatedSize += rounded;
+        acquiredBuffers[buffer.get()] = {bufferType, rounded};
+        return buffer;
+    }
+
+    void BufferPool::release(const uint32 frameIndex, std::shared_ptr<vireo::Buffer>& buffer) {
+        if (!buffer) { return; }
+        auto lock = std::lock_guard{mutex};
+        assert([&]{ return acquiredBuffers.contains(buffer.get()); }, "Buffer not acquired from the pool");
+        auto entry = acquiredBuffers.extract(buffer.get()).mapped();
+        entry.buffer = std::move(buffer);
+        releasedBuffers[frameIndex % releasedBuffers.size()].push_back(std::move(entry));
+        buffer.reset();
+    }
+
+    void BufferPool::recycle(const uint32 frameIndex) {
+        auto lock = std::lock_guard{mutex};
+        // With one frame in flight the previous frame has completed, the buffers released
+        // during the current frame are not used anymore
+        if (lastRecycledFrame == frameIndex && releasedBuffers.size() > 1) { return; }
+        lastRecycledFrame = frameIndex;
+        for (auto& entry : releasedBuffers[frameIndex % releasedBuffers.size()]) {
+            freeSize += entry.size;
+            freeBuffers.emplace(entry.size, std::move(entry));
+        }
+        releasedBuffers[frameIndex % releasedBuffers.size()].clear();
+        while (freeSize > freeBudget) {
+            const auto largest = std::prev(freeBuffers.end());
+            freeSize -= largest->first;
+            allocatedSize -= largest->first;
+            freeBuffers.erase(largest);
+        }
+    }
+
+    BufferPool::~BufferPool() {
+        freeBuffers.clear();
+        releasedBuffers.clear();
     }
 
     HostVisibleMemoryArray::HostVisibleMemoryArray(
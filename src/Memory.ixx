@@ -93,6 +93,9 @@ export namespace lysa {
          * @param instanceCount Maximum number of resources stored in the array
          * @param stagingInstanceCount Maximum number of temporary resources used for staging temporary data before transfer
          * @param name Name of the GPU buffer for GPU-side debug
+         * @param stagingBuffersCount Number of staging buffers used in turn by flush(). An array shared by the
+         * frames in flight and flushed at most once per frame needs one staging buffer per frame in flight
+         * so the CPU never writes in a staging buffer still read by a previous frame.
          */
         DeviceMemoryArray(
             const std::shared_ptr<vireo::Vireo>& vireo,
@@ -100,7 +103,8 @@ export namespace lysa {
             size_t instanceCount,
             size_t stagingInstanceCount,
             vireo::BufferType,
-            const std::string& name);
+            const std::string& name,
+            uint32 stagingBuffersCount = 1);
 
         void write(const MemoryBlock& destination, const void* source) override;
 
@@ -109,6 +113,17 @@ export namespace lysa {
          */
         void flush(const vireo::CommandList& commandList);
 
+        /**
+         * Returns true if writes are waiting for the next flush()
+         */
+        bool isPending() const { return !pendingWrites.empty(); }
+
+        /**
+         * Put the GPU buffer in COPY_DST state from the SHADER_READ state of postBarrier(),
+         * before a flush() of an array already read by the shaders of previous frames
+         */
+        void preBarrier(const vireo::CommandList& commandList) const;
+
         /**
          * Put the GPU buffer in SHADER_READ state
          */
@@ -117,11 +132,84 @@ export namespace lysa {
         ~DeviceMemoryArray() override;
 
     private:
+        std::vector<std::shared_ptr<vireo::Buffer>> stagingBuffers;
         std::shared_ptr<vireo::Buffer> stagingBuffer;
+        uint32 currentStagingBuffer{0};
         size_t stagingBufferCurrentOffset{0};
         std::vector<vireo::BufferCopyRegion> pendingWrites;
     };
 
+    /**
+     * Pool of GPU buffers shared by the resizable buffers of a scene
+     *
+     * The sizes are rounded to powers of two, so a buffer released by a shrinking array can be
+     * acquired by a growing one. A released buffer can still be read by the frames in flight :
+     * it returns to the pool only at the next recycle() of the frame in flight that released it,
+     * once this frame and all the frames submitted before have completed. The unused buffers
+     * above the free budget are destroyed, the largest first.
+     */
+    class BufferPool {
+    public:
+        /**
+         * Creates an empty pool
+         * @param vireo Vireo instance
+         * @param framesInFlight Number of frames in flight
+         * @param freeBudget Maximum size in bytes of the unused buffers kept for reuse
+         */
+        BufferPool(
+            const std::shared_ptr<vireo::Vireo>& vireo,
+            uint32 framesInFlight,
+            size_t freeBudget);
+
+        /**
+         * Returns an unused buffer of at least the requested size, creates one if needed
+         * @param bufferType Type of the buffer, only the buffers of the same type are reused
+         * @param size Minimum size in bytes, rounded to the next power of two
+         * @param name Name of a new GPU buffer for GPU-side debug
+         */
+        std::shared_ptr<vireo::Buffer> acquire(vireo::BufferType bufferType, size_t size, const std::string& name);
+
+        /**
+         * Gives back a buffer acquired from the pool and resets the pointer
+         * @param frameIndex Index of the frame in flight recording the last use of the buffer
+         * @param buffer Buffer to release, ignored if null
+         */
+        void release(uint32 frameIndex, std::shared_ptr<vireo::Buffer>& buffer);
+
+        /**
+         * Makes reusable the buffers released by the previous frame using the same index,
+         * called at the start of each frame. The next calls in the same frame do nothing.
+         * @param frameIndex Index of the frame in flight
+         */
+        void recycle(uint32 frameIndex);
+
+        /** Returns the size in bytes of all the buffers created by the pool and not destroyed */
+        auto getAllocatedSize() const { return allocatedSize; }
+
+        /** Returns the size in bytes of the buffers waiting in the pool for reuse */
+        auto getFreeSize() const { return freeSize; }
+
+        ~BufferPool();
+        BufferPool(BufferPool&) = delete;
+        BufferPool& operator=(BufferPool&) = delete;
+
+    private:
+        struct Entry {
+            vireo::BufferType bufferType;
+            size_t size;
+            std::shared_ptr<vireo::Buffer> buffer;
+        };
+        const std::shared_ptr<vireo::Vireo> vireo;
+        const size_t freeBudget;
+        std::vector<std::vector<Entry>> releasedBuffers;
+        std::multimap<size_t, Entry> freeBuffers;
+        std::unordered_map<const vireo::Buffer*, Entry> acquiredBuffers;
+        std::optional<uint32> lastRecycledFrame;
+        size_t allocatedSize{0};
+        size_t freeSize{0};
+        std::mutex mutex;
+    };
+
     /**
      * Host-accessible GPU memory array
      */
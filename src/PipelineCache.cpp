@@ -0,0 +1,104 @@
+/*
+* Copyright (c) 2025-present Henri Michelon
+*
+* This software is released under the MIT License.
+* https://opensource.org/licenses/MIT
+*/
+module lysa.pipeline_cache;
+
+namespace lysa {
+
+    PipelineCache::PipelineCache(const std::filesystem::path& filePath, const Device& device) :
+        filePath{filePath},
+        device{device} {
+        if (!filePath.empty()) {
+            load();
+        }
+    }
+
+    void PipelineCache::setColdTimes(const double shadersLoadTime, const double startupTime) {
+        header.coldShadersLoadTime = shadersLoadTime;
+        header.coldStartupTime = startupTime;
+    }
+
+    bool PipelineCache::isValid(const std::vector<char>& blob, const Device& device) {
+        auto vulkanHeader = VulkanHeader{};
+        if (blob.size() < sizeof(vulkanHeader)) { return false; }
+        std::memcpy(&vulkanHeader, blob.data(), sizeof(vulkanHeader));
+        return vulkanHeader.headerSize >= sizeof(vulkanHeader) &&
+               vulkanHeader.headerSize <= blob.size() &&
+               vulkanHeader.headerVersion == VULKAN_HEADER_VERSION_ONE &&
+               vulkanHeader.vendorID == device.vendorID &&
+               vulkanHeader.deviceID == device.deviceID &&
+               std::ranges::equal(vulkanHeader.pipelineCacheUUID, device.pipelineCacheUUID);
+    }
+
+    uint64 PipelineCache::hash(const std::vector<char>& blob) {
+        auto value = uint64{14695981039346656037ull};
+        for (const auto c : blob) {
+            value ^= static_cast<uint8>(c);
+            value *= 1099511628211ull;
+        }
+        return value;
+    }
+
+    void PipelineCache::load() {
+        auto error = std::error_code{};
+        const auto fileSize = std::filesystem::file_size(filePath, error);
+        if (error) { return; }
+        auto file = std::ifstream(filePath, std::ios::binary);
+        if (!file.is_open()) { return; }
+        auto fileHeader = Header{};
+        file.read(reinterpret_cast<std::istream::char_type *>(&fileHeader), sizeof(fileHeader));
+        // The size is checked against the file before the allocation
+        if (!file ||
+            !std::ranges::equal(fileHeader.magic, MAGIC) ||
+            fileHeader.version != VERSION ||
+            fileHeader.dataSize != fileSize - sizeof(fileHeader)) {
+            status = Status::CORRUPTED;
+            return;
+        }
+        if (fileHeader.device != device) {
+            status = Status::OTHER_DEVICE;
+            return;
+        }
+        auto blob = std::vector<char>(fileHeader.dataSize);
+        file.read(blob.data(), static_cast<std::streamsize>(blob.size()));
+        if (!file || hash(blob) != fileHeader.hash) {
+            status = Status::CORRUPTED;
+            return;
+        }
+        // The driver checks the blob too, but a blob of another device must not reach it
+        if (!isValid(blob, device)) {
+            status = Status::OTHER_DEVICE;
+            return;
+        }
+        header.coldShadersLoadTime = fileHeader.coldShadersLoadTime;
+        header.coldStartupTime = fileHeader.coldStartupTime;
+        data = std::move(blob);
+        status = Status::LOADED;
+    }
+
+    bool PipelineCache::save(const std::vector<char>& blob) {
+        if (filePath.empty() || !isValid(blob, device)) { return false; }
+        auto fileHeader = header;
+        std::ranges::copy(MAGIC, fileHeader.magic);
+        fileHeader.version = VERSION;
+        fileHeader.device = device;
+        fileHeader.dataSize = blob.size();
+        fileHeader.hash = hash(blob);
+        auto tempPath = filePath;
+        tempPath += ".tmp";
+        {
+            auto file = std::ofstream(tempPath, std::ios::binary | std::ios::trunc);
+            file.write(reinterpret_cast<const std::ostream::char_type *>(&fileHeader), sizeof(fileHeader));
+            file.write(blob.data(), static_cast<std::streamsize>(blob.size()));
+            if (!file) { return false; }
+        }
+        // Replaced in one step, a crash during the write leaves the previous file
+        auto error = std::error_code{};
+        std::filesystem::rename(tempPath, filePath, error);
+        return !error;
+    }
+
+}
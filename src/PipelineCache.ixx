@@ -0,0 +1,140 @@
+/*
+* Copyright (c) 2025-present Henri Michelon
+*
+* This software is released under the MIT License.
+* https://opensource.org/licenses/MIT
+*/
+export module lysa.pipeline_cache;
+
+import std;
+import lysa.types;
+
+export namespace lysa {
+
+    /**
+     * File of the Vulkan pipeline cache of a device.
+     *
+     * The file stores the pipeline cache blob of the driver after a header identifying the
+     * device and the driver which created it. A blob is only given back to the same device,
+     * driver version and pipeline cache UUID : the file header and the Vulkan header of the
+     * blob (`VkPipelineCacheHeaderVersionOne`) are checked, and the size and hash of the blob.
+     * A rejected file is ignored, the pipelines are then created without initial data and the
+     * next save() replaces the file.
+     */
+    class PipelineCache {
+    public:
+        /** Size of the pipeline cache UUID of a device */
+        static constexpr uint32 UUID_SIZE{16};
+
+        /**
+         * Identity of the device and driver which created a pipeline cache blob
+         */
+        struct Device {
+            //! Vendor of the device
+            uint32 vendorID{0};
+            //! Device of the vendor
+            uint32 deviceID{0};
+            //! Version of the driver, the driver can't use a blob of another version
+            uint32 driverVersion{0};
+            //! Pipeline cache UUID of the device and driver
+            std::array<uint8, UUID_SIZE> pipelineCacheUUID{};
+
+            bool operator==(const Device&) const = default;
+        };
+
+        /**
+         * State of the file after the creation of the cache
+         */
+        enum class Status : uint8 {
+            //! No file, or caching disabled
+            MISSING      = 0,
+            //! The blob of the file was loaded
+            LOADED       = 1,
+            //! The file was truncated or corrupted
+            CORRUPTED    = 2,
+            //! The file was created by another device or driver
+            OTHER_DEVICE = 3,
+        };
+
+        /**
+         * Loads the pipeline cache file of a device
+         * @param filePath The cache file, empty to disable the file
+         * @param device The device and driver using the cache
+         */
+        PipelineCache(const std::filesystem::path& filePath, const Device& device);
+
+        /** Returns the state of the file when loaded */
+        Status getStatus() const { return status; }
+
+        /** Returns the pipeline cache blob of the file, empty if none or rejected */
+        const std::vector<char>& getData() const { return data; }
+
+        /** Shaders load time of the run which created the file, in milliseconds */
+        double getColdShadersLoadTime() const { return header.coldShadersLoadTime; }
+
+        /** Startup time of the run which created the file, in milliseconds */
+        double getColdStartupTime() const { return header.coldStartupTime; }
+
+        /** Sets the startup times stored in the file by the run which creates it */
+        void setColdTimes(double shadersLoadTime, double startupTime);
+
+        /**
+         * Replaces the file with a pipeline cache blob of the device
+         * @return false if the blob is not a valid blob of the device or on write error
+         */
+        bool save(const std::vector<char>& blob);
+
+        /**
+         * Returns true if a pipeline cache blob starts with a valid Vulkan header of a device
+         */
+        static bool isValid(const std::vector<char>& blob, const Device& device);
+
+    private:
+        static constexpr char MAGIC[4]{'L', 'P', 'P', 'C'};
+        static constexpr uint32 VERSION{1};
+        // VK_PIPELINE_CACHE_HEADER_VERSION_ONE
+        static constexpr uint32 VULKAN_HEADER_VERSION_ONE{1};
+
+        /*
+         * Cache file header, followed by the blob
+         */
+        struct Header {
+            //! Magic header thing
+            char   magic[4];
+            //! Format version
+            uint32 version{0};
+            //! Device and driver which created the blob
+            Device device;
+            //! Size in bytes of the blob
+            uint64 dataSize{0};
+            //! FNV-1a hash of the blob
+            uint64 hash{0};
+            //! Shaders load time of the run which created the file, in milliseconds
+            double coldShadersLoadTime{0.0};
+            //! Startup time of the run which created the file, in milliseconds
+            double coldStartupTime{0.0};
+        };
+
+        /*
+         * Header of a Vulkan pipeline cache blob, VkPipelineCacheHeaderVersionOne
+         */
+        struct VulkanHeader {
+            uint32 headerSize;
+            uint32 headerVersion;
+            uint32 vendorID;
+            uint32 deviceID;
+            uint8  pipelineCacheUUID[UUID_SIZE];
+        };
+
+        const std::filesystem::path filePath;
+        const Device device;
+        Header header{};
+        std::vector<char> data;
+        Status status{Status::MISSING};
+
+        static uint64 hash(const std::vector<char>& blob);
+
+        void load();
+    };
+
+}
@@ -0,0 +1,125 @@
+/*
+* Copyright (c) 2025-present Henri Michelon
+*
+* This software is released under the MIT License.
+* https://opensource.org/licenses/MIT
+*/
+module lysa.shader_cache;
+
+import lysa.log;
+
+namespace lysa {
+
+    ShaderCache::ShaderCache(
+        const std::shared_ptr<vireo::Vireo>& vireo,
+        const VirtualFS& fs,
+        const std::filesystem::path& directory) :
+        vireo{vireo},
+        fs{fs},
+        startTime{std::chrono::steady_clock::now()} {
+        if (directory.empty()) {
+            return;
+        }
+        auto error = std::error_code{};
+        std::filesystem::create_directories(directory, error);
+        const auto& device = vireo->getDevice();
+        pipelineCache = std::make_unique<PipelineCache>(
+            directory / "pipelines.cache",
+            PipelineCache::Device{
+                .vendorID = device->getVendorID(),
+                .deviceID = device->getDeviceID(),
+                .driverVersion = device->getDriverVersion(),
+                .pipelineCacheUUID = device->getPipelineCacheUUID(),
+            });
+        switch (pipelineCache->getStatus()) {
+        case PipelineCache::Status::LOADED:
+            // Given to the device before the creation of the first pipeline
+            device->setPipelineCacheData(pipelineCache->getData());
+            report.warm = true;
+            report.pipelineCacheSize = pipelineCache->getData().size();
+            report.coldShadersLoadTime = pipelineCache->getColdShadersLoadTime();
+            report.coldStartupTime = pipelineCache->getColdStartupTime();
+            break;
+        case PipelineCache::Status::CORRUPTED:
+            Log::warning("Pipeline cache ", directory.string(), " ignored : truncated or corrupted");
+            break;
+        case PipelineCache::Status::OTHER_DEVICE:
+            Log::warning("Pipeline cache ", directory.string(), " ignored : created by another device or driver");
+            break;
+        case PipelineCache::Status::MISSING:
+            break;
+        }
+    }
+
+    std::shared_ptr<vireo::ShaderModule> ShaderCache::get(const std::string& shaderName) {
+        auto lock = std::lock_guard(mutex);
+        if (modules.contains(shaderName)) {
+            return modules[shaderName];
+        }
+        const auto start = std::chrono::steady_clock::now();
+        auto code = std::vector<char>{};
+        fs.loadShader(shaderName, code);
+        auto& module = modulesByHash[hash(code)];
+        if (module == nullptr) {
+            module = vireo->createShaderModule(code, shaderName);
+            report.shadersCount += 1;
+        }
+        modules[shaderName] = module;
+        report.shadersLoadTime += std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+        return module;
+    }
+
+    void ShaderCache::invalidate(const std::string& shaderName) {
+        auto lock = std::lock_guard(mutex);
+        modules.erase(shaderName);
+    }
+
+    void ShaderCache::endStartup() {
+        auto lock = std::lock_guard(mutex);
+        if (startupEnded) { return; }
+        startupEnded = true;
+        report.startupTime = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - startTime).count();
+        if (!pipelineCache) { return; }
+        if (!report.warm) {
+            report.coldShadersLoadTime = report.shadersLoadTime;
+            report.coldStartupTime = report.startupTime;
+            pipelineCache->setColdTimes(report.coldShadersLoadTime, report.coldStartupTime);
+        }
+        savePipelineCache();
+        Log::info("Pipeline cache : ", report.warm ? "warm" : "cold", " start, ",
+            report.pipelineCacheSize, " bytes loaded, ",
+            report.shadersLoadTime, " ms to load the shaders (cold run ", report.coldShadersLoadTime, " ms), ",
+            report.startupTime, " ms to the first frame (cold run ", report.coldStartupTime, " ms)");
+    }
+
+    StartupReport ShaderCache::getStartupReport() const {
+        auto lock = std::lock_guard(mutex);
+        return report;
+    }
+
+    void ShaderCache::clear() {
+        auto lock = std::lock_guard(mutex);
+        // The pipelines compiled since the first frame, by the prewarming for example
+        if (pipelineCache) {
+            savePipelineCache();
+        }
+        modules.clear();
+        modulesByHash.clear();
+    }
+
+    void ShaderCache::savePipelineCache() {
+        if (!pipelineCache->save(vireo->getDevice()->getPipelineCacheData())) {
+            Log::warning("Pipeline cache : not saved");
+        }
+    }
+
+    uint64 ShaderCache::hash(const std::vector<char>& code) {
+        auto value = uint64{14695981039346656037ull};
+        for (const auto c : code) {
+            value ^= static_cast<uint8>(c);
+            value *= 1099511628211ull;
+        }
+        return value;
+    }
+
+}
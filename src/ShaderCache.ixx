@@ -0,0 +1,114 @@
+/*
+* Copyright (c) 2025-present Henri Michelon
+*
+* This software is released under the MIT License.
+* https://opensource.org/licenses/MIT
+*/
+export module lysa.shader_cache;
+
+import std;
+import vireo;
+import lysa.pipeline_cache;
+import lysa.types;
+import lysa.virtual_fs;
+
+export namespace lysa {
+
+    /**
+     * Startup times of the current run and of the run which created the pipeline cache,
+     * see ShaderCache::getStartupReport().
+     */
+    struct StartupReport {
+        /** The pipeline cache was loaded from the cache directory */
+        bool warm{false};
+        /** Number of shader modules created */
+        uint32 shadersCount{0};
+        /** Size in bytes of the pipeline cache given to the device at startup */
+        size_t pipelineCacheSize{0};
+        /** Time spent loading the compiled shaders and creating the shader modules, in milliseconds */
+        double shadersLoadTime{0.0};
+        /** Time from the creation of the context to the end of the first frame, in milliseconds */
+        double startupTime{0.0};
+        /** Time spent loading the shaders by the run which created the cache, in milliseconds */
+        double coldShadersLoadTime{0.0};
+        /** Startup time of the run which created the cache, in milliseconds, 0 if not measured */
+        double coldStartupTime{0.0};
+    };
+
+    /**
+     * Shader modules shared by all the renderers and pipelines, with the persistent pipeline
+     * cache of the device.
+     *
+     * The shader modules are created once per compiled shader content : two shader names with
+     * the same bytecode share the same module. When a cache directory is configured and the
+     * backend is Vulkan, the pipeline cache of the device is loaded from the directory before
+     * the creation of the first pipeline, and saved after the first frame and on clear(), see
+     * PipelineCache.
+     */
+    class ShaderCache {
+    public:
+        /**
+         * Creates the shader cache and gives the pipeline cache file to the device
+         * @param vireo The graphic backend
+         * @param fs The file system used to read the compiled shaders
+         * @param directory The cache directory, empty to disable the pipeline cache. The pipeline
+         * cache blobs are specific to the Vulkan drivers, only use it with the Vulkan backend.
+         */
+        ShaderCache(
+            const std::shared_ptr<vireo::Vireo>& vireo,
+            const VirtualFS& fs,
+            const std::filesystem::path& directory);
+
+        /**
+         * Returns the shader module of a compiled shader, loaded from the shaders directory on
+         * first use.
+         * @param shaderName Name of the shader, without the extension of the backend
+         */
+        std::shared_ptr<vireo::ShaderModule> get(const std::string& shaderName);
+
+        /**
+         * Reads the compiled file of a shader again on its next use, for example on a
+         * DirectoryWatcherEvent::FILE_CHANGE event of the shaders directory
+         * @param shaderName Name of the shader, without the extension of the backend
+         */
+        void invalidate(const std::string& shaderName);
+
+        /**
+         * Ends the measure of the startup time and saves the pipeline cache. The first call of
+         * a cold run stores its startup report in the cache file, the next calls are ignored.
+         */
+        void endStartup();
+
+        /**
+         * Returns the startup report of the current run, compared to the run which created the cache
+         */
+        StartupReport getStartupReport() const;
+
+        /**
+         * Saves the pipeline cache and releases the shader modules
+         */
+        void clear();
+
+        ShaderCache(ShaderCache&) = delete;
+        ShaderCache& operator=(ShaderCache&) = delete;
+
+    private:
+        const std::shared_ptr<vireo::Vireo> vireo;
+        const VirtualFS& fs;
+        const std::chrono::steady_clock::time_point startTime;
+        mutable std::mutex mutex;
+        /* Pipeline cache file of the device, if enabled */
+        std::unique_ptr<PipelineCache> pipelineCache;
+        /* Shader modules by shader name */
+        std::unordered_map<std::string, std::shared_ptr<vireo::ShaderModule>> modules;
+        /* Shader modules by bytecode hash */
+        std::unordered_map<uint64, std::shared_ptr<vireo::ShaderModule>> modulesByHash;
+        StartupReport report;
+        bool startupEnded{false};
+
+        static uint64 hash(const std::vector<char>& code);
+
+        void savePipelineCache();
+    };
+
+}
@@ -124,13 +124,15 @@ namespace lysa {
     }
 
     void VirtualFS::loadShader(const std::string& shaderName, std::vector<char>& out) const {
-        std::ifstream file(
-            getPath(APP_URI + config.shadersDir + "/" + shaderName + vireo->getShaderFileExtension()),
-            std::ios::ate | std::ios::binary);
+        std::ifstream file(getShaderPath(shaderName), std::ios::ate | std::ios::binary);
         if (!file.is_open()) { throw Exception("failed to open compiled shader '", shaderName, "'"); }
         loadBinaryData(file, out);
     }
 
+    std::string VirtualFS::getShaderPath(const std::string& shaderName) const {
+        return getPath(APP_URI + config.shadersDir + "/" + shaderName + vireo->getShaderFileExtension());
+    }
+
     bool VirtualFS::directoryExists(const std::string& dirPath) const {
         std::error_code ec;
         return std::filesystem::is_directory(getPath(dirPath), ec);
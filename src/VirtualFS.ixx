@@ -127,6 +127,13 @@ export namespace lysa {
 
         void loadShader(const std::string& shaderName, std::vector<char>& out) const;
 
+        /**
+         * Returns the OS path of a compiled shader for the current backend.
+         *
+         * @param shaderName Name of the shader, without the extension of the backend.
+         */
+        std::string getShaderPath(const std::string& shaderName) const;
+
         /**
          * Frees an image buffer allocated by loadImage().
          *
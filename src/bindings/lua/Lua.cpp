@@ -116,6 +116,14 @@ end
     }
 
     void Lua::bind() {
+        const auto toTable = [&](const std::vector<const MeshInstance*>& meshInstances) {
+            auto table = luabridge::newTable(L);
+            for (auto i = 0; i < meshInstances.size(); i++) {
+                table[i + 1] = meshInstances[i];
+            }
+            return table;
+        };
+
         beginNamespace("std")
             .beginClass<std::string>("string")
                 .addFunction("append",
@@ -664,12 +672,31 @@ end
             .addFunction("destroy", &RenderingWindowManager::destroy)
         .endClass()
 
+        .beginNamespace("UpscalingFilter")
+            .addVariable("BILINEAR", UpscalingFilter::BILINEAR)
+            .addVariable("SHARPEN", UpscalingFilter::SHARPEN)
+        .endNamespace()
+        .beginClass<DynamicResolutionConfiguration>("DynamicResolutionConfiguration")
+            .addConstructor<void()>()
+            .addProperty("enabled", &DynamicResolutionConfiguration::enabled)
+            .addProperty("target_frame_time", &DynamicResolutionConfiguration::targetFrameTime)
+            .addProperty("min_scale", &DynamicResolutionConfiguration::minScale)
+            .addProperty("max_scale", &DynamicResolutionConfiguration::maxScale)
+            .addProperty("scale_step", &DynamicResolutionConfiguration::scaleStep)
+            .addProperty("headroom", &DynamicResolutionConfiguration::headroom)
+            .addProperty("adjustment_interval", &DynamicResolutionConfiguration::adjustmentInterval)
+            .addProperty("smoothing", &DynamicResolutionConfiguration::smoothing)
+            .addProperty("upscaling_filter", &DynamicResolutionConfiguration::upscalingFilter)
+            .addProperty("sharpness", &DynamicResolutionConfiguration::sharpness)
+        .endClass()
         .beginClass<RenderTargetConfiguration>("RenderTargetConfiguration")
             .addConstructor<void()>()
             .addProperty("rendering_window_handle", &RenderTargetConfiguration::renderingWindowHandle)
             .addProperty("swap_chain_format", &RenderTargetConfiguration::swapChainFormat)
             .addProperty("present_mode", &RenderTargetConfiguration::presentMode)
             .addProperty("renderer_configuration", &RenderTargetConfiguration::rendererConfiguration)
+            .addProperty("recording_threads", &RenderTargetConfiguration::recordingThreads)
+            .addProperty("dynamic_resolution", &RenderTargetConfiguration::dynamicResolution)
         .endClass()
         .beginNamespace("RenderTargetEventType")
             .addVariable("PAUSED", &RenderTargetEvent::PAUSED)
@@ -688,6 +715,15 @@ end
             .addProperty("aspect_ratio", &RenderTarget::getAspectRatio)
             .addFunction("add_view", &RenderTarget::addView)
             .addFunction("remove_view", &RenderTarget::removeView)
+            .addProperty("render_scale", &RenderTarget::getRenderScale)
+            .addProperty("average_frame_time", &RenderTarget::getAverageFrameTime)
+            .addProperty("prewarm_progress", &RenderTarget::getPrewarmProgress)
+            .addFunction("prewarm_pipelines", +[](RenderTarget* self, const std::string& path) {
+                self->prewarmPipelines(PipelineManifest::load(path));
+            })
+            .addFunction("save_used_pipelines", +[](RenderTarget* self, const std::string& path) {
+                self->getUsedPipelines().save(path);
+            })
         .endClass()
         .beginClass<RenderTargetManager>("RenderTargetManager")
             .addFunction("create", +[](RenderTargetManager* self, const RenderTargetConfiguration& config) -> RenderTarget& {
@@ -885,6 +921,17 @@ end
             .addProperty("min", &AABB::min)
             .addProperty("max", &AABB::max)
             .addFunction("to_global", &AABB::toGlobal)
+            .addFunction("merge", &AABB::merge)
+            .addFunction("contains", &AABB::contains)
+            .addFunction("intersects", &AABB::intersects)
+            .addProperty("center", &AABB::getCenter)
+            .addProperty("surface_area", &AABB::getSurfaceArea)
+        .endClass()
+        .beginClass<Ray>("Ray")
+            .addConstructor<void(), void(const float3&, const float3&)>()
+            .addProperty("origin", &Ray::origin)
+            .addProperty("direction", &Ray::direction)
+            .addFunction("get_point", &Ray::getPoint)
         .endClass()
 
         .beginClass<Vertex>("Vertex")
@@ -905,6 +952,8 @@ end
             .addFunction("get_surface_material", &Mesh::getSurfaceMaterial)
             .addFunction("set_surface_material", &Mesh::setSurfaceMaterial)
             .addProperty("aabb", &Mesh::getAABB)
+            .addFunction("build_bvh", &Mesh::buildBVH)
+            .addProperty("have_bvh", +[](const Mesh* self) { return self->getBVH() != nullptr; })
         .endClass()
         .beginClass<MeshManager>("MeshManager")
             .addFunction("create",
@@ -932,6 +981,8 @@ end
             .addProperty("mesh", &MeshInstance::getMesh)
             .addProperty("visible", &MeshInstance::isVisible, &MeshInstance::setVisible)
             .addProperty("cast_shadow", &MeshInstance::isCastShadows, &MeshInstance::setCastShadow)
+            .addProperty("occluder", &MeshInstance::isOccluder, &MeshInstance::setOccluder)
+            .addProperty("static", &MeshInstance::isStatic, &MeshInstance::setStatic)
             .addProperty("aabb", &MeshInstance::getAABB, &MeshInstance::setAABB)
             .addProperty("transform", &MeshInstance::getTransform, &MeshInstance::setTransform)
             .addFunction("get_surface_material", &MeshInstance::getSurfaceMaterial)
@@ -1023,6 +1074,29 @@ end
             .addFunction("add_instance", &Scene::addInstance)
             .addFunction("update_instance", &Scene::updateInstance)
             .addFunction("remove_instance", &Scene::removeInstance)
+            .addFunction("query_aabb", [&](const Scene* self, const AABB& aabb) {
+                return toTable(self->queryAABB(aabb));
+            })
+            .addFunction("query_sphere", [&](const Scene* self, const float3& center, const float radius) {
+                return toTable(self->querySphere(center, radius));
+            })
+            .addFunction("query_frustum", [&](const Scene* self, const Camera& camera) {
+                return toTable(self->queryFrustum(camera));
+            })
+            .addFunction("is_occluded", &Scene::isOccluded)
+            .addFunction("raycast", [&](const Scene* self, const Ray& ray, const float maxDistance) {
+                const auto hit = self->raycast(ray, maxDistance);
+                return hit ? luabridge::LuaRef(L, *hit) : luabridge::LuaRef(L);
+            })
+        .endClass()
+        .beginClass<RaycastHit>("RaycastHit")
+            .addProperty("mesh_instance", &RaycastHit::meshInstance)
+            .addProperty("distance", &RaycastHit::distance)
+            .addProperty("position", &RaycastHit::position)
+            .addProperty("precise", &RaycastHit::precise)
+            .addProperty("surface_index", &RaycastHit::surfaceIndex)
+            .addProperty("triangle_index", &RaycastHit::triangleIndex)
+            .addProperty("barycentrics", &RaycastHit::barycentrics)
         .endClass()
         .beginClass<SceneManager>("SceneManager")
            .addFunction("create", +[](SceneManager* self) -> Scene& {
@@ -1045,6 +1119,11 @@ end
             .addVariable("FORWARD", RendererType::FORWARD)
             .addVariable("DEFERRED", RendererType::DEFERRED)
         .endNamespace()
+        .beginNamespace("SSAOResolution")
+            .addVariable("FULL", SSAOResolution::FULL)
+            .addVariable("HALF", SSAOResolution::HALF)
+            .addVariable("QUARTER", SSAOResolution::QUARTER)
+        .endNamespace()
         .beginClass<RendererConfiguration>("RendererConfiguration")
             .addConstructor<void()>()
             .addProperty("renderer_type", &RendererConfiguration::rendererType)
@@ -1052,6 +1131,16 @@ end
             .addProperty("depth_stencil_format", &RendererConfiguration::depthStencilFormat)
             .addProperty("clear_color", &RendererConfiguration::clearColor)
             .addProperty("msaa", &RendererConfiguration::msaa)
+            .addProperty("post_processing_fusion_enabled", &RendererConfiguration::postProcessingFusionEnabled)
+            .addProperty("pipeline_compilation_threads", &RendererConfiguration::pipelineCompilationThreads)
+            .addProperty("bloom_threshold", &RendererConfiguration::bloomThreshold)
+            .addProperty("bloom_mip_count", &RendererConfiguration::bloomMipCount)
+            .addProperty("bloom_radius", &RendererConfiguration::bloomRadius)
+            .addProperty("bloom_intensity", &RendererConfiguration::bloomIntensity)
+#ifdef DEFERRED_RENDERER
+            .addProperty("ssao_resolution", &RendererConfiguration::ssaoResolution)
+            .addProperty("ssao_depth_sharpness", &RendererConfiguration::ssaoDepthSharpness)
+#endif
         .endClass()
         .beginClass<Renderer>("Renderer")
         .endClass()
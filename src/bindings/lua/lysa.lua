@@ -727,8 +727,19 @@ return {
     ---@field min lysa.float3
     ---@field max lysa.float3
     ---@field to_global fun(tr:lysa.AABB):lysa.AABB
+    ---@field merge fun(self:lysa.AABB, other:lysa.AABB):lysa.AABB
+    ---@field contains fun(self:lysa.AABB, other:lysa.AABB):boolean
+    ---@field intersects fun(self:lysa.AABB, other:lysa.AABB):boolean
+    ---@field center lysa.float3
+    ---@field surface_area number
     AABB = lysa.AABB,
 
+    ---@class lysa.Ray
+    ---@field origin lysa.float3
+    ---@field direction lysa.float3
+    ---@field get_point fun(self:lysa.Ray, distance:number):lysa.float3
+    Ray = lysa.Ray,
+
     ---@class lysa.Vertex
     ---@field position lysa.float3
     ---@field normal lysa.float3
@@ -747,6 +758,8 @@ return {
     ---@field get_surface_material fun(self:lysa.Mesh, surfaceIndex:integer):lysa.Material|nil
     ---@field set_surface_material fun(self:lysa.Mesh, surfaceIndex:integer, mat:integer):nil
     ---@field aabb lysa.AABB
+    ---@field build_bvh fun(self:lysa.Mesh)
+    ---@field have_bvh boolean
     Mesh = lysa.Mesh,
 
     ---@class lysa.MeshManager
@@ -762,6 +775,8 @@ return {
     ---@field aabb lysa.AABB
     ---@field visible boolean
     ---@field cast_shadow boolean
+    ---@field occluder boolean
+    ---@field static boolean
     ---@field transform lysa.float4x4
     ---@field get_surface_material fun(self:lysa.Mesh, surfaceIndex:integer):lysa.Material|nil
     ---@field set_surface_material_override fun(self:lysa.Mesh, surfaceIndex:integer, id:integer):lysa.Material|nil
@@ -782,8 +797,23 @@ return {
     ---@field add_instance fun(self:lysa.Scene, id:integer)
     ---@field update_instance fun(self:lysa.Scene, id:integer)
     ---@field remove_instance fun(self:lysa.Scene, id:integer)
+    ---@field query_aabb fun(self:lysa.Scene, aabb:lysa.AABB):lysa.MeshInstance[]
+    ---@field query_sphere fun(self:lysa.Scene, center:lysa.float3, radius:number):lysa.MeshInstance[]
+    ---@field query_frustum fun(self:lysa.Scene, camera:lysa.Camera):lysa.MeshInstance[]
+    ---@field is_occluded fun(self:lysa.Scene, mesh_instance:lysa.MeshInstance, camera:lysa.Camera):boolean
+    ---@field raycast fun(self:lysa.Scene, ray:lysa.Ray, max_distance:number):lysa.RaycastHit|nil
     Scene = lysa.Scene,
 
+    ---@class lysa.RaycastHit
+    ---@field mesh_instance lysa.MeshInstance
+    ---@field distance number
+    ---@field position lysa.float3
+    ---@field precise boolean
+    ---@field surface_index integer
+    ---@field triangle_index integer
+    ---@field barycentrics lysa.float2
+    RaycastHit = lysa.RaycastHit,
+
     ---@class lysa.SceneManager
     ---@field create fun(self:lysa.SceneManager):lysa.Scene
     ---@field get fun(self:lysa.SceneManager, id:integer):lysa.Scene
@@ -30,6 +30,12 @@ export namespace lysa {
         SMAA     = 2,
     };
 
+    enum class SSAOResolution : uint8 {
+        FULL     = 1,
+        HALF     = 2,
+        QUARTER  = 4,
+    };
+
     /**
     * Default clear color for windows and color frame buffers
     */
@@ -62,10 +68,28 @@ export namespace lysa {
         int                smaaBlendMaxSteps{4};
         //! Enable the bloom post-processing effect
         bool               bloomEnabled{true};
-        //! Bloom effect blur kernel size
-        uint32             bloomBlurKernelSize{5};
-        //! Bloom effect blur strength
-        float              bloomBlurStrength{1.2f};
+        //! Luminance over which the pixels bloom
+        float              bloomThreshold{1.0f};
+        //! Number of levels of the bloom mip chain, each level halves the resolution of the previous one
+        uint32             bloomMipCount{6};
+        //! Radius of the bloom upsampling filter, in texels of the lower level
+        float              bloomRadius{1.0f};
+        //! Intensity of the bloom added to the color attachment
+        float              bloomIntensity{1.0f};
+        //! Enable the two-phase GPU occlusion culling against a hierarchical depth buffer
+        bool               occlusionCullingEnabled{false};
+        //! Draw the visible instances of the same mesh surface with the same material in one instanced draw,
+        //! except for the ShaderMaterial with a custom vertex shader
+        bool               automaticInstancingEnabled{true};
+        //! Fuse the consecutive per-pixel post-processing passes in one draw
+        bool               postProcessingFusionEnabled{true};
+        //! Number of threads compiling the pipelines of the materials, 0 to compile them when the materials appear
+        uint32             pipelineCompilationThreads{2};
+        //! Render the static mesh instances once in the shadow maps caches instead of each frame
+        bool               shadowMapsCacheEnabled{true};
+        //! Render the six faces of the omni lights shadow maps in one pass, needs clip distances support.
+        //! Falls back to one pass per face when the device does not support it.
+        bool               omniShadowMapsSinglePassEnabled{true};
 #ifdef DEFERRED_RENDERER
         //! Enable SSAO in the deferred renderer
         bool               ssaoEnabled{true};
@@ -79,6 +103,10 @@ export namespace lysa {
         float              ssaoBias{0.025f};
         //! SSAO strength
         float              ssaoStrength{2.0f};
+        //! SSAO resolution, HALF and QUARTER compute the SSAO from a downsampled depth and normal buffer then upsample it
+        SSAOResolution     ssaoResolution{SSAOResolution::FULL};
+        //! Depth sensitivity of the bilateral blur and upsampling of the HALF and QUARTER resolutions SSAO
+        float              ssaoDepthSharpness{16.0f};
 #endif
     };
 
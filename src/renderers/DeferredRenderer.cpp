@@ -6,6 +6,8 @@
 */
 module lysa.renderers.deferred_renderer;
 
+import lysa.math;
+
 namespace lysa {
 
     DeferredRenderer::DeferredRenderer(
@@ -15,7 +17,9 @@ namespace lysa {
         ssaoBlurData{.kernelSize = config.ssaoBlurKernelSize},
         gBufferPass{config, withStencil},
         lightingPass{config, gBufferPass, withStencil} {
-        if (config.ssaoEnabled) {
+        if (config.ssaoEnabled && config.ssaoResolution != SSAOResolution::FULL) {
+            downsampledSSAOPass = std::make_unique<DownsampledSSAOPass>(config, gBufferPass);
+        } else if (config.ssaoEnabled) {
             ssaoPass = std::make_unique<SSAOPass>(config, gBufferPass, withStencil);
             ssaoBlurPass = std::make_unique<PostProcessing>(
                 config,
@@ -29,13 +33,12 @@ namespace lysa {
 
     void DeferredRenderer::update(const uint32 frameIndex) {
         Renderer::update(frameIndex);
-        if (config.ssaoEnabled) { ssaoBlurPass->update(frameIndex); }
+        if (ssaoBlurPass) { ssaoBlurPass->update(frameIndex); }
     }
 
-    void DeferredRenderer::updatePipelines(
-        const std::unordered_map<pipeline_id, std::vector<unique_id>>& pipelineIds) {
-        Renderer::updatePipelines(pipelineIds);
-        gBufferPass.updatePipelines(pipelineIds);
+    void DeferredRenderer::updatePipelines(const std::vector<MaterialPipeline>& materialPipelines) {
+        Renderer::updatePipelines(materialPipelines);
+        gBufferPass.updatePipelines(materialPipelines, pipelineCompiler);
     }
 
     void DeferredRenderer::colorPass(
@@ -53,7 +56,8 @@ namespace lysa {
             frame.depthAttachment,
             clearAttachment,
             frameIndex);
-        if (config.ssaoEnabled) {
+        auto aoMap = std::shared_ptr<vireo::RenderTarget>{};
+        if (ssaoPass) {
             ssaoPass->render(
                 commandList,
                 scene,
@@ -64,16 +68,25 @@ namespace lysa {
                 ssaoPass->getSSAOColorBuffer(frameIndex),
                 nullptr,
                 frameIndex);
+            aoMap = ssaoBlurPass->getColorAttachment(frameIndex);
+        } else if (downsampledSSAOPass) {
+            downsampledSSAOPass->render(
+                commandList,
+                scene,
+                frame.depthAttachment,
+                scissors,
+                frameIndex);
+            aoMap = downsampledSSAOPass->getSSAOColorBuffer(frameIndex);
         }
         lightingPass.render(
             commandList,
             scene,
             frame.colorAttachment,
             frame.depthAttachment,
-            config.ssaoEnabled ? ssaoBlurPass->getColorAttachment(frameIndex) : nullptr,
+            aoMap,
             true,
             frameIndex);
-        if (config.ssaoEnabled) {
+        if (ssaoBlurPass) {
             commandList.barrier(
                 ssaoBlurPass->getColorAttachment(frameIndex),
                 vireo::ResourceState::SHADER_READ,
@@ -81,13 +94,28 @@ namespace lysa {
         }
     }
 
+    void DeferredRenderer::setRenderExtent(const vireo::Extent& extent) {
+        Renderer::setRenderExtent(extent);
+        const auto renderScale = float2{
+            static_cast<float>(extent.width) / static_cast<float>(getExtent().width),
+            static_cast<float>(extent.height) / static_cast<float>(getExtent().height)};
+        if (ssaoPass) {
+            ssaoPass->setRenderScale(renderScale);
+            ssaoBlurPass->setRenderExtent(extent);
+        } else if (downsampledSSAOPass) {
+            downsampledSSAOPass->setRenderScale(renderScale);
+        }
+    }
+
     void DeferredRenderer::resize(const vireo::Extent& extent, const std::shared_ptr<vireo::CommandList>& commandList) {
         Renderer::resize(extent, commandList);
         gBufferPass.resize(extent, commandList);
-        if (config.ssaoEnabled) {
+        if (ssaoPass) {
             ssaoBlurData.update(extent, 1.2);
             ssaoPass->resize(extent, commandList);
             ssaoBlurPass->resize(extent);
+        } else if (downsampledSSAOPass) {
+            downsampledSSAOPass->resize(extent, commandList);
         }
         lightingPass.resize(extent, commandList);
     }
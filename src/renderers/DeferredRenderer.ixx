@@ -11,8 +11,10 @@ import lysa.blur_data;
 import lysa.context;
 import lysa.types;
 import lysa.renderers.configuration;
+import lysa.renderers.pipeline_manifest;
 import lysa.renderers.renderer;
 import lysa.renderers.scene_frame_data;
+import lysa.renderers.renderpasses.downsampled_ssao_pass;
 import lysa.renderers.renderpasses.gbuffer_pass;
 import lysa.renderers.renderpasses.lighting_pass;
 import lysa.renderers.renderpasses.post_processing;
@@ -41,14 +43,17 @@ export namespace lysa {
         /** Performs per-frame housekeeping (e.g., SSAO/bloom data updates). */
         void update(uint32 frameIndex) override;
 
+        using Renderer::updatePipelines;
+
         /** Updates/creates pipelines following the materials mapping. */
-        void updatePipelines(
-            const std::unordered_map<pipeline_id,
-            std::vector<unique_id>>& pipelineIds) override;
+        void updatePipelines(const std::vector<MaterialPipeline>& materialPipelines) override;
 
         /** Recreates attachments/pipelines after a resize. */
         void resize(const vireo::Extent& extent, const std::shared_ptr<vireo::CommandList>& commandList) override;
 
+        /** Sets the rendered part of the attachments, the SSAO reconstructs the positions in it. */
+        void setRenderExtent(const vireo::Extent& extent) override;
+
         /** Returns the brightness buffer used for bloom extraction. */
         std::shared_ptr<vireo::RenderTarget> getBloomColorAttachment(const uint32 frameIndex) const override {
             return lightingPass.getBrightnessBuffer(frameIndex);
@@ -60,6 +65,8 @@ export namespace lysa {
 
         PostProcessing& getSSAOBlurPass() const { return *ssaoBlurPass; }
 
+        DownsampledSSAOPass& getDownsampledSSAOPass() const { return *downsampledSSAOPass; }
+
 
     protected:
         /** Records G-Buffer population then lighting resolve into color attachment. */
@@ -82,5 +89,7 @@ export namespace lysa {
         std::unique_ptr<SSAOPass> ssaoPass;
         /** Optional blur pass applied to the SSAO result. */
         std::unique_ptr<PostProcessing> ssaoBlurPass;
+        /** Optional half or quarter resolution SSAO, replaces ssaoPass and ssaoBlurPass. */
+        std::unique_ptr<DownsampledSSAOPass> downsampledSSAOPass;
     };
 }
\ No newline at end of file
@@ -0,0 +1,64 @@
+/*
+* Copyright (c) 2025-present Henri Michelon
+*
+* This software is released under the MIT License.
+* https://opensource.org/licenses/MIT
+*/
+module lysa.renderers.dynamic_resolution;
+
+import lysa.exception;
+
+namespace lysa {
+
+    DynamicResolution::DynamicResolution(const DynamicResolutionConfiguration& config) :
+        config{config},
+        minSteps{static_cast<int32>(std::ceil(config.minScale / config.scaleStep - 0.001f))},
+        maxSteps{static_cast<int32>(std::floor(config.maxScale / config.scaleStep + 0.001f))},
+        steps{maxSteps} {
+        if (config.scaleStep <= 0.0f || minSteps < 1 || minSteps > maxSteps) {
+            throw Exception("DynamicResolutionConfiguration : invalid scales");
+        }
+        if (config.targetFrameTime <= 0.0) {
+            throw Exception("DynamicResolutionConfiguration : invalid target frame time");
+        }
+    }
+
+    bool DynamicResolution::update(const double frameTime) {
+        averageFrameTime = framesCount == 0 ?
+            frameTime :
+            averageFrameTime + config.smoothing * (frameTime - averageFrameTime);
+        framesCount += 1;
+        framesSinceChange += 1;
+        if (framesSinceChange < config.adjustmentInterval) {
+            return false;
+        }
+
+        auto newSteps = steps;
+        if (averageFrameTime > config.targetFrameTime) {
+            // The cost is proportional to the number of pixels, the square of the scale
+            const auto targetScale = getScale() * std::sqrt(config.targetFrameTime / averageFrameTime);
+            newSteps = std::min(steps - 1, static_cast<int32>(std::floor(targetScale / config.scaleStep)));
+        } else if (averageFrameTime < config.targetFrameTime * config.headroom) {
+            newSteps = steps + 1;
+        }
+        newSteps = std::clamp(newSteps, minSteps, maxSteps);
+        if (newSteps == steps) {
+            return false;
+        }
+
+        // Estimates the frame time at the new scale until the next frames are measured
+        const auto ratio = static_cast<double>(newSteps) / static_cast<double>(steps);
+        averageFrameTime *= ratio * ratio;
+        steps = newSteps;
+        framesSinceChange = 0;
+        return true;
+    }
+
+    vireo::Extent DynamicResolution::scale(const vireo::Extent& extent, const float scale) {
+        return {
+            std::max(1u, static_cast<uint32>(std::lround(extent.width * scale))),
+            std::max(1u, static_cast<uint32>(std::lround(extent.height * scale))),
+        };
+    }
+
+}
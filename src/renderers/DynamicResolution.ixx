@@ -0,0 +1,115 @@
+/*
+* Copyright (c) 2025-present Henri Michelon
+*
+* This software is released under the MIT License.
+* https://opensource.org/licenses/MIT
+*/
+export module lysa.renderers.dynamic_resolution;
+
+import vireo;
+import lysa.types;
+
+export namespace lysa {
+
+    /**
+     * Filter of the upscaling from the rendering resolution to the swap chain resolution
+     */
+    enum class UpscalingFilter {
+        //! Bilinear filtering
+        BILINEAR = 0,
+        //! Bilinear filtering followed by a contrast limited sharpening
+        SHARPEN = 1,
+    };
+
+    /**
+     * Dynamic resolution configuration, see RenderTargetConfiguration::dynamicResolution
+     */
+    struct DynamicResolutionConfiguration {
+        //! Renders the scenes at a resolution scaled to reach the target frame time
+        bool enabled{false};
+        //! Target frame time, in milliseconds
+        double targetFrameTime{1000.0 / 60.0};
+        //! Minimum scale of the rendering resolution
+        float minScale{0.5f};
+        //! Maximum scale of the rendering resolution
+        float maxScale{1.0f};
+        //! Scale increment, the scale is always a multiple of the step
+        float scaleStep{0.05f};
+        //! The scale increases when the average frame time is under targetFrameTime * headroom
+        float headroom{0.85f};
+        //! Minimum number of frames between two scale changes
+        uint32 adjustmentInterval{30};
+        //! Weight of the last frame in the average frame time
+        float smoothing{0.1f};
+        //! Upscaling filter
+        UpscalingFilter upscalingFilter{UpscalingFilter::BILINEAR};
+        //! Strength of the UpscalingFilter::SHARPEN filter, from 0.0 to 1.0
+        float sharpness{0.5f};
+    };
+
+    /**
+     * Chooses the scale of the rendering resolution from the frame times.
+     *
+     * The frame times are averaged and compared to the target frame time every
+     * DynamicResolutionConfiguration::adjustmentInterval frames at most. Over the target the scale
+     * decreases, assuming a cost proportional to the number of pixels. Under the target with some
+     * headroom the scale increases by one step. The controller does not depend on the GPU and can
+     * be fed with simulated frame times.
+     */
+    class DynamicResolution {
+    public:
+        /**
+         * Creates the controller, starting at the maximum scale
+         */
+        DynamicResolution(const DynamicResolutionConfiguration& config);
+
+        /**
+         * Adds the time of a frame
+         * @param frameTime Time of the last frame, in milliseconds
+         * @return `true` if the scale changed
+         */
+        bool update(double frameTime);
+
+        /**
+         * Returns the current scale of the rendering resolution
+         */
+        float getScale() const { return static_cast<float>(steps) * config.scaleStep; }
+
+        /**
+         * Returns the maximum scale of the rendering resolution, a multiple of the step
+         */
+        float getMaxScale() const { return static_cast<float>(maxSteps) * config.scaleStep; }
+
+        /**
+         * Returns the average frame time, in milliseconds
+         */
+        auto getAverageFrameTime() const { return averageFrameTime; }
+
+        /**
+         * Returns the rendering extent for an output extent at the current scale
+         */
+        vireo::Extent getExtent(const vireo::Extent& extent) const { return scale(extent, getScale()); }
+
+        /**
+         * Returns the rendering extent for an output extent at the maximum scale, the extent of the
+         * attachments : the scale changes only the rendered part of them
+         */
+        vireo::Extent getMaxExtent(const vireo::Extent& extent) const { return scale(extent, getMaxScale()); }
+
+        /**
+         * Returns an extent scaled and rounded, at least 1x1
+         */
+        static vireo::Extent scale(const vireo::Extent& extent, float scale);
+
+    private:
+        const DynamicResolutionConfiguration config;
+        const int32 minSteps;
+        const int32 maxSteps;
+        /* Current scale, in number of steps */
+        int32 steps;
+        double averageFrameTime{0.0};
+        uint32 framesCount{0};
+        uint32 framesSinceChange{0};
+    };
+
+}
@@ -20,9 +20,9 @@ namespace lysa {
         forwardColorPass.update(frameIndex);
     }
 
-    void ForwardRenderer::updatePipelines(const std::unordered_map<pipeline_id, std::vector<unique_id>>& pipelineIds) {
-        Renderer::updatePipelines(pipelineIds);
-        forwardColorPass.updatePipelines(pipelineIds);
+    void ForwardRenderer::updatePipelines(const std::vector<MaterialPipeline>& materialPipelines) {
+        Renderer::updatePipelines(materialPipelines);
+        forwardColorPass.updatePipelines(materialPipelines, pipelineCompiler);
     }
 
     void ForwardRenderer::colorPass(
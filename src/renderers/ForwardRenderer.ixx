@@ -11,6 +11,7 @@ import vireo;
 import lysa.context;
 import lysa.types;
 import lysa.renderers.configuration;
+import lysa.renderers.pipeline_manifest;
 import lysa.renderers.renderer;
 import lysa.renderers.renderpasses.forward_color_pass;
 import lysa.renderers.scene_frame_data;
@@ -31,10 +32,10 @@ export namespace lysa {
             const RendererConfiguration& config,
             vireo::ImageFormat outputFormat);
 
+        using Renderer::updatePipelines;
+
         /** Updates/creates pipelines following the materials mapping. */
-        void updatePipelines(
-            const std::unordered_map<pipeline_id,
-            std::vector<unique_id>>& pipelineIds) override;
+        void updatePipelines(const std::vector<MaterialPipeline>& materialPipelines) override;
 
         void resize(const vireo::Extent& extent, const std::shared_ptr<vireo::CommandList>& commandList) override;
 
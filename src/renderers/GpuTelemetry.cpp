@@ -0,0 +1,66 @@
+/*
+* Copyright (c) 2025-present Henri Michelon
+*
+* This software is released under the MIT License.
+* https://opensource.org/licenses/MIT
+*/
+module lysa.renderers.gpu_telemetry;
+
+import lysa.exception;
+
+namespace lysa {
+
+    GpuTelemetry::GpuTelemetry(const uint32 countersCount, const std::string& name, const uint32 latency) :
+        countersCount{countersCount},
+        latency{latency == 0 ? ctx().config.framesInFlight : latency} {
+        const auto& vireo = *ctx().vireo;
+        const auto size = sizeof(uint32) * countersCount;
+        counters = vireo.createBuffer(vireo::BufferType::READWRITE_STORAGE, size, 1, name + "/counters");
+        clearBuffer = vireo.createBuffer(vireo::BufferType::BUFFER_UPLOAD, size, 1, name + "/clear");
+        const auto clearValues = std::vector<uint32>(countersCount, 0);
+        clearBuffer->map();
+        clearBuffer->write(clearValues.data());
+        clearBuffer->unmap();
+        // One slot written by the GPU while the older ones are readable
+        ring.resize(this->latency + 1);
+        for (auto i = 0; i < ring.size(); i++) {
+            ring[i] = vireo.createBuffer(vireo::BufferType::BUFFER_DOWNLOAD, size, 1, name + "/ring:" + std::to_string(i));
+            ring[i]->map();
+            std::memset(ring[i]->getMappedAddress(), 0, size);
+        }
+    }
+
+    void GpuTelemetry::capture(const vireo::CommandList& commandList) {
+        if (capturesCount == 0) {
+            commandList.barrier(
+                *counters,
+                vireo::ResourceState::UNDEFINED,
+                vireo::ResourceState::COPY_DST);
+        } else {
+            commandList.barrier(
+                *counters,
+                vireo::ResourceState::COMPUTE_WRITE,
+                vireo::ResourceState::COPY_SRC);
+            commandList.copy(*counters, *ring[capturesCount % ring.size()]);
+            commandList.barrier(
+                *counters,
+                vireo::ResourceState::COPY_SRC,
+                vireo::ResourceState::COPY_DST);
+        }
+        commandList.copy(*clearBuffer, *counters);
+        commandList.barrier(
+            *counters,
+            vireo::ResourceState::COPY_DST,
+            vireo::ResourceState::COMPUTE_WRITE);
+        capturesCount += 1;
+    }
+
+    uint32 GpuTelemetry::get(const uint32 counter) const {
+        assert([&]{ return counter < countersCount; }, "Invalid telemetry counter");
+        // Slot of the capture recorded `latency` captures before the last one
+        if (capturesCount <= latency + 1) { return 0; }
+        const auto slot = (capturesCount - 1 - latency) % ring.size();
+        return static_cast<const uint32*>(ring[slot]->getMappedAddress())[counter];
+    }
+
+}
@@ -0,0 +1,67 @@
+/*
+* Copyright (c) 2025-present Henri Michelon
+*
+* This software is released under the MIT License.
+* https://opensource.org/licenses/MIT
+*/
+export module lysa.renderers.gpu_telemetry;
+
+import vireo;
+import lysa.context;
+import lysa.math;
+
+export namespace lysa {
+
+    /**
+     * Asynchronous read back of GPU counters.
+     *
+     * Shaders increment the counters of a storage buffer with atomic operations. Once per
+     * frame the counters are copied into one of the download buffers of a ring and cleared.
+     * The CPU reads the most recent copy old enough to be completed by the GPU, so
+     * reading never waits for the GPU and nothing in the frame depends on the values.
+     *
+     * The counters read are `latency` frames older than the last capture.
+     */
+    class GpuTelemetry {
+    public:
+        /**
+         * Creates the counters and the ring of download buffers.
+         * @param countersCount Number of uint32 counters
+         * @param name Debug name of the buffers
+         * @param latency Number of captures between a copy and its read back, 0 for the number of frames in flight
+         */
+        GpuTelemetry(uint32 countersCount, const std::string& name, uint32 latency = 0);
+
+        /**
+         * Records the copy of the counters incremented since the previous call into the ring,
+         * then clears them. The counters are in the COMPUTE_WRITE state when finished.
+         * @param commandList Command list to record into, before any shader using the counters
+         */
+        void capture(const vireo::CommandList& commandList);
+
+        /**
+         * Returns the value of a counter from the last completed capture, 0 if none.
+         * @param counter Index of the counter
+         */
+        uint32 get(uint32 counter) const;
+
+        /** Returns the GPU buffer of the counters, to bind as a read-write storage buffer. */
+        const auto& getCounters() const { return counters; }
+
+        /** Returns the number of counters. */
+        auto getCountersCount() const { return countersCount; }
+
+        GpuTelemetry(GpuTelemetry&) = delete;
+        GpuTelemetry& operator=(GpuTelemetry&) = delete;
+
+    private:
+        const uint32 countersCount;
+        const uint32 latency;
+        std::shared_ptr<vireo::Buffer> counters;
+        std::shared_ptr<vireo::Buffer> clearBuffer;
+        std::vector<std::shared_ptr<vireo::Buffer>> ring;
+        /* Number of captures recorded, the first one only clears the counters. */
+        uint64 capturesCount{0};
+    };
+
+}
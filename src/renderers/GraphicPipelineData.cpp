@@ -10,6 +10,7 @@ module lysa.renderers.graphic_pipeline_data;
 
 import std;
 import vireo;
+import lysa.exception;
 import lysa.log;
 
 namespace lysa {
@@ -23,6 +24,7 @@ namespace lysa {
     void GraphicPipelineData::createDescriptorLayouts(const std::shared_ptr<vireo::Vireo>& vireo) {
         pipelineDescriptorLayout = vireo->createDescriptorLayout("Pipeline data");
         pipelineDescriptorLayout->add(BINDING_INSTANCES, vireo::DescriptorType::DEVICE_STORAGE);
+        pipelineDescriptorLayout->add(BINDING_INSTANCE_INDICES, vireo::DescriptorType::DEVICE_STORAGE);
         pipelineDescriptorLayout->build();
     }
 
@@ -30,63 +32,42 @@ namespace lysa {
         pipelineDescriptorLayout.reset();
     }
 
-    GraphicPipelineData::GraphicPipelineData(
-        const uint32 pipelineId,
-        const DeviceMemoryArray& meshInstancesDataArray,
-        const uint32 maxMeshSurfacePerPipeline) :
+    GraphicPipelineInstances::GraphicPipelineInstances(
+        const pipeline_id pipelineId,
+        BufferPool& bufferPool,
+        const uint32 maxMeshSurfacePerPipeline,
+        const BufferCapacityConfiguration& capacityConfiguration) :
         pipelineId{pipelineId},
-        frustumCullingPipeline{true, meshInstancesDataArray, pipelineId},
         materialManager(ctx().res.get<MaterialManager>()),
-        vireo(ctx().vireo),
-        instancesArray{
-            ctx().vireo,
-            sizeof(InstanceData),
-            maxMeshSurfacePerPipeline,
-            maxMeshSurfacePerPipeline,
-            vireo::BufferType::DEVICE_STORAGE,
-            "instance:" + std::to_string(pipelineId)},
-        drawCommands(maxMeshSurfacePerPipeline),
-        drawCommandsBuffer{ctx().vireo->createBuffer(
-            vireo::BufferType::DEVICE_STORAGE,
-            sizeof(DrawCommand) * maxMeshSurfacePerPipeline,
-            1,
-            "drawCommand:" + std::to_string(pipelineId))},
-        culledDrawCommandsCountBuffer{ctx().vireo->createBuffer(
-            vireo::BufferType::READWRITE_STORAGE,
-            sizeof(uint32),
-            1,
-            "culledDrawCommandsCount:" + std::to_string(pipelineId))},
-        culledDrawCommandsBuffer{ctx().vireo->createBuffer(
-            vireo::BufferType::READWRITE_STORAGE,
-            sizeof(DrawCommand) * maxMeshSurfacePerPipeline,
-            1,
-            "culledDrawCommands:" + std::to_string(pipelineId))}
-    {
-        descriptorSet = ctx().vireo->createDescriptorSet(pipelineDescriptorLayout, "Graphic : " + std::to_string(pipelineId));
-        descriptorSet->update(BINDING_INSTANCES, instancesArray.getBuffer());
+        bufferPool{bufferPool},
+        capacity{maxMeshSurfacePerPipeline, capacityConfiguration},
+        stagingBuffers(ctx().config.framesInFlight) {
     }
 
-    void GraphicPipelineData::addInstance(
+    void GraphicPipelineInstances::addInstance(
         const MeshInstance* meshInstance,
-        const std::unordered_map<const MeshInstance*, MemoryBlock>& meshInstancesDataMemoryBlocks) {
-        const auto& mesh = meshInstance->getMesh();
-        const auto instanceMemoryBlock = instancesArray.alloc(mesh.getSurfaces().size());
-        instancesMemoryBlocks[meshInstance] = instanceMemoryBlock;
-        addInstance(meshInstance, instanceMemoryBlock, meshInstancesDataMemoryBlocks.at(meshInstance));
+        const MemoryBlock& meshInstanceMemoryBlock) {
+        meshInstances.insert(meshInstance);
+        appendInstance(meshInstance, meshInstanceMemoryBlock);
     }
 
-    void GraphicPipelineData::addInstance(
+    void GraphicPipelineInstances::appendInstance(
         const MeshInstance* meshInstance,
-        const MemoryBlock& instanceMemoryBlock,
         const MemoryBlock& meshInstanceMemoryBlock) {
         const auto& mesh = meshInstance->getMesh();
-        auto instancesData = std::vector<InstanceData>{};
         for (uint32 i = 0; i < mesh.getSurfaces().size(); i++) {
             const auto& surface = mesh.getSurfaces()[i];
             const auto& material = materialManager[meshInstance->getSurfaceMaterial(i)];
             if (material.getPipelineId() == pipelineId) {
-                const uint32 id = instanceMemoryBlock.instanceIndex + instancesData.size();
-                drawCommands[drawCommandsCount] = {
+                if (material.getType() == Material::SHADER &&
+                    !dynamic_cast<const ShaderMaterial&>(material).getVertFileName().empty()) {
+                    automaticInstancing = false;
+                }
+                if (drawCommandsCount >= capacity.getMaximum()) {
+                    throw Exception{"Too many mesh surfaces for pipeline " + std::to_string(pipelineId)};
+                }
+                const uint32 id = drawCommandsCount;
+                drawCommands.push_back({
                     .instanceIndex = id,
                     .command = {
                         .indexCount = surface.indexCount,
@@ -95,7 +76,14 @@ namespace lysa {
                         .vertexOffset = static_cast<int32>(mesh.getVerticesIndex()),
                         .firstInstance = id,
                     }
-                };
+                });
+                drawBatches.add(
+                    mesh.getSurfacesIndex() + i,
+                    material.getIndex(),
+                    id,
+                    drawCommands.back().command.indexCount,
+                    drawCommands.back().command.firstIndex,
+                    drawCommands.back().command.vertexOffset);
                 instancesData.push_back(InstanceData {
                     .meshInstanceIndex = meshInstanceMemoryBlock.instanceIndex,
                     .meshSurfaceIndex = mesh.getSurfacesIndex() + i,
@@ -103,67 +91,180 @@ namespace lysa {
                     .meshSurfaceMaterialIndex =  materialManager[mesh.getSurfaceMaterial(i)].getIndex(),
                 });
                 drawCommandsCount++;
+                instancesUpdated = true;
             }
         }
-        if (!instancesData.empty()) {
-            instancesArray.write(instanceMemoryBlock, instancesData.data());
-            instancesUpdated = true;
-        }
     }
 
-    void GraphicPipelineData::removeInstance(const MeshInstance* meshInstance) {
-        if (instancesMemoryBlocks.contains(meshInstance)) {
+    void GraphicPipelineInstances::removeInstance(const MeshInstance* meshInstance) {
+        if (meshInstances.contains(meshInstance)) {
             instancesToRemove.insert(meshInstance);
         }
     }
 
-    void GraphicPipelineData::updateData(
+    void GraphicPipelineInstances::updateData(
         const vireo::CommandList& commandList,
-        std::unordered_set<std::shared_ptr<vireo::Buffer>>& drawCommandsStagingBufferRecycleBin,
+        const uint32 frameIndex,
         const std::unordered_map<const MeshInstance*, MemoryBlock>& meshInstancesDataMemoryBlocks) {
         if (!instancesToRemove.empty()) {
             for (const auto* meshInstance : instancesToRemove) {
-                instancesToRemove.insert(meshInstance);
-                instancesArray.free(instancesMemoryBlocks.at(meshInstance));
-                instancesMemoryBlocks.erase(meshInstance);
-                drawCommandsCount = 0;
+                meshInstances.erase(meshInstance);
             }
             instancesToRemove.clear();
-            for (const auto& instance : std::views::keys(instancesMemoryBlocks)) {
-                addInstance(
-                    instance,
-                    instancesMemoryBlocks.at(instance),
-                    meshInstancesDataMemoryBlocks.at(instance));
+            // Compacts the instances and the draw commands
+            drawCommandsCount = 0;
+            uploadedCount = 0;
+            instancesData.clear();
+            drawCommands.clear();
+            drawBatches.clear();
+            for (const auto* instance : meshInstances) {
+                appendInstance(instance, meshInstancesDataMemoryBlocks.at(instance));
             }
+            // Also uploads when the last instance has been removed
+            instancesUpdated = true;
+        }
+
+        // The frames in flight can still read the previous buffers, the pool reuses them later
+        if (capacity.update(drawCommandsCount)) {
+            const auto name = std::to_string(pipelineId);
+            bufferPool.release(frameIndex, instancesBuffer);
+            bufferPool.release(frameIndex, drawCommandsBuffer);
+            bufferPool.release(frameIndex, batchesBuffer);
+            bufferPool.release(frameIndex, instanceBatchesBuffer);
+            instancesBuffer = bufferPool.acquire(
+                vireo::BufferType::DEVICE_STORAGE,
+                sizeof(InstanceData) * capacity.get(),
+                "instance:" + name);
+            drawCommandsBuffer = bufferPool.acquire(
+                vireo::BufferType::DEVICE_STORAGE,
+                sizeof(DrawCommand) * capacity.get(),
+                "drawCommand:" + name);
+            batchesBuffer = bufferPool.acquire(
+                vireo::BufferType::DEVICE_STORAGE,
+                sizeof(DrawBatches::Batch) * capacity.get(),
+                "batches:" + name);
+            instanceBatchesBuffer = bufferPool.acquire(
+                vireo::BufferType::DEVICE_STORAGE,
+                sizeof(uint32) * capacity.get(),
+                "instanceBatches:" + name);
+            uploadedCount = 0;
+            uploaded = false;
+            instancesUpdated = true;
         }
-        if (instancesUpdated) {
-            instancesArray.flush(commandList);
-            instancesArray.postBarrier(commandList);
-            if (drawCommandsStagingBufferCount < drawCommandsCount) {
-                if (drawCommandsStagingBuffer) {
-                    drawCommandsStagingBufferRecycleBin.insert(drawCommandsStagingBuffer);
+        if (!instancesUpdated) { return; }
+
+        auto& staging = stagingBuffers[frameIndex];
+        const auto upload = [&](
+            std::shared_ptr<vireo::Buffer>& stagingBuffer,
+            const std::shared_ptr<vireo::Buffer>& buffer,
+            const void* data,
+            const size_t offset,
+            const size_t size,
+            const vireo::ResourceState state) {
+            const auto fromState = uploaded ? state : vireo::ResourceState::UNDEFINED;
+            if (size == 0) {
+                if (!uploaded) {
+                    commandList.barrier(*buffer, fromState, state);
                 }
-                drawCommandsStagingBuffer = vireo->createBuffer(
-                    vireo::BufferType::BUFFER_UPLOAD,
-                    sizeof(DrawCommand) * drawCommandsCount);
-                drawCommandsStagingBufferCount = drawCommandsCount;
-                drawCommandsStagingBuffer->map();
+                return;
             }
+            // The staging buffer of this frame was last used by a completed frame.
+            // Reallocated when too small, or larger than the whole buffer after a shrink
+            if (!stagingBuffer || stagingBuffer->getSize() < size || stagingBuffer->getSize() > buffer->getSize()) {
+                stagingBuffer = ctx().vireo->createBuffer(vireo::BufferType::BUFFER_UPLOAD, size);
+                stagingBuffer->map();
+            }
+            stagingBuffer->write(static_cast<const std::byte*>(data) + offset, size);
+            commandList.barrier(*buffer, fromState, vireo::ResourceState::COPY_DST);
+            commandList.copy(stagingBuffer, buffer, std::vector<vireo::BufferCopyRegion>{{0, offset, size}});
+            commandList.barrier(*buffer, vireo::ResourceState::COPY_DST, state);
+        };
+        // Only the appended instances and draw commands, the batches are rebuilt by each change
+        upload(
+            staging.instances,
+            instancesBuffer,
+            instancesData.data(),
+            sizeof(InstanceData) * uploadedCount,
+            sizeof(InstanceData) * (drawCommandsCount - uploadedCount),
+            vireo::ResourceState::SHADER_READ);
+        upload(
+            staging.drawCommands,
+            drawCommandsBuffer,
+            drawCommands.data(),
+            sizeof(DrawCommand) * uploadedCount,
+            sizeof(DrawCommand) * (drawCommandsCount - uploadedCount),
+            vireo::ResourceState::INDIRECT_DRAW);
+        drawBatches.updateRanges();
+        upload(
+            staging.batches,
+            batchesBuffer,
+            drawBatches.getBatches().data(),
+            0,
+            sizeof(DrawBatches::Batch) * drawBatches.getBatches().size(),
+            vireo::ResourceState::SHADER_READ);
+        upload(
+            staging.instanceBatches,
+            instanceBatchesBuffer,
+            drawBatches.getInstanceBatches().data(),
+            0,
+            sizeof(uint32) * drawBatches.getInstanceBatches().size(),
+            vireo::ResourceState::SHADER_READ);
+        uploadedCount = drawCommandsCount;
+        uploaded = true;
+        instancesUpdated = false;
+        version += 1;
+    }
 
-            if (drawCommandsCount > 0) {
-                drawCommandsStagingBuffer->write(drawCommands.data(),
-                    sizeof(DrawCommand) * drawCommandsCount);
-               commandList.copy(drawCommandsStagingBuffer, drawCommandsBuffer, sizeof(DrawCommand) * drawCommandsCount);
+    GraphicPipelineData::GraphicPipelineData(
+        const GraphicPipelineInstances& instances,
+        const DeviceMemoryArray& meshInstancesDataArray,
+        BufferPool& bufferPool) :
+        pipelineId{instances.pipelineId},
+        instances{instances},
+        bufferPool{bufferPool},
+        frustumCullingPipeline{meshInstancesDataArray, instances.pipelineId, sizeof(DrawCommand)},
+        drawBatchingPipeline{instances.pipelineId, sizeof(DrawCommand)},
+        culledDrawCommandsCountBuffer{ctx().vireo->createBuffer(
+            vireo::BufferType::READWRITE_STORAGE,
+            sizeof(uint32),
+            1,
+            "culledDrawCommandsCount:" + std::to_string(instances.pipelineId))}
+    {
+        descriptorSet = ctx().vireo->createDescriptorSet(pipelineDescriptorLayout, "Graphic : " + std::to_string(pipelineId));
+    }
+
+    void GraphicPipelineData::updateData(const vireo::CommandList& commandList, const uint32 frameIndex) {
+        if (capacity != instances.capacity.get()) {
+            capacity = instances.capacity.get();
+            bufferPool.release(frameIndex, culledDrawCommandsBuffer);
+            culledDrawCommandsBuffer = bufferPool.acquire(
+                vireo::BufferType::READWRITE_STORAGE,
+                sizeof(DrawCommand) * capacity,
+                "culledDrawCommands:" + std::to_string(pipelineId));
+            culledDrawCommandsInitialized = false;
+            drawBatchingPipeline.reserve(capacity);
+            descriptorSet->update(BINDING_INSTANCE_INDICES, drawBatchingPipeline.getInstanceIndicesBuffer());
+            if (occlusionCullingPipeline) {
+                occlusionCullingPipeline->reserve(capacity);
             }
-            instancesUpdated = false;
-            commandList.barrier(
-                *drawCommandsBuffer,
-                vireo::ResourceState::COPY_DST,
-                vireo::ResourceState::INDIRECT_DRAW);
+        }
+        if (boundInstancesBuffer != instances.instancesBuffer) {
+            boundInstancesBuffer = instances.instancesBuffer;
+            descriptorSet->update(BINDING_INSTANCES, boundInstancesBuffer);
+        }
+        if (!culledDrawCommandsInitialized) {
             commandList.barrier(
                 *culledDrawCommandsBuffer,
-                vireo::ResourceState::COPY_DST,
+                vireo::ResourceState::UNDEFINED,
                 vireo::ResourceState::INDIRECT_DRAW);
+            culledDrawCommandsInitialized = true;
+        }
+        if (instancesVersion != instances.version) {
+            // The visibility of the previous frame is indexed by the previous draw commands
+            if (occlusionCullingPipeline) {
+                occlusionCullingPipeline->invalidate();
+            }
+            instancesVersion = instances.version;
         }
     }
 
@@ -9,14 +9,18 @@ export module lysa.renderers.graphic_pipeline_data;
 import vireo;
 
 import lysa.aabb;
+import lysa.buffer_capacity;
 import lysa.context;
+import lysa.draw_batches;
 import lysa.math;
 import lysa.memory;
 import lysa.resources.material;
 import lysa.resources.mesh;
 import lysa.resources.mesh_instance;
 import lysa.renderers.configuration;
+import lysa.renderers.pipelines.draw_batching;
 import lysa.renderers.pipelines.frustum_culling;
+import lysa.renderers.pipelines.occlusion_culling;
 
 export namespace lysa {
 
@@ -41,6 +45,12 @@ export namespace lysa {
         uint32      bloomEnabled{0};
         /** event.Toggle for SSAO post-process (1 enabled, 0 disabled). */
         uint32      ssaoEnabled{0};
+        /** event.Camera near clipping plane distance, for the lights clusters. */
+        float       nearPlane{0.0f};
+        /** event.Camera far clipping plane distance, for the lights clusters. */
+        float       farPlane{0.0f};
+        /** event.Luminance over which the pixels are written to the bloom attachment. */
+        float       bloomThreshold{1.0f};
     };
 
     /**
@@ -86,82 +96,95 @@ export namespace lysa {
     };
 
     /**
-     * event.Per-pipeline data for instances, draw command arrays and culling.
+     * event.Per-pipeline instances and draw commands, shared by the frames in flight.
      *
-     * Stores instance data, staging/copy buffers and the compute pipeline
-     * used to perform frustum culling and produce culled indirect draws.
+     * Only changes when mesh instances are added or removed. The GPU buffers are updated by
+     * the command list of the frame applying the changes : all the frames are submitted to the
+     * same queue so the frames in flight submitted before read them before the copies, and each
+     * frame in flight uploads from its own staging buffers.
+     *
+     * The instances and the draw commands are stored contiguously, the additions are appended
+     * and only the appended ones are uploaded, the removals compact the arrays. The GPU buffers
+     * are acquired from the scene BufferPool with the capacity of the number of draw commands
+     * (see BufferCapacity) and are reallocated when the capacity changes.
      */
-    struct GraphicPipelineData {
-        /** event.Descriptor binding for per-instance buffer used by pipelines. */
-        static constexpr vireo::DescriptorIndex BINDING_INSTANCES{0};
-        /** event.Shared descriptor layout for pipeline-local resources. */
-        inline static std::shared_ptr<vireo::DescriptorLayout> pipelineDescriptorLayout{nullptr};
-        /**
-         * event.Create the shared descriptor layout.
-         * @param vireo Shared pointer to the Vireo instance.
-         */
-        static void createDescriptorLayouts(const std::shared_ptr<vireo::Vireo>& vireo);
-        /** event.Destroy the shared descriptor layout. */
-        static void destroyDescriptorLayouts();
-
+    struct GraphicPipelineInstances {
         /** event.Identifier of the material/pipeline family. */
         pipeline_id pipelineId;
-        /** event.Descriptor set bound when drawing with this pipeline. */
-        std::shared_ptr<vireo::DescriptorSet> descriptorSet;
-        /** event.Compute pipeline used to cull draw commands against the frustum. */
-        FrustumCulling frustumCullingPipeline;
         /** event.Reference to the material manager. */
         MaterialManager& materialManager;
-        /** event.Reference to Vireo. */
-        std::shared_ptr<vireo::Vireo> vireo;
+        /** event.Pool of the GPU buffers of the scene. */
+        BufferPool& bufferPool;
 
+        /** event.Incremented each time the draw commands are uploaded, see GraphicPipelineData::instancesVersion. */
+        uint32 version{0};
         /** event.Flag tracking if the instances set has been updated. */
         bool instancesUpdated{false};
+        /**
+         * event.false for the ShaderMaterial pipelines with a custom vertex shader : their draw
+         * commands are not instanced by the automatic instancing, see DrawBatches::INDIRECT_INSTANCE.
+         */
+        bool automaticInstancing{true};
+        /** event.Mesh instances registered in this pipeline. */
+        std::unordered_set<const MeshInstance*> meshInstances;
         /** event.Set of mesh instances scheduled for removal. */
         std::unordered_set<const MeshInstance*> instancesToRemove;
-        /** event.Device memory array that stores InstanceData blocks. */
-        DeviceMemoryArray instancesArray;
-        /** event.Mapping of mesh instance to its memory block within instancesArray. */
-        std::unordered_map<const MeshInstance*, MemoryBlock> instancesMemoryBlocks;
+        /** event.CPU-side list of the instances, one per draw command. */
+        std::vector<InstanceData> instancesData;
 
         /** event.Number of indirect draw commands before culling. */
         uint32 drawCommandsCount{0};
+        /** event.Number of draw commands and instances already in the GPU buffers. */
+        uint32 uploadedCount{0};
         /** event.CPU-side list of draw commands to upload. */
         std::vector<DrawCommand> drawCommands;
+        /** event.Batches of the draw commands sharing a mesh surface and a material. */
+        DrawBatches drawBatches;
+        /** event.Capacity of the GPU buffers, in draw commands. */
+        BufferCapacity capacity;
+        /** event.GPU buffer storing the InstanceData. */
+        std::shared_ptr<vireo::Buffer> instancesBuffer;
         /** event.GPU buffer storing indirect draw commands. */
         std::shared_ptr<vireo::Buffer> drawCommandsBuffer;
-        /** event.GPU buffer storing the count of culled draw commands. */
-        std::shared_ptr<vireo::Buffer> culledDrawCommandsCountBuffer;
-        /** event.GPU buffer storing culled indirect draw commands. */
-        std::shared_ptr<vireo::Buffer> culledDrawCommandsBuffer;
+        /** event.GPU buffer storing the batches of the draw commands, see DrawBatching. */
+        std::shared_ptr<vireo::Buffer> batchesBuffer;
+        /** event.GPU buffer storing the batch of each instance index, see DrawBatching. */
+        std::shared_ptr<vireo::Buffer> instanceBatchesBuffer;
 
-        /** event.Staging buffer used to copy draw commands to the GPU. */
-        std::shared_ptr<vireo::Buffer> drawCommandsStagingBuffer;
-        /** event.Number of draw commands stored in the current staging buffer. */
-        uint32 drawCommandsStagingBufferCount{0};
+        /** event.Staging buffers of a frame in flight, resized on demand. */
+        struct StagingBuffers {
+            std::shared_ptr<vireo::Buffer> instances;
+            std::shared_ptr<vireo::Buffer> drawCommands;
+            std::shared_ptr<vireo::Buffer> batches;
+            std::shared_ptr<vireo::Buffer> instanceBatches;
+        };
+        /** event.Staging buffers, one set per frame in flight. */
+        std::vector<StagingBuffers> stagingBuffers;
+        /** event.Flag set once the GPU buffers have been written. */
+        bool uploaded{false};
 
         /**
-         * event.Create a pipeline data object for a specific material/pipeline ID.
-         * 
-         * @param ctx Reference to the rendering context.
+         * event.Create the shared instances of a material/pipeline ID.
+         *
          * @param pipelineId Identifier of the pipeline.
-         * @param meshInstancesDataArray Array storing per-mesh-instance data.
+         * @param bufferPool Pool of the GPU buffers of the scene.
          * @param maxMeshSurfacePerPipeline Maximum number of mesh surfaces supported by this pipeline.
+         * @param capacityConfiguration Sizing rules of the GPU buffers.
          */
-        GraphicPipelineData(
-            const
-            uint32 pipelineId,
-            const DeviceMemoryArray& meshInstancesDataArray,
-            uint32 maxMeshSurfacePerPipeline);
+        GraphicPipelineInstances(
+            pipeline_id pipelineId,
+            BufferPool& bufferPool,
+            uint32 maxMeshSurfacePerPipeline,
+            const BufferCapacityConfiguration& capacityConfiguration);
 
         /**
-         * event.Registers a mesh instance into this pipeline data object.
+         * event.Registers a mesh instance into this pipeline.
          * @param meshInstance Pointer to the mesh instance to add.
-         * @param meshInstancesDataMemoryBlocks Map of memory blocks for mesh instance data.
+         * @param meshInstanceMemoryBlock Memory block for the mesh instance data.
          */
         void addInstance(
             const MeshInstance* meshInstance,
-            const std::unordered_map<const MeshInstance*, MemoryBlock>& meshInstancesDataMemoryBlocks);
+            const MemoryBlock& meshInstanceMemoryBlock);
 
         /**
          * event.Removes a previously registered mesh instance.
@@ -171,27 +194,98 @@ export namespace lysa {
             const MeshInstance* meshInstance);
 
         /**
-         * event.Adds a single draw instance and wires memory blocks.
-         * @param meshInstance Pointer to the mesh instance.
-         * @param instanceMemoryBlock Memory block for the instance data.
-         * @param meshInstanceMemoryBlock Memory block for the mesh instance data.
+         * event.Rebuilds the draw commands after removals, resizes the GPU buffers and uploads the changes.
+         *
+         * @param commandList Command buffer for GPU operations.
+         * @param frameIndex Index of the frame in flight, selects the staging buffers.
+         * @param meshInstancesDataMemoryBlocks Map of memory blocks for mesh instance data.
          */
-        void addInstance(
+        void updateData(
+            const vireo::CommandList& commandList,
+            uint32 frameIndex,
+            const std::unordered_map<const MeshInstance*, MemoryBlock>& meshInstancesDataMemoryBlocks);
+
+        GraphicPipelineInstances(GraphicPipelineInstances&) = delete;
+        GraphicPipelineInstances& operator=(GraphicPipelineInstances&) = delete;
+
+    private:
+        void appendInstance(
             const MeshInstance* meshInstance,
-            const MemoryBlock& instanceMemoryBlock,
             const MemoryBlock& meshInstanceMemoryBlock);
+    };
 
+    /**
+     * event.Per-frame culling data of a graphic pipeline.
+     *
+     * Stores the culled draw commands and the compute pipelines used to perform the culling
+     * of the draw commands of the shared GraphicPipelineInstances. The buffers follow the
+     * capacity of the shared instances.
+     */
+    struct GraphicPipelineData {
+        /** event.Descriptor binding for per-instance buffer used by pipelines. */
+        static constexpr vireo::DescriptorIndex BINDING_INSTANCES{0};
+        /** event.Descriptor binding for the instance indices of the instanced draw commands, see DrawBatches. */
+        static constexpr vireo::DescriptorIndex BINDING_INSTANCE_INDICES{1};
+        /** event.Shared descriptor layout for pipeline-local resources. */
+        inline static std::shared_ptr<vireo::DescriptorLayout> pipelineDescriptorLayout{nullptr};
         /**
-         * event.Uploads/refreshes GPU buffers and prepares culled draw arrays.
-         * 
+         * event.Create the shared descriptor layout.
+         * @param vireo Shared pointer to the Vireo instance.
+         */
+        static void createDescriptorLayouts(const std::shared_ptr<vireo::Vireo>& vireo);
+        /** event.Destroy the shared descriptor layout. */
+        static void destroyDescriptorLayouts();
+
+        /** event.Identifier of the material/pipeline family. */
+        pipeline_id pipelineId;
+        /** event.Instances and draw commands shared by the frames in flight. */
+        const GraphicPipelineInstances& instances;
+        /** event.Pool of the GPU buffers of the scene. */
+        BufferPool& bufferPool;
+        /** event.Version of the shared draw commands culled by the last frame. */
+        uint32 instancesVersion{0};
+        /** event.Capacity of the culling buffers, in draw commands. */
+        uint32 capacity{0};
+        /** event.Shared instances buffer bound in descriptorSet. */
+        std::shared_ptr<vireo::Buffer> boundInstancesBuffer;
+        /** event.Descriptor set bound when drawing with this pipeline. */
+        std::shared_ptr<vireo::DescriptorSet> descriptorSet;
+        /** event.Compute pipeline used to cull draw commands against the camera and shadow maps frustums. */
+        FrustumCulling frustumCullingPipeline;
+        /** event.Compute pipeline replacing the frustum culling when the occlusion culling is enabled. */
+        std::unique_ptr<OcclusionCulling> occlusionCullingPipeline;
+        /** event.Compute pipeline gathering the culled draw commands of the camera in instanced draw commands. */
+        DrawBatching drawBatchingPipeline;
+
+        /** event.GPU buffer storing the count of culled draw commands. */
+        std::shared_ptr<vireo::Buffer> culledDrawCommandsCountBuffer;
+        /** event.GPU buffer storing culled indirect draw commands. */
+        std::shared_ptr<vireo::Buffer> culledDrawCommandsBuffer;
+        /** event.Flag set once culledDrawCommandsBuffer is in the indirect draw state. */
+        bool culledDrawCommandsInitialized{false};
+
+        /**
+         * event.Create the culling data of a frame for the shared instances of a pipeline.
+         *
+         * @param instances Instances and draw commands of the pipeline.
+         * @param meshInstancesDataArray Array storing per-mesh-instance data.
+         * @param bufferPool Pool of the GPU buffers of the scene.
+         */
+        GraphicPipelineData(
+            const GraphicPipelineInstances& instances,
+            const DeviceMemoryArray& meshInstancesDataArray,
+            BufferPool& bufferPool);
+
+        /** event.Returns the number of indirect draw commands before culling. */
+        auto getDrawCommandsCount() const { return instances.drawCommandsCount; }
+
+        /**
+         * event.Resizes the culling buffers to the capacity of the shared instances, resets the
+         * occlusion culling when the draw commands changed.
          * @param commandList Command buffer for GPU operations.
-         * @param drawCommandsStagingBufferRecycleBin Set for recycling staging buffers.
-         * @param meshInstancesDataMemoryBlocks Map of memory blocks for mesh instance data.
+         * @param frameIndex Index of the frame in flight.
          */
-        void updateData(
-            const vireo::CommandList& commandList,
-            std::unordered_set<std::shared_ptr<vireo::Buffer>>& drawCommandsStagingBufferRecycleBin,
-            const std::unordered_map<const MeshInstance*, MemoryBlock>& meshInstancesDataMemoryBlocks);
+        void updateData(const vireo::CommandList& commandList, uint32 frameIndex);
     };
 
 }
@@ -0,0 +1,126 @@
+/*
+* Copyright (c) 2025-present Henri Michelon
+*
+* This software is released under the MIT License.
+* https://opensource.org/licenses/MIT
+*/
+module lysa.renderers.pipeline_compiler;
+
+import lysa.context;
+
+namespace lysa {
+
+    PipelineCompiler::PipelineCompiler(const uint32 threadsCount) {
+        for (auto i = 0; i < threadsCount; i++) {
+            workers.emplace_back([this](const std::stop_token& stopToken) { work(stopToken); });
+        }
+    }
+
+    PipelineCompiler::~PipelineCompiler() {
+        for (auto& worker : workers) {
+            worker.request_stop();
+        }
+        jobQueued.notify_all();
+        workers.clear();
+    }
+
+    void PipelineCompiler::compile(
+        Pipelines& pipelines,
+        const pipeline_id pipelineId,
+        const vireo::GraphicPipelineConfiguration& configuration,
+        const std::string& name) {
+        if (workers.empty()) {
+            {
+                auto lock = std::lock_guard(mutex);
+                statistics.queuedCount += 1;
+            }
+            auto job = Job{&pipelines, pipelineId, configuration, name};
+            create(job);
+            if (job.exception) {
+                std::rethrow_exception(job.exception);
+            }
+            pipelines[pipelineId] = job.pipeline;
+            return;
+        }
+        {
+            auto lock = std::lock_guard(mutex);
+            for (const auto& job : jobs) {
+                if (job.pipelines == &pipelines && job.pipelineId == pipelineId) { return; }
+            }
+            jobs.push_back({&pipelines, pipelineId, configuration, name});
+            queue.push_back(&jobs.back());
+            statistics.pendingCount += 1;
+            statistics.queuedCount += 1;
+        }
+        jobQueued.notify_one();
+    }
+
+    void PipelineCompiler::swap() {
+        auto lock = std::lock_guard(mutex);
+        statistics.swappedCount = 0;
+        if (jobs.empty()) { return; }
+        auto pendingIds = std::unordered_set<pipeline_id>{};
+        for (const auto& job : jobs) {
+            if (!job.done) {
+                pendingIds.insert(job.pipelineId);
+            }
+        }
+        auto exception = std::exception_ptr{nullptr};
+        for (auto it = jobs.begin(); it != jobs.end();) {
+            if (pendingIds.contains(it->pipelineId)) {
+                ++it;
+                continue;
+            }
+            if (it->exception) {
+                if (!exception) { exception = it->exception; }
+            } else {
+                (*it->pipelines)[it->pipelineId] = it->pipeline;
+                statistics.swappedCount += 1;
+            }
+            it = jobs.erase(it);
+        }
+        statistics.pendingPipelineIdsCount = static_cast<uint32>(pendingIds.size());
+        if (exception) {
+            std::rethrow_exception(exception);
+        }
+    }
+
+    PipelineCompilerStatistics PipelineCompiler::getStatistics() const {
+        auto lock = std::lock_guard(mutex);
+        return statistics;
+    }
+
+    void PipelineCompiler::work(const std::stop_token& stopToken) {
+        while (true) {
+            Job* job;
+            {
+                auto lock = std::unique_lock(mutex);
+                if (!jobQueued.wait(lock, stopToken, [this] { return !queue.empty(); })) {
+                    return;
+                }
+                job = queue.front();
+                queue.pop_front();
+            }
+            // The job is only read by swap() once done
+            create(*job);
+            auto lock = std::lock_guard(mutex);
+            job->done = true;
+            statistics.pendingCount -= 1;
+        }
+    }
+
+    void PipelineCompiler::create(Job& job) {
+        const auto start = std::chrono::steady_clock::now();
+        try {
+            job.pipeline = ctx().vireo->createGraphicPipeline(job.configuration, job.name);
+        } catch (...) {
+            job.exception = std::current_exception();
+        }
+        const auto time = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+        auto lock = std::lock_guard(mutex);
+        statistics.compiledCount += 1;
+        statistics.compileTime += time;
+        statistics.maxCompileTime = std::max(statistics.maxCompileTime, time);
+    }
+
+}
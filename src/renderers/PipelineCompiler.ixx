@@ -0,0 +1,116 @@
+/*
+* Copyright (c) 2025-present Henri Michelon
+*
+* This software is released under the MIT License.
+* https://opensource.org/licenses/MIT
+*/
+export module lysa.renderers.pipeline_compiler;
+
+import vireo;
+import lysa.math;
+import lysa.types;
+
+export namespace lysa {
+
+    /**
+     * Counters of the pipelines compilation, see PipelineCompiler::getStatistics()
+     */
+    struct PipelineCompilerStatistics {
+        /** Number of pipelines waiting for or in compilation */
+        uint32 pendingCount{0};
+        /** Number of pipeline ids whose draws are skipped, waiting for at least one of their pipelines */
+        uint32 pendingPipelineIdsCount{0};
+        /** Number of pipelines made available by the last swap() */
+        uint32 swappedCount{0};
+        /** Total number of pipelines queued by compile() */
+        uint64 queuedCount{0};
+        /** Total number of compiled pipelines */
+        uint64 compiledCount{0};
+        /** Total compilation time, summed over the threads, in milliseconds */
+        double compileTime{0.0};
+        /** Longest compilation time, in milliseconds */
+        double maxCompileTime{0.0};
+    };
+
+    /**
+     * Compiles the graphic pipelines of the materials in background threads.
+     *
+     * The render passes queue their pipelines with compile() instead of creating them. A
+     * compiled pipeline is kept aside until swap(), called by the renderer before the recording
+     * of a frame, which adds to the pipelines maps of the passes all the pipelines of the
+     * pipeline ids whose pipelines are all compiled. A new material then appears in all the
+     * passes in the same frame : the draws of its pipeline id are skipped until then, see
+     * SceneFrameData::drawModels().
+     *
+     * With 0 threads the pipelines are created by compile(), as before.
+     */
+    class PipelineCompiler {
+    public:
+        /** Pipelines of a pass, by pipeline id */
+        using Pipelines = std::unordered_map<pipeline_id, std::shared_ptr<vireo::GraphicPipeline>>;
+
+        /**
+         * Creates the compiler
+         * @param threadsCount Number of compilation threads, 0 to compile in compile()
+         */
+        PipelineCompiler(uint32 threadsCount);
+
+        /**
+         * Queues the compilation of a pipeline, ignored if already queued
+         * @param pipelines Pipelines map of the pass, updated by swap()
+         * @param pipelineId The pipeline id of the materials
+         * @param configuration Configuration of the pipeline, copied
+         * @param name Debug name of the pipeline
+         */
+        void compile(
+            Pipelines& pipelines,
+            pipeline_id pipelineId,
+            const vireo::GraphicPipelineConfiguration& configuration,
+            const std::string& name);
+
+        /**
+         * Adds the compiled pipelines to the pipelines maps of the passes, per pipeline id.
+         * Rethrows the first compilation error.
+         */
+        void swap();
+
+        /**
+         * Returns the counters of the compilation
+         */
+        PipelineCompilerStatistics getStatistics() const;
+
+        /**
+         * Returns true if the pipelines are compiled in background threads
+         */
+        auto isAsync() const { return !workers.empty(); }
+
+        ~PipelineCompiler();
+        PipelineCompiler(PipelineCompiler&) = delete;
+        PipelineCompiler& operator=(PipelineCompiler&) = delete;
+
+    private:
+        struct Job {
+            Pipelines* pipelines;
+            pipeline_id pipelineId;
+            vireo::GraphicPipelineConfiguration configuration;
+            std::string name;
+            std::shared_ptr<vireo::GraphicPipeline> pipeline{nullptr};
+            std::exception_ptr exception{nullptr};
+            bool done{false};
+        };
+
+        mutable std::mutex mutex;
+        std::condition_variable_any jobQueued;
+        /* Queued and compiled jobs, removed by swap() */
+        std::list<Job> jobs;
+        /* Jobs waiting for a thread */
+        std::deque<Job*> queue;
+        PipelineCompilerStatistics statistics;
+        std::vector<std::jthread> workers;
+
+        void work(const std::stop_token& stopToken);
+
+        void create(Job& job);
+    };
+
+}
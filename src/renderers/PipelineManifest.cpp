@@ -0,0 +1,130 @@
+/*
+* Copyright (c) 2025-present Henri Michelon
+*
+* This software is released under the MIT License.
+* https://opensource.org/licenses/MIT
+*/
+module lysa.renderers.pipeline_manifest;
+
+import lysa.context;
+import lysa.exception;
+import lysa.log;
+
+namespace lysa {
+
+    MaterialPipeline MaterialPipeline::of(const Material& material) {
+        auto pipeline = MaterialPipeline {
+            .pipelineId = material.getPipelineId(),
+            .type = material.getType(),
+            .transparency = material.getTransparency(),
+            .cullMode = material.getCullMode(),
+        };
+        if (material.getType() == Material::SHADER) {
+            const auto& shaderMaterial = dynamic_cast<const ShaderMaterial&>(material);
+            pipeline.vertFileName = shaderMaterial.getVertFileName();
+            pipeline.fragFileName = shaderMaterial.getFragFileName();
+        }
+        return pipeline;
+    }
+
+    bool PipelineManifest::add(const MaterialPipeline& pipeline) {
+        return pipelines.try_emplace(pipeline.pipelineId, pipeline).second;
+    }
+
+    void PipelineManifest::merge(const PipelineManifest& manifest) {
+        for (const auto& pipeline : manifest.pipelines | std::views::values) {
+            add(pipeline);
+        }
+    }
+
+    std::vector<MaterialPipeline> PipelineManifest::getPipelines() const {
+        auto result = std::vector<MaterialPipeline>{};
+        result.reserve(pipelines.size());
+        for (const auto& pipeline : pipelines | std::views::values) {
+            result.push_back(pipeline);
+        }
+        return result;
+    }
+
+    void PipelineManifest::save(const std::string& filepath) const {
+        auto file = ctx().fs.openWriteStream(filepath);
+        write(file);
+        if (!file) {
+            throw Exception("Error writing pipelines manifest ", filepath);
+        }
+    }
+
+    void PipelineManifest::write(std::ostream& stream) const {
+        const auto shaderName = [](const std::string& name) {
+            return name.empty() ? std::string{DEFAULT_SHADER} : name;
+        };
+        stream << HEADER << '\n';
+        for (const auto& pipeline : pipelines | std::views::values) {
+            stream << pipeline.pipelineId << ' '
+                   << static_cast<uint32>(pipeline.type) << ' '
+                   << static_cast<uint32>(pipeline.transparency) << ' '
+                   << static_cast<uint32>(pipeline.cullMode) << ' '
+                   << std::quoted(shaderName(pipeline.vertFileName)) << ' '
+                   << std::quoted(shaderName(pipeline.fragFileName)) << '\n';
+        }
+    }
+
+    PipelineManifest PipelineManifest::load(const std::string& filepath) {
+        if (!ctx().fs.fileExists(filepath)) { return {}; }
+        auto file = ctx().fs.openReadStream(filepath);
+        return read(file, filepath);
+    }
+
+    PipelineManifest PipelineManifest::read(std::istream& stream, const std::string& name) {
+        auto manifest = PipelineManifest{};
+        const auto shaderName = [](const std::string& fileName) {
+            return fileName == DEFAULT_SHADER ? std::string{} : fileName;
+        };
+        auto line = std::string{};
+        auto lineNumber = 0;
+        while (std::getline(stream, line)) {
+            lineNumber += 1;
+            if (line.empty() || line.starts_with('#')) { continue; }
+            auto fields = std::istringstream{line};
+            auto pipelineId = pipeline_id{0};
+            auto type = uint32{0};
+            auto transparency = uint32{0};
+            auto cullMode = uint32{0};
+            auto vertFileName = std::string{};
+            auto fragFileName = std::string{};
+            fields >> pipelineId >> type >> transparency >> cullMode
+                   >> std::quoted(vertFileName) >> std::quoted(fragFileName);
+            if (fields.fail() ||
+                type > Material::SHADER ||
+                transparency > static_cast<uint32>(Transparency::ALPHA) ||
+                !isValid(static_cast<vireo::CullMode>(cullMode))) {
+                Log::warning("Pipelines manifest ", name, " : line ", lineNumber, " ignored");
+                continue;
+            }
+            manifest.add({
+                .pipelineId = pipelineId,
+                .type = static_cast<Material::Type>(type),
+                .transparency = static_cast<Transparency>(transparency),
+                .cullMode = static_cast<vireo::CullMode>(cullMode),
+                .vertFileName = shaderName(vertFileName),
+                .fragFileName = shaderName(fragFileName),
+            });
+        }
+        return manifest;
+    }
+
+    bool PipelineManifest::isValid(const vireo::CullMode cullMode) {
+        return cullMode == vireo::CullMode::NONE ||
+               cullMode == vireo::CullMode::FRONT ||
+               cullMode == vireo::CullMode::BACK;
+    }
+
+    std::string PipelineManifest::getPath(const std::string& assetsPackPath) {
+        constexpr auto extension = std::string_view{".assets"};
+        if (assetsPackPath.ends_with(extension)) {
+            return assetsPackPath.substr(0, assetsPackPath.size() - extension.size()) + ".pipelines";
+        }
+        return assetsPackPath + ".pipelines";
+    }
+
+}
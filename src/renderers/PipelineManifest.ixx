@@ -0,0 +1,119 @@
+/*
+* Copyright (c) 2025-present Henri Michelon
+*
+* This software is released under the MIT License.
+* https://opensource.org/licenses/MIT
+*/
+export module lysa.renderers.pipeline_manifest;
+
+import vireo;
+import lysa.types;
+import lysa.resources.material;
+
+export namespace lysa {
+
+    /**
+     * Material flags used by the render passes to create the pipelines of a pipeline id
+     */
+    struct MaterialPipeline {
+        //! Pipeline id of the materials
+        pipeline_id pipelineId{DEFAULT_PIPELINE_ID};
+        //! Type of the materials
+        Material::Type type{Material::STANDARD};
+        //! Transparency mode of the materials
+        Transparency transparency{Transparency::DISABLED};
+        //! Cull mode of the materials
+        vireo::CullMode cullMode{vireo::CullMode::NONE};
+        //! Vertex shader of the shader materials, empty for the default one
+        std::string vertFileName;
+        //! Fragment shader of the shader materials, empty for the default one
+        std::string fragFileName;
+
+        /**
+         * Returns the pipeline flags of a material
+         */
+        static MaterialPipeline of(const Material& material);
+    };
+
+    /**
+     * List of the pipelines used by an assets pack or by a run of the application.
+     *
+     * A manifest is saved next to an assets pack, see getPath(), or from the pipelines used by a
+     * renderer during a recording run, see Renderer::getUsedPipelines(). At load time
+     * Renderer::prewarmPipelines() queues the compilation of all the listed pipelines in all
+     * the passes before the first frame. The passes are not stored in the manifest since they
+     * depend on the configuration of the renderer which loads it.
+     *
+     * The file is a text file with one pipeline per line :
+     * `pipelineId type transparency cullMode "vertFileName" "fragFileName"`, with `"-"` for the
+     * default shaders. The shader file names are quoted and may contain spaces.
+     */
+    class PipelineManifest {
+    public:
+        /**
+         * Adds a pipeline, ignored if the pipeline id is already listed
+         * @return `true` if the pipeline was added
+         */
+        bool add(const MaterialPipeline& pipeline);
+
+        /**
+         * Adds the pipelines of another manifest
+         */
+        void merge(const PipelineManifest& manifest);
+
+        /**
+         * Returns the listed pipelines, ordered by pipeline id
+         */
+        std::vector<MaterialPipeline> getPipelines() const;
+
+        /**
+         * Returns the number of listed pipelines
+         */
+        auto getPipelinesCount() const { return pipelines.size(); }
+
+        /**
+         * Returns `true` if no pipeline is listed
+         */
+        auto empty() const { return pipelines.empty(); }
+
+        /**
+         * Saves the manifest
+         * @param filepath URI of the manifest file
+         */
+        void save(const std::string& filepath) const;
+
+        /**
+         * Writes the manifest in a stream
+         */
+        void write(std::ostream& stream) const;
+
+        /**
+         * Loads a manifest, the malformed lines are ignored
+         * @param filepath URI of the manifest file
+         * @return The manifest, empty if the file does not exist
+         */
+        static PipelineManifest load(const std::string& filepath);
+
+        /**
+         * Reads a manifest from a stream, the malformed lines are ignored
+         * @param stream Content of the manifest
+         * @param name Name of the manifest in the warnings
+         */
+        static PipelineManifest read(std::istream& stream, const std::string& name);
+
+        /**
+         * Returns the URI of the manifest saved next to an assets pack,
+         * `scene.assets` -> `scene.pipelines`
+         */
+        static std::string getPath(const std::string& assetsPackPath);
+
+    private:
+        static constexpr auto HEADER{"# Lysa pipelines manifest 1"};
+        static constexpr auto DEFAULT_SHADER{"-"};
+
+        std::map<pipeline_id, MaterialPipeline> pipelines;
+
+        static bool isValid(vireo::CullMode cullMode);
+    };
+
+}
@@ -0,0 +1,120 @@
+/*
+* Copyright (c) 2025-present Henri Michelon
+*
+* This software is released under the MIT License.
+* https://opensource.org/licenses/MIT
+*/
+module lysa.renderers.recording_scheduler;
+
+import lysa.context;
+import lysa.exception;
+
+namespace lysa {
+
+    RecordingScheduler::RecordingScheduler(const uint32 threadsCount, const vireo::CommandType commandType) :
+        commandType{commandType} {
+        if (threadsCount == 0) {
+            throw Exception("RecordingScheduler : need a least one recording thread");
+        }
+        framesSlots.resize(ctx().config.framesInFlight);
+        for (auto i = 1; i < threadsCount; i++) {
+            workers.emplace_back([this](const std::stop_token& stopToken) { work(stopToken); });
+        }
+    }
+
+    RecordingScheduler::~RecordingScheduler() {
+        for (auto& worker : workers) {
+            worker.request_stop();
+        }
+        batchReady.notify_all();
+        workers.clear();
+    }
+
+    const std::vector<std::shared_ptr<const vireo::CommandList>>& RecordingScheduler::record(
+        const uint32 frameIndex,
+        const std::vector<Job>& jobs) {
+        const auto start = std::chrono::steady_clock::now();
+        // The allocators are created by the calling thread, the workers only record
+        auto& frameSlots = framesSlots[frameIndex];
+        while (frameSlots.size() < jobs.size()) {
+            auto slot = Slot{ .commandAllocator = ctx().vireo->createCommandAllocator(commandType) };
+            slot.commandList = slot.commandAllocator->createCommandList();
+            frameSlots.push_back(slot);
+        }
+        commandLists.clear();
+        for (auto i = 0; i < jobs.size(); i++) {
+            commandLists.push_back(frameSlots[i].commandList);
+        }
+
+        nextJob = 0;
+        if (workers.empty() || jobs.size() < 2) {
+            execute(jobs, frameSlots);
+        } else {
+            {
+                auto lock = std::lock_guard(mutex);
+                this->jobs = &jobs;
+                slots = &frameSlots;
+                batch += 1;
+            }
+            batchReady.notify_all();
+            execute(jobs, frameSlots);
+            auto lock = std::unique_lock(mutex);
+            // All the jobs are taken, wait for the ones still recorded by the workers
+            batchDone.wait(lock, [this] { return activeWorkers == 0; });
+            this->jobs = nullptr;
+            slots = nullptr;
+        }
+
+        recordingTime = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+        if (exception) {
+            const auto error = exception;
+            exception = nullptr;
+            std::rethrow_exception(error);
+        }
+        return commandLists;
+    }
+
+    void RecordingScheduler::work(const std::stop_token& stopToken) {
+        auto lastBatch = uint64{0};
+        while (!stopToken.stop_requested()) {
+            const std::vector<Job>* batchJobs;
+            std::vector<Slot>* batchSlots;
+            {
+                auto lock = std::unique_lock(mutex);
+                if (!batchReady.wait(lock, stopToken, [&] { return batch != lastBatch; })) {
+                    return;
+                }
+                lastBatch = batch;
+                // Woken after the end of the batch
+                if (jobs == nullptr) { continue; }
+                batchJobs = jobs;
+                batchSlots = slots;
+                activeWorkers += 1;
+            }
+            execute(*batchJobs, *batchSlots);
+            {
+                auto lock = std::lock_guard(mutex);
+                activeWorkers -= 1;
+            }
+            batchDone.notify_one();
+        }
+    }
+
+    void RecordingScheduler::execute(const std::vector<Job>& batchJobs, std::vector<Slot>& batchSlots) {
+        for (auto i = nextJob.fetch_add(1); i < batchJobs.size(); i = nextJob.fetch_add(1)) {
+            const auto& slot = batchSlots[i];
+            try {
+                slot.commandAllocator->reset();
+                slot.commandList->begin();
+                batchJobs[i](*slot.commandList);
+                slot.commandList->end();
+            } catch (...) {
+                auto lock = std::lock_guard(mutex);
+                if (!exception) {
+                    exception = std::current_exception();
+                }
+            }
+        }
+    }
+
+}
@@ -0,0 +1,96 @@
+/*
+* Copyright (c) 2025-present Henri Michelon
+*
+* This software is released under the MIT License.
+* https://opensource.org/licenses/MIT
+*/
+export module lysa.renderers.recording_scheduler;
+
+import vireo;
+import lysa.math;
+
+export namespace lysa {
+
+    /**
+     * Records independent parts of a frame in parallel.
+     *
+     * Each job records into its own command list, allocated from its own command allocator
+     * since a command allocator can't be used by two threads at the same time. The jobs are
+     * shared between the worker threads and the calling thread, which waits for all of them.
+     * The command lists are returned in the order of the jobs, whatever the thread which
+     * recorded them, so the submission order does not depend on the scheduling.
+     *
+     * The jobs must only record commands : they run at the same time and must not change the
+     * state of the scene or of the renderer.
+     */
+    class RecordingScheduler {
+    public:
+        /** Recording job, called between the begin() and the end() of its command list */
+        using Job = std::function<void(vireo::CommandList&)>;
+
+        /**
+         * Constructs a scheduler
+         * @param threadsCount Number of recording threads, including the calling thread
+         * @param commandType Type of the command lists
+         */
+        RecordingScheduler(uint32 threadsCount, vireo::CommandType commandType);
+
+        /**
+         * Records the jobs of a frame, one command list per job
+         * @param frameIndex Index of the current frame, the command lists of the frame are reused
+         * @param jobs Jobs to record
+         * @return The command lists, in the order of the jobs
+         */
+        const std::vector<std::shared_ptr<const vireo::CommandList>>& record(
+            uint32 frameIndex,
+            const std::vector<Job>& jobs);
+
+        /**
+         * Returns the number of recording threads, including the calling thread
+         */
+        auto getThreadsCount() const { return static_cast<uint32>(workers.size() + 1); }
+
+        /**
+         * Returns the time spent in the last record(), in milliseconds
+         */
+        auto getRecordingTime() const { return recordingTime; }
+
+        ~RecordingScheduler();
+        RecordingScheduler(RecordingScheduler&) = delete;
+        RecordingScheduler& operator=(RecordingScheduler&) = delete;
+
+    private:
+        struct Slot {
+            std::shared_ptr<vireo::CommandAllocator> commandAllocator;
+            std::shared_ptr<vireo::CommandList> commandList;
+        };
+
+        const vireo::CommandType commandType;
+        /* Command allocators and lists, per frame in flight then per job */
+        std::vector<std::vector<Slot>> framesSlots;
+        /* Command lists of the last record(), in the order of the jobs */
+        std::vector<std::shared_ptr<const vireo::CommandList>> commandLists;
+        double recordingTime{0.0};
+
+        std::vector<std::jthread> workers;
+        std::mutex mutex;
+        /* Signaled when a new batch of jobs is ready */
+        std::condition_variable_any batchReady;
+        /* Signaled when a worker leaves a batch */
+        std::condition_variable batchDone;
+        /* Current batch, jobs is nullptr between two batches */
+        const std::vector<Job>* jobs{nullptr};
+        std::vector<Slot>* slots{nullptr};
+        uint64 batch{0};
+        std::atomic<uint32> nextJob{0};
+        /* Number of workers recording jobs of the current batch */
+        uint32 activeWorkers{0};
+        /* First exception thrown by a job of the current batch */
+        std::exception_ptr exception;
+
+        void work(const std::stop_token& stopToken);
+
+        void execute(const std::vector<Job>& batchJobs, std::vector<Slot>& batchSlots);
+    };
+
+}
@@ -7,8 +7,9 @@
 module lysa.renderers.renderer;
 
 import lysa.exception;
+import lysa.log;
 import lysa.renderers.renderpasses.renderpass;
-import lysa.renderers.renderpasses.shadow_map_pass;
+import lysa.resources.material;
 #ifdef FORWARD_RENDERER
 import lysa.renderers.forward_renderer;
 #endif
@@ -18,6 +19,23 @@ import lysa.renderers.deferred_renderer;
 
 namespace lysa {
 
+    vireo::ResourceState toResourceState(const RenderGraph::State state) {
+        switch (state) {
+        case RenderGraph::State::RENDER_TARGET_COLOR:
+            return vireo::ResourceState::RENDER_TARGET_COLOR;
+        case RenderGraph::State::RENDER_TARGET_DEPTH:
+            return vireo::ResourceState::RENDER_TARGET_DEPTH;
+        case RenderGraph::State::RENDER_TARGET_DEPTH_STENCIL:
+            return vireo::ResourceState::RENDER_TARGET_DEPTH_STENCIL;
+        case RenderGraph::State::SHADER_READ:
+            return vireo::ResourceState::SHADER_READ;
+        case RenderGraph::State::COPY_SRC:
+            return vireo::ResourceState::COPY_SRC;
+        default:
+            return vireo::ResourceState::UNDEFINED;
+        }
+    }
+
     std::unique_ptr<Renderer> Renderer::create(
         const RendererConfiguration& config,
         const vireo::ImageFormat outputFormat) {
@@ -42,6 +60,7 @@ namespace lysa {
             config.depthStencilFormat == vireo::ImageFormat::D24_UNORM_S8_UINT
         ),
         config(config),
+        pipelineCompiler(config.pipelineCompilationThreads),
         depthPrePass(config, withStencil),
         meshManager(ctx().res.get<MeshManager>()),
         shaderMaterialPass(config),
@@ -72,10 +91,24 @@ namespace lysa {
         if (config.bloomEnabled) {
             bloomPass = std::make_unique<BloomPass>(config, outputFormat);
         }
+        if (config.occlusionCullingEnabled) {
+            depthPyramidBuilder = std::make_unique<DepthPyramidBuilder>(config);
+        }
+        // The attachments of the post-processing chain are allocated by the graph
+        if (gammaCorrectionPass) { gammaCorrectionPass->setExternalColorAttachments(true); }
+        if (fxaaPass) { fxaaPass->setExternalColorAttachments(true); }
+        if (smaaPass) { smaaPass->setExternalColorAttachments(true); }
+        if (bloomPass) { bloomPass->setExternalColorAttachments(true); }
         framesData.resize(ctx().config.framesInFlight);
+        graphFramesData.resize(ctx().config.framesInFlight);
     }
 
     void Renderer::update(const uint32 frameIndex) {
+        pipelineCompiler.swap();
+        std::erase_if(retiredFusedPostProcessingPasses, [](auto& retired) {
+            retired.first -= 1;
+            return retired.first == 0;
+        });
         depthPrePass.update(frameIndex);
         if (bloomPass) {
             bloomPass->update(frameIndex);
@@ -83,6 +116,9 @@ namespace lysa {
         for (const auto& postProcessingPass : postProcessingPasses) {
             postProcessingPass->update(frameIndex);
         }
+        for (const auto& fusedPass : activeFusedPostProcessingPasses) {
+            fusedPass->update(frameIndex);
+        }
         if (fxaaPass) {
             fxaaPass->update(frameIndex);
         } else if (smaaPass) {
@@ -97,9 +133,39 @@ namespace lysa {
     }
 
     void Renderer::updatePipelines(const std::unordered_map<pipeline_id, std::vector<unique_id>>& pipelineIds) {
-        depthPrePass.updatePipelines(pipelineIds);
-        shaderMaterialPass.updatePipelines(pipelineIds);
-        transparencyPass.updatePipelines(pipelineIds);
+        const auto& materialManager = ctx().res.get<MaterialManager>();
+        auto materialPipelines = std::vector<MaterialPipeline>{};
+        materialPipelines.reserve(pipelineIds.size());
+        for (const auto& materials : pipelineIds | std::views::values) {
+            materialPipelines.push_back(MaterialPipeline::of(materialManager[materials.at(0)]));
+            usedPipelines.add(materialPipelines.back());
+        }
+        updatePipelines(materialPipelines);
+    }
+
+    void Renderer::updatePipelines(const std::vector<MaterialPipeline>& materialPipelines) {
+        depthPrePass.updatePipelines(materialPipelines, pipelineCompiler);
+        shaderMaterialPass.updatePipelines(materialPipelines, pipelineCompiler);
+        transparencyPass.updatePipelines(materialPipelines, pipelineCompiler);
+    }
+
+    void Renderer::prewarmPipelines(const PipelineManifest& manifest) {
+        const auto statistics = pipelineCompiler.getStatistics();
+        if (statistics.pendingCount == 0) {
+            // Starts a new progress, a prewarm during a prewarm extends it
+            prewarmQueuedCount = statistics.queuedCount;
+        }
+        updatePipelines(manifest.getPipelines());
+    }
+
+    float Renderer::getPrewarmProgress() const {
+        const auto statistics = pipelineCompiler.getStatistics();
+        if (statistics.pendingCount == 0) { return 1.0f; }
+        // The jobs queued before the prewarm are compiled first
+        const auto queued = static_cast<double>(statistics.queuedCount - prewarmQueuedCount);
+        const auto compiled = static_cast<double>(statistics.compiledCount) - static_cast<double>(prewarmQueuedCount);
+        if (queued <= 0.0) { return 0.0f; }
+        return static_cast<float>(std::clamp(compiled / queued, 0.0, 1.0));
     }
 
     void Renderer::prepare(
@@ -108,14 +174,35 @@ namespace lysa {
         const vireo::Viewport& viewport,
         const vireo::Rect& scissors,
         const uint32 frameIndex) {
-        commandList.bindVertexBuffer(meshManager.getVertexBuffer());
-        commandList.bindIndexBuffer(meshManager.getIndexBuffer());
-        for (const auto& shadowMapRenderer : scene.getShadowMapRenderers()) {
-            static_pointer_cast<ShadowMapPass>(shadowMapRenderer)->render(commandList, scene);
-        }
+        bindMeshBuffers(commandList);
+        scene.renderShadowMaps(commandList);
+        renderDepthPrePass(commandList, scene, viewport, scissors, frameIndex);
+    }
+
+    void Renderer::renderDepthPrePass(
+        vireo::CommandList& commandList,
+        const SceneFrameData& scene,
+        const vireo::Viewport& viewport,
+        const vireo::Rect& scissors,
+        const uint32 frameIndex) {
         commandList.setViewport(viewport);
         commandList.setScissors(scissors);
-        depthPrePass.render(commandList, scene, framesData[frameIndex].depthAttachment, frameIndex);
+        const auto& depthAttachment = framesData[frameIndex].depthAttachment;
+        depthPrePass.render(commandList, scene, depthAttachment, frameIndex);
+        if (depthPyramidBuilder && scene.isOcclusionCullingEnabled()) {
+            depthPyramidBuilder->build(commandList, depthAttachment, frameIndex);
+            scene.computeOcclusionCulling(
+                commandList,
+                *depthPyramidBuilder->getPyramid(frameIndex),
+                depthPyramidBuilder->getLayout(),
+                viewport);
+            depthPrePass.renderNewlyVisible(commandList, scene, depthAttachment, frameIndex);
+        }
+    }
+
+    void Renderer::bindMeshBuffers(vireo::CommandList& commandList) const {
+        commandList.bindVertexBuffer(meshManager.getVertexBuffer());
+        commandList.bindIndexBuffer(meshManager.getIndexBuffer());
     }
 
     void Renderer::render(
@@ -125,8 +212,7 @@ namespace lysa {
         const vireo::Rect& scissors,
         const bool clearAttachment,
         const uint32 frameIndex) {
-        commandList.bindVertexBuffer(meshManager.getVertexBuffer());
-        commandList.bindIndexBuffer(meshManager.getIndexBuffer());
+        bindMeshBuffers(commandList);
         commandList.setViewport(viewport);
         commandList.setScissors(scissors);
         colorPass(
@@ -183,6 +269,9 @@ namespace lysa {
                 depthStage);
         }
         depthPrePass.resize(extent, commandList);
+        if (depthPyramidBuilder) {
+            depthPyramidBuilder->resize(extent, commandList);
+        }
         shaderMaterialPass.resize(extent, commandList);
         transparencyPass.resize(extent, commandList);
         if (bloomPass) {
@@ -197,128 +286,388 @@ namespace lysa {
             postProcessingPass->resize(extent);
         }
         gammaCorrectionPass->resize(extent);
+        buildPostProcessingGraph();
     }
 
-     std::shared_ptr<vireo::RenderTarget> Renderer::gammaCorrection(
+    void Renderer::setRenderExtent(const vireo::Extent& extent) {
+        if (bloomPass) {
+            bloomPass->setRenderExtent(extent);
+        }
+        for (const auto& postProcessingPass : postProcessingPasses) {
+            postProcessingPass->setRenderExtent(extent);
+        }
+        for (const auto& fusedPass : activeFusedPostProcessingPasses) {
+            fusedPass->setRenderExtent(extent);
+        }
+        if (fxaaPass) {
+            fxaaPass->setRenderExtent(extent);
+        }
+        gammaCorrectionPass->setRenderExtent(extent);
+    }
+
+    std::shared_ptr<vireo::RenderTarget> Renderer::gammaCorrection(
         vireo::CommandList& commandList,
-        const std::shared_ptr<vireo::RenderTarget>& colorAttachment,
-        const uint32 frameIndex) const {
-        commandList.barrier(
-           colorAttachment,
-           vireo::ResourceState::UNDEFINED,
-           vireo::ResourceState::SHADER_READ);
-        gammaCorrectionPass->render(
+        const uint32 frameIndex) {
+        recordPostProcessingGraph(
             commandList,
-            colorAttachment,
-            nullptr,
-            frameIndex);
-        commandList.barrier(
-           colorAttachment,
-           vireo::ResourceState::SHADER_READ,
-           vireo::ResourceState::UNDEFINED);
-        commandList.barrier(
-           gammaCorrectionPass->getColorAttachment(frameIndex),
-           vireo::ResourceState::SHADER_READ,
-           vireo::ResourceState::UNDEFINED);
-        return gammaCorrectionPass->getColorAttachment(frameIndex);
+            frameIndex,
+            postprocessPassesCount,
+            static_cast<uint32>(compiledPostProcessingGraph->passes.size()));
+        for (const auto& barrier : compiledPostProcessingGraph->finalBarriers) {
+            recordBarrier(commandList, frameIndex, barrier);
+        }
+        return getGraphAttachment(graphOutputAttachment, frameIndex);
     }
 
     void Renderer::postprocess(
         vireo::CommandList& commandList,
-        uint32 frameIndex) {
-        const auto& frame = framesData[frameIndex];
-        commandList.barrier(
-            frame.colorAttachment,
-            vireo::ResourceState::UNDEFINED,
-            vireo::ResourceState::SHADER_READ);
-        auto colorAttachment = frame.colorAttachment;
-        if (bloomPass) {
-            bloomPass->render(
-                commandList,
-                colorAttachment,
-                getBloomColorAttachment(frameIndex),
-                frameIndex);
-            colorAttachment = bloomPass->getColorAttachment(frameIndex);
+        const uint32 frameIndex) {
+        recordPostProcessingGraph(commandList, frameIndex, 0, postprocessPassesCount);
+    }
+
+    void Renderer::recordPostProcessingGraph(
+        vireo::CommandList& commandList,
+        const uint32 frameIndex,
+        const uint32 first,
+        const uint32 last) {
+        const auto& passes = compiledPostProcessingGraph->passes;
+        for (auto i = first; i < last; i++) {
+            for (const auto& barrier : passes[i].barriers) {
+                recordBarrier(commandList, frameIndex, barrier);
+            }
+            const auto& record = postProcessingGraphPasses[passes[i].pass];
+            if (record) {
+                record(commandList, frameIndex);
+            }
         }
-        if (!postProcessingPasses.empty()) {
-            const auto depthStage =
-               config.depthStencilFormat == vireo::ImageFormat::D32_SFLOAT_S8_UINT ||
-               config.depthStencilFormat == vireo::ImageFormat::D24_UNORM_S8_UINT   ?
-               vireo::ResourceState::RENDER_TARGET_DEPTH_STENCIL :
-               vireo::ResourceState::RENDER_TARGET_DEPTH;
+    }
+
+    void Renderer::recordBarrier(
+        vireo::CommandList& commandList,
+        const uint32 frameIndex,
+        const RenderGraph::Barrier& barrier) {
+        auto before = barrier.before;
+        const auto slot = compiledPostProcessingGraph->attachmentSlots[barrier.attachment];
+        if (slot != RenderGraph::INVALID_INDEX) {
+            auto& state = graphFramesData[frameIndex].states[slot];
+            // New or reused render targets are not in the state of the end of the previous frame
+            if (barrier.first) {
+                before = state;
+            }
+            state = barrier.after;
+        }
+        if (before != barrier.after) {
             commandList.barrier(
-               frame.depthAttachment,
-               depthStage,
-               vireo::ResourceState::SHADER_READ);
-            std::ranges::for_each(postProcessingPasses, [&](auto* postProcessingPass) {
-                postProcessingPass->render(
-                    commandList,
-                    colorAttachment,
-                    frame.depthAttachment,
-                    frameIndex);
-                colorAttachment = postProcessingPass->getColorAttachment(frameIndex);
+                getGraphAttachment(barrier.attachment, frameIndex),
+                toResourceState(before),
+                toResourceState(barrier.after));
+        }
+    }
+
+    std::shared_ptr<vireo::RenderTarget> Renderer::getGraphAttachment(
+        const uint32 attachment,
+        const uint32 frameIndex) const {
+        const auto slot = compiledPostProcessingGraph->attachmentSlots[attachment];
+        if (slot != RenderGraph::INVALID_INDEX) {
+            return graphFramesData[frameIndex].attachments[slot];
+        }
+        if (attachment == graphDepthAttachment) {
+            return framesData[frameIndex].depthAttachment;
+        }
+        if (attachment == graphBloomAttachment) {
+            return getBloomColorAttachment(frameIndex);
+        }
+        return framesData[frameIndex].colorAttachment;
+    }
+
+    void Renderer::buildPostProcessingGraph() {
+        auto& graph = postProcessingGraph;
+        graph.clear();
+        postProcessingGraphPasses.clear();
+        const auto depthState = withStencil ?
+            RenderGraph::State::RENDER_TARGET_DEPTH_STENCIL :
+            RenderGraph::State::RENDER_TARGET_DEPTH;
+        const auto addAttachment = [&](
+            const std::string& name,
+            const vireo::ImageFormat format,
+            const vireo::MSAA msaa) {
+            return graph.addAttachment({
+                .name = name,
+                .format = static_cast<uint32>(format),
+                .msaa = static_cast<uint32>(msaa),
+                .width = currentExtent.width,
+                .height = currentExtent.height,
+                .pixelSize = vireo::Image::getPixelSize(format),
             });
-            commandList.barrier(
-               frame.depthAttachment,
-               vireo::ResourceState::SHADER_READ,
-               depthStage);
-            std::ranges::for_each(postProcessingPasses, [&](const auto& postProcessingPass) {
-                commandList.barrier(
-                    postProcessingPass->getColorAttachment(frameIndex),
-                    vireo::ResourceState::SHADER_READ,
-                    vireo::ResourceState::UNDEFINED);
+        };
+        const auto addPass = [&](
+            const std::string& name,
+            const bool sideEffects,
+            const std::function<void(vireo::CommandList&, uint32)>& record) {
+            postProcessingGraphPasses.push_back(record);
+            return graph.addPass(name, sideEffects);
+        };
+
+        // The color and depth attachments rest in the UNDEFINED and depth states between the stages
+        graphColorAttachment = graph.addAttachment({
+            .name = "Main color attachment",
+            .imported = true,
+        });
+        graphDepthAttachment = graph.addAttachment({
+            .name = "Main depth stencil attachment",
+            .imported = true,
+            .initialState = depthState,
+            .finalState = depthState,
+        });
+        graphBloomAttachment = RenderGraph::INVALID_INDEX;
+        auto current = graphColorAttachment;
+        auto blur = RenderGraph::INVALID_INDEX;
+
+        if (bloomPass) {
+            graphBloomAttachment = graph.addAttachment({
+                .name = "Bloom color attachment",
+                .imported = true,
+                .initialState = RenderGraph::State::SHADER_READ,
+                .finalState = RenderGraph::State::SHADER_READ,
+            });
+            blur = addAttachment("Bloom blur", bloomPass->getMipChainPass().getOutputFormat(), config.msaa);
+            const auto pass = addPass("Bloom blur", false, [this, blur](vireo::CommandList& commandList, const uint32 frameIndex) {
+                auto& mipChainPass = bloomPass->getMipChainPass();
+                mipChainPass.setColorAttachment(frameIndex, getGraphAttachment(blur, frameIndex));
+                mipChainPass.render(commandList, getBloomColorAttachment(frameIndex), frameIndex);
             });
+            graph.read(pass, graphBloomAttachment);
+            graph.write(pass, blur);
         }
+
+        // The bloom composite and the user passes, the consecutive fusible ones in one pass.
+        // The gamma correction and tone mapping pass is never fused with them : it runs after the
+        // overlay, the vector renderers drawing in linear colors between the two.
+        auto stages = std::vector<PostProcessing*>{};
+        if (bloomPass) {
+            stages.push_back(bloomPass.get());
+        }
+        stages.insert(stages.end(), postProcessingPasses.begin(), postProcessingPasses.end());
+        activeFusedPostProcessingPasses.clear();
+        for (auto first = 0; first < stages.size();) {
+            auto last = first + 1;
+            if (config.postProcessingFusionEnabled && FusedPostProcessing::isFusible(*stages[first])) {
+                while (last < stages.size() &&
+                       last - first < FusedPostProcessing::MAX_STAGES &&
+                       FusedPostProcessing::isFusible(*stages[last])) {
+                    last += 1;
+                }
+            }
+            const auto withBloom = stages[first] == bloomPass.get();
+            if (last - first > 1) {
+                const auto fusedStages = std::vector<PostProcessing*>{stages.begin() + first, stages.begin() + last};
+                auto* fusedPass = getFusedPostProcessing(fusedStages);
+                activeFusedPostProcessingPasses.push_back(fusedPass);
+                const auto name = FusedPostProcessing::getName(fusedStages);
+                const auto bloom = withBloom ? blur : RenderGraph::INVALID_INDEX;
+                const auto output = addAttachment(name, fusedPass->getOutputFormat(), config.msaa);
+                const auto pass = addPass(
+                    name,
+                    false,
+                    [this, fusedPass, current, output, bloom](vireo::CommandList& commandList, const uint32 frameIndex) {
+                        fusedPass->setColorAttachment(frameIndex, getGraphAttachment(output, frameIndex));
+                        fusedPass->render(
+                            commandList,
+                            getGraphAttachment(current, frameIndex),
+                            framesData[frameIndex].depthAttachment,
+                            bloom == RenderGraph::INVALID_INDEX ? nullptr : getGraphAttachment(bloom, frameIndex),
+                            frameIndex);
+                    });
+                graph.read(pass, current);
+                graph.read(pass, graphDepthAttachment);
+                if (withBloom) {
+                    graph.read(pass, bloom);
+                }
+                graph.write(pass, output);
+                current = output;
+            } else if (withBloom) {
+                const auto bloom = addAttachment("Bloom", bloomPass->getOutputFormat(), config.msaa);
+                const auto pass = addPass("Bloom", false, [this, current, bloom](vireo::CommandList& commandList, const uint32 frameIndex) {
+                    bloomPass->setColorAttachment(frameIndex, getGraphAttachment(bloom, frameIndex));
+                    bloomPass->renderBloom(commandList, getGraphAttachment(current, frameIndex), frameIndex);
+                });
+                graph.read(pass, current);
+                graph.read(pass, blur);
+                graph.write(pass, bloom);
+                current = bloom;
+            } else {
+                auto* postProcessingPass = stages[first];
+                const auto output = addAttachment(
+                    postProcessingPass->getFragShaderName(),
+                    postProcessingPass->getOutputFormat(),
+                    config.msaa);
+                const auto pass = addPass(
+                    postProcessingPass->getFragShaderName(),
+                    false,
+                    [this, postProcessingPass, current, output](vireo::CommandList& commandList, const uint32 frameIndex) {
+                        postProcessingPass->setColorAttachment(frameIndex, getGraphAttachment(output, frameIndex));
+                        postProcessingPass->render(
+                            commandList,
+                            getGraphAttachment(current, frameIndex),
+                            framesData[frameIndex].depthAttachment,
+                            frameIndex);
+                    });
+                graph.read(pass, current);
+                graph.read(pass, graphDepthAttachment);
+                graph.write(pass, output);
+                current = output;
+            }
+            first = last;
+        }
+
         if (fxaaPass) {
-            fxaaPass->render(
-                commandList,
-                colorAttachment,
-                frame.depthAttachment,
-                frameIndex);
-            commandList.barrier(
-                fxaaPass->getColorAttachment(frameIndex),
-               vireo::ResourceState::SHADER_READ,
-               vireo::ResourceState::UNDEFINED);
+            const auto output = addAttachment("FXAA", fxaaPass->getOutputFormat(), config.msaa);
+            const auto pass = addPass("FXAA", false, [this, current, output](vireo::CommandList& commandList, const uint32 frameIndex) {
+                fxaaPass->setColorAttachment(frameIndex, getGraphAttachment(output, frameIndex));
+                fxaaPass->render(commandList, getGraphAttachment(current, frameIndex), nullptr, frameIndex);
+            });
+            graph.read(pass, current);
+            graph.write(pass, output);
+            current = output;
         } else if (smaaPass) {
-            smaaPass->render(
-                commandList,
-                colorAttachment,
-                frameIndex);
-            commandList.barrier(
-                smaaPass->getColorAttachment(frameIndex),
-               vireo::ResourceState::SHADER_READ,
-               vireo::ResourceState::UNDEFINED);
+            const auto output = addAttachment("SMAA Color", smaaPass->getOutputFormat(), vireo::MSAA::NONE);
+            const auto pass = addPass("SMAA", false, [this, current, output](vireo::CommandList& commandList, const uint32 frameIndex) {
+                smaaPass->setColorAttachment(frameIndex, getGraphAttachment(output, frameIndex));
+                smaaPass->render(commandList, getGraphAttachment(current, frameIndex), frameIndex);
+            });
+            graph.read(pass, current);
+            graph.write(pass, output);
+            current = output;
         }
-        commandList.barrier(
-            frame.colorAttachment,
-            vireo::ResourceState::SHADER_READ,
-            vireo::ResourceState::UNDEFINED);
-    }
 
-    std::shared_ptr<vireo::RenderTarget> Renderer::getCurrentColorAttachment(const uint32 frameIndex) const {
-        if (fxaaPass) {
-            return fxaaPass->getColorAttachment(frameIndex);
+        // The vectors renderers draw in the current color attachment between postprocess() and gammaCorrection()
+        const auto overlayPass = addPass("Overlay", true, {});
+        graph.read(overlayPass, current, RenderGraph::State::UNDEFINED);
+        graph.write(overlayPass, current, RenderGraph::State::UNDEFINED);
+        graph.read(overlayPass, graphDepthAttachment, depthState);
+        graphCurrentAttachment = current;
+
+        if (gammaCorrectionPass) {
+            const auto output = addAttachment("Gamma correction", gammaCorrectionPass->getOutputFormat(), config.msaa);
+            const auto pass = addPass("Gamma correction", false, [this, current, output](vireo::CommandList& commandList, const uint32 frameIndex) {
+                gammaCorrectionPass->setColorAttachment(frameIndex, getGraphAttachment(output, frameIndex));
+                gammaCorrectionPass->render(commandList, getGraphAttachment(current, frameIndex), nullptr, frameIndex);
+            });
+            graph.read(pass, current);
+            graph.write(pass, output);
+            current = output;
+        }
+        graphOutputAttachment = current;
+        graph.addOutput(graphOutputAttachment);
+
+        // The fused passes of the previous effects list are destroyed once the frames in flight completed
+        for (auto it = fusedPostProcessingPasses.begin(); it != fusedPostProcessingPasses.end();) {
+            if (std::ranges::find(activeFusedPostProcessingPasses, it->second.get()) == activeFusedPostProcessingPasses.end()) {
+                retiredFusedPostProcessingPasses.push_back({ctx().config.framesInFlight, std::move(it->second)});
+                it = fusedPostProcessingPasses.erase(it);
+            } else {
+                ++it;
+            }
+        }
+
+        const auto& compiled = graph.compile();
+        compiledPostProcessingGraph = &compiled;
+        postprocessPassesCount = 0;
+        while (compiled.passes[postprocessPassesCount].pass != overlayPass) {
+            postprocessPassesCount += 1;
         }
-        if (smaaPass) {
-            return smaaPass->getColorAttachment(frameIndex);
+        postprocessPassesCount += 1;
+
+        // Allocates the physical attachments, reusing the render targets of the previous graph
+        // with the same description since the previous frames may still use them
+        auto slots = std::vector<RenderGraph::Attachment>{};
+        for (const auto attachment : compiled.slots) {
+            slots.push_back(graph.getAttachments()[attachment]);
         }
-        if (postProcessingPasses.empty()) {
-            if (bloomPass) {
-                return bloomPass->getColorAttachment(frameIndex);
+        for (auto& frame : graphFramesData) {
+            auto previous = std::move(frame.attachments);
+            auto previousStates = std::move(frame.states);
+            frame.attachments.clear();
+            frame.states.clear();
+            for (const auto& slot : slots) {
+                auto renderTarget = std::shared_ptr<vireo::RenderTarget>{};
+                auto state = RenderGraph::State::UNDEFINED;
+                for (auto i = 0; i < previous.size(); i++) {
+                    const auto& previousSlot = postProcessingGraphSlots[i];
+                    if (previous[i] &&
+                        previousSlot.format == slot.format &&
+                        previousSlot.msaa == slot.msaa &&
+                        previousSlot.width == slot.width &&
+                        previousSlot.height == slot.height) {
+                        renderTarget = std::move(previous[i]);
+                        state = previousStates[i];
+                        break;
+                    }
+                }
+                if (!renderTarget) {
+                    renderTarget = ctx().vireo->createRenderTarget(
+                        static_cast<vireo::ImageFormat>(slot.format),
+                        slot.width, slot.height,
+                        vireo::RenderTargetType::COLOR,
+                        {},
+                        1,
+                        static_cast<vireo::MSAA>(slot.msaa),
+                        slot.name);
+                }
+                frame.attachments.push_back(renderTarget);
+                frame.states.push_back(state);
             }
-            return framesData[frameIndex].colorAttachment;
         }
-        return postProcessingPasses.back()->getColorAttachment(frameIndex);
+        postProcessingGraphSlots = std::move(slots);
+
+        const auto& report = compiled.report;
+        Log::info("Post-processing attachments : ",
+            report.transientCount, " aliased on ", report.physicalCount, ", ",
+            report.transientSize / (1024 * 1024), "MB -> ",
+            report.aliasedSize / (1024 * 1024), "MB per frame");
+    }
+
+    FusedPostProcessing* Renderer::getFusedPostProcessing(const std::vector<PostProcessing*>& passes) {
+        // The identifiers are never reused : a pass removed then another one allocated at the same
+        // address gives another key
+        auto key = std::vector<uint32>{};
+        for (const auto* pass : passes) {
+            key.push_back(pass->getId());
+        }
+        auto& fusedPass = fusedPostProcessingPasses[key];
+        if (!fusedPass) {
+            fusedPass = std::make_unique<FusedPostProcessing>(config, passes);
+            fusedPass->setExternalColorAttachments(true);
+        }
+        fusedPass->resize(currentExtent);
+        return fusedPass.get();
+    }
+
+    std::shared_ptr<vireo::RenderTarget> Renderer::getCurrentColorAttachment(const uint32 frameIndex) const {
+        return getGraphAttachment(graphCurrentAttachment, frameIndex);
     }
 
     void Renderer::addPostprocessing(PostProcessing& postProcessingPass) {
+        postProcessingPass.setExternalColorAttachments(true);
         postProcessingPass.resize(currentExtent);
         postProcessingPasses.push_back(&postProcessingPass);
+        if (currentExtent.width > 0 && currentExtent.height > 0) {
+            buildPostProcessingGraph();
+        }
     }
 
     void Renderer::removePostprocessing(const std::string& fragShaderName) {
-        std::erase_if(postProcessingPasses, [&fragShaderName](const PostProcessing* item) {
-            return item->getFragShaderName() == fragShaderName;
+        std::erase_if(postProcessingPasses, [&](PostProcessing* item) {
+            if (item->getFragShaderName() == fragShaderName) {
+                // The pass allocates its attachments again
+                item->setExternalColorAttachments(false);
+                item->resize(currentExtent);
+                return true;
+            }
+            return false;
         });
+        if (currentExtent.width > 0 && currentExtent.height > 0) {
+            buildPostProcessingGraph();
+        }
     }
 }
\ No newline at end of file
@@ -10,11 +10,16 @@ import vireo;
 
 import lysa.context;
 import lysa.math;
+import lysa.render_graph;
 import lysa.renderers.configuration;
 import lysa.renderers.graphic_pipeline_data;
+import lysa.renderers.pipeline_compiler;
+import lysa.renderers.pipeline_manifest;
+import lysa.renderers.pipelines.depth_pyramid_builder;
 import lysa.renderers.scene_frame_data;
 import lysa.renderers.renderpasses.bloom_pass;
 import lysa.renderers.renderpasses.depth_prepass;
+import lysa.renderers.renderpasses.fused_post_processing;
 import lysa.renderers.renderpasses.fxaa_pass;
 import lysa.renderers.renderpasses.gamma_correction_pass;
 import lysa.renderers.renderpasses.post_processing;
@@ -32,6 +37,8 @@ export namespace lysa {
      *    (depth pre-pass, opaque/transparent color, shader-material passes, SMAA,
      *    bloom and other post-processing).
      *  - Allocate per-frame color/depth attachments and expose them to callers.
+     *  - Record the post-processing chain from a RenderGraph : the attachments of the
+     *    post-processing passes are aliased and their barriers computed by the graph.
      *  - Update and (re)build graphics pipelines when the set of materials changes.
      */
     class Renderer {
@@ -66,6 +73,14 @@ export namespace lysa {
          */
         virtual void resize(const vireo::Extent& extent, const std::shared_ptr<vireo::CommandList>& commandList);
 
+        /**
+         * Sets the rendered part of the attachments, from the top left corner, see DynamicResolution.
+         * The attachments keep their extent, the viewports of the views are scaled by the caller
+         * and the screen space passes only read and write the rendered part.
+         * @param extent Extent of the rendered part, at most the extent of the attachments
+         */
+        virtual void setRenderExtent(const vireo::Extent& extent);
+
         /**
          * Updates graphics pipelines according to the Scene material mapping.
          * Convenience overload that pulls mapping from the Scene.
@@ -74,13 +89,45 @@ export namespace lysa {
 
         /**
          * Updates graphics pipelines according to the provided materials mapping.
+         * The pipelines are added to the used pipelines, see getUsedPipelines().
          * @param pipelineIds Map of pipeline family id to materials.
          */
-        virtual void updatePipelines(const std::unordered_map<pipeline_id, std::vector<unique_id>>& pipelineIds);
+        void updatePipelines(const std::unordered_map<pipeline_id, std::vector<unique_id>>& pipelineIds);
+
+        /**
+         * Updates graphics pipelines according to the material flags of the pipeline ids.
+         * @param materialPipelines Material flags of the pipeline ids.
+         */
+        virtual void updatePipelines(const std::vector<MaterialPipeline>& materialPipelines);
 
-        /** Performs per-frame housekeeping (e.g., pass-local data updates). */
+        /**
+         * Queues the compilation of the pipelines of a manifest in all the passes,
+         * before the first use of their materials.
+         * @param manifest Pipelines to compile, see PipelineManifest::load().
+         */
+        void prewarmPipelines(const PipelineManifest& manifest);
+
+        /**
+         * Returns the progress of the pipelines compilation started by prewarmPipelines(),
+         * from 0.0 to 1.0 once all the queued pipelines are compiled.
+         */
+        float getPrewarmProgress() const;
+
+        /**
+         * Returns the pipelines used by the scenes since the creation of the renderer,
+         * to save as the manifest of a recording run.
+         */
+        const auto& getUsedPipelines() const { return usedPipelines; }
+
+        /**
+         * Performs per-frame housekeeping (e.g., pass-local data updates).
+         * Adds the pipelines compiled since the previous frame to the passes.
+         */
         virtual void update(uint32 frameIndex);
 
+        /** Returns the counters of the pipelines compilation, updated each frame by update(). */
+        auto getPipelineCompilerStatistics() const { return pipelineCompiler.getStatistics(); }
+
         /** Pre-render stage: uploads, layout transitions, depth pre pass and shadow maps. */
         void prepare(
             vireo::CommandList& commandList,
@@ -89,6 +136,20 @@ export namespace lysa {
             const vireo::Rect& scissors,
             uint32 frameIndex);
 
+        /**
+         * Pre-render stage without the shadow maps : depth pre pass and occlusion culling.
+         * The mesh buffers must be bound, see bindMeshBuffers().
+         */
+        void renderDepthPrePass(
+            vireo::CommandList& commandList,
+            const SceneFrameData& scene,
+            const vireo::Viewport& viewport,
+            const vireo::Rect& scissors,
+            uint32 frameIndex);
+
+        /** Binds the vertex and index buffers of the meshes. */
+        void bindMeshBuffers(vireo::CommandList& commandList) const;
+
         /** Main render stage: records opaque/transparent draw calls. */
         void render(
             vireo::CommandList& commandList,
@@ -98,13 +159,18 @@ export namespace lysa {
             bool clearAttachment,
             uint32 frameIndex);
 
-        /** Applies gamme correction, must be called at the end of the rendering path */
-         std::shared_ptr<vireo::RenderTarget> gammaCorrection(
+        /**
+         * Applies gamme correction to the current color attachment, must be called at the end of the rendering path.
+         * @return The final color attachment, in the UNDEFINED state
+         */
+        std::shared_ptr<vireo::RenderTarget> gammaCorrection(
             vireo::CommandList& commandList,
-            const std::shared_ptr<vireo::RenderTarget>& colorAttachment,
-            uint32 frameIndex) const;
+            uint32 frameIndex);
 
-        /** Applies post-processing chain (SMAA, bloom, custom passes). */
+        /**
+         * Applies post-processing chain (SMAA, bloom, custom passes).
+         * The current color attachment is then in the UNDEFINED state until gammaCorrection().
+         */
         void postprocess(
             vireo::CommandList& commandList,
             uint32 frameIndex);
@@ -128,6 +194,11 @@ export namespace lysa {
 
         const auto& getExtent() const { return currentExtent; }
 
+        /** Returns the memory used by the post-processing attachments of one frame, before and after aliasing. */
+        RenderGraph::MemoryReport getPostProcessingMemoryReport() const {
+            return compiledPostProcessingGraph ? compiledPostProcessingGraph->report : RenderGraph::MemoryReport{};
+        }
+
         virtual ~Renderer() = default;
         Renderer(Renderer&) = delete;
         Renderer& operator=(Renderer&) = delete;
@@ -142,8 +213,16 @@ export namespace lysa {
         const bool withStencil;
         const RendererConfiguration config;
         std::vector<FrameData> framesData;
+        // Compiles the pipelines of the materials, destroyed after the passes
+        PipelineCompiler pipelineCompiler;
+        // Pipelines used by the scenes, see getUsedPipelines()
+        PipelineManifest usedPipelines;
+        // Number of pipelines queued before the current prewarm, see getPrewarmProgress()
+        uint64 prewarmQueuedCount{0};
         // Depth-only pre-pass used by both forward and deferred renderers
         DepthPrepass depthPrePass;
+        // Hierarchical depth buffer of the depth pre-pass, for the occlusion culling
+        std::unique_ptr<DepthPyramidBuilder> depthPyramidBuilder;
 
         Renderer(
             const RendererConfiguration& config,
@@ -174,5 +253,51 @@ export namespace lysa {
         std::unique_ptr<PostProcessing> gammaCorrectionPass;
         /* List of active post-processing passes applied after color and bloom pass, but before AA pass. */
         std::list<PostProcessing*> postProcessingPasses;
+        /* Fused post-processing passes by identifiers of the fused passes, the ones used by the graph. */
+        std::map<std::vector<uint32>, std::unique_ptr<FusedPostProcessing>> fusedPostProcessingPasses;
+        /* Fused post-processing passes removed from the graph and number of frames before their destruction,
+         * the previous frames may still use them. */
+        std::vector<std::pair<uint32, std::unique_ptr<FusedPostProcessing>>> retiredFusedPostProcessingPasses;
+        /* Fused post-processing passes used by the post-processing graph. */
+        std::vector<FusedPostProcessing*> activeFusedPostProcessingPasses;
+
+        // Physical attachments of the post-processing graph for a frame
+        struct GraphFrameData {
+            std::vector<std::shared_ptr<vireo::RenderTarget>> attachments;
+            // Current state of each physical attachment
+            std::vector<RenderGraph::State> states;
+        };
+
+        // Post-processing chain, from the color attachment to the gamma correction
+        RenderGraph postProcessingGraph;
+        const RenderGraph::Compiled* compiledPostProcessingGraph{nullptr};
+        // Recording function of each pass of the graph
+        std::vector<std::function<void(vireo::CommandList&, uint32)>> postProcessingGraphPasses;
+        // Descriptions of the physical attachments
+        std::vector<RenderGraph::Attachment> postProcessingGraphSlots;
+        std::vector<GraphFrameData> graphFramesData;
+        // Imported attachments
+        uint32 graphColorAttachment{RenderGraph::INVALID_INDEX};
+        uint32 graphDepthAttachment{RenderGraph::INVALID_INDEX};
+        uint32 graphBloomAttachment{RenderGraph::INVALID_INDEX};
+        // Output of the post-processing passes, input of the gamma correction
+        uint32 graphCurrentAttachment{RenderGraph::INVALID_INDEX};
+        // Output of the gamma correction
+        uint32 graphOutputAttachment{RenderGraph::INVALID_INDEX};
+        // Number of compiled passes recorded by postprocess(), the next ones are recorded by gammaCorrection()
+        uint32 postprocessPassesCount{0};
+
+        // Declares and compiles the post-processing graph, called when the passes or the extent change
+        void buildPostProcessingGraph();
+
+        // Returns the fused pass of some consecutive fusible passes, created on first use
+        FusedPostProcessing* getFusedPostProcessing(const std::vector<PostProcessing*>& passes);
+
+        // Records a range of compiled passes of the post-processing graph
+        void recordPostProcessingGraph(vireo::CommandList& commandList, uint32 frameIndex, uint32 first, uint32 last);
+
+        void recordBarrier(vireo::CommandList& commandList, uint32 frameIndex, const RenderGraph::Barrier& barrier);
+
+        std::shared_ptr<vireo::RenderTarget> getGraphAttachment(uint32 attachment, uint32 frameIndex) const;
     };
 }
@@ -7,9 +7,9 @@
 module lysa.renderers.scene_frame_data;
 
 import lysa.exception;
+import lysa.frustum;
 import lysa.log;
 import lysa.math;
-import lysa.resources.image;
 import lysa.renderers.renderpasses.shadow_map_pass;
 
 namespace lysa {
@@ -18,15 +18,16 @@ namespace lysa {
         sceneDescriptorLayout = ctx().vireo->createDescriptorLayout("Scene");
         sceneDescriptorLayout->add(BINDING_SCENE, vireo::DescriptorType::UNIFORM);
         sceneDescriptorLayout->add(BINDING_MODELS, vireo::DescriptorType::DEVICE_STORAGE);
-        sceneDescriptorLayout->add(BINDING_LIGHTS, vireo::DescriptorType::UNIFORM);
-        sceneDescriptorLayout->add(BINDING_SHADOW_MAPS, vireo::DescriptorType::SAMPLED_IMAGE,
-            ctx().config.maxShadowMapsPerScene * 6);
+        sceneDescriptorLayout->add(BINDING_LIGHTS, vireo::DescriptorType::DEVICE_STORAGE);
+        sceneDescriptorLayout->add(BINDING_SHADOW_ATLAS, vireo::DescriptorType::SAMPLED_IMAGE);
+        sceneDescriptorLayout->add(BINDING_LIGHT_CLUSTERS, vireo::DescriptorType::DEVICE_STORAGE);
+        sceneDescriptorLayout->add(BINDING_SHADOWS, vireo::DescriptorType::DEVICE_STORAGE);
         sceneDescriptorLayout->build();
 
 #ifdef SHADOW_TRANSPARENCY_COLOR_ENABLED
         sceneDescriptorLayoutOptional1 = ctx().vireo->createDescriptorLayout("Scene opt1");
-        sceneDescriptorLayoutOptional1->add(BINDING_SHADOW_MAP_TRANSPARENCY_COLOR,
-            vireo::DescriptorType::SAMPLED_IMAGE, ctx().config.maxShadowMapsPerScene * 6);
+        sceneDescriptorLayoutOptional1->add(BINDING_SHADOW_ATLAS_TRANSPARENCY_COLOR,
+            vireo::DescriptorType::SAMPLED_IMAGE);
         sceneDescriptorLayoutOptional1->build();
 #endif
 
@@ -42,85 +43,382 @@ namespace lysa {
     }
 
     SceneFrameData::SceneFrameData(
+        SceneSharedData& sharedData,
         const uint32 maxLights,
-        const uint32 maxMeshInstancesPerScene,
-        const uint32 maxMeshSurfacePerPipeline) :
-        lightsBuffer{ctx().vireo->createBuffer(
-            vireo::BufferType::UNIFORM,
-            sizeof(LightData),
-            1,
-            "lights")},
-        meshInstancesDataArray{ctx().vireo,
-            sizeof(MeshInstanceData),
-            maxMeshInstancesPerScene,
-            maxMeshInstancesPerScene,
-            vireo::BufferType::DEVICE_STORAGE,
-            "meshInstancesData"},
+        const BufferCapacityConfiguration& lightsCapacity) :
+        sharedData(sharedData),
         sceneUniformBuffer{ctx().vireo->createBuffer(
             vireo::BufferType::UNIFORM,
             sizeof(SceneData), 1,
             "sceneUniform")},
-        maxMeshSurfacePerPipeline(maxMeshSurfacePerPipeline),
-        maxLights(maxLights),
-        materialManager(ctx().res.get<MaterialManager>()) {
-        const auto blankImage = ctx().res.get<ImageManager>().getBlankImage();
-
-        shadowMaps.resize(ctx().config.maxShadowMapsPerScene * 6);
-        for (int i = 0; i < shadowMaps.size(); i++) {
-            shadowMaps[i] = blankImage;
-        }
+        shadowAtlasAllocator(ctx().config.shadowAtlasSize, ctx().config.shadowAtlasMinTileSize),
+        lightsCapacity{maxLights, lightsCapacity},
+        shadowsDataArray{ctx().vireo,
+            sizeof(ShadowData),
+            ctx().config.maxShadowMapsPerScene,
+            ctx().config.maxShadowMapsPerScene,
+            vireo::BufferType::DEVICE_STORAGE,
+            "shadowsData"} {
+        this->lightsCapacity.update(0);
+        lightsDataArray = std::make_unique<DeviceMemoryArray>(
+            ctx().vireo,
+            sizeof(LightData),
+            this->lightsCapacity.get(),
+            this->lightsCapacity.get(),
+            vireo::BufferType::DEVICE_STORAGE,
+            "lightsData");
+        const auto atlasSize = shadowAtlasAllocator.getSize();
+        shadowAtlas = ctx().vireo->createRenderTarget(
+            SHADOW_ATLAS_FORMAT,
+            atlasSize, atlasSize,
+            vireo::RenderTargetType::DEPTH,
+            { .depthStencil = { .depth = 1.0f, .stencil = 0 } },
+            1,
+            vireo::MSAA::NONE,
+            "shadowAtlas");
         descriptorSet = ctx().vireo->createDescriptorSet(sceneDescriptorLayout, "Scene");
         descriptorSet->update(BINDING_SCENE, sceneUniformBuffer);
-        descriptorSet->update(BINDING_MODELS, meshInstancesDataArray.getBuffer());
-        descriptorSet->update(BINDING_LIGHTS, lightsBuffer);
-        descriptorSet->update(BINDING_SHADOW_MAPS, shadowMaps);
+        descriptorSet->update(BINDING_MODELS, sharedData.getMeshInstancesDataArray().getBuffer());
+        descriptorSet->update(BINDING_LIGHTS, lightsDataArray->getBuffer());
+        descriptorSet->update(BINDING_SHADOW_ATLAS, shadowAtlas->getImage());
+        lightClustering = std::make_unique<LightClustering>("lightClusters");
+        descriptorSet->update(BINDING_LIGHT_CLUSTERS, lightClustering->getClustersBuffer());
+        descriptorSet->update(BINDING_SHADOWS, shadowsDataArray.getBuffer());
 
 #ifdef SHADOW_TRANSPARENCY_COLOR_ENABLED
-        shadowTransparencyColorMaps.resize(ctx().config.maxShadowMapsPerScene * 6);
-        for (int i = 0; i < shadowMaps.size(); i++) {
-            shadowMaps[i] = blankImage;
-            shadowTransparencyColorMaps[i] = blankImage;
-        }
+        shadowTransparencyColorAtlas = ctx().vireo->createRenderTarget(
+            SHADOW_ATLAS_TRANSPARENCY_COLOR_FORMAT,
+            atlasSize, atlasSize,
+            vireo::RenderTargetType::COLOR,
+            {0.0f, 0.0f, 0.0f, 1.0f},
+            1,
+            vireo::MSAA::NONE,
+            "shadowTransparencyColorAtlas");
         descriptorSetOpt1 = ctx().vireo->createDescriptorSet(sceneDescriptorLayoutOptional1, "Scene Opt1");
-        descriptorSetOpt1->update(BINDING_SHADOW_MAP_TRANSPARENCY_COLOR, shadowTransparencyColorMaps);
+        descriptorSetOpt1->update(BINDING_SHADOW_ATLAS_TRANSPARENCY_COLOR, shadowTransparencyColorAtlas->getImage());
 #endif
 
         sceneUniformBuffer->map();
-        lightsBuffer->map();
+        cullingTelemetry = std::make_unique<GpuTelemetry>(CullingStatistics::COUNT, "cullingTelemetry");
+
+        // The camera and up to six views per shadow map
+        const auto maxCullingViews = 1 + ctx().config.maxShadowMapsPerScene * 6;
+        cullingViews.reserve(maxCullingViews);
+        cullingViewsBuffer = ctx().vireo->createBuffer(
+            vireo::BufferType::DEVICE_STORAGE,
+            sizeof(CullingView) * maxCullingViews,
+            1,
+            "cullingViews");
+        cullingViewsStagingBuffer = ctx().vireo->createBuffer(
+            vireo::BufferType::BUFFER_UPLOAD,
+            sizeof(CullingView) * maxCullingViews,
+            1,
+            "cullingViewsStaging");
+        cullingViewsStagingBuffer->map();
+
+        occlusionBits.resize((sharedData.getMaxMeshInstances() + 31) / 32);
+        occlusionBitsBuffer = ctx().vireo->createBuffer(
+            vireo::BufferType::DEVICE_STORAGE,
+            sizeof(uint32) * occlusionBits.size(),
+            1,
+            "occlusionBits");
+        occlusionBitsStagingBuffer = ctx().vireo->createBuffer(
+            vireo::BufferType::BUFFER_UPLOAD,
+            sizeof(uint32) * occlusionBits.size(),
+            1,
+            "occlusionBitsStaging");
+        occlusionBitsStagingBuffer->map();
     }
 
     void SceneFrameData::compute(vireo::CommandList& commandList, const Camera& camera) const {
+        cullingTelemetry->capture(commandList);
         compute(camera, commandList, opaquePipelinesData);
         compute(camera, commandList, shaderMaterialPipelinesData);
         compute(camera, commandList, transparentPipelinesData);
     }
 
+    void SceneFrameData::computeLightClustering(
+        vireo::CommandList& commandList,
+        const Camera& camera,
+        const bool asyncCompute) const {
+        lightClustering->dispatch(commandList, camera, lightsDataArray->getBuffer(), lightsSlotsCount, asyncCompute);
+    }
+
     void SceneFrameData::compute(
         const Camera& camera,
         vireo::CommandList& commandList,
         const std::unordered_map<uint32, std::unique_ptr<GraphicPipelineData>>& pipelinesData) const {
         for (const auto& [pipelineId, pipelineData] : pipelinesData) {
+            if (pipelineData->occlusionCullingPipeline) {
+                pipelineData->occlusionCullingPipeline->dispatchFirstPass(
+                    commandList,
+                    pipelineData->getDrawCommandsCount(),
+                    camera.transform,
+                    camera.projection,
+                    *occlusionBitsBuffer,
+                    cullingViews.front().occlusionOffset,
+                    *pipelineData->instances.instancesBuffer,
+                    *pipelineData->instances.drawCommandsBuffer,
+                    *pipelineData->culledDrawCommandsBuffer,
+                    *pipelineData->culledDrawCommandsCountBuffer,
+                    *cullingTelemetry->getCounters());
+            }
+            // With the occlusion culling only the shadow maps views are culled here
             pipelineData->frustumCullingPipeline.dispatch(
                 commandList,
-                pipelineData->drawCommandsCount,
-                camera.transform,
-                camera.projection,
-                *pipelineData->instancesArray.getBuffer(),
-                *pipelineData->drawCommandsBuffer,
+                pipelineData->getDrawCommandsCount(),
+                *cullingViewsBuffer,
+                cullingViews.size(),
+                *occlusionBitsBuffer,
+                !pipelineData->occlusionCullingPipeline,
+                *pipelineData->instances.instancesBuffer,
+                *pipelineData->instances.drawCommandsBuffer,
                 *pipelineData->culledDrawCommandsBuffer,
-                *pipelineData->culledDrawCommandsCountBuffer);
+                *pipelineData->culledDrawCommandsCountBuffer,
+                *cullingTelemetry->getCounters());
+            // With the occlusion culling the commands are instanced after the second pass
+            if (isInstanced(*pipelineData) && !pipelineData->occlusionCullingPipeline) {
+                pipelineData->drawBatchingPipeline.dispatch(
+                    commandList,
+                    pipelineData->getDrawCommandsCount(),
+                    pipelineData->instances.drawBatches.getBatches().size(),
+                    *pipelineData->instances.batchesBuffer,
+                    *pipelineData->instances.instanceBatchesBuffer,
+                    *pipelineData->culledDrawCommandsBuffer,
+                    *pipelineData->culledDrawCommandsCountBuffer,
+                    *cullingTelemetry->getCounters());
+            }
         }
-        for (const auto& renderer : std::views::values(shadowMapRenderers)) {
-            const auto& shadowMapRenderer = std::static_pointer_cast<ShadowMapPass>(renderer);
-            shadowMapRenderer->compute(commandList, pipelinesData);
+    }
+
+    void SceneFrameData::computeOcclusionCulling(
+        vireo::CommandList& commandList,
+        const vireo::Buffer& pyramid,
+        const DepthPyramid& pyramidLayout,
+        const vireo::Viewport& viewport) const {
+        computeOcclusionCulling(commandList, pyramid, pyramidLayout, viewport, opaquePipelinesData);
+        computeOcclusionCulling(commandList, pyramid, pyramidLayout, viewport, shaderMaterialPipelinesData);
+        computeOcclusionCulling(commandList, pyramid, pyramidLayout, viewport, transparentPipelinesData);
+    }
+
+    void SceneFrameData::computeOcclusionCulling(
+        vireo::CommandList& commandList,
+        const vireo::Buffer& pyramid,
+        const DepthPyramid& pyramidLayout,
+        const vireo::Viewport& viewport,
+        const std::unordered_map<uint32, std::unique_ptr<GraphicPipelineData>>& pipelinesData) const {
+        for (const auto& [pipelineId, pipelineData] : pipelinesData) {
+            if (!pipelineData->occlusionCullingPipeline) { continue; }
+            pipelineData->occlusionCullingPipeline->dispatchSecondPass(
+                commandList,
+                pipelineData->getDrawCommandsCount(),
+                pyramid,
+                pyramidLayout,
+                viewport,
+                *pipelineData->instances.instancesBuffer,
+                *pipelineData->instances.drawCommandsBuffer,
+                *pipelineData->culledDrawCommandsBuffer,
+                *pipelineData->culledDrawCommandsCountBuffer,
+                *cullingTelemetry->getCounters());
+            if (isInstanced(*pipelineData)) {
+                pipelineData->drawBatchingPipeline.dispatch(
+                    commandList,
+                    pipelineData->getDrawCommandsCount(),
+                    pipelineData->instances.drawBatches.getBatches().size(),
+                    *pipelineData->instances.batchesBuffer,
+                    *pipelineData->instances.instanceBatchesBuffer,
+                    *pipelineData->culledDrawCommandsBuffer,
+                    *pipelineData->culledDrawCommandsCountBuffer,
+                    *cullingTelemetry->getCounters());
+            }
         }
     }
 
+    CullingStatistics SceneFrameData::getCullingStatistics() const {
+        return {
+            .frustumCulled = cullingTelemetry->get(CullingStatistics::FRUSTUM_CULLED),
+            .drawn = cullingTelemetry->get(CullingStatistics::DRAWN),
+            .occluded = cullingTelemetry->get(CullingStatistics::OCCLUDED),
+            .secondPassDrawn = cullingTelemetry->get(CullingStatistics::SECOND_PASS_DRAWN),
+            .shadowCulled = cullingTelemetry->get(CullingStatistics::SHADOW_CULLED),
+            .shadowDrawn = cullingTelemetry->get(CullingStatistics::SHADOW_DRAWN),
+            .shadowCached = cullingTelemetry->get(CullingStatistics::SHADOW_CACHED),
+            .instancedDrawn = cullingTelemetry->get(CullingStatistics::INSTANCED_DRAWN),
+        };
+    }
+
     void SceneFrameData::updatePipelinesData(
         const vireo::CommandList& commandList,
-        const std::unordered_map<uint32, std::unique_ptr<GraphicPipelineData>>& pipelinesData) {
+        const uint32 frameIndex,
+        const std::unordered_map<uint32, std::unique_ptr<GraphicPipelineInstances>>& pipelinesInstances,
+        std::unordered_map<uint32, std::unique_ptr<GraphicPipelineData>>& pipelinesData) {
+        // Culling data for the pipelines added to the shared data
+        for (const auto& [pipelineId, pipelineInstances] : pipelinesInstances) {
+            if (!pipelinesData.contains(pipelineId)) {
+                pipelinesData[pipelineId] = std::make_unique<GraphicPipelineData>(
+                    *pipelineInstances,
+                    sharedData.getMeshInstancesDataArray(),
+                    sharedData.getBufferPool());
+            }
+        }
         for (const auto& [pipelineId, pipelineData] : pipelinesData) {
-            pipelineData->updateData(commandList, drawCommandsStagingBufferRecycleBin, meshInstancesDataMemoryBlocks);
+            pipelineData->updateData(commandList, frameIndex);
+            if (occlusionCullingEnabled && !pipelineData->occlusionCullingPipeline) {
+                pipelineData->occlusionCullingPipeline = std::make_unique<OcclusionCulling>(
+                    sharedData.getMeshInstancesDataArray(),
+                    pipelineId,
+                    sizeof(DrawCommand),
+                    pipelineData->capacity);
+            } else if (!occlusionCullingEnabled && pipelineData->occlusionCullingPipeline) {
+                pipelineData->occlusionCullingPipeline.reset();
+            }
+            pipelineData->frustumCullingPipeline.reserve(
+                commandList,
+                cullingViews.size() - 1,
+                pipelineData->getDrawCommandsCount(),
+                pipelineData->capacity);
+        }
+    }
+
+    void SceneFrameData::updateCullingViews(
+        const vireo::CommandList& commandList,
+        const Camera& camera,
+        const std::unordered_set<const MeshInstance*>& occludedInstances) {
+        cullingViews.clear();
+        auto& cameraView = cullingViews.emplace_back(
+            mul(inverse(camera.transform), camera.projection),
+            CullingView::TYPE_CAMERA);
+        if (!occludedInstances.empty()) {
+            cameraView.occlusionOffset = 0;
+        }
+        for (const auto& renderer : std::views::values(shadowMapRenderers)) {
+            std::static_pointer_cast<ShadowMapPass>(renderer)->addCullingViews(cullingViews);
+        }
+        const auto size = sizeof(CullingView) * cullingViews.size();
+        cullingViewsStagingBuffer->write(cullingViews.data(), size);
+        commandList.barrier(
+            *cullingViewsBuffer,
+            cullingViewsUploaded ? vireo::ResourceState::COMPUTE_READ : vireo::ResourceState::UNDEFINED,
+            vireo::ResourceState::COPY_DST);
+        commandList.copy(cullingViewsStagingBuffer, cullingViewsBuffer, size);
+        commandList.barrier(
+            *cullingViewsBuffer,
+            vireo::ResourceState::COPY_DST,
+            vireo::ResourceState::COMPUTE_READ);
+        cullingViewsUploaded = true;
+    }
+
+    void SceneFrameData::updateOcclusionBits(
+        const vireo::CommandList& commandList,
+        const std::unordered_set<const MeshInstance*>& occludedInstances) {
+        // Rebuilt from the occluded instances of the camera each frame : the indices of the
+        // removed instances are reused, the asynchronously added ones get an index later
+        auto bits = std::vector<uint32>(occlusionBits.size());
+        for (const auto* meshInstance : occludedInstances) {
+            if (!sharedData.haveInstance(meshInstance)) { continue; }
+            const auto index = sharedData.getInstanceIndex(meshInstance);
+            bits[index / 32] |= 1u << (index % 32);
+        }
+        if (occlusionBitsUploaded && bits == occlusionBits) { return; }
+        occlusionBits = std::move(bits);
+        const auto size = sizeof(uint32) * occlusionBits.size();
+        occlusionBitsStagingBuffer->write(occlusionBits.data(), size);
+        commandList.barrier(
+            *occlusionBitsBuffer,
+            occlusionBitsUploaded ? vireo::ResourceState::COMPUTE_READ : vireo::ResourceState::UNDEFINED,
+            vireo::ResourceState::COPY_DST);
+        commandList.copy(occlusionBitsStagingBuffer, occlusionBitsBuffer, size);
+        commandList.barrier(
+            *occlusionBitsBuffer,
+            vireo::ResourceState::COPY_DST,
+            vireo::ResourceState::COMPUTE_READ);
+        occlusionBitsUploaded = true;
+    }
+
+    void SceneFrameData::updateShadowAtlas(const vireo::CommandList& commandList, const Camera& camera) {
+        if (!shadowAtlasInitialized) {
+            commandList.barrier(
+                shadowAtlas,
+                vireo::ResourceState::UNDEFINED,
+                vireo::ResourceState::SHADER_READ);
+#ifdef SHADOW_TRANSPARENCY_COLOR_ENABLED
+            commandList.barrier(
+                shadowTransparencyColorAtlas,
+                vireo::ResourceState::UNDEFINED,
+                vireo::ResourceState::SHADER_READ);
+#endif
+            shadowAtlasInitialized = true;
+        }
+
+        // One tile request per shadow map of the visible lights, as important as the light covers the screen
+        Frustum::Plane cameraPlanes[6];
+        Frustum::extractPlanes(cameraPlanes, mul(inverse(camera.transform), camera.projection));
+        auto requests = std::vector<ShadowAtlasAllocator::Request>{};
+        auto targets = std::vector<std::pair<ShadowMapPass*, uint32>>{};
+        for (const auto& [light, renderpass] : shadowMapRenderers) {
+            const auto renderer = std::static_pointer_cast<ShadowMapPass>(renderpass).get();
+            if (!light->visible || !light->castShadows) {
+                for (auto i = 0; i < renderer->getShadowMapCount(); i++) {
+                    shadowAtlasAllocator.free(renderer->getTile(i));
+                    renderer->setTile(i, {});
+                }
+                continue;
+            }
+            const auto coverage = renderer->getScreenCoverage(camera, cameraPlanes);
+            for (auto i = 0; i < renderer->getShadowMapCount(); i++) {
+                requests.push_back({ renderer->getWantedTileSize(i, coverage, shadowAtlasAllocator), coverage });
+                targets.push_back({ renderer, i });
+            }
+        }
+        shadowAtlasAllocator.fit(requests);
+
+        // The shadow maps of a light are all in the atlas or none of them
+        for (auto first = 0; first < requests.size();) {
+            const auto renderer = targets[first].first;
+            const auto last = first + renderer->getShadowMapCount();
+            auto dropped = false;
+            for (auto i = first; i < last; i++) {
+                dropped |= requests[i].size == 0;
+            }
+            for (auto i = first; i < last; i++) {
+                if (dropped) { requests[i].size = 0; }
+                // The tiles keeping their size stay in place
+                const auto& tile = renderer->getTile(targets[i].second);
+                if (tile.size != requests[i].size) {
+                    shadowAtlasAllocator.free(tile);
+                    renderer->setTile(targets[i].second, {});
+                }
+            }
+            first = last;
+        }
+
+        // New tiles by decreasing size. When the atlas is too fragmented all the tiles are
+        // allocated again, in an empty atlas they always fit after fit()
+        auto pending = std::vector<uint32>{};
+        for (auto i = 0; i < requests.size(); i++) {
+            if (requests[i].size != 0 && targets[i].first->getTile(targets[i].second).size == 0) {
+                pending.push_back(i);
+            }
+        }
+        const auto largestFirst = [&](const uint32 a, const uint32 b) { return requests[a].size > requests[b].size; };
+        std::ranges::stable_sort(pending, largestFirst);
+        for (const auto i : pending) {
+            const auto tile = shadowAtlasAllocator.allocate(requests[i].size);
+            if (tile.size == 0) {
+                shadowAtlasAllocator.clear();
+                pending.clear();
+                for (auto j = 0; j < requests.size(); j++) {
+                    if (requests[j].size != 0) {
+                        pending.push_back(j);
+                    }
+                }
+                std::ranges::stable_sort(pending, largestFirst);
+                for (const auto j : pending) {
+                    targets[j].first->setTile(targets[j].second, shadowAtlasAllocator.allocate(requests[j].size));
+                }
+                break;
+            }
+            targets[i].first->setTile(targets[i].second, tile);
         }
     }
 
@@ -128,40 +426,50 @@ namespace lysa {
         const vireo::CommandList& commandList,
         const Camera& camera,
         const RendererConfiguration& config,
-        const uint32 frameIndex) {
+        const uint32 frameIndex,
+        const std::unordered_set<const MeshInstance*>& occludedInstances) {
+        for (const auto& aabb : sharedData.takeShadowMapsCachesInvalidations(frameIndex)) {
+            invalidateShadowMapsCaches(aabb);
+        }
         if (!removedLights.empty()) {
             for (const auto& light : removedLights) {
                 disableLightShadowCasting(light);
+                // Empty the slot so the light clustering ignores it
+                const auto& slot = lights.at(light);
+                if (slot.block.size > 0) {
+                    const auto empty = LightData{};
+                    lightsDataArray->write(slot.block, &empty);
+                    lightsDataArray->free(slot.block);
+                }
                 lights.erase(light);
             }
             removedLights.clear();
+            lightsSlotsCount = 0;
+            for (const auto& slot : std::views::values(lights)) {
+                lightsSlotsCount = std::max(lightsSlotsCount, slot.block.instanceIndex + 1);
+            }
+            lightsDataUpdated = true;
         }
-        for (const auto* light : lights) {
+        updateLightsSlots();
+        for (const auto* light : std::views::keys(lights)) {
             if (light->castShadows) {
                 enableLightShadowCasting(light);
             } else {
                 disableLightShadowCasting(light);
             }
         }
-        if (shadowMapsUpdated) {
-            descriptorSet->update(BINDING_SHADOW_MAPS, shadowMaps);
-#ifdef SHADOW_TRANSPARENCY_COLOR_ENABLED
-                descriptorSetOpt1->update(BINDING_SHADOW_MAP_TRANSPARENCY_COLOR, shadowTransparencyColorMaps);
-#endif
-            shadowMapsUpdated = false;
-        }
+        updateShadowAtlas(commandList, camera);
         for (const auto [light, renderpass] : shadowMapRenderers) {
             if (light->visible && light->castShadows) {
                 const auto shadowMapRenderer = std::dynamic_pointer_cast<ShadowMapPass>(renderpass);
                 shadowMapRenderer->setCurrentCamera(camera);
-                shadowMapRenderer->updatePipelines(pipelineIds);
+                shadowMapRenderer->setCacheEnabled(config.shadowMapsCacheEnabled && sharedData.haveStaticShadowCasters());
+                shadowMapRenderer->setSinglePassEnabled(config.omniShadowMapsSinglePassEnabled);
                 shadowMapRenderer->update(frameIndex);
             }
         }
-
-        if (!drawCommandsStagingBufferRecycleBin.empty()) {
-            drawCommandsStagingBufferRecycleBin.clear();
-        }
+        updateCullingViews(commandList, camera, occludedInstances);
+        updateOcclusionBits(commandList, occludedInstances);
 
         const auto sceneUniform = SceneData {
             .cameraPosition = camera.transform[3].xyz,
@@ -169,158 +477,134 @@ namespace lysa {
             .view = inverse(camera.transform),
             .viewInverse = camera.transform,
             .ambientLight = float4(environment.color, environment.intensity),
-            .lightsCount = static_cast<uint32>(lights.size()),
+            .lightsCount = lightsSlotsCount,
             .bloomEnabled = config.bloomEnabled ? 1u : 0u,
 #ifdef DEFERRED_RENDERER
             .ssaoEnabled = config.ssaoEnabled ? 1u : 0u,
 #endif
+            .nearPlane = camera.near,
+            .farPlane = camera.far,
+            .bloomThreshold = config.bloomThreshold,
         };
         sceneUniformBuffer->write(&sceneUniform);
 
-        if (meshInstancesDataUpdated) {
-            meshInstancesDataArray.flush(commandList);
-            meshInstancesDataArray.postBarrier(commandList);
-            meshInstancesDataUpdated = false;
-        }
-
-        updatePipelinesData(commandList, opaquePipelinesData);
-        updatePipelinesData(commandList, shaderMaterialPipelinesData);
-        updatePipelinesData(commandList, transparentPipelinesData);
-
-        if (!lights.empty()) {
-            if (lights.size() > lightsBufferCount) {
-                if (lightsBufferCount >= maxLights) {
-                    throw Exception("Too many lights");
-                }
-                lightsBufferCount = lights.size();
-                lightsBuffer = ctx().vireo->createBuffer(
-                    vireo::BufferType::UNIFORM,
-                    sizeof(LightData) * lightsBufferCount, 1,
-                    "Scene Lights");
-                lightsBuffer->map();
-                descriptorSet->update(BINDING_LIGHTS, lightsBuffer);
-            }
-            auto lightIndex = 0;
-            auto lightsArray = std::vector<LightData>(lightsBufferCount);
-            for (const auto& light : lights) {
-                if (light->visible) {
-                    lightsArray[lightIndex] = light->getData();
-                    if (shadowMapRenderers.contains(light)) {
-                        const auto& shadowMapRenderer = std::static_pointer_cast<ShadowMapPass>(shadowMapRenderers[light]);
-                        lightsArray[lightIndex].mapIndex = shadowMapIndex[light];
-                        switch (light->type) {
-                            case LightType::LIGHT_DIRECTIONAL: {
-                                for (int cascadeIndex = 0; cascadeIndex < lightsArray[lightIndex].cascadesCount ; cascadeIndex++) {
-                                    lightsArray[lightIndex].lightSpace[cascadeIndex] =
-                                        shadowMapRenderer->getLightSpace(cascadeIndex);
-                                    lightsArray[lightIndex].cascadeSplitDepth[cascadeIndex] =
-                                        shadowMapRenderer->getCascadeSplitDepth(cascadeIndex);
-                                }
-                                break;
-                            }
-                            case LightType::LIGHT_SPOT: {
-                                lightsArray[lightIndex].lightSpace[0] = shadowMapRenderer->getLightSpace(0);
-                                break;
-                            }
-                            case LightType::LIGHT_OMNI: {
-                                break;
+        occlusionCullingEnabled = config.occlusionCullingEnabled;
+        automaticInstancingEnabled = config.automaticInstancingEnabled;
+        sharedData.update(commandList, frameIndex);
+        updatePipelinesData(commandList, frameIndex, sharedData.getOpaquePipelinesInstances(), opaquePipelinesData);
+        updatePipelinesData(commandList, frameIndex, sharedData.getShaderMaterialPipelinesInstances(), shaderMaterialPipelinesData);
+        updatePipelinesData(commandList, frameIndex, sharedData.getTransparentPipelinesInstances(), transparentPipelinesData);
+
+        // Only the lights and the shadow maps whose data changed since the last frame are uploaded
+        lightsUploadSize = 0;
+        auto shadowsDataUpdated = false;
+        const auto atlasSize = static_cast<float>(shadowAtlasAllocator.getSize());
+        for (auto& [light, slot] : lights) {
+            auto data = light->visible ? light->getData() : LightData{};
+            if (light->visible && shadowSlots.contains(light)) {
+                const auto& shadowMapRenderer = std::static_pointer_cast<ShadowMapPass>(shadowMapRenderers.at(light));
+                if (shadowMapRenderer->isInAtlas()) {
+                    auto& shadowSlot = shadowSlots.at(light);
+                    auto shadowData = ShadowData{};
+                    for (auto i = 0; i < shadowMapRenderer->getShadowMapCount(); i++) {
+                        const auto& tile = shadowMapRenderer->getTile(i);
+                        shadowData.shadowMapTiles[i] = float4{
+                            static_cast<float>(tile.x),
+                            static_cast<float>(tile.y),
+                            static_cast<float>(tile.size),
+                            static_cast<float>(tile.size)} / atlasSize;
+                    }
+                    switch (light->type) {
+                        case LightType::LIGHT_DIRECTIONAL: {
+                            for (int cascadeIndex = 0; cascadeIndex < data.cascadesCount ; cascadeIndex++) {
+                                shadowData.lightSpace[cascadeIndex] = shadowMapRenderer->getLightSpace(cascadeIndex);
+                                data.cascadeSplitDepth[cascadeIndex] = shadowMapRenderer->getCascadeSplitDepth(cascadeIndex);
                             }
-                            default:;
+                            break;
                         }
+                        case LightType::LIGHT_SPOT: {
+                            shadowData.lightSpace[0] = shadowMapRenderer->getLightSpace(0);
+                            break;
+                        }
+                        case LightType::LIGHT_OMNI: {
+                            break;
+                        }
+                        default:;
+                    }
+                    data.mapIndex = static_cast<int32>(shadowSlot.block.instanceIndex);
+                    if (!shadowSlot.written || std::memcmp(&shadowSlot.data, &shadowData, sizeof(ShadowData)) != 0) {
+                        shadowSlot.data = shadowData;
+                        shadowSlot.written = true;
+                        shadowsDataArray.write(shadowSlot.block, &shadowSlot.data);
+                        lightsUploadSize += sizeof(ShadowData);
+                        shadowsDataUpdated = true;
                     }
-                    lightIndex++;
                 }
             }
-            lightsBuffer->write(lightsArray.data(), lightsArray.size() * sizeof(LightData));
+            if (!slot.written || std::memcmp(&slot.data, &data, sizeof(LightData)) != 0) {
+                slot.data = data;
+                slot.written = true;
+                lightsDataArray->write(slot.block, &slot.data);
+                lightsUploadSize += sizeof(LightData);
+                lightsDataUpdated = true;
+            }
+        }
+        if (lightsDataUpdated) {
+            lightsDataArray->flush(commandList);
+            lightsDataArray->postBarrier(commandList);
+            lightsDataUpdated = false;
+        }
+        if (shadowsDataUpdated) {
+            shadowsDataArray.flush(commandList);
+            shadowsDataArray.postBarrier(commandList);
         }
     }
 
     void SceneFrameData::addLight(const Light* light) {
-        lights.insert(light);
+        assert([&]{ return !lights.contains(light); }, "Light already in the scene");
+        // The slot is allocated by the next update, after the growth of the lights buffer
+        lights[light] = LightSlot{};
         if (light->castShadows) {
             enableLightShadowCasting(light);
         }
     }
 
-    void SceneFrameData::removeLight(const Light* light) {
-        if (lights.contains(light)) {
-            removedLights.insert(light);
-        }
-    }
-
-    void SceneFrameData::addInstance(const MeshInstance* meshInstance) {
-        const auto& mesh = meshInstance->getMesh();
-        assert([&]{ return !meshInstancesDataMemoryBlocks.contains(meshInstance);}, "Mesh instance already in the scene");
-        assert([&]{return !mesh.getMaterials().empty(); }, "Models without materials are not supported");
-        assert([&]{return mesh.isUploaded(); }, "Mesh instance is not in VRAM");
-
-        const auto meshInstanceData = meshInstance->getData();
-        meshInstancesDataMemoryBlocks[meshInstance] = meshInstancesDataArray.alloc(1);
-        meshInstancesDataArray.write(meshInstancesDataMemoryBlocks[meshInstance], &meshInstanceData);
-        meshInstancesDataUpdated = true;
-
-        auto haveTransparentMaterial{false};
-        auto haveShaderMaterial{false};
-        auto nodePipelineIds = std::set<uint32>{};
-        for (int i = 0; i < mesh.getSurfaces().size(); i++) {
-            const auto& material = materialManager[meshInstance->getSurfaceMaterial(i)];
-            haveTransparentMaterial = material.getTransparency() != Transparency::DISABLED;
-            haveShaderMaterial = material.getType() == Material::SHADER;
-            const auto id = material.getPipelineId();
-            nodePipelineIds.insert(id);
-            if (!pipelineIds.contains(id)) {
-                pipelineIds[id].push_back(material.id);
-                materialsUpdated = true;
+    void SceneFrameData::updateLightsSlots() {
+        if (lightsCapacity.update(static_cast<uint32>(lights.size()))) {
+            // The previous array is only read by this frame in flight, all the lights get a
+            // new slot and are written again
+            lightsDataArray = std::make_unique<DeviceMemoryArray>(
+                ctx().vireo,
+                sizeof(LightData),
+                lightsCapacity.get(),
+                lightsCapacity.get(),
+                vireo::BufferType::DEVICE_STORAGE,
+                "lightsData");
+            descriptorSet->update(BINDING_LIGHTS, lightsDataArray->getBuffer());
+            for (auto& slot : std::views::values(lights)) {
+                slot = LightSlot{};
             }
+            lightsSlotsCount = 0;
         }
-
-        for (const auto& pipelineId : nodePipelineIds) {
-            if (haveShaderMaterial) {
-                addInstance(pipelineId, meshInstance, shaderMaterialPipelinesData);
-            } else if (haveTransparentMaterial) {
-                addInstance(pipelineId, meshInstance, transparentPipelinesData);
-            } else {
-                addInstance(pipelineId, meshInstance, opaquePipelinesData);
+        for (auto& slot : std::views::values(lights)) {
+            if (slot.block.size == 0) {
+                slot.block = lightsDataArray->alloc(1);
+                lightsSlotsCount = std::max(lightsSlotsCount, slot.block.instanceIndex + 1);
+                lightsDataUpdated = true;
             }
         }
     }
 
-    void SceneFrameData::updateInstance(const MeshInstance* meshInstance) {
-        assert([&]{ return meshInstancesDataMemoryBlocks.contains(meshInstance); },
-"MeshInstance does not belong to the scene");
-        const auto meshInstanceData = meshInstance->getData();
-        meshInstancesDataArray.write(meshInstancesDataMemoryBlocks[meshInstance], &meshInstanceData);
-        meshInstancesDataUpdated = true;
-    }
-
-    void SceneFrameData::addInstance(
-        pipeline_id pipelineId,
-        const MeshInstance*& meshInstance,
-        std::unordered_map<uint32, std::unique_ptr<GraphicPipelineData>>& pipelinesData) {
-        if (!pipelinesData.contains(pipelineId)) {
-            pipelinesData[pipelineId] = std::make_unique<GraphicPipelineData>(
-                pipelineId, meshInstancesDataArray, maxMeshSurfacePerPipeline);
+    void SceneFrameData::removeLight(const Light* light) {
+        if (lights.contains(light)) {
+            removedLights.insert(light);
         }
-        pipelinesData[pipelineId]->addInstance(meshInstance, meshInstancesDataMemoryBlocks);
     }
 
-    void SceneFrameData::removeInstance(const MeshInstance* meshInstance) {
-        assert([&]{ return meshInstancesDataMemoryBlocks.contains(meshInstance); },
-            "MeshInstance does not belong to the scene");
-        for (const auto& pipelineId : std::views::keys(pipelineIds)) {
-            if (shaderMaterialPipelinesData.contains(pipelineId)) {
-                shaderMaterialPipelinesData[pipelineId]->removeInstance(meshInstance);
-            }
-            if (transparentPipelinesData.contains(pipelineId)) {
-                transparentPipelinesData[pipelineId]->removeInstance(meshInstance);
-            }
-            if (opaquePipelinesData.contains(pipelineId)) {
-                opaquePipelinesData[pipelineId]->removeInstance(meshInstance);
-            }
+    void SceneFrameData::invalidateShadowMapsCaches(const AABB& aabb) const {
+        for (const auto& renderer : std::views::values(shadowMapRenderers)) {
+            std::static_pointer_cast<ShadowMapPass>(renderer)->invalidateCache(aabb);
         }
-        meshInstancesDataArray.free(meshInstancesDataMemoryBlocks.at(meshInstance));
-        meshInstancesDataMemoryBlocks.erase(meshInstance);
-        meshInstancesDataUpdated = true;
     }
 
     void SceneFrameData::drawOpaquesModels(
@@ -330,6 +614,20 @@ namespace lysa {
         drawModels(commandList, pipelines, opaquePipelinesData);
     }
 
+    void SceneFrameData::drawFirstPassOpaquesModels(
+        vireo::CommandList& commandList,
+        const std::unordered_map<uint32, std::shared_ptr<vireo::GraphicPipeline>>& pipelines) const {
+        if (opaquePipelinesData.empty()) { return; }
+        drawModels(commandList, pipelines, opaquePipelinesData, DrawCommandsList::FIRST_PASS);
+    }
+
+    void SceneFrameData::drawNewlyVisibleOpaquesModels(
+        vireo::CommandList& commandList,
+        const std::unordered_map<uint32, std::shared_ptr<vireo::GraphicPipeline>>& pipelines) const {
+        if (opaquePipelinesData.empty()) { return; }
+        drawModels(commandList, pipelines, opaquePipelinesData, DrawCommandsList::NEWLY_VISIBLE);
+    }
+
     void SceneFrameData::drawTransparentModels(
         vireo::CommandList& commandList,
         const std::unordered_map<uint32, std::shared_ptr<vireo::GraphicPipeline>>& pipelines) const {
@@ -348,65 +646,41 @@ namespace lysa {
     void SceneFrameData::drawModels(
         vireo::CommandList& commandList,
         const uint32 set,
-        const std::map<pipeline_id, std::shared_ptr<vireo::Buffer>>& culledDrawCommandsBuffers,
-        const std::map<pipeline_id, std::shared_ptr<vireo::Buffer>>& culledDrawCommandsCountBuffers,
-        const std::map<pipeline_id, std::shared_ptr<FrustumCulling>>& frustumCullingPipelines) const {
-        for (const auto& [pipelineId, pipelineData] : opaquePipelinesData) {
-            if (pipelineData->drawCommandsCount == 0 ||
-                frustumCullingPipelines.at(pipelineId)->getDrawCommandsCount() == 0) { continue; }
-            commandList.bindDescriptor(pipelineData->descriptorSet, set);
-            // commandList.drawIndexedIndirect(
-                // pipelineData->drawCommandsBuffer,
-                // 0,
-                // pipelineData->drawCommandsCount,
-                // sizeof(DrawCommand),
-                // sizeof(uint32));
-            commandList.drawIndexedIndirectCount(
-                culledDrawCommandsBuffers.at(pipelineId),
-                0,
-                culledDrawCommandsCountBuffers.at(pipelineId),
-                0,
-                pipelineData->drawCommandsCount,
-                sizeof(DrawCommand),
-                sizeof(uint32));
-        }
-        for (const auto& [pipelineId, pipelineData] : shaderMaterialPipelinesData) {
-            if (pipelineData->drawCommandsCount == 0 ||
-                frustumCullingPipelines.at(pipelineId)->getDrawCommandsCount() == 0) { continue; }
-            commandList.bindDescriptor(pipelineData->descriptorSet, set);
-            commandList.drawIndexedIndirectCount(
-                culledDrawCommandsBuffers.at(pipelineId),
-                0,
-                culledDrawCommandsCountBuffers.at(pipelineId),
-                0,
-                pipelineData->drawCommandsCount,
-                sizeof(DrawCommand),
-                sizeof(uint32));
-        }
-        for (const auto& [pipelineId, pipelineData] : transparentPipelinesData) {
-            if (pipelineData->drawCommandsCount == 0 ||
-                frustumCullingPipelines.at(pipelineId)->getDrawCommandsCount() == 0) { continue; }
-            commandList.bindDescriptor(pipelineData->descriptorSet, set);
-            commandList.drawIndexedIndirectCount(
-                culledDrawCommandsBuffers.at(pipelineId),
-                0,
-                culledDrawCommandsCountBuffers.at(pipelineId),
-                0,
-                pipelineData->drawCommandsCount,
-                sizeof(DrawCommand),
-                sizeof(uint32));
-        }
+        const uint32 cullingView) const {
+        assert([&]{ return cullingView > 0 && cullingView < cullingViews.size(); }, "Invalid shadow map culling view");
+        const auto shadowView = cullingView - 1;
+        const auto draw = [&](const std::unordered_map<uint32, std::unique_ptr<GraphicPipelineData>>& pipelinesData) {
+            for (const auto& pipelineData : std::views::values(pipelinesData)) {
+                if (pipelineData->getDrawCommandsCount() == 0) { continue; }
+                const auto& frustumCulling = pipelineData->frustumCullingPipeline;
+                commandList.bindDescriptor(pipelineData->descriptorSet, set);
+                commandList.drawIndexedIndirectCount(
+                    frustumCulling.getShadowDrawCommandsBuffer(),
+                    sizeof(DrawCommand) * frustumCulling.getShadowDrawCommandsStride() * shadowView,
+                    frustumCulling.getShadowDrawCommandsCountBuffer(),
+                    sizeof(uint32) * shadowView,
+                    pipelineData->getDrawCommandsCount(),
+                    sizeof(DrawCommand),
+                    sizeof(uint32));
+            }
+        };
+        draw(opaquePipelinesData);
+        draw(shaderMaterialPipelinesData);
+        draw(transparentPipelinesData);
     }
 
     void SceneFrameData::drawModels(
         vireo::CommandList& commandList,
         const std::unordered_map<uint32, std::shared_ptr<vireo::GraphicPipeline>>& pipelines,
-        const std::unordered_map<uint32, std::unique_ptr<GraphicPipelineData>>& pipelinesData) const {
+        const std::unordered_map<uint32, std::unique_ptr<GraphicPipelineData>>& pipelinesData,
+        const DrawCommandsList list) const {
         for (const auto& [pipelineId, pipelineData] : pipelinesData) {
-            if (pipelineData->drawCommandsCount == 0 ||
-                pipelineData->frustumCullingPipeline.getDrawCommandsCount() == 0) { continue; }
-            const auto& pipeline = pipelines.at(pipelineId);
-            commandList.bindPipeline(pipeline);
+            const auto& occlusionCulling = pipelineData->occlusionCullingPipeline;
+            if (pipelineData->getDrawCommandsCount() == 0 || (list == DrawCommandsList::NEWLY_VISIBLE && !occlusionCulling)) { continue; }
+            // Skipped while the pipelines of the material are compiled, see PipelineCompiler
+            const auto pipeline = pipelines.find(pipelineId);
+            if (pipeline == pipelines.end()) { continue; }
+            commandList.bindPipeline(pipeline->second);
             commandList.bindDescriptors({
                 ctx().globalDescriptorSet,
                 ctx().samplers.getDescriptorSet(),
@@ -417,41 +691,151 @@ namespace lysa {
 #endif
             });
 
+            auto drawCommands = pipelineData->culledDrawCommandsBuffer;
+            auto drawCommandsCounter = pipelineData->culledDrawCommandsCountBuffer;
+            if (list == DrawCommandsList::NEWLY_VISIBLE) {
+                drawCommands = occlusionCulling->getNewlyVisibleDrawCommandsBuffer();
+                drawCommandsCounter = occlusionCulling->getNewlyVisibleDrawCommandsCountBuffer();
+            } else if (list == DrawCommandsList::CULLED && isInstanced(*pipelineData)) {
+                drawCommands = pipelineData->drawBatchingPipeline.getDrawCommandsBuffer();
+                drawCommandsCounter = pipelineData->drawBatchingPipeline.getDrawCommandsCountBuffer();
+            }
             commandList.drawIndexedIndirectCount(
-                pipelineData->culledDrawCommandsBuffer,
+                drawCommands,
                 0,
-                pipelineData->culledDrawCommandsCountBuffer,
+                drawCommandsCounter,
                 0,
-                pipelineData->drawCommandsCount,
+                pipelineData->getDrawCommandsCount(),
                 sizeof(DrawCommand),
                 sizeof(uint32));
         }
     }
 
+    void SceneFrameData::renderShadowMaps(vireo::CommandList& commandList) const {
+        if (shadowMapRenderers.empty()) { return; }
+        beginShadowMaps(commandList, false);
+        commandList.beginRendering(getShadowMapsRenderingConfiguration(true));
+        for (const auto& renderer : std::views::values(shadowMapRenderers)) {
+            std::static_pointer_cast<ShadowMapPass>(renderer)->render(commandList, *this);
+        }
+        commandList.endRendering();
+        endShadowMaps(commandList);
+    }
+
+    void SceneFrameData::beginShadowMaps(vireo::CommandList& commandList, const bool clear) const {
+        if (shadowMapRenderers.empty()) { return; }
+        for (const auto& renderer : std::views::values(shadowMapRenderers)) {
+            std::static_pointer_cast<ShadowMapPass>(renderer)->renderCaches(commandList, *this);
+        }
+        commandList.barrier(
+            shadowAtlas,
+            vireo::ResourceState::SHADER_READ,
+            vireo::ResourceState::RENDER_TARGET_DEPTH);
+#ifdef SHADOW_TRANSPARENCY_COLOR_ENABLED
+        commandList.barrier(
+            shadowTransparencyColorAtlas,
+            vireo::ResourceState::SHADER_READ,
+            vireo::ResourceState::RENDER_TARGET_COLOR);
+#endif
+        if (clear) {
+            commandList.beginRendering(getShadowMapsRenderingConfiguration(true));
+            commandList.endRendering();
+        }
+    }
+
+    void SceneFrameData::renderShadowMaps(
+        vireo::CommandList& commandList,
+        const uint32 first,
+        const uint32 count) const {
+        if (count == 0) { return; }
+        if (ctx().config.backend == vireo::Backend::VULKAN) {
+            // The rendering scopes of the other command lists write and load the same atlas
+            commandList.barrier(
+                shadowAtlas,
+                vireo::ResourceState::RENDER_TARGET_DEPTH,
+                vireo::ResourceState::RENDER_TARGET_DEPTH);
+#ifdef SHADOW_TRANSPARENCY_COLOR_ENABLED
+            commandList.barrier(
+                shadowTransparencyColorAtlas,
+                vireo::ResourceState::RENDER_TARGET_COLOR,
+                vireo::ResourceState::RENDER_TARGET_COLOR);
+#endif
+        }
+        commandList.beginRendering(getShadowMapsRenderingConfiguration(false));
+        for (const auto& renderer : shadowMapRenderers | std::views::values | std::views::drop(first) | std::views::take(count)) {
+            std::static_pointer_cast<ShadowMapPass>(renderer)->render(commandList, *this);
+        }
+        commandList.endRendering();
+    }
+
+    void SceneFrameData::endShadowMaps(vireo::CommandList& commandList) const {
+        if (shadowMapRenderers.empty()) { return; }
+        commandList.barrier(
+            shadowAtlas,
+            vireo::ResourceState::RENDER_TARGET_DEPTH,
+            vireo::ResourceState::SHADER_READ);
+#ifdef SHADOW_TRANSPARENCY_COLOR_ENABLED
+        commandList.barrier(
+            shadowTransparencyColorAtlas,
+            vireo::ResourceState::RENDER_TARGET_COLOR,
+            vireo::ResourceState::SHADER_READ);
+#endif
+    }
+
+    std::vector<std::pair<uint32, uint32>> SceneFrameData::splitShadowMaps(const uint32 groupsCount) const {
+        auto groups = std::vector<std::pair<uint32, uint32>>{};
+        if (shadowMapRenderers.empty() || groupsCount == 0) { return groups; }
+        // Contiguous groups of lights with about the same number of shadow maps
+        auto total = uint32{0};
+        for (const auto& renderer : std::views::values(shadowMapRenderers)) {
+            total += std::static_pointer_cast<ShadowMapPass>(renderer)->getShadowMapCount();
+        }
+        const auto perGroup = std::max(1u, (total + groupsCount - 1) / groupsCount);
+        auto first = uint32{0};
+        auto index = uint32{0};
+        auto mapsCount = uint32{0};
+        for (const auto& renderer : std::views::values(shadowMapRenderers)) {
+            mapsCount += std::static_pointer_cast<ShadowMapPass>(renderer)->getShadowMapCount();
+            index += 1;
+            if (mapsCount >= perGroup) {
+                groups.push_back({first, index - first});
+                first = index;
+                mapsCount = 0;
+            }
+        }
+        if (first < index) {
+            groups.push_back({first, index - first});
+        }
+        return groups;
+    }
+
+    vireo::RenderingConfiguration SceneFrameData::getShadowMapsRenderingConfiguration(const bool clear) const {
+        auto renderingConfig = vireo::RenderingConfiguration {
+#ifdef SHADOW_TRANSPARENCY_COLOR_ENABLED
+            .colorRenderTargets = {
+                {
+                    .clear = clear,
+                    .clearValue{ .color = {0.0f, 0.0f, 0.0f, 1.0f} }
+                }},
+#endif
+            .depthTestEnable = true,
+            .clearDepthStencil = clear,
+            .discardDepthStencilAfterRender = false,
+        };
+#ifdef SHADOW_TRANSPARENCY_COLOR_ENABLED
+        renderingConfig.colorRenderTargets[0].renderTarget = shadowTransparencyColorAtlas;
+#endif
+        renderingConfig.depthStencilRenderTarget = shadowAtlas;
+        return renderingConfig;
+    }
+
     void SceneFrameData::enableLightShadowCasting(const Light* light) {
         if (light->castShadows && !shadowMapRenderers.contains(light) && (shadowMapRenderers.size() < ctx().config.maxShadowMapsPerScene)) {
-            const auto shadowMapRenderer = std::make_shared<ShadowMapPass>(
-                light,
-                meshInstancesDataArray,
-                maxMeshSurfacePerPipeline);
+            const auto shadowMapRenderer = std::make_shared<ShadowMapPass>(light, shadowAtlasAllocator.getSize());
             // Log::info("enableLightShadowCasting for #", std::to_string(light->id));
             materialsUpdated = true; // force update pipelines
             shadowMapRenderers[light] = shadowMapRenderer;
-            const auto blankImage = ctx().res.get<ImageManager>().getBlankImage();
-            for (uint32 index = 0; index < shadowMaps.size(); index += 6) {
-                if (shadowMaps[index] == blankImage) {
-                    shadowMapIndex[light] = index;
-                    for (int i = 0; i < shadowMapRenderer->getShadowMapCount(); i++) {
-                        shadowMaps[index + i] = shadowMapRenderer->getShadowMap(i)->getImage();
-#ifdef SHADOW_TRANSPARENCY_COLOR_ENABLED
-                        shadowTransparencyColorMaps[index + i] = shadowMapRenderer->getTransparencyColorMap(i)->getImage();
-#endif
-                    }
-                    shadowMapsUpdated = true;
-                    return;
-                }
-            }
-            throw Exception("Out of memory for shadow map");
+            shadowSlots[light] = ShadowSlot{ .block = shadowsDataArray.alloc(1) };
         }
     }
 
@@ -459,17 +843,12 @@ namespace lysa {
         if (shadowMapRenderers.contains(light)) {
             // Log::info("disableLightShadowCasting for #", std::to_string(light->id));
             const auto& shadowMapRenderer = std::static_pointer_cast<ShadowMapPass>(shadowMapRenderers.at(light));
-            const auto index = shadowMapIndex[light];
-            const auto& blankImage = ctx().res.get<ImageManager>().getBlankImage();
-            for (int i = 0; i < shadowMapRenderer->getShadowMapCount(); i++) {
-                shadowMaps[index + i] = blankImage;
-#ifdef SHADOW_TRANSPARENCY_COLOR_ENABLED
-                shadowTransparencyColorMaps[index + i] = blankImage;
-#endif
+            for (auto i = 0; i < shadowMapRenderer->getShadowMapCount(); i++) {
+                shadowAtlasAllocator.free(shadowMapRenderer->getTile(i));
             }
-            shadowMapsUpdated = true;
-            shadowMapIndex.erase(light);
             shadowMapRenderers.erase(light);
+            shadowsDataArray.free(shadowSlots.at(light).block);
+            shadowSlots.erase(light);
         }
     }
 
@@ -7,7 +7,11 @@
 export module lysa.renderers.scene_frame_data;
 
 import vireo;
+import lysa.aabb;
+import lysa.buffer_capacity;
 import lysa.context;
+import lysa.culling_view;
+import lysa.depth_pyramid;
 import lysa.math;
 import lysa.memory;
 import lysa.resources.camera;
@@ -17,9 +21,14 @@ import lysa.resources.material;
 import lysa.resources.manager;
 import lysa.resources.mesh_instance;
 import lysa.renderers.configuration;
+import lysa.renderers.gpu_telemetry;
 import lysa.renderers.graphic_pipeline_data;
 import lysa.renderers.pipelines.frustum_culling;
+import lysa.renderers.pipelines.light_clustering;
+import lysa.renderers.pipelines.occlusion_culling;
+import lysa.renderers.scene_shared_data;
 import lysa.renderers.renderpasses.renderpass;
+import lysa.shadow_atlas_allocator;
 
 export namespace lysa {
 
@@ -27,7 +36,9 @@ export namespace lysa {
      * Manages per-frame scene data for rendering.
      *
      * SceneFrameData handles the storage and update of scene-wide information,
-     * including cameras, lights, environment settings, and mesh instance data.
+     * including cameras, lights and environment settings. The mesh instances data
+     * is shared by the frames in flight, see SceneSharedData, only the culling
+     * outputs are stored per frame.
      * It also manages descriptor sets and buffers required for rendering.
      */
     class SceneFrameData {
@@ -38,13 +49,21 @@ export namespace lysa {
         static constexpr vireo::DescriptorIndex BINDING_MODELS{1};
         /** Descriptor binding for lights buffer. */
         static constexpr vireo::DescriptorIndex BINDING_LIGHTS{2};
-        /** Descriptor binding for shadow maps array. */
-        static constexpr vireo::DescriptorIndex BINDING_SHADOW_MAPS{3};
+        /** Descriptor binding for the shadow atlas. */
+        static constexpr vireo::DescriptorIndex BINDING_SHADOW_ATLAS{3};
+        /** Descriptor binding for the lights clusters, see LightClusters. */
+        static constexpr vireo::DescriptorIndex BINDING_LIGHT_CLUSTERS{4};
+        /** Descriptor binding for the shadow maps data of the shadow casting lights. */
+        static constexpr vireo::DescriptorIndex BINDING_SHADOWS{5};
         /** Shared descriptor layout for the main scene set. */
         inline static std::shared_ptr<vireo::DescriptorLayout> sceneDescriptorLayout{nullptr};
 
         /** Optional descriptor binding: transparency color for shadow maps. */
-        static constexpr vireo::DescriptorIndex BINDING_SHADOW_MAP_TRANSPARENCY_COLOR{0};
+        static constexpr vireo::DescriptorIndex BINDING_SHADOW_ATLAS_TRANSPARENCY_COLOR{0};
+        /** Depth format of the shadow atlas. */
+        static constexpr auto SHADOW_ATLAS_FORMAT{vireo::ImageFormat::D32_SFLOAT};
+        /** Format of the transparency color shadow atlas, packed RGB + alpha. */
+        static constexpr auto SHADOW_ATLAS_TRANSPARENCY_COLOR_FORMAT{vireo::ImageFormat::R8G8B8A8_SNORM};
 #ifdef SHADOW_TRANSPARENCY_COLOR_ENABLED
         /** Optional descriptor layout (set used when transparency color is needed). */
         inline static std::shared_ptr<vireo::DescriptorLayout> sceneDescriptorLayoutOptional1{nullptr};
@@ -74,16 +93,14 @@ export namespace lysa {
         /**
          * Constructs a new SceneFrameData object.
          * 
-         * @param ctx Reference to the global context.
+         * @param sharedData Mesh instances data shared by the frames in flight.
          * @param maxLights Maximum number of lights supported.
-         * @param maxMeshInstancesPerScene Maximum number of mesh instances per scene.
-         * @param maxMeshSurfacePerPipeline Maximum number of mesh surfaces per pipeline.
+         * @param lightsCapacity Sizing of the lights buffer, it follows the number of lights up to maxLights.
          */
         SceneFrameData(
-            const
+            SceneSharedData& sharedData,
             uint32 maxLights,
-            uint32 maxMeshInstancesPerScene,
-            uint32 maxMeshSurfacePerPipeline);
+            const BufferCapacityConfiguration& lightsCapacity = {});
 
         /**
          * Sets the scene's environment settings.
@@ -102,13 +119,22 @@ export namespace lysa {
          * @param camera The current camera.
          * @param config Renderer configuration.
          * @param frameIndex Index of the current frame.
+         * @param occludedInstances Mesh instances hidden by the software occlusion culling of the camera,
+         * see Scene::getOccludedInstances().
          */
-        void update(const vireo::CommandList& commandList, const Camera& camera, const RendererConfiguration& config, uint32 frameIndex);
+        void update(
+            const vireo::CommandList& commandList,
+            const Camera& camera,
+            const RendererConfiguration& config,
+            uint32 frameIndex,
+            const std::unordered_set<const MeshInstance*>& occludedInstances = {});
 
         /**
          * Executes compute workloads.
          * 
-         * Performs operations such as frustum culling.
+         * Performs operations such as the frustum culling, or the first pass of the occlusion
+         * culling. Each pipeline is culled against the camera and all the shadow maps views in
+         * one dispatch.
          * 
          * @param commandList Command buffer for GPU operations.
          * @param camera The current camera.
@@ -116,22 +142,43 @@ export namespace lysa {
         void compute(vireo::CommandList& commandList, const Camera& camera) const;
 
         /**
-         * Adds a mesh instance to the scene.
-         * @param meshInstance Pointer to the mesh instance to add.
+         * Assigns the lights to the clusters of the camera frustum.
+         *
+         * Independent of the culling and of the shadow maps, it can run in the compute queue
+         * during the shadow maps rendering, see RenderTarget.
+         *
+         * @param commandList Command buffer for GPU operations.
+         * @param camera The current camera.
+         * @param asyncCompute True if the command buffer is submitted to the compute queue.
          */
-        void addInstance(const MeshInstance* meshInstance);
+        void computeLightClustering(vireo::CommandList& commandList, const Camera& camera, bool asyncCompute) const;
+
+        /**
+         * Executes the second pass of the occlusion culling.
+         *
+         * Must be called after the depth pre-pass and the build of the depth pyramid.
+         *
+         * @param commandList Command buffer for GPU operations.
+         * @param pyramid Depth pyramid buffer.
+         * @param pyramidLayout Layout of the depth pyramid.
+         * @param viewport Rectangle of the view in the depth buffer.
+         */
+        void computeOcclusionCulling(
+            vireo::CommandList& commandList,
+            const vireo::Buffer& pyramid,
+            const DepthPyramid& pyramidLayout,
+            const vireo::Viewport& viewport) const;
 
         /**
-         * Updates an existing mesh instance in the scene.
-         * @param meshInstance Pointer to the mesh instance to update.
+         * Returns true if the occlusion culling replaces the frustum culling.
          */
-        void updateInstance(const MeshInstance* meshInstance);
+        auto isOcclusionCullingEnabled() const { return occlusionCullingEnabled; }
 
         /**
-         * Removes a mesh instance from the scene.
-         * @param meshInstance Pointer to the mesh instance to remove.
+         * Returns the culling statistics of all the pipelines and shadow maps.
+         * The counters are read back asynchronously and are a few frames old.
          */
-        void removeInstance(const MeshInstance* meshInstance);
+        CullingStatistics getCullingStatistics() const;
 
         /**
          * Adds a light to the scene.
@@ -154,6 +201,26 @@ export namespace lysa {
            vireo::CommandList& commandList,
            const std::unordered_map<uint32, std::shared_ptr<vireo::GraphicPipeline>>& pipelines) const;
 
+        /**
+         * Issues draw calls for the opaque models drawn by the first pass of the occlusion
+         * culling, before the automatic instancing of the draw commands.
+         * @param commandList Command buffer to record into.
+         * @param pipelines   Map of material/pipeline identifiers to pipelines.
+         */
+        void drawFirstPassOpaquesModels(
+           vireo::CommandList& commandList,
+           const std::unordered_map<uint32, std::shared_ptr<vireo::GraphicPipeline>>& pipelines) const;
+
+        /**
+         * Issues draw calls for the opaque models that became visible in the second pass
+         * of the occlusion culling.
+         * @param commandList Command buffer to record into.
+         * @param pipelines   Map of material/pipeline identifiers to pipelines.
+         */
+        void drawNewlyVisibleOpaquesModels(
+           vireo::CommandList& commandList,
+           const std::unordered_map<uint32, std::shared_ptr<vireo::GraphicPipeline>>& pipelines) const;
+
         /**
          * Issues draw calls for transparent models.
          * @param commandList Command buffer to record into.
@@ -173,37 +240,38 @@ export namespace lysa {
            const std::unordered_map<uint32, std::shared_ptr<vireo::GraphicPipeline>>& pipelines) const;
 
         /**
-         * Issues multi-draw indirect calls for models.
+         * Issues multi-draw indirect calls for the models culled for a shadow map view.
          * 
          * @param commandList Command buffer to record into.
          * @param set Descriptor set index.
-         * @param culledDrawCommandsBuffers Map of buffers containing indirect draw commands.
-         * @param culledDrawCommandsCountBuffers Map of buffers containing indirect draw counts.
-         * @param frustumCullingPipelines Map of frustum culling pipelines.
+         * @param cullingView Index of the view in the culled views, see ShadowMapPass::addCullingViews().
          */
         void drawModels(
            vireo::CommandList& commandList,
            uint32 set,
-           const std::map<pipeline_id, std::shared_ptr<vireo::Buffer>>& culledDrawCommandsBuffers,
-           const std::map<pipeline_id, std::shared_ptr<vireo::Buffer>>& culledDrawCommandsCountBuffers,
-           const std::map<pipeline_id, std::shared_ptr<FrustumCulling>>& frustumCullingPipelines) const;
+           uint32 cullingView) const;
 
         /**
          * Returns the mapping of pipeline identifiers to their materials.
          * @return A reference to the pipeline to materials map.
          */
-        const auto& getPipelineIds() const { return pipelineIds; }
+        const auto& getPipelineIds() const { return sharedData.getPipelineIds(); }
 
         /**
          * Checks if materials have been updated.
          * @return True if materials were updated and pipelines/descriptors must be refreshed.
          */
-        auto isMaterialsUpdated() const { return materialsUpdated; }
+        auto isMaterialsUpdated() const {
+            return materialsUpdated || pipelineIdsVersion != sharedData.getPipelineIdsVersion();
+        }
 
         /**
          * Resets the materials updated flag.
          */
-        void resetMaterialsUpdated() { materialsUpdated = false; }
+        void resetMaterialsUpdated() {
+            materialsUpdated = false;
+            pipelineIdsVersion = sharedData.getPipelineIdsVersion();
+        }
 
         /**
          * Returns the main descriptor set.
@@ -219,6 +287,49 @@ export namespace lysa {
         auto getDescriptorSetOptional1() const { return descriptorSetOpt1; }
 #endif
 
+        /**
+         * Renders the shadow maps of all the lights in the shadow atlas.
+         * @param commandList Command buffer to record into.
+         */
+        void renderShadowMaps(vireo::CommandList& commandList) const;
+
+        /**
+         * Renders the shadow maps caches and prepares the shadow atlas for the rendering of the
+         * shadow maps in several command lists, see renderShadowMaps(vireo::CommandList&, uint32, uint32).
+         * @param commandList Command buffer to record into, submitted before the other ones.
+         * @param clear true to clear the shadow atlas.
+         */
+        void beginShadowMaps(vireo::CommandList& commandList, bool clear = true) const;
+
+        /**
+         * Renders the shadow maps of some lights in the shadow atlas, without changing the
+         * state of the scene : the command lists of several groups can be recorded in parallel.
+         * The shadow atlas must be prepared with beginShadowMaps() and finished with endShadowMaps().
+         * @param commandList Command buffer to record into.
+         * @param first Index of the first light.
+         * @param count Number of lights.
+         */
+        void renderShadowMaps(vireo::CommandList& commandList, uint32 first, uint32 count) const;
+
+        /**
+         * Makes the shadow atlas readable by the shaders after the rendering of the shadow maps.
+         * @param commandList Command buffer to record into, submitted after the other ones.
+         */
+        void endShadowMaps(vireo::CommandList& commandList) const;
+
+        /**
+         * Splits the shadow casting lights in contiguous groups with about the same number of shadow maps.
+         * @param groupsCount Maximum number of groups.
+         * @return The index of the first light and the number of lights of each group.
+         */
+        std::vector<std::pair<uint32, uint32>> splitShadowMaps(uint32 groupsCount) const;
+
+        /**
+         * Returns the number of bytes of lights and shadow maps data uploaded by the last update().
+         * Only the lights whose data changed are uploaded.
+         */
+        auto getLightsUploadSize() const { return lightsUploadSize; }
+
         /**
          * Returns the shadow map renderers.
          * @return A view over the shadow map renderer values.
@@ -230,12 +341,22 @@ export namespace lysa {
         SceneFrameData& operator=(SceneFrameData&) = delete;
 
     private:
-        /* Reference to the material manager. */
-        MaterialManager& materialManager;
-        /* Maximum number of supported lights. */
-        const uint32 maxLights;
-        /* Maximum number of mesh surfaces per pipeline. */
-        const uint32 maxMeshSurfacePerPipeline;
+        /* Slot of a light in lightsDataArray and last data written in it. */
+        struct LightSlot {
+            MemoryBlock block;
+            LightData data;
+            bool written{false};
+        };
+
+        /* Slot of a shadow casting light in shadowsDataArray and last data written in it. */
+        struct ShadowSlot {
+            MemoryBlock block;
+            ShadowData data;
+            bool written{false};
+        };
+
+        /* Mesh instances data shared by the frames in flight. */
+        SceneSharedData& sharedData;
         /* Main descriptor set for scene bindings. */
         std::shared_ptr<vireo::DescriptorSet> descriptorSet;
 #ifdef SHADOW_TRANSPARENCY_COLOR_ENABLED
@@ -248,40 +369,64 @@ export namespace lysa {
         Environment environment;
         /* Map of lights to their shadow-map render passes. */
         std::map<const Light*, std::shared_ptr<Renderpass>> shadowMapRenderers;
-        /* Array of shadow map images. */
-        std::vector<std::shared_ptr<vireo::Image>> shadowMaps;
+        /* Depth atlas holding the shadow maps of all the lights. */
+        std::shared_ptr<vireo::RenderTarget> shadowAtlas;
 #ifdef SHADOW_TRANSPARENCY_COLOR_ENABLED
-        /* Array of transparency-color shadow maps. */
-        std::vector<std::shared_ptr<vireo::Image>> shadowTransparencyColorMaps;
+        /* Transparency color atlas, with the same tiles as shadowAtlas. */
+        std::shared_ptr<vireo::RenderTarget> shadowTransparencyColorAtlas;
 #endif
-        /* Associates each light with a shadow map index. */
-        std::map<const Light*, uint32> shadowMapIndex;
+        /* Allocator of the shadow maps tiles in shadowAtlas. */
+        ShadowAtlasAllocator shadowAtlasAllocator;
+        /* Flag set once the shadow atlas is in the shader read state. */
+        bool shadowAtlasInitialized{false};
         /* Lights scheduled for removal. */
         std::unordered_set<const Light*> removedLights;
-        /* Flag set if shadow maps have changed. */
-        bool shadowMapsUpdated{false};
-
-        /* Device array for per-mesh-instance data. */
-        DeviceMemoryArray meshInstancesDataArray;
-        /* Memory blocks in meshInstancesDataArray per mesh instance. */
-        std::unordered_map<const MeshInstance*, MemoryBlock> meshInstancesDataMemoryBlocks{};
-        /* Flag set if mesh instance data changed. */
-        bool meshInstancesDataUpdated{false};
-
-        /* Mapping of pipeline id to its materials. */
-        std::unordered_map<pipeline_id, std::vector<unique_id>> pipelineIds;
-        /* Flag set when the materials list changes. */
-        bool materialsUpdated{false};
-
-        /* List of active lights. */
-        std::unordered_set<const Light*> lights;
-        /* GPU buffer for packed light parameters. */
-        std::shared_ptr<vireo::Buffer> lightsBuffer;
-        /* Number of allocated light slots in lightsBuffer. */
-        uint32 lightsBufferCount{1};
 
-        /* Recycle bin for indirect draw commands staging buffers. */
-        std::unordered_set<std::shared_ptr<vireo::Buffer>> drawCommandsStagingBufferRecycleBin;
+        /* Flag set when the shadow casting lights change. */
+        bool materialsUpdated{false};
+        /* Version of the shared pipelines list seen by the last resetMaterialsUpdated(). */
+        uint32 pipelineIdsVersion{0};
+        /* Use the two-phase occlusion culling instead of the frustum culling. */
+        bool occlusionCullingEnabled{false};
+        /* Gather the culled draw commands of the camera in instanced draw commands. */
+        bool automaticInstancingEnabled{false};
+        /* Counters of the culling shaders, see CullingStatistics. */
+        std::unique_ptr<GpuTelemetry> cullingTelemetry;
+        /* Views culled by the frustum culling : the camera then the shadow maps views. */
+        std::vector<CullingView> cullingViews;
+        /* GPU copy of cullingViews. */
+        std::shared_ptr<vireo::Buffer> cullingViewsBuffer;
+        /* Staging buffer used to upload cullingViews. */
+        std::shared_ptr<vireo::Buffer> cullingViewsStagingBuffer;
+        /* Flag set once cullingViewsBuffer has been written. */
+        bool cullingViewsUploaded{false};
+        /* Software occlusion bits of the camera view, one bit per mesh instance, see CullingView::occlusionOffset. */
+        std::vector<uint32> occlusionBits;
+        /* GPU copy of occlusionBits. */
+        std::shared_ptr<vireo::Buffer> occlusionBitsBuffer;
+        /* Staging buffer used to upload occlusionBits. */
+        std::shared_ptr<vireo::Buffer> occlusionBitsStagingBuffer;
+        /* Flag set once occlusionBitsBuffer has been written. */
+        bool occlusionBitsUploaded{false};
+
+        /* Active lights and their slots in lightsDataArray, a block of size 0 until the next update. */
+        std::unordered_map<const Light*, LightSlot> lights;
+        /* Capacity of lightsDataArray, following the number of lights up to the maximum. */
+        BufferCapacity lightsCapacity;
+        /* Device array for per-light data, the hidden lights and the free slots have an empty LightData. */
+        std::unique_ptr<DeviceMemoryArray> lightsDataArray;
+        /* Number of slots of lightsDataArray read by the shaders : the last used slot + 1. */
+        uint32 lightsSlotsCount{0};
+        /* Flag set if lights data changed. */
+        bool lightsDataUpdated{false};
+        /* Device array for the shadow maps data of the shadow casting lights. */
+        DeviceMemoryArray shadowsDataArray;
+        /* Slots of the shadow casting lights in shadowsDataArray. */
+        std::unordered_map<const Light*, ShadowSlot> shadowSlots;
+        /* Number of bytes written in lightsDataArray and shadowsDataArray by the last update. */
+        size_t lightsUploadSize{0};
+        /* Assignment of the visible lights to the clusters of the camera frustum. */
+        std::unique_ptr<LightClustering> lightClustering;
 
         /* Opaque pipelines data. */
         std::unordered_map<uint32, std::unique_ptr<GraphicPipelineData>> opaquePipelinesData;
@@ -292,22 +437,59 @@ export namespace lysa {
 
         void updatePipelinesData(
             const vireo::CommandList& commandList,
-            const std::unordered_map<uint32, std::unique_ptr<GraphicPipelineData>>& pipelinesData);
+            uint32 frameIndex,
+            const std::unordered_map<uint32, std::unique_ptr<GraphicPipelineInstances>>& pipelinesInstances,
+            std::unordered_map<uint32, std::unique_ptr<GraphicPipelineData>>& pipelinesData);
+
+        void updateLightsSlots();
+
+        void updateCullingViews(
+            const vireo::CommandList& commandList,
+            const Camera& camera,
+            const std::unordered_set<const MeshInstance*>& occludedInstances);
+
+        void updateOcclusionBits(
+            const vireo::CommandList& commandList,
+            const std::unordered_set<const MeshInstance*>& occludedInstances);
+
+        void updateShadowAtlas(const vireo::CommandList& commandList, const Camera& camera);
 
         void compute(
             const Camera& camera,
             vireo::CommandList& commandList,
             const std::unordered_map<uint32, std::unique_ptr<GraphicPipelineData>>& pipelinesData) const;
 
-        void addInstance(
-            pipeline_id pipelineId,
-            const MeshInstance*& meshInstance,
-            std::unordered_map<uint32, std::unique_ptr<GraphicPipelineData>>& pipelinesData);
+        void computeOcclusionCulling(
+            vireo::CommandList& commandList,
+            const vireo::Buffer& pyramid,
+            const DepthPyramid& pyramidLayout,
+            const vireo::Viewport& viewport,
+            const std::unordered_map<uint32, std::unique_ptr<GraphicPipelineData>>& pipelinesData) const;
+
+        /* Draw commands lists of the camera. */
+        enum class DrawCommandsList {
+            /* Culled commands, instanced if the automatic instancing is enabled. */
+            CULLED,
+            /* Commands of the first pass of the occlusion culling, not instanced yet. */
+            FIRST_PASS,
+            /* Commands newly visible in the second pass of the occlusion culling. */
+            NEWLY_VISIBLE,
+        };
 
         void drawModels(
             vireo::CommandList& commandList,
             const std::unordered_map<uint32, std::shared_ptr<vireo::GraphicPipeline>>& pipelines,
-            const std::unordered_map<uint32, std::unique_ptr<GraphicPipelineData>>& pipelinesData) const;
+            const std::unordered_map<uint32, std::unique_ptr<GraphicPipelineData>>& pipelinesData,
+            DrawCommandsList list = DrawCommandsList::CULLED) const;
+
+        /* The custom vertex shaders of the ShaderMaterial pipelines do not read the instanced draw commands. */
+        bool isInstanced(const GraphicPipelineData& pipelineData) const {
+            return automaticInstancingEnabled && pipelineData.instances.automaticInstancing;
+        }
+
+        vireo::RenderingConfiguration getShadowMapsRenderingConfiguration(bool clear) const;
+
+        void invalidateShadowMapsCaches(const AABB& aabb) const;
 
         void enableLightShadowCasting(const Light* light);
 
@@ -0,0 +1,205 @@
+/*
+* Copyright (c) 2025-present Henri Michelon
+*
+* This software is released under the MIT License.
+* https://opensource.org/licenses/MIT
+*/
+module lysa.renderers.scene_shared_data;
+
+import lysa.draw_batches;
+import lysa.exception;
+import lysa.resources.mesh;
+
+namespace lysa {
+
+    SceneSharedData::SceneSharedData(
+        const uint32 maxMeshInstancesPerScene,
+        const uint32 maxMeshSurfacePerPipeline,
+        const BufferCapacityConfiguration& drawCommandsCapacity,
+        const size_t bufferPoolFreeBudget) :
+        materialManager(ctx().res.get<MaterialManager>()),
+        maxMeshInstances(maxMeshInstancesPerScene),
+        maxMeshSurfacePerPipeline(maxMeshSurfacePerPipeline),
+        drawCommandsCapacity(drawCommandsCapacity),
+        bufferPool{ctx().vireo, ctx().config.framesInFlight, bufferPoolFreeBudget},
+        meshInstancesDataArray{ctx().vireo,
+            sizeof(MeshInstanceData),
+            maxMeshInstancesPerScene,
+            maxMeshInstancesPerScene,
+            vireo::BufferType::DEVICE_STORAGE,
+            "meshInstancesData",
+            ctx().config.framesInFlight},
+        shadowMapsCachesInvalidations(ctx().config.framesInFlight) {
+    }
+
+    void SceneSharedData::update(const vireo::CommandList& commandList, const uint32 frameIndex) {
+        bufferPool.recycle(frameIndex);
+        if (meshInstancesDataArray.isPending()) {
+            // The previous frames read the buffer before the copy, they are submitted first to the same queue
+            if (meshInstancesDataUploaded) {
+                meshInstancesDataArray.preBarrier(commandList);
+            }
+            meshInstancesDataArray.flush(commandList);
+            meshInstancesDataArray.postBarrier(commandList);
+            meshInstancesDataUploaded = true;
+        }
+        updatePipelinesInstances(commandList, frameIndex, opaquePipelinesInstances);
+        updatePipelinesInstances(commandList, frameIndex, shaderMaterialPipelinesInstances);
+        updatePipelinesInstances(commandList, frameIndex, transparentPipelinesInstances);
+    }
+
+    void SceneSharedData::updatePipelinesInstances(
+        const vireo::CommandList& commandList,
+        const uint32 frameIndex,
+        const std::unordered_map<uint32, std::unique_ptr<GraphicPipelineInstances>>& pipelinesInstances) {
+        for (const auto& pipelineInstances : std::views::values(pipelinesInstances)) {
+            pipelineInstances->updateData(commandList, frameIndex, meshInstancesDataMemoryBlocks);
+        }
+    }
+
+    std::vector<AABB> SceneSharedData::takeShadowMapsCachesInvalidations(const uint32 frameIndex) {
+        return std::exchange(shadowMapsCachesInvalidations[frameIndex], {});
+    }
+
+    void SceneSharedData::addInstance(const MeshInstance* meshInstance) {
+        const auto& mesh = meshInstance->getMesh();
+        assert([&]{ return !meshInstancesDataMemoryBlocks.contains(meshInstance);}, "Mesh instance already in the scene");
+        assert([&]{return !mesh.getMaterials().empty(); }, "Models without materials are not supported");
+        assert([&]{return mesh.isUploaded(); }, "Mesh instance is not in VRAM");
+
+        const auto meshInstanceData = meshInstance->getData();
+        meshInstancesDataMemoryBlocks[meshInstance] = meshInstancesDataArray.alloc(1);
+        meshInstancesDataArray.write(meshInstancesDataMemoryBlocks[meshInstance], &meshInstanceData);
+        updateStaticShadowCaster(meshInstance, &meshInstanceData);
+
+        auto haveTransparentMaterial{false};
+        auto haveShaderMaterial{false};
+        auto nodePipelineIds = std::set<uint32>{};
+        for (int i = 0; i < mesh.getSurfaces().size(); i++) {
+            const auto& material = materialManager[meshInstance->getSurfaceMaterial(i)];
+            haveTransparentMaterial = material.getTransparency() != Transparency::DISABLED;
+            haveShaderMaterial = material.getType() == Material::SHADER;
+            const auto id = material.getPipelineId();
+            nodePipelineIds.insert(id);
+            if (!pipelineIds.contains(id)) {
+                pipelineIds[id].push_back(material.id);
+                pipelineIdsVersion += 1;
+            }
+        }
+
+        for (const auto& pipelineId : nodePipelineIds) {
+            if (haveShaderMaterial) {
+                addInstance(pipelineId, meshInstance, shaderMaterialPipelinesInstances);
+            } else if (haveTransparentMaterial) {
+                addInstance(pipelineId, meshInstance, transparentPipelinesInstances);
+            } else {
+                addInstance(pipelineId, meshInstance, opaquePipelinesInstances);
+            }
+        }
+    }
+
+    void SceneSharedData::addInstance(
+        const pipeline_id pipelineId,
+        const MeshInstance* meshInstance,
+        std::unordered_map<uint32, std::unique_ptr<GraphicPipelineInstances>>& pipelinesInstances) {
+        if (!pipelinesInstances.contains(pipelineId)) {
+            pipelinesInstances[pipelineId] = std::make_unique<GraphicPipelineInstances>(
+                pipelineId, bufferPool, maxMeshSurfacePerPipeline, drawCommandsCapacity);
+        }
+        pipelinesInstances[pipelineId]->addInstance(meshInstance, meshInstancesDataMemoryBlocks.at(meshInstance));
+    }
+
+    void SceneSharedData::updateInstance(const MeshInstance* meshInstance) {
+        assert([&]{ return meshInstancesDataMemoryBlocks.contains(meshInstance); },
+"MeshInstance does not belong to the scene");
+        const auto meshInstanceData = meshInstance->getData();
+        meshInstancesDataArray.write(meshInstancesDataMemoryBlocks[meshInstance], &meshInstanceData);
+        updateStaticShadowCaster(meshInstance, &meshInstanceData);
+    }
+
+    void SceneSharedData::removeInstance(const MeshInstance* meshInstance) {
+        assert([&]{ return meshInstancesDataMemoryBlocks.contains(meshInstance); },
+            "MeshInstance does not belong to the scene");
+        for (const auto& pipelineId : std::views::keys(pipelineIds)) {
+            if (shaderMaterialPipelinesInstances.contains(pipelineId)) {
+                shaderMaterialPipelinesInstances[pipelineId]->removeInstance(meshInstance);
+            }
+            if (transparentPipelinesInstances.contains(pipelineId)) {
+                transparentPipelinesInstances[pipelineId]->removeInstance(meshInstance);
+            }
+            if (opaquePipelinesInstances.contains(pipelineId)) {
+                opaquePipelinesInstances[pipelineId]->removeInstance(meshInstance);
+            }
+        }
+        meshInstancesDataArray.free(meshInstancesDataMemoryBlocks.at(meshInstance));
+        meshInstancesDataMemoryBlocks.erase(meshInstance);
+        updateStaticShadowCaster(meshInstance, nullptr);
+    }
+
+    void SceneSharedData::updateStaticShadowCaster(
+        const MeshInstance* meshInstance,
+        const MeshInstanceData* meshInstanceData) {
+        const auto isCaster =
+            meshInstanceData &&
+            meshInstanceData->isStatic &&
+            meshInstanceData->castShadows &&
+            meshInstanceData->visible;
+        const auto it = staticShadowCasters.find(meshInstance);
+        if (it != staticShadowCasters.end()) {
+            const auto& previous = it->second;
+            if (isCaster &&
+                !any(previous.transform[0] != meshInstanceData->transform[0]) &&
+                !any(previous.transform[1] != meshInstanceData->transform[1]) &&
+                !any(previous.transform[2] != meshInstanceData->transform[2]) &&
+                !any(previous.transform[3] != meshInstanceData->transform[3]) &&
+                !any(previous.aabbMin != meshInstanceData->aabbMin) &&
+                !any(previous.aabbMax != meshInstanceData->aabbMax)) {
+                // Still casting at the same place, the caches are valid
+                return;
+            }
+            invalidateShadowMapsCaches({previous.aabbMin, previous.aabbMax});
+            staticShadowCasters.erase(it);
+        }
+        if (isCaster) {
+            staticShadowCasters[meshInstance] = *meshInstanceData;
+            invalidateShadowMapsCaches({meshInstanceData->aabbMin, meshInstanceData->aabbMax});
+        }
+    }
+
+    void SceneSharedData::invalidateShadowMapsCaches(const AABB& aabb) {
+        // Each frame in flight has its own shadow maps
+        for (auto& invalidations : shadowMapsCachesInvalidations) {
+            invalidations.push_back(aabb);
+        }
+    }
+
+    SceneMemoryFootprint SceneSharedData::getMemoryFootprint(
+        const uint32 maxMeshInstancesPerScene,
+        const uint32 maxMeshSurfacePerPipeline,
+        const uint32 pipelinesCount,
+        const uint32 framesInFlight) {
+        const auto instances = static_cast<size_t>(maxMeshInstancesPerScene);
+        const auto surfaces = static_cast<size_t>(maxMeshSurfacePerPipeline);
+        // Mesh instances data, then for each pipeline the instances, the draw commands and the batches
+        const auto shared =
+            sizeof(MeshInstanceData) * instances +
+            pipelinesCount * surfaces * (
+                sizeof(InstanceData) +
+                sizeof(DrawCommand) +
+                sizeof(DrawBatches::Batch) +
+                sizeof(uint32));
+        // For each pipeline the culled draw commands, the batches counters, the instance indices
+        // and the instanced draw commands, with their counters
+        const auto perFrame =
+            pipelinesCount * (
+                surfaces * (sizeof(DrawCommand) + sizeof(uint32) + sizeof(uint32) + sizeof(DrawCommand)) +
+                sizeof(uint32) * 2);
+        return {
+            .shared = shared,
+            .perFrame = perFrame,
+            .total = shared + perFrame * framesInFlight,
+            .replicated = (shared + perFrame) * framesInFlight,
+        };
+    }
+
+}
@@ -0,0 +1,203 @@
+/*
+* Copyright (c) 2025-present Henri Michelon
+*
+* This software is released under the MIT License.
+* https://opensource.org/licenses/MIT
+*/
+export module lysa.renderers.scene_shared_data;
+
+import vireo;
+import lysa.aabb;
+import lysa.buffer_capacity;
+import lysa.context;
+import lysa.math;
+import lysa.memory;
+import lysa.resources.material;
+import lysa.resources.manager;
+import lysa.resources.mesh_instance;
+import lysa.renderers.graphic_pipeline_data;
+
+export namespace lysa {
+
+    /**
+     * Device memory used by the mesh instances of a scene, see SceneSharedData::getMemoryFootprint().
+     */
+    struct SceneMemoryFootprint {
+        /** Bytes shared by the frames in flight : mesh instances data, pipelines instances, draw commands and batches. */
+        size_t shared{0};
+        /** Bytes of each frame in flight : culled draw commands and automatic instancing outputs. */
+        size_t perFrame{0};
+        /** Bytes for all the frames in flight. */
+        size_t total{0};
+        /** Bytes for all the frames in flight with one copy of the shared data per frame. */
+        size_t replicated{0};
+    };
+
+    /**
+     * Mesh instances data of a scene shared by the frames in flight.
+     *
+     * Holds the mesh instances data and, for each graphic pipeline, the instances, the draw
+     * commands and the automatic instancing batches (see GraphicPipelineInstances). The changes
+     * are applied once and uploaded by the command list of the next frame : all the frames are
+     * submitted to the same queue, so the frames in flight submitted before read the buffers
+     * before the copies, and each frame in flight uploads from its own staging buffers.
+     * Only the culling outputs are replicated per frame, in SceneFrameData.
+     */
+    class SceneSharedData {
+    public:
+        /**
+         * Creates the shared data of a scene.
+         * @param maxMeshInstancesPerScene Maximum number of mesh instances per scene.
+         * @param maxMeshSurfacePerPipeline Maximum number of mesh surfaces per pipeline.
+         * @param drawCommandsCapacity Sizing of the draw commands buffers of the pipelines.
+         * @param bufferPoolFreeBudget Maximum size in bytes of the unused buffers kept in the pool.
+         */
+        SceneSharedData(
+            uint32 maxMeshInstancesPerScene,
+            uint32 maxMeshSurfacePerPipeline,
+            const BufferCapacityConfiguration& drawCommandsCapacity,
+            size_t bufferPoolFreeBudget);
+
+        /**
+         * Adds a mesh instance.
+         * @param meshInstance Pointer to the mesh instance to add.
+         */
+        void addInstance(const MeshInstance* meshInstance);
+
+        /**
+         * Updates the data of a mesh instance.
+         * @param meshInstance Pointer to the mesh instance to update.
+         */
+        void updateInstance(const MeshInstance* meshInstance);
+
+        /**
+         * Removes a mesh instance.
+         * @param meshInstance Pointer to the mesh instance to remove.
+         */
+        void removeInstance(const MeshInstance* meshInstance);
+
+        /**
+         * Returns true if a mesh instance has been added.
+         * @param meshInstance Pointer to the mesh instance.
+         */
+        bool haveInstance(const MeshInstance* meshInstance) const {
+            return meshInstancesDataMemoryBlocks.contains(meshInstance);
+        }
+
+        /**
+         * Returns the index of an added mesh instance in the mesh instances data array.
+         * @param meshInstance Pointer to the mesh instance.
+         */
+        uint32 getInstanceIndex(const MeshInstance* meshInstance) const {
+            return meshInstancesDataMemoryBlocks.at(meshInstance).instanceIndex;
+        }
+
+        /** Returns the maximum number of mesh instances. */
+        auto getMaxMeshInstances() const { return maxMeshInstances; }
+
+        /**
+         * Uploads the changes since the last call. Called by each frame, only the first call
+         * after a change records copies.
+         * @param commandList Command buffer of the frame.
+         * @param frameIndex Index of the frame in flight, selects the staging buffers.
+         */
+        void update(const vireo::CommandList& commandList, uint32 frameIndex);
+
+        /**
+         * Returns the bounds of the static shadow casters changed since the last call for a frame,
+         * to invalidate the shadow maps caches of the frame.
+         * @param frameIndex Index of the frame in flight.
+         */
+        std::vector<AABB> takeShadowMapsCachesInvalidations(uint32 frameIndex);
+
+        /** Returns true if at least one visible static instance casts shadows. */
+        bool haveStaticShadowCasters() const { return !staticShadowCasters.empty(); }
+
+        /** Returns the mesh instances data array. */
+        const auto& getMeshInstancesDataArray() const { return meshInstancesDataArray; }
+
+        /** Returns the pool of the draw commands and culling buffers of the pipelines. */
+        auto& getBufferPool() { return bufferPool; }
+
+        /** Returns the mapping of pipeline identifiers to their materials. */
+        const auto& getPipelineIds() const { return pipelineIds; }
+
+        /** Returns a counter incremented each time a pipeline or a material is added. */
+        auto getPipelineIdsVersion() const { return pipelineIdsVersion; }
+
+        /** Returns the opaque pipelines instances. */
+        const auto& getOpaquePipelinesInstances() const { return opaquePipelinesInstances; }
+
+        /** Returns the shader material pipelines instances. */
+        const auto& getShaderMaterialPipelinesInstances() const { return shaderMaterialPipelinesInstances; }
+
+        /** Returns the transparent pipelines instances. */
+        const auto& getTransparentPipelinesInstances() const { return transparentPipelinesInstances; }
+
+        /**
+         * Estimates the device memory of the mesh instances of a scene, without the occlusion
+         * culling and the shadow maps draw commands.
+         * @param maxMeshInstancesPerScene Maximum number of mesh instances per scene.
+         * @param maxMeshSurfacePerPipeline Capacity of the draw commands buffers of each pipeline,
+         * see BufferCapacity::fit().
+         * @param pipelinesCount Number of graphic pipelines used by the scene.
+         * @param framesInFlight Number of frames in flight.
+         */
+        static SceneMemoryFootprint getMemoryFootprint(
+            uint32 maxMeshInstancesPerScene,
+            uint32 maxMeshSurfacePerPipeline,
+            uint32 pipelinesCount,
+            uint32 framesInFlight);
+
+        SceneSharedData(SceneSharedData&) = delete;
+        SceneSharedData& operator=(SceneSharedData&) = delete;
+
+    private:
+        /* Reference to the material manager. */
+        MaterialManager& materialManager;
+        /* Maximum number of mesh instances. */
+        const uint32 maxMeshInstances;
+        /* Maximum number of mesh surfaces per pipeline. */
+        const uint32 maxMeshSurfacePerPipeline;
+        /* Sizing of the draw commands buffers of the pipelines. */
+        const BufferCapacityConfiguration drawCommandsCapacity;
+        /* Pool of the draw commands and culling buffers, destroyed after the pipelines instances. */
+        BufferPool bufferPool;
+        /* Device array for per-mesh-instance data. */
+        DeviceMemoryArray meshInstancesDataArray;
+        /* Memory blocks in meshInstancesDataArray per mesh instance. */
+        std::unordered_map<const MeshInstance*, MemoryBlock> meshInstancesDataMemoryBlocks{};
+        /* Flag set once meshInstancesDataArray has been read by the shaders. */
+        bool meshInstancesDataUploaded{false};
+        /* Last data of the visible static mesh instances casting shadows, to invalidate the shadow maps caches. */
+        std::unordered_map<const MeshInstance*, MeshInstanceData> staticShadowCasters;
+        /* Changed static shadow casters bounds, per frame in flight. */
+        std::vector<std::vector<AABB>> shadowMapsCachesInvalidations;
+
+        /* Mapping of pipeline id to its materials. */
+        std::unordered_map<pipeline_id, std::vector<unique_id>> pipelineIds;
+        /* Incremented when the materials list changes. */
+        uint32 pipelineIdsVersion{0};
+        /* Opaque pipelines instances. */
+        std::unordered_map<uint32, std::unique_ptr<GraphicPipelineInstances>> opaquePipelinesInstances;
+        /* Shader material pipelines instances. */
+        std::unordered_map<uint32, std::unique_ptr<GraphicPipelineInstances>> shaderMaterialPipelinesInstances;
+        /* Transparent pipelines instances. */
+        std::unordered_map<uint32, std::unique_ptr<GraphicPipelineInstances>> transparentPipelinesInstances;
+
+        void addInstance(
+            pipeline_id pipelineId,
+            const MeshInstance* meshInstance,
+            std::unordered_map<uint32, std::unique_ptr<GraphicPipelineInstances>>& pipelinesInstances);
+
+        void updatePipelinesInstances(
+            const vireo::CommandList& commandList,
+            uint32 frameIndex,
+            const std::unordered_map<uint32, std::unique_ptr<GraphicPipelineInstances>>& pipelinesInstances);
+
+        void updateStaticShadowCaster(const MeshInstance* meshInstance, const MeshInstanceData* meshInstanceData);
+
+        void invalidateShadowMapsCaches(const AABB& aabb);
+    };
+
+}
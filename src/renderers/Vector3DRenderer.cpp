@@ -72,11 +72,8 @@ namespace lysa {
         pipelineConfig.depthWriteEnable = depthTestEnable;
         pipelineConfig.colorRenderFormats.push_back(outputFormat);
         pipelineConfig.vertexInputLayout = ctx().vireo->createVertexLayout(sizeof(Vertex), vertexAttributes);
-        auto tempBuffer = std::vector<char>{};
-        ctx().fs.loadShader(shadersName + ".vert", tempBuffer);
-        pipelineConfig.vertexShader = ctx().vireo->createShaderModule(tempBuffer, shadersName + ".vert");
-        ctx().fs.loadShader(shadersName + ".frag", tempBuffer);
-        pipelineConfig.fragmentShader = ctx().vireo->createShaderModule(tempBuffer, shadersName + ".frag");
+        pipelineConfig.vertexShader = ctx().shaders.get(shadersName + ".vert");
+        pipelineConfig.fragmentShader = ctx().shaders.get(shadersName + ".frag");
         pipelineConfig.resources = ctx().vireo->createPipelineResources(
            {
                 descriptorLayout,
@@ -98,10 +95,8 @@ namespace lysa {
         pipelineConfig.colorBlendDesc = glyphPipelineConfig.colorBlendDesc;
         pipelineImages = ctx().vireo->createGraphicPipeline(pipelineConfig, name + " images");
 
-        ctx().fs.loadShader(glyphShadersName + ".vert", tempBuffer);
-        pipelineConfig.vertexShader = ctx().vireo->createShaderModule(tempBuffer, glyphShadersName + ".vert");
-        ctx().fs.loadShader(glyphShadersName + ".frag", tempBuffer);
-        pipelineConfig.fragmentShader = ctx().vireo->createShaderModule(tempBuffer, glyphShadersName + ".frag");
+        pipelineConfig.vertexShader = ctx().shaders.get(glyphShadersName + ".vert");
+        pipelineConfig.fragmentShader = ctx().shaders.get(glyphShadersName + ".frag");
         pipelineGlyphs = ctx().vireo->createGraphicPipeline(pipelineConfig, name + " glyphs");
     }
 
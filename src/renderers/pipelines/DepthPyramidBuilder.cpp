@@ -0,0 +1,131 @@
+/*
+* Copyright (c) 2025-present Henri Michelon
+*
+* This software is released under the MIT License.
+* https://opensource.org/licenses/MIT
+*/
+module lysa.renderers.pipelines.depth_pyramid_builder;
+
+import lysa.virtual_fs;
+
+namespace lysa {
+
+    std::shared_ptr<vireo::DescriptorLayout> DepthPyramidBuilder::descriptorLayout;
+    std::shared_ptr<vireo::ShaderModule> DepthPyramidBuilder::shaderModule;
+    std::shared_ptr<vireo::Pipeline> DepthPyramidBuilder::sharedPipeline;
+
+    DepthPyramidBuilder::DepthPyramidBuilder(const RendererConfiguration& config) :
+        depthStage{
+            config.depthStencilFormat == vireo::ImageFormat::D32_SFLOAT_S8_UINT ||
+            config.depthStencilFormat == vireo::ImageFormat::D24_UNORM_S8_UINT   ?
+            vireo::ResourceState::RENDER_TARGET_DEPTH_STENCIL :
+            vireo::ResourceState::RENDER_TARGET_DEPTH} {
+        const auto& vireo = *ctx().vireo;
+        if (descriptorLayout == nullptr) {
+            descriptorLayout = vireo.createDescriptorLayout(DEBUG_NAME);
+            descriptorLayout->add(BINDING_GLOBAL, vireo::DescriptorType::UNIFORM);
+            descriptorLayout->add(BINDING_DEPTH, vireo::DescriptorType::SAMPLED_IMAGE);
+            descriptorLayout->add(BINDING_PYRAMID, vireo::DescriptorType::READWRITE_STORAGE);
+            descriptorLayout->build();
+        }
+        if (sharedPipeline == nullptr) {
+            const auto pipelineResources = vireo.createPipelineResources(
+                { descriptorLayout },
+                {},
+                DEBUG_NAME);
+            shaderModule = ctx().shaders.get(SHADER);
+            sharedPipeline = vireo.createComputePipeline(pipelineResources, shaderModule, SHADER);
+        }
+        pipeline = sharedPipeline;
+        framesData.resize(ctx().config.framesInFlight);
+    }
+
+    void DepthPyramidBuilder::cleanup() {
+        sharedPipeline.reset();
+        shaderModule.reset();
+        descriptorLayout.reset();
+    }
+
+    void DepthPyramidBuilder::resize(const vireo::Extent& extent, const std::shared_ptr<vireo::CommandList>& commandList) {
+        const auto& vireo = *ctx().vireo;
+        layout = std::make_unique<DepthPyramid>(extent.width, extent.height);
+        const auto& levels = layout->getLevels();
+        for (auto& frame : framesData) {
+            frame.pyramid = vireo.createBuffer(
+                vireo::BufferType::READWRITE_STORAGE,
+                sizeof(float) * layout->getSize(),
+                1,
+                DEBUG_NAME + "/pyramid");
+            commandList->barrier(
+                *frame.pyramid,
+                vireo::ResourceState::UNDEFINED,
+                vireo::ResourceState::COMPUTE_READ);
+            frame.globalBuffers.clear();
+            frame.descriptorSets.clear();
+            frame.depthAttachment.reset();
+            for (auto levelIndex = 0u; levelIndex < levels.size(); levelIndex++) {
+                const auto& level = levels[levelIndex];
+                const auto global = Global {
+                    .level = levelIndex,
+                    .srcOffset = levelIndex == 0 ? 0 : levels[levelIndex - 1].offset,
+                    .srcWidth = levelIndex == 0 ? extent.width : levels[levelIndex - 1].width,
+                    .srcHeight = levelIndex == 0 ? extent.height : levels[levelIndex - 1].height,
+                    .dstOffset = level.offset,
+                    .dstWidth = level.width,
+                    .dstHeight = level.height,
+                };
+                auto globalBuffer = vireo.createBuffer(
+                    vireo::BufferType::UNIFORM,
+                    sizeof(Global),
+                    1,
+                    DEBUG_NAME + "/global:" + std::to_string(levelIndex));
+                globalBuffer->map();
+                globalBuffer->write(&global);
+                globalBuffer->unmap();
+                auto descriptorSet = vireo.createDescriptorSet(descriptorLayout, DEBUG_NAME + ":" + std::to_string(levelIndex));
+                descriptorSet->update(BINDING_GLOBAL, globalBuffer);
+                descriptorSet->update(BINDING_PYRAMID, frame.pyramid);
+                frame.globalBuffers.push_back(globalBuffer);
+                frame.descriptorSets.push_back(descriptorSet);
+            }
+        }
+    }
+
+    void DepthPyramidBuilder::build(
+        vireo::CommandList& commandList,
+        const std::shared_ptr<vireo::RenderTarget>& depthAttachment,
+        const uint32 frameIndex) {
+        auto& frame = framesData[frameIndex];
+        if (frame.depthAttachment != depthAttachment) {
+            for (const auto& descriptorSet : frame.descriptorSets) {
+                descriptorSet->update(BINDING_DEPTH, depthAttachment->getImage());
+            }
+            frame.depthAttachment = depthAttachment;
+        }
+        const auto& levels = layout->getLevels();
+        commandList.barrier(
+            depthAttachment,
+            depthStage,
+            vireo::ResourceState::SHADER_READ);
+        commandList.bindPipeline(pipeline);
+        for (auto levelIndex = 0u; levelIndex < levels.size(); levelIndex++) {
+            const auto& level = levels[levelIndex];
+            commandList.barrier(
+                *frame.pyramid,
+                vireo::ResourceState::COMPUTE_READ,
+                vireo::ResourceState::COMPUTE_WRITE);
+            commandList.bindDescriptors({ frame.descriptorSets[levelIndex] });
+            commandList.dispatch((level.width + 7) / 8, (level.height + 7) / 8, 1);
+            // Makes the level visible to the next one and to the occlusion culling
+            commandList.barrier(
+                *frame.pyramid,
+                vireo::ResourceState::COMPUTE_WRITE,
+                vireo::ResourceState::COMPUTE_READ);
+        }
+        commandList.barrier(
+            depthAttachment,
+            vireo::ResourceState::SHADER_READ,
+            depthStage);
+    }
+
+}
@@ -0,0 +1,97 @@
+/*
+* Copyright (c) 2025-present Henri Michelon
+*
+* This software is released under the MIT License.
+* https://opensource.org/licenses/MIT
+*/
+export module lysa.renderers.pipelines.depth_pyramid_builder;
+
+import vireo;
+import lysa.context;
+import lysa.depth_pyramid;
+import lysa.math;
+import lysa.renderers.configuration;
+
+export namespace lysa {
+
+    /**
+     * Builds the hierarchical depth pyramid of the depth pre-pass on the GPU,
+     * one compute dispatch per level. See DepthPyramid for the layout.
+     */
+    class DepthPyramidBuilder {
+    public:
+        /**
+         * Creates the builder.
+         * @param config Renderer configuration, for the depth buffer format
+         */
+        DepthPyramidBuilder(const RendererConfiguration& config);
+
+        /**
+         * Recreates the pyramids after a resize.
+         * @param extent New size of the depth buffers
+         * @param commandList Command list used for the initial transitions
+         */
+        void resize(const vireo::Extent& extent, const std::shared_ptr<vireo::CommandList>& commandList);
+
+        /**
+         * Records the build of the pyramid of a frame.
+         * The pyramid is in the COMPUTE_READ state when finished.
+         * @param commandList Command list to record into
+         * @param depthAttachment Depth buffer written by the depth pre-pass
+         * @param frameIndex Index of the current frame
+         */
+        void build(
+            vireo::CommandList& commandList,
+            const std::shared_ptr<vireo::RenderTarget>& depthAttachment,
+            uint32 frameIndex);
+
+        /** Returns the pyramid buffer of a frame. */
+        const auto& getPyramid(const uint32 frameIndex) const { return framesData[frameIndex].pyramid; }
+
+        /** Returns the layout of the pyramids. */
+        const auto& getLayout() const { return *layout; }
+
+        static void cleanup();
+
+        virtual ~DepthPyramidBuilder() = default;
+        DepthPyramidBuilder(DepthPyramidBuilder&) = delete;
+        DepthPyramidBuilder& operator=(DepthPyramidBuilder&) = delete;
+
+    private:
+        static constexpr vireo::DescriptorIndex BINDING_GLOBAL{0};
+        static constexpr vireo::DescriptorIndex BINDING_DEPTH{1};
+        static constexpr vireo::DescriptorIndex BINDING_PYRAMID{2};
+
+        const std::string DEBUG_NAME{"DepthPyramidBuilder"};
+        const std::string SHADER{"depth_pyramid.comp"};
+
+        struct Global {
+            uint32 level;
+            uint32 srcOffset;
+            uint32 srcWidth;
+            uint32 srcHeight;
+            uint32 dstOffset;
+            uint32 dstWidth;
+            uint32 dstHeight;
+            uint32 _pad{0};
+        };
+
+        struct FrameData {
+            std::shared_ptr<vireo::Buffer> pyramid;
+            // One uniform and descriptor set per level
+            std::vector<std::shared_ptr<vireo::Buffer>> globalBuffers;
+            std::vector<std::shared_ptr<vireo::DescriptorSet>> descriptorSets;
+            // Depth buffer currently bound to the descriptor sets
+            std::shared_ptr<vireo::RenderTarget> depthAttachment;
+        };
+
+        const vireo::ResourceState depthStage;
+        std::unique_ptr<DepthPyramid> layout;
+        std::vector<FrameData> framesData;
+        std::shared_ptr<vireo::Pipeline> pipeline;
+
+        static std::shared_ptr<vireo::DescriptorLayout> descriptorLayout;
+        static std::shared_ptr<vireo::ShaderModule> shaderModule;
+        static std::shared_ptr<vireo::Pipeline> sharedPipeline;
+    };
+}
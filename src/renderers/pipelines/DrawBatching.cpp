@@ -0,0 +1,234 @@
+/*
+* Copyright (c) 2025-present Henri Michelon
+*
+* This software is released under the MIT License.
+* https://opensource.org/licenses/MIT
+*/
+module lysa.renderers.pipelines.draw_batching;
+
+import lysa.virtual_fs;
+
+namespace lysa {
+
+    std::shared_ptr<vireo::DescriptorLayout> DrawBatching::descriptorLayout;
+    std::shared_ptr<vireo::ShaderModule> DrawBatching::shaderModule;
+    std::shared_ptr<vireo::Pipeline> DrawBatching::sharedPipeline;
+
+    DrawBatching::DrawBatching(
+        const pipeline_id pipelineId,
+        const size_t drawCommandSize) :
+        debugName{DEBUG_NAME + ":" + std::to_string(pipelineId)},
+        drawCommandSize{drawCommandSize} {
+        const auto& vireo = *ctx().vireo;
+        gatherGlobalBuffer = vireo.createBuffer(vireo::BufferType::UNIFORM, sizeof(Global), 1, debugName + "/global1");
+        gatherGlobalBuffer->map();
+        emitGlobalBuffer = vireo.createBuffer(vireo::BufferType::UNIFORM, sizeof(Global), 1, debugName + "/global2");
+        emitGlobalBuffer->map();
+
+        commandClearCounterBuffer = vireo.createBuffer(vireo::BufferType::BUFFER_UPLOAD, sizeof(uint32), 1, debugName + "/commandClearCounter");
+        constexpr auto clearValue = 0;
+        commandClearCounterBuffer->map();
+        commandClearCounterBuffer->write(&clearValue);
+        commandClearCounterBuffer->unmap();
+
+        if (descriptorLayout == nullptr) {
+            descriptorLayout = vireo.createDescriptorLayout(DEBUG_NAME);
+            descriptorLayout->add(BINDING_GLOBAL, vireo::DescriptorType::UNIFORM);
+            descriptorLayout->add(BINDING_BATCHES, vireo::DescriptorType::DEVICE_STORAGE);
+            descriptorLayout->add(BINDING_INSTANCE_BATCHES, vireo::DescriptorType::DEVICE_STORAGE);
+            descriptorLayout->add(BINDING_INPUT, vireo::DescriptorType::DEVICE_STORAGE);
+            descriptorLayout->add(BINDING_INPUT_COUNTER, vireo::DescriptorType::DEVICE_STORAGE);
+            descriptorLayout->add(BINDING_BATCH_COUNTERS, vireo::DescriptorType::READWRITE_STORAGE);
+            descriptorLayout->add(BINDING_INSTANCE_INDICES, vireo::DescriptorType::READWRITE_STORAGE);
+            descriptorLayout->add(BINDING_OUTPUT, vireo::DescriptorType::READWRITE_STORAGE);
+            descriptorLayout->add(BINDING_OUTPUT_COUNTER, vireo::DescriptorType::READWRITE_STORAGE);
+            descriptorLayout->add(BINDING_STATISTICS, vireo::DescriptorType::READWRITE_STORAGE);
+            descriptorLayout->build();
+        }
+
+        gatherDescriptorSet = vireo.createDescriptorSet(descriptorLayout, debugName + "/gather");
+        emitDescriptorSet = vireo.createDescriptorSet(descriptorLayout, debugName + "/emit");
+        gatherDescriptorSet->update(BINDING_GLOBAL, gatherGlobalBuffer);
+        emitDescriptorSet->update(BINDING_GLOBAL, emitGlobalBuffer);
+
+        if (sharedPipeline == nullptr) {
+            const auto pipelineResources = vireo.createPipelineResources(
+                { descriptorLayout },
+                {},
+                DEBUG_NAME);
+            shaderModule = ctx().shaders.get(SHADER);
+            sharedPipeline = vireo.createComputePipeline(pipelineResources, shaderModule, SHADER);
+        }
+        pipeline = sharedPipeline;
+    }
+
+    void DrawBatching::reserve(const uint32 maxDrawCommands) {
+        const auto& vireo = *ctx().vireo;
+        batchCountersBuffer = vireo.createBuffer(
+            vireo::BufferType::READWRITE_STORAGE,
+            sizeof(uint32) * maxDrawCommands,
+            1,
+            debugName + "/batchCounters");
+        clearBatchCountersBuffer = vireo.createBuffer(
+            vireo::BufferType::BUFFER_UPLOAD,
+            sizeof(uint32) * maxDrawCommands,
+            1,
+            debugName + "/clearBatchCounters");
+        const auto clearValues = std::vector<uint32>(maxDrawCommands, 0);
+        clearBatchCountersBuffer->map();
+        clearBatchCountersBuffer->write(clearValues.data());
+        clearBatchCountersBuffer->unmap();
+        instanceIndicesBuffer = vireo.createBuffer(
+            vireo::BufferType::READWRITE_STORAGE,
+            sizeof(uint32) * maxDrawCommands,
+            1,
+            debugName + "/instanceIndices");
+        outputBuffer = vireo.createBuffer(
+            vireo::BufferType::READWRITE_STORAGE,
+            drawCommandSize * maxDrawCommands,
+            1,
+            debugName + "/drawCommands");
+        outputCounterBuffer = vireo.createBuffer(
+            vireo::BufferType::READWRITE_STORAGE,
+            sizeof(uint32),
+            1,
+            debugName + "/drawCommandsCounter");
+        for (const auto& descriptorSet : {gatherDescriptorSet, emitDescriptorSet}) {
+            descriptorSet->update(BINDING_BATCH_COUNTERS, batchCountersBuffer);
+            descriptorSet->update(BINDING_INSTANCE_INDICES, instanceIndicesBuffer);
+            descriptorSet->update(BINDING_OUTPUT, outputBuffer, outputCounterBuffer);
+            descriptorSet->update(BINDING_OUTPUT_COUNTER, outputCounterBuffer);
+        }
+        // The new buffers are in the undefined state
+        outputInitialized = false;
+    }
+
+    void DrawBatching::cleanup() {
+        sharedPipeline.reset();
+        shaderModule.reset();
+        descriptorLayout.reset();
+    }
+
+    void DrawBatching::dispatch(
+        vireo::CommandList& commandList,
+        const uint32 drawCommandsCount,
+        const uint32 batchesCount,
+        const vireo::Buffer& batches,
+        const vireo::Buffer& instanceBatches,
+        const vireo::Buffer& input,
+        const vireo::Buffer& counter,
+        const vireo::Buffer& statistics) {
+        const auto outputState = outputInitialized ? vireo::ResourceState::INDIRECT_DRAW : vireo::ResourceState::UNDEFINED;
+        commandList.barrier(
+            *outputCounterBuffer,
+            outputState,
+            vireo::ResourceState::COPY_DST);
+        commandList.copy(*commandClearCounterBuffer, *outputCounterBuffer);
+        commandList.barrier(
+            *outputCounterBuffer,
+            vireo::ResourceState::COPY_DST,
+            vireo::ResourceState::COMPUTE_WRITE);
+        if (drawCommandsCount == 0 || batchesCount == 0) {
+            commandList.barrier(
+                *outputCounterBuffer,
+                vireo::ResourceState::COMPUTE_WRITE,
+                vireo::ResourceState::INDIRECT_DRAW);
+            if (!outputInitialized) {
+                commandList.barrier(
+                    *outputBuffer,
+                    vireo::ResourceState::UNDEFINED,
+                    vireo::ResourceState::INDIRECT_DRAW);
+                commandList.barrier(
+                    *batchCountersBuffer,
+                    vireo::ResourceState::UNDEFINED,
+                    vireo::ResourceState::COMPUTE_READ);
+                commandList.barrier(
+                    *instanceIndicesBuffer,
+                    vireo::ResourceState::UNDEFINED,
+                    vireo::ResourceState::SHADER_READ);
+                outputInitialized = true;
+            }
+            return;
+        }
+
+        const auto gatherGlobal = Global{
+            .drawCommandsCount = drawCommandsCount,
+            .batchesCount = batchesCount,
+            .phase = PHASE_GATHER,
+        };
+        gatherGlobalBuffer->write(&gatherGlobal);
+        const auto emitGlobal = Global{
+            .drawCommandsCount = drawCommandsCount,
+            .batchesCount = batchesCount,
+            .phase = PHASE_EMIT,
+        };
+        emitGlobalBuffer->write(&emitGlobal);
+        for (const auto& descriptorSet : {gatherDescriptorSet, emitDescriptorSet}) {
+            descriptorSet->update(BINDING_BATCHES, batches);
+            descriptorSet->update(BINDING_INSTANCE_BATCHES, instanceBatches);
+            descriptorSet->update(BINDING_INPUT, input);
+            descriptorSet->update(BINDING_INPUT_COUNTER, counter);
+            descriptorSet->update(BINDING_STATISTICS, statistics);
+        }
+
+        // Gather
+        commandList.barrier(
+            *batchCountersBuffer,
+            outputInitialized ? vireo::ResourceState::COMPUTE_READ : vireo::ResourceState::UNDEFINED,
+            vireo::ResourceState::COPY_DST);
+        commandList.copy(clearBatchCountersBuffer, batchCountersBuffer, sizeof(uint32) * batchesCount);
+        commandList.barrier(
+            *batchCountersBuffer,
+            vireo::ResourceState::COPY_DST,
+            vireo::ResourceState::COMPUTE_WRITE);
+        commandList.barrier(
+            *instanceIndicesBuffer,
+            outputInitialized ? vireo::ResourceState::SHADER_READ : vireo::ResourceState::UNDEFINED,
+            vireo::ResourceState::COMPUTE_WRITE);
+        commandList.barrier(
+            input,
+            vireo::ResourceState::INDIRECT_DRAW,
+            vireo::ResourceState::COMPUTE_READ);
+        commandList.barrier(
+            counter,
+            vireo::ResourceState::INDIRECT_DRAW,
+            vireo::ResourceState::COMPUTE_READ);
+        commandList.bindPipeline(pipeline);
+        commandList.bindDescriptors({ gatherDescriptorSet });
+        commandList.dispatch((drawCommandsCount + 63) / 64, 1, 1);
+        commandList.barrier(
+            input,
+            vireo::ResourceState::COMPUTE_READ,
+            vireo::ResourceState::INDIRECT_DRAW);
+        commandList.barrier(
+            counter,
+            vireo::ResourceState::COMPUTE_READ,
+            vireo::ResourceState::INDIRECT_DRAW);
+        commandList.barrier(
+            *instanceIndicesBuffer,
+            vireo::ResourceState::COMPUTE_WRITE,
+            vireo::ResourceState::SHADER_READ);
+        commandList.barrier(
+            *batchCountersBuffer,
+            vireo::ResourceState::COMPUTE_WRITE,
+            vireo::ResourceState::COMPUTE_READ);
+
+        // Emit
+        commandList.barrier(
+            *outputBuffer,
+            outputState,
+            vireo::ResourceState::COMPUTE_WRITE);
+        commandList.bindDescriptors({ emitDescriptorSet });
+        commandList.dispatch((batchesCount + 63) / 64, 1, 1);
+        commandList.barrier(
+            *outputBuffer,
+            vireo::ResourceState::COMPUTE_WRITE,
+            vireo::ResourceState::INDIRECT_DRAW);
+        commandList.barrier(
+            *outputCounterBuffer,
+            vireo::ResourceState::COMPUTE_WRITE,
+            vireo::ResourceState::INDIRECT_DRAW);
+        outputInitialized = true;
+    }
+
+}
@@ -0,0 +1,123 @@
+/*
+* Copyright (c) 2025-present Henri Michelon
+*
+* This software is released under the MIT License.
+* https://opensource.org/licenses/MIT
+*/
+export module lysa.renderers.pipelines.draw_batching;
+
+import vireo;
+import lysa.context;
+import lysa.utils;
+import lysa.math;
+
+export namespace lysa {
+
+    /**
+     * Automatic instancing of the culled draw commands of the camera for a graphic pipeline.
+     *
+     * Gathers the culled draw commands sharing a mesh surface and a material in one instanced
+     * draw command per batch, see DrawBatches. The instance indices list is read by the vertex
+     * shaders for the draw commands with the DrawBatches::INDIRECT_INSTANCE bit.
+     * The batches are uploaded with the draw commands of the pipeline, see GraphicPipelineInstances.
+     */
+    class DrawBatching {
+    public:
+        /**
+         * Creates the compute pipeline, the buffers are created by reserve().
+         * @param pipelineId Identifier of the graphic pipeline, for debug names
+         * @param drawCommandSize Size of a draw command in the draw commands buffers
+         */
+        DrawBatching(
+            pipeline_id pipelineId,
+            size_t drawCommandSize);
+
+        /**
+         * Recreates the buffers for a number of draw commands. The buffers are used by one
+         * frame in flight only, the previous ones are released when the frame has completed.
+         * @param maxDrawCommands Capacity of the draw commands buffers of the graphic pipeline
+         */
+        void reserve(uint32 maxDrawCommands);
+
+        /**
+         * Records the gathering of the culled draw commands into the instanced draw commands.
+         * @param commandList Command list to record into
+         * @param drawCommandsCount Number of draw commands of the pipeline
+         * @param batchesCount Number of batches, see DrawBatches::getBatches()
+         * @param batches Batches of the draw commands, in the shader read state
+         * @param instanceBatches Batch of each instance index, in the shader read state
+         * @param input Culled draw commands
+         * @param counter Number of culled draw commands
+         * @param statistics Culling counters, see CullingStatistics
+         */
+        void dispatch(
+            vireo::CommandList& commandList,
+            uint32 drawCommandsCount,
+            uint32 batchesCount,
+            const vireo::Buffer& batches,
+            const vireo::Buffer& instanceBatches,
+            const vireo::Buffer& input,
+            const vireo::Buffer& counter,
+            const vireo::Buffer& statistics);
+
+        /** Returns the instanced draw commands. */
+        const auto& getDrawCommandsBuffer() const { return outputBuffer; }
+
+        /** Returns the number of instanced draw commands. */
+        const auto& getDrawCommandsCountBuffer() const { return outputCounterBuffer; }
+
+        /** Returns the instance indices list read by the vertex shaders. */
+        const auto& getInstanceIndicesBuffer() const { return instanceIndicesBuffer; }
+
+        static void cleanup();
+
+        virtual ~DrawBatching() = default;
+        DrawBatching(DrawBatching&) = delete;
+        DrawBatching& operator=(DrawBatching&) = delete;
+
+    private:
+        static constexpr vireo::DescriptorIndex BINDING_GLOBAL{0};
+        static constexpr vireo::DescriptorIndex BINDING_BATCHES{1};
+        static constexpr vireo::DescriptorIndex BINDING_INSTANCE_BATCHES{2};
+        static constexpr vireo::DescriptorIndex BINDING_INPUT{3};
+        static constexpr vireo::DescriptorIndex BINDING_INPUT_COUNTER{4};
+        static constexpr vireo::DescriptorIndex BINDING_BATCH_COUNTERS{5};
+        static constexpr vireo::DescriptorIndex BINDING_INSTANCE_INDICES{6};
+        static constexpr vireo::DescriptorIndex BINDING_OUTPUT{7};
+        static constexpr vireo::DescriptorIndex BINDING_OUTPUT_COUNTER{8};
+        static constexpr vireo::DescriptorIndex BINDING_STATISTICS{9};
+
+        static constexpr uint32 PHASE_GATHER{0};
+        static constexpr uint32 PHASE_EMIT{1};
+
+        const std::string DEBUG_NAME{"DrawBatching"};
+        const std::string SHADER{"draw_batching.comp"};
+
+        struct Global {
+            uint32 drawCommandsCount;
+            uint32 batchesCount;
+            uint32 phase;
+            uint32 _pad0;
+        };
+
+        const std::string debugName;
+        // One descriptor set and uniform per phase since both are recorded in the same frame
+        std::shared_ptr<vireo::DescriptorSet>    gatherDescriptorSet;
+        std::shared_ptr<vireo::DescriptorSet>    emitDescriptorSet;
+        std::shared_ptr<vireo::Buffer>           gatherGlobalBuffer;
+        std::shared_ptr<vireo::Buffer>           emitGlobalBuffer;
+        std::shared_ptr<vireo::Buffer>           batchCountersBuffer;
+        std::shared_ptr<vireo::Buffer>           clearBatchCountersBuffer;
+        std::shared_ptr<vireo::Buffer>           instanceIndicesBuffer;
+        std::shared_ptr<vireo::Buffer>           outputBuffer;
+        std::shared_ptr<vireo::Buffer>           outputCounterBuffer;
+        std::shared_ptr<vireo::Buffer>           commandClearCounterBuffer;
+        std::shared_ptr<vireo::Pipeline>         pipeline;
+        const size_t                             drawCommandSize;
+        bool                                     outputInitialized{false};
+
+        static std::shared_ptr<vireo::DescriptorLayout> descriptorLayout;
+        static std::shared_ptr<vireo::ShaderModule> shaderModule;
+        static std::shared_ptr<vireo::Pipeline> sharedPipeline;
+    };
+}
@@ -6,22 +6,24 @@
 */
 module lysa.renderers.pipelines.frustum_culling;
 
+import lysa.exception;
 import lysa.log;
 import lysa.virtual_fs;
 
 namespace lysa {
 
     std::shared_ptr<vireo::DescriptorLayout> FrustumCulling::descriptorLayout;
-    std::unordered_map<std::string, std::shared_ptr<vireo::ShaderModule>> FrustumCulling::shaderModules{};
-    std::unordered_map<std::string, std::shared_ptr<vireo::Pipeline>> FrustumCulling::pipelines{};
+    std::shared_ptr<vireo::ShaderModule> FrustumCulling::shaderModule;
+    std::shared_ptr<vireo::Pipeline> FrustumCulling::sharedPipeline;
 
     FrustumCulling::FrustumCulling(
-        const bool isForScene,
         const DeviceMemoryArray& meshInstancesArray,
-        pipeline_id pipelineId) {
+        const pipeline_id pipelineId,
+        const size_t drawCommandSize) :
+        drawCommandSize{drawCommandSize},
+        debugName{DEBUG_NAME + ":" + std::to_string(pipelineId)} {
         const auto& vireo = *ctx().vireo;
-        auto debugName = DEBUG_NAME + ":" + std::to_string(pipelineId);
-        globalBuffer = vireo.createBuffer(vireo::BufferType::UNIFORM, sizeof(Utils), 1, debugName + "/global");
+        globalBuffer = vireo.createBuffer(vireo::BufferType::UNIFORM, sizeof(Global), 1, debugName + "/global");
         globalBuffer->map();
         commandClearCounterBuffer = vireo.createBuffer(vireo::BufferType::BUFFER_UPLOAD, sizeof(uint32), 1, debugName + "/commandClearCounter");
         constexpr auto clearValue = 0;
@@ -29,9 +31,6 @@ namespace lysa {
         commandClearCounterBuffer->write(&clearValue);
         commandClearCounterBuffer->unmap();
 
-        downloadCounterBuffer = vireo.createBuffer(vireo::BufferType::BUFFER_DOWNLOAD, sizeof(uint32), 1, debugName + "/downloadCounter");
-        downloadCounterBuffer->map();
-
         if (descriptorLayout == nullptr) {
             descriptorLayout = vireo.createDescriptorLayout(DEBUG_NAME);
             descriptorLayout->add(BINDING_GLOBAL, vireo::DescriptorType::UNIFORM);
@@ -40,6 +39,11 @@ namespace lysa {
             descriptorLayout->add(BINDING_INPUT, vireo::DescriptorType::DEVICE_STORAGE);
             descriptorLayout->add(BINDING_OUTPUT, vireo::DescriptorType::READWRITE_STORAGE);
             descriptorLayout->add(BINDING_COUNTER, vireo::DescriptorType::READWRITE_STORAGE);
+            descriptorLayout->add(BINDING_STATISTICS, vireo::DescriptorType::READWRITE_STORAGE);
+            descriptorLayout->add(BINDING_VIEWS, vireo::DescriptorType::DEVICE_STORAGE);
+            descriptorLayout->add(BINDING_SHADOW_OUTPUT, vireo::DescriptorType::READWRITE_STORAGE);
+            descriptorLayout->add(BINDING_SHADOW_COUNTERS, vireo::DescriptorType::READWRITE_STORAGE);
+            descriptorLayout->add(BINDING_OCCLUSION_BITS, vireo::DescriptorType::DEVICE_STORAGE);
             descriptorLayout->build();
         }
 
@@ -47,91 +51,182 @@ namespace lysa {
         descriptorSet->update(BINDING_GLOBAL, globalBuffer);
         descriptorSet->update(BINDING_MESHINSTANCES, meshInstancesArray.getBuffer());
 
-        auto& shaderName = isForScene ? SHADER_SCENE : SHADER_SHADOWMAP;
-        if (!shaderModules.contains(shaderName)) {
+        if (sharedPipeline == nullptr) {
             const auto pipelineResources = vireo.createPipelineResources(
                 { descriptorLayout },
                 {},
                 DEBUG_NAME);
-            auto tempBuffer = std::vector<char>{};
-            ctx().fs.loadShader(shaderName, tempBuffer);
-            shaderModules[shaderName] = vireo.createShaderModule(tempBuffer, shaderName);
-            pipelines[shaderName] = vireo.createComputePipeline(pipelineResources, shaderModules[shaderName], shaderName);
+            shaderModule = ctx().shaders.get(SHADER);
+            sharedPipeline = vireo.createComputePipeline(pipelineResources, shaderModule, SHADER);
         }
-        pipeline = pipelines[shaderName];
+        pipeline = sharedPipeline;
     }
 
     void FrustumCulling::cleanup() {
-        pipelines.clear();
-        shaderModules.clear();
+        sharedPipeline.reset();
+        shaderModule.reset();
         descriptorLayout.reset();
     }
 
+    void FrustumCulling::reserve(
+        const vireo::CommandList& commandList,
+        const uint32 shadowViewsCount,
+        const uint32 drawCommandsCount,
+        const uint32 maxDrawCommandsCount) {
+        // The buffers are always bound to the shader, even without shadow views
+        const auto viewsCount = std::max(1u, shadowViewsCount);
+        if (viewsCount <= shadowViewsCapacity && drawCommandsCount <= shadowDrawCommandsStride) { return; }
+        shadowViewsCapacity = std::max(viewsCount, shadowViewsCapacity);
+        if (drawCommandsCount > shadowDrawCommandsStride || shadowDrawCommandsStride == 0) {
+            // Grows by steps to avoid a reallocation each time a mesh instance is added
+            shadowDrawCommandsStride = std::min(
+                maxDrawCommandsCount,
+                std::max({drawCommandsCount, shadowDrawCommandsStride * 2, 64u}));
+        }
+        const auto& vireo = *ctx().vireo;
+        shadowDrawCommandsBuffer = vireo.createBuffer(
+            vireo::BufferType::READWRITE_STORAGE,
+            drawCommandSize * shadowDrawCommandsStride * shadowViewsCapacity,
+            1,
+            debugName + "/shadowDrawCommands");
+        shadowDrawCommandsCountBuffer = vireo.createBuffer(
+            vireo::BufferType::READWRITE_STORAGE,
+            sizeof(uint32) * shadowViewsCapacity,
+            1,
+            debugName + "/shadowDrawCommandsCount");
+        shadowClearCountersBuffer = vireo.createBuffer(
+            vireo::BufferType::BUFFER_UPLOAD,
+            sizeof(uint32) * shadowViewsCapacity,
+            1,
+            debugName + "/shadowClearCounters");
+        const auto clearValues = std::vector<uint32>(shadowViewsCapacity, 0);
+        shadowClearCountersBuffer->map();
+        shadowClearCountersBuffer->write(clearValues.data());
+        shadowClearCountersBuffer->unmap();
+        commandList.barrier(
+            *shadowDrawCommandsBuffer,
+            vireo::ResourceState::UNDEFINED,
+            vireo::ResourceState::INDIRECT_DRAW);
+        commandList.barrier(
+            *shadowDrawCommandsCountBuffer,
+            vireo::ResourceState::UNDEFINED,
+            vireo::ResourceState::INDIRECT_DRAW);
+        descriptorSet->update(BINDING_SHADOW_OUTPUT, shadowDrawCommandsBuffer);
+        descriptorSet->update(BINDING_SHADOW_COUNTERS, shadowDrawCommandsCountBuffer);
+    }
+
     void FrustumCulling::dispatch(
         vireo::CommandList& commandList,
         const uint32 drawCommandsCount,
-        const float4x4& view,
-        const float4x4& projection,
+        const vireo::Buffer& views,
+        const uint32 viewsCount,
+        const vireo::Buffer& occlusionBits,
+        const bool cullCamera,
         const vireo::Buffer& instances,
         const vireo::Buffer& input,
         const vireo::Buffer& output,
-        const vireo::Buffer& counter) {
-        commandList.barrier(
-            counter,
-            vireo::ResourceState::INDIRECT_DRAW,
-            vireo::ResourceState::COPY_DST);
-        commandList.copy(*commandClearCounterBuffer, counter);
-        commandList.barrier(
-            counter,
-            vireo::ResourceState::COPY_DST,
-            vireo::ResourceState::COMPUTE_WRITE);
-        if (drawCommandsCount == 0) { return; }
+        const vireo::Buffer& counter,
+        const vireo::Buffer& statistics) {
+        assert([&]{ return shadowDrawCommandsBuffer != nullptr; }, "FrustumCulling::reserve() not called");
+        assert([&]{ return viewsCount - 1 <= shadowViewsCapacity; }, "Too many shadow views");
+        assert([&]{ return drawCommandsCount <= shadowDrawCommandsStride; }, "Too many draw commands");
+        const auto firstView = cullCamera ? 0u : 1u;
+        if (cullCamera) {
+            commandList.barrier(
+                counter,
+                vireo::ResourceState::INDIRECT_DRAW,
+                vireo::ResourceState::COPY_DST);
+            commandList.copy(*commandClearCounterBuffer, counter);
+            commandList.barrier(
+                counter,
+                vireo::ResourceState::COPY_DST,
+                vireo::ResourceState::COMPUTE_WRITE);
+        }
+        if (viewsCount > 1) {
+            commandList.barrier(
+                *shadowDrawCommandsCountBuffer,
+                vireo::ResourceState::INDIRECT_DRAW,
+                vireo::ResourceState::COPY_DST);
+            commandList.copy(*shadowClearCountersBuffer, *shadowDrawCommandsCountBuffer);
+            commandList.barrier(
+                *shadowDrawCommandsCountBuffer,
+                vireo::ResourceState::COPY_DST,
+                vireo::ResourceState::COMPUTE_WRITE);
+        }
+        if (drawCommandsCount == 0 || firstView >= viewsCount) {
+            if (cullCamera) {
+                commandList.barrier(
+                    counter,
+                    vireo::ResourceState::COMPUTE_WRITE,
+                    vireo::ResourceState::INDIRECT_DRAW);
+            }
+            if (viewsCount > 1) {
+                commandList.barrier(
+                    *shadowDrawCommandsCountBuffer,
+                    vireo::ResourceState::COMPUTE_WRITE,
+                    vireo::ResourceState::INDIRECT_DRAW);
+            }
+            return;
+        }
 
-        auto global = Utils{
+        const auto global = Global{
             .drawCommandsCount = drawCommandsCount,
-            .viewMatrix = inverse(view),
+            .firstView = firstView,
+            .shadowDrawCommandsStride = shadowDrawCommandsStride,
         };
-        Frustum::extractPlanes(global.planes, mul(global.viewMatrix, projection));
         globalBuffer->write(&global);
 
         descriptorSet->update(BINDING_INSTANCES, instances);
         descriptorSet->update(BINDING_INPUT, input);
         descriptorSet->update(BINDING_OUTPUT, output, counter);
         descriptorSet->update(BINDING_COUNTER, counter);
+        descriptorSet->update(BINDING_STATISTICS, statistics);
+        descriptorSet->update(BINDING_VIEWS, views);
+        descriptorSet->update(BINDING_OCCLUSION_BITS, occlusionBits);
 
         commandList.barrier(
             input,
             vireo::ResourceState::INDIRECT_DRAW,
             vireo::ResourceState::COMPUTE_READ);
-        commandList.barrier(
-            output,
-            vireo::ResourceState::INDIRECT_DRAW,
-            vireo::ResourceState::COMPUTE_WRITE);
+        if (cullCamera) {
+            commandList.barrier(
+                output,
+                vireo::ResourceState::INDIRECT_DRAW,
+                vireo::ResourceState::COMPUTE_WRITE);
+        }
+        if (viewsCount > 1) {
+            commandList.barrier(
+                *shadowDrawCommandsBuffer,
+                vireo::ResourceState::INDIRECT_DRAW,
+                vireo::ResourceState::COMPUTE_WRITE);
+        }
         commandList.bindPipeline(pipeline);
         commandList.bindDescriptors({ descriptorSet });
-        commandList.dispatch((drawCommandsCount + 63) / 64, 1, 1);
-        commandList.barrier(
-            output,
-            vireo::ResourceState::COMPUTE_WRITE,
-            vireo::ResourceState::INDIRECT_DRAW);
+        commandList.dispatch((drawCommandsCount + 63) / 64, viewsCount - firstView, 1);
         commandList.barrier(
             input,
             vireo::ResourceState::COMPUTE_READ,
             vireo::ResourceState::INDIRECT_DRAW);
-
-        commandList.barrier(
-            counter,
-            vireo::ResourceState::COMPUTE_WRITE,
-            vireo::ResourceState::COPY_SRC);
-        commandList.copy(counter, *downloadCounterBuffer);
-        commandList.barrier(
-            counter,
-            vireo::ResourceState::COPY_SRC,
-            vireo::ResourceState::INDIRECT_DRAW);
-    }
-
-    uint32 FrustumCulling::getDrawCommandsCount() const {
-        return *static_cast<uint32*>(downloadCounterBuffer->getMappedAddress());
+        if (cullCamera) {
+            commandList.barrier(
+                output,
+                vireo::ResourceState::COMPUTE_WRITE,
+                vireo::ResourceState::INDIRECT_DRAW);
+            commandList.barrier(
+                counter,
+                vireo::ResourceState::COMPUTE_WRITE,
+                vireo::ResourceState::INDIRECT_DRAW);
+        }
+        if (viewsCount > 1) {
+            commandList.barrier(
+                *shadowDrawCommandsBuffer,
+                vireo::ResourceState::COMPUTE_WRITE,
+                vireo::ResourceState::INDIRECT_DRAW);
+            commandList.barrier(
+                *shadowDrawCommandsCountBuffer,
+                vireo::ResourceState::COMPUTE_WRITE,
+                vireo::ResourceState::INDIRECT_DRAW);
+        }
     }
 
-}
\ No newline at end of file
+}
@@ -8,30 +8,114 @@ export module lysa.renderers.pipelines.frustum_culling;
 
 import vireo;
 import lysa.context;
-import lysa.frustum;
 import lysa.utils;
 import lysa.math;
 import lysa.memory;
 
 export namespace lysa {
+
+    /**
+     * Counters of the culling shaders, incremented in a GpuTelemetry counters buffer.
+     */
+    struct CullingStatistics {
+        /** Index of the commands outside the camera frustum or hidden. */
+        static constexpr uint32 FRUSTUM_CULLED{0};
+        /** Index of the commands drawn by the frustum culling or the first occlusion culling pass. */
+        static constexpr uint32 DRAWN{1};
+        /** Index of the commands inside the frustum hidden by the depth pyramid. */
+        static constexpr uint32 OCCLUDED{2};
+        /** Index of the commands newly visible, drawn by the second occlusion culling pass. */
+        static constexpr uint32 SECOND_PASS_DRAWN{3};
+        /** Index of the commands outside the shadow maps frustums. */
+        static constexpr uint32 SHADOW_CULLED{4};
+        /** Index of the commands drawn in the shadow maps. */
+        static constexpr uint32 SHADOW_DRAWN{5};
+        /** Index of the commands of static instances not drawn because already in a shadow map cache. */
+        static constexpr uint32 SHADOW_CACHED{6};
+        /** Index of the instanced draw commands of the camera, see DrawBatching. */
+        static constexpr uint32 INSTANCED_DRAWN{7};
+        /** Number of counters. */
+        static constexpr uint32 COUNT{8};
+
+        uint32 frustumCulled{0};
+        uint32 drawn{0};
+        uint32 occluded{0};
+        uint32 secondPassDrawn{0};
+        uint32 shadowCulled{0};
+        uint32 shadowDrawn{0};
+        uint32 shadowCached{0};
+        uint32 instancedDrawn{0};
+    };
+
+    /**
+     * Culls the draw commands of a graphic pipeline against a list of views in one dispatch.
+     *
+     * View 0 is the main camera, its draw commands are compacted into the culled draw
+     * commands buffer of the pipeline. The next views are the shadow maps views, their draw
+     * commands are compacted into a shared buffer with one range of getShadowDrawCommandsStride()
+     * commands and one counter per view.
+     */
     class FrustumCulling {
     public:
+        /**
+         * Creates the culling pipeline of a graphic pipeline.
+         * @param meshInstancesArray Mesh instances data of the scene
+         * @param pipelineId Identifier of the graphic pipeline
+         * @param drawCommandSize Size of a draw command in the draw commands buffers
+         */
         FrustumCulling(
-            bool isForScene,
             const DeviceMemoryArray& meshInstancesArray,
-            pipeline_id pipelineId);
+            pipeline_id pipelineId,
+            size_t drawCommandSize);
 
+        /**
+         * Grows the shadow views draw commands buffers if needed.
+         * @param commandList Command list used to initialize the new buffers
+         * @param shadowViewsCount Number of shadow views culled
+         * @param drawCommandsCount Number of draw commands of the pipeline
+         * @param maxDrawCommandsCount Maximum number of draw commands of the pipeline
+         */
+        void reserve(
+            const vireo::CommandList& commandList,
+            uint32 shadowViewsCount,
+            uint32 drawCommandsCount,
+            uint32 maxDrawCommandsCount);
+
+        /**
+         * Culls the draw commands against the views.
+         * @param commandList Command list to record into
+         * @param drawCommandsCount Number of draw commands of the pipeline
+         * @param views Views to cull against, see CullingView
+         * @param viewsCount Number of views
+         * @param occlusionBits Software occlusion bits of the camera views, see CullingView::occlusionOffset
+         * @param cullCamera false to skip the camera view when culled by the occlusion culling
+         * @param instances Instances of the pipeline
+         * @param input Draw commands of the pipeline
+         * @param output Culled draw commands for the camera
+         * @param counter Number of culled draw commands for the camera
+         * @param statistics Culling counters, see CullingStatistics
+         */
         void dispatch(
             vireo::CommandList& commandList,
             uint32 drawCommandsCount,
-            const float4x4& view,
-            const float4x4& projection,
+            const vireo::Buffer& views,
+            uint32 viewsCount,
+            const vireo::Buffer& occlusionBits,
+            bool cullCamera,
             const vireo::Buffer& instances,
             const vireo::Buffer& input,
             const vireo::Buffer& output,
-            const vireo::Buffer& counter);
+            const vireo::Buffer& counter,
+            const vireo::Buffer& statistics);
+
+        /** Returns the culled draw commands of the shadow views. */
+        const auto& getShadowDrawCommandsBuffer() const { return shadowDrawCommandsBuffer; }
 
-        uint32 getDrawCommandsCount() const;
+        /** Returns the number of culled draw commands of each shadow view. */
+        const auto& getShadowDrawCommandsCountBuffer() const { return shadowDrawCommandsCountBuffer; }
+
+        /** Returns the number of draw commands reserved for each shadow view. */
+        auto getShadowDrawCommandsStride() const { return shadowDrawCommandsStride; }
 
         static void cleanup();
 
@@ -46,25 +130,37 @@ export namespace lysa {
         static constexpr vireo::DescriptorIndex BINDING_INPUT{3};
         static constexpr vireo::DescriptorIndex BINDING_OUTPUT{4};
         static constexpr vireo::DescriptorIndex BINDING_COUNTER{5};
+        static constexpr vireo::DescriptorIndex BINDING_STATISTICS{6};
+        static constexpr vireo::DescriptorIndex BINDING_VIEWS{7};
+        static constexpr vireo::DescriptorIndex BINDING_SHADOW_OUTPUT{8};
+        static constexpr vireo::DescriptorIndex BINDING_SHADOW_COUNTERS{9};
+        static constexpr vireo::DescriptorIndex BINDING_OCCLUSION_BITS{10};
 
         const std::string DEBUG_NAME{"FrustumCulling"};
-        const std::string SHADER_SCENE{"frustum_culling.comp"};
-        const std::string SHADER_SHADOWMAP{"frustum_culling_shadowmap.comp"};
+        const std::string SHADER{"frustum_culling.comp"};
 
-        struct Utils {
+        struct Global {
             uint32 drawCommandsCount;
-            Frustum::Plane planes[6];
-            float4x4 viewMatrix;
+            uint32 firstView;
+            uint32 shadowDrawCommandsStride;
+            uint32 _pad0;
         };
 
+        const size_t drawCommandSize;
+        const std::string debugName;
         std::shared_ptr<vireo::DescriptorSet>    descriptorSet;
         std::shared_ptr<vireo::Buffer>           globalBuffer;
         std::shared_ptr<vireo::Buffer>           commandClearCounterBuffer;
-        std::shared_ptr<vireo::Buffer>           downloadCounterBuffer;
         std::shared_ptr<vireo::Pipeline>         pipeline;
 
+        uint32 shadowViewsCapacity{0};
+        uint32 shadowDrawCommandsStride{0};
+        std::shared_ptr<vireo::Buffer>           shadowDrawCommandsBuffer;
+        std::shared_ptr<vireo::Buffer>           shadowDrawCommandsCountBuffer;
+        std::shared_ptr<vireo::Buffer>           shadowClearCountersBuffer;
+
         static std::shared_ptr<vireo::DescriptorLayout> descriptorLayout;
-        static std::unordered_map<std::string, std::shared_ptr<vireo::ShaderModule>> shaderModules;
-        static std::unordered_map<std::string, std::shared_ptr<vireo::Pipeline>> pipelines;
+        static std::shared_ptr<vireo::ShaderModule> shaderModule;
+        static std::shared_ptr<vireo::Pipeline> sharedPipeline;
     };
 }
\ No newline at end of file
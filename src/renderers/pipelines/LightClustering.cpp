@@ -0,0 +1,91 @@
+/*
+* Copyright (c) 2025-present Henri Michelon
+*
+* This software is released under the MIT License.
+* https://opensource.org/licenses/MIT
+*/
+module lysa.renderers.pipelines.light_clustering;
+
+import lysa.virtual_fs;
+
+namespace lysa {
+
+    std::shared_ptr<vireo::DescriptorLayout> LightClustering::descriptorLayout;
+    std::shared_ptr<vireo::ShaderModule> LightClustering::shaderModule;
+    std::shared_ptr<vireo::Pipeline> LightClustering::pipeline;
+
+    LightClustering::LightClustering(const std::string& name) {
+        const auto& vireo = *ctx().vireo;
+        globalBuffer = vireo.createBuffer(vireo::BufferType::UNIFORM, sizeof(Global), 1, name + "/global");
+        globalBuffer->map();
+        clustersBuffer = vireo.createBuffer(
+            vireo::BufferType::READWRITE_STORAGE,
+            sizeof(uint32) * LightClusters::CLUSTER_STRIDE * LightClusters::COUNT,
+            1,
+            name);
+
+        if (descriptorLayout == nullptr) {
+            descriptorLayout = vireo.createDescriptorLayout(DEBUG_NAME);
+            descriptorLayout->add(BINDING_GLOBAL, vireo::DescriptorType::UNIFORM);
+            descriptorLayout->add(BINDING_LIGHTS, vireo::DescriptorType::DEVICE_STORAGE);
+            descriptorLayout->add(BINDING_CLUSTERS, vireo::DescriptorType::READWRITE_STORAGE);
+            descriptorLayout->build();
+        }
+
+        descriptorSet = vireo.createDescriptorSet(descriptorLayout, name);
+        descriptorSet->update(BINDING_GLOBAL, globalBuffer);
+        descriptorSet->update(BINDING_CLUSTERS, clustersBuffer);
+
+        if (pipeline == nullptr) {
+            const auto pipelineResources = vireo.createPipelineResources(
+                { descriptorLayout },
+                {},
+                DEBUG_NAME);
+            shaderModule = ctx().shaders.get(SHADER);
+            pipeline = vireo.createComputePipeline(pipelineResources, shaderModule, SHADER);
+        }
+    }
+
+    void LightClustering::cleanup() {
+        pipeline.reset();
+        shaderModule.reset();
+        descriptorLayout.reset();
+    }
+
+    void LightClustering::dispatch(
+        vireo::CommandList& commandList,
+        const Camera& camera,
+        const std::shared_ptr<vireo::Buffer>& lights,
+        const uint32 lightsCount,
+        const bool asyncCompute) {
+        const auto global = Global{
+            .view = inverse(camera.transform),
+            .inverseProjection = inverse(camera.projection),
+            .near = camera.near,
+            .far = camera.far,
+            .lightsCount = lightsCount,
+        };
+        globalBuffer->write(&global);
+        // The lights buffer grows with the number of lights
+        if (lights != lightsBuffer) {
+            descriptorSet->update(BINDING_LIGHTS, lights);
+            lightsBuffer = lights;
+        }
+
+        // Every cluster is written again, and the fragment shaders reading it in the previous use
+        // of the frame in flight are completed : the compute queue does not wait for them
+        commandList.barrier(
+            *clustersBuffer,
+            asyncCompute ? vireo::ResourceState::UNDEFINED : clustersState,
+            vireo::ResourceState::COMPUTE_WRITE);
+        commandList.bindPipeline(pipeline);
+        commandList.bindDescriptors({ descriptorSet });
+        commandList.dispatch((LightClusters::COUNT + GROUP_SIZE - 1) / GROUP_SIZE, 1, 1);
+        clustersState = asyncCompute ? vireo::ResourceState::COMPUTE_READ : vireo::ResourceState::SHADER_READ;
+        commandList.barrier(
+            *clustersBuffer,
+            vireo::ResourceState::COMPUTE_WRITE,
+            clustersState);
+    }
+
+}
@@ -0,0 +1,83 @@
+/*
+* Copyright (c) 2025-present Henri Michelon
+*
+* This software is released under the MIT License.
+* https://opensource.org/licenses/MIT
+*/
+export module lysa.renderers.pipelines.light_clustering;
+
+import vireo;
+import lysa.context;
+import lysa.light_clusters;
+import lysa.math;
+import lysa.resources.camera;
+
+export namespace lysa {
+
+    /**
+     * Assigns the lights of a scene to the clusters of the camera frustum in one dispatch.
+     * See LightClusters for the layout of the clusters buffer read by the lighting shaders.
+     */
+    class LightClustering {
+    public:
+        /**
+         * Creates the clusters buffer and the compute pipeline.
+         * @param name Name of the clusters buffer for GPU-side debug
+         */
+        LightClustering(const std::string& name);
+
+        /**
+         * Records the light assignment.
+         * The clusters buffer is in the SHADER_READ state when finished, or in the COMPUTE_READ
+         * state in a compute queue : the graphic queue then waits for the dispatch with a semaphore.
+         * @param commandList Command list to record into
+         * @param camera The current camera
+         * @param lights Lights buffer of the scene, in the SHADER_READ state
+         * @param lightsCount Number of lights in the lights buffer
+         * @param asyncCompute True if the command list is submitted to the compute queue
+         */
+        void dispatch(
+            vireo::CommandList& commandList,
+            const Camera& camera,
+            const std::shared_ptr<vireo::Buffer>& lights,
+            uint32 lightsCount,
+            bool asyncCompute = false);
+
+        /** Returns the clusters buffer. */
+        const auto& getClustersBuffer() const { return clustersBuffer; }
+
+        static void cleanup();
+
+        virtual ~LightClustering() = default;
+        LightClustering(LightClustering&) = delete;
+        LightClustering& operator=(LightClustering&) = delete;
+
+    private:
+        static constexpr vireo::DescriptorIndex BINDING_GLOBAL{0};
+        static constexpr vireo::DescriptorIndex BINDING_LIGHTS{1};
+        static constexpr vireo::DescriptorIndex BINDING_CLUSTERS{2};
+
+        const std::string DEBUG_NAME{"LightClustering"};
+        const std::string SHADER{"light_clustering.comp"};
+        static constexpr uint32 GROUP_SIZE{64};
+
+        struct Global {
+            float4x4 view;
+            float4x4 inverseProjection;
+            float    near;
+            float    far;
+            uint32   lightsCount;
+            uint32   _pad0;
+        };
+
+        std::shared_ptr<vireo::DescriptorSet>    descriptorSet;
+        std::shared_ptr<vireo::Buffer>           globalBuffer;
+        std::shared_ptr<vireo::Buffer>           clustersBuffer;
+        std::shared_ptr<vireo::Buffer>           lightsBuffer;
+        vireo::ResourceState                     clustersState{vireo::ResourceState::UNDEFINED};
+
+        static std::shared_ptr<vireo::DescriptorLayout> descriptorLayout;
+        static std::shared_ptr<vireo::ShaderModule> shaderModule;
+        static std::shared_ptr<vireo::Pipeline> pipeline;
+    };
+}
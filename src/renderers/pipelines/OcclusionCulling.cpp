@@ -0,0 +1,278 @@
+/*
+* Copyright (c) 2025-present Henri Michelon
+*
+* This software is released under the MIT License.
+* https://opensource.org/licenses/MIT
+*/
+module lysa.renderers.pipelines.occlusion_culling;
+
+import lysa.log;
+import lysa.virtual_fs;
+
+namespace lysa {
+
+    std::shared_ptr<vireo::DescriptorLayout> OcclusionCulling::descriptorLayout;
+    std::shared_ptr<vireo::ShaderModule> OcclusionCulling::shaderModule;
+    std::shared_ptr<vireo::Pipeline> OcclusionCulling::sharedPipeline;
+
+    OcclusionCulling::OcclusionCulling(
+        const DeviceMemoryArray& meshInstancesArray,
+        const pipeline_id pipelineId,
+        const size_t drawCommandSize,
+        const uint32 maxDrawCommands) :
+        debugName{DEBUG_NAME + ":" + std::to_string(pipelineId)},
+        drawCommandSize{drawCommandSize} {
+        const auto& vireo = *ctx().vireo;
+        firstPassGlobalBuffer = vireo.createBuffer(vireo::BufferType::UNIFORM, sizeof(Global), 1, debugName + "/global1");
+        firstPassGlobalBuffer->map();
+        secondPassGlobalBuffer = vireo.createBuffer(vireo::BufferType::UNIFORM, sizeof(Global), 1, debugName + "/global2");
+        secondPassGlobalBuffer->map();
+        newlyVisibleCounterBuffer = vireo.createBuffer(
+            vireo::BufferType::READWRITE_STORAGE,
+            sizeof(uint32),
+            1,
+            debugName + "/newlyVisibleCounter");
+
+        commandClearCounterBuffer = vireo.createBuffer(vireo::BufferType::BUFFER_UPLOAD, sizeof(uint32), 1, debugName + "/commandClearCounter");
+        constexpr auto clearValue = 0;
+        commandClearCounterBuffer->map();
+        commandClearCounterBuffer->write(&clearValue);
+        commandClearCounterBuffer->unmap();
+
+        if (descriptorLayout == nullptr) {
+            descriptorLayout = vireo.createDescriptorLayout(DEBUG_NAME);
+            descriptorLayout->add(BINDING_GLOBAL, vireo::DescriptorType::UNIFORM);
+            descriptorLayout->add(BINDING_MESHINSTANCES, vireo::DescriptorType::DEVICE_STORAGE);
+            descriptorLayout->add(BINDING_INSTANCES, vireo::DescriptorType::DEVICE_STORAGE);
+            descriptorLayout->add(BINDING_INPUT, vireo::DescriptorType::DEVICE_STORAGE);
+            descriptorLayout->add(BINDING_OUTPUT, vireo::DescriptorType::READWRITE_STORAGE);
+            descriptorLayout->add(BINDING_COUNTER, vireo::DescriptorType::READWRITE_STORAGE);
+            descriptorLayout->add(BINDING_NEWLY_VISIBLE, vireo::DescriptorType::READWRITE_STORAGE);
+            descriptorLayout->add(BINDING_NEWLY_VISIBLE_COUNTER, vireo::DescriptorType::READWRITE_STORAGE);
+            descriptorLayout->add(BINDING_VISIBILITY, vireo::DescriptorType::READWRITE_STORAGE);
+            descriptorLayout->add(BINDING_STATISTICS, vireo::DescriptorType::READWRITE_STORAGE);
+            descriptorLayout->add(BINDING_PYRAMID, vireo::DescriptorType::READWRITE_STORAGE);
+            descriptorLayout->add(BINDING_OCCLUSION_BITS, vireo::DescriptorType::DEVICE_STORAGE);
+            descriptorLayout->build();
+        }
+
+        firstPassDescriptorSet = vireo.createDescriptorSet(descriptorLayout, debugName + "/first");
+        secondPassDescriptorSet = vireo.createDescriptorSet(descriptorLayout, debugName + "/second");
+        for (const auto& descriptorSet : {firstPassDescriptorSet, secondPassDescriptorSet}) {
+            descriptorSet->update(BINDING_MESHINSTANCES, meshInstancesArray.getBuffer());
+            descriptorSet->update(BINDING_NEWLY_VISIBLE_COUNTER, newlyVisibleCounterBuffer);
+        }
+        firstPassDescriptorSet->update(BINDING_GLOBAL, firstPassGlobalBuffer);
+        secondPassDescriptorSet->update(BINDING_GLOBAL, secondPassGlobalBuffer);
+        reserve(maxDrawCommands);
+
+        if (sharedPipeline == nullptr) {
+            const auto pipelineResources = vireo.createPipelineResources(
+                { descriptorLayout },
+                {},
+                DEBUG_NAME);
+            shaderModule = ctx().shaders.get(SHADER);
+            sharedPipeline = vireo.createComputePipeline(pipelineResources, shaderModule, SHADER);
+        }
+        pipeline = sharedPipeline;
+    }
+
+    void OcclusionCulling::reserve(const uint32 maxDrawCommands) {
+        const auto& vireo = *ctx().vireo;
+        visibilityBuffer = vireo.createBuffer(
+            vireo::BufferType::READWRITE_STORAGE,
+            sizeof(uint32) * maxDrawCommands,
+            1,
+            debugName + "/visibility");
+        newlyVisibleBuffer = vireo.createBuffer(
+            vireo::BufferType::READWRITE_STORAGE,
+            drawCommandSize * maxDrawCommands,
+            1,
+            debugName + "/newlyVisible");
+        for (const auto& descriptorSet : {firstPassDescriptorSet, secondPassDescriptorSet}) {
+            descriptorSet->update(BINDING_NEWLY_VISIBLE, newlyVisibleBuffer, newlyVisibleCounterBuffer);
+            descriptorSet->update(BINDING_VISIBILITY, visibilityBuffer);
+        }
+        // The first pass does not read the pyramid but the binding must be valid
+        firstPassDescriptorSet->update(BINDING_PYRAMID, visibilityBuffer);
+        // The new visibility buffer is empty
+        visibilityValid = false;
+    }
+
+    void OcclusionCulling::cleanup() {
+        sharedPipeline.reset();
+        shaderModule.reset();
+        descriptorLayout.reset();
+    }
+
+    void OcclusionCulling::dispatchFirstPass(
+        vireo::CommandList& commandList,
+        const uint32 drawCommandsCount,
+        const float4x4& view,
+        const float4x4& projection,
+        const vireo::Buffer& occlusionBits,
+        const uint32 occlusionOffset,
+        const vireo::Buffer& instances,
+        const vireo::Buffer& input,
+        const vireo::Buffer& output,
+        const vireo::Buffer& counter,
+        const vireo::Buffer& statistics) {
+        commandList.barrier(
+            counter,
+            vireo::ResourceState::INDIRECT_DRAW,
+            vireo::ResourceState::COPY_DST);
+        commandList.copy(*commandClearCounterBuffer, counter);
+        commandList.barrier(
+            counter,
+            vireo::ResourceState::COPY_DST,
+            vireo::ResourceState::COMPUTE_WRITE);
+        if (drawCommandsCount == 0) {
+            commandList.barrier(
+                counter,
+                vireo::ResourceState::COMPUTE_WRITE,
+                vireo::ResourceState::INDIRECT_DRAW);
+            return;
+        }
+
+        viewProjection = mul(inverse(view), projection);
+        Frustum::extractPlanes(planes, viewProjection);
+        this->occlusionOffset = occlusionOffset;
+        auto global = Global{
+            .drawCommandsCount = drawCommandsCount,
+            .phase = PHASE_FIRST,
+            .visibilityValid = visibilityValid ? 1u : 0u,
+            .occlusionOffset = occlusionOffset,
+            .viewProjection = viewProjection,
+        };
+        std::ranges::copy(planes, std::begin(global.planes));
+        firstPassGlobalBuffer->write(&global);
+
+        firstPassDescriptorSet->update(BINDING_INSTANCES, instances);
+        firstPassDescriptorSet->update(BINDING_INPUT, input);
+        firstPassDescriptorSet->update(BINDING_OUTPUT, output, counter);
+        firstPassDescriptorSet->update(BINDING_COUNTER, counter);
+        firstPassDescriptorSet->update(BINDING_STATISTICS, statistics);
+        // Read by both passes, the second one is recorded in the same frame
+        firstPassDescriptorSet->update(BINDING_OCCLUSION_BITS, occlusionBits);
+        secondPassDescriptorSet->update(BINDING_OCCLUSION_BITS, occlusionBits);
+
+        commandList.barrier(
+            input,
+            vireo::ResourceState::INDIRECT_DRAW,
+            vireo::ResourceState::COMPUTE_READ);
+        commandList.barrier(
+            output,
+            vireo::ResourceState::INDIRECT_DRAW,
+            vireo::ResourceState::COMPUTE_WRITE);
+        commandList.barrier(
+            *visibilityBuffer,
+            vireo::ResourceState::COMPUTE_WRITE,
+            vireo::ResourceState::COMPUTE_READ);
+        commandList.bindPipeline(pipeline);
+        commandList.bindDescriptors({ firstPassDescriptorSet });
+        commandList.dispatch((drawCommandsCount + 63) / 64, 1, 1);
+        commandList.barrier(
+            *visibilityBuffer,
+            vireo::ResourceState::COMPUTE_READ,
+            vireo::ResourceState::COMPUTE_WRITE);
+        commandList.barrier(
+            output,
+            vireo::ResourceState::COMPUTE_WRITE,
+            vireo::ResourceState::INDIRECT_DRAW);
+        commandList.barrier(
+            input,
+            vireo::ResourceState::COMPUTE_READ,
+            vireo::ResourceState::INDIRECT_DRAW);
+        commandList.barrier(
+            counter,
+            vireo::ResourceState::COMPUTE_WRITE,
+            vireo::ResourceState::INDIRECT_DRAW);
+    }
+
+    void OcclusionCulling::dispatchSecondPass(
+        vireo::CommandList& commandList,
+        const uint32 drawCommandsCount,
+        const vireo::Buffer& pyramid,
+        const DepthPyramid& pyramidLayout,
+        const vireo::Viewport& viewport,
+        const vireo::Buffer& instances,
+        const vireo::Buffer& input,
+        const vireo::Buffer& output,
+        const vireo::Buffer& counter,
+        const vireo::Buffer& statistics) {
+        commandList.barrier(
+            *newlyVisibleCounterBuffer,
+            vireo::ResourceState::INDIRECT_DRAW,
+            vireo::ResourceState::COPY_DST);
+        commandList.copy(*commandClearCounterBuffer, *newlyVisibleCounterBuffer);
+        commandList.barrier(
+            *newlyVisibleCounterBuffer,
+            vireo::ResourceState::COPY_DST,
+            vireo::ResourceState::COMPUTE_WRITE);
+        if (drawCommandsCount > 0) {
+            auto global = Global{
+                .drawCommandsCount = drawCommandsCount,
+                .phase = PHASE_SECOND,
+                .visibilityValid = visibilityValid ? 1u : 0u,
+                .levelsCount = pyramidLayout.getLevelsCount(),
+                .viewport = float4{viewport.x, viewport.y, viewport.width, viewport.height},
+                .depthWidth = pyramidLayout.getWidth(),
+                .depthHeight = pyramidLayout.getHeight(),
+                .occlusionOffset = occlusionOffset,
+                .viewProjection = viewProjection,
+            };
+            std::ranges::copy(planes, std::begin(global.planes));
+            std::ranges::copy(pyramidLayout.getLevels(), std::begin(global.levels));
+            secondPassGlobalBuffer->write(&global);
+
+            secondPassDescriptorSet->update(BINDING_INSTANCES, instances);
+            secondPassDescriptorSet->update(BINDING_INPUT, input);
+            secondPassDescriptorSet->update(BINDING_OUTPUT, output, counter);
+            secondPassDescriptorSet->update(BINDING_COUNTER, counter);
+            secondPassDescriptorSet->update(BINDING_STATISTICS, statistics);
+            secondPassDescriptorSet->update(BINDING_PYRAMID, pyramid);
+
+            commandList.barrier(
+                input,
+                vireo::ResourceState::INDIRECT_DRAW,
+                vireo::ResourceState::COMPUTE_READ);
+            commandList.barrier(
+                output,
+                vireo::ResourceState::INDIRECT_DRAW,
+                vireo::ResourceState::COMPUTE_WRITE);
+            commandList.barrier(
+                counter,
+                vireo::ResourceState::INDIRECT_DRAW,
+                vireo::ResourceState::COMPUTE_WRITE);
+            commandList.barrier(
+                *newlyVisibleBuffer,
+                vireo::ResourceState::INDIRECT_DRAW,
+                vireo::ResourceState::COMPUTE_WRITE);
+            commandList.bindPipeline(pipeline);
+            commandList.bindDescriptors({ secondPassDescriptorSet });
+            commandList.dispatch((drawCommandsCount + 63) / 64, 1, 1);
+            commandList.barrier(
+                *newlyVisibleBuffer,
+                vireo::ResourceState::COMPUTE_WRITE,
+                vireo::ResourceState::INDIRECT_DRAW);
+            commandList.barrier(
+                counter,
+                vireo::ResourceState::COMPUTE_WRITE,
+                vireo::ResourceState::INDIRECT_DRAW);
+            commandList.barrier(
+                output,
+                vireo::ResourceState::COMPUTE_WRITE,
+                vireo::ResourceState::INDIRECT_DRAW);
+            commandList.barrier(
+                input,
+                vireo::ResourceState::COMPUTE_READ,
+                vireo::ResourceState::INDIRECT_DRAW);
+            visibilityValid = true;
+        }
+        commandList.barrier(
+            *newlyVisibleCounterBuffer,
+            vireo::ResourceState::COMPUTE_WRITE,
+            vireo::ResourceState::INDIRECT_DRAW);
+    }
+
+}
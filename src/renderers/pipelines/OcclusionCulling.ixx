@@ -0,0 +1,166 @@
+/*
+* Copyright (c) 2025-present Henri Michelon
+*
+* This software is released under the MIT License.
+* https://opensource.org/licenses/MIT
+*/
+export module lysa.renderers.pipelines.occlusion_culling;
+
+import vireo;
+import lysa.context;
+import lysa.depth_pyramid;
+import lysa.frustum;
+import lysa.utils;
+import lysa.math;
+import lysa.memory;
+
+export namespace lysa {
+
+    /**
+     * Two-phase GPU occlusion culling of the draw commands of a pipeline.
+     *
+     * The first pass replaces the frustum culling : it keeps the commands inside the frustum
+     * that were visible the last time the pass ran. Once the depth pre-pass has rendered
+     * those commands and the depth pyramid has been built, the second pass tests every
+     * command inside the frustum against the pyramid, stores the visibility for the next
+     * frame and appends the newly visible commands to both the culled commands (drawn by
+     * the color passes) and a separate list drawn by a second depth pre-pass.
+     *
+     * The visibility is reset when the draw commands are rebuilt, the first pass then draws
+     * everything inside the frustum.
+     */
+    class OcclusionCulling {
+    public:
+        /**
+         * Creates the culling pipeline.
+         * @param meshInstancesArray Array storing per-mesh-instance data
+         * @param pipelineId Identifier of the graphic pipeline, for debug names
+         * @param drawCommandSize Size of a draw command in the draw commands buffers
+         * @param maxDrawCommands Capacity of the draw commands buffers of the graphic pipeline
+         */
+        OcclusionCulling(
+            const DeviceMemoryArray& meshInstancesArray,
+            pipeline_id pipelineId,
+            size_t drawCommandSize,
+            uint32 maxDrawCommands);
+
+        /**
+         * Recreates the buffers for a number of draw commands and forgets the previous visibility.
+         * The buffers are used by one frame in flight only, the previous ones are released
+         * when the frame has completed.
+         * @param maxDrawCommands Capacity of the draw commands buffers of the graphic pipeline
+         */
+        void reserve(uint32 maxDrawCommands);
+
+        /**
+         * Records the first pass, resets the culled commands counter.
+         * @param occlusionBits Software occlusion bits of the camera views, see CullingView::occlusionOffset
+         * @param occlusionOffset First word of the bits of the camera, or CullingView::NO_OCCLUSION
+         * @param statistics Counters incremented by the shader, see CullingStatistics
+         */
+        void dispatchFirstPass(
+            vireo::CommandList& commandList,
+            uint32 drawCommandsCount,
+            const float4x4& view,
+            const float4x4& projection,
+            const vireo::Buffer& occlusionBits,
+            uint32 occlusionOffset,
+            const vireo::Buffer& instances,
+            const vireo::Buffer& input,
+            const vireo::Buffer& output,
+            const vireo::Buffer& counter,
+            const vireo::Buffer& statistics);
+
+        /**
+         * Records the second pass, must be called after dispatchFirstPass() in the same frame.
+         * @param pyramid Depth pyramid buffer built from the first pass depth buffer
+         * @param pyramidLayout Layout of the depth pyramid
+         * @param viewport Rectangle of the view in the depth buffer
+         */
+        void dispatchSecondPass(
+            vireo::CommandList& commandList,
+            uint32 drawCommandsCount,
+            const vireo::Buffer& pyramid,
+            const DepthPyramid& pyramidLayout,
+            const vireo::Viewport& viewport,
+            const vireo::Buffer& instances,
+            const vireo::Buffer& input,
+            const vireo::Buffer& output,
+            const vireo::Buffer& counter,
+            const vireo::Buffer& statistics);
+
+        /**
+         * Forgets the previous visibility, called when the draw commands are rebuilt.
+         */
+        void invalidate() { visibilityValid = false; }
+
+        /** Returns the commands newly visible in the second pass. */
+        const auto& getNewlyVisibleDrawCommandsBuffer() const { return newlyVisibleBuffer; }
+
+        /** Returns the number of commands newly visible in the second pass. */
+        const auto& getNewlyVisibleDrawCommandsCountBuffer() const { return newlyVisibleCounterBuffer; }
+
+        static void cleanup();
+
+        virtual ~OcclusionCulling() = default;
+        OcclusionCulling(OcclusionCulling&) = delete;
+        OcclusionCulling& operator=(OcclusionCulling&) = delete;
+
+    private:
+        static constexpr vireo::DescriptorIndex BINDING_GLOBAL{0};
+        static constexpr vireo::DescriptorIndex BINDING_MESHINSTANCES{1};
+        static constexpr vireo::DescriptorIndex BINDING_INSTANCES{2};
+        static constexpr vireo::DescriptorIndex BINDING_INPUT{3};
+        static constexpr vireo::DescriptorIndex BINDING_OUTPUT{4};
+        static constexpr vireo::DescriptorIndex BINDING_COUNTER{5};
+        static constexpr vireo::DescriptorIndex BINDING_NEWLY_VISIBLE{6};
+        static constexpr vireo::DescriptorIndex BINDING_NEWLY_VISIBLE_COUNTER{7};
+        static constexpr vireo::DescriptorIndex BINDING_VISIBILITY{8};
+        static constexpr vireo::DescriptorIndex BINDING_STATISTICS{9};
+        static constexpr vireo::DescriptorIndex BINDING_PYRAMID{10};
+        static constexpr vireo::DescriptorIndex BINDING_OCCLUSION_BITS{11};
+
+        static constexpr uint32 PHASE_FIRST{0};
+        static constexpr uint32 PHASE_SECOND{1};
+
+        const std::string DEBUG_NAME{"OcclusionCulling"};
+        const std::string SHADER{"occlusion_culling.comp"};
+
+        struct Global {
+            uint32 drawCommandsCount;
+            uint32 phase;
+            uint32 visibilityValid;
+            uint32 levelsCount{0};
+            float4 viewport{};
+            uint32 depthWidth{0};
+            uint32 depthHeight{0};
+            uint32 occlusionOffset;
+            uint32 _pad{0};
+            Frustum::Plane planes[6];
+            float4x4 viewProjection;
+            DepthPyramid::Level levels[DepthPyramid::MAX_LEVELS]{};
+        };
+
+        const std::string                        debugName;
+        const size_t                             drawCommandSize;
+
+        // One descriptor set and uniform per pass since both are recorded in the same frame
+        std::shared_ptr<vireo::DescriptorSet>    firstPassDescriptorSet;
+        std::shared_ptr<vireo::DescriptorSet>    secondPassDescriptorSet;
+        std::shared_ptr<vireo::Buffer>           firstPassGlobalBuffer;
+        std::shared_ptr<vireo::Buffer>           secondPassGlobalBuffer;
+        std::shared_ptr<vireo::Buffer>           visibilityBuffer;
+        std::shared_ptr<vireo::Buffer>           newlyVisibleBuffer;
+        std::shared_ptr<vireo::Buffer>           newlyVisibleCounterBuffer;
+        std::shared_ptr<vireo::Buffer>           commandClearCounterBuffer;
+        std::shared_ptr<vireo::Pipeline>         pipeline;
+        bool                                     visibilityValid{false};
+        float4x4                                 viewProjection;
+        Frustum::Plane                           planes[6];
+        uint32                                   occlusionOffset{0};
+
+        static std::shared_ptr<vireo::DescriptorLayout> descriptorLayout;
+        static std::shared_ptr<vireo::ShaderModule> shaderModule;
+        static std::shared_ptr<vireo::Pipeline> sharedPipeline;
+    };
+}
@@ -0,0 +1,217 @@
+/*
+* Copyright (c) 2025-present Henri Michelon
+*
+* This software is released under the MIT License.
+* https://opensource.org/licenses/MIT
+*/
+module lysa.renderers.renderpasses.bloom_mip_chain_pass;
+
+import lysa.exception;
+
+namespace lysa {
+
+    BloomMipChainPass::BloomMipChainPass(
+        const RendererConfiguration& config,
+        const vireo::ImageFormat outputFormat):
+        Renderpass{config, "Bloom mip chain"},
+        outputFormat{outputFormat} {
+        if (config.bloomMipCount == 0) {
+            throw Exception("RendererConfiguration : bloomMipCount must be at least 1");
+        }
+
+        descriptorLayout = ctx().vireo->createDescriptorLayout(name);
+        descriptorLayout->add(BINDING_LEVEL, vireo::DescriptorType::UNIFORM);
+        descriptorLayout->add(BINDING_SOURCE, vireo::DescriptorType::SAMPLED_IMAGE);
+        descriptorLayout->build();
+
+        pipelineConfig.resources = ctx().vireo->createPipelineResources({
+            descriptorLayout,
+            ctx().samplers.getDescriptorLayout()},
+            {}, name);
+        pipelineConfig.vertexShader = loadShader(VERTEX_SHADER);
+        downsamplePipeline = createPipeline(MIP_FORMAT, DOWNSAMPLE_FRAGMENT_SHADER, false, "Bloom Downsample");
+        upsamplePipeline = createPipeline(MIP_FORMAT, UPSAMPLE_FRAGMENT_SHADER, true, "Bloom Upsample");
+        outputPipeline = createPipeline(outputFormat, UPSAMPLE_FRAGMENT_SHADER, false, name);
+
+        framesData.resize(ctx().config.framesInFlight);
+    }
+
+    std::shared_ptr<vireo::GraphicPipeline> BloomMipChainPass::createPipeline(
+        const vireo::ImageFormat format,
+        const std::string& fragmentShader,
+        const bool additive,
+        const std::string& name) {
+        auto configuration = pipelineConfig;
+        configuration.colorRenderFormats = {format};
+        configuration.colorBlendDesc = {{}};
+        if (additive) {
+            configuration.colorBlendDesc[0] = {
+                .blendEnable = true,
+                .srcColorBlendFactor = vireo::BlendFactor::ONE,
+                .dstColorBlendFactor = vireo::BlendFactor::ONE,
+                .colorBlendOp = vireo::BlendOp::ADD,
+                // The alpha of the levels stays at 1.0
+                .srcAlphaBlendFactor = vireo::BlendFactor::ZERO,
+                .dstAlphaBlendFactor = vireo::BlendFactor::ONE,
+                .alphaBlendOp = vireo::BlendOp::ADD,
+                .colorWriteMask = vireo::ColorWriteMask::ALL,
+            };
+        }
+        configuration.fragmentShader = loadShader(fragmentShader);
+        return ctx().vireo->createGraphicPipeline(configuration, name);
+    }
+
+    void BloomMipChainPass::render(
+        vireo::CommandList& commandList,
+        const std::shared_ptr<vireo::RenderTarget>& bloomAttachment,
+        const uint32 frameIndex) {
+        const auto& frame = framesData[frameIndex];
+        frame.descriptorSets[0]->update(BINDING_SOURCE, bloomAttachment->getImage());
+
+        // The levels are fully overwritten by the downsampling, their previous content is discarded
+        for (auto i = 0; i < mipCount; i++) {
+            commandList.barrier(
+                frame.mips[i],
+                vireo::ResourceState::UNDEFINED,
+                vireo::ResourceState::RENDER_TARGET_COLOR);
+            draw(commandList, downsamplePipeline, frame.mips[i], frame.descriptorSets[i]);
+            commandList.barrier(
+                frame.mips[i],
+                vireo::ResourceState::RENDER_TARGET_COLOR,
+                vireo::ResourceState::SHADER_READ);
+        }
+        for (auto i = static_cast<int32>(mipCount) - 2; i >= 0; i--) {
+            commandList.barrier(
+                frame.mips[i],
+                vireo::ResourceState::SHADER_READ,
+                vireo::ResourceState::RENDER_TARGET_COLOR);
+            draw(commandList, upsamplePipeline, frame.mips[i], frame.descriptorSets[mipCount + i]);
+            commandList.barrier(
+                frame.mips[i],
+                vireo::ResourceState::RENDER_TARGET_COLOR,
+                vireo::ResourceState::SHADER_READ);
+        }
+
+        if (!externalColorAttachments) {
+            commandList.barrier(
+                frame.colorAttachment,
+                vireo::ResourceState::UNDEFINED,
+                vireo::ResourceState::RENDER_TARGET_COLOR);
+        }
+        draw(commandList, outputPipeline, frame.colorAttachment, frame.descriptorSets[2 * mipCount - 1]);
+        if (!externalColorAttachments) {
+            commandList.barrier(
+                frame.colorAttachment,
+                vireo::ResourceState::RENDER_TARGET_COLOR,
+                vireo::ResourceState::SHADER_READ);
+        }
+    }
+
+    void BloomMipChainPass::draw(
+        vireo::CommandList& commandList,
+        const std::shared_ptr<vireo::GraphicPipeline>& pipeline,
+        const std::shared_ptr<vireo::RenderTarget>& renderTarget,
+        const std::shared_ptr<vireo::DescriptorSet>& descriptorSet) const {
+        const auto renderingConfig = vireo::RenderingConfiguration {
+            .colorRenderTargets = {{ .renderTarget = renderTarget }}
+        };
+        commandList.beginRendering(renderingConfig);
+        commandList.setViewport({
+            static_cast<float>(renderTarget->getImage()->getWidth()),
+            static_cast<float>(renderTarget->getImage()->getHeight())});
+        commandList.bindPipeline(pipeline);
+        commandList.bindDescriptors({
+            descriptorSet,
+            ctx().samplers.getDescriptorSet()});
+        commandList.draw(3);
+        commandList.endRendering();
+    }
+
+    uint32 BloomMipChainPass::getMipCount(const vireo::Extent& extent, const uint32 maxMipCount) {
+        auto count = 1u;
+        auto size = std::min(extent.width, extent.height) / 2;
+        while (count < maxMipCount && size / 2 >= 2) {
+            size /= 2;
+            count += 1;
+        }
+        return count;
+    }
+
+    void BloomMipChainPass::resize(const vireo::Extent& extent) {
+        if (extent.width == 0 || extent.height == 0) { return; }
+        mipCount = getMipCount(extent, config.bloomMipCount);
+
+        // Draws : the downsamplings to the levels 0 to mipCount-1, the upsamplings to the levels 0
+        // to mipCount-2 at mipCount+level, then the upsampling of the level 0 to the output
+        auto sizes = std::vector<vireo::Extent>{extent};
+        for (auto i = 0; i < mipCount; i++) {
+            sizes.push_back({std::max(1u, sizes.back().width / 2), std::max(1u, sizes.back().height / 2)});
+        }
+        const auto texelSize = [&](const uint32 level) {
+            return float2{1.0f / sizes[level].width, 1.0f / sizes[level].height};
+        };
+        auto levels = std::vector<LevelData>(2 * mipCount);
+        for (auto i = 0; i < mipCount; i++) {
+            levels[i] = {
+                .texelSize = texelSize(i),
+                .karisAverage = i == 0 ? 1u : 0u,
+            };
+        }
+        for (auto i = 0; i < mipCount - 1; i++) {
+            levels[mipCount + i] = {
+                .texelSize = texelSize(i + 2),
+                .radius = config.bloomRadius,
+                .scale = 1.0f,
+            };
+        }
+        levels[2 * mipCount - 1] = {
+            .texelSize = texelSize(1),
+            .radius = config.bloomRadius,
+            .scale = config.bloomIntensity / static_cast<float>(mipCount),
+        };
+        levelsBuffers.resize(levels.size());
+        for (auto i = 0; i < levels.size(); i++) {
+            levelsBuffers[i] = ctx().vireo->createBuffer(vireo::BufferType::UNIFORM, sizeof(LevelData), 1, "Bloom Level");
+            levelsBuffers[i]->map();
+            levelsBuffers[i]->write(&levels[i]);
+        }
+
+        for (auto& frame : framesData) {
+            frame.mips.resize(mipCount);
+            for (auto i = 0; i < mipCount; i++) {
+                frame.mips[i] = ctx().vireo->createRenderTarget(
+                    MIP_FORMAT,
+                    sizes[i + 1].width, sizes[i + 1].height,
+                    vireo::RenderTargetType::COLOR,
+                    {},
+                    1,
+                    vireo::MSAA::NONE,
+                    "Bloom Mip " + std::to_string(i));
+            }
+            if (!externalColorAttachments) {
+                frame.colorAttachment = ctx().vireo->createRenderTarget(
+                    outputFormat,
+                    extent.width, extent.height,
+                    vireo::RenderTargetType::COLOR,
+                    {},
+                    1,
+                    config.msaa,
+                    name);
+            }
+            frame.descriptorSets.resize(levels.size());
+            for (auto i = 0; i < levels.size(); i++) {
+                frame.descriptorSets[i] = ctx().vireo->createDescriptorSet(descriptorLayout, name);
+                frame.descriptorSets[i]->update(BINDING_LEVEL, levelsBuffers[i]);
+            }
+            // The source of the first downsampling is set in render()
+            for (auto i = 1; i < mipCount; i++) {
+                frame.descriptorSets[i]->update(BINDING_SOURCE, frame.mips[i - 1]->getImage());
+            }
+            for (auto i = 0; i < mipCount - 1; i++) {
+                frame.descriptorSets[mipCount + i]->update(BINDING_SOURCE, frame.mips[i + 1]->getImage());
+            }
+            frame.descriptorSets[2 * mipCount - 1]->update(BINDING_SOURCE, frame.mips[0]->getImage());
+        }
+    }
+
+}
@@ -0,0 +1,147 @@
+/*
+* Copyright (c) 2025-present Henri Michelon
+*
+* This software is released under the MIT License.
+* https://opensource.org/licenses/MIT
+*/
+export module lysa.renderers.renderpasses.bloom_mip_chain_pass;
+
+import vireo;
+import lysa.context;
+import lysa.math;
+import lysa.renderers.configuration;
+import lysa.renderers.renderpasses.renderpass;
+
+export namespace lysa {
+
+    /**
+     * Blur of the bloom attachment by progressive downsampling and upsampling.
+     *
+     * The bloom attachment is downsampled RendererConfiguration::bloomMipCount times, each level
+     * halving the resolution of the previous one, with a 13 fetches filter. The first level uses
+     * a Karis average to keep the isolated very bright pixels from flickering. The levels are
+     * then upsampled from the smallest one with a 3x3 tent filter, each upsampled level being
+     * added to the upper level, and the first level is upsampled to the output attachment.
+     * The output is the sum of the levels, scaled by RendererConfiguration::bloomIntensity
+     * divided by the number of levels.
+     *
+     * The number of levels is reduced when the smallest level would be under 2x2 texels.
+     * The filters are in bloom_downsample.frag and bloom_upsample.frag.
+     */
+    class BloomMipChainPass : public Renderpass {
+    public:
+        /**
+         * Constructs a BloomMipChainPass
+         * @param config The renderer configuration
+         * @param outputFormat Format of the output attachment
+         */
+        BloomMipChainPass(
+            const RendererConfiguration& config,
+            vireo::ImageFormat outputFormat);
+
+        /**
+         * Renders the mip chain and the output attachment
+         * @param commandList The command list to record rendering commands into
+         * @param bloomAttachment The bloom attachment to blur, sampled
+         * @param frameIndex Index of the current frame
+         */
+        void render(
+            vireo::CommandList& commandList,
+            const std::shared_ptr<vireo::RenderTarget>& bloomAttachment,
+            uint32 frameIndex);
+
+        /**
+         * Recreates the mip chain
+         * @param extent The extent of the bloom attachment
+         */
+        void resize(const vireo::Extent& extent);
+
+        /**
+         * Lets the caller allocate the output attachments and record their barriers, see Renderer.
+         * @param external true to stop allocating the output attachments in resize() and recording their barriers
+         */
+        void setExternalColorAttachments(const bool external) { externalColorAttachments = external; }
+
+        /**
+         * Sets the output attachment of a frame, for the external color attachments
+         * @param frameIndex Index of the frame
+         * @param colorAttachment Render target in the RENDER_TARGET_COLOR state during render()
+         */
+        void setColorAttachment(const uint32 frameIndex, const std::shared_ptr<vireo::RenderTarget>& colorAttachment) {
+            framesData[frameIndex].colorAttachment = colorAttachment;
+        }
+
+        /**
+         * Gets the output attachment for a specific frame
+         * @param frameIndex Index of the frame
+         */
+        auto getColorAttachment(const uint32 frameIndex) const { return framesData[frameIndex].colorAttachment; }
+
+        /**
+         * Gets the format of the output attachments
+         */
+        auto getOutputFormat() const { return outputFormat; }
+
+        /**
+         * Returns the number of levels of the mip chain for the last extent
+         */
+        auto getMipCount() const { return mipCount; }
+
+        /**
+         * Returns the number of levels of the mip chain for an extent, at least 1
+         * @param extent The extent of the bloom attachment
+         * @param maxMipCount The configured number of levels
+         */
+        static uint32 getMipCount(const vireo::Extent& extent, uint32 maxMipCount);
+
+    private:
+        const std::string VERTEX_SHADER{"quad.vert"};
+        const std::string DOWNSAMPLE_FRAGMENT_SHADER{"bloom_downsample.frag"};
+        const std::string UPSAMPLE_FRAGMENT_SHADER{"bloom_upsample.frag"};
+
+        static constexpr vireo::DescriptorIndex BINDING_LEVEL{0};
+        static constexpr vireo::DescriptorIndex BINDING_SOURCE{1};
+
+        static constexpr auto MIP_FORMAT{vireo::ImageFormat::R16G16B16A16_SFLOAT};
+
+        // Parameters of one draw, see bloom_mip_chain.inc.slang
+        struct LevelData {
+            float2 texelSize;
+            uint32 karisAverage;
+            float  radius;
+            float  scale;
+        };
+
+        struct FrameData {
+            /* Downsampled levels, from the half resolution one */
+            std::vector<std::shared_ptr<vireo::RenderTarget>> mips;
+            /* One descriptor set per draw, see resize() */
+            std::vector<std::shared_ptr<vireo::DescriptorSet>> descriptorSets;
+            std::shared_ptr<vireo::RenderTarget> colorAttachment;
+        };
+
+        const vireo::ImageFormat outputFormat;
+        bool externalColorAttachments{false};
+        uint32 mipCount{0};
+        vireo::GraphicPipelineConfiguration pipelineConfig;
+        std::vector<FrameData> framesData;
+        /* One uniform buffer per draw, shared by the frames */
+        std::vector<std::shared_ptr<vireo::Buffer>> levelsBuffers;
+        std::shared_ptr<vireo::DescriptorLayout> descriptorLayout;
+        std::shared_ptr<vireo::GraphicPipeline> downsamplePipeline;
+        std::shared_ptr<vireo::GraphicPipeline> upsamplePipeline;
+        std::shared_ptr<vireo::GraphicPipeline> outputPipeline;
+
+        std::shared_ptr<vireo::GraphicPipeline> createPipeline(
+            vireo::ImageFormat format,
+            const std::string& fragmentShader,
+            bool additive,
+            const std::string& name);
+
+        void draw(
+            vireo::CommandList& commandList,
+            const std::shared_ptr<vireo::GraphicPipeline>& pipeline,
+            const std::shared_ptr<vireo::RenderTarget>& renderTarget,
+            const std::shared_ptr<vireo::DescriptorSet>& descriptorSet) const;
+    };
+}
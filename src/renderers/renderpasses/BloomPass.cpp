@@ -19,50 +19,47 @@ namespace lysa {
             "bloom",
             nullptr, 0,
         "Bloom"),
-        blurData{ .kernelSize = config.bloomBlurKernelSize },
-        blurPass(
-            config,
-            outputFormat,
-            "blur",
-            &blurData,
-            sizeof(blurData),
-            "Bloom blur") { }
-
-    void BloomPass::update(const uint32 frameIndex) {
-        PostProcessing::update(frameIndex);
-        blurPass.update(frameIndex);
-    }
+        mipChainPass(config, outputFormat) { }
 
     void BloomPass::render(
         vireo::CommandList& commandList,
         const std::shared_ptr<vireo::RenderTarget>& colorAttachment,
         const std::shared_ptr<vireo::RenderTarget>& bloomAttachment,
         const uint32 frameIndex) {
-        blurPass.render(
-                        commandList,
-                        bloomAttachment,
-                        nullptr,
-                        frameIndex);
+        mipChainPass.render(commandList, bloomAttachment, frameIndex);
+        renderBloom(commandList, colorAttachment, frameIndex);
+        if (!externalColorAttachments) {
+            commandList.barrier(
+                framesData[frameIndex].colorAttachment,
+                vireo::ResourceState::SHADER_READ,
+                vireo::ResourceState::UNDEFINED);
+            commandList.barrier(
+                mipChainPass.getColorAttachment(frameIndex),
+                vireo::ResourceState::SHADER_READ,
+                vireo::ResourceState::UNDEFINED);
+        }
+    }
+
+    void BloomPass::renderBloom(
+        vireo::CommandList& commandList,
+        const std::shared_ptr<vireo::RenderTarget>& colorAttachment,
+        const uint32 frameIndex) {
         PostProcessing::render(
             commandList,
             colorAttachment,
             nullptr,
-            blurPass.getColorAttachment(frameIndex),
+            mipChainPass.getColorAttachment(frameIndex),
             frameIndex);
-        commandList.barrier(
-            framesData[frameIndex].colorAttachment,
-            vireo::ResourceState::SHADER_READ,
-            vireo::ResourceState::UNDEFINED);
-        commandList.barrier(
-                blurPass.getColorAttachment(frameIndex),
-                vireo::ResourceState::SHADER_READ,
-                vireo::ResourceState::UNDEFINED);
+    }
+
+    void BloomPass::setExternalColorAttachments(const bool external) {
+        PostProcessing::setExternalColorAttachments(external);
+        mipChainPass.setExternalColorAttachments(external);
     }
 
     void BloomPass::resize(const vireo::Extent& extent) {
         PostProcessing::resize(extent);
-        blurData.update(extent, config.bloomBlurStrength);
-        blurPass.resize(extent);
+        mipChainPass.resize(extent);
     }
 
 
@@ -7,16 +7,17 @@
 export module lysa.renderers.renderpasses.bloom_pass;
 
 import vireo;
-import lysa.blur_data;
 import lysa.context;
 import lysa.types;
 import lysa.renderers.configuration;
+import lysa.renderers.renderpasses.bloom_mip_chain_pass;
 import lysa.renderers.renderpasses.post_processing;
 
 export namespace lysa {
 
     /**
-     * Render pass for bloom effect
+     * Render pass for bloom effect : the bloom attachment is blurred by a BloomMipChainPass
+     * then added to the color attachment
      */
     class BloomPass : public PostProcessing {
     public:
@@ -28,12 +29,6 @@ export namespace lysa {
             const RendererConfiguration& config,
             vireo::ImageFormat outputFormat);
 
-        /**
-          * Updates the render pass state for the current frame
-          * @param frameIndex Index of the current frame
-          */
-        void update(uint32 frameIndex) override;
-
         /**
          * Renders the Bloom pass
         * @param frameIndex Index of the current frame
@@ -49,16 +44,31 @@ export namespace lysa {
             const std::shared_ptr<vireo::RenderTarget>& bloomAttachment,
             uint32 frameIndex) override;
 
+        /**
+         * Renders the bloom composition only, the mip chain pass must be rendered before
+         * @param commandList The command list to record rendering commands into
+         * @param colorAttachment The input color attachment
+         * @param frameIndex Index of the current frame
+         */
+        void renderBloom(
+            vireo::CommandList& commandList,
+            const std::shared_ptr<vireo::RenderTarget>& colorAttachment,
+            uint32 frameIndex);
+
         /**
          * Resizes the render pass resources
          * @param extent The new extent
          */
         void resize(const vireo::Extent& extent) override;
 
-        PostProcessing& getBlurPass() { return blurPass; }
+        void setExternalColorAttachments(bool external) override;
+
+        /**
+         * Gets the pass blurring the bloom attachment
+         */
+        BloomMipChainPass& getMipChainPass() { return mipChainPass; }
 
     private:
-        BlurData blurData;
-        PostProcessing blurPass;
+        BloomMipChainPass mipChainPass;
     };
 }
\ No newline at end of file
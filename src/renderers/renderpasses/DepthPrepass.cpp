@@ -12,8 +12,7 @@ namespace lysa {
     DepthPrepass::DepthPrepass(
         const RendererConfiguration& config,
         const bool withStencil):
-        Renderpass{config, "Depth pre-pass"},
-        materialManager(ctx().res.get<MaterialManager>()) {
+        Renderpass{config, "Depth pre-pass"} {
         pipelineConfig.depthStencilImageFormat = config.depthStencilFormat;
         pipelineConfig.stencilTestEnable = withStencil;
         pipelineConfig.backStencilOpState = pipelineConfig.frontStencilOpState;
@@ -31,15 +30,16 @@ namespace lysa {
         framesData.resize(ctx().config.framesInFlight);
     }
 
-    void DepthPrepass::updatePipelines(const std::unordered_map<pipeline_id, std::vector<unique_id>>& pipelineIds) {
-        for (const auto& [pipelineId, materials] : pipelineIds) {
-            if (!pipelines.contains(pipelineId)) {
-                const auto& material = materials.at(0);
-                pipelineConfig.cullMode = materialManager[material].getCullMode();
+    void DepthPrepass::updatePipelines(
+        const std::vector<MaterialPipeline>& materialPipelines,
+        PipelineCompiler& compiler) {
+        for (const auto& material : materialPipelines) {
+            if (!pipelines.contains(material.pipelineId)) {
+                pipelineConfig.cullMode = material.cullMode;
                 pipelineConfig.vertexShader = loadShader(VERTEX_SHADER);
                 pipelineConfig.vertexInputLayout = ctx().vireo->createVertexLayout(sizeof(VertexData), VertexData::vertexAttributes);
                 pipelineConfig.msaa = config.msaa;
-                pipelines[pipelineId] = ctx().vireo->createGraphicPipeline(pipelineConfig, name + ":" + std::to_string(pipelineId));
+                compiler.compile(pipelines, material.pipelineId, pipelineConfig, name + ":" + std::to_string(material.pipelineId));
             }
         }
     }
@@ -56,7 +56,30 @@ namespace lysa {
         if (pipelineConfig.stencilTestEnable) {
             commandList.setStencilReference(1);
         }
-        scene.drawOpaquesModels(commandList, pipelines);
+        if (scene.isOcclusionCullingEnabled()) {
+            // The draw commands are instanced after the second pass of the occlusion culling
+            scene.drawFirstPassOpaquesModels(commandList, pipelines);
+        } else {
+            scene.drawOpaquesModels(commandList, pipelines);
+        }
+        commandList.endRendering();
+    }
+
+    void DepthPrepass::renderNewlyVisible(
+        vireo::CommandList& commandList,
+        const SceneFrameData& scene,
+        const std::shared_ptr<vireo::RenderTarget>& depthAttachment,
+        const uint32 frameIndex) {
+        const auto& frame = framesData[frameIndex];
+        auto loadRenderingConfig = renderingConfig;
+        loadRenderingConfig.clearDepthStencil = false;
+        loadRenderingConfig.depthStencilRenderTarget = depthAttachment;
+        loadRenderingConfig.multisampledDepthStencilRenderTarget = frame.multisampledDepthAttachment;
+        commandList.beginRendering(loadRenderingConfig);
+        if (pipelineConfig.stencilTestEnable) {
+            commandList.setStencilReference(1);
+        }
+        scene.drawNewlyVisibleOpaquesModels(commandList, pipelines);
         commandList.endRendering();
     }
 
@@ -10,6 +10,8 @@ import vireo;
 import lysa.context;
 import lysa.types;
 import lysa.renderers.configuration;
+import lysa.renderers.pipeline_compiler;
+import lysa.renderers.pipeline_manifest;
 import lysa.renderers.renderpasses.renderpass;
 import lysa.renderers.scene_frame_data;
 import lysa.resources.material;
@@ -32,9 +34,12 @@ export namespace lysa {
 
         /**
          * Updates the graphics pipelines based on active pipeline IDs
-         * @param pipelineIds Map of pipeline IDs to unique object IDs
+         * @param materialPipelines Material flags of the pipeline ids
+         * @param compiler Compiler of the pipelines, see PipelineCompiler::compile()
          */
-        void updatePipelines(const std::unordered_map<pipeline_id, std::vector<unique_id>>& pipelineIds);
+        void updatePipelines(
+            const std::vector<MaterialPipeline>& materialPipelines,
+            PipelineCompiler& compiler);
 
         /**
          * Gets the multisampled depth attachment for a specific frame
@@ -58,6 +63,20 @@ export namespace lysa {
             const std::shared_ptr<vireo::RenderTarget>& depthAttachment,
             uint32 frameIndex);
 
+        /**
+         * Renders the models that became visible in the second pass of the occlusion
+         * culling, without clearing the depth attachment
+         * @param commandList The command list to record rendering commands into
+         * @param scene The scene frame data
+         * @param depthAttachment The target depth attachment
+         * @param frameIndex Index of the current frame
+         */
+        void renderNewlyVisible(
+            vireo::CommandList& commandList,
+            const SceneFrameData& scene,
+            const std::shared_ptr<vireo::RenderTarget>& depthAttachment,
+            uint32 frameIndex);
+
         /**
          * Resizes the render pass resources
          * @param extent The new extent
@@ -91,7 +110,6 @@ export namespace lysa {
             std::shared_ptr<vireo::RenderTarget> multisampledDepthAttachment;
         };
 
-        const MaterialManager& materialManager;
         std::vector<FrameData> framesData;
         std::unordered_map<pipeline_id, std::shared_ptr<vireo::GraphicPipeline>> pipelines;
     };
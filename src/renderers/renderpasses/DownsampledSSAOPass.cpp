@@ -0,0 +1,199 @@
+/*
+* Copyright (c) 2025-present Henri Michelon
+*
+* This software is released under the MIT License.
+* https://opensource.org/licenses/MIT
+*/
+module lysa.renderers.renderpasses.downsampled_ssao_pass;
+
+namespace lysa {
+
+    DownsampledSSAOPass::DownsampledSSAOPass(
+        const RendererConfiguration& config,
+        const GBufferPass& gBufferPass):
+        Renderpass{config, "Downsampled SSAO"},
+        params{
+            .radius = config.ssaoRadius,
+            .bias = config.ssaoBias,
+            .power = config.ssaoStrength,
+            .sampleCount = std::min(config.ssaoSampleCount, static_cast<uint32>(SSAOPass::KERNEL_SIZE)),
+            .downsampling = static_cast<uint32>(config.ssaoResolution),
+            .blurKernelSize = config.ssaoBlurKernelSize,
+            .depthSharpness = config.ssaoDepthSharpness },
+        depthStage{
+            config.depthStencilFormat == vireo::ImageFormat::D32_SFLOAT_S8_UINT ||
+            config.depthStencilFormat == vireo::ImageFormat::D24_UNORM_S8_UINT   ?
+            vireo::ResourceState::RENDER_TARGET_DEPTH_STENCIL :
+            vireo::ResourceState::RENDER_TARGET_DEPTH},
+        gBufferPass{gBufferPass} {
+
+        descriptorLayout = ctx().vireo->createDescriptorLayout();
+        descriptorLayout->add(BINDING_PARAMS, vireo::DescriptorType::UNIFORM);
+        descriptorLayout->add(BINDING_DEPTH_BUFFER, vireo::DescriptorType::SAMPLED_IMAGE);
+        descriptorLayout->add(BINDING_NORMAL_BUFFER, vireo::DescriptorType::SAMPLED_IMAGE);
+        descriptorLayout->add(BINDING_NOISE_TEXTURE, vireo::DescriptorType::SAMPLED_IMAGE);
+        descriptorLayout->add(BINDING_DOWNSAMPLED_DEPTH_BUFFER, vireo::DescriptorType::SAMPLED_IMAGE);
+        descriptorLayout->add(BINDING_DOWNSAMPLED_NORMAL_BUFFER, vireo::DescriptorType::SAMPLED_IMAGE);
+        descriptorLayout->add(BINDING_SSAO_BUFFER, vireo::DescriptorType::SAMPLED_IMAGE);
+        descriptorLayout->add(BINDING_BLURRED_SSAO_BUFFER, vireo::DescriptorType::SAMPLED_IMAGE);
+        descriptorLayout->build();
+
+        pipelineConfig.resources = ctx().vireo->createPipelineResources({
+            ctx().globalDescriptorLayout,
+            ctx().samplers.getDescriptorLayout(),
+            SceneFrameData::sceneDescriptorLayout,
+            descriptorLayout},
+            {}, name);
+        pipelineConfig.vertexShader = loadShader(VERTEX_SHADER);
+        downsamplePipeline = createPipeline({DEPTH_FORMAT, NORMAL_FORMAT}, DOWNSAMPLE_FRAGMENT_SHADER, "SSAO Downsample");
+        ssaoPipeline = createPipeline({SSAO_FORMAT}, SSAO_FRAGMENT_SHADER, name);
+        blurPipeline = createPipeline({SSAO_FORMAT}, BLUR_FRAGMENT_SHADER, "SSAO Bilateral Blur");
+        upsamplePipeline = createPipeline({SSAO_FORMAT}, UPSAMPLE_FRAGMENT_SHADER, "SSAO Upsample");
+
+        framesData.resize(ctx().config.framesInFlight);
+        for (auto& frame : framesData) {
+            frame.descriptorSet = ctx().vireo->createDescriptorSet(descriptorLayout);
+        }
+    }
+
+    std::shared_ptr<vireo::GraphicPipeline> DownsampledSSAOPass::createPipeline(
+        const std::vector<vireo::ImageFormat>& formats,
+        const std::string& fragmentShader,
+        const std::string& name) {
+        auto configuration = pipelineConfig;
+        configuration.colorRenderFormats = formats;
+        configuration.colorBlendDesc.resize(formats.size());
+        configuration.fragmentShader = loadShader(fragmentShader);
+        return ctx().vireo->createGraphicPipeline(configuration, name);
+    }
+
+    void DownsampledSSAOPass::render(
+        vireo::CommandList& commandList,
+        const SceneFrameData& scene,
+        const std::shared_ptr<vireo::RenderTarget>& depthAttachment,
+        const vireo::Rect& scissors,
+        const uint32 frameIndex) {
+        const auto& frame = framesData[frameIndex];
+        // Covers all the downsampled texels touched by the view, the buffers are rounded up, see resize()
+        auto downsampledScissors = scissors;
+        downsampledScissors.x = scissors.x / params.downsampling;
+        downsampledScissors.y = scissors.y / params.downsampling;
+        downsampledScissors.width =
+            (scissors.x + scissors.width + params.downsampling - 1) / params.downsampling - downsampledScissors.x;
+        downsampledScissors.height =
+            (scissors.y + scissors.height + params.downsampling - 1) / params.downsampling - downsampledScissors.y;
+
+        frame.descriptorSet->update(BINDING_DEPTH_BUFFER, depthAttachment->getImage());
+        frame.descriptorSet->update(BINDING_NORMAL_BUFFER, gBufferPass.getNormalBuffer(frameIndex)->getImage());
+
+        commandList.barrier(
+            depthAttachment,
+            depthStage,
+            vireo::ResourceState::SHADER_READ);
+        draw(commandList, scene, downsamplePipeline, {frame.depthBuffer, frame.normalBuffer}, downsampledScissors, frameIndex);
+        draw(commandList, scene, ssaoPipeline, {frame.ssaoBuffer}, downsampledScissors, frameIndex);
+        draw(commandList, scene, blurPipeline, {frame.blurredBuffer}, downsampledScissors, frameIndex);
+        draw(commandList, scene, upsamplePipeline, {frame.upsampledBuffer}, scissors, frameIndex);
+        commandList.barrier(
+            depthAttachment,
+            vireo::ResourceState::SHADER_READ,
+            depthStage);
+    }
+
+    void DownsampledSSAOPass::draw(
+        vireo::CommandList& commandList,
+        const SceneFrameData& scene,
+        const std::shared_ptr<vireo::GraphicPipeline>& pipeline,
+        const std::vector<std::shared_ptr<vireo::RenderTarget>>& renderTargets,
+        const vireo::Rect& scissors,
+        const uint32 frameIndex) {
+        auto renderingConfig = vireo::RenderingConfiguration{};
+        for (const auto& renderTarget : renderTargets) {
+            renderingConfig.colorRenderTargets.push_back({ .renderTarget = renderTarget });
+            commandList.barrier(
+               renderTarget,
+               vireo::ResourceState::SHADER_READ,
+               vireo::ResourceState::RENDER_TARGET_COLOR);
+        }
+        commandList.bindPipeline(pipeline);
+        commandList.setViewport({
+            static_cast<float>(renderTargets[0]->getImage()->getWidth()),
+            static_cast<float>(renderTargets[0]->getImage()->getHeight())});
+        commandList.setScissors(scissors);
+        commandList.bindDescriptors({
+             ctx().globalDescriptorSet,
+             ctx().samplers.getDescriptorSet(),
+             scene.getDescriptorSet(),
+             framesData[frameIndex].descriptorSet,
+        });
+        commandList.beginRendering(renderingConfig);
+        commandList.draw(3);
+        commandList.endRendering();
+        for (const auto& renderTarget : renderTargets) {
+            commandList.barrier(
+                renderTarget,
+                vireo::ResourceState::RENDER_TARGET_COLOR,
+                vireo::ResourceState::SHADER_READ);
+        }
+    }
+
+    void DownsampledSSAOPass::resize(const vireo::Extent& extent, const std::shared_ptr<vireo::CommandList>& commandList) {
+        const auto width = std::max(1u, (extent.width + params.downsampling - 1) / params.downsampling);
+        const auto height = std::max(1u, (extent.height + params.downsampling - 1) / params.downsampling);
+        const auto createBuffer = [&](
+            const vireo::ImageFormat format,
+            const uint32 bufferWidth,
+            const uint32 bufferHeight,
+            const std::string& bufferName) {
+            auto buffer = ctx().vireo->createRenderTarget(
+                format,
+                bufferWidth, bufferHeight,
+                vireo::RenderTargetType::COLOR,
+                {},
+                1,
+                vireo::MSAA::NONE,
+                bufferName);
+            commandList->barrier(
+                buffer,
+                vireo::ResourceState::UNDEFINED,
+                vireo::ResourceState::SHADER_READ);
+            return buffer;
+        };
+        for (auto& frame : framesData) {
+            frame.depthBuffer = createBuffer(DEPTH_FORMAT, width, height, "SSAO Depth");
+            frame.normalBuffer = createBuffer(NORMAL_FORMAT, width, height, "SSAO Normal");
+            frame.ssaoBuffer = createBuffer(SSAO_FORMAT, width, height, "SSAO Color");
+            frame.blurredBuffer = createBuffer(SSAO_FORMAT, width, height, "SSAO Blurred");
+            frame.upsampledBuffer = createBuffer(SSAO_FORMAT, extent.width, extent.height, "SSAO Upsampled");
+            frame.descriptorSet->update(BINDING_DOWNSAMPLED_DEPTH_BUFFER, frame.depthBuffer->getImage());
+            frame.descriptorSet->update(BINDING_DOWNSAMPLED_NORMAL_BUFFER, frame.normalBuffer->getImage());
+            frame.descriptorSet->update(BINDING_SSAO_BUFFER, frame.ssaoBuffer->getImage());
+            frame.descriptorSet->update(BINDING_BLURRED_SSAO_BUFFER, frame.blurredBuffer->getImage());
+        }
+
+        if (paramsBuffer == nullptr) {
+            paramsBuffer = ctx().vireo->createBuffer(vireo::BufferType::UNIFORM, sizeof(Params), 1, "Downsampled SSAO Params");
+            paramsBuffer->map();
+            noiseTexture = SSAOPass::createKernel(params.samples, commandList);
+            for (auto& frame : framesData) {
+                frame.descriptorSet->update(BINDING_PARAMS, paramsBuffer);
+                frame.descriptorSet->update(BINDING_NOISE_TEXTURE, noiseTexture);
+            }
+        }
+
+        params.screenSize = {width, height};
+        params.noiseScale = {width / 4.0f, height / 4.0f};
+        params.texelSize = {1.0f / width, 1.0f / height};
+        params.fullScreenSize = {extent.width, extent.height};
+        paramsBuffer->write(&params);
+    }
+
+    void DownsampledSSAOPass::setRenderScale(const float2& renderScale) {
+        if (all(params.renderScale == renderScale)) { return; }
+        params.renderScale = renderScale;
+        if (paramsBuffer) {
+            paramsBuffer->write(&params);
+        }
+    }
+
+}
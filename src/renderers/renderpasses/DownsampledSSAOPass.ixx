@@ -0,0 +1,154 @@
+/*
+* Copyright (c) 2025-present Henri Michelon
+*
+* This software is released under the MIT License.
+* https://opensource.org/licenses/MIT
+*/
+export module lysa.renderers.renderpasses.downsampled_ssao_pass;
+
+import vireo;
+import lysa.context;
+import lysa.math;
+import lysa.renderers.configuration;
+import lysa.renderers.scene_frame_data;
+import lysa.renderers.renderpasses.gbuffer_pass;
+import lysa.renderers.renderpasses.renderpass;
+import lysa.renderers.renderpasses.ssao_pass;
+
+export namespace lysa {
+
+    /**
+     * Screen Space Ambient Occlusion computed at half or quarter resolution.
+     *
+     * Used by the deferred renderer when RendererConfiguration::ssaoResolution is not FULL.
+     * The pass records four draws :
+     *  - downsampling of the depth buffer and of the G-buffer normals into linear view-space
+     *    depths and view-space normals, keeping the nearest of the 2x2 texels at the center of each block
+     *  - SSAO on the downsampled buffer, with the view positions reconstructed from the depths
+     *  - depth and normal aware bilateral blur of the SSAO
+     *  - joint bilateral upsampling to the full resolution, guided by the full resolution depth buffer
+     *
+     * The position G-buffer is not read. The full resolution result is in the SHADER_READ state
+     * after render().
+     */
+    class DownsampledSSAOPass : public Renderpass {
+    public:
+        /**
+         * Constructs a DownsampledSSAOPass
+         * @param config The renderer configuration
+         * @param gBufferPass Reference to the G-buffer pass providing the normal buffer
+         */
+        DownsampledSSAOPass(
+            const RendererConfiguration& config,
+            const GBufferPass& gBufferPass);
+
+        /**
+         * Renders the SSAO
+         * @param commandList The command list to record rendering commands into
+         * @param scene The scene frame data
+         * @param depthAttachment The depth attachment of the G-buffer pass, sampled
+         * @param scissors Full resolution scissors of the view, the scissors are left set on return
+         * @param frameIndex Index of the current frame
+         */
+        void render(
+            vireo::CommandList& commandList,
+            const SceneFrameData& scene,
+            const std::shared_ptr<vireo::RenderTarget>& depthAttachment,
+            const vireo::Rect& scissors,
+            uint32 frameIndex);
+
+        /**
+         * Resizes the render pass resources
+         * @param extent The new full resolution extent
+         * @param commandList Command list for resource transitions
+         */
+        void resize(const vireo::Extent& extent, const std::shared_ptr<vireo::CommandList>& commandList) override;
+
+        /**
+         * Sets the rendered part of the attachments, from the top left corner, see Renderer::setRenderExtent()
+         * @param renderScale Size of the rendered part divided by the size of the attachments
+         */
+        void setRenderScale(const float2& renderScale);
+
+        /**
+         * Gets the full resolution SSAO buffer for a specific frame
+         * @param frameIndex Index of the current frame
+         */
+        auto getSSAOColorBuffer(const uint32 frameIndex) const {
+            return framesData[frameIndex].upsampledBuffer;
+        }
+
+    private:
+        const std::string VERTEX_SHADER{"quad.vert"};
+        const std::string DOWNSAMPLE_FRAGMENT_SHADER{"ssao_downsample.frag"};
+        const std::string SSAO_FRAGMENT_SHADER{"ssao_downsampled.frag"};
+        const std::string BLUR_FRAGMENT_SHADER{"ssao_bilateral_blur.frag"};
+        const std::string UPSAMPLE_FRAGMENT_SHADER{"ssao_upsample.frag"};
+
+        static constexpr vireo::DescriptorIndex BINDING_PARAMS{0};
+        static constexpr vireo::DescriptorIndex BINDING_DEPTH_BUFFER{1};
+        static constexpr vireo::DescriptorIndex BINDING_NORMAL_BUFFER{2};
+        static constexpr vireo::DescriptorIndex BINDING_NOISE_TEXTURE{3};
+        static constexpr vireo::DescriptorIndex BINDING_DOWNSAMPLED_DEPTH_BUFFER{4};
+        static constexpr vireo::DescriptorIndex BINDING_DOWNSAMPLED_NORMAL_BUFFER{5};
+        static constexpr vireo::DescriptorIndex BINDING_SSAO_BUFFER{6};
+        static constexpr vireo::DescriptorIndex BINDING_BLURRED_SSAO_BUFFER{7};
+
+        // See ssao_downsampled.inc.slang
+        struct Params {
+            float2 screenSize;
+            float2 noiseScale;
+            float2 texelSize;
+            float2 fullScreenSize;
+            float2 renderScale{1.0f};
+            float  radius;
+            float  bias;
+            float  power;
+            uint   sampleCount;
+            uint   downsampling;
+            uint   blurKernelSize;
+            float  depthSharpness;
+            float4 samples[SSAOPass::KERNEL_SIZE];
+        };
+
+        struct FrameData {
+            std::shared_ptr<vireo::DescriptorSet> descriptorSet;
+            std::shared_ptr<vireo::RenderTarget> depthBuffer;
+            std::shared_ptr<vireo::RenderTarget> normalBuffer;
+            std::shared_ptr<vireo::RenderTarget> ssaoBuffer;
+            std::shared_ptr<vireo::RenderTarget> blurredBuffer;
+            std::shared_ptr<vireo::RenderTarget> upsampledBuffer;
+        };
+
+        static constexpr auto DEPTH_FORMAT{vireo::ImageFormat::R32_SFLOAT};
+        static constexpr auto NORMAL_FORMAT{vireo::ImageFormat::R16G16B16A16_SFLOAT};
+        static constexpr auto SSAO_FORMAT{vireo::ImageFormat::R8_UNORM};
+
+        vireo::GraphicPipelineConfiguration pipelineConfig;
+
+        Params params;
+        const vireo::ResourceState depthStage;
+        const GBufferPass& gBufferPass;
+        std::vector<FrameData> framesData;
+        std::shared_ptr<vireo::Buffer> paramsBuffer;
+        std::shared_ptr<vireo::Image> noiseTexture;
+        std::shared_ptr<vireo::GraphicPipeline> downsamplePipeline;
+        std::shared_ptr<vireo::GraphicPipeline> ssaoPipeline;
+        std::shared_ptr<vireo::GraphicPipeline> blurPipeline;
+        std::shared_ptr<vireo::GraphicPipeline> upsamplePipeline;
+        std::shared_ptr<vireo::DescriptorLayout> descriptorLayout;
+
+        std::shared_ptr<vireo::GraphicPipeline> createPipeline(
+            const std::vector<vireo::ImageFormat>& formats,
+            const std::string& fragmentShader,
+            const std::string& name);
+
+        void draw(
+            vireo::CommandList& commandList,
+            const SceneFrameData& scene,
+            const std::shared_ptr<vireo::GraphicPipeline>& pipeline,
+            const std::vector<std::shared_ptr<vireo::RenderTarget>>& renderTargets,
+            const vireo::Rect& scissors,
+            uint32 frameIndex);
+    };
+}
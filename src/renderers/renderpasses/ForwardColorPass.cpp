@@ -11,8 +11,7 @@ import lysa.renderers.graphic_pipeline_data;
 namespace lysa {
     ForwardColorPass::ForwardColorPass(
         const RendererConfiguration& config):
-        Renderpass{config, "Forward Color"},
-        materialManager(ctx().res.get<MaterialManager>()) {
+        Renderpass{config, "Forward Color"} {
 
         pipelineConfig.colorRenderFormats.push_back(config.colorRenderingFormat); // Color
         if (config.bloomEnabled) {
@@ -43,26 +42,24 @@ namespace lysa {
         framesData.resize(ctx().config.framesInFlight);
     }
 
-    void ForwardColorPass::updatePipelines(const std::unordered_map<pipeline_id, std::vector<unique_id>>& pipelineIds) {
-        for (const auto& [pipelineId, materials] : pipelineIds) {
-            if (!pipelines.contains(pipelineId)) {
-                const auto& material = materialManager[materials.at(0)];
+    void ForwardColorPass::updatePipelines(
+        const std::vector<MaterialPipeline>& materialPipelines,
+        PipelineCompiler& compiler) {
+        for (const auto& material : materialPipelines) {
+            if (!pipelines.contains(material.pipelineId)) {
                 std::string vertShaderName = DEFAULT_VERTEX_SHADER;
                 std::string fragShaderName = config.bloomEnabled ? DEFAULT_FRAGMENT_BLOOM_SHADER : DEFAULT_FRAGMENT_SHADER;
-                if (material.getType() == Material::SHADER) {
-                    const auto& shaderMaterial = dynamic_cast<const ShaderMaterial&>(material);
-                    if (!shaderMaterial.getVertFileName().empty()) {
-                        vertShaderName = shaderMaterial.getVertFileName();
-                    }
-                    if (!shaderMaterial.getFragFileName().empty()) {
-                        fragShaderName = shaderMaterial.getFragFileName();
-                    }
+                if (!material.vertFileName.empty()) {
+                    vertShaderName = material.vertFileName;
                 }
-                pipelineConfig.cullMode = material.getCullMode();
+                if (!material.fragFileName.empty()) {
+                    fragShaderName = material.fragFileName;
+                }
+                pipelineConfig.cullMode = material.cullMode;
                 pipelineConfig.vertexShader = loadShader(vertShaderName);
                 pipelineConfig.fragmentShader = loadShader(fragShaderName);
                 pipelineConfig.msaa = config.msaa;
-                pipelines[pipelineId] = ctx().vireo->createGraphicPipeline(pipelineConfig, vertShaderName + "+" + fragShaderName + ":" + std::to_string(pipelineId));
+                compiler.compile(pipelines, material.pipelineId, pipelineConfig, vertShaderName + "+" + fragShaderName + ":" + std::to_string(material.pipelineId));
             }
         }
     }
@@ -11,6 +11,8 @@ import lysa.context;
 import lysa.types;
 import lysa.renderers.configuration;
 import lysa.renderers.scene_frame_data;
+import lysa.renderers.pipeline_compiler;
+import lysa.renderers.pipeline_manifest;
 import lysa.renderers.renderpasses.renderpass;
 import lysa.resources.material;
 
@@ -30,9 +32,12 @@ export namespace lysa {
 
         /**
          * Updates the graphics pipelines based on active pipeline IDs
-         * @param pipelineIds Map of pipeline IDs to unique object IDs
+         * @param materialPipelines Material flags of the pipeline ids
+         * @param compiler Compiler of the pipelines, see PipelineCompiler::compile()
          */
-        void updatePipelines(const std::unordered_map<pipeline_id, std::vector<unique_id>>& pipelineIds);
+        void updatePipelines(
+            const std::vector<MaterialPipeline>& materialPipelines,
+            PipelineCompiler& compiler);
 
         /**
          * Renders the forward color pass
@@ -90,7 +95,6 @@ export namespace lysa {
             std::shared_ptr<vireo::RenderTarget> brightnessBuffer;
         };
 
-        const MaterialManager& materialManager;
         std::vector<FrameData> framesData;
         std::unordered_map<pipeline_id, std::shared_ptr<vireo::GraphicPipeline>> pipelines;
 
@@ -0,0 +1,86 @@
+/*
+* Copyright (c) 2025-present Henri Michelon
+*
+* This software is released under the MIT License.
+* https://opensource.org/licenses/MIT
+*/
+module lysa.renderers.renderpasses.fused_post_processing;
+
+import lysa.exception;
+
+namespace lysa {
+
+    std::optional<FusedPostProcessing::Operation> FusedPostProcessing::getOperation(const PostProcessing& pass) {
+        static const auto operations = std::unordered_map<std::string, Operation>{
+            {"passthrough", Operation::PASSTHROUGH},
+            {"greyscale", Operation::GREYSCALE},
+            {"bloom", Operation::BLOOM},
+            {"gamma_correction", Operation::GAMMA_CORRECTION},
+            {"reinhard", Operation::REINHARD},
+            {"aces", Operation::ACES},
+        };
+        const auto it = operations.find(pass.getFragShaderName());
+        if (it == operations.end() || pass.getDataSize() > MAX_STAGE_DATA_SIZE) {
+            return std::nullopt;
+        }
+        return it->second;
+    }
+
+    std::optional<FusedPostProcessing::Quantization> FusedPostProcessing::getQuantization(const vireo::ImageFormat format) {
+        switch (format) {
+        case vireo::ImageFormat::R8G8B8A8_UNORM:
+            return Quantization::UNORM8;
+        case vireo::ImageFormat::R16G16B16A16_UNORM:
+            return Quantization::UNORM16;
+        case vireo::ImageFormat::R16G16B16A16_SFLOAT:
+            return Quantization::FLOAT16;
+        case vireo::ImageFormat::R32G32B32A32_SFLOAT:
+            return Quantization::NONE;
+        default:
+            return std::nullopt;
+        }
+    }
+
+    std::string FusedPostProcessing::getName(const std::vector<PostProcessing*>& passes) {
+        auto name = std::string{"Fused"};
+        for (const auto* pass : passes) {
+            name += " " + pass->getFragShaderName();
+        }
+        return name;
+    }
+
+    FusedPostProcessing::FusedPostProcessing(
+        const RendererConfiguration& config,
+        const std::vector<PostProcessing*>& passes) :
+        PostProcessing(
+            config,
+            passes.back()->getOutputFormat(),
+            "fused",
+            &fusedData, sizeof(fusedData),
+            getName(passes)),
+        passes{passes} {
+        if (passes.size() < 2 || passes.size() > MAX_STAGES) {
+            throw Exception("Fused post-processing : ", passes.size(), " passes, expected 2 to ", MAX_STAGES);
+        }
+        fusedData.stagesCount = static_cast<uint32>(passes.size());
+        for (auto i = 0; i < passes.size(); i++) {
+            const auto operation = getOperation(*passes[i]);
+            const auto quantization = getQuantization(passes[i]->getOutputFormat());
+            if (!operation || !quantization) {
+                throw Exception("Fused post-processing : ", passes[i]->getFragShaderName(), " can't be fused");
+            }
+            auto& stage = fusedData.stages[i];
+            stage.operation = static_cast<uint32>(*operation);
+            // The last pass writes the attachment of the fused pass
+            stage.quantization = static_cast<uint32>(i == passes.size() - 1 ? Quantization::NONE : *quantization);
+        }
+    }
+
+    void FusedPostProcessing::update(const uint32 frameIndex) {
+        for (auto i = 0; i < passes.size(); i++) {
+            std::memcpy(fusedData.stages[i].data, passes[i]->getData(), passes[i]->getDataSize());
+        }
+        PostProcessing::update(frameIndex);
+    }
+
+}
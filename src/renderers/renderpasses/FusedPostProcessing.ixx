@@ -0,0 +1,125 @@
+/*
+* Copyright (c) 2025-present Henri Michelon
+*
+* This software is released under the MIT License.
+* https://opensource.org/licenses/MIT
+*/
+export module lysa.renderers.renderpasses.fused_post_processing;
+
+import vireo;
+import lysa.context;
+import lysa.math;
+import lysa.renderers.configuration;
+import lysa.renderers.renderpasses.post_processing;
+
+export namespace lysa {
+
+    /**
+     * Chain of per-pixel post-processing passes rendered in one full-screen draw.
+     *
+     * The `fused` shader applies the operations of the passes in order to the color of the
+     * pixel instead of writing and reading back an attachment between each pass. To give the
+     * same pixels as the separate passes, the color is rounded after each operation but the
+     * last one to the format of the attachment of the pass.
+     *
+     * The data of the passes are copied each frame from the passes, they can still be changed
+     * through the passes. Only the passes using the shaders known by the `fused` shader can be
+     * fused, see isFusible(). The gamma correction and tone mapping pass of the renderer is not
+     * fused : it runs after the overlay drawn by the vector renderers in linear colors.
+     */
+    class FusedPostProcessing : public PostProcessing {
+    public:
+        /** Maximum number of fused passes */
+        static constexpr uint32 MAX_STAGES{8};
+        /** Maximum size of the custom data of a fused pass */
+        static constexpr uint32 MAX_STAGE_DATA_SIZE{16};
+
+        /**
+         * Operation of a pass in the fused shader
+         */
+        enum class Operation : uint32 {
+            PASSTHROUGH      = 0,
+            GREYSCALE        = 1,
+            BLOOM            = 2,
+            GAMMA_CORRECTION = 3,
+            REINHARD         = 4,
+            ACES             = 5,
+        };
+
+        /**
+         * Rounding of the color to the format of the attachment of a pass
+         */
+        enum class Quantization : uint32 {
+            NONE    = 0,
+            UNORM8  = 1,
+            UNORM16 = 2,
+            FLOAT16 = 3,
+        };
+
+        /**
+         * Returns the operation of a pass in the fused shader
+         * @return The operation, or nothing if the shader of the pass can't be fused
+         */
+        static std::optional<Operation> getOperation(const PostProcessing& pass);
+
+        /**
+         * Returns the rounding of the color to an attachment format
+         * @return The rounding, or nothing if the format can't be emulated
+         */
+        static std::optional<Quantization> getQuantization(vireo::ImageFormat format);
+
+        /**
+         * Returns true if a pass can be fused with the passes before and after it
+         */
+        static bool isFusible(const PostProcessing& pass) {
+            return getOperation(pass).has_value() && getQuantization(pass.getOutputFormat()).has_value();
+        }
+
+        /**
+         * Returns the debug name of the fused pass of some passes
+         */
+        static std::string getName(const std::vector<PostProcessing*>& passes);
+
+        /**
+         * Constructs a fused pass
+         * @param config The renderer configuration
+         * @param passes The fusible passes, in execution order
+         */
+        FusedPostProcessing(
+            const RendererConfiguration& config,
+            const std::vector<PostProcessing*>& passes);
+
+        /**
+         * Copies the data of the fused passes then updates the render pass state
+         * @param frameIndex Index of the current frame
+         */
+        void update(uint32 frameIndex) override;
+
+        /**
+         * Renders the fused passes, with the bloom color attachment for the bloom pass
+         */
+        using PostProcessing::render;
+
+        /**
+         * Gets the fused passes
+         */
+        const auto& getPasses() const { return passes; }
+
+    private:
+        struct Stage {
+            uint32 operation;
+            uint32 quantization;
+            uint32 _pad[2];
+            uint8  data[MAX_STAGE_DATA_SIZE];
+        };
+
+        struct Data {
+            uint32 stagesCount;
+            uint32 _pad[3];
+            Stage  stages[MAX_STAGES];
+        };
+
+        const std::vector<PostProcessing*> passes;
+        Data fusedData{};
+    };
+}
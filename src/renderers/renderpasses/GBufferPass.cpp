@@ -13,8 +13,7 @@ namespace lysa {
     GBufferPass::GBufferPass(
         const RendererConfiguration& config,
         const bool withStencil):
-        Renderpass{config, "GBuffer"},
-        materialManager(ctx().res.get<MaterialManager>()) {
+        Renderpass{config, "GBuffer"} {
 
         pipelineConfig.depthStencilImageFormat = config.depthStencilFormat;
         pipelineConfig.stencilTestEnable = withStencil;
@@ -40,15 +39,16 @@ namespace lysa {
         framesData.resize(ctx().config.framesInFlight);
     }
 
-    void GBufferPass::updatePipelines(const std::unordered_map<pipeline_id, std::vector<unique_id>>& pipelineIds) {
-        for (const auto& [pipelineId, materials] : pipelineIds) {
-            if (!pipelines.contains(pipelineId)) {
-                const auto& material = materialManager[materials.at(0)];
+    void GBufferPass::updatePipelines(
+        const std::vector<MaterialPipeline>& materialPipelines,
+        PipelineCompiler& compiler) {
+        for (const auto& material : materialPipelines) {
+            if (!pipelines.contains(material.pipelineId)) {
                 //INFO("GBufferPass updatePipelines ", std::to_string(material->getName()));
-                pipelineConfig.cullMode = material.getCullMode();
+                pipelineConfig.cullMode = material.cullMode;
                 pipelineConfig.vertexShader = loadShader(VERTEX_SHADER);
                 pipelineConfig.fragmentShader = loadShader(FRAGMENT_SHADER);
-                pipelines[pipelineId] = ctx().vireo->createGraphicPipeline(pipelineConfig, name);
+                compiler.compile(pipelines, material.pipelineId, pipelineConfig, name);
             }
         }
     }
@@ -9,6 +9,8 @@ module lysa.renderers.renderpasses.post_processing;
 import lysa.resources.image;
 
 namespace lysa {
+    uint32 PostProcessing::nextId{0};
+
     PostProcessing::PostProcessing(
         const RendererConfiguration& config,
         const vireo::ImageFormat outputFormat,
@@ -17,6 +19,7 @@ namespace lysa {
         uint32 dataSize,
         const std::string& name):
         Renderpass{config, name.empty() ? fragShaderName : name},
+        id{nextId++},
         fragShaderName{fragShaderName},
         data{data},
         descriptorLayout{ctx().vireo->createDescriptorLayout(this->name)} {
@@ -29,6 +32,7 @@ namespace lysa {
             this->data = &dummyData;
             dataSize = sizeof(dummyData);
         }
+        this->dataSize = dataSize;
 
         descriptorLayout->add(BINDING_PARAMS, vireo::DescriptorType::UNIFORM);
         descriptorLayout->add(BINDING_DATA, vireo::DescriptorType::UNIFORM);
@@ -96,37 +100,49 @@ namespace lysa {
         frame.descriptorSet->update(BINDING_TEXTURES, textures);
 
         renderingConfig.colorRenderTargets[0].renderTarget = frame.colorAttachment;
-        commandList.barrier(
-            frame.colorAttachment,
-            vireo::ResourceState::UNDEFINED,
-            vireo::ResourceState::RENDER_TARGET_COLOR);
+        if (!externalColorAttachments) {
+            commandList.barrier(
+                frame.colorAttachment,
+                vireo::ResourceState::UNDEFINED,
+                vireo::ResourceState::RENDER_TARGET_COLOR);
+        }
         commandList.beginRendering(renderingConfig);
+        const auto width = frame.colorAttachment->getImage()->getWidth();
+        const auto height = frame.colorAttachment->getImage()->getHeight();
+        // Same pixels in the input and the output : the rendered part stays in the top left corner
         commandList.setViewport({
-        static_cast<float>(frame.colorAttachment->getImage()->getWidth()),
-        static_cast<float>(frame.colorAttachment->getImage()->getHeight())});
+            static_cast<float>(width),
+            static_cast<float>(height)});
+        commandList.setScissors(renderExtent.width == 0 ?
+            vireo::Rect{width, height} :
+            vireo::Rect{std::min(renderExtent.width, width), std::min(renderExtent.height, height)});
         commandList.bindPipeline(pipeline);
         commandList.bindDescriptors({
             frame.descriptorSet,
             ctx().samplers.getDescriptorSet()});
         commandList.draw(3);
         commandList.endRendering();
-        commandList.barrier(
-            frame.colorAttachment,
-            vireo::ResourceState::RENDER_TARGET_COLOR,
-            vireo::ResourceState::SHADER_READ);
+        if (!externalColorAttachments) {
+            commandList.barrier(
+                frame.colorAttachment,
+                vireo::ResourceState::RENDER_TARGET_COLOR,
+                vireo::ResourceState::SHADER_READ);
+        }
     }
 
     void PostProcessing::resize(const vireo::Extent& extent) {
         if (extent.width == 0 || extent.height == 0) { return; }
         for (auto& frame : framesData) {
-            frame.colorAttachment = ctx().vireo->createRenderTarget(
-                pipelineConfig.colorRenderFormats[0],
-                extent.width, extent.height,
-                vireo::RenderTargetType::COLOR,
-                {},
-                1,
-                config.msaa,
-                name);
+            if (!externalColorAttachments) {
+                frame.colorAttachment = ctx().vireo->createRenderTarget(
+                    pipelineConfig.colorRenderFormats[0],
+                    extent.width, extent.height,
+                    vireo::RenderTargetType::COLOR,
+                    {},
+                    1,
+                    config.msaa,
+                    name);
+            }
             frame.params.imageSize.x = extent.width;
             frame.params.imageSize.y = extent.height;
         }
@@ -94,6 +94,12 @@ export namespace lysa {
             throw Exception("Not implemented for post-processing passes");
         }
 
+        /**
+         * Limits the rendering to the rendered part of the attachments, see Renderer::setRenderExtent()
+         * @param extent Extent of the rendered part from the top left corner, empty for the whole attachments
+         */
+        void setRenderExtent(const vireo::Extent& extent) { renderExtent = extent; }
+
         /**
          * Gets the color attachment for a specific frame
          * @param frameIndex Index of the frame
@@ -103,12 +109,47 @@ export namespace lysa {
             return framesData[frameIndex].colorAttachment;
         }
 
+        /**
+         * Lets the caller allocate the color attachments and record their barriers, see Renderer.
+         * @param external true to stop allocating the attachments in resize() and recording their barriers
+         */
+        virtual void setExternalColorAttachments(const bool external) { externalColorAttachments = external; }
+
+        /**
+         * Sets the color attachment of a frame, for the external color attachments
+         * @param frameIndex Index of the frame
+         * @param colorAttachment Render target in the RENDER_TARGET_COLOR state during render()
+         */
+        void setColorAttachment(const uint32 frameIndex, const std::shared_ptr<vireo::RenderTarget>& colorAttachment) {
+            framesData[frameIndex].colorAttachment = colorAttachment;
+        }
+
+        /**
+         * Gets the format of the color attachments
+         */
+        auto getOutputFormat() const { return pipelineConfig.colorRenderFormats[0]; }
+
         /**
          * Gets the name of the fragment shader
          * @return The fragment shader name
          */
         const auto& getFragShaderName() const { return fragShaderName; }
 
+        /**
+         * Gets the identifier of the pass, unique for the life of the application
+         */
+        auto getId() const { return id; }
+
+        /**
+         * Gets the custom data of the shader
+         */
+        const void* getData() const { return data; }
+
+        /**
+         * Gets the size of the custom data
+         */
+        auto getDataSize() const { return dataSize; }
+
     protected:
         struct FrameData {
             PostProcessingParams                  params;
@@ -125,9 +166,14 @@ export namespace lysa {
             .colorRenderTargets = {{}}
         };
 
+        const uint32 id;
         const std::string fragShaderName;
+        bool externalColorAttachments{false};
+        // Rendered part of the attachments, the whole attachments if empty
+        vireo::Extent renderExtent{};
         uint8 dummyData{0};
         void* data{nullptr};
+        uint32 dataSize{0};
         std::shared_ptr<vireo::Buffer> dataUniform{nullptr};
         std::vector<FrameData> framesData;
         std::vector<std::shared_ptr<vireo::Image>> textures;
@@ -154,5 +200,8 @@ export namespace lysa {
            const std::shared_ptr<vireo::RenderTarget>& depthAttachment,
            const std::shared_ptr<vireo::RenderTarget>& bloomColorAttachment,
            uint32 frameIndex);
+
+    private:
+        static uint32 nextId;
     };
 }
\ No newline at end of file
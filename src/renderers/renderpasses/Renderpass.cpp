@@ -8,9 +8,6 @@ module lysa.renderers.renderpasses.renderpass;
 
 namespace lysa {
 
-    std::mutex Renderpass::shaderModulesMutex;
-    std::unordered_map<std::string, std::shared_ptr<vireo::ShaderModule>> Renderpass::shaderModules;
-
     Renderpass::Renderpass(
         const RendererConfiguration& config,
         const std::string& name):
@@ -19,13 +16,7 @@ namespace lysa {
     }
 
     std::shared_ptr<vireo::ShaderModule> Renderpass::loadShader(const std::string& shaderName) const {
-        auto lock = std::lock_guard(shaderModulesMutex);
-        if (!shaderModules.contains(shaderName)) {
-            auto tempBuffer = std::vector<char>{};
-            ctx().fs.loadShader(shaderName, tempBuffer);
-            shaderModules[shaderName] = ctx().vireo->createShaderModule(tempBuffer, shaderName);
-        }
-        return shaderModules[shaderName];
+        return ctx().shaders.get(shaderName);
     }
 
 }
\ No newline at end of file
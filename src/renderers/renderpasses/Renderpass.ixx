@@ -41,8 +41,6 @@ export namespace lysa {
         Renderpass(Renderpass&) = delete;
         Renderpass& operator=(Renderpass&) = delete;
 
-        static void destroyShaderModules() { shaderModules.clear(); }
-
     protected:
         /** Debug/name label for the pass. */
         const std::string name;
@@ -52,8 +50,5 @@ export namespace lysa {
         /** Utility to load a shader module by name (backend-agnostic). */
         std::shared_ptr<vireo::ShaderModule> loadShader(const std::string& shaderName) const;
 
-        static std::mutex shaderModulesMutex;
-        static std::unordered_map<std::string, std::shared_ptr<vireo::ShaderModule>> shaderModules;
-
     };
 }
\ No newline at end of file
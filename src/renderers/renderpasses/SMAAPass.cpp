@@ -105,10 +105,12 @@ namespace lysa {
             vireo::ResourceState::SHADER_READ);
 
         renderingConfig.colorRenderTargets[0].renderTarget = frame.colorBuffer;
-        commandList.barrier(
-           frame.colorBuffer,
-           vireo::ResourceState::UNDEFINED,
-           vireo::ResourceState::RENDER_TARGET_COLOR);
+        if (!externalColorAttachments) {
+            commandList.barrier(
+               frame.colorBuffer,
+               vireo::ResourceState::UNDEFINED,
+               vireo::ResourceState::RENDER_TARGET_COLOR);
+        }
         commandList.bindPipeline(blendPipeline);
         commandList.bindDescriptors({
            frame.descriptorSet,
@@ -116,10 +118,12 @@ namespace lysa {
         commandList.beginRendering(renderingConfig);
         commandList.draw(3);
         commandList.endRendering();
-        commandList.barrier(
-            frame.colorBuffer,
-            vireo::ResourceState::RENDER_TARGET_COLOR,
-            vireo::ResourceState::SHADER_READ);
+        if (!externalColorAttachments) {
+            commandList.barrier(
+                frame.colorBuffer,
+                vireo::ResourceState::RENDER_TARGET_COLOR,
+                vireo::ResourceState::SHADER_READ);
+        }
     }
 
     void SMAAPass::resize(const vireo::Extent& extent, const std::shared_ptr<vireo::CommandList>& commandList) {
@@ -140,14 +144,16 @@ namespace lysa {
                 1,
                 vireo::MSAA::NONE,
                 "SMAA Blend weight");
-            frame.colorBuffer = ctx().vireo->createRenderTarget(
-                outputFormat,
-                extent.width,extent.height,
-                vireo::RenderTargetType::COLOR,
-                renderingConfig.colorRenderTargets[0].clearValue,
-                1,
-                vireo::MSAA::NONE,
-                "SMAA Color");
+            if (!externalColorAttachments) {
+                frame.colorBuffer = ctx().vireo->createRenderTarget(
+                    outputFormat,
+                    extent.width,extent.height,
+                    vireo::RenderTargetType::COLOR,
+                    renderingConfig.colorRenderTargets[0].clearValue,
+                    1,
+                    vireo::MSAA::NONE,
+                    "SMAA Color");
+            }
             commandList->barrier(
                 { frame.edgeDetectBuffer, frame.blendWeightBuffer },
                 vireo::ResourceState::UNDEFINED,
@@ -57,6 +57,26 @@ export namespace lysa {
             return framesData[frameIndex].colorBuffer;
         }
 
+        /**
+         * Lets the caller allocate the color attachments and record their barriers, see Renderer.
+         * @param external true to stop allocating the attachments in resize() and recording their barriers
+         */
+        void setExternalColorAttachments(const bool external) { externalColorAttachments = external; }
+
+        /**
+         * Sets the color attachment of a frame, for the external color attachments
+         * @param frameIndex Index of the current frame
+         * @param colorAttachment Render target in the RENDER_TARGET_COLOR state during render()
+         */
+        void setColorAttachment(const uint32 frameIndex, const std::shared_ptr<vireo::RenderTarget>& colorAttachment) {
+            framesData[frameIndex].colorBuffer = colorAttachment;
+        }
+
+        /**
+         * Gets the format of the color attachments
+         */
+        auto getOutputFormat() const { return outputFormat; }
+
         auto getEdgeDetectBuffer(const uint32 frameIndex) {
             return framesData[frameIndex].edgeDetectBuffer;
         }
@@ -93,6 +113,7 @@ export namespace lysa {
         };
 
         const vireo::ImageFormat outputFormat;
+        bool externalColorAttachments{false};
         Data data;
         std::vector<FrameData> framesData;
         PostProcessing::PostProcessingParams params;
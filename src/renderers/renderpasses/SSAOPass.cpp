@@ -103,38 +103,9 @@ namespace lysa {
         }
 
         if (paramsBuffer == nullptr) {
-            noiseTexture = ctx().vireo->createImage(vireo::ImageFormat::R32G32B32A32_SFLOAT, 4, 4, 1, 1, "SSAO Noise");
             paramsBuffer = ctx().vireo->createBuffer(vireo::BufferType::UNIFORM, sizeof(Params), 1, "SSAO Params");
             paramsBuffer->map();
-
-            // https://learnopengl.com/Advanced-Lighting/SSAO
-            std::uniform_real_distribution<float> randomFloats(0.0, 1.0); // random floats between [0.0, 1.0]
-            std::default_random_engine generator;
-            for (unsigned int i = 0; i < 64; i++) {
-                float3 sample{
-                    randomFloats(generator) * 2.0 - 1.0,
-                    randomFloats(generator) * 2.0 - 1.0,
-                    randomFloats(generator)
-                };
-                sample = normalize(sample);
-                sample *= randomFloats(generator);
-                float scale = static_cast<float>(i) / 64.0;
-                scale = std::lerp(0.1f, 1.0f, scale * scale);
-                sample *= scale;
-                params.samples[i] = float4{sample, 0.0f};
-            }
-
-            std::vector<float4> ssaoNoise;
-            for (unsigned int i = 0; i < 16; i++){
-                float4 noise{
-                    randomFloats(generator) * 2.0 - 1.0,
-                    randomFloats(generator) * 2.0 - 1.0,
-                    0.0f, 0.0f};
-                ssaoNoise.push_back(noise);
-            }
-            commandList->barrier(noiseTexture, vireo::ResourceState::UNDEFINED, vireo::ResourceState::COPY_DST);
-            commandList->upload(noiseTexture, ssaoNoise.data());
-            commandList->barrier(noiseTexture, vireo::ResourceState::COPY_DST, vireo::ResourceState::SHADER_READ);
+            noiseTexture = createKernel(params.samples, commandList);
 
             for (auto& frame : framesData) {
                 frame.descriptorSet->update(BINDING_PARAMS, paramsBuffer);
@@ -147,4 +118,47 @@ namespace lysa {
         paramsBuffer->write(&params);
     }
 
+    void SSAOPass::setRenderScale(const float2& renderScale) {
+        if (all(params.renderScale == renderScale)) { return; }
+        params.renderScale = renderScale;
+        if (paramsBuffer) {
+            paramsBuffer->write(&params);
+        }
+    }
+
+    std::shared_ptr<vireo::Image> SSAOPass::createKernel(
+        float4 (&samples)[KERNEL_SIZE],
+        const std::shared_ptr<vireo::CommandList>& commandList) {
+        // https://learnopengl.com/Advanced-Lighting/SSAO
+        std::uniform_real_distribution<float> randomFloats(0.0, 1.0); // random floats between [0.0, 1.0]
+        std::default_random_engine generator;
+        for (unsigned int i = 0; i < KERNEL_SIZE; i++) {
+            float3 sample{
+                randomFloats(generator) * 2.0 - 1.0,
+                randomFloats(generator) * 2.0 - 1.0,
+                randomFloats(generator)
+            };
+            sample = normalize(sample);
+            sample *= randomFloats(generator);
+            float scale = static_cast<float>(i) / static_cast<float>(KERNEL_SIZE);
+            scale = std::lerp(0.1f, 1.0f, scale * scale);
+            sample *= scale;
+            samples[i] = float4{sample, 0.0f};
+        }
+
+        std::vector<float4> ssaoNoise;
+        for (unsigned int i = 0; i < 16; i++){
+            float4 noise{
+                randomFloats(generator) * 2.0 - 1.0,
+                randomFloats(generator) * 2.0 - 1.0,
+                0.0f, 0.0f};
+            ssaoNoise.push_back(noise);
+        }
+        auto noiseTexture = ctx().vireo->createImage(vireo::ImageFormat::R32G32B32A32_SFLOAT, 4, 4, 1, 1, "SSAO Noise");
+        commandList->barrier(noiseTexture, vireo::ResourceState::UNDEFINED, vireo::ResourceState::COPY_DST);
+        commandList->upload(noiseTexture, ssaoNoise.data());
+        commandList->barrier(noiseTexture, vireo::ResourceState::COPY_DST, vireo::ResourceState::SHADER_READ);
+        return noiseTexture;
+    }
+
 }
\ No newline at end of file
@@ -52,6 +52,12 @@ export namespace lysa {
          */
         void resize(const vireo::Extent& extent, const std::shared_ptr<vireo::CommandList>& commandList) override;
 
+        /**
+         * Sets the rendered part of the attachments, from the top left corner, see Renderer::setRenderExtent()
+         * @param renderScale Size of the rendered part divided by the size of the attachments
+         */
+        void setRenderScale(const float2& renderScale);
+
         /**
          * Gets the SSAO color buffer for a specific frame
          * @param frameIndex Index of the current frame
@@ -69,6 +75,19 @@ export namespace lysa {
             return pipelineConfig.colorRenderFormats[0];
         }
 
+        /** Number of samples in the hemisphere kernel */
+        static constexpr auto KERNEL_SIZE{64};
+
+        /**
+         * Creates the hemisphere kernel and the 4x4 texture of random rotations, shared with DownsampledSSAOPass
+         * @param samples Receives the kernel samples, in tangent space
+         * @param commandList Command list recording the upload of the rotations texture
+         * @return The rotations texture in the SHADER_READ state
+         */
+        static std::shared_ptr<vireo::Image> createKernel(
+            float4 (&samples)[KERNEL_SIZE],
+            const std::shared_ptr<vireo::CommandList>& commandList);
+
     private:
         const std::string VERTEX_SHADER{"quad.vert"};
         const std::string FRAGMENT_SHADER{"ssao.frag"};
@@ -81,11 +100,12 @@ export namespace lysa {
         struct Params {
             float2 screenSize;
             float2 noiseScale;
+            float2 renderScale{1.0f};
             float  radius;
             float  bias;
             float  power;
-            uint   sampleCount{64};
-            float4 samples[64];
+            uint   sampleCount{KERNEL_SIZE};
+            float4 samples[KERNEL_SIZE];
         };
 
         struct FrameData {
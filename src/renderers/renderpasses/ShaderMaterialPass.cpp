@@ -11,8 +11,7 @@ import lysa.renderers.graphic_pipeline_data;
 namespace lysa {
     ShaderMaterialPass::ShaderMaterialPass(
         const RendererConfiguration& config):
-        Renderpass{config, "ShaderMaterialPass"},
-        materialManager(ctx().res.get<MaterialManager>()) {
+        Renderpass{config, "ShaderMaterialPass"} {
 
         pipelineConfig.colorRenderFormats.push_back(config.colorRenderingFormat);
         pipelineConfig.depthStencilImageFormat = config.depthStencilFormat;
@@ -36,25 +35,23 @@ namespace lysa {
         renderingConfig.clearDepthStencil = false; //!config.forwardDepthPrepass;
     }
 
-    void ShaderMaterialPass::updatePipelines(const std::unordered_map<pipeline_id, std::vector<unique_id>>& pipelineIds) {
-        for (const auto& [pipelineId, materials] : pipelineIds) {
-            if (!pipelines.contains(pipelineId)) {
-                const auto& material = materialManager[materials.at(0)];
+    void ShaderMaterialPass::updatePipelines(
+        const std::vector<MaterialPipeline>& materialPipelines,
+        PipelineCompiler& compiler) {
+        for (const auto& material : materialPipelines) {
+            if (!pipelines.contains(material.pipelineId)) {
                 std::string vertShaderName = DEFAULT_VERTEX_SHADER;
                 std::string fragShaderName = DEFAULT_FRAGMENT_SHADER;
-                if (material.getType() == Material::SHADER) {
-                    const auto& shaderMaterial = dynamic_cast<const ShaderMaterial&>(material);
-                    if (!shaderMaterial.getVertFileName().empty()) {
-                        vertShaderName = shaderMaterial.getVertFileName();
-                    }
-                    if (!shaderMaterial.getFragFileName().empty()) {
-                        fragShaderName = shaderMaterial.getFragFileName();
-                    }
+                if (!material.vertFileName.empty()) {
+                    vertShaderName = material.vertFileName;
                 }
-                pipelineConfig.cullMode = material.getCullMode();
+                if (!material.fragFileName.empty()) {
+                    fragShaderName = material.fragFileName;
+                }
+                pipelineConfig.cullMode = material.cullMode;
                 pipelineConfig.vertexShader = loadShader(vertShaderName);
                 pipelineConfig.fragmentShader = loadShader(fragShaderName);
-                pipelines[pipelineId] = ctx().vireo->createGraphicPipeline(pipelineConfig, name);
+                compiler.compile(pipelines, material.pipelineId, pipelineConfig, name);
             }
         }
     }
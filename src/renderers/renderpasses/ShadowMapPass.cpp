@@ -11,16 +11,12 @@ import lysa.log;
 
 namespace lysa {
 
-    ShadowMapPass::ShadowMapPass(
-        const Light* light,
-        const DeviceMemoryArray& meshInstancesDataArray,
-        const size_t maxMeshSurfacePerPipeline) :
+    ShadowMapPass::ShadowMapPass(const Light* light, const uint32 atlasSize) :
         Renderpass{{}, "ShadowMapPass"},
         light{light},
-        meshInstancesDataArray{meshInstancesDataArray},
-        maxMeshSurfacePerPipeline(maxMeshSurfacePerPipeline),
         isCascaded{light->type == LightType::LIGHT_DIRECTIONAL},
-        isCubeMap{light->type == LightType::LIGHT_OMNI} {
+        isCubeMap{light->type == LightType::LIGHT_OMNI},
+        atlasSize{atlasSize} {
         const auto& vireo = *ctx().vireo;
 
         descriptorLayout = vireo.createDescriptorLayout();
@@ -60,66 +56,315 @@ namespace lysa {
             data.globalUniformBuffer->map();
             data.descriptorSet = vireo.createDescriptorSet(descriptorLayout);
             data.descriptorSet->update(BINDING_GLOBAL, data.globalUniformBuffer);
-            int size = light->shadowMapSize;
-            if (isCascaded) {
-                size = std::max(512, size >> i);
+        }
+    }
+
+    float ShadowMapPass::getScreenCoverage(const Camera& camera, const Frustum::Plane cameraPlanes[6]) const {
+        if (isCascaded) { return 1.0f; }
+        const auto position = light->getPosition();
+        // Bounding sphere of the light outside the camera frustum
+        for (auto i = 0; i < 6; i++) {
+            if (static_cast<float>(dot(cameraPlanes[i].data.xyz, position) + cameraPlanes[i].data.w) < -light->range) {
+                return 0.0f;
             }
-            data.shadowMap = vireo.createRenderTarget(
-                pipelineConfig.depthStencilImageFormat,
-                size,
-                size,
-                vireo::RenderTargetType::DEPTH,
-                renderingConfig.depthStencilClearValue);
+        }
+        const float distance = length(position - camera.transform[3].xyz);
+        if (distance <= light->range) { return 1.0f; }
+        // Projected radius of the bounding sphere, relative to the half height of the screen
+        const auto projectedRadius = light->range * static_cast<float>(camera.projection[1][1]) /
+            std::sqrt(distance * distance - light->range * light->range);
+        return std::clamp(projectedRadius, 0.0f, 1.0f);
+    }
+
+    uint32 ShadowMapPass::getWantedTileSize(
+        const uint32 index,
+        const float coverage,
+        const ShadowAtlasAllocator& allocator) const {
+        if (isCascaded) {
+            return allocator.getTileSize(std::max(512u, light->shadowMapSize >> index));
+        }
+        const auto maxSize = allocator.getTileSize(light->shadowMapSize);
+        const auto wanted = std::max(static_cast<float>(allocator.getMinTileSize()), coverage * maxSize);
+        const auto current = subpassData[index].tile.size;
+        if (current != 0 && current <= maxSize &&
+            std::fabs(std::log2(wanted) - std::log2(static_cast<float>(current))) <= 0.5f + TILE_SIZE_HYSTERESIS) {
+            return current;
+        }
+        return allocator.getTileSize(static_cast<uint32>(std::exp2(std::round(std::log2(wanted)))));
+    }
+
+    void ShadowMapPass::addCullingViews(std::vector<CullingView>& views) {
+        if (!light->visible || !light->castShadows || !isInAtlas()) { return; }
+        for (auto& data : subpassData) {
+            if (cacheEnabled) {
+                updateCacheMaps(data);
+                computeCacheUpdate(data);
+                if (data.cache.update != CacheUpdate::NONE) {
+                    data.staticCullingView = views.size();
+                    views.push_back(CullingView{data.globalUniform.lightSpace, CullingView::TYPE_SHADOW_STATIC});
+                }
+            }
+            if (singlePass) { continue; }
+            data.cullingView = views.size();
+            views.push_back(CullingView{
+                data.globalUniform.lightSpace,
+                cacheEnabled ? CullingView::TYPE_SHADOW_DYNAMIC : CullingView::TYPE_SHADOW});
+        }
+        if (singlePass) {
+            // All the faces in one view
+            cubeCullingView = views.size();
+            views.push_back(CullingView::cube(
+                light->getPosition(),
+                light->range,
+                cacheEnabled ? CullingView::TYPE_SHADOW_CUBE_DYNAMIC : CullingView::TYPE_SHADOW_CUBE));
+        }
+    }
+
+    void ShadowMapPass::setSinglePassEnabled(const bool enabled) {
+        singlePass = enabled && isCubeMap && singlePassSupported;
+        if (!singlePass || cubePipeline) { return; }
+        const auto& vireo = *ctx().vireo;
+        auto cubePipelineConfig = pipelineConfig;
+        try {
+            cubeDescriptorLayout = vireo.createDescriptorLayout(name + "/cube");
+            cubeDescriptorLayout->add(BINDING_GLOBAL, vireo::DescriptorType::UNIFORM);
+            cubeDescriptorLayout->add(BINDING_CUBE_FACES, vireo::DescriptorType::UNIFORM);
+            cubeDescriptorLayout->build();
+            cubePipelineConfig.resources = vireo.createPipelineResources({
+                  ctx().globalDescriptorLayout,
+                  SceneFrameData::sceneDescriptorLayout,
+                  GraphicPipelineData::pipelineDescriptorLayout,
+                  cubeDescriptorLayout,
+                  ctx().samplers.getDescriptorLayout()
+              },
+              SceneFrameData::instanceIndexConstantDesc, name + "/cube");
+            cubePipelineConfig.vertexShader = loadShader(VERTEX_SHADER_CUBEMAP);
+            cubePipeline = vireo.createGraphicPipeline(cubePipelineConfig, name + "/cube");
+        } catch (const std::exception& e) {
+            // Without clip distances support the vertex shader can't cut the faces
+            Log::warning("Omni shadow maps rendered one face at a time, single pass not supported : ", e.what());
+            singlePassSupported = false;
+            singlePass = false;
+            cubeDescriptorLayout.reset();
+            return;
+        }
+        cubeFacesBuffer = vireo.createBuffer(vireo::BufferType::UNIFORM, sizeof(CubeFacesUniform));
+        cubeFacesBuffer->map();
+        cubeDescriptorSet = vireo.createDescriptorSet(cubeDescriptorLayout);
+        // The fragment shader reads the light position of the first face
+        cubeDescriptorSet->update(BINDING_GLOBAL, subpassData[0].globalUniformBuffer);
+        cubeDescriptorSet->update(BINDING_CUBE_FACES, cubeFacesBuffer);
+    }
+
+    void ShadowMapPass::setCacheEnabled(bool enabled) {
 #ifdef SHADOW_TRANSPARENCY_COLOR_ENABLED
-            data.transparencyColorMap = vireo.createRenderTarget(
-                pipelineConfig.colorRenderFormats[0],
-                size,
-                size,
-                vireo::RenderTargetType::COLOR,
-                renderingConfig.colorRenderTargets[0].clearValue);
+        // The transparency color maps are not cached
+        enabled = false;
 #endif
+        if (enabled == cacheEnabled) { return; }
+        cacheEnabled = enabled;
+        if (!enabled) {
+            for (auto& data : subpassData) {
+                data.cache.valid = false;
+            }
+            return;
         }
+        if (cachePipeline) { return; }
+        const auto& vireo = *ctx().vireo;
+        cacheDescriptorLayout = vireo.createDescriptorLayout(name + "/cache");
+        cacheDescriptorLayout->add(BINDING_GLOBAL, vireo::DescriptorType::UNIFORM);
+        cacheDescriptorLayout->add(BINDING_CACHE, vireo::DescriptorType::SAMPLED_IMAGE);
+        cacheDescriptorLayout->build();
+        cachePipelineConfig.resources = vireo.createPipelineResources({ cacheDescriptorLayout }, {}, name + "/cache");
+        cachePipelineConfig.vertexShader = loadShader(CACHE_VERTEX_SHADER);
+        cachePipelineConfig.fragmentShader = loadShader(CACHE_FRAGMENT_SHADER);
+        cachePipeline = vireo.createGraphicPipeline(cachePipelineConfig, name + "/cache");
     }
 
-    void ShadowMapPass::updatePipelines(const std::unordered_map<pipeline_id, std::vector<unique_id>>& pipelineIds) {
-        for (const auto& pipelineId: std::views::keys(pipelineIds)) {
-            for (auto& data : subpassData) {
-                if (!data.frustumCullingPipelines.contains(pipelineId)) {
-                    // INFO("ShadowMapPass::updatePipelines for light ", std::to_string(light->getName()));
-                    data.frustumCullingPipelines[pipelineId] =
-                        std::make_shared<FrustumCulling>(false, meshInstancesDataArray, pipelineId);
-                    data.culledDrawCommandsCountBuffers[pipelineId] = ctx().vireo->createBuffer(
-                      vireo::BufferType::READWRITE_STORAGE,
-                      sizeof(uint32));
-                    data.culledDrawCommandsBuffers[pipelineId] = ctx().vireo->createBuffer(
-                      vireo::BufferType::READWRITE_STORAGE,
-                      sizeof(DrawCommand) * maxMeshSurfacePerPipeline);
-                }
+    void ShadowMapPass::updateCacheMaps(SubpassData& data) const {
+        auto& cache = data.cache;
+        if (cache.maps[0] && cache.maps[0]->getImage()->getWidth() == data.tile.size) { return; }
+        // New tile size : the cache is rendered again at the new size
+        const auto& vireo = *ctx().vireo;
+        // The cascades need a second map to scroll
+        for (auto i = 0; i < (isCascaded ? 2 : 1); i++) {
+            cache.maps[i] = vireo.createRenderTarget(
+                pipelineConfig.depthStencilImageFormat,
+                data.tile.size,
+                data.tile.size,
+                vireo::RenderTargetType::DEPTH,
+                { .depthStencil = { .depth = 1.0f, .stencil = 0 } });
+            if (!cache.globalBuffers[i]) {
+                cache.globalBuffers[i] = vireo.createBuffer(vireo::BufferType::UNIFORM, sizeof(CacheGlobal));
+                cache.globalBuffers[i]->map();
+                cache.descriptorSets[i] = vireo.createDescriptorSet(cacheDescriptorLayout);
+                cache.descriptorSets[i]->update(BINDING_GLOBAL, cache.globalBuffers[i]);
             }
+            cache.descriptorSets[i]->update(BINDING_CACHE, cache.maps[i]->getImage());
+            cache.mapsInitialized[i] = false;
         }
+        cache.current = 0;
+        cache.valid = false;
     }
 
-    void ShadowMapPass::compute(
+    void ShadowMapPass::invalidateCache(const AABB& aabb) {
+        for (auto& data : subpassData) {
+            auto& cache = data.cache;
+            if (cache.valid &&
+                CullingView{cache.lightSpace, CullingView::TYPE_SHADOW_STATIC}.isVisible(aabb, true, true, false, true)) {
+                cache.valid = false;
+            }
+        }
+    }
+
+    void ShadowMapPass::computeCacheUpdate(SubpassData& data) const {
+        static constexpr auto epsilon = 1e-5f;
+        const auto sameRow = [](const float4& a, const float4& b) {
+            const float4 d = abs(a - b);
+            return std::max(
+                std::max(static_cast<float>(d.x), static_cast<float>(d.y)),
+                std::max(static_cast<float>(d.z), static_cast<float>(d.w))) <= epsilon;
+        };
+        auto& cache = data.cache;
+        const auto& lightSpace = data.globalUniform.lightSpace;
+        cache.update = CacheUpdate::FULL;
+        if (!cache.valid) { return; }
+        const auto sameOrientation =
+            sameRow(lightSpace[0], cache.lightSpace[0]) &&
+            sameRow(lightSpace[1], cache.lightSpace[1]) &&
+            sameRow(lightSpace[2], cache.lightSpace[2]);
+        if (sameOrientation && sameRow(lightSpace[3], cache.lightSpace[3])) {
+            cache.update = CacheUpdate::NONE;
+            return;
+        }
+        // Only the cascades move with the camera, other lights moved
+        if (!isCascaded || !sameOrientation) { return; }
+
+        // Translation of the light space between the cache and the frame, in NDC
+        const float4 delta = lightSpace[3] - cache.lightSpace[3];
+        const auto width = static_cast<float>(data.tile.size);
+        const auto height = static_cast<float>(data.tile.size);
+        // Offset from a pixel of the shadow map to the same point in the cache, Y down
+        const float offsetX = -delta.x * width * 0.5f;
+        const float offsetY = delta.y * height * 0.5f;
+        const auto texelOffsetX = std::round(offsetX);
+        const auto texelOffsetY = std::round(offsetY);
+        const auto depthShift = cache.depthShift + std::fabs(static_cast<float>(delta.z));
+        if (std::fabs(offsetX - texelOffsetX) > 0.01f || std::fabs(offsetY - texelOffsetY) > 0.01f ||
+            std::fabs(texelOffsetX) >= width || std::fabs(texelOffsetY) >= height ||
+            depthShift > CACHE_MAX_DEPTH_SHIFT) {
+            return;
+        }
+        cache.update = CacheUpdate::SCROLL;
+        cache.texelOffsetX = static_cast<int32>(texelOffsetX);
+        cache.texelOffsetY = static_cast<int32>(texelOffsetY);
+        cache.depthOffset = delta.z;
+    }
+
+    void ShadowMapPass::copyCache(
         vireo::CommandList& commandList,
-        const std::unordered_map<uint32, std::unique_ptr<GraphicPipelineData>>& pipelinesData) const {
-        if (!light->visible || !light->castShadows) { return; }
-        for (const auto& [pipelineId, pipelineData] : pipelinesData) {
-            for (const auto& data : subpassData) {
-                data.frustumCullingPipelines.at(pipelineId)->dispatch(
-                    commandList,
-                    pipelineData->drawCommandsCount,
-                    data.inverseViewMatrix,
-                    data.projection,
-                    *pipelineData->instancesArray.getBuffer(),
-                    *pipelineData->drawCommandsBuffer,
-                    *data.culledDrawCommandsBuffers.at(pipelineId),
-                    *data.culledDrawCommandsCountBuffers.at(pipelineId));
+        const CacheData& cache,
+        const uint32 index,
+        const ShadowAtlasAllocator::Tile& tile,
+        const int32 texelOffsetX,
+        const int32 texelOffsetY,
+        const float depthOffset) const {
+        const auto global = CacheGlobal {
+            .texelOffsetX = texelOffsetX,
+            .texelOffsetY = texelOffsetY,
+            .tileOriginX = static_cast<int32>(tile.x),
+            .tileOriginY = static_cast<int32>(tile.y),
+            .depthOffset = depthOffset,
+        };
+        cache.globalBuffers[index]->write(&global);
+        commandList.bindPipeline(cachePipeline);
+        commandList.bindDescriptors({ cache.descriptorSets[index] });
+        commandList.draw(3);
+    }
+
+    void ShadowMapPass::bindShadowMapPipeline(
+        vireo::CommandList& commandList,
+        const SceneFrameData& scene,
+        const std::shared_ptr<vireo::GraphicPipeline>& pipeline,
+        const std::shared_ptr<vireo::DescriptorSet>& descriptorSet) const {
+        commandList.bindPipeline(pipeline);
+        commandList.bindDescriptor(ctx().globalDescriptorSet, SET_RESOURCES);
+        commandList.bindDescriptor(scene.getDescriptorSet(), SET_SCENE);
+        commandList.bindDescriptor(descriptorSet, SET_PASS);
+        commandList.bindDescriptor(ctx().samplers.getDescriptorSet(), SET_SAMPLERS);
+    }
+
+    void ShadowMapPass::renderCache(
+        vireo::CommandList& commandList,
+        const SceneFrameData& scene,
+        SubpassData& data) const {
+        auto& cache = data.cache;
+        if (cache.update == CacheUpdate::NONE) { return; }
+        const auto scroll = cache.update == CacheUpdate::SCROLL;
+        const auto target = scroll ? 1 - cache.current : cache.current;
+        const auto& map = cache.maps[target];
+        commandList.barrier(
+            map,
+            cache.mapsInitialized[target] ? vireo::ResourceState::SHADER_READ : vireo::ResourceState::UNDEFINED,
+            vireo::ResourceState::RENDER_TARGET_DEPTH);
+        auto cacheRenderingConfig = vireo::RenderingConfiguration {
+            .depthTestEnable = true,
+            .clearDepthStencil = true,
+            .discardDepthStencilAfterRender = false,
+        };
+        cacheRenderingConfig.depthStencilRenderTarget = map;
+        commandList.beginRendering(cacheRenderingConfig);
+        const auto mapTile = ShadowAtlasAllocator::Tile{ .size = data.tile.size };
+        commandList.setViewport({ static_cast<float>(mapTile.size), static_cast<float>(mapTile.size) });
+        commandList.setScissors({ mapTile.size, mapTile.size });
+        if (scroll) {
+            copyCache(commandList, cache, cache.current, mapTile, cache.texelOffsetX, cache.texelOffsetY, cache.depthOffset);
+            bindShadowMapPipeline(commandList, scene, pipeline, data.descriptorSet);
+            // Columns and rows of the shadow map outside the previous cache
+            const auto width = static_cast<int32>(mapTile.size);
+            const auto height = static_cast<int32>(mapTile.size);
+            auto exposed = std::vector<vireo::Rect>{};
+            if (cache.texelOffsetX != 0) {
+                auto rect = vireo::Rect{};
+                rect.x = cache.texelOffsetX > 0 ? width - cache.texelOffsetX : 0;
+                rect.y = 0;
+                rect.width = std::abs(cache.texelOffsetX);
+                rect.height = height;
+                exposed.push_back(rect);
+            }
+            if (cache.texelOffsetY != 0) {
+                auto rect = vireo::Rect{};
+                rect.x = 0;
+                rect.y = cache.texelOffsetY > 0 ? height - cache.texelOffsetY : 0;
+                rect.width = width;
+                rect.height = std::abs(cache.texelOffsetY);
+                exposed.push_back(rect);
+            }
+            for (const auto& rect : exposed) {
+                commandList.setScissors(rect);
+                scene.drawModels(commandList, SET_PIPELINE, data.staticCullingView);
             }
+            commandList.setScissors({ mapTile.size, mapTile.size });
+            cache.depthShift += std::fabs(cache.depthOffset);
+            cache.current = target;
+        } else {
+            bindShadowMapPipeline(commandList, scene, pipeline, data.descriptorSet);
+            scene.drawModels(commandList, SET_PIPELINE, data.staticCullingView);
+            cache.depthShift = 0.0f;
         }
+        commandList.endRendering();
+        commandList.barrier(
+            map,
+            vireo::ResourceState::RENDER_TARGET_DEPTH,
+            vireo::ResourceState::SHADER_READ);
+        cache.mapsInitialized[target] = true;
+        cache.lightSpace = data.globalUniform.lightSpace;
+        cache.valid = true;
+        cache.update = CacheUpdate::NONE;
     }
 
     void ShadowMapPass::update(const uint32) {
-        if (!light->visible || !light->castShadows) { return; }
+        if (!light->visible || !light->castShadows || !isInAtlas()) { return; }
         static constexpr auto aspectRatio{1};
         switch (light->type) {
             case LightType::LIGHT_DIRECTIONAL: {
@@ -184,7 +429,7 @@ namespace lysa {
                     radius = std::ceil(radius * 16.0f) / 16.0f ;
 
                     // Snap the frustum center to the nearest texel grid
-                    const auto shadowMapResolution = static_cast<float>(subpassData[cascadeIndex].shadowMap->getImage()->getWidth());
+                    const auto shadowMapResolution = static_cast<float>(subpassData[cascadeIndex].tile.size);
 
                     // Split the bounding box
                     const auto maxExtents = float3(radius);
@@ -210,7 +455,6 @@ namespace lysa {
                     roundOffset.w = 0.0f;
                     lightProjection[3] += roundOffset;
 
-                    subpassData[cascadeIndex].inverseViewMatrix = inverse(viewMatrix);
                     subpassData[cascadeIndex].projection = lightProjection;
                     subpassData[cascadeIndex].globalUniform.lightSpace = mul(viewMatrix, lightProjection);
                     subpassData[cascadeIndex].globalUniform.splitDepth = (nearClip + splitDist * clipRange);
@@ -253,7 +497,6 @@ namespace lysa {
                             {0.0, 1.0, 0.0});
                     for (int i = 0; i < 6; i++) {
                         subpassData[i].projection = perspective(radians(90.0f), aspectRatio, near, far);
-                        subpassData[i].inverseViewMatrix = inverse(viewMatrix[i]);
                         subpassData[i].globalUniform.lightSpace = mul(viewMatrix[i], subpassData[i].projection);
                         subpassData[i].globalUniform.lightPosition = float4(lightPosition, far);
                         subpassData[i].globalUniform.transparencyScissor = light->shadowTransparencyScissors;
@@ -262,6 +505,21 @@ namespace lysa {
                     }
                     lastLightPosition = lightPosition;
                 }
+                if (singlePass) {
+                    // Written each frame : the tiles can move in the atlas
+                    auto cubeFaces = CubeFacesUniform{};
+                    const auto size = static_cast<float>(atlasSize);
+                    for (auto i = 0; i < 6; i++) {
+                        const auto& tile = subpassData[i].tile;
+                        cubeFaces.lightSpace[i] = subpassData[i].globalUniform.lightSpace;
+                        cubeFaces.tiles[i] = float4{
+                            tile.size / size,
+                            (2.0f * tile.x + tile.size) / size - 1.0f,
+                            1.0f - (2.0f * tile.y + tile.size) / size,
+                            0.0f};
+                    }
+                    cubeFacesBuffer->write(&cubeFaces);
+                }
                 break;
             }
             case LightType::LIGHT_SPOT: {
@@ -274,7 +532,6 @@ namespace lysa {
                     light->shadowMapNearClipDistance,
                     light->range);
                 const auto viewMatrix = look_at(lightPosition, target, AXIS_UP);
-                subpassData[0].inverseViewMatrix = inverse(viewMatrix);
                 subpassData[0].globalUniform.lightSpace = mul(viewMatrix,  subpassData[0].projection);
                 subpassData[0].globalUniform.lightPosition = float4(lightPosition, light->range);
                 subpassData[0].globalUniform.transparencyScissor = light->shadowTransparencyScissors;
@@ -286,69 +543,48 @@ namespace lysa {
         }
     }
 
-    void ShadowMapPass::render(
+    void ShadowMapPass::renderCaches(
         vireo::CommandList& commandList,
         const SceneFrameData& scene) {
-        if (!light->visible || !light->castShadows) { return; }
+        if (!light->visible || !light->castShadows || !isInAtlas() || !cacheEnabled) { return; }
+        for (auto& data : subpassData) {
+            renderCache(commandList, scene, data);
+        }
+    }
 
+    void ShadowMapPass::render(
+        vireo::CommandList& commandList,
+        const SceneFrameData& scene) const {
+        if (!light->visible || !light->castShadows || !isInAtlas()) { return; }
         for (const auto& data : subpassData) {
-            commandList.setViewport({
-                static_cast<float>(data.shadowMap->getImage()->getWidth()),
-                static_cast<float>(data.shadowMap->getImage()->getHeight())
-            });
-            commandList.setScissors({
-                data.shadowMap->getImage()->getWidth(),
-                data.shadowMap->getImage()->getHeight()
-            });
-            if (firstPass) {
-                commandList.barrier(
-                  data.shadowMap,
-                  vireo::ResourceState::UNDEFINED,
-                  vireo::ResourceState::SHADER_READ);
-#ifdef SHADOW_TRANSPARENCY_COLOR_ENABLED
-                commandList.barrier(
-                  data.transparencyColorMap,
-                  vireo::ResourceState::UNDEFINED,
-                  vireo::ResourceState::SHADER_READ);
-#endif
+            const auto& tile = data.tile;
+            auto viewport = vireo::Viewport{};
+            viewport.x = static_cast<float>(tile.x);
+            viewport.y = static_cast<float>(tile.y);
+            viewport.width = static_cast<float>(tile.size);
+            viewport.height = static_cast<float>(tile.size);
+            commandList.setViewport(viewport);
+            auto scissors = vireo::Rect{};
+            scissors.x = static_cast<int32>(tile.x);
+            scissors.y = static_cast<int32>(tile.y);
+            scissors.width = tile.size;
+            scissors.height = tile.size;
+            commandList.setScissors(scissors);
+            if (cacheEnabled) {
+                // The static instances, then the others over them
+                copyCache(commandList, data.cache, data.cache.current, tile, 0, 0, 0.0f);
             }
-            commandList.barrier(
-                data.shadowMap,
-                vireo::ResourceState::SHADER_READ,
-                vireo::ResourceState::RENDER_TARGET_DEPTH);
-#ifdef SHADOW_TRANSPARENCY_COLOR_ENABLED
-            commandList.barrier(
-                data.transparencyColorMap,
-                vireo::ResourceState::SHADER_READ,
-                vireo::ResourceState::RENDER_TARGET_COLOR);
-            renderingConfig.colorRenderTargets[0].renderTarget = data.transparencyColorMap;
-#endif
-            renderingConfig.depthStencilRenderTarget = data.shadowMap;
-            commandList.beginRendering(renderingConfig);
-            commandList.bindPipeline(pipeline);
-            commandList.bindDescriptor(ctx().globalDescriptorSet, SET_RESOURCES);
-            commandList.bindDescriptor(scene.getDescriptorSet(), SET_SCENE);
-            commandList.bindDescriptor(data.descriptorSet, SET_PASS);
-            commandList.bindDescriptor(ctx().samplers.getDescriptorSet(), SET_SAMPLERS);
-            scene.drawModels(
-                commandList,
-                SET_PIPELINE,
-                data.culledDrawCommandsBuffers,
-                data.culledDrawCommandsCountBuffers,
-                data.frustumCullingPipelines);
-            commandList.endRendering();
-            commandList.barrier(
-                data.shadowMap,
-                vireo::ResourceState::RENDER_TARGET_DEPTH,
-                vireo::ResourceState::SHADER_READ);
-#ifdef SHADOW_TRANSPARENCY_COLOR_ENABLED
-            commandList.barrier(
-                data.transparencyColorMap,
-                vireo::ResourceState::RENDER_TARGET_COLOR,
-                vireo::ResourceState::SHADER_READ);
-#endif
+            if (singlePass) { continue; }
+            bindShadowMapPipeline(commandList, scene, pipeline, data.descriptorSet);
+            scene.drawModels(commandList, SET_PIPELINE, data.cullingView);
+        }
+        if (singlePass) {
+            // The vertex shader moves each face into its tile
+            commandList.setViewport({ static_cast<float>(atlasSize), static_cast<float>(atlasSize) });
+            commandList.setScissors({ atlasSize, atlasSize });
+            bindShadowMapPipeline(commandList, scene, cubePipeline, cubeDescriptorSet);
+            scene.drawModels(commandList, SET_PIPELINE, cubeCullingView);
         }
-        firstPass = false;
     }
 
-}
\ No newline at end of file
+}
@@ -11,47 +11,118 @@ export module lysa.renderers.renderpasses.shadow_map_pass;
 import vireo;
 import lysa.context;
 import lysa.math;
-import lysa.memory;
+import lysa.aabb;
+import lysa.culling_view;
+import lysa.frustum;
 import lysa.resources.camera;
 import lysa.resources.light;
 import lysa.renderers.configuration;
 import lysa.renderers.graphic_pipeline_data;
 import lysa.renderers.scene_frame_data;
-import lysa.renderers.pipelines.frustum_culling;
 import lysa.renderers.renderpasses.renderpass;
+import lysa.shadow_atlas_allocator;
 
 export namespace lysa {
 
     /**
      * Render pass for generating shadow maps
+     *
+     * The shadow maps are rendered in tiles of the shadow atlas of the scene, see
+     * SceneFrameData::updateShadowAtlas(). The size of the tiles of the omni and spot lights
+     * follows the screen space coverage of the light.
+     *
+     * When the cache is enabled the static instances are rendered once per shadow map in a
+     * cache, copied each frame in the shadow map before the other instances are rendered.
+     * A cache is rendered again when a static instance in its view changes or when the light
+     * moves. The caches of the directional lights cascades scroll with the camera : the
+     * cache is shifted by a whole number of texels and only the newly exposed borders are
+     * rendered.
+     *
+     * With the single pass enabled the six faces of an omni light are rendered with one
+     * draw per pipeline, each instance drawing a face, see CullingView::TYPE_SHADOW_CUBE.
      */
     class ShadowMapPass : public Renderpass {
     public:
         /**
          * Constructs a ShadowMapPass
          * @param light Pointer to the light source for which shadows are generated
-         * @param meshInstancesDataArray Array of mesh instance data in device memory
-         * @param maxMeshSurfacePerPipeline Maximum number of mesh surfaces per pipeline
+         * @param atlasSize Size of the shadow atlas in texels
          */
-        ShadowMapPass(
-            const Light* light,
-            const DeviceMemoryArray& meshInstancesDataArray,
-            size_t maxMeshSurfacePerPipeline);
+        ShadowMapPass(const Light* light, uint32 atlasSize);
 
         /**
-         * Computes frustum culling for shadow map generation
-         * @param commandList The command list to record compute commands into
-         * @param pipelinesData Map of pipeline data for mesh rendering
+         * Returns the fraction of the screen height covered by the light, 1.0 for the
+         * directional lights and 0.0 for the lights outside the camera frustum.
+         * @param camera The current camera
+         * @param cameraPlanes Clipping planes of the camera
          */
-        void compute(
-            vireo::CommandList& commandList,
-            const std::unordered_map<uint32, std::unique_ptr<GraphicPipelineData>>& pipelinesData) const;
+        float getScreenCoverage(const Camera& camera, const Frustum::Plane cameraPlanes[6]) const;
+
+        /**
+         * Returns the size of the tile wanted in the shadow atlas for a shadow map.
+         * The cascades have a fixed size, the other shadow maps have the light shadowMapSize
+         * scaled by the screen coverage. To not render the shadow maps again for small camera
+         * movements the current size is kept until the wanted size moves away from it.
+         * @param index Index of the shadow map
+         * @param coverage Screen coverage of the light, see getScreenCoverage()
+         * @param allocator Allocator of the shadow atlas
+         */
+        uint32 getWantedTileSize(uint32 index, float coverage, const ShadowAtlasAllocator& allocator) const;
+
+        /**
+         * Sets the tile of a shadow map in the shadow atlas.
+         * @param index Index of the shadow map
+         * @param tile The tile, of size 0 when the shadow map is not rendered
+         */
+        void setTile(const uint32 index, const ShadowAtlasAllocator::Tile& tile) {
+            subpassData[index].tile = tile;
+        }
+
+        /**
+         * Returns the tile of a shadow map in the shadow atlas.
+         * @param index Index of the shadow map
+         */
+        const auto& getTile(const uint32 index) const { return subpassData[index].tile; }
+
+        /**
+         * Returns true if the shadow maps have tiles in the shadow atlas.
+         * The shadow maps of a light are all in the atlas or none of them.
+         */
+        auto isInAtlas() const { return subpassData[0].tile.size != 0; }
 
         /**
-         * Updates the graphics pipelines based on active pipeline IDs
-         * @param pipelineIds Map of pipeline IDs to unique object IDs
+         * Appends the views of the shadow maps to the list of views culled by the
+         * frustum culling and remembers their indices for the rendering.
+         * Must be called after update().
+         * @param views List of views culled in the frame
          */
-        void updatePipelines(const std::unordered_map<pipeline_id, std::vector<unique_id>>& pipelineIds);
+        void addCullingViews(std::vector<CullingView>& views);
+
+        /**
+         * Enables or disables the static instances caches.
+         * @param enabled true to render the static instances in the caches
+         */
+        void setCacheEnabled(bool enabled);
+
+        /**
+         * Enables or disables the rendering of the six faces of an omni light in one pass.
+         * Ignored for the other lights. Falls back to one pass per face for all the lights
+         * if the single pass pipeline can't be created, see isSinglePassSupported().
+         * @param enabled true to render the faces in one pass, false for one pass per face
+         */
+        void setSinglePassEnabled(bool enabled);
+
+        /**
+         * Returns false once the single pass pipeline failed to be created, the device not
+         * supporting the clip distances in the vertex shader.
+         */
+        static auto isSinglePassSupported() { return singlePassSupported; }
+
+        /**
+         * Invalidates the caches of the shadow maps seeing a static instance.
+         * @param aabb World space bounding box of the static instance
+         */
+        void invalidateCache(const AABB& aabb);
 
         /**
          * Sets the current camera for cascaded shadow maps calculation
@@ -68,37 +139,29 @@ export namespace lysa {
         void update(uint32 frameIndex) override;
 
         /**
-         * Renders the shadow maps
+         * Renders the static instances in the caches which need it, outside the rendering
+         * of the shadow atlas.
          * @param commandList The command list to record rendering commands into
          * @param scene The scene frame data
          */
-        void render(
+        void renderCaches(
             vireo::CommandList& commandList,
             const SceneFrameData& scene);
 
         /**
-         * Gets the number of shadow maps (subpasses)
-         * @return The number of shadow maps
-         */
-        auto getShadowMapCount() const { return subpassesCount; }
-
-        /**
-         * Gets a shadow map render target
-         * @param index Index of the shadow map
-         * @return A shared pointer to the shadow map render target
+         * Renders the shadow maps in their tiles, during the rendering of the shadow atlas
+         * @param commandList The command list to record rendering commands into
+         * @param scene The scene frame data
          */
-        auto getShadowMap(const uint32 index) const {
-            return subpassData[index].shadowMap;
-        }
+        void render(
+            vireo::CommandList& commandList,
+            const SceneFrameData& scene) const;
 
         /**
-         * Gets a transparency color map render target
-         * @param index Index of the shadow map
-         * @return A shared pointer to the transparency color map render target
+         * Gets the number of shadow maps (subpasses)
+         * @return The number of shadow maps
          */
-        auto getTransparencyColorMap(const uint32 index) const {
-            return subpassData[index].transparencyColorMap;
-        }
+        auto getShadowMapCount() const { return subpassesCount; }
 
         /**
          * Gets the light space matrix for a shadow map
@@ -122,6 +185,9 @@ export namespace lysa {
         const std::string VERTEX_SHADER{"shadowmap.vert"};
         const std::string FRAGMENT_SHADER{"shadowmap.frag"};
         const std::string FRAGMENT_SHADER_CUBEMAP{"shadowmap_cubemap.frag"};
+        const std::string VERTEX_SHADER_CUBEMAP{"shadowmap_cubemap.vert"};
+        const std::string CACHE_VERTEX_SHADER{"quad.vert"};
+        const std::string CACHE_FRAGMENT_SHADER{"shadowmap_cache.frag"};
 
         static constexpr uint32 SET_RESOURCES{0};
         static constexpr uint32 SET_SCENE{1};
@@ -129,6 +195,12 @@ export namespace lysa {
         static constexpr uint32 SET_PASS{3};
         static constexpr uint32 SET_SAMPLERS{4};
         static constexpr vireo::DescriptorIndex BINDING_GLOBAL{0};
+        static constexpr vireo::DescriptorIndex BINDING_CACHE{1};
+        static constexpr vireo::DescriptorIndex BINDING_CUBE_FACES{1};
+        /* Maximum depth shift of a scrolled cache before rendering it again, see CacheData::depthShift. */
+        static constexpr float CACHE_MAX_DEPTH_SHIFT{0.1f};
+        /* Distance, in powers of two, between the wanted and the current tile sizes before a resize beyond the nearest one. */
+        static constexpr float TILE_SIZE_HYSTERESIS{0.25f};
 
         struct GlobalUniform {
             float4x4 lightSpace;
@@ -138,21 +210,62 @@ export namespace lysa {
             float    splitDepth;
         };
 
+        struct CubeFacesUniform {
+            float4x4 lightSpace[6];
+            // X: scale, YZ: offset, from the NDC of a face to the NDC of the shadow atlas
+            float4   tiles[6];
+        };
+
+        struct CacheGlobal {
+            int32 texelOffsetX;
+            int32 texelOffsetY;
+            int32 tileOriginX;
+            int32 tileOriginY;
+            float depthOffset;
+            float _pad0[3];
+        };
+
+        enum class CacheUpdate {
+            // The cache is up to date
+            NONE,
+            // All the static instances are rendered in the cache
+            FULL,
+            // The cache is shifted and the newly exposed borders are rendered
+            SCROLL,
+        };
+
+        struct CacheData {
+            // Two maps for the cascades : the scrolling copies one in the other
+            std::shared_ptr<vireo::RenderTarget> maps[2];
+            std::shared_ptr<vireo::Buffer> globalBuffers[2];
+            std::shared_ptr<vireo::DescriptorSet> descriptorSets[2];
+            bool mapsInitialized[2]{false, false};
+            uint32 current{0};
+            bool valid{false};
+            // Light space matrix used to render the current map
+            float4x4 lightSpace;
+            // Depth offset accumulated by the scrolling since the last full rendering
+            float depthShift{0.0f};
+            CacheUpdate update{CacheUpdate::NONE};
+            int32 texelOffsetX{0};
+            int32 texelOffsetY{0};
+            float depthOffset{0.0f};
+        };
+
         struct SubpassData {
-            float4x4 inverseViewMatrix;
             float4x4 projection;
             GlobalUniform globalUniform;
-            std::shared_ptr<vireo::RenderTarget> shadowMap;
-            std::shared_ptr<vireo::RenderTarget> transparencyColorMap;
+            uint32 cullingView{0};
+            uint32 staticCullingView{0};
+            CacheData cache;
+            ShadowAtlasAllocator::Tile tile;
             std::shared_ptr<vireo::Buffer> globalUniformBuffer;
             std::shared_ptr<vireo::DescriptorSet> descriptorSet;
-            std::map<pipeline_id, std::shared_ptr<FrustumCulling>> frustumCullingPipelines;
-            std::map<pipeline_id, std::shared_ptr<vireo::Buffer>> culledDrawCommandsBuffers;
-            std::map<pipeline_id, std::shared_ptr<vireo::Buffer>> culledDrawCommandsCountBuffers;
         };
 
         const bool isCubeMap;
         const bool isCascaded;
+        const uint32 atlasSize;
         uint32 subpassesCount;
         Camera* currentCamera{nullptr};
         float3 lastLightPosition{-10000.0f};
@@ -165,10 +278,10 @@ export namespace lysa {
 
         vireo::GraphicPipelineConfiguration pipelineConfig {
 #ifdef SHADOW_TRANSPARENCY_COLOR_ENABLED
-            .colorRenderFormats = { vireo::ImageFormat::R8G8B8A8_SNORM }, // Packed RGB + alpha
+            .colorRenderFormats = { SceneFrameData::SHADOW_ATLAS_TRANSPARENCY_COLOR_FORMAT },
             .colorBlendDesc = {{}},
 #endif
-            .depthStencilImageFormat = vireo::ImageFormat::D32_SFLOAT,
+            .depthStencilImageFormat = SceneFrameData::SHADOW_ATLAS_FORMAT,
             .depthTestEnable = true,
             .depthWriteEnable = true,
             .depthBiasEnable = true,
@@ -176,23 +289,38 @@ export namespace lysa {
             .depthBiasSlopeFactor = 1.75f,
         };
 
-        vireo::RenderingConfiguration renderingConfig {
-#ifdef SHADOW_TRANSPARENCY_COLOR_ENABLED
-            .colorRenderTargets = {
-                {
-                    .clear = true,
-                    .clearValue{ .color = {0.0f, 0.0f, 0.0f, 1.0f} }
-                }},
-#endif
-            .depthTestEnable = pipelineConfig.depthTestEnable,
-            .clearDepthStencil = true,
-            .discardDepthStencilAfterRender = false,
+        /* Cleared by the first failed creation of the single pass pipeline, for all the lights. */
+        inline static bool singlePassSupported{true};
+        bool singlePass{false};
+        uint32 cubeCullingView{0};
+        std::shared_ptr<vireo::DescriptorLayout> cubeDescriptorLayout;
+        std::shared_ptr<vireo::GraphicPipeline> cubePipeline;
+        std::shared_ptr<vireo::Buffer> cubeFacesBuffer;
+        std::shared_ptr<vireo::DescriptorSet> cubeDescriptorSet;
+
+        bool cacheEnabled{false};
+        std::shared_ptr<vireo::DescriptorLayout> cacheDescriptorLayout;
+        std::shared_ptr<vireo::GraphicPipeline> cachePipeline;
+
+        vireo::GraphicPipelineConfiguration cachePipelineConfig {
+            .depthStencilImageFormat = SceneFrameData::SHADOW_ATLAS_FORMAT,
+            .depthTestEnable = true,
+            .depthWriteEnable = true,
         };
 
-        bool firstPass{true};
+        void updateCacheMaps(SubpassData& data) const;
+
+        void computeCacheUpdate(SubpassData& data) const;
+
+        void renderCache(vireo::CommandList& commandList, const SceneFrameData& scene, SubpassData& data) const;
+
+        void bindShadowMapPipeline(
+            vireo::CommandList& commandList,
+            const SceneFrameData& scene,
+            const std::shared_ptr<vireo::GraphicPipeline>& pipeline,
+            const std::shared_ptr<vireo::DescriptorSet>& descriptorSet) const;
 
-        const size_t maxMeshSurfacePerPipeline;
-        const DeviceMemoryArray& meshInstancesDataArray;
+        void copyCache(vireo::CommandList& commandList, const CacheData& cache, uint32 index, const ShadowAtlasAllocator::Tile& tile, int32 texelOffsetX, int32 texelOffsetY, float depthOffset) const;
 
         const Light* light;
         std::shared_ptr<vireo::GraphicPipeline> pipeline;
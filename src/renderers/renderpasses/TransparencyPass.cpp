@@ -11,8 +11,7 @@ namespace lysa {
 
     TransparencyPass::TransparencyPass(
         const RendererConfiguration& config):
-        Renderpass{config, "OIT Transparency"},
-        materialManager(ctx().res.get<MaterialManager>()) {
+        Renderpass{config, "OIT Transparency"} {
 
         oitPipelineConfig.depthStencilImageFormat = config.depthStencilFormat;
         oitPipelineConfig.backStencilOpState = oitPipelineConfig.frontStencilOpState;
@@ -52,15 +51,16 @@ namespace lysa {
         }
     }
 
-    void TransparencyPass::updatePipelines(const std::unordered_map<pipeline_id, std::vector<unique_id>>& pipelineIds) {
-        for (const auto& [pipelineId, materials] : pipelineIds) {
-            if (!oitPipelines.contains(pipelineId)) {
-                const auto& material = materialManager[materials.at(0)];
+    void TransparencyPass::updatePipelines(
+        const std::vector<MaterialPipeline>& materialPipelines,
+        PipelineCompiler& compiler) {
+        for (const auto& material : materialPipelines) {
+            if (!oitPipelines.contains(material.pipelineId)) {
                 std::string fragShaderName = FRAGMENT_SHADER_OIT;
-                oitPipelineConfig.cullMode = material.getCullMode();
+                oitPipelineConfig.cullMode = material.cullMode;
                 oitPipelineConfig.vertexShader = loadShader(VERTEX_SHADER_OIT);
                 oitPipelineConfig.fragmentShader = loadShader(fragShaderName);
-                oitPipelines[pipelineId] = ctx().vireo->createGraphicPipeline(oitPipelineConfig, "Transparency OIT");
+                compiler.compile(oitPipelines, material.pipelineId, oitPipelineConfig, "Transparency OIT");
             }
         }
     }
@@ -12,6 +12,8 @@ import lysa.types;
 import lysa.resources.material;
 import lysa.renderers.configuration;
 import lysa.renderers.scene_frame_data;
+import lysa.renderers.pipeline_compiler;
+import lysa.renderers.pipeline_manifest;
 import lysa.renderers.renderpasses.renderpass;
 
 export namespace lysa {
@@ -30,10 +32,12 @@ export namespace lysa {
 
         /**
          * Updates the OIT graphics pipelines based on active pipeline IDs
-         * @param pipelineIds Map of pipeline IDs to unique object IDs
+         * @param materialPipelines Material flags of the pipeline ids
+         * @param compiler Compiler of the pipelines, see PipelineCompiler::compile()
          */
         void updatePipelines(
-           const std::unordered_map<pipeline_id, std::vector<unique_id>>& pipelineIds);
+            const std::vector<MaterialPipeline>& materialPipelines,
+            PipelineCompiler& compiler);
 
         /**
          * Resizes the render pass resources
@@ -146,7 +150,6 @@ export namespace lysa {
             .depthTestEnable = compositePipelineConfig.depthTestEnable,
         };
 
-        const MaterialManager& materialManager;
         std::vector<FrameData> framesData;
         std::shared_ptr<vireo::Pipeline> compositePipeline;
         std::shared_ptr<vireo::DescriptorLayout> compositeDescriptorLayout;
@@ -0,0 +1,61 @@
+/*
+* Copyright (c) 2025-present Henri Michelon
+*
+* This software is released under the MIT License.
+* https://opensource.org/licenses/MIT
+*/
+export module lysa.renderers.renderpasses.upscaling_pass;
+
+import vireo;
+import lysa.context;
+import lysa.math;
+import lysa.renderers.configuration;
+import lysa.renderers.dynamic_resolution;
+import lysa.renderers.renderpasses.post_processing;
+
+export namespace lysa {
+
+    /**
+     * Render pass upscaling the final image of the renderer to the swap chain resolution,
+     * see DynamicResolution.
+     *
+     * The attachments of the renderer are allocated at the maximum scale, the pass only samples
+     * their rendered part, see setRenderScale().
+     */
+    class UpscalingPass : public PostProcessing {
+    public:
+        /**
+         * Constructs an UpscalingPass
+         * @param config The renderer configuration
+         * @param outputFormat Format of the swap chain
+         * @param filter The upscaling filter
+         * @param sharpness Strength of the UpscalingFilter::SHARPEN filter
+         */
+        UpscalingPass(
+            const RendererConfiguration& config,
+            const vireo::ImageFormat outputFormat,
+            const UpscalingFilter filter,
+            const float sharpness) :
+            PostProcessing(
+                config,
+                outputFormat,
+                "upscaling",
+                &upscalingData, sizeof(upscalingData),
+                "Upscaling"),
+            upscalingData{ .sharpness = filter == UpscalingFilter::SHARPEN ? sharpness : 0.0f } {
+        }
+
+        /**
+         * Sets the rendered part of the input image, from the top left corner
+         * @param renderScale Size of the rendered part divided by the size of the image
+         */
+        void setRenderScale(const float2& renderScale) { upscalingData.renderScale = renderScale; }
+
+    private:
+        /** Upscaling parameters. */
+        struct {
+            float  sharpness;
+            float2 renderScale{1.0f};
+        } upscalingData;
+    };
+}
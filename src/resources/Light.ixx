@@ -43,14 +43,23 @@ export namespace lysa {
         float4 direction{0.0f};
         /** Light color (RGB) + Intensity (A) */
         float4 color{1.0f, 1.0f, 1.0f, 1.0f};
-        /** Shadow map index */
+        /** Index of the ShadowData of the light, -1 if the light has no shadow maps in the atlas */
         int32 mapIndex{-1};
         /** Number of cascades for directional shadows */
         uint32 cascadesCount{0};
+        uint32 _pad0[2]{0, 0};
         /** Cascade split depths */
         float4 cascadeSplitDepth{0.0f};
-        /** Light space matrices for shadows */
+    };
+
+    /**
+    * Shadow maps data of a shadow casting light in GPU memory
+    */
+    struct ShadowData {
+        /** Light space matrices of the shadow maps */
         float4x4 lightSpace[6];
+        /** Tiles of the shadow maps in the shadow atlas, XY: UV offset, ZW: UV scale */
+        float4 shadowMapTiles[6];
     };
 
     /**
@@ -73,7 +82,7 @@ export namespace lysa {
         float outerCutOff;
         /** Whether the light casts shadows */
         bool castShadows;
-        /** Resolution of the shadow map */
+        /** Resolution of the shadow map when the light covers the screen */
         uint32 shadowMapSize;
         /** Whether the light is visible/active */
         bool visible{true};
@@ -68,6 +68,18 @@ namespace lysa {
         localAABB = {min, max};
     }
 
+    void Mesh::buildBVH() {
+        auto positions = std::vector<float3>(vertices.size());
+        for (auto i = 0; i < vertices.size(); i++) {
+            positions[i] = vertices[i].position;
+        }
+        auto surfacesRanges = std::vector<std::pair<uint32, uint32>>(surfaces.size());
+        for (auto i = 0; i < surfaces.size(); i++) {
+            surfacesRanges[i] = {surfaces[i].firstIndex, surfaces[i].indexCount};
+        }
+        bvh = std::make_unique<TriangleBVH>(positions, indices, surfacesRanges);
+    }
+
     MeshManager::MeshManager(
         const size_t capacity,
         const size_t vertexCapacity,
@@ -168,6 +180,7 @@ namespace lysa {
                 surfaceData[i].verticesIndex = mesh.verticesMemoryBlock.instanceIndex;
             }
             meshSurfaceArray.write(mesh.surfacesMemoryBlock, surfaceData.data());
+            mesh.revision += 1;
         }
         needUpload.clear();
 
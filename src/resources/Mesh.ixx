@@ -15,6 +15,7 @@ import lysa.memory;
 import lysa.resources;
 import lysa.resources.material;
 import lysa.resources.manager;
+import lysa.triangle_bvh;
 
 export namespace lysa {
 
@@ -159,6 +160,24 @@ export namespace lysa {
 
         void buildAABB();
 
+        /**
+         * Builds the triangles BVH used for precise ray casting from the CPU copy of the
+         * vertices and indices. Must be called again after modifying the vertices, indices
+         * or surfaces.
+         */
+        void buildBVH();
+
+        /**
+         * Returns the triangles BVH, or nullptr if buildBVH() has not been called.
+         */
+        const TriangleBVH* getBVH() const { return bvh.get(); }
+
+        /**
+         * Returns the number of uploads of the vertices and indices, see MeshManager::upload().
+         * The CPU copies of the geometry compare it to know when to refresh.
+         */
+        auto getRevision() const { return revision; }
+
         constexpr const std::string& getName() const { return name; }
 
     protected:
@@ -169,9 +188,11 @@ export namespace lysa {
 
         std::vector<MeshSurface> surfaces{};
         std::unordered_set<unique_id> materials{};
+        std::unique_ptr<TriangleBVH> bvh;
 
     private:
         friend class MeshManager;
+        uint32 revision{0};
         MemoryBlock verticesMemoryBlock;
         MemoryBlock indicesMemoryBlock;
         MemoryBlock surfacesMemoryBlock;
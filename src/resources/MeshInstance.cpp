@@ -26,6 +26,8 @@ namespace lysa {
         name(name),
         visible(mi.visible),
         castShadows(mi.castShadows),
+        occluder(mi.occluder),
+        staticInstance(mi.staticInstance),
         worldAABB(mi.worldAABB),
         worldTransform(mi.worldTransform) {
         meshManager.use(mesh.id);
@@ -38,6 +40,8 @@ namespace lysa {
         name(orig.name),
         visible(orig.visible),
         castShadows(orig.castShadows),
+        occluder(orig.occluder),
+        staticInstance(orig.staticInstance),
         worldAABB(orig.worldAABB),
         worldTransform(orig.worldTransform) {
         meshManager.use(mesh.id);
@@ -68,6 +72,7 @@ namespace lysa {
             .aabbMax = worldAABB.max,
             .visible = visible ? 1u : 0u,
             .castShadows = castShadows ? 1u : 0u,
+            .isStatic = staticInstance ? 1u : 0u,
         };
     }
 
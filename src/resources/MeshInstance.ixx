@@ -31,6 +31,9 @@ export namespace lysa {
         uint     visible;
         /** Shadow casting flag (1 if casting shadows, 0 otherwise) */
         uint     castShadows;
+        /** Static flag (1 if the instance never moves, 0 otherwise) */
+        uint     isStatic;
+        uint     _pad0;
     };
 
     /**
@@ -74,6 +77,29 @@ export namespace lysa {
          */
         void setCastShadows(const bool castShadows) { this->castShadows = castShadows; }
 
+        /**
+         * Returns `true` if the instance is used as an occluder by the software occlusion culling
+         */
+        bool isOccluder() const { return occluder; }
+
+        /**
+         * Sets whether the instance is used as an occluder by the software occlusion culling.
+         * Occluders should be large, simple and opaque meshes like walls or terrain.
+         */
+        void setOccluder(const bool occluder) { this->occluder = occluder; }
+
+        /**
+         * Returns `true` if the instance never moves
+         */
+        bool isStatic() const { return staticInstance; }
+
+        /**
+         * Sets whether the instance never moves. The shadows of the static instances are
+         * rendered once in the shadow maps caches and re-rendered only when a static
+         * instance changes or when the light moves.
+         */
+        void setStatic(const bool isStatic) { staticInstance = isStatic; }
+
         /**
          * Returns the world-space AABB of the instance
          */
@@ -139,6 +165,10 @@ export namespace lysa {
         bool visible{true};
         /* Shadow casting flag */
         bool castShadows{false};
+        /* Software occlusion culling occluder flag */
+        bool occluder{false};
+        /* Static instance flag */
+        bool staticInstance{false};
         /* World-space AABB */
         AABB worldAABB{};
         /* World transformation matrix */
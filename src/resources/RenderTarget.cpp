@@ -10,6 +10,7 @@ import vireo;
 import lysa.exception;
 import lysa.log;
 import lysa.renderers.renderer;
+import lysa.renderers.scene_frame_data;
 
 namespace lysa {
 
@@ -30,6 +31,20 @@ namespace lysa {
             configuration.presentMode,
             ctx().config.framesInFlight);
         renderer = Renderer::create(rendererConfiguration, swapChain->getFormat());
+        if (configuration.dynamicResolution.enabled) {
+            dynamicResolution = std::make_unique<DynamicResolution>(configuration.dynamicResolution);
+            upscalingPass = std::make_unique<UpscalingPass>(
+                rendererConfiguration,
+                swapChain->getFormat(),
+                configuration.dynamicResolution.upscalingFilter,
+                configuration.dynamicResolution.sharpness);
+            upscalingPass->setExternalColorAttachments(true);
+        }
+        if (configuration.recordingThreads > 1) {
+            recordingScheduler = std::make_unique<RecordingScheduler>(
+                configuration.recordingThreads,
+                vireo::CommandType::GRAPHIC);
+        }
         framesData.resize(ctx().config.framesInFlight);
         for (auto& frame : framesData) {
             frame.inFlightFence = ctx().vireo->createFence(true, "inFlightFence");
@@ -40,19 +55,19 @@ namespace lysa {
             frame.updateCommandList = frame.commandAllocator->createCommandList();
             frame.computeCommandList = frame.commandAllocator->createCommandList();
             frame.prepareCommandList = frame.commandAllocator->createCommandList();
+            frame.depthPrePassCommandList = frame.commandAllocator->createCommandList();
             frame.renderCommandList = frame.commandAllocator->createCommandList();
+            if (ctx().computeQueue) {
+                frame.asyncComputeCommandAllocator = ctx().vireo->createCommandAllocator(vireo::CommandType::COMPUTE);
+                frame.asyncComputeSemaphore = ctx().vireo->createSemaphore(vireo::SemaphoreType::BINARY, "Async compute");
+                frame.asyncComputeCommandList = frame.asyncComputeCommandAllocator->createCommandList();
+            }
         }
 
         // Create the main rendering attachments
-        const auto& frame = framesData[0];
-        frame.commandAllocator->reset();
-        frame.prepareCommandList->begin();
-        renderer->resize(swapChain->getExtent(), frame.prepareCommandList);
-        frame.prepareCommandList->end();
-        ctx().graphicQueue->submit({frame.prepareCommandList});
-        ctx().graphicQueue->waitIdle();
-
         const auto extent = swapChain->getExtent();
+        resizeAttachments(dynamicResolution ? dynamicResolution->getMaxExtent(extent) : extent, extent);
+
         mainViewport = vireo::Viewport{
             static_cast<float>(extent.width),
             static_cast<float>(extent.height)};
@@ -92,6 +107,10 @@ namespace lysa {
         auto lock = std::unique_lock{viewsMutex};
         swapChain->waitIdle();
         views.remove(view);
+        if (std::ranges::none_of(views, [&](const RenderView& other) {
+            return &other.scene == &view.scene && &other.camera == &view.camera; })) {
+            view.scene.releaseOcclusion(view.camera);
+        }
     }
 
     void RenderTarget::updateView(RenderView& view) {
@@ -102,6 +121,7 @@ namespace lysa {
     void RenderTarget::setPause(const bool pause) {
         if (paused != pause) {
             paused = pause;
+            lastFrameTime = {};
             const auto event = Event{
                 .type = static_cast<event_type>(paused ? RenderTargetEvent::PAUSED : RenderTargetEvent::RESUMED),
                 .id = id};
@@ -122,15 +142,12 @@ namespace lysa {
         mainScissors = vireo::Rect {
             newExtent.width,
             newExtent.height};
-        if (renderer->getExtent().width != newExtent.width || renderer->getExtent().height != newExtent.height) {
-            const auto& frame = framesData[0];
+        const auto attachmentsExtent = dynamicResolution ? dynamicResolution->getMaxExtent(newExtent) : newExtent;
+        // The upscaled attachments follow the swap chain even if the rendering extent does not change
+        if (dynamicResolution ||
+            renderer->getExtent().width != attachmentsExtent.width || renderer->getExtent().height != attachmentsExtent.height) {
             // viewportManager.resize(id, newExtent);
-            frame.commandAllocator->reset();
-            frame.prepareCommandList->begin();
-            renderer->resize(newExtent, frame.prepareCommandList);
-            frame.prepareCommandList->end();
-            ctx().graphicQueue->submit({frame.prepareCommandList});
-            ctx().graphicQueue->waitIdle();
+            resizeAttachments(attachmentsExtent, newExtent);
             const auto event = Event{static_cast<event_type>(RenderTargetEvent::RESIZED), newExtent, id};
             ctx().events.push(event);
         }
@@ -143,20 +160,48 @@ namespace lysa {
         const auto frameIndex = swapChain->getCurrentFrameIndex();
         const auto& frame = framesData[frameIndex];
         if (!swapChain->acquire(frame.inFlightFence)) { return; }
+        const auto frameTime = measureFrameTime();
+        if (dynamicResolution && frameTime > 0.0) {
+            // A new scale only changes the viewports, the attachments are kept
+            dynamicResolution->update(frameTime);
+        }
+        const auto renderExtent = getRenderExtent();
+        renderer->setRenderExtent(renderExtent);
+        if (upscalingPass) {
+            upscalingPass->setRenderScale(float2{
+                static_cast<float>(renderExtent.width) / static_cast<float>(renderer->getExtent().width),
+                static_cast<float>(renderExtent.height) / static_cast<float>(renderer->getExtent().height)});
+        }
         frame.commandAllocator->reset();
+        // The software occlusion is computed for each camera, the scene updates once per scene
+        auto scenes = std::vector<Scene*>{};
         for (auto& view : views) {
-            view.scene.processDeferredOperations(frameIndex);
-            auto& data = view.scene.get(frameIndex);
+            view.scene.cullOccludedInstances(view.camera);
+            if (std::ranges::find(scenes, &view.scene) == scenes.end()) {
+                scenes.push_back(&view.scene);
+            }
+        }
+        for (auto* scene : scenes) {
+            scene->processDeferredOperations();
+            auto& data = scene->get(frameIndex);
             if (data.isMaterialsUpdated()) {
                 renderer->updatePipelines(data);
                 data.resetMaterialsUpdated();
             }
         }
         renderer->update(frameIndex);
+        if (upscalingPass) {
+            upscalingPass->update(frameIndex);
+        }
 
         frame.updateCommandList->begin();
         for (auto& view : views) {
-            view.scene.get(frameIndex).update(*frame.updateCommandList, view.camera, rendererConfiguration, frameIndex);
+            view.scene.get(frameIndex).update(
+                *frame.updateCommandList,
+                view.camera,
+                rendererConfiguration,
+                frameIndex,
+                view.scene.getOccludedInstances(view.camera));
         }
         for (auto* vectorRenderer : vector3DRenderers) {
             vectorRenderer->update(
@@ -170,9 +215,15 @@ namespace lysa {
             frame.updateSemaphore,
             {frame.updateCommandList});
 
+        // The culling is needed by the shadow maps, the light clustering only by the color passes
+        const auto asyncCompute = isAsyncCompute();
         frame.computeCommandList->begin();
         for (auto& view : views) {
-            view.scene.get(frameIndex).compute(*frame.computeCommandList, view.camera);
+            auto& data = view.scene.get(frameIndex);
+            data.compute(*frame.computeCommandList, view.camera);
+            if (!asyncCompute) {
+                data.computeLightClustering(*frame.computeCommandList, view.camera, false);
+            }
         }
         frame.computeCommandList->end();
         ctx().graphicQueue->submit(
@@ -182,18 +233,45 @@ namespace lysa {
             frame.computeSemaphore,
             {frame.computeCommandList});
 
-        frame.prepareCommandList->begin();
-        for (auto& view : views) {
-            auto& data = view.scene.get(frameIndex);
-            renderer->prepare(*frame.prepareCommandList, data, view.viewport, view.scissors, frameIndex);
+        if (asyncCompute) {
+            frame.asyncComputeCommandAllocator->reset();
+            frame.asyncComputeCommandList->begin();
+            for (auto& view : views) {
+                view.scene.get(frameIndex).computeLightClustering(*frame.asyncComputeCommandList, view.camera, true);
+            }
+            frame.asyncComputeCommandList->end();
+            ctx().computeQueue->submit(
+                frame.computeSemaphore,
+                vireo::WaitStage::COMPUTE_SHADER,
+                vireo::WaitStage::COMPUTE_SHADER,
+                frame.asyncComputeSemaphore,
+                {frame.asyncComputeCommandList});
+        }
+
+        auto prepareCommandLists = std::vector<std::shared_ptr<const vireo::CommandList>>{};
+        if (recordingScheduler) {
+            recordPrepare(frame, frameIndex, prepareCommandLists);
+        } else {
+            frame.prepareCommandList->begin();
+            for (auto& view : views) {
+                auto& data = view.scene.get(frameIndex);
+                renderer->prepare(*frame.prepareCommandList, data, getRenderViewport(view), getRenderScissors(view), frameIndex);
+            }
+            frame.prepareCommandList->end();
+            prepareCommandLists.push_back(frame.prepareCommandList);
+        }
+        if (asyncCompute) {
+            // Runs during the light clustering. The culling submitted before in the same queue
+            // ends with barriers to the indirect draw state.
+            ctx().graphicQueue->submit(prepareCommandLists);
+        } else {
+            ctx().graphicQueue->submit(
+                frame.computeSemaphore,
+                vireo::WaitStage::VERTEX_INPUT,
+                vireo::WaitStage::ALL_COMMANDS,
+                frame.prepareSemaphore,
+                prepareCommandLists);
         }
-        frame.prepareCommandList->end();
-        ctx().graphicQueue->submit(
-            frame.computeSemaphore,
-            vireo::WaitStage::VERTEX_INPUT,
-            vireo::WaitStage::ALL_COMMANDS,
-            frame.prepareSemaphore,
-            {frame.prepareCommandList});
 
         auto& commandList = frame.renderCommandList;
         commandList->begin();
@@ -203,8 +281,8 @@ namespace lysa {
             renderer->render(
                 *commandList,
                 data,
-                view.viewport,
-                view.scissors,
+                getRenderViewport(view),
+                getRenderScissors(view),
                 clearAttachment,
                 frameIndex);
             clearAttachment = false;
@@ -215,8 +293,14 @@ namespace lysa {
 
         auto colorAttachment = renderer->getCurrentColorAttachment(frameIndex);
         const auto depthAttachment = renderer->getDepthAttachment(frameIndex);
+        const auto upscaling = isUpscaling();
         for (auto& view : views) {
             for (auto* vectorRenderer : vector3DRenderers) {
+                // The UI renderers draw at the swap chain resolution, after the upscaling
+                if (upscaling && !vectorRenderer->isUseCamera()) { continue; }
+                // The post-processing passes leave the viewport of the whole attachments
+                commandList->setViewport(vectorRenderer->isUseCamera() ? getRenderViewport(view) : mainViewport);
+                commandList->setScissors(vectorRenderer->isUseCamera() ? getRenderScissors(view) : mainScissors);
                 vectorRenderer->render(
                     *commandList,
                     view.camera,
@@ -228,9 +312,32 @@ namespace lysa {
         }
         colorAttachment = renderer->gammaCorrection(
             *commandList,
-            colorAttachment,
             frameIndex);
 
+        if (upscaling) {
+            const auto& upscaledColorAttachment = frame.upscaledColorAttachment;
+            commandList->barrier(colorAttachment, vireo::ResourceState::UNDEFINED, vireo::ResourceState::SHADER_READ);
+            commandList->barrier(upscaledColorAttachment, vireo::ResourceState::UNDEFINED, vireo::ResourceState::RENDER_TARGET_COLOR);
+            upscalingPass->render(*commandList, colorAttachment, nullptr, frameIndex);
+            commandList->barrier(upscaledColorAttachment, vireo::ResourceState::RENDER_TARGET_COLOR, vireo::ResourceState::UNDEFINED);
+            commandList->barrier(colorAttachment, vireo::ResourceState::SHADER_READ, vireo::ResourceState::UNDEFINED);
+            for (auto& view : views) {
+                for (auto* vectorRenderer : vector3DRenderers) {
+                    if (vectorRenderer->isUseCamera()) { continue; }
+                    commandList->setViewport(mainViewport);
+                    commandList->setScissors(mainScissors);
+                    vectorRenderer->render(
+                        *commandList,
+                        view.camera,
+                        upscaledColorAttachment,
+                        nullptr,
+                        frameIndex
+                    );
+                }
+            }
+            colorAttachment = upscaledColorAttachment;
+        }
+
         commandList->barrier(colorAttachment, vireo::ResourceState::UNDEFINED,vireo::ResourceState::COPY_SRC);
         commandList->barrier(swapChain, vireo::ResourceState::UNDEFINED, vireo::ResourceState::COPY_DST);
         commandList->copy(colorAttachment->getImage(), swapChain);
@@ -239,7 +346,7 @@ namespace lysa {
         commandList->end();
 
         ctx().graphicQueue->submit(
-            frame.prepareSemaphore,
+            asyncCompute ? frame.asyncComputeSemaphore : frame.prepareSemaphore,
             vireo::WaitStage::VERTEX_INPUT,
             frame.inFlightFence,
             swapChain,
@@ -248,8 +355,173 @@ namespace lysa {
         swapChain->nextFrameIndex();
     }
 
+    void RenderTarget::recordPrepare(
+        const FrameData& frame,
+        const uint32 frameIndex,
+        std::vector<std::shared_ptr<const vireo::CommandList>>& commandLists) {
+        // The shadow maps of a scene are rendered once, even when several views show the scene
+        auto scenes = std::vector<const SceneFrameData*>{};
+        for (auto& view : views) {
+            const auto* data = &view.scene.get(frameIndex);
+            if (std::ranges::find(scenes, data) == scenes.end()) {
+                scenes.push_back(data);
+            }
+        }
+
+        // The shadow maps caches change the state of the shadow map passes : recorded before the jobs
+        frame.prepareCommandList->begin();
+        for (const auto* scene : scenes) {
+            scene->beginShadowMaps(*frame.prepareCommandList);
+        }
+        frame.prepareCommandList->end();
+        commandLists.push_back(frame.prepareCommandList);
+
+        recordingJobs.clear();
+        for (const auto* scene : scenes) {
+            for (const auto& [first, count] : scene->splitShadowMaps(recordingScheduler->getThreadsCount())) {
+                recordingJobs.push_back([this, scene, first, count](vireo::CommandList& commandList) {
+                    renderer->bindMeshBuffers(commandList);
+                    scene->renderShadowMaps(commandList, first, count);
+                });
+            }
+        }
+        for (const auto& commandList : recordingScheduler->record(frameIndex, recordingJobs)) {
+            commandLists.push_back(commandList);
+        }
+
+        frame.depthPrePassCommandList->begin();
+        for (const auto* scene : scenes) {
+            scene->endShadowMaps(*frame.depthPrePassCommandList);
+        }
+        renderer->bindMeshBuffers(*frame.depthPrePassCommandList);
+        for (auto& view : views) {
+            auto& data = view.scene.get(frameIndex);
+            renderer->renderDepthPrePass(*frame.depthPrePassCommandList, data, getRenderViewport(view), getRenderScissors(view), frameIndex);
+        }
+        frame.depthPrePassCommandList->end();
+        commandLists.push_back(frame.depthPrePassCommandList);
+    }
+
+    double RenderTarget::measureFrameTime() {
+        const auto now = std::chrono::steady_clock::now();
+        const auto asyncCompute = isAsyncCompute();
+        auto frameTime = 0.0;
+        if (lastFrameTime != std::chrono::steady_clock::time_point{}) {
+            frameTime = std::chrono::duration<double, std::milli>(now - lastFrameTime).count();
+        }
+        if (frameTime > 0.0 && lastFrameAsyncCompute == asyncCompute) {
+            if (asyncCompute) {
+                asyncFramesTime += frameTime;
+                asyncFramesCount += 1;
+            } else {
+                syncFramesTime += frameTime;
+                syncFramesCount += 1;
+            }
+        }
+        lastFrameTime = now;
+        lastFrameAsyncCompute = asyncCompute;
+        return frameTime;
+    }
+
+    void RenderTarget::resizeAttachments(const vireo::Extent& attachmentsExtent, const vireo::Extent& swapChainExtent) {
+        const auto& frame = framesData[0];
+        frame.commandAllocator->reset();
+        frame.prepareCommandList->begin();
+        renderer->resize(attachmentsExtent, frame.prepareCommandList);
+        frame.prepareCommandList->end();
+        ctx().graphicQueue->submit({frame.prepareCommandList});
+        ctx().graphicQueue->waitIdle();
+        if (upscalingPass) {
+            upscalingPass->resize(swapChainExtent);
+            for (auto i = 0; i < framesData.size(); i++) {
+                framesData[i].upscaledColorAttachment = ctx().vireo->createRenderTarget(
+                    swapChain->getFormat(),
+                    swapChainExtent.width, swapChainExtent.height,
+                    vireo::RenderTargetType::COLOR,
+                    {},
+                    1,
+                    vireo::MSAA::NONE,
+                    "Upscaled color attachment");
+                upscalingPass->setColorAttachment(i, framesData[i].upscaledColorAttachment);
+            }
+        }
+    }
+
+    vireo::Extent RenderTarget::getRenderExtent() const {
+        const auto swapChainExtent = swapChain->getExtent();
+        return dynamicResolution ? dynamicResolution->getExtent(swapChainExtent) : swapChainExtent;
+    }
+
+    bool RenderTarget::isUpscaling() const {
+        const auto renderExtent = getRenderExtent();
+        const auto& attachmentsExtent = renderer->getExtent();
+        const auto swapChainExtent = swapChain->getExtent();
+        return renderExtent.width != swapChainExtent.width || renderExtent.height != swapChainExtent.height ||
+               attachmentsExtent.width != swapChainExtent.width || attachmentsExtent.height != swapChainExtent.height;
+    }
+
+    vireo::Viewport RenderTarget::getRenderViewport(const RenderView& view) const {
+        const auto renderExtent = getRenderExtent();
+        const auto swapChainExtent = swapChain->getExtent();
+        if (renderExtent.width == swapChainExtent.width && renderExtent.height == swapChainExtent.height) {
+            return view.viewport;
+        }
+        const auto scaleX = static_cast<float>(renderExtent.width) / static_cast<float>(swapChainExtent.width);
+        const auto scaleY = static_cast<float>(renderExtent.height) / static_cast<float>(swapChainExtent.height);
+        auto viewport = view.viewport;
+        viewport.x *= scaleX;
+        viewport.y *= scaleY;
+        viewport.width *= scaleX;
+        viewport.height *= scaleY;
+        return viewport;
+    }
+
+    vireo::Rect RenderTarget::getRenderScissors(const RenderView& view) const {
+        const auto renderExtent = getRenderExtent();
+        const auto swapChainExtent = swapChain->getExtent();
+        if (renderExtent.width == swapChainExtent.width && renderExtent.height == swapChainExtent.height) {
+            return view.scissors;
+        }
+        const auto scaleX = static_cast<float>(renderExtent.width) / static_cast<float>(swapChainExtent.width);
+        const auto scaleY = static_cast<float>(renderExtent.height) / static_cast<float>(swapChainExtent.height);
+        auto scissors = view.scissors;
+        scissors.x = static_cast<decltype(scissors.x)>(std::floor(static_cast<float>(view.scissors.x) * scaleX));
+        scissors.y = static_cast<decltype(scissors.y)>(std::floor(static_cast<float>(view.scissors.y) * scaleY));
+        scissors.width = static_cast<decltype(scissors.width)>(std::ceil(static_cast<float>(view.scissors.width) * scaleX));
+        scissors.height = static_cast<decltype(scissors.height)>(std::ceil(static_cast<float>(view.scissors.height) * scaleY));
+        return scissors;
+    }
+
+    AsyncComputeReport RenderTarget::getAsyncComputeReport() const {
+        auto report = AsyncComputeReport{
+            .available = ctx().computeQueue != nullptr,
+            .asyncFramesCount = asyncFramesCount,
+            .syncFramesCount = syncFramesCount,
+        };
+        if (asyncFramesCount > 0) {
+            report.asyncFrameTime = asyncFramesTime / static_cast<double>(asyncFramesCount);
+        }
+        if (syncFramesCount > 0) {
+            report.syncFrameTime = syncFramesTime / static_cast<double>(syncFramesCount);
+        }
+        if (asyncFramesCount > 0 && syncFramesCount > 0) {
+            report.overlapGain = report.syncFrameTime - report.asyncFrameTime;
+        }
+        return report;
+    }
+
     void RenderTarget::updatePipelines(const std::unordered_map<pipeline_id, std::vector<unique_id>>& pipelineIds) const {
         renderer->updatePipelines(pipelineIds);
     }
 
+    void RenderTarget::prewarmPipelines(const PipelineManifest& manifest) {
+        auto lock = std::unique_lock{viewsMutex};
+        renderer->prewarmPipelines(manifest);
+    }
+
+    PipelineManifest RenderTarget::getUsedPipelines() {
+        auto lock = std::unique_lock{viewsMutex};
+        return renderer->getUsedPipelines();
+    }
+
 }
\ No newline at end of file
@@ -12,8 +12,12 @@ import lysa.event;
 import lysa.input_event;
 import lysa.math;
 import lysa.renderers.configuration;
+import lysa.renderers.dynamic_resolution;
 import lysa.renderers.graphic_pipeline_data;
+import lysa.renderers.pipeline_manifest;
+import lysa.renderers.recording_scheduler;
 import lysa.renderers.renderer;
+import lysa.renderers.renderpasses.upscaling_pass;
 import lysa.renderers.vector_2d;
 import lysa.renderers.vector_3d;
 import lysa.resources;
@@ -31,6 +35,35 @@ export namespace lysa {
         vireo::PresentMode presentMode{vireo::PresentMode::IMMEDIATE};
         /** Configuration for the rendering path of the target */
         RendererConfiguration rendererConfiguration;
+        /**
+         * Number of threads recording the shadow maps, including the rendering thread.
+         * With 1 the shadow maps are recorded with the other pre-render commands.
+         */
+        uint32 recordingThreads{1};
+        /** Scaling of the rendering resolution driven by the frame times */
+        DynamicResolutionConfiguration dynamicResolution;
+    };
+
+    /**
+     * Frame times of a render target with and without the asynchronous compute,
+     * see RenderTarget::getAsyncComputeReport().
+     *
+     * The frame times are the times between two frames, the GPU frame times when the rendering
+     * is GPU bound with the IMMEDIATE presentation mode.
+     */
+    struct AsyncComputeReport {
+        /** A compute queue is available, see Context::computeQueue */
+        bool available{false};
+        /** Number of frames measured with the asynchronous compute */
+        uint64 asyncFramesCount{0};
+        /** Average frame time with the asynchronous compute, in milliseconds */
+        double asyncFrameTime{0.0};
+        /** Number of frames measured with all the compute work in the graphic queue */
+        uint64 syncFramesCount{0};
+        /** Average frame time with all the compute work in the graphic queue, in milliseconds */
+        double syncFrameTime{0.0};
+        /** Average frame time gained by the overlap, in milliseconds, 0 until both modes are measured */
+        double overlapGain{0.0};
     };
 
     /**
@@ -132,6 +165,23 @@ export namespace lysa {
          */
         void updatePipelines(const std::unordered_map<pipeline_id, std::vector<unique_id>>& pipelineIds) const;
 
+        /**
+         * Queues the compilation of the pipelines of a manifest, to call before the first frame
+         * using the assets of the manifest, see Renderer::prewarmPipelines()
+         */
+        void prewarmPipelines(const PipelineManifest& manifest);
+
+        /**
+         * Returns the progress of the pipelines prewarm, from 0.0 to 1.0, for the loading screens
+         */
+        float getPrewarmProgress() const { return renderer->getPrewarmProgress(); }
+
+        /**
+         * Returns the pipelines used by the views since the creation of the render target,
+         * to save with PipelineManifest::save() during a recording run
+         */
+        PipelineManifest getUsedPipelines();
+
         /** Resizes the render target */
         void resize();
 
@@ -152,6 +202,42 @@ export namespace lysa {
          */
         Renderer& getRenderer() const { return *renderer; }
 
+        /**
+         * Submits the light clustering to the compute queue, running during the shadow maps
+         * rendering, or records it in the graphic queue before the shadow maps.
+         * Ignored without a compute queue, see Context::computeQueue.
+         */
+        void setAsyncCompute(const bool enabled) { asyncCompute = enabled; }
+
+        /**
+         * Returns `true` if the light clustering is submitted to the compute queue
+         */
+        bool isAsyncCompute() const { return asyncCompute && ctx().computeQueue != nullptr; }
+
+        /**
+         * Returns the frame times measured with and without the asynchronous compute.
+         * Switch the mode with setAsyncCompute() to measure both.
+         */
+        AsyncComputeReport getAsyncComputeReport() const;
+
+        /**
+         * Returns the time spent recording the shadow maps in parallel during the last frame,
+         * in milliseconds, 0 with one recording thread, see RenderTargetConfiguration::recordingThreads.
+         */
+        double getRecordingTime() const { return recordingScheduler ? recordingScheduler->getRecordingTime() : 0.0; }
+
+        /**
+         * Returns the scale of the rendering resolution, 1.0 without the dynamic resolution,
+         * see RenderTargetConfiguration::dynamicResolution
+         */
+        float getRenderScale() const { return dynamicResolution ? dynamicResolution->getScale() : 1.0f; }
+
+        /**
+         * Returns the average frame time used by the dynamic resolution, in milliseconds,
+         * 0 without the dynamic resolution
+         */
+        double getAverageFrameTime() const { return dynamicResolution ? dynamicResolution->getAverageFrameTime() : 0.0; }
+
     private:
         /* Per-frame data */
         struct FrameData {
@@ -171,14 +257,35 @@ export namespace lysa {
             std::shared_ptr<vireo::CommandList> computeCommandList;
             /* Command list used for rendering into the swap chain. */
             std::shared_ptr<vireo::CommandList> prepareCommandList;
+            /* Command list used for the depth pre pass after the shadow maps recorded in parallel. */
+            std::shared_ptr<vireo::CommandList> depthPrePassCommandList;
             /* Command list used for rendering into the swap chain. */
             std::shared_ptr<vireo::CommandList> renderCommandList;
+            /* Command allocator for the asynchronous compute workloads, with a compute queue. */
+            std::shared_ptr<vireo::CommandAllocator> asyncComputeCommandAllocator;
+            /* Semaphore signaled when the asynchronous compute stage is finished. */
+            std::shared_ptr<vireo::Semaphore> asyncComputeSemaphore;
+            /* Command list used for the asynchronous compute workloads. */
+            std::shared_ptr<vireo::CommandList> asyncComputeCommandList;
+            /* Color attachment at the swap chain resolution, with the dynamic resolution. */
+            std::shared_ptr<vireo::RenderTarget> upscaledColorAttachment;
         };
 
         /* The renderer configuration */
         const RendererConfiguration rendererConfiguration;
         /* Set to true to pause the rendering in this target */
         bool paused{false};
+        /* Set to false to record all the compute work in the graphic queue */
+        bool asyncCompute{true};
+        /* Start of the previous frame, reset when paused */
+        std::chrono::steady_clock::time_point lastFrameTime{};
+        /* Mode of the previous frame, the frame times are measured between frames of the same mode */
+        bool lastFrameAsyncCompute{false};
+        /* Sums of the frame times in milliseconds, with and without the asynchronous compute */
+        double asyncFramesTime{0.0};
+        double syncFramesTime{0.0};
+        uint64 asyncFramesCount{0};
+        uint64 syncFramesCount{0};
         /* Array of per‑frame resource bundles (size = frames in flight). */
         std::vector<FrameData> framesData;
         /* Swap chain presenting the render target in memory. */
@@ -187,6 +294,14 @@ export namespace lysa {
         std::list<RenderView> views;
         /* Scene renderer used to draw attached views. */
         std::unique_ptr<Renderer> renderer;
+        /* Parallel recording of the shadow maps, nullptr with one recording thread */
+        std::unique_ptr<RecordingScheduler> recordingScheduler;
+        /* Recording jobs of the current frame */
+        std::vector<RecordingScheduler::Job> recordingJobs;
+        /* Scale of the rendering resolution, nullptr without the dynamic resolution */
+        std::unique_ptr<DynamicResolution> dynamicResolution;
+        /* Upscaling to the swap chain resolution, nullptr without the dynamic resolution */
+        std::unique_ptr<UpscalingPass> upscalingPass;
         /* Additional 3D Vector renderers */
         std::vector<Vector3DRenderer*> vector3DRenderers;
         /* Protect views to be modifies when render() is called */
@@ -195,6 +310,37 @@ export namespace lysa {
         vireo::Viewport mainViewport;
         /* The main scissors */
         vireo::Rect mainScissors;
+
+        /*
+         * Adds the time since the previous frame to the frame times of the current mode.
+         * Returns the time in milliseconds, 0 for the first frame after a pause.
+         */
+        double measureFrameTime();
+
+        /*
+         * Recreates the attachments of the renderer and of the upscaling for new extents.
+         * With the dynamic resolution the attachments of the renderer are allocated at the
+         * maximum scale, only the rendered part of them follows the scale.
+         */
+        void resizeAttachments(const vireo::Extent& attachmentsExtent, const vireo::Extent& swapChainExtent);
+
+        /* Returns the rendered part of the attachments of the renderer, from the top left corner */
+        vireo::Extent getRenderExtent() const;
+
+        /* Returns true if the renderer does not render at the swap chain resolution */
+        bool isUpscaling() const;
+
+        /* Returns the viewport of a view at the rendering resolution */
+        vireo::Viewport getRenderViewport(const RenderView& view) const;
+
+        /* Returns the scissors of a view at the rendering resolution */
+        vireo::Rect getRenderScissors(const RenderView& view) const;
+
+        /* Records the pre-render stage with the shadow maps recorded in parallel */
+        void recordPrepare(
+            const FrameData& frame,
+            uint32 frameIndex,
+            std::vector<std::shared_ptr<const vireo::CommandList>>& commandLists);
     };
 
 }
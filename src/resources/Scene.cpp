@@ -7,6 +7,7 @@
 module lysa.resources.scene;
 
 import lysa.exception;
+import lysa.frustum;
 import lysa.log;
 import lysa.resources.environment;
 
@@ -17,24 +18,37 @@ namespace lysa {
         imageManager(ctx().res.get<ImageManager>()),
         materialManager(ctx().res.get<MaterialManager>()),
         meshManager(ctx().res.get<MeshManager>()),
-        maxAsyncNodesUpdatedPerFrame(config.asyncObjectUpdatesPerFrame) {
+        asyncUpdatesBudget(config.asyncUpdatesBudget, config.asyncUpdatesInitialUnitCost, config.asyncUpdatesAging),
+        instancesTree(config.instancesTreeMargin, config.instancesTreeRebuildRatio),
+        softwareOcclusionWidth(config.softwareOcclusionCulling ? config.softwareOcclusionWidth : 0),
+        softwareOcclusionHeight(config.softwareOcclusionCulling ? config.softwareOcclusionHeight : 0) {
+        sharedData = std::make_unique<SceneSharedData>(
+            config.maxMeshInstances,
+            config.maxMeshSurfacePerPipeline,
+            config.drawCommandsCapacity,
+            config.bufferPoolFreeBudget);
         framesData.resize(ctx().config.framesInFlight);
         for (auto& data : framesData) {
-            data.scene =std::make_unique<SceneFrameData>(
+            data = std::make_unique<SceneFrameData>(
+                *sharedData,
                 config.maxLights,
-                config.maxMeshInstances,
-                config.maxMeshSurfacePerPipeline);
+                config.lightsCapacity);
         }
     }
 
     Scene::~Scene() {
+        for (const auto& occlusion : std::views::values(camerasOcclusion)) {
+            if (occlusion.job.valid()) {
+                occlusion.job.wait();
+            }
+        }
         ctx().graphicQueue->waitIdle();
     }
 
     void Scene::setEnvironment(const Environment& environment) {
         auto lock = std::lock_guard(frameDataMutex);
         for (const auto& data : framesData) {
-            data.scene->setEnvironment(environment);
+            data->setEnvironment(environment);
         }
     }
 
@@ -45,99 +59,326 @@ namespace lysa {
     void Scene::addLight(const Light& light) {
         auto lock = std::lock_guard(frameDataMutex);
         for (const auto& frame : framesData) {
-            frame.scene->addLight(&light);
+            frame->addLight(&light);
         }
     }
 
     void Scene::removeLight(const Light& light) {
         auto lock = std::lock_guard(frameDataMutex);
         for (const auto& frame : framesData) {
-            frame.scene->addLight(&light);
+            frame->removeLight(&light);
         }
     }
 
     void Scene::addInstance(const MeshInstance& meshInstance, const bool async) {
         const auto* pMeshInstance = &meshInstance;
         assert([&]{return !meshInstances.contains(pMeshInstance);}, "MeshInstance already in scene");
-        meshInstances.insert(pMeshInstance);
+        meshInstances[pMeshInstance] = instancesTree.insert(meshInstance.getAABB(), pMeshInstance);
+        meshesInstancesCount[meshInstance.getMesh().id] += 1;
         auto lock = std::lock_guard(frameDataMutex);
-        for (auto& frame : framesData) {
-            if (async) {
-                frame.addedNodesAsync.insert(pMeshInstance);
-            } else {
-                frame.addedNodes.insert(pMeshInstance);
-            }
+        if (async) {
+            addedNodesAsync.try_emplace(pMeshInstance, std::chrono::steady_clock::now());
+        } else {
+            addedNodes.insert(pMeshInstance);
         }
     }
 
     void Scene::updateInstance(const MeshInstance& meshInstance) {
         const auto* pMeshInstance = &meshInstance;
         assert([&]{return meshInstances.contains(pMeshInstance);}, "MeshInstance not in scene");
+        instancesTree.update(meshInstances[pMeshInstance], meshInstance.getAABB());
         updatedNodes.insert(pMeshInstance);
     }
 
     void Scene::removeInstance(const MeshInstance& meshInstance, const bool async) {
         const auto* pMeshInstance = &meshInstance;
         assert([&]{return meshInstances.contains(pMeshInstance);}, "MeshInstance not in scene");
+        instancesTree.remove(meshInstances[pMeshInstance]);
         meshInstances.erase(pMeshInstance);
+        for (auto& occlusion : std::views::values(camerasOcclusion)) {
+            occlusion.occludedInstances.erase(pMeshInstance);
+        }
+        const auto meshId = meshInstance.getMesh().id;
+        if (--meshesInstancesCount[meshId] == 0) {
+            meshesInstancesCount.erase(meshId);
+            occluderMeshes.erase(meshId);
+        }
         auto lock = std::lock_guard(frameDataMutex);
-        for (auto& frame : framesData) {
-            if (async) {
-                frame.removedNodesAsync.insert(pMeshInstance);
-            } else {
-                frame.removedNodes.insert(pMeshInstance);
-            }
+        // Not yet added to the shared data, cancels the addition
+        if (addedNodes.erase(pMeshInstance) > 0 || addedNodesAsync.erase(pMeshInstance) > 0) {
+            return;
+        }
+        if (async) {
+            removedNodesAsync.try_emplace(pMeshInstance, std::chrono::steady_clock::now());
+        } else {
+            removedNodes.insert(pMeshInstance);
         }
     }
 
-    void Scene::processDeferredOperations(const uint32 frameIndex) {
+    void Scene::processDeferredOperations() {
+        if (instancesTree.isRebuildNeeded()) {
+            instancesTree.rebuild();
+        }
         auto lock = std::lock_guard(frameDataMutex);
-        auto &data = framesData[frameIndex];
         // Remove from the renderer the nodes previously removed from the scene tree
         // Immediate removes
-        if (!data.removedNodes.empty()) {
-            for (const auto *mi : data.removedNodes) {
-                data.scene->removeInstance(mi);
-                updatedNodes.erase(mi);
-            }
-            data.removedNodes.clear();
-        }
-        // Async removes
-        if (!data.removedNodesAsync.empty()) {
-            auto count = 0;
-            for (auto it = data.removedNodesAsync.begin(); it != data.removedNodesAsync.end();) {
-                const auto* mi = *it;
-                data.scene->removeInstance(mi);
+        if (!removedNodes.empty()) {
+            for (const auto *mi : removedNodes) {
+                sharedData->removeInstance(mi);
                 updatedNodes.erase(mi);
-                it = data.removedNodesAsync.erase(it);
-                count += 1;
-                if (count > maxAsyncNodesUpdatedPerFrame) { break; }
             }
+            removedNodes.clear();
         }
+        // Async removes then additions, in the time budget of the frame
+        auto elapsed = 0.0f;
+        asyncUpdatesBudget.begin();
+        auto queueLength = processAsyncOperations(
+            removedNodesAsync,
+            AsyncUpdatesBudget::Operation::REMOVE,
+            elapsed,
+            [&](const MeshInstance* mi) {
+                sharedData->removeInstance(mi);
+                updatedNodes.erase(mi);
+            });
         // Add to the scene the nodes previously added to the scene tree
         // Immediate additions
-        if (!data.addedNodes.empty()) {
-            for (const auto* mi : data.addedNodes) {
-                data.scene->addInstance(mi);
+        if (!addedNodes.empty()) {
+            for (const auto* mi : addedNodes) {
+                sharedData->addInstance(mi);
                 updatedNodes.erase(mi);
             }
-            data.addedNodes.clear();
-        }
-        // Async additions
-        if (!data.addedNodesAsync.empty()) {
-            auto count = 0;
-            for (auto it = data.addedNodesAsync.begin(); it != data.addedNodesAsync.end();) {
-                const auto* mi = *it;
-                data.scene->addInstance(mi);
+            addedNodes.clear();
+        }
+        // Async additions, in the remaining time budget
+        queueLength += processAsyncOperations(
+            addedNodesAsync,
+            AsyncUpdatesBudget::Operation::ADD,
+            elapsed,
+            [&](const MeshInstance* mi) {
+                sharedData->addInstance(mi);
                 updatedNodes.erase(mi);
-                it = data.addedNodesAsync.erase(it);
-                count += 1;
-                if (count > maxAsyncNodesUpdatedPerFrame) { break; }
+            });
+        asyncUpdatesBudget.end(elapsed, queueLength);
+        // Nodes still queued for an asynchronous addition are added later with their current data
+        for (auto it = updatedNodes.begin(); it != updatedNodes.end();) {
+            const auto* mi = *it;
+            if (sharedData->haveInstance(mi)) {
+                sharedData->updateInstance(mi);
+                it = updatedNodes.erase(it);
+            } else {
+                ++it;
             }
         }
-        for (const auto* mi : updatedNodes) {
-            data.scene->updateInstance(mi);
+    }
+
+    uint32 Scene::processAsyncOperations(
+        std::unordered_map<const MeshInstance*, std::chrono::steady_clock::time_point>& queue,
+        const AsyncUpdatesBudget::Operation operation,
+        float& elapsed,
+        const std::function<void(const MeshInstance*)>& process) {
+        if (queue.empty()) { return 0; }
+        const auto now = std::chrono::steady_clock::now();
+        // The cost of an operation follows the number of mesh surfaces to (un)register in the pipelines
+        auto meshInstances = std::vector<const MeshInstance*>{};
+        auto pending = std::vector<AsyncUpdatesBudget::Pending>{};
+        meshInstances.reserve(queue.size());
+        pending.reserve(queue.size());
+        for (const auto& [mi, queued] : queue) {
+            pending.push_back({
+                .index = static_cast<uint32>(meshInstances.size()),
+                .priority = asyncUpdatesPriority ? asyncUpdatesPriority(*mi) : 0.0f,
+                .waiting = std::chrono::duration<float, std::milli>(now - queued).count(),
+                .cost = 1 + static_cast<uint32>(mi->getMesh().getSurfaces().size()),
+            });
+            meshInstances.push_back(mi);
+        }
+        return asyncUpdatesBudget.processQueue(
+            pending,
+            operation,
+            elapsed,
+            [&](const uint32 index) {
+                process(meshInstances[index]);
+                queue.erase(meshInstances[index]);
+            },
+            [&] {
+                return std::chrono::duration<float, std::micro>(std::chrono::steady_clock::now() - now).count();
+            });
+    }
+
+    void Scene::setAsyncUpdatesPriority(const std::function<float(const MeshInstance&)>& priority) {
+        auto lock = std::lock_guard(frameDataMutex);
+        asyncUpdatesPriority = priority;
+    }
+
+    AsyncUpdatesBudget::Statistics Scene::getAsyncUpdatesStatistics() const {
+        return asyncUpdatesBudget.getStatistics();
+    }
+
+    void Scene::cullOccludedInstances(const Camera& camera) {
+        if (softwareOcclusionWidth == 0) { return; }
+        auto& occlusion = camerasOcclusion[&camera];
+        if (!occlusion.rasterizer) {
+            occlusion.rasterizer = std::make_unique<OcclusionRasterizer>(softwareOcclusionWidth, softwareOcclusionHeight);
+        }
+        if (occlusion.job.valid()) {
+            applyOcclusionResults(occlusion, occlusion.job.get());
         }
+
+        // Copies everything needed by the job, the scene can change while it runs
+        auto occluders = std::vector<OcclusionItem>{};
+        auto occludees = std::vector<OcclusionItem>{};
+        for (const auto* meshInstance : queryFrustum(camera)) {
+            if (!meshInstance->isVisible()) { continue; }
+            if (!meshInstance->isOccluder()) {
+                occludees.push_back({ meshInstance, nullptr, {}, meshInstance->getAABB() });
+                continue;
+            }
+            const auto& mesh = meshInstance->getMesh();
+            auto& occluderMesh = occluderMeshes[mesh.id];
+            // Copied again after each upload of the mesh, the previous copy stays alive for the
+            // jobs still reading it
+            if (!occluderMesh || occluderMesh->revision != mesh.getRevision()) {
+                auto geometry = std::make_shared<OccluderMesh>();
+                geometry->revision = mesh.getRevision();
+                geometry->positions.resize(mesh.getVertices().size());
+                for (auto i = 0; i < mesh.getVertices().size(); i++) {
+                    geometry->positions[i] = mesh.getVertices()[i].position;
+                }
+                geometry->indices = mesh.getIndices();
+                occluderMesh = std::move(geometry);
+            }
+            occluders.push_back({ meshInstance, occluderMesh, meshInstance->getTransform(), {} });
+        }
+        if (occluders.empty()) {
+            // Nothing can be hidden
+            occlusion.occludedInstances.clear();
+            return;
+        }
+
+        const auto viewProjection = mul(inverse(camera.transform), camera.projection);
+        occlusion.job = std::async(
+            std::launch::async,
+            [&rasterizer = *occlusion.rasterizer, viewProjection,
+             occluders = std::move(occluders), occludees = std::move(occludees)] {
+            rasterizer.begin(viewProjection);
+            for (const auto& occluder : occluders) {
+                rasterizer.renderOccluder(occluder.mesh->positions, occluder.mesh->indices, occluder.transform);
+            }
+            rasterizer.end();
+            auto result = std::vector<const MeshInstance*>{};
+            for (const auto& occludee : occludees) {
+                if (rasterizer.isOccluded(occludee.aabb)) {
+                    result.push_back(occludee.meshInstance);
+                }
+            }
+            return result;
+        });
+    }
+
+    void Scene::releaseOcclusion(const Camera& camera) {
+        const auto it = camerasOcclusion.find(&camera);
+        if (it == camerasOcclusion.end()) { return; }
+        if (it->second.job.valid()) {
+            it->second.job.wait();
+        }
+        camerasOcclusion.erase(it);
+    }
+
+    const std::unordered_set<const MeshInstance*>& Scene::getOccludedInstances(const Camera& camera) const {
+        static const auto none = std::unordered_set<const MeshInstance*>{};
+        const auto it = camerasOcclusion.find(&camera);
+        return it == camerasOcclusion.end() ? none : it->second.occludedInstances;
+    }
+
+    void Scene::applyOcclusionResults(CameraOcclusion& occlusion, const std::vector<const MeshInstance*>& results) const {
+        occlusion.occludedInstances.clear();
+        for (const auto* meshInstance : results) {
+            // The instance may have been removed while the job was running
+            if (meshInstances.contains(meshInstance)) {
+                occlusion.occludedInstances.insert(meshInstance);
+            }
+        }
+    }
+
+    std::vector<const MeshInstance*> Scene::queryAABB(const AABB& aabb) const {
+        auto result = std::vector<const MeshInstance*>{};
+        instancesTree.queryAABB(aabb, [&](const void* userData) {
+            const auto* meshInstance = static_cast<const MeshInstance*>(userData);
+            // The tree stores enlarged AABBs, filter with the exact ones
+            if (meshInstance->getAABB().intersects(aabb)) {
+                result.push_back(meshInstance);
+            }
+            return true;
+        });
+        return result;
+    }
+
+    std::vector<const MeshInstance*> Scene::querySphere(const float3& center, const float radius) const {
+        auto result = std::vector<const MeshInstance*>{};
+        instancesTree.querySphere(center, radius, [&](const void* userData) {
+            const auto* meshInstance = static_cast<const MeshInstance*>(userData);
+            if (BVH::distanceSquared(meshInstance->getAABB(), center) <= radius * radius) {
+                result.push_back(meshInstance);
+            }
+            return true;
+        });
+        return result;
+    }
+
+    std::vector<const MeshInstance*> Scene::queryFrustum(const Camera& camera) const {
+        Frustum::Plane planes[6];
+        Frustum::extractPlanes(planes, mul(inverse(camera.transform), camera.projection));
+        return queryFrustum(planes);
+    }
+
+    std::vector<const MeshInstance*> Scene::queryFrustum(const Frustum::Plane planes[6]) const {
+        auto result = std::vector<const MeshInstance*>{};
+        instancesTree.queryFrustum(planes, [&](const void* userData) {
+            result.push_back(static_cast<const MeshInstance*>(userData));
+            return true;
+        });
+        return result;
+    }
+
+    std::optional<RaycastHit> Scene::raycast(const Ray& ray, const float maxDistance) const {
+        const float3 invDirection = 1.0f / ray.direction;
+        auto result = std::optional<RaycastHit>{};
+        instancesTree.raycast(ray, maxDistance, [&](const void* userData, const float currentMax) {
+            const auto* meshInstance = static_cast<const MeshInstance*>(userData);
+            float distance;
+            if (!BVH::intersects(ray.origin, invDirection, meshInstance->getAABB(), currentMax, distance)) {
+                return currentMax;
+            }
+            if (const auto* meshBVH = meshInstance->getMesh().getBVH()) {
+                // Ray in the mesh local space. The direction is not normalized, so the hit
+                // distance along the local ray is also the world distance.
+                const auto invTransform = inverse(meshInstance->getTransform());
+                auto localRay = Ray{};
+                localRay.origin = mul(float4(ray.origin, 1.0f), invTransform).xyz;
+                localRay.direction = mul(float4(ray.direction, 0.0f), invTransform).xyz;
+                const auto hit = meshBVH->raycast(localRay, currentMax);
+                if (!hit) {
+                    return currentMax;
+                }
+                result = RaycastHit{
+                    .meshInstance = meshInstance,
+                    .distance = hit->distance,
+                    .position = ray.getPoint(hit->distance),
+                    .precise = true,
+                    .surfaceIndex = hit->surfaceIndex,
+                    .triangleIndex = hit->triangleIndex,
+                    .barycentrics = hit->barycentrics,
+                };
+                return hit->distance;
+            }
+            result = RaycastHit{
+                .meshInstance = meshInstance,
+                .distance = distance,
+                .position = ray.getPoint(distance),
+            };
+            return distance;
+        });
+        return result;
     }
 
 }
\ No newline at end of file
@@ -6,11 +6,19 @@
 */
 export module lysa.resources.scene;
 
+import lysa.aabb;
+import lysa.async_updates_budget;
+import lysa.buffer_capacity;
+import lysa.bvh;
 import lysa.context;
+import lysa.frustum;
 import lysa.math;
+import lysa.occlusion_rasterizer;
 import lysa.renderers.graphic_pipeline_data;
 import lysa.renderers.scene_frame_data;
+import lysa.renderers.scene_shared_data;
 import lysa.resources;
+import lysa.resources.camera;
 import lysa.resources.manager;
 import lysa.resources.environment;
 import lysa.resources.image;
@@ -26,14 +34,69 @@ export namespace lysa {
      * Configuration settings for a Scene.
      */
     struct SceneConfiguration {
-        /** Number of nodes updates per frame for asynchronous scene updates. */
-        uint32 asyncObjectUpdatesPerFrame{50};
-        /** Maximum number of lights per scene. */
-        size_t maxLights{10};
+        /**
+         * Time budget per frame for the asynchronous mesh instances additions and removals, in microseconds.
+         * At least one asynchronous operation is processed each frame.
+         */
+        float asyncUpdatesBudget{1000.0f};
+        /**
+         * Estimated time of one cost unit of an asynchronous operation before the first measures,
+         * in microseconds. The cost of an operation is one unit plus one unit per mesh surface.
+         */
+        float asyncUpdatesInitialUnitCost{10.0f};
+        /**
+         * Decrease of the priority of a queued asynchronous operation per second of waiting, so the
+         * operations with a high priority value are not starved, see Scene::setAsyncUpdatesPriority().
+         */
+        float asyncUpdatesAging{10.0f};
+        /** Maximum number of lights per scene. The lights are assigned to the clusters of the camera frustum, see LightClusters. */
+        size_t maxLights{4096};
+        /** Sizing of the lights buffers, they follow the number of lights of the scene up to maxLights. */
+        BufferCapacityConfiguration lightsCapacity{ .minimum = 16 };
         /** Maximum number of mesh instances per frame per scene. */
         size_t maxMeshInstances{10000};
         /** Maximum number of mesh surfaces instances per pipeline. */
         size_t maxMeshSurfacePerPipeline{100000};
+        /**
+         * Sizing of the draw commands buffers of the pipelines, they follow the number of mesh
+         * surfaces of each pipeline up to maxMeshSurfacePerPipeline.
+         */
+        BufferCapacityConfiguration drawCommandsCapacity{};
+        /** Maximum size in bytes of the unused draw commands buffers kept for reuse by the pipelines. */
+        size_t bufferPoolFreeBudget{16 * 1024 * 1024};
+        /** Enlargement of the mesh instances AABB in the scene BVH, allowing small moves without updating the tree. */
+        float instancesTreeMargin{0.1f};
+        /** Ratio of refitted mesh instances, relative to the number of instances, triggering a rebuild of the scene BVH. */
+        float instancesTreeRebuildRatio{0.25f};
+        /** Enables the CPU software occlusion culling of the mesh instances by the occluders (see MeshInstance::setOccluder()). */
+        bool softwareOcclusionCulling{false};
+        /** Width of the software occlusion culling depth buffer. */
+        uint32 softwareOcclusionWidth{256};
+        /** Height of the software occlusion culling depth buffer. */
+        uint32 softwareOcclusionHeight{128};
+    };
+
+    /**
+     * Result of a ray cast against the mesh instances of a scene.
+     */
+    struct RaycastHit {
+        /** Mesh instance hit by the ray. */
+        const MeshInstance* meshInstance{nullptr};
+        /** Distance from the ray origin to the hit point. */
+        float distance{0.0f};
+        /** World position of the hit point. */
+        float3 position{};
+        /**
+         * True if the hit has been computed against the triangles of the mesh (see Mesh::buildBVH()),
+         * false if computed against the world AABB of the mesh instance.
+         */
+        bool precise{false};
+        /** Index of the mesh surface hit, for precise hits only. */
+        uint32 surfaceIndex{0};
+        /** Index of the mesh triangle hit, for precise hits only. */
+        uint32 triangleIndex{0};
+        /** Barycentric coordinates of the hit point in the triangle, for precise hits only. */
+        float2 barycentrics{};
     };
 
     /**
@@ -41,7 +104,8 @@ export namespace lysa {
      *
      * The Scene class manages the high-level representation of a scene, including
      * its environment, lights, and mesh instances. It handles deferred operations
-     * for adding/removing instances across multiple frames.
+     * for adding/removing instances, applied once to the mesh instances data shared
+     * by the frames in flight (see SceneSharedData).
      */
     class Scene : public UniqueResource {
     public:
@@ -69,6 +133,8 @@ export namespace lysa {
 
         /**
          * Adds a mesh instance to the scene.
+         * The asynchronous additions are processed in the time budget of the frames,
+         * see SceneConfiguration::asyncUpdatesBudget and setAsyncUpdatesPriority().
          * @param meshInstance The mesh instance to add.
          * @param async Whether to add the instance asynchronously.
          */
@@ -82,11 +148,28 @@ export namespace lysa {
 
         /**
          * Removes a mesh instance from the scene.
+         * A pending addition of the instance is cancelled.
          * @param meshInstance The mesh instance to remove.
          * @param async Whether to remove the instance asynchronously.
          */
         void removeInstance(const MeshInstance& meshInstance, bool async = false);
 
+        /**
+         * Sets the order of the asynchronous operations : the queued operations with the lowest
+         * priority are processed first, for example with the distance to the camera.
+         * The priorities are evaluated each frame and decrease with the waiting time, see
+         * SceneConfiguration::asyncUpdatesAging. Without priority function the operations
+         * are processed in the queuing order.
+         * @param priority Priority function, or an empty function to process in the queuing order.
+         */
+        void setAsyncUpdatesPriority(const std::function<float(const MeshInstance&)>& priority);
+
+        /**
+         * Returns the statistics of the asynchronous operations : queue length and time spent
+         * in the last processed frame, estimated costs and latency distribution.
+         */
+        AsyncUpdatesBudget::Statistics getAsyncUpdatesStatistics() const;
+
         /**
          * Adds a light to the scene.
          * @param light The light to add.
@@ -100,17 +183,103 @@ export namespace lysa {
         void removeLight(const Light& light);
 
         /**
-         * Processes deferred scene operations for a specific frame.
-         * @param frameIndex The index of the frame to process.
+         * Processes deferred scene operations, once per frame before the update of the frame data,
+         * even if the scene is rendered by several views.
+         */
+        void processDeferredOperations();
+
+        /**
+         * Returns the mesh instances whose world AABB overlaps a box.
+         * @param aabb World space box.
+         */
+        std::vector<const MeshInstance*> queryAABB(const AABB& aabb) const;
+
+        /**
+         * Returns the mesh instances whose world AABB overlaps a sphere.
+         * @param center World space center of the sphere.
+         * @param radius Radius of the sphere.
+         */
+        std::vector<const MeshInstance*> querySphere(const float3& center, float radius) const;
+
+        /**
+         * Returns the mesh instances whose world AABB is inside or intersects the frustum of a camera.
+         * The test is conservative : instances slightly outside the frustum (by less than
+         * SceneConfiguration::instancesTreeMargin) can be returned.
+         * @param camera The camera.
+         */
+        std::vector<const MeshInstance*> queryFrustum(const Camera& camera) const;
+
+        /**
+         * Returns the mesh instances whose world AABB is inside or intersects a frustum.
+         * @param planes Frustum planes, see Frustum::extractPlanes().
+         */
+        std::vector<const MeshInstance*> queryFrustum(const Frustum::Plane planes[6]) const;
+
+        /**
+         * Casts a ray against the mesh instances. Instances whose mesh have a triangles BVH
+         * (see Mesh::buildBVH()) are tested against their triangles, the other ones
+         * against their world AABB.
+         * @param ray World space ray.
+         * @param maxDistance Maximum distance along the ray.
+         * @return The closest hit, if any.
+         */
+        std::optional<RaycastHit> raycast(const Ray& ray, float maxDistance = std::numeric_limits<float>::max()) const;
+
+        /**
+         * Runs the software occlusion culling of the mesh instances for a camera.
+         *
+         * The occluders are rasterized and the mesh instances inside the frustum tested by
+         * a background job running in parallel with the frame. The results of the job
+         * started by the previous call for the same camera are applied first, so the
+         * occlusion has one frame of latency. Each camera has its own results, read by the
+         * camera view of the GPU culling, see getOccludedInstances(). The geometry of the
+         * occluders is copied from their mesh and copied again after each MeshManager::upload()
+         * of the mesh.
+         * Does nothing if SceneConfiguration::softwareOcclusionCulling is disabled.
+         * @param camera The camera.
+         */
+        void cullOccludedInstances(const Camera& camera);
+
+        /**
+         * Forgets the software occlusion culling of a camera, waiting for its running job.
+         * Called when a view of the camera is removed from a render target.
+         * @param camera The camera.
+         */
+        void releaseOcclusion(const Camera& camera);
+
+        /**
+         * Returns true if a mesh instance is hidden by the occluders for a camera, as computed
+         * by the last completed software occlusion culling of the camera.
+         * @param meshInstance The mesh instance.
+         * @param camera The camera.
+         */
+        bool isOccluded(const MeshInstance& meshInstance, const Camera& camera) const {
+            return getOccludedInstances(camera).contains(&meshInstance);
+        }
+
+        /**
+         * Returns the mesh instances hidden by the occluders for a camera, as computed by
+         * the last completed software occlusion culling of the camera.
+         * @param camera The camera.
+         */
+        const std::unordered_set<const MeshInstance*>& getOccludedInstances(const Camera& camera) const;
+
+        /**
+         * Returns the bounding volume hierarchy of the mesh instances world AABB.
          */
-        void processDeferredOperations(uint32 frameIndex);
+        const BVH& getInstancesTree() const { return instancesTree; }
 
         /**
          * Gets the frame-specific data for a given frame index.
          * @param frameIndex The index of the frame.
          * @return A reference to the SceneFrameData for the frame.
          */
-        SceneFrameData& get(const uint32 frameIndex) const { return *framesData[frameIndex].scene; }
+        SceneFrameData& get(const uint32 frameIndex) const { return *framesData[frameIndex]; }
+
+        /**
+         * Returns the mesh instances data shared by the frames in flight.
+         */
+        const SceneSharedData& getSharedData() const { return *sharedData; }
 
     protected:
         /** Reference to the image manager. */
@@ -121,29 +290,73 @@ export namespace lysa {
         MeshManager& meshManager;
 
     private:
-        /* Per-frame state and deferred operations processed at frame boundaries.*/
-        struct FrameData {
-            /* Nodes to add on the next frame (synchronous path). */
-            std::unordered_set<const MeshInstance*> addedNodes;
-            /* Nodes to add on the next frame (async path). */
-            std::unordered_set<const MeshInstance*> addedNodesAsync;
-            /* Nodes to remove on the next frame (synchronous path). */
-            std::unordered_set<const MeshInstance*> removedNodes;
-            /* Nodes to remove on the next frame (async path). */
-            std::unordered_set<const MeshInstance*> removedNodesAsync;
-            /* Scene instance associated with this frame. */
-            std::unique_ptr<SceneFrameData> scene;
-        };
-        /* Maximum number of nodes to update asynchronously per frame. */
-        const uint32 maxAsyncNodesUpdatedPerFrame;
-        /* Vector of per-frame data. */
-        std::vector<FrameData> framesData;
+        /* Nodes to add on the next frame (synchronous path). */
+        std::unordered_set<const MeshInstance*> addedNodes;
+        /* Nodes to add in the next frames (async path), with their queuing time. */
+        std::unordered_map<const MeshInstance*, std::chrono::steady_clock::time_point> addedNodesAsync;
+        /* Nodes to remove on the next frame (synchronous path). */
+        std::unordered_set<const MeshInstance*> removedNodes;
+        /* Nodes to remove in the next frames (async path), with their queuing time. */
+        std::unordered_map<const MeshInstance*, std::chrono::steady_clock::time_point> removedNodesAsync;
+        /* Time budget and cost estimation of the asynchronous operations. */
+        AsyncUpdatesBudget asyncUpdatesBudget;
+        /* Order of the asynchronous operations, queuing order if empty. */
+        std::function<float(const MeshInstance&)> asyncUpdatesPriority;
+        /* Mesh instances data shared by the frames in flight, destroyed after the frames data. */
+        std::unique_ptr<SceneSharedData> sharedData;
+        /* Per-frame lights, shadow maps and culling data. */
+        std::vector<std::unique_ptr<SceneFrameData>> framesData;
         /* Mutex to guard access to frame data. */
         std::mutex frameDataMutex;
-        /* Set of all mesh instances currently in the scene. */
-        std::unordered_set<const MeshInstance*> meshInstances;
+        /* All mesh instances currently in the scene, with their proxy in the instances tree. */
+        std::unordered_map<const MeshInstance*, int32> meshInstances;
+        /* Bounding volume hierarchy of the mesh instances world AABB, used by the CPU queries. */
+        BVH instancesTree;
         /* Set of nodes that have been updated and need synchronization. */
         std::unordered_set<const MeshInstance*> updatedNodes;
+
+        /* Occluder mesh geometry, copied from the mesh for the occlusion job. */
+        struct OccluderMesh {
+            /* Mesh::getRevision() of the copied geometry. */
+            uint32 revision;
+            std::vector<float3> positions;
+            std::vector<uint32> indices;
+        };
+        /* Occluder or occludee copied at the start of an occlusion job. */
+        struct OcclusionItem {
+            const MeshInstance* meshInstance;
+            /* Shared with the job : the scene can replace or erase the geometry while the job runs. */
+            std::shared_ptr<const OccluderMesh> mesh;
+            float4x4 transform;
+            AABB aabb;
+        };
+        /* Software occlusion culling of a camera. */
+        struct CameraOcclusion {
+            /* Only used by the occlusion job. */
+            std::unique_ptr<OcclusionRasterizer> rasterizer;
+            /* Running occlusion job, returning the hidden mesh instances. */
+            std::future<std::vector<const MeshInstance*>> job;
+            /* Mesh instances hidden by the occluders. */
+            std::unordered_set<const MeshInstance*> occludedInstances;
+        };
+        /* Size of the software occlusion depth buffers, 0 if disabled. */
+        const uint32 softwareOcclusionWidth;
+        const uint32 softwareOcclusionHeight;
+        /* Software occlusion culling of each camera. */
+        std::unordered_map<const Camera*, CameraOcclusion> camerasOcclusion;
+        /* Occluders geometry, by mesh, erased when the last instance of the mesh leaves the scene. */
+        std::unordered_map<unique_id, std::shared_ptr<const OccluderMesh>> occluderMeshes;
+        /* Number of instances of each mesh in the scene. */
+        std::unordered_map<unique_id, uint32> meshesInstancesCount;
+
+        void applyOcclusionResults(CameraOcclusion& occlusion, const std::vector<const MeshInstance*>& results) const;
+
+        /* Processes the queued operations in order while they fit in the frame budget, adds the time spent to elapsed (in microseconds) and returns the number of remaining operations. */
+        uint32 processAsyncOperations(
+            std::unordered_map<const MeshInstance*, std::chrono::steady_clock::time_point>& queue,
+            AsyncUpdatesBudget::Operation operation,
+            float& elapsed,
+            const std::function<void(const MeshInstance*)>& process);
     };
 
 }
@@ -0,0 +1,103 @@
+/*
+ * Copyright (c) 2025-present Henri Michelon
+ *
+ * This software is released under the MIT License.
+ * https://opensource.org/licenses/MIT
+*/
+module lysa.async_updates_budget;
+
+namespace lysa {
+
+    AsyncUpdatesBudget::AsyncUpdatesBudget(const float budget, const float initialUnitCost, const float aging) :
+        budget(budget),
+        aging(aging),
+        unitCosts{initialUnitCost, initialUnitCost} {
+        latencies.reserve(LATENCY_SAMPLES);
+    }
+
+    void AsyncUpdatesBudget::begin() {
+        frameProcessed = 0;
+    }
+
+    bool AsyncUpdatesBudget::fits(const float elapsed, const Operation operation, const uint32 cost) const {
+        return frameProcessed == 0 || (elapsed + estimate(operation, cost)) <= budget;
+    }
+
+    void AsyncUpdatesBudget::processed(
+        const Operation operation,
+        const uint32 cost,
+        const float duration,
+        const float latency) {
+        auto& unitCost = unitCosts[static_cast<uint32>(operation)];
+        unitCost += SMOOTHING * (duration / static_cast<float>(std::max(cost, 1u)) - unitCost);
+        if (latencies.size() < LATENCY_SAMPLES) {
+            latencies.push_back(latency);
+        } else {
+            latencies[latenciesNext] = latency;
+            latenciesNext = (latenciesNext + 1) % LATENCY_SAMPLES;
+        }
+        frameProcessed += 1;
+    }
+
+    uint32 AsyncUpdatesBudget::processQueue(
+        std::vector<Pending>& pending,
+        const Operation operation,
+        float& elapsed,
+        const std::function<void(uint32)>& process,
+        const std::function<float()>& clock) {
+        if (pending.empty()) { return 0; }
+        const auto start = clock();
+        // Min-heap on the aged priority then the queuing time : only the processed operations are sorted
+        const auto after = [&](const Pending& a, const Pending& b) {
+            const auto priorityA = getAgedPriority(a);
+            const auto priorityB = getAgedPriority(b);
+            return priorityA != priorityB ? priorityA > priorityB : a.waiting < b.waiting;
+        };
+        std::ranges::make_heap(pending, after);
+        while (!pending.empty()) {
+            const auto next = pending.front();
+            const auto begin = clock();
+            if (!fits(elapsed + begin - start, operation, next.cost)) {
+                break;
+            }
+            process(next.index);
+            const auto end = clock();
+            processed(operation, next.cost, end - begin, next.waiting + (end - start) / 1000.0f);
+            std::ranges::pop_heap(pending, after);
+            pending.pop_back();
+        }
+        elapsed += clock() - start;
+        return static_cast<uint32>(pending.size());
+    }
+
+    void AsyncUpdatesBudget::end(const float elapsed, const uint32 queueLength) {
+        frameStatistics.queueLength = queueLength;
+        frameStatistics.processed = frameProcessed;
+        frameStatistics.elapsed = elapsed;
+    }
+
+    AsyncUpdatesBudget::Statistics AsyncUpdatesBudget::getStatistics() const {
+        auto statistics = frameStatistics;
+        statistics.addUnitCost = unitCosts[static_cast<uint32>(Operation::ADD)];
+        statistics.removeUnitCost = unitCosts[static_cast<uint32>(Operation::REMOVE)];
+        statistics.latencySamples = static_cast<uint32>(latencies.size());
+        if (latencies.empty()) { return statistics; }
+
+        auto sorted = latencies;
+        std::ranges::sort(sorted);
+        const auto percentile = [&](const float p) {
+            return sorted[static_cast<size_t>(p * static_cast<float>(sorted.size() - 1) + 0.5f)];
+        };
+        auto total = 0.0f;
+        for (const auto latency : sorted) {
+            total += latency;
+        }
+        statistics.latencyAverage = total / static_cast<float>(sorted.size());
+        statistics.latency50 = percentile(0.50f);
+        statistics.latency90 = percentile(0.90f);
+        statistics.latency99 = percentile(0.99f);
+        statistics.latencyMax = sorted.back();
+        return statistics;
+    }
+
+}
@@ -0,0 +1,172 @@
+/*
+ * Copyright (c) 2025-present Henri Michelon
+ *
+ * This software is released under the MIT License.
+ * https://opensource.org/licenses/MIT
+*/
+export module lysa.async_updates_budget;
+
+import lysa.math;
+
+export namespace lysa {
+
+    /**
+     * Time budget of the asynchronous updates processed each frame.
+     *
+     * Each operation has a cost in units (for example one unit plus one per mesh surface) and
+     * the time of one unit is estimated per kind of operation. After each operation the
+     * estimation moves toward the measured time with an exponential moving average, so the
+     * budget follows the real cost of the operations on the running hardware.
+     * An operation is processed while the time spent in the frame plus its estimated time fits
+     * in the budget. The first operation of a frame is always processed so the queue progresses
+     * even with a budget smaller than one operation.
+     *
+     * The queued operations are processed by order of priority, the lowest first, then by
+     * queuing time. The priority of an operation decreases by `aging` per second of waiting : a
+     * continuous flow of operations with a better priority delays the other ones but does not
+     * starve them.
+     *
+     * The times are given by the caller, the class does not read any clock.
+     */
+    class AsyncUpdatesBudget {
+    public:
+        /** Kind of operation, each kind has its own cost estimation. */
+        enum class Operation : uint32 {
+            ADD     = 0,
+            REMOVE  = 1,
+        };
+
+        /**
+         * Statistics of the last processed frame and latency distribution of the last operations.
+         */
+        struct Statistics {
+            /** Number of operations still queued at the end of the frame */
+            uint32 queueLength{0};
+            /** Number of operations processed in the frame */
+            uint32 processed{0};
+            /** Time spent in the frame, in microseconds */
+            float  elapsed{0.0f};
+            /** Estimated time of one cost unit of an addition, in microseconds */
+            float  addUnitCost{0.0f};
+            /** Estimated time of one cost unit of a removal, in microseconds */
+            float  removeUnitCost{0.0f};
+            /** Number of operations in the latency distribution */
+            uint32 latencySamples{0};
+            /** Average time between the queuing and the processing of an operation, in milliseconds */
+            float  latencyAverage{0.0f};
+            /** Median latency in milliseconds */
+            float  latency50{0.0f};
+            /** 90th percentile of the latency in milliseconds */
+            float  latency90{0.0f};
+            /** 99th percentile of the latency in milliseconds */
+            float  latency99{0.0f};
+            /** Maximum latency in milliseconds */
+            float  latencyMax{0.0f};
+        };
+
+        /**
+         * Operation waiting in a queue of the caller.
+         */
+        struct Pending {
+            /** Index of the operation in the queue of the caller */
+            uint32 index;
+            /** Priority of the operation, the lowest first */
+            float  priority;
+            /** Time since the queuing of the operation, in milliseconds */
+            float  waiting;
+            /** Cost of the operation in units */
+            uint32 cost;
+        };
+
+        /** Number of the last operations kept for the latency distribution. */
+        static constexpr uint32 LATENCY_SAMPLES{1024};
+
+        /**
+         * Creates a budget.
+         * @param budget Time budget per frame in microseconds
+         * @param initialUnitCost Estimated time of one cost unit before any measure, in microseconds
+         * @param aging Decrease of the priority of the queued operations per second of waiting
+         */
+        AsyncUpdatesBudget(float budget, float initialUnitCost, float aging);
+
+        /**
+         * Starts a frame, resets the frame counters.
+         */
+        void begin();
+
+        /**
+         * Returns true if an operation can be processed in the current frame.
+         * @param elapsed Time already spent in the frame, in microseconds
+         * @param operation Kind of operation
+         * @param cost Cost of the operation in units
+         */
+        bool fits(float elapsed, Operation operation, uint32 cost) const;
+
+        /**
+         * Records a processed operation and updates the estimated time of its kind.
+         * @param operation Kind of operation
+         * @param cost Cost of the operation in units
+         * @param duration Measured time of the operation, in microseconds
+         * @param latency Time between the queuing and the processing of the operation, in milliseconds
+         */
+        void processed(Operation operation, uint32 cost, float duration, float latency);
+
+        /**
+         * Processes the queued operations in order while they fit in the budget of the frame.
+         * @param pending Queued operations, the processed ones are removed
+         * @param operation Kind of the operations
+         * @param elapsed Time already spent in the frame in microseconds, the time spent is added
+         * @param process Processes the operation of the queue of the caller at the given index
+         * @param clock Returns the current time in microseconds
+         * @return Number of operations still queued
+         */
+        uint32 processQueue(
+            std::vector<Pending>& pending,
+            Operation operation,
+            float& elapsed,
+            const std::function<void(uint32)>& process,
+            const std::function<float()>& clock);
+
+        /**
+         * Returns the priority of a queued operation after the aging of its waiting time.
+         */
+        float getAgedPriority(const Pending& pending) const {
+            return pending.priority - aging * pending.waiting / 1000.0f;
+        }
+
+        /**
+         * Ends a frame.
+         * @param elapsed Time spent in the frame, in microseconds
+         * @param queueLength Number of operations still queued
+         */
+        void end(float elapsed, uint32 queueLength);
+
+        /**
+         * Returns the estimated time of an operation, in microseconds.
+         * @param operation Kind of operation
+         * @param cost Cost of the operation in units
+         */
+        float estimate(const Operation operation, const uint32 cost) const {
+            return unitCosts[static_cast<uint32>(operation)] * static_cast<float>(std::max(cost, 1u));
+        }
+
+        /** Returns the statistics, the latency percentiles are computed on each call. */
+        Statistics getStatistics() const;
+
+        /** Returns the time budget per frame in microseconds. */
+        auto getBudget() const { return budget; }
+
+    private:
+        // Weight of the last measure in the estimated unit costs
+        static constexpr float SMOOTHING{0.1f};
+
+        const float budget;
+        const float aging;
+        float unitCosts[2];
+        uint32 frameProcessed{0};
+        Statistics frameStatistics;
+        std::vector<float> latencies;
+        uint32 latenciesNext{0};
+    };
+
+}
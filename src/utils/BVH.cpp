@@ -0,0 +1,291 @@
+/*
+ * Copyright (c) 2025-present Henri Michelon
+ *
+ * This software is released under the MIT License.
+ * https://opensource.org/licenses/MIT
+*/
+module lysa.bvh;
+
+import lysa.exception;
+
+namespace lysa {
+
+    BVH::BVH(const float margin, const float rebuildRatio) :
+        margin{margin},
+        rebuildRatio{rebuildRatio} {
+    }
+
+    int32 BVH::insert(const AABB& aabb, const void* userData) {
+        const auto leaf = allocateNode();
+        auto& node = nodes[leaf];
+        node.aabb = AABB{aabb.min - margin, aabb.max + margin};
+        node.userData = userData;
+        node.height = 0;
+        insertLeaf(leaf);
+        leafCount += 1;
+        return leaf;
+    }
+
+    void BVH::remove(const int32 proxyId) {
+        assert([&]{ return proxyId >= 0 && proxyId < nodes.size() && nodes[proxyId].height == 0; }, "Invalid BVH proxy");
+        removeLeaf(proxyId);
+        freeNode(proxyId);
+        leafCount -= 1;
+    }
+
+    bool BVH::update(const int32 proxyId, const AABB& aabb) {
+        assert([&]{ return proxyId >= 0 && proxyId < nodes.size() && nodes[proxyId].height == 0; }, "Invalid BVH proxy");
+        auto& node = nodes[proxyId];
+        if (node.aabb.contains(aabb)) {
+            return false;
+        }
+        node.aabb = AABB{aabb.min - margin, aabb.max + margin};
+        refit(node.parent);
+        refitCount += 1;
+        return true;
+    }
+
+    void BVH::clear() {
+        nodes.clear();
+        root = NULL_NODE;
+        freeList = NULL_NODE;
+        leafCount = 0;
+        refitCount = 0;
+    }
+
+    float BVH::getCost() const {
+        if (root == NULL_NODE) { return 0.0f; }
+        auto area = 0.0f;
+        for (const auto& node : nodes) {
+            if (node.height > 0) {
+                area += node.aabb.getSurfaceArea();
+            }
+        }
+        const auto rootArea = nodes[root].aabb.getSurfaceArea();
+        return rootArea > 0.0f ? area / rootArea : 0.0f;
+    }
+
+    void BVH::rebuild() {
+        refitCount = 0;
+        if (root == NULL_NODE) { return; }
+        auto leaves = std::vector<int32>{};
+        leaves.reserve(leafCount);
+        for (auto i = 0; i < nodes.size(); i++) {
+            if (nodes[i].height == 0) {
+                leaves.push_back(i);
+            } else if (nodes[i].height > 0) {
+                freeNode(i);
+            }
+        }
+        root = build(leaves.data(), leaves.size(), 0);
+        nodes[root].parent = NULL_NODE;
+    }
+
+    int32 BVH::allocateNode() {
+        if (freeList == NULL_NODE) {
+            nodes.push_back({});
+            return static_cast<int32>(nodes.size() - 1);
+        }
+        const auto index = freeList;
+        freeList = nodes[index].parent;
+        nodes[index] = {};
+        return index;
+    }
+
+    void BVH::freeNode(const int32 index) {
+        auto& node = nodes[index];
+        node.parent = freeList;
+        node.child1 = NULL_NODE;
+        node.child2 = NULL_NODE;
+        node.userData = nullptr;
+        node.height = -1;
+        freeList = index;
+    }
+
+    void BVH::insertLeaf(const int32 leaf) {
+        if (root == NULL_NODE) {
+            root = leaf;
+            nodes[root].parent = NULL_NODE;
+            return;
+        }
+
+        // Find the best sibling for the new leaf by descending the tree,
+        // using the cost of the new parent plus the cost inherited by the ancestors
+        const auto leafAABB = nodes[leaf].aabb;
+        auto index = root;
+        while (!nodes[index].isLeaf()) {
+            const auto& node = nodes[index];
+            const auto area = node.aabb.getSurfaceArea();
+            const auto combinedArea = node.aabb.merge(leafAABB).getSurfaceArea();
+            // Cost of creating a new parent for this node and the new leaf
+            const auto cost = 2.0f * combinedArea;
+            // Minimum cost of pushing the leaf further down the tree
+            const auto inheritanceCost = 2.0f * (combinedArea - area);
+            const auto childCost = [&](const int32 childIndex) {
+                const auto& child = nodes[childIndex];
+                const auto mergedArea = leafAABB.merge(child.aabb).getSurfaceArea();
+                return (child.isLeaf() ? mergedArea : mergedArea - child.aabb.getSurfaceArea()) + inheritanceCost;
+            };
+            const auto cost1 = childCost(node.child1);
+            const auto cost2 = childCost(node.child2);
+            if (cost < cost1 && cost < cost2) {
+                break;
+            }
+            index = cost1 < cost2 ? node.child1 : node.child2;
+        }
+
+        // Create a new parent for the sibling and the new leaf
+        const auto sibling = index;
+        const auto oldParent = nodes[sibling].parent;
+        const auto newParent = allocateNode();
+        nodes[newParent].parent = oldParent;
+        nodes[newParent].aabb = leafAABB.merge(nodes[sibling].aabb);
+        nodes[newParent].height = nodes[sibling].height + 1;
+        nodes[newParent].child1 = sibling;
+        nodes[newParent].child2 = leaf;
+        nodes[sibling].parent = newParent;
+        nodes[leaf].parent = newParent;
+        if (oldParent == NULL_NODE) {
+            root = newParent;
+        } else if (nodes[oldParent].child1 == sibling) {
+            nodes[oldParent].child1 = newParent;
+        } else {
+            nodes[oldParent].child2 = newParent;
+        }
+        refit(oldParent);
+    }
+
+    void BVH::removeLeaf(const int32 leaf) {
+        if (leaf == root) {
+            root = NULL_NODE;
+            return;
+        }
+        const auto parent = nodes[leaf].parent;
+        const auto grandParent = nodes[parent].parent;
+        const auto sibling = nodes[parent].child1 == leaf ? nodes[parent].child2 : nodes[parent].child1;
+        if (grandParent == NULL_NODE) {
+            root = sibling;
+            nodes[sibling].parent = NULL_NODE;
+            freeNode(parent);
+            return;
+        }
+        // Replace the parent by the sibling in the grand parent
+        if (nodes[grandParent].child1 == parent) {
+            nodes[grandParent].child1 = sibling;
+        } else {
+            nodes[grandParent].child2 = sibling;
+        }
+        nodes[sibling].parent = grandParent;
+        freeNode(parent);
+        refit(grandParent);
+    }
+
+    void BVH::refit(int32 index) {
+        while (index != NULL_NODE) {
+            auto& node = nodes[index];
+            const auto& child1 = nodes[node.child1];
+            const auto& child2 = nodes[node.child2];
+            node.aabb = child1.aabb.merge(child2.aabb);
+            node.height = 1 + std::max(child1.height, child2.height);
+            index = node.parent;
+        }
+    }
+
+    int32 BVH::build(int32* leaves, const size_t count, const int depth) {
+        if (count == 1) {
+            return leaves[0];
+        }
+
+        // Bounds of the leaves centers, used to distribute the leaves in the bins
+        auto centersBounds = AABB{nodes[leaves[0]].aabb.getCenter(), nodes[leaves[0]].aabb.getCenter()};
+        for (auto i = 1; i < count; i++) {
+            const auto center = nodes[leaves[i]].aabb.getCenter();
+            centersBounds = AABB{lysa::min(centersBounds.min, center), lysa::max(centersBounds.max, center)};
+        }
+        const float3 extent = centersBounds.max - centersBounds.min;
+
+        auto bestAxis = -1;
+        auto bestSplit = 0;
+        auto bestCost = std::numeric_limits<float>::max();
+        if (depth < MAX_BUILD_DEPTH) {
+            for (auto axis = 0; axis < 3; axis++) {
+                if (extent.f32[axis] <= 0.0f) { continue; }
+                const auto scale = BINS_COUNT / extent.f32[axis];
+                struct Bin {
+                    AABB aabb;
+                    uint32 count{0};
+                } bins[BINS_COUNT];
+                for (auto i = 0; i < count; i++) {
+                    const auto& aabb = nodes[leaves[i]].aabb;
+                    const auto bin = std::min(
+                        BINS_COUNT - 1,
+                        static_cast<int>((aabb.getCenter().f32[axis] - centersBounds.min.f32[axis]) * scale));
+                    bins[bin].aabb = bins[bin].count == 0 ? aabb : bins[bin].aabb.merge(aabb);
+                    bins[bin].count += 1;
+                }
+                // Sweep from the right to get the cost of the right side of each split plane
+                float rightCosts[BINS_COUNT];
+                auto rightAABB = AABB{};
+                auto rightCount = 0u;
+                for (auto i = BINS_COUNT - 1; i > 0; i--) {
+                    if (bins[i].count > 0) {
+                        rightAABB = rightCount == 0 ? bins[i].aabb : rightAABB.merge(bins[i].aabb);
+                        rightCount += bins[i].count;
+                    }
+                    rightCosts[i] = rightCount == 0 ? 0.0f : rightAABB.getSurfaceArea() * rightCount;
+                }
+                // Sweep from the left and evaluate each split plane
+                auto leftAABB = AABB{};
+                auto leftCount = 0u;
+                for (auto i = 0; i < BINS_COUNT - 1; i++) {
+                    if (bins[i].count > 0) {
+                        leftAABB = leftCount == 0 ? bins[i].aabb : leftAABB.merge(bins[i].aabb);
+                        leftCount += bins[i].count;
+                    }
+                    if (leftCount == 0 || leftCount == count) { continue; }
+                    const auto cost = leftAABB.getSurfaceArea() * leftCount + rightCosts[i + 1];
+                    if (cost < bestCost) {
+                        bestCost = cost;
+                        bestAxis = axis;
+                        bestSplit = i + 1;
+                    }
+                }
+            }
+        }
+
+        auto middle = count / 2;
+        if (bestAxis != -1) {
+            const auto scale = BINS_COUNT / extent.f32[bestAxis];
+            const auto minimum = centersBounds.min.f32[bestAxis];
+            const auto* pivot = std::partition(leaves, leaves + count, [&](const int32 leaf) {
+                const auto bin = std::min(
+                    BINS_COUNT - 1,
+                    static_cast<int>((nodes[leaf].aabb.getCenter().f32[bestAxis] - minimum) * scale));
+                return bin < bestSplit;
+            });
+            middle = pivot - leaves;
+        } else {
+            // All the centers are at the same place or the tree is too deep : median split
+            // on the largest axis
+            const auto axis = extent.f32[0] > extent.f32[1] ?
+                (extent.f32[0] > extent.f32[2] ? 0 : 2) :
+                (extent.f32[1] > extent.f32[2] ? 1 : 2);
+            std::nth_element(leaves, leaves + middle, leaves + count, [&](const int32 a, const int32 b) {
+                return nodes[a].aabb.getCenter().f32[axis] < nodes[b].aabb.getCenter().f32[axis];
+            });
+        }
+
+        const auto child1 = build(leaves, middle, depth + 1);
+        const auto child2 = build(leaves + middle, count - middle, depth + 1);
+        const auto index = allocateNode();
+        auto& node = nodes[index];
+        node.child1 = child1;
+        node.child2 = child2;
+        node.aabb = nodes[child1].aabb.merge(nodes[child2].aabb);
+        node.height = 1 + std::max(nodes[child1].height, nodes[child2].height);
+        nodes[child1].parent = index;
+        nodes[child2].parent = index;
+        return index;
+    }
+
+}
@@ -0,0 +1,408 @@
+/*
+ * Copyright (c) 2025-present Henri Michelon
+ *
+ * This software is released under the MIT License.
+ * https://opensource.org/licenses/MIT
+*/
+export module lysa.bvh;
+
+import lysa.aabb;
+import lysa.frustum;
+import lysa.math;
+
+export namespace lysa {
+
+    /**
+     * Half-line used by the ray casting queries.
+     */
+    struct Ray {
+        /** Origin of the ray. */
+        float3 origin{};
+        /** Unit direction of the ray. */
+        float3 direction{AXIS_FRONT};
+
+        Ray() = default;
+
+        /**
+         * Constructs a ray, the direction does not need to be normalized.
+         * @param origin Origin of the ray
+         * @param direction Direction of the ray
+         */
+        Ray(const float3& origin, const float3& direction) : origin{origin}, direction{normalize(direction)} {}
+
+        /**
+         * Returns the point at a given distance along the ray.
+         * @param distance Distance from the origin
+         */
+        float3 getPoint(const float distance) const { return origin + direction * distance; }
+    };
+
+    /**
+     * Dynamic bounding volume hierarchy of axis-aligned bounding boxes.
+     *
+     * Each object is stored in a leaf (a "proxy") holding an enlarged ("fat") copy of
+     * its AABB and an opaque user pointer. The tree supports :
+     *  - incremental insertions, using the surface area heuristic to select the sibling
+     *    of the new leaf,
+     *  - incremental updates : an object moving inside its fat AABB costs nothing, an
+     *    object leaving it only refits the leaf and its ancestors without changing the
+     *    topology of the tree,
+     *  - full rebuilds using a top-down binned SAH build, used to restore the quality of
+     *    the tree after many refits (see isRebuildNeeded()),
+     *  - frustum, ray, sphere and AABB queries.
+     *
+     * Proxy identifiers are stable for the whole life of the object, including across rebuilds.
+     * The tree is not thread-safe : concurrent queries are allowed, but not while modifying it.
+     */
+    class BVH {
+    public:
+        /** Invalid node or proxy identifier. */
+        static constexpr int32 NULL_NODE{-1};
+
+        /**
+         * Creates an empty tree.
+         * @param margin Enlargement of the objects AABB stored in the leaves, allowing small
+         * moves without updating the tree.
+         * @param rebuildRatio Ratio of refitted leaves, relative to the number of leaves,
+         * after which isRebuildNeeded() returns true.
+         */
+        BVH(float margin = 0.1f, float rebuildRatio = 0.25f);
+
+        /**
+         * Inserts an object in the tree.
+         * @param aabb World AABB of the object
+         * @param userData Opaque pointer given back by the queries
+         * @return The proxy identifier of the object
+         */
+        int32 insert(const AABB& aabb, const void* userData);
+
+        /**
+         * Removes an object from the tree.
+         * @param proxyId Proxy identifier returned by insert()
+         */
+        void remove(int32 proxyId);
+
+        /**
+         * Updates the AABB of an object.
+         * @param proxyId Proxy identifier returned by insert()
+         * @param aabb New world AABB of the object
+         * @return true if the tree has been modified, false if the object is still inside its fat AABB
+         */
+        bool update(int32 proxyId, const AABB& aabb);
+
+        /**
+         * Rebuilds the whole tree using a binned SAH top-down build.
+         * Proxy identifiers stay valid.
+         */
+        void rebuild();
+
+        /**
+         * Returns true when enough leaves have been refitted since the last rebuild
+         * to make a rebuild worthwhile.
+         */
+        bool isRebuildNeeded() const {
+            return refitCount > MIN_REFITS_BEFORE_REBUILD && refitCount > rebuildRatio * leafCount;
+        }
+
+        /**
+         * Removes all the objects from the tree.
+         */
+        void clear();
+
+        /**
+         * Returns the user pointer associated with an object.
+         * @param proxyId Proxy identifier returned by insert()
+         */
+        const void* getUserData(const int32 proxyId) const { return nodes[proxyId].userData; }
+
+        /**
+         * Returns the enlarged AABB stored for an object.
+         * @param proxyId Proxy identifier returned by insert()
+         */
+        const AABB& getFatAABB(const int32 proxyId) const { return nodes[proxyId].aabb; }
+
+        /**
+         * Returns the number of objects in the tree.
+         */
+        uint32 getProxyCount() const { return leafCount; }
+
+        /**
+         * Returns the height of the tree, 0 for a tree with a single object, -1 for an empty tree.
+         */
+        int32 getHeight() const { return root == NULL_NODE ? -1 : nodes[root].height; }
+
+        /**
+         * Returns the number of leaves refitted since the last rebuild.
+         */
+        uint32 getRefitCount() const { return refitCount; }
+
+        /**
+         * Returns the SAH cost of the tree : the sum of the surface area of the internal
+         * nodes divided by the surface area of the root. Lower is better.
+         */
+        float getCost() const;
+
+        /**
+         * Calls the visitor for each object whose fat AABB overlaps the given box.
+         * @param aabb Box to test
+         * @param visitor Callable `bool(const void* userData)`, returns false to stop the query
+         */
+        template<typename Visitor>
+        void queryAABB(const AABB& aabb, Visitor&& visitor) const {
+            if (root == NULL_NODE) { return; }
+            TraversalStack<int32> stack;
+            stack.push(root);
+            while (!stack.empty()) {
+                const auto& node = nodes[stack.pop()];
+                if (!node.aabb.intersects(aabb)) { continue; }
+                if (node.isLeaf()) {
+                    if (!visitor(node.userData)) { return; }
+                } else {
+                    stack.push(node.child1);
+                    stack.push(node.child2);
+                }
+            }
+        }
+
+        /**
+         * Calls the visitor for each object whose fat AABB overlaps the given sphere.
+         * @param center Center of the sphere
+         * @param radius Radius of the sphere
+         * @param visitor Callable `bool(const void* userData)`, returns false to stop the query
+         */
+        template<typename Visitor>
+        void querySphere(const float3& center, const float radius, Visitor&& visitor) const {
+            if (root == NULL_NODE) { return; }
+            const auto radiusSquared = radius * radius;
+            TraversalStack<int32> stack;
+            stack.push(root);
+            while (!stack.empty()) {
+                const auto& node = nodes[stack.pop()];
+                if (distanceSquared(node.aabb, center) > radiusSquared) { continue; }
+                if (node.isLeaf()) {
+                    if (!visitor(node.userData)) { return; }
+                } else {
+                    stack.push(node.child1);
+                    stack.push(node.child2);
+                }
+            }
+        }
+
+        /**
+         * Calls the visitor for each object whose fat AABB is inside or intersects the frustum.
+         * Subtrees fully inside a plane are not tested again against this plane.
+         * @param planes Frustum planes, see Frustum::extractPlanes()
+         * @param visitor Callable `bool(const void* userData)`, returns false to stop the query
+         */
+        template<typename Visitor>
+        void queryFrustum(const Frustum::Plane planes[6], Visitor&& visitor) const {
+            if (root == NULL_NODE) { return; }
+            TraversalStack<std::pair<int32, uint32>> stack;
+            stack.push({root, ALL_PLANES});
+            while (!stack.empty()) {
+                auto [index, mask] = stack.pop();
+                const auto& node = nodes[index];
+                if (mask != 0 && !classify(node.aabb, planes, mask)) { continue; }
+                if (node.isLeaf()) {
+                    if (!visitor(node.userData)) { return; }
+                } else {
+                    stack.push({node.child1, mask});
+                    stack.push({node.child2, mask});
+                }
+            }
+        }
+
+        /**
+         * Casts a ray in the tree, visiting the objects front to back.
+         *
+         * The visitor is called for each object whose fat AABB is hit before the current
+         * maximum distance. It returns the distance of the hit with the object, or any
+         * value greater or equal than the current maximum distance if the object is not hit.
+         * Returning a smaller distance clips the ray, allowing closest-hit queries.
+         * @param ray Ray to cast
+         * @param maxDistance Maximum distance along the ray
+         * @param visitor Callable `float(const void* userData, float maxDistance)`
+         */
+        template<typename Visitor>
+        void raycast(const Ray& ray, const float maxDistance, Visitor&& visitor) const {
+            if (root == NULL_NODE) { return; }
+            const float3 invDirection = 1.0f / ray.direction;
+            auto currentMax = maxDistance;
+            float distance;
+            if (!intersects(ray.origin, invDirection, nodes[root].aabb, currentMax, distance)) { return; }
+            TraversalStack<std::pair<int32, float>> stack;
+            stack.push({root, distance});
+            while (!stack.empty()) {
+                const auto [index, entry] = stack.pop();
+                // The ray may have been clipped since this node was pushed
+                if (entry > currentMax) { continue; }
+                const auto& node = nodes[index];
+                if (node.isLeaf()) {
+                    currentMax = std::min(currentMax, visitor(node.userData, currentMax));
+                    continue;
+                }
+                float distance1, distance2;
+                const auto hit1 = intersects(ray.origin, invDirection, nodes[node.child1].aabb, currentMax, distance1);
+                const auto hit2 = intersects(ray.origin, invDirection, nodes[node.child2].aabb, currentMax, distance2);
+                // Push the farthest first to visit the nearest first
+                if (hit1 && hit2) {
+                    if (distance1 < distance2) {
+                        stack.push({node.child2, distance2});
+                        stack.push({node.child1, distance1});
+                    } else {
+                        stack.push({node.child1, distance1});
+                        stack.push({node.child2, distance2});
+                    }
+                } else if (hit1) {
+                    stack.push({node.child1, distance1});
+                } else if (hit2) {
+                    stack.push({node.child2, distance2});
+                }
+            }
+        }
+
+        /**
+         * Ray/box slab test.
+         * @param origin Origin of the ray
+         * @param invDirection Component-wise inverse of the ray direction, infinite for the
+         * null components of the direction
+         * @param aabb Box to test
+         * @param maxDistance Maximum distance along the ray
+         * @param distance Entry distance in the box, 0 if the origin is inside the box
+         * @return true if the box is hit before maxDistance
+         */
+        static bool intersects(
+            const float3& origin,
+            const float3& invDirection,
+            const AABB& aabb,
+            const float maxDistance,
+            float& distance) {
+            distance = 0.0f;
+            auto exit = maxDistance;
+            for (auto axis = 0; axis < 3; axis++) {
+                const auto min = aabb.min.f32[axis] - origin.f32[axis];
+                const auto max = aabb.max.f32[axis] - origin.f32[axis];
+                if (std::isinf(invDirection.f32[axis])) {
+                    // Ray parallel to the slab : 0 * inf is NaN for an origin on a slab plane,
+                    // the ray is inside the slab for its whole length or never
+                    if (min > 0.0f || max < 0.0f) { return false; }
+                    continue;
+                }
+                const auto t1 = min * invDirection.f32[axis];
+                const auto t2 = max * invDirection.f32[axis];
+                distance = std::max(distance, std::min(t1, t2));
+                exit = std::min(exit, std::max(t1, t2));
+            }
+            return distance <= exit;
+        }
+
+        /**
+         * Returns the squared distance between a point and a box, 0 if the point is inside the box.
+         * @param aabb Box to test
+         * @param point Point to test
+         */
+        static float distanceSquared(const AABB& aabb, const float3& point) {
+            const float3 d = point - clamp(point, aabb.min, aabb.max);
+            return dot(d, d);
+        }
+
+    private:
+        /* Number of bins per axis used by the SAH build. */
+        static constexpr int BINS_COUNT{16};
+        /* Maximum depth of the SAH build before falling back to median splits. */
+        static constexpr int MAX_BUILD_DEPTH{64};
+        /* Minimum number of refits before requesting a rebuild, avoiding rebuilds of small trees. */
+        static constexpr uint32 MIN_REFITS_BEFORE_REBUILD{32};
+        /* Frustum planes mask with all the planes to test. */
+        static constexpr uint32 ALL_PLANES{0b111111};
+
+        /* Tree node, a leaf when child1 is NULL_NODE. */
+        struct Node {
+            /* Enlarged object AABB for a leaf, union of the children for an internal node. */
+            AABB aabb;
+            /* User pointer of a leaf. */
+            const void* userData{nullptr};
+            /* Parent node, or next free node when in the free list. */
+            int32 parent{NULL_NODE};
+            int32 child1{NULL_NODE};
+            int32 child2{NULL_NODE};
+            /* 0 for a leaf, -1 for a free node. */
+            int32 height{-1};
+
+            bool isLeaf() const { return child1 == NULL_NODE; }
+        };
+
+        /* Small-buffer stack used by the traversals to avoid heap allocations for balanced trees. */
+        template<typename T>
+        struct TraversalStack {
+            static constexpr size_t CAPACITY{64};
+            std::array<T, CAPACITY> fixed;
+            std::vector<T> overflow;
+            size_t size{0};
+
+            void push(const T& value) {
+                if (size < CAPACITY) {
+                    fixed[size] = value;
+                } else {
+                    overflow.push_back(value);
+                }
+                size += 1;
+            }
+
+            T pop() {
+                size -= 1;
+                if (size < CAPACITY) { return fixed[size]; }
+                const auto value = overflow.back();
+                overflow.pop_back();
+                return value;
+            }
+
+            bool empty() const { return size == 0; }
+        };
+
+        std::vector<Node> nodes;
+        int32 root{NULL_NODE};
+        int32 freeList{NULL_NODE};
+        uint32 leafCount{0};
+        uint32 refitCount{0};
+        const float margin;
+        const float rebuildRatio;
+
+        int32 allocateNode();
+
+        void freeNode(int32 index);
+
+        void insertLeaf(int32 leaf);
+
+        void removeLeaf(int32 leaf);
+
+        void refit(int32 index);
+
+        int32 build(int32* leaves, size_t count, int depth);
+
+        /*
+         * Tests a box against the frustum planes not yet known to fully contain it.
+         * Returns false if the box is outside, and removes from the mask the planes
+         * fully containing the box.
+         */
+        static bool classify(const AABB& aabb, const Frustum::Plane planes[6], uint32& mask) {
+            for (auto i = 0; i < 6; i++) {
+                const auto bit = 1u << i;
+                if ((mask & bit) == 0) { continue; }
+                const float4& plane = planes[i].data;
+                const float3 normal = plane.xyz;
+                const float distance = plane.w;
+                // Positive vertex : the box corner the farthest along the normal
+                const float3 positive = select(normal >= 0.0f, aabb.max, aabb.min);
+                const float positiveDistance = dot(normal, positive) + distance;
+                if (positiveDistance < 0.0f) { return false; }
+                // Negative vertex in front of the plane : the whole box is in front of the plane
+                const float3 negative = select(normal >= 0.0f, aabb.min, aabb.max);
+                const float negativeDistance = dot(normal, negative) + distance;
+                if (negativeDistance >= 0.0f) { mask &= ~bit; }
+            }
+            return true;
+        }
+    };
+
+}
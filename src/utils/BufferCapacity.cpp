@@ -0,0 +1,48 @@
+/*
+ * Copyright (c) 2025-present Henri Michelon
+ *
+ * This software is released under the MIT License.
+ * https://opensource.org/licenses/MIT
+*/
+module lysa.buffer_capacity;
+
+namespace lysa {
+
+    BufferCapacity::BufferCapacity(const uint32 maximum, const BufferCapacityConfiguration& configuration) :
+        maximum(std::max(maximum, 1u)),
+        configuration(configuration) {
+    }
+
+    uint32 BufferCapacity::fit(const uint32 count) const {
+        const auto wanted = static_cast<uint64>(count) +
+            static_cast<uint64>(std::ceil(static_cast<float>(count) * configuration.headroom));
+        const auto rounded = std::bit_ceil(std::max(wanted, static_cast<uint64>(configuration.minimum)));
+        return static_cast<uint32>(std::min(rounded, static_cast<uint64>(maximum)));
+    }
+
+    bool BufferCapacity::update(const uint32 count) {
+        if (capacity == 0 || count > capacity) {
+            // Grows immediately, the elements must fit
+            const auto previous = capacity;
+            capacity = std::max(fit(count), std::min(count, maximum));
+            updatesUnderThreshold = 0;
+            return capacity != previous;
+        }
+        if (static_cast<float>(count) >= static_cast<float>(capacity) * configuration.shrinkThreshold) {
+            updatesUnderThreshold = 0;
+            return false;
+        }
+        updatesUnderThreshold += 1;
+        if (updatesUnderThreshold < configuration.shrinkDelay) {
+            return false;
+        }
+        updatesUnderThreshold = 0;
+        const auto next = fit(count);
+        if (next >= capacity) {
+            return false;
+        }
+        capacity = next;
+        return true;
+    }
+
+}
@@ -0,0 +1,74 @@
+/*
+ * Copyright (c) 2025-present Henri Michelon
+ *
+ * This software is released under the MIT License.
+ * https://opensource.org/licenses/MIT
+*/
+export module lysa.buffer_capacity;
+
+import lysa.math;
+
+export namespace lysa {
+
+    /**
+     * Sizing rules of a BufferCapacity.
+     */
+    struct BufferCapacityConfiguration {
+        /** Smallest capacity, in elements. */
+        uint32 minimum{64};
+        /** Extra elements reserved above the count when the capacity changes, as a fraction of the count. */
+        float headroom{0.25f};
+        /** The capacity shrinks when the count stays under this fraction of the capacity. */
+        float shrinkThreshold{0.25f};
+        /** Number of consecutive updates under the shrink threshold before shrinking. */
+        uint32 shrinkDelay{120};
+    };
+
+    /**
+     * Capacity of a GPU buffer following a number of elements.
+     *
+     * The capacity is the power of two above the count plus the headroom, so the buffers of
+     * the same capacity can be reused by each other (see BufferPool). It grows as soon as the
+     * count exceeds it. It shrinks only after the count stayed under the shrink threshold for
+     * the shrink delay : with the default values a new capacity is at least twice the count
+     * and at most half the previous capacity, so a count oscillating around a power of two
+     * never reallocates the buffers.
+     *
+     * The class only computes the capacity, the caller reallocates its buffers.
+     */
+    class BufferCapacity {
+    public:
+        /**
+         * Creates a capacity, zero until the first update().
+         * @param maximum Largest capacity, in elements
+         * @param configuration Sizing rules
+         */
+        BufferCapacity(uint32 maximum, const BufferCapacityConfiguration& configuration = {});
+
+        /**
+         * Updates the capacity for a number of elements, called once per frame.
+         * @param count Number of elements stored in the buffer, at most the maximum capacity
+         * @return true if the capacity changed and the buffer must be reallocated
+         */
+        bool update(uint32 count);
+
+        /**
+         * Returns the capacity for a number of elements, without the hysteresis.
+         * @param count Number of elements
+         */
+        uint32 fit(uint32 count) const;
+
+        /** Returns the current capacity, in elements. */
+        auto get() const { return capacity; }
+
+        /** Returns the largest capacity, in elements. */
+        auto getMaximum() const { return maximum; }
+
+    private:
+        const uint32 maximum;
+        const BufferCapacityConfiguration configuration;
+        uint32 capacity{0};
+        uint32 updatesUnderThreshold{0};
+    };
+
+}
@@ -0,0 +1,75 @@
+/*
+ * Copyright (c) 2025-present Henri Michelon
+ *
+ * This software is released under the MIT License.
+ * https://opensource.org/licenses/MIT
+*/
+module lysa.culling_view;
+
+namespace lysa {
+
+    CullingView::CullingView(const float4x4& viewProjection, const uint32 type) :
+        type{type} {
+        Frustum::extractPlanes(planes, viewProjection);
+    }
+
+    CullingView CullingView::cube(const float3& position, const float range, const uint32 type) {
+        auto view = CullingView{};
+        view.planes[0].data = float4{position, range};
+        view.type = type;
+        return view;
+    }
+
+    uint32 CullingView::getCubeFacesMask(const AABB& aabb) const {
+        const float3 position = planes[0].data.xyz;
+        const float range = planes[0].data.w;
+        // Outside the range of the light
+        const float3 nearest = clamp(position, aabb.min, aabb.max);
+        const float3 toNearest = nearest - position;
+        if (static_cast<float>(dot(toNearest, toNearest)) > range * range) { return 0; }
+        // A face along the axis A with the sign S sees the points where S * A >= |B| for the
+        // two other axes B, tested separately against the four planes S * A = +/- B
+        const float3 boxMin = aabb.min - position;
+        const float3 boxMax = aabb.max - position;
+        auto mask = 0u;
+        for (auto face = 0; face < 6; face++) {
+            const auto axis = face / 2;
+            const auto farthest = (face % 2 == 0) ? static_cast<float>(boxMax[axis]) : -static_cast<float>(boxMin[axis]);
+            auto visible = farthest > 0.0f;
+            for (auto other = 0; other < 3 && visible; other++) {
+                if (other == axis) { continue; }
+                visible = farthest >= static_cast<float>(boxMin[other]) && farthest >= -static_cast<float>(boxMax[other]);
+            }
+            if (visible) { mask |= 1u << face; }
+        }
+        return mask;
+    }
+
+    bool CullingView::isOccluded(const std::span<const uint32> occlusionBits, const uint32 meshInstanceIndex) const {
+        if (type != TYPE_CAMERA || occlusionOffset == NO_OCCLUSION) { return false; }
+        const auto word = occlusionOffset + meshInstanceIndex / 32;
+        return word < occlusionBits.size() && (occlusionBits[word] & (1u << (meshInstanceIndex % 32))) != 0;
+    }
+
+    bool CullingView::isVisible(
+        const AABB& aabb,
+        const bool visible,
+        const bool castShadows,
+        const bool occluded,
+        const bool isStatic) const {
+        if (!visible) { return false; }
+        if (type == TYPE_CAMERA ? occluded : !castShadows) { return false; }
+        if ((type == TYPE_SHADOW_STATIC && !isStatic) ||
+            ((type == TYPE_SHADOW_DYNAMIC || type == TYPE_SHADOW_CUBE_DYNAMIC) && isStatic)) { return false; }
+        if (isCube()) { return getCubeFacesMask(aabb) != 0; }
+        for (const auto& plane : planes) {
+            // Corner of the box the farthest along the plane normal
+            const float3 positiveVertex = select(plane.data.xyz >= float3{0.0f}, aabb.max, aabb.min);
+            if (static_cast<float>(dot(plane.data.xyz, positiveVertex) + plane.data.w) < 0.0f) {
+                return false;
+            }
+        }
+        return true;
+    }
+
+}
@@ -0,0 +1,107 @@
+/*
+ * Copyright (c) 2025-present Henri Michelon
+ *
+ * This software is released under the MIT License.
+ * https://opensource.org/licenses/MIT
+*/
+export module lysa.culling_view;
+
+import std;
+import lysa.aabb;
+import lysa.frustum;
+import lysa.math;
+
+export namespace lysa {
+
+    /**
+     * A point of view tested by the GPU culling : the main camera, a shadow map cascade,
+     * a face of an omni light cube map, a whole cube map or a spot light.
+     *
+     * A cube map view is tested against the six faces at once : the visible faces are
+     * stored as a mask in the six high bits of the instance index of the culled draw command,
+     * drawn with one instance per visible face, see shadowmap_cubemap.vert.
+     *
+     * A camera view reads the software occlusion results of its own camera, one bit per mesh
+     * instance starting at occlusionOffset in the occlusion bits buffer of the scene frame data,
+     * so several cameras on the same scene do not share the results of the last one.
+     *
+     * The memory layout is the one of the `CullingView` structure of the culling shader,
+     * the views are uploaded as is in a storage buffer.
+     *
+     * isVisible() is the CPU reference of the view versus instance test done by the shader
+     * and must be kept in sync with it.
+     */
+    struct CullingView {
+        /** The view renders the visible and not occluded instances. */
+        static constexpr uint32 TYPE_CAMERA{0};
+        /** The view renders the visible instances casting shadows. */
+        static constexpr uint32 TYPE_SHADOW{1};
+        /** The view renders the visible static instances casting shadows, for a shadow map cache. */
+        static constexpr uint32 TYPE_SHADOW_STATIC{2};
+        /** The view renders the visible non-static instances casting shadows, over a shadow map cache. */
+        static constexpr uint32 TYPE_SHADOW_DYNAMIC{3};
+        /** The cube map view renders the visible instances casting shadows in all the faces. */
+        static constexpr uint32 TYPE_SHADOW_CUBE{4};
+        /** The cube map view renders the visible non-static instances casting shadows, over the faces caches. */
+        static constexpr uint32 TYPE_SHADOW_CUBE_DYNAMIC{5};
+        /** First bit of the visible faces mask in the instance index of a cube map draw command. */
+        static constexpr uint32 CUBE_FACES_SHIFT{26};
+        /** occlusionOffset of the views without software occlusion results. */
+        static constexpr uint32 NO_OCCLUSION{0xffffffff};
+
+        /** Clipping planes of the view, see Frustum::extractPlanes(). For a cube map view the first one is the light position and range. */
+        Frustum::Plane planes[6];
+        /** Type of the view, one of the TYPE_* constants. */
+        uint32 type{TYPE_CAMERA};
+        /** Index of the first word of the software occlusion bits of a camera view, or NO_OCCLUSION. */
+        uint32 occlusionOffset{NO_OCCLUSION};
+
+        CullingView() = default;
+
+        /**
+         * Creates a view from a view and projection matrix.
+         * @param viewProjection View and projection matrix (clip-from-world)
+         * @param type Type of the view
+         */
+        CullingView(const float4x4& viewProjection, uint32 type);
+
+        /**
+         * Creates a view of the six faces of an omni light cube map.
+         * @param position Position of the light
+         * @param range Range of the light
+         * @param type TYPE_SHADOW_CUBE or TYPE_SHADOW_CUBE_DYNAMIC
+         */
+        static CullingView cube(const float3& position, float range, uint32 type);
+
+        /**
+         * Returns true for the cube map views.
+         */
+        bool isCube() const { return type == TYPE_SHADOW_CUBE || type == TYPE_SHADOW_CUBE_DYNAMIC; }
+
+        /**
+         * Returns the faces of a cube map view seeing a box, one bit per face in the order
+         * +X, -X, +Y, -Y, +Z, -Z.
+         * @param aabb World space bounding box
+         */
+        uint32 getCubeFacesMask(const AABB& aabb) const;
+
+        /**
+         * Returns true if a mesh instance is hidden in the software occlusion results of the view.
+         * @param occlusionBits Software occlusion bits of all the camera views, one bit per mesh instance
+         * @param meshInstanceIndex Index of the instance in the mesh instances data
+         */
+        bool isOccluded(std::span<const uint32> occlusionBits, uint32 meshInstanceIndex) const;
+
+        /**
+         * Tests a mesh instance against the view.
+         * @param aabb World space bounding box of the instance
+         * @param visible Visibility flag of the instance
+         * @param castShadows Shadow casting flag of the instance
+         * @param occluded Software occlusion flag of the instance in the view, see isOccluded()
+         * @param isStatic Static flag of the instance
+         * @return true if the instance is drawn in the view
+         */
+        bool isVisible(const AABB& aabb, bool visible, bool castShadows, bool occluded, bool isStatic) const;
+    };
+
+}
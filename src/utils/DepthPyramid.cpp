@@ -0,0 +1,110 @@
+/*
+ * Copyright (c) 2025-present Henri Michelon
+ *
+ * This software is released under the MIT License.
+ * https://opensource.org/licenses/MIT
+*/
+module lysa.depth_pyramid;
+
+import lysa.exception;
+
+namespace lysa {
+
+    DepthPyramid::DepthPyramid(const uint32 width, const uint32 height) :
+        width{width},
+        height{height} {
+        auto levelWidth = width;
+        auto levelHeight = height;
+        do {
+            levelWidth = std::max(1u, (levelWidth + 1) / 2);
+            levelHeight = std::max(1u, (levelHeight + 1) / 2);
+            levels.push_back({ size, levelWidth, levelHeight });
+            size += levelWidth * levelHeight;
+        } while ((levelWidth > 1 || levelHeight > 1) && levels.size() < MAX_LEVELS);
+    }
+
+    void DepthPyramid::build(const std::vector<float>& depth) {
+        assert([&]{ return depth.size() == width * height; }, "Invalid depth buffer size");
+        data.resize(size);
+        auto srcWidth = width;
+        auto srcHeight = height;
+        const float* src = depth.data();
+        for (const auto& level : levels) {
+            float* dst = data.data() + level.offset;
+            for (auto y = 0u; y < level.height; y++) {
+                const auto y0 = std::min(y * 2, srcHeight - 1);
+                const auto y1 = std::min(y * 2 + 1, srcHeight - 1);
+                for (auto x = 0u; x < level.width; x++) {
+                    const auto x0 = std::min(x * 2, srcWidth - 1);
+                    const auto x1 = std::min(x * 2 + 1, srcWidth - 1);
+                    dst[y * level.width + x] = std::max(
+                        std::max(src[y0 * srcWidth + x0], src[y0 * srcWidth + x1]),
+                        std::max(src[y1 * srcWidth + x0], src[y1 * srcWidth + x1]));
+                }
+            }
+            src = dst;
+            srcWidth = level.width;
+            srcHeight = level.height;
+        }
+    }
+
+    bool DepthPyramid::isOccluded(
+        const AABB& aabb,
+        const float4x4& view,
+        const float4x4& projection,
+        const float4& viewport) const {
+        assert([&]{ return !data.empty(); }, "Depth pyramid not built");
+        const auto viewProjection = mul(view, projection);
+        auto ndcMin = float2{std::numeric_limits<float>::max()};
+        auto ndcMax = float2{std::numeric_limits<float>::lowest()};
+        auto nearestDepth = std::numeric_limits<float>::max();
+        for (auto i = 0; i < 8; i++) {
+            const auto corner = float4{
+                (i & 1) ? aabb.max.x : aabb.min.x,
+                (i & 2) ? aabb.max.y : aabb.min.y,
+                (i & 4) ? aabb.max.z : aabb.min.z,
+                1.0f };
+            const float4 clip = mul(corner, viewProjection);
+            const float w = clip.w;
+            // Crossing the camera plane : can't be projected
+            if (w <= 1e-5f) { return false; }
+            const float3 ndc = clip.xyz / w;
+            ndcMin = lysa::min(ndcMin, ndc.xy);
+            ndcMax = lysa::max(ndcMax, ndc.xy);
+            nearestDepth = std::min(nearestDepth, static_cast<float>(ndc.z));
+        }
+
+        // NDC to depth buffer pixels, Y down
+        const float minX = viewport.x + (ndcMin.x * 0.5f + 0.5f) * viewport.z;
+        const float maxX = viewport.x + (ndcMax.x * 0.5f + 0.5f) * viewport.z;
+        const float minY = viewport.y + (0.5f - ndcMax.y * 0.5f) * viewport.w;
+        const float maxY = viewport.y + (0.5f - ndcMin.y * 0.5f) * viewport.w;
+        // Outside of the depth buffer : let the frustum culling decide
+        if (maxX < 0.0f || maxY < 0.0f || minX >= width || minY >= height) { return false; }
+        const auto x0 = static_cast<uint32>(std::max(0.0f, minX));
+        const auto y0 = static_cast<uint32>(std::max(0.0f, minY));
+        const auto x1 = std::min(static_cast<uint32>(maxX), width - 1);
+        const auto y1 = std::min(static_cast<uint32>(maxY), height - 1);
+
+        // Smallest level where the rectangle covers at most 2x2 texels
+        const auto extent = std::max(x1 - x0, y1 - y0) + 1;
+        auto levelIndex = 0u;
+        while ((2u << levelIndex) < extent && levelIndex < levels.size() - 1) {
+            levelIndex += 1;
+        }
+        const auto& level = levels[levelIndex];
+        const auto shift = levelIndex + 1;
+        const auto tx0 = std::min(x0 >> shift, level.width - 1);
+        const auto tx1 = std::min(x1 >> shift, level.width - 1);
+        const auto ty0 = std::min(y0 >> shift, level.height - 1);
+        const auto ty1 = std::min(y1 >> shift, level.height - 1);
+        auto farthestDepth = 0.0f;
+        for (auto y = ty0; y <= ty1; y++) {
+            for (auto x = tx0; x <= tx1; x++) {
+                farthestDepth = std::max(farthestDepth, get(levelIndex, x, y));
+            }
+        }
+        return nearestDepth > farthestDepth;
+    }
+
+}
@@ -0,0 +1,115 @@
+/*
+ * Copyright (c) 2025-present Henri Michelon
+ *
+ * This software is released under the MIT License.
+ * https://opensource.org/licenses/MIT
+*/
+export module lysa.depth_pyramid;
+
+import lysa.aabb;
+import lysa.math;
+
+export namespace lysa {
+
+    /**
+     * Hierarchical depth (Hi-Z) pyramid used by the GPU occlusion culling.
+     *
+     * The level 0 is half the resolution of the depth buffer and each texel of a level
+     * stores the farthest depth of the 2x2 texels of the previous level (or pixels of the
+     * depth buffer for the level 0), odd sizes being rounded up. A texel of the level L
+     * covers exactly the (2^(L+1))² pixels block of the depth buffer at the same position.
+     * All the levels are stored in a single linear array, level after level.
+     *
+     * This class gives the layout shared with the `depth_pyramid.comp` and
+     * `occlusion_culling.comp` shaders and is the CPU reference implementation of both
+     * the pyramid reduction and the AABB occlusion test.
+     */
+    class DepthPyramid {
+    public:
+        /** Maximum number of levels, enough for a 65536x65536 depth buffer. */
+        static constexpr uint32 MAX_LEVELS{16};
+
+        /**
+         * Position and size of a level in the linear array.
+         * Matches the layout of the `Level` struct of the shaders.
+         */
+        struct Level {
+            /** Index of the first texel of the level. */
+            uint32 offset;
+            /** Width of the level in texels. */
+            uint32 width;
+            /** Height of the level in texels. */
+            uint32 height;
+            uint32 _pad{0};
+        };
+
+        /**
+         * Computes the layout of the pyramid for a depth buffer.
+         * @param width Width of the depth buffer in pixels
+         * @param height Height of the depth buffer in pixels
+         */
+        DepthPyramid(uint32 width, uint32 height);
+
+        /**
+         * Builds the pyramid from a depth buffer (CPU reference of `depth_pyramid.comp`).
+         * @param depth Depth buffer, row by row, width*height values
+         */
+        void build(const std::vector<float>& depth);
+
+        /**
+         * Tests an AABB against the pyramid (CPU reference of `occlusion_culling.comp`).
+         *
+         * The AABB is projected on the screen, the smallest level where the projected
+         * rectangle covers at most 2x2 texels is selected and the nearest depth of the box
+         * is compared with the farthest depth of those texels. Boxes crossing the camera
+         * plane are never occluded.
+         * @param aabb World space box
+         * @param view View matrix (view-from-world)
+         * @param projection Projection matrix (clip-from-view)
+         * @param viewport Rectangle of the view in the depth buffer, in pixels : x, y, width, height
+         * @return true if the box is fully hidden by the depth buffer
+         */
+        bool isOccluded(
+            const AABB& aabb,
+            const float4x4& view,
+            const float4x4& projection,
+            const float4& viewport) const;
+
+        /**
+         * Returns the farthest depth stored in a texel.
+         * @param level Level index
+         * @param x Column of the texel
+         * @param y Row of the texel
+         */
+        float get(const uint32 level, const uint32 x, const uint32 y) const {
+            const auto& l = levels[level];
+            return data[l.offset + y * l.width + x];
+        }
+
+        /** Returns the levels of the pyramid. */
+        const auto& getLevels() const { return levels; }
+
+        /** Returns the number of levels of the pyramid. */
+        auto getLevelsCount() const { return static_cast<uint32>(levels.size()); }
+
+        /** Returns the total number of texels of all the levels. */
+        auto getSize() const { return size; }
+
+        /** Returns the width of the source depth buffer. */
+        auto getWidth() const { return width; }
+
+        /** Returns the height of the source depth buffer. */
+        auto getHeight() const { return height; }
+
+        /** Returns the texels of all the levels, empty if build() has not been called. */
+        const auto& getData() const { return data; }
+
+    private:
+        const uint32 width;
+        const uint32 height;
+        uint32 size{0};
+        std::vector<Level> levels;
+        std::vector<float> data;
+    };
+
+}
@@ -0,0 +1,87 @@
+/*
+ * Copyright (c) 2025-present Henri Michelon
+ *
+ * This software is released under the MIT License.
+ * https://opensource.org/licenses/MIT
+*/
+module lysa.draw_batches;
+
+namespace lysa {
+
+    DrawBatches::DrawBatches(const uint32 maxInstancesPerBatch) :
+        maxInstancesPerBatch{std::max(maxInstancesPerBatch, 1u)} {
+    }
+
+    void DrawBatches::clear() {
+        batches.clear();
+        instanceBatches.clear();
+        batchIndices.clear();
+        instancesCount = 0;
+    }
+
+    uint32 DrawBatches::add(
+        const uint32 meshSurfaceIndex,
+        const uint32 materialIndex,
+        const uint32 instanceIndex,
+        const uint32 indexCount,
+        const uint32 firstIndex,
+        const int32 vertexOffset) {
+        const auto key = static_cast<uint64>(meshSurfaceIndex) << 32 | materialIndex;
+        auto it = batchIndices.find(key);
+        if (it == batchIndices.end() || batches[it->second].instancesCount >= maxInstancesPerBatch) {
+            // The full batch keeps its draw commands, the next ones go to a new batch
+            it = batchIndices.insert_or_assign(key, static_cast<uint32>(batches.size())).first;
+            batches.push_back({
+                .indexCount = indexCount,
+                .firstIndex = firstIndex,
+                .vertexOffset = vertexOffset,
+            });
+        }
+        const auto batch = it->second;
+        batches[batch].instancesCount += 1;
+        if (instanceIndex >= instanceBatches.size()) {
+            instanceBatches.resize(instanceIndex + 1, 0);
+        }
+        instanceBatches[instanceIndex] = batch;
+        instancesCount += 1;
+        return batch;
+    }
+
+    void DrawBatches::updateRanges() {
+        auto firstInstance = 0u;
+        for (auto& batch : batches) {
+            batch.firstInstance = firstInstance;
+            firstInstance += batch.instancesCount;
+        }
+    }
+
+    void DrawBatches::compact(
+        const std::vector<Command>& culled,
+        std::vector<Command>& output,
+        std::vector<uint32>& instanceIndices) const {
+        // Gather : one slot of the range of its batch per visible instance
+        auto counters = std::vector<uint32>(batches.size(), 0);
+        instanceIndices.assign(instancesCount, 0);
+        for (const auto& command : culled) {
+            const auto batch = instanceBatches[command.instanceIndex];
+            instanceIndices[batches[batch].firstInstance + counters[batch]] = command.instanceIndex;
+            counters[batch] += 1;
+        }
+        // Emit : one instanced draw command per batch with visible instances
+        output.clear();
+        for (auto i = 0; i < batches.size(); i++) {
+            if (counters[i] == 0) { continue; }
+            const auto& batch = batches[i];
+            const auto instanceIndex = batch.firstInstance | INDIRECT_INSTANCE;
+            output.push_back({
+                .instanceIndex = instanceIndex,
+                .indexCount = batch.indexCount,
+                .instanceCount = counters[i],
+                .firstIndex = batch.firstIndex,
+                .vertexOffset = batch.vertexOffset,
+                .firstInstance = instanceIndex,
+            });
+        }
+    }
+
+}
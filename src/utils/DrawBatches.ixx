@@ -0,0 +1,137 @@
+/*
+ * Copyright (c) 2025-present Henri Michelon
+ *
+ * This software is released under the MIT License.
+ * https://opensource.org/licenses/MIT
+*/
+export module lysa.draw_batches;
+
+import lysa.math;
+
+export namespace lysa {
+
+    /**
+     * Automatic instancing of the draw commands of a graphic pipeline.
+     *
+     * The draw commands drawing the same mesh surface with the same material are grouped in
+     * a batch, and each batch reserves a range of the instance indices list as large as its
+     * number of draw commands. After the culling the visible instances of a batch are gathered
+     * in its range and the batch emits one draw command with one instance per visible instance.
+     * The instance index of this command is the first index of the range with the
+     * INDIRECT_INSTANCE bit set : the vertex shaders then read the index of the Nth instance
+     * of the draw in the instance indices list.
+     * A batch has at most maxInstancesPerBatch draw commands, the next draw commands of the same
+     * mesh surface and material start a new batch : this bounds the contention on the counter of
+     * a batch during the gathering of the large foliage-like batches.
+     *
+     * This class builds the batches used by the `draw_batching.comp` shader and is the CPU
+     * reference implementation of the compaction. The GPU gathers the instances of a batch and
+     * emits the batches in any order, the CPU reference in the order of the culled commands
+     * and of the batches.
+     */
+    class DrawBatches {
+    public:
+        /** Bit of the instance index of a batched draw command, see the `instances.inc` shader. */
+        static constexpr uint32 INDIRECT_INSTANCE{1u << 31};
+        /** Default maximum number of draw commands of a batch. */
+        static constexpr uint32 MAX_INSTANCES_PER_BATCH{65536};
+
+        /**
+         * A batch of draw commands.
+         * Matches the layout of the `Batch` struct of the shader.
+         */
+        struct Batch {
+            /** Number of indices of the mesh surface. */
+            uint32 indexCount;
+            /** Index of the first index of the mesh surface in the index buffer. */
+            uint32 firstIndex;
+            /** Index of the first vertex of the mesh in the vertex buffer. */
+            int32  vertexOffset;
+            /** Index of the range of the batch in the instance indices list. */
+            uint32 firstInstance{0};
+            /** Number of draw commands of the batch, size of its range. */
+            uint32 instancesCount{0};
+        };
+
+        /**
+         * A draw command with the instance index it belongs to.
+         * Same layout as DrawCommand.
+         */
+        struct Command {
+            uint32 instanceIndex;
+            uint32 indexCount;
+            uint32 instanceCount;
+            uint32 firstIndex;
+            int32  vertexOffset;
+            uint32 firstInstance;
+        };
+
+        /**
+         * Creates an empty list of batches.
+         * @param maxInstancesPerBatch Maximum number of draw commands of a batch
+         */
+        explicit DrawBatches(uint32 maxInstancesPerBatch = MAX_INSTANCES_PER_BATCH);
+
+        /**
+         * Removes all the batches.
+         */
+        void clear();
+
+        /**
+         * Adds a draw command to the batch of its mesh surface and material, creates the batch if needed
+         * or if the current batch of the mesh surface and material is full.
+         * updateRanges() must be called before using the batches.
+         * @param meshSurfaceIndex Index of the mesh surface in the global surfaces array
+         * @param materialIndex Index of the material of the surface
+         * @param instanceIndex Instance index of the draw command
+         * @param indexCount Number of indices of the mesh surface
+         * @param firstIndex Index of the first index of the mesh surface
+         * @param vertexOffset Index of the first vertex of the mesh
+         * @return Index of the batch
+         */
+        uint32 add(
+            uint32 meshSurfaceIndex,
+            uint32 materialIndex,
+            uint32 instanceIndex,
+            uint32 indexCount,
+            uint32 firstIndex,
+            int32  vertexOffset);
+
+        /**
+         * Computes the ranges of the batches in the instance indices list.
+         */
+        void updateRanges();
+
+        /**
+         * Gathers the culled draw commands in instanced draw commands (CPU reference of `draw_batching.comp`).
+         * @param culled Culled draw commands, added with add()
+         * @param output One draw command per batch with visible instances
+         * @param instanceIndices Instance indices list, indexed by the instance index of the output commands
+         */
+        void compact(
+            const std::vector<Command>& culled,
+            std::vector<Command>& output,
+            std::vector<uint32>& instanceIndices) const;
+
+        /** Returns the batches. */
+        const auto& getBatches() const { return batches; }
+
+        /** Returns the batch of each instance index, the unused instance indices are in the batch 0. */
+        const auto& getInstanceBatches() const { return instanceBatches; }
+
+        /** Returns the size of the instance indices list, the number of draw commands added. */
+        auto getInstancesCount() const { return instancesCount; }
+
+        /** Returns the maximum number of draw commands of a batch. */
+        auto getMaxInstancesPerBatch() const { return maxInstancesPerBatch; }
+
+    private:
+        const uint32 maxInstancesPerBatch;
+        std::vector<Batch> batches;
+        std::vector<uint32> instanceBatches;
+        // Batch being filled for each mesh surface and material
+        std::unordered_map<uint64, uint32> batchIndices;
+        uint32 instancesCount{0};
+    };
+
+}
@@ -0,0 +1,89 @@
+/*
+ * Copyright (c) 2025-present Henri Michelon
+ *
+ * This software is released under the MIT License.
+ * https://opensource.org/licenses/MIT
+*/
+module lysa.light_clusters;
+
+namespace lysa {
+
+    uint32 LightClusters::getClusterIndex(const float2& ndc, const float viewDepth, const float near, const float far) {
+        const auto tileX = std::clamp(
+            static_cast<int32>(std::floor((static_cast<float>(ndc.x) * 0.5f + 0.5f) * TILES_X)),
+            0, static_cast<int32>(TILES_X) - 1);
+        const auto tileY = std::clamp(
+            static_cast<int32>(std::floor((static_cast<float>(ndc.y) * 0.5f + 0.5f) * TILES_Y)),
+            0, static_cast<int32>(TILES_Y) - 1);
+        auto slice = 0;
+        if (viewDepth > near) {
+            slice = std::min(
+                static_cast<int32>(std::floor(std::log(viewDepth / near) / std::log(far / near) * SLICES)),
+                static_cast<int32>(SLICES) - 1);
+        }
+        return (slice * TILES_Y + tileY) * TILES_X + tileX;
+    }
+
+    void LightClusters::getClusterBounds(
+        const uint32 x, const uint32 y, const uint32 slice,
+        const float4x4& inverseProjection,
+        const float near, const float far,
+        float3& min, float3& max) {
+        // Exponential slices, the camera looks toward -Z
+        const auto sliceNear = near * std::pow(far / near, static_cast<float>(slice) / SLICES);
+        const auto sliceFar = near * std::pow(far / near, static_cast<float>(slice + 1) / SLICES);
+        min = float3{std::numeric_limits<float>::max()};
+        max = float3{std::numeric_limits<float>::lowest()};
+        for (auto i = 0; i < 4; i++) {
+            const auto ndcX = -1.0f + 2.0f * static_cast<float>(x + (i & 1)) / TILES_X;
+            const auto ndcY = -1.0f + 2.0f * static_cast<float>(y + (i >> 1)) / TILES_Y;
+            // Line of the corner between the near and far planes, for perspective and orthographic projections
+            const float4 nearPoint = mul(float4{ndcX, ndcY, 0.0f, 1.0f}, inverseProjection);
+            const float4 farPoint = mul(float4{ndcX, ndcY, 1.0f, 1.0f}, inverseProjection);
+            const float3 start = nearPoint.xyz / nearPoint.w;
+            const float3 end = farPoint.xyz / farPoint.w;
+            for (const auto depth : { sliceNear, sliceFar }) {
+                const float t = (-depth - start.z) / (end.z - start.z);
+                const float3 corner = start + (end - start) * t;
+                min = lysa::min(min, corner);
+                max = lysa::max(max, corner);
+            }
+        }
+    }
+
+    void LightClusters::build(
+        const std::vector<float4>& lights,
+        const float4x4& view,
+        const float4x4& projection,
+        const float near, const float far) {
+        data.assign(COUNT * CLUSTER_STRIDE, 0);
+        auto viewLights = std::vector<float4>(lights.size());
+        for (auto i = 0; i < lights.size(); i++) {
+            viewLights[i] = float4{mul(float4{lights[i].xyz, 1.0f}, view).xyz, lights[i].w};
+        }
+        const auto inverseProjection = inverse(projection);
+        for (auto slice = 0u; slice < SLICES; slice++) {
+            for (auto y = 0u; y < TILES_Y; y++) {
+                for (auto x = 0u; x < TILES_X; x++) {
+                    float3 min, max;
+                    getClusterBounds(x, y, slice, inverseProjection, near, far, min, max);
+                    const auto cluster = (slice * TILES_Y + y) * TILES_X + x;
+                    auto count = 0u;
+                    for (auto i = 0; i < viewLights.size() && count < MAX_LIGHTS_PER_CLUSTER; i++) {
+                        const auto& light = viewLights[i];
+                        const float range = light.w;
+                        if (range == 0.0f) { continue; }
+                        if (range > 0.0f) {
+                            const float3 toNearest = clamp(light.xyz, min, max) - light.xyz;
+                            if (static_cast<float>(dot(toNearest, toNearest)) > range * range) { continue; }
+                        }
+                        data[cluster * CLUSTER_STRIDE + 1 + count] = i;
+                        count += 1;
+                    }
+                    data[cluster * CLUSTER_STRIDE] = count;
+                }
+            }
+        }
+    }
+
+}
@@ -0,0 +1,99 @@
+/*
+ * Copyright (c) 2025-present Henri Michelon
+ *
+ * This software is released under the MIT License.
+ * https://opensource.org/licenses/MIT
+*/
+export module lysa.light_clusters;
+
+import lysa.math;
+
+export namespace lysa {
+
+    /**
+     * Clustered (froxel) light assignment.
+     *
+     * The view frustum of the camera is split in TILES_X x TILES_Y screen tiles and SLICES
+     * depth slices, exponentially distributed between the near and far planes. Each cluster
+     * stores the indices of the lights whose range sphere touches the view space bounding box
+     * of the cluster, in the order of the lights buffer, up to MAX_LIGHTS_PER_CLUSTER lights.
+     * The lights with a negative range (directional lights) are in all the clusters, the
+     * lights with a null range (empty slots of the lights buffer) in none of them.
+     *
+     * The clusters are stored in a single array of CLUSTER_STRIDE uint32 per cluster : the
+     * number of lights then the lights indices. The index of a cluster is
+     * (slice * TILES_Y + tileY) * TILES_X + tileX, tileX and tileY growing with the NDC.
+     *
+     * This class gives the layout shared with the `light_clustering.comp` and `lighting.inc`
+     * shaders and is the CPU reference implementation of the light assignment.
+     */
+    class LightClusters {
+    public:
+        /** Number of screen tiles on the X axis. */
+        static constexpr uint32 TILES_X{16};
+        /** Number of screen tiles on the Y axis. */
+        static constexpr uint32 TILES_Y{9};
+        /** Number of depth slices. */
+        static constexpr uint32 SLICES{24};
+        /** Number of clusters. */
+        static constexpr uint32 COUNT{TILES_X * TILES_Y * SLICES};
+        /** Maximum number of lights in a cluster, the next ones are ignored. */
+        static constexpr uint32 MAX_LIGHTS_PER_CLUSTER{255};
+        /** Number of uint32 per cluster in the clusters array. */
+        static constexpr uint32 CLUSTER_STRIDE{MAX_LIGHTS_PER_CLUSTER + 1};
+
+        /**
+         * Returns the index of the cluster containing a view space position.
+         * @param ndc Normalized device coordinates of the position
+         * @param viewDepth Distance from the camera plane, positive in front of the camera
+         * @param near Near clipping plane distance
+         * @param far Far clipping plane distance
+         */
+        static uint32 getClusterIndex(const float2& ndc, float viewDepth, float near, float far);
+
+        /**
+         * Computes the view space bounding box of a cluster.
+         * @param x Screen tile column
+         * @param y Screen tile row
+         * @param slice Depth slice
+         * @param inverseProjection Inverse of the projection matrix (view-from-clip)
+         * @param near Near clipping plane distance
+         * @param far Far clipping plane distance
+         * @param min Minimum corner of the box
+         * @param max Maximum corner of the box
+         */
+        static void getClusterBounds(
+            uint32 x, uint32 y, uint32 slice,
+            const float4x4& inverseProjection,
+            float near, float far,
+            float3& min, float3& max);
+
+        /**
+         * Assigns the lights to the clusters (CPU reference of `light_clustering.comp`).
+         * @param lights World space position (XYZ) and range (W) of the lights, a negative
+         * range for the lights lighting all the clusters, a null range for the ignored lights
+         * @param view View matrix (view-from-world)
+         * @param projection Projection matrix (clip-from-view)
+         * @param near Near clipping plane distance
+         * @param far Far clipping plane distance
+         */
+        void build(
+            const std::vector<float4>& lights,
+            const float4x4& view,
+            const float4x4& projection,
+            float near, float far);
+
+        /** Returns the number of lights of a cluster. */
+        auto getLightsCount(const uint32 cluster) const { return data[cluster * CLUSTER_STRIDE]; }
+
+        /** Returns the index in the lights buffer of the i-th light of a cluster. */
+        auto getLight(const uint32 cluster, const uint32 i) const { return data[cluster * CLUSTER_STRIDE + 1 + i]; }
+
+        /** Returns the clusters array, empty if build() has not been called. */
+        const auto& getData() const { return data; }
+
+    private:
+        std::vector<uint32> data;
+    };
+
+}
@@ -0,0 +1,255 @@
+/*
+ * Copyright (c) 2025-present Henri Michelon
+ *
+ * This software is released under the MIT License.
+ * https://opensource.org/licenses/MIT
+*/
+module lysa.occlusion_rasterizer;
+
+import lysa.exception;
+
+namespace lysa {
+
+    OcclusionRasterizer::OcclusionRasterizer(const uint32 width, const uint32 height) :
+        width{std::max(1u, (width + TILE_WIDTH - 1) / TILE_WIDTH) * TILE_WIDTH},
+        height{std::max(1u, (height + TILE_HEIGHT - 1) / TILE_HEIGHT) * TILE_HEIGHT},
+        tilesX{this->width / TILE_WIDTH},
+        tilesY{this->height / TILE_HEIGHT},
+        occluderStride{this->width + 2 * OCCLUDER_BORDER_X},
+        depth(this->width * this->height, 1.0f),
+        tilesMaxDepth(tilesX * tilesY, 1.0f),
+        occluderDepth(occluderStride * (this->height + 2), UNCOVERED) {
+    }
+
+    void OcclusionRasterizer::begin(const float4x4& viewProjection) {
+        this->viewProjection = viewProjection;
+        std::ranges::fill(depth, 1.0f);
+        std::ranges::fill(tilesMaxDepth, 1.0f);
+        statistics = {};
+    }
+
+    void OcclusionRasterizer::renderOccluder(
+        const std::vector<float3>& positions,
+        const std::vector<uint32>& indices,
+        const float4x4& transform) {
+        assert([&]{ return indices.size() % 3 == 0; }, "Invalid occluder indices count");
+        const auto worldViewProjection = mul(transform, viewProjection);
+        screenVertices.resize(positions.size());
+        clippedVertices.resize(positions.size());
+        for (auto i = 0; i < positions.size(); i++) {
+            const float4 clip = mul(float4{positions[i], 1.0f}, worldViewProjection);
+            const float w = clip.w;
+            const float z = clip.z;
+            // Behind the camera or in front of the near plane
+            clippedVertices[i] = w <= 1e-5f || z < -w;
+            if (clippedVertices[i]) { continue; }
+            const float3 ndc = clip.xyz / w;
+            screenVertices[i] = float4{
+                (ndc.x * 0.5f + 0.5f) * width,
+                (0.5f - ndc.y * 0.5f) * height,
+                ndc.z,
+                0.0f};
+        }
+        for (auto i = 0; i < indices.size(); i += 3) {
+            const auto i0 = indices[i];
+            const auto i1 = indices[i + 1];
+            const auto i2 = indices[i + 2];
+            // Clipping the triangles is not worth it for occlusion : they are skipped
+            if (clippedVertices[i0] || clippedVertices[i1] || clippedVertices[i2]) {
+                statistics.trianglesSkipped += 1;
+                continue;
+            }
+            rasterize(screenVertices[i0], screenVertices[i1], screenVertices[i2]);
+        }
+        mergeOccluder();
+    }
+
+    void OcclusionRasterizer::rasterize(const float4& v0, const float4& v1, const float4& v2) {
+        const float x0 = v0.x, y0 = v0.y, z0 = v0.z;
+        float x1 = v1.x, y1 = v1.y, z1 = v1.z;
+        float x2 = v2.x, y2 = v2.y, z2 = v2.z;
+
+        // Both faces are rendered : counter-clockwise triangles are reordered
+        auto area = (x1 - x0) * (y2 - y0) - (y1 - y0) * (x2 - x0);
+        if (area < 0.0f) {
+            std::swap(x1, x2);
+            std::swap(y1, y2);
+            std::swap(z1, z2);
+            area = -area;
+        }
+        if (area <= 1e-8f) {
+            statistics.trianglesSkipped += 1;
+            return;
+        }
+
+        // Bounding rectangle clipped to the screen and its border, in the columns and rows of
+        // occluderDepth. The first column is aligned on the SIMD width.
+        const auto minX = std::max(-1.0f, std::floor(std::min({x0, x1, x2})));
+        const auto maxX = std::min(static_cast<float>(width), std::floor(std::max({x0, x1, x2})));
+        const auto minY = std::max(-1.0f, std::floor(std::min({y0, y1, y2})));
+        const auto maxY = std::min(static_cast<float>(height), std::floor(std::max({y0, y1, y2})));
+        if (minX > maxX || minY > maxY) {
+            statistics.trianglesSkipped += 1;
+            return;
+        }
+        const auto startX = static_cast<uint32>(minX + OCCLUDER_BORDER_X) & ~3u;
+        const auto endX = static_cast<uint32>(maxX + OCCLUDER_BORDER_X);
+        const auto startY = static_cast<uint32>(minY + 1.0f);
+        const auto endY = static_cast<uint32>(maxY + 1.0f);
+        occluderMinX = std::min(occluderMinX, startX);
+        occluderMaxX = std::max(occluderMaxX, endX | 3u);
+        occluderMinY = std::min(occluderMinY, startY);
+        occluderMaxY = std::max(occluderMaxY, endY);
+
+        // Edge functions E(x, y) = A * x + B * y + C, positive inside the triangle
+        const auto edge = [](const float ax, const float ay, const float bx, const float by) {
+            const auto a = ay - by;
+            const auto b = bx - ax;
+            return float3{a, b, -(a * ax + b * ay)};
+        };
+        const auto e12 = edge(x1, y1, x2, y2);
+        const auto e20 = edge(x2, y2, x0, y0);
+        const auto e01 = edge(x0, y0, x1, y1);
+
+        // Depth plane interpolated with the barycentric coordinates
+        const auto invArea = 1.0f / area;
+        const float3 zPlane = (e12 * z0 + e20 * z1 + e01 * z2) * invArea;
+        const float zA = zPlane.x;
+        const float zB = zPlane.y;
+        // Farthest depth inside the pixel, but never farther than the triangle
+        const auto zBias = 0.5f * (std::fabs(zA) + std::fabs(zB));
+        const auto zFar = float4{std::max({z0, z1, z2})};
+
+        // Pixel centers inside the triangle or on its edges. The pixels covered by two triangles
+        // of the occluder keep the nearest depth.
+        const float4 a12{e12.x}, a20{e20.x}, a01{e01.x}, aZ{zA};
+        const auto zero = float4{0.0f};
+        for (auto y = startY; y <= endY; y++) {
+            // Row and columns of the screen
+            const float py = static_cast<float>(y) - 0.5f;
+            const float4 row12{e12.y * py + e12.z};
+            const float4 row20{e20.y * py + e20.z};
+            const float4 row01{e01.y * py + e01.z};
+            const float4 rowZ{zB * py + zPlane.z + zBias};
+            float* line = occluderDepth.data() + y * occluderStride;
+            for (auto x = startX; x <= endX; x += 4) {
+                const auto px = float4{static_cast<float>(x) - static_cast<float>(OCCLUDER_BORDER_X)} +
+                    float4{0.5f, 1.5f, 2.5f, 3.5f};
+                const float4 inside =
+                    (a12 * px + row12 >= zero) *
+                    (a20 * px + row20 >= zero) *
+                    (a01 * px + row01 >= zero);
+                const float4 z = min(aZ * px + rowZ, zFar);
+                float4 current;
+                load(current, line + x);
+                store(select(inside, min(current, z), current), line + x);
+            }
+        }
+        statistics.trianglesRasterized += 1;
+    }
+
+    void OcclusionRasterizer::mergeOccluder() {
+        if (occluderMinX > occluderMaxX) { return; }
+        // Farthest depth of the pixel and its eight neighbors, UNCOVERED if one of them is
+        // not covered : the depth buffer keeps its value
+        const auto startY = std::max(occluderMinY, 1u);
+        const auto endY = std::min(occluderMaxY, height);
+        const auto startX = std::max(occluderMinX, OCCLUDER_BORDER_X);
+        const auto endX = std::min(occluderMaxX, width + OCCLUDER_BORDER_X - 1);
+        for (auto y = startY; y <= endY; y++) {
+            float* line = depth.data() + (y - 1) * width - OCCLUDER_BORDER_X;
+            for (auto x = startX; x <= endX; x += 4) {
+                auto farthest = float4{0.0f};
+                for (auto row = y - 1; row <= y + 1; row++) {
+                    float* neighbors = occluderDepth.data() + row * occluderStride + x;
+                    float4 left, center, right;
+                    load(left, neighbors - 1);
+                    load(center, neighbors);
+                    load(right, neighbors + 1);
+                    farthest = max(farthest, max(center, max(left, right)));
+                }
+                float4 current;
+                load(current, line + x);
+                store(min(current, farthest), line + x);
+            }
+        }
+        for (auto y = occluderMinY; y <= occluderMaxY; y++) {
+            float* line = occluderDepth.data() + y * occluderStride;
+            std::fill(line + occluderMinX, line + occluderMaxX + 1, UNCOVERED);
+        }
+        occluderMinX = occluderMinY = std::numeric_limits<uint32>::max();
+        occluderMaxX = occluderMaxY = 0;
+    }
+
+    void OcclusionRasterizer::end() {
+        for (auto ty = 0u; ty < tilesY; ty++) {
+            for (auto tx = 0u; tx < tilesX; tx++) {
+                auto farthest = float4{0.0f};
+                for (auto y = ty * TILE_HEIGHT; y < (ty + 1) * TILE_HEIGHT; y++) {
+                    float* line = depth.data() + y * width + tx * TILE_WIDTH;
+                    for (auto x = 0u; x < TILE_WIDTH; x += 4) {
+                        float4 values;
+                        load(values, line + x);
+                        farthest = max(farthest, values);
+                    }
+                }
+                tilesMaxDepth[ty * tilesX + tx] = std::max(
+                    std::max(static_cast<float>(farthest.x), static_cast<float>(farthest.y)),
+                    std::max(static_cast<float>(farthest.z), static_cast<float>(farthest.w)));
+            }
+        }
+    }
+
+    bool OcclusionRasterizer::isOccluded(const AABB& aabb) const {
+        auto ndcMin = float2{std::numeric_limits<float>::max()};
+        auto ndcMax = float2{std::numeric_limits<float>::lowest()};
+        auto nearestDepth = std::numeric_limits<float>::max();
+        for (auto i = 0; i < 8; i++) {
+            const auto corner = float4{
+                (i & 1) ? aabb.max.x : aabb.min.x,
+                (i & 2) ? aabb.max.y : aabb.min.y,
+                (i & 4) ? aabb.max.z : aabb.min.z,
+                1.0f };
+            const float4 clip = mul(corner, viewProjection);
+            const float w = clip.w;
+            // Crossing the camera plane : can't be projected
+            if (w <= 1e-5f) { return false; }
+            const float3 ndc = clip.xyz / w;
+            ndcMin = lysa::min(ndcMin, ndc.xy);
+            ndcMax = lysa::max(ndcMax, ndc.xy);
+            nearestDepth = std::min(nearestDepth, static_cast<float>(ndc.z));
+        }
+
+        // NDC to pixels, Y down
+        const float minX = (ndcMin.x * 0.5f + 0.5f) * width;
+        const float maxX = (ndcMax.x * 0.5f + 0.5f) * width;
+        const float minY = (0.5f - ndcMax.y * 0.5f) * height;
+        const float maxY = (0.5f - ndcMin.y * 0.5f) * height;
+        // Outside of the screen : let the frustum culling decide
+        if (maxX < 0.0f || maxY < 0.0f || minX >= width || minY >= height) { return false; }
+        const auto x0 = static_cast<uint32>(std::max(0.0f, minX));
+        const auto y0 = static_cast<uint32>(std::max(0.0f, minY));
+        const auto x1 = std::min(static_cast<uint32>(maxX), width - 1);
+        const auto y1 = std::min(static_cast<uint32>(maxY), height - 1);
+
+        // Tiles fully covered by the rectangle use the farthest depth of the tile,
+        // the others are tested pixel by pixel
+        for (auto ty = y0 / TILE_HEIGHT; ty <= y1 / TILE_HEIGHT; ty++) {
+            const auto tileY0 = ty * TILE_HEIGHT;
+            const auto tileY1 = tileY0 + TILE_HEIGHT - 1;
+            for (auto tx = x0 / TILE_WIDTH; tx <= x1 / TILE_WIDTH; tx++) {
+                if (tilesMaxDepth[ty * tilesX + tx] < nearestDepth) { continue; }
+                const auto tileX0 = tx * TILE_WIDTH;
+                const auto tileX1 = tileX0 + TILE_WIDTH - 1;
+                if (x0 <= tileX0 && tileX1 <= x1 && y0 <= tileY0 && tileY1 <= y1) { return false; }
+                for (auto y = std::max(y0, tileY0); y <= std::min(y1, tileY1); y++) {
+                    for (auto x = std::max(x0, tileX0); x <= std::min(x1, tileX1); x++) {
+                        if (depth[y * width + x] >= nearestDepth) { return false; }
+                    }
+                }
+            }
+        }
+        return true;
+    }
+
+}
@@ -0,0 +1,138 @@
+/*
+ * Copyright (c) 2025-present Henri Michelon
+ *
+ * This software is released under the MIT License.
+ * https://opensource.org/licenses/MIT
+*/
+export module lysa.occlusion_rasterizer;
+
+import lysa.aabb;
+import lysa.math;
+
+export namespace lysa {
+
+    /**
+     * CPU software occlusion culling.
+     *
+     * A small set of occluder meshes is rasterized into a low resolution depth buffer, four
+     * pixels at a time with SIMD instructions, then AABBs are tested against it. Both sides
+     * of the triangles are rasterized and the triangles crossing the camera plane are
+     * skipped. The depth buffer is split in tiles of TILE_WIDTH x TILE_HEIGHT pixels storing
+     * the farthest depth of their pixels, so most of the AABB tests read one value per tile.
+     *
+     * The results are conservative : the triangles of an occluder are rasterized at the pixel
+     * centers, with the farthest depth of the triangle over the pixel area, then the coverage
+     * of the whole occluder is eroded by one pixel. A pixel is written only when it and its
+     * eight neighbors are covered, with the farthest depth of the nine pixels, so the edges
+     * shared by two triangles do not leave holes and the silhouettes never grow. An AABB is
+     * occluded only if its nearest point is behind every pixel it touches. An occluder thinner
+     * than a pixel does not hide anything. Depths are normalized device coordinates (z/w),
+     * cleared to 1.0 (far plane).
+     *
+     * The rasterizer does not depend on the GPU and is not thread safe : one thread renders
+     * the occluders, then any number of threads can test AABBs.
+     */
+    class OcclusionRasterizer {
+    public:
+        /** Width of a tile in pixels, a multiple of the SIMD width. */
+        static constexpr uint32 TILE_WIDTH{8};
+        /** Height of a tile in pixels. */
+        static constexpr uint32 TILE_HEIGHT{4};
+
+        /**
+         * Counters of the occluders rasterized since the last call to begin().
+         */
+        struct Statistics {
+            /** Triangles rasterized. */
+            uint32 trianglesRasterized{0};
+            /** Triangles crossing the camera plane, outside the screen or degenerated. */
+            uint32 trianglesSkipped{0};
+        };
+
+        /**
+         * Creates the depth buffer.
+         * @param width Width in pixels, rounded up to a multiple of TILE_WIDTH
+         * @param height Height in pixels, rounded up to a multiple of TILE_HEIGHT
+         */
+        OcclusionRasterizer(uint32 width, uint32 height);
+
+        /**
+         * Clears the depth buffer and starts the rendering of the occluders.
+         * @param viewProjection View and projection matrix (clip-from-world)
+         */
+        void begin(const float4x4& viewProjection);
+
+        /**
+         * Rasterizes an occluder mesh.
+         * @param positions Local space vertices positions
+         * @param indices Triangles vertices indices, three per triangle
+         * @param transform Local to world transform of the occluder
+         */
+        void renderOccluder(
+            const std::vector<float3>& positions,
+            const std::vector<uint32>& indices,
+            const float4x4& transform);
+
+        /**
+         * Ends the rendering of the occluders and updates the tiles, must be called
+         * before testing AABBs.
+         */
+        void end();
+
+        /**
+         * Tests an AABB against the occluders.
+         * @param aabb World space box
+         * @return true if the box is fully hidden by the occluders
+         */
+        bool isOccluded(const AABB& aabb) const;
+
+        /**
+         * Returns the depth of a pixel.
+         * @param x Column of the pixel
+         * @param y Row of the pixel, from the top
+         */
+        float getDepth(const uint32 x, const uint32 y) const { return depth[y * width + x]; }
+
+        /** Returns the width of the depth buffer. */
+        auto getWidth() const { return width; }
+
+        /** Returns the height of the depth buffer. */
+        auto getHeight() const { return height; }
+
+        /** Returns the statistics of the occluders rendered since the last call to begin(). */
+        const auto& getStatistics() const { return statistics; }
+
+    private:
+        const uint32 width;
+        const uint32 height;
+        const uint32 tilesX;
+        const uint32 tilesY;
+        const uint32 occluderStride;
+        float4x4 viewProjection{float4x4::identity()};
+        std::vector<float> depth;
+        std::vector<float> tilesMaxDepth;
+        /* Screen space vertices of the current occluder : x, y in pixels, z in NDC, w unused. */
+        std::vector<float4> screenVertices;
+        /* Vertices of the current occluder crossing the camera plane. */
+        std::vector<bool> clippedVertices;
+        /* Depths of the current occluder at the pixel centers, UNCOVERED where not covered.
+           A border of OCCLUDER_BORDER_X columns and one row around the screen keeps the
+           coverage of the occluders crossing the screen edges. */
+        std::vector<float> occluderDepth;
+        /* Columns and rows of occluderDepth written by the current occluder. */
+        uint32 occluderMinX{std::numeric_limits<uint32>::max()};
+        uint32 occluderMaxX{0};
+        uint32 occluderMinY{std::numeric_limits<uint32>::max()};
+        uint32 occluderMaxY{0};
+        Statistics statistics;
+
+        static constexpr uint32 OCCLUDER_BORDER_X{4};
+        static constexpr float UNCOVERED{std::numeric_limits<float>::max()};
+
+        void rasterize(const float4& v0, const float4& v1, const float4& v2);
+
+        /* Writes the eroded coverage of the current occluder in the depth buffer and clears it. */
+        void mergeOccluder();
+    };
+
+}
@@ -0,0 +1,234 @@
+/*
+ * Copyright (c) 2025-present Henri Michelon
+ *
+ * This software is released under the MIT License.
+ * https://opensource.org/licenses/MIT
+*/
+module lysa.render_graph;
+
+import lysa.exception;
+
+namespace lysa {
+
+    uint32 RenderGraph::addAttachment(const Attachment& attachment) {
+        attachments.push_back(attachment);
+        compiled.reset();
+        return static_cast<uint32>(attachments.size() - 1);
+    }
+
+    uint32 RenderGraph::addPass(const std::string& name, const bool sideEffects) {
+        passes.push_back({name, sideEffects, {}});
+        compiled.reset();
+        return static_cast<uint32>(passes.size() - 1);
+    }
+
+    void RenderGraph::read(const uint32 pass, const uint32 attachment, const State state) {
+        access(pass, attachment, state, false);
+    }
+
+    void RenderGraph::write(const uint32 pass, const uint32 attachment, const State state) {
+        access(pass, attachment, state, true);
+    }
+
+    void RenderGraph::access(const uint32 pass, const uint32 attachment, const State state, const bool write) {
+        if (pass >= passes.size() || attachment >= attachments.size()) {
+            throw Exception("Render graph : unknown pass or attachment");
+        }
+        compiled.reset();
+        auto& accesses = passes[pass].accesses;
+        for (auto& access : accesses) {
+            if (access.attachment == attachment) {
+                if (access.state != state) {
+                    throw Exception("Render graph : ", attachments[attachment].name,
+                        " used in two states by ", passes[pass].name);
+                }
+                access.read = access.read || !write;
+                access.write = access.write || write;
+                return;
+            }
+        }
+        accesses.push_back({attachment, state, !write, write});
+    }
+
+    void RenderGraph::addOutput(const uint32 attachment) {
+        if (attachment >= attachments.size()) {
+            throw Exception("Render graph : unknown attachment");
+        }
+        outputs.push_back(attachment);
+        compiled.reset();
+    }
+
+    void RenderGraph::clear() {
+        attachments.clear();
+        passes.clear();
+        outputs.clear();
+        compiled.reset();
+    }
+
+    const RenderGraph::Compiled& RenderGraph::compile() {
+        if (compiled) {
+            return *compiled;
+        }
+        auto result = Compiled{};
+        const auto kept = cull();
+        auto keptPasses = std::vector<uint32>{};
+        for (auto i = 0; i < passes.size(); i++) {
+            if (kept[i]) {
+                keptPasses.push_back(i);
+                result.passes.push_back({static_cast<uint32>(i), {}});
+            } else {
+                result.report.culledPassesCount += 1;
+            }
+        }
+        alias(result, keptPasses);
+        computeBarriers(result);
+        compiled = std::move(result);
+        return *compiled;
+    }
+
+    std::vector<bool> RenderGraph::cull() const {
+        auto kept = std::vector<bool>(passes.size(), false);
+        auto needed = std::vector<bool>(attachments.size(), false);
+        for (const auto output : outputs) {
+            needed[output] = true;
+        }
+        // Backward : a pass is kept if a kept pass or the caller uses what it writes
+        for (auto i = static_cast<int>(passes.size()) - 1; i >= 0; i--) {
+            const auto& pass = passes[i];
+            auto keep = pass.sideEffects;
+            for (const auto& access : pass.accesses) {
+                if (access.write && (needed[access.attachment] || attachments[access.attachment].imported)) {
+                    keep = true;
+                }
+            }
+            if (!keep) {
+                continue;
+            }
+            kept[i] = true;
+            for (const auto& access : pass.accesses) {
+                if (access.read) {
+                    needed[access.attachment] = true;
+                }
+            }
+        }
+        return kept;
+    }
+
+    void RenderGraph::alias(Compiled& result, const std::vector<uint32>& keptPasses) const {
+        // Lifetimes of the transient attachments, in kept passes
+        auto firstUse = std::vector<uint32>(attachments.size(), INVALID_INDEX);
+        auto lastUse = std::vector<uint32>(attachments.size(), 0);
+        for (auto i = 0; i < keptPasses.size(); i++) {
+            const auto& pass = passes[keptPasses[i]];
+            for (const auto& access : pass.accesses) {
+                if (attachments[access.attachment].imported) {
+                    continue;
+                }
+                if (firstUse[access.attachment] == INVALID_INDEX) {
+                    if (access.read) {
+                        throw Exception("Render graph : ", attachments[access.attachment].name,
+                            " read by ", pass.name, " before being written");
+                    }
+                    firstUse[access.attachment] = i;
+                }
+                lastUse[access.attachment] = i;
+            }
+        }
+        for (const auto output : outputs) {
+            if (firstUse[output] != INVALID_INDEX) {
+                lastUse[output] = static_cast<uint32>(keptPasses.size());
+            }
+        }
+
+        auto transients = std::vector<uint32>{};
+        for (auto i = 0; i < attachments.size(); i++) {
+            if (firstUse[i] != INVALID_INDEX) {
+                transients.push_back(i);
+            }
+        }
+        std::ranges::stable_sort(transients, [&](const uint32 a, const uint32 b) {
+            return firstUse[a] < firstUse[b];
+        });
+
+        // First fit on the physical attachments with the same description freed before the first use
+        result.attachmentSlots.assign(attachments.size(), INVALID_INDEX);
+        auto slotsLastUse = std::vector<uint32>{};
+        for (const auto index : transients) {
+            const auto& attachment = attachments[index];
+            auto slot = INVALID_INDEX;
+            for (auto i = 0; i < result.slots.size(); i++) {
+                const auto& physical = attachments[result.slots[i]];
+                if (physical.format == attachment.format &&
+                    physical.msaa == attachment.msaa &&
+                    physical.width == attachment.width &&
+                    physical.height == attachment.height &&
+                    slotsLastUse[i] < firstUse[index]) {
+                    slot = i;
+                    break;
+                }
+            }
+            if (slot == INVALID_INDEX) {
+                slot = static_cast<uint32>(result.slots.size());
+                result.slots.push_back(index);
+                slotsLastUse.push_back(0);
+                result.report.aliasedSize += getSize(attachment);
+            }
+            result.attachmentSlots[index] = slot;
+            slotsLastUse[slot] = lastUse[index];
+            result.report.transientSize += getSize(attachment);
+        }
+        result.report.transientCount = static_cast<uint32>(transients.size());
+        result.report.physicalCount = static_cast<uint32>(result.slots.size());
+    }
+
+    void RenderGraph::computeBarriers(Compiled& result) const {
+        auto importedStates = std::vector<State>(attachments.size());
+        for (auto i = 0; i < attachments.size(); i++) {
+            importedStates[i] = attachments[i].initialState;
+        }
+        auto slotsStates = std::vector<std::optional<State>>(result.slots.size());
+        // Position of the first barrier of each physical attachment, patched at the end
+        auto slotsFirstBarriers = std::vector<std::pair<uint32, uint32>>(result.slots.size());
+
+        for (auto i = 0; i < result.passes.size(); i++) {
+            auto& compiledPass = result.passes[i];
+            for (const auto& access : passes[compiledPass.pass].accesses) {
+                const auto slot = result.attachmentSlots[access.attachment];
+                if (slot == INVALID_INDEX) {
+                    auto& state = importedStates[access.attachment];
+                    if (state != access.state) {
+                        compiledPass.barriers.push_back({access.attachment, state, access.state});
+                        state = access.state;
+                    }
+                } else if (!slotsStates[slot].has_value()) {
+                    slotsFirstBarriers[slot] = {i, static_cast<uint32>(compiledPass.barriers.size())};
+                    compiledPass.barriers.push_back({access.attachment, State::UNDEFINED, access.state, true});
+                    slotsStates[slot] = access.state;
+                } else if (*slotsStates[slot] != access.state) {
+                    compiledPass.barriers.push_back({access.attachment, *slotsStates[slot], access.state});
+                    slotsStates[slot] = access.state;
+                }
+            }
+        }
+
+        for (const auto output : outputs) {
+            const auto slot = result.attachmentSlots[output];
+            if (slot != INVALID_INDEX && *slotsStates[slot] != attachments[output].finalState) {
+                result.finalBarriers.push_back({output, *slotsStates[slot], attachments[output].finalState});
+                slotsStates[slot] = attachments[output].finalState;
+            }
+        }
+        for (auto i = 0; i < attachments.size(); i++) {
+            if (attachments[i].imported && importedStates[i] != attachments[i].finalState) {
+                result.finalBarriers.push_back({static_cast<uint32>(i), importedStates[i], attachments[i].finalState});
+            }
+        }
+
+        // The next frame starts from the states of the end of the frame
+        for (auto slot = 0; slot < result.slots.size(); slot++) {
+            const auto [pass, barrier] = slotsFirstBarriers[slot];
+            result.passes[pass].barriers[barrier].before = *slotsStates[slot];
+        }
+    }
+
+}
@@ -0,0 +1,205 @@
+/*
+ * Copyright (c) 2025-present Henri Michelon
+ *
+ * This software is released under the MIT License.
+ * https://opensource.org/licenses/MIT
+*/
+export module lysa.render_graph;
+
+import lysa.math;
+
+export namespace lysa {
+
+    /**
+     * Frame render graph compiler.
+     *
+     * The passes are declared in their execution order with the attachments they read and
+     * write and the state each attachment must be in during the pass. The compilation :
+     *  - culls the passes whose writes are never read by a kept pass nor are outputs,
+     *  - computes the lifetime of the transient attachments, from their first to their last use,
+     *  - aliases the transient attachments with the same description and non-overlapping
+     *    lifetimes on the same physical attachment,
+     *  - computes the state transitions before each pass and at the end of the frame.
+     *
+     * The compiled graph is kept until the declaration changes. The graph does not know the
+     * GPU API : the caller allocates one render target per physical attachment and maps the
+     * states to its resource states.
+     *
+     * The states are tracked per physical attachment across the frames : the first barrier of
+     * a physical attachment in a frame starts from the state it was left in at the end of the
+     * previous frame (see Barrier::first), the transient attachments do not go back to the
+     * UNDEFINED state after their last use.
+     */
+    class RenderGraph {
+    public:
+        /** State of an attachment during a pass. */
+        enum class State : uint8 {
+            UNDEFINED,
+            RENDER_TARGET_COLOR,
+            RENDER_TARGET_DEPTH,
+            RENDER_TARGET_DEPTH_STENCIL,
+            SHADER_READ,
+            COPY_SRC,
+        };
+
+        /**
+         * Description of an attachment.
+         */
+        struct Attachment {
+            /** Debug name. */
+            std::string name;
+            /** Pixel format identifier, opaque to the graph. */
+            uint32 format{0};
+            /** Multisampling identifier, opaque to the graph. */
+            uint32 msaa{0};
+            uint32 width{0};
+            uint32 height{0};
+            /** Size of a pixel in bytes, for the memory report. */
+            uint32 pixelSize{0};
+            /** Owned by the caller, never aliased nor culled. */
+            bool imported{false};
+            /** State of an imported attachment before the first pass. */
+            State initialState{State::UNDEFINED};
+            /** State of an imported attachment or of an output after the last pass. */
+            State finalState{State::UNDEFINED};
+        };
+
+        /**
+         * State transition of an attachment.
+         */
+        struct Barrier {
+            /** Index of the attachment. */
+            uint32 attachment;
+            State before;
+            State after;
+            /**
+             * First use of a physical attachment in the frame : `before` is its state at the end
+             * of the frame. The caller replaces it by the actual state of a newly allocated or
+             * reused render target, and skips the barrier when both states are equal.
+             */
+            bool first{false};
+        };
+
+        /**
+         * A kept pass and the barriers to record before it.
+         */
+        struct CompiledPass {
+            /** Index of the pass. */
+            uint32 pass;
+            std::vector<Barrier> barriers;
+        };
+
+        /**
+         * Memory used by the transient attachments, for one frame.
+         */
+        struct MemoryReport {
+            /** Number of used transient attachments. */
+            uint32 transientCount{0};
+            /** Number of physical attachments after aliasing. */
+            uint32 physicalCount{0};
+            /** Number of culled passes. */
+            uint32 culledPassesCount{0};
+            /** Bytes of the transient attachments without aliasing. */
+            size_t transientSize{0};
+            /** Bytes of the physical attachments. */
+            size_t aliasedSize{0};
+        };
+
+        /**
+         * Result of the compilation.
+         */
+        struct Compiled {
+            /** Kept passes, in execution order. */
+            std::vector<CompiledPass> passes;
+            /** Barriers to record after the last pass. */
+            std::vector<Barrier> finalBarriers;
+            /** Physical attachment of each attachment, INVALID_INDEX for the imported and unused ones. */
+            std::vector<uint32> attachmentSlots;
+            /** Attachment describing each physical attachment, the first one aliased on it. */
+            std::vector<uint32> slots;
+            MemoryReport report;
+        };
+
+        static constexpr auto INVALID_INDEX{std::numeric_limits<uint32>::max()};
+
+        /**
+         * Adds an attachment.
+         * @return Index of the attachment
+         */
+        uint32 addAttachment(const Attachment& attachment);
+
+        /**
+         * Adds a pass after the previous ones.
+         * @param name Debug name
+         * @param sideEffects Never culled, for the passes writing outside the graph
+         * @return Index of the pass
+         */
+        uint32 addPass(const std::string& name, bool sideEffects = false);
+
+        /**
+         * Declares an attachment read by a pass.
+         */
+        void read(uint32 pass, uint32 attachment, State state = State::SHADER_READ);
+
+        /**
+         * Declares an attachment written by a pass.
+         */
+        void write(uint32 pass, uint32 attachment, State state = State::RENDER_TARGET_COLOR);
+
+        /**
+         * Declares an attachment used after the last pass. It keeps the passes writing it and
+         * is left in its final state.
+         */
+        void addOutput(uint32 attachment);
+
+        /**
+         * Compiles the graph, or returns the last compiled graph if the declaration did not change.
+         */
+        const Compiled& compile();
+
+        /** Returns true if the graph is compiled and the declaration did not change since. */
+        bool isCompiled() const { return compiled.has_value(); }
+
+        /** Removes all the passes and attachments. */
+        void clear();
+
+        /** Returns the attachments. */
+        const auto& getAttachments() const { return attachments; }
+
+        /** Returns the name of a pass. */
+        const auto& getPassName(const uint32 pass) const { return passes[pass].name; }
+
+        /** Returns the size in bytes of an attachment. */
+        static size_t getSize(const Attachment& attachment) {
+            return static_cast<size_t>(attachment.width) * attachment.height * attachment.pixelSize;
+        }
+
+    private:
+        struct Access {
+            uint32 attachment;
+            State state;
+            bool read;
+            bool write;
+        };
+
+        struct Pass {
+            std::string name;
+            bool sideEffects;
+            std::vector<Access> accesses;
+        };
+
+        std::vector<Attachment> attachments;
+        std::vector<Pass> passes;
+        std::vector<uint32> outputs;
+        std::optional<Compiled> compiled;
+
+        void access(uint32 pass, uint32 attachment, State state, bool write);
+
+        std::vector<bool> cull() const;
+
+        void alias(Compiled& result, const std::vector<uint32>& keptPasses) const;
+
+        void computeBarriers(Compiled& result) const;
+    };
+
+}
@@ -0,0 +1,140 @@
+/*
+ * Copyright (c) 2025-present Henri Michelon
+ *
+ * This software is released under the MIT License.
+ * https://opensource.org/licenses/MIT
+*/
+module lysa.shadow_atlas_allocator;
+
+import lysa.exception;
+
+namespace lysa {
+
+    ShadowAtlasAllocator::ShadowAtlasAllocator(const uint32 size, const uint32 minTileSize) :
+        size{std::bit_ceil(std::max(1u, size))},
+        minTileSize{std::min(std::bit_ceil(std::max(1u, minTileSize)), this->size)},
+        levelsCount{static_cast<uint32>(std::countr_zero(this->size) - std::countr_zero(this->minTileSize)) + 1} {
+        freeTiles.resize(levelsCount);
+        clear();
+    }
+
+    void ShadowAtlasAllocator::clear() {
+        for (auto& tiles : freeTiles) {
+            tiles.clear();
+        }
+        freeTiles[0].insert(0);
+        freeArea = static_cast<uint64>(size) * size;
+    }
+
+    uint32 ShadowAtlasAllocator::getTileSize(const uint32 size) const {
+        return std::clamp(std::bit_ceil(std::max(1u, size)), minTileSize, this->size);
+    }
+
+    uint32 ShadowAtlasAllocator::getLevel(const uint32 tileSize) const {
+        return std::countr_zero(size) - std::countr_zero(tileSize);
+    }
+
+    ShadowAtlasAllocator::Tile ShadowAtlasAllocator::allocate(const uint32 size) {
+        const auto tileSize = getTileSize(size);
+        const auto level = getLevel(tileSize);
+        // Smallest free tile large enough
+        auto parentLevel = static_cast<int32>(level);
+        while (parentLevel >= 0 && freeTiles[parentLevel].empty()) {
+            parentLevel -= 1;
+        }
+        if (parentLevel < 0) { return {}; }
+
+        auto position = *freeTiles[parentLevel].begin();
+        freeTiles[parentLevel].erase(freeTiles[parentLevel].begin());
+        // Split it down to the requested level, keeping the top left child
+        for (auto l = static_cast<uint32>(parentLevel); l < level; l++) {
+            const auto tilesPerRow = 1u << l;
+            const auto x = (position % tilesPerRow) * 2;
+            const auto y = (position / tilesPerRow) * 2;
+            const auto childrenPerRow = tilesPerRow * 2;
+            freeTiles[l + 1].insert(y * childrenPerRow + x + 1);
+            freeTiles[l + 1].insert((y + 1) * childrenPerRow + x);
+            freeTiles[l + 1].insert((y + 1) * childrenPerRow + x + 1);
+            position = y * childrenPerRow + x;
+        }
+        freeArea -= static_cast<uint64>(tileSize) * tileSize;
+        const auto tilesPerRow = 1u << level;
+        return {
+            .x = (position % tilesPerRow) * tileSize,
+            .y = (position / tilesPerRow) * tileSize,
+            .size = tileSize,
+        };
+    }
+
+    void ShadowAtlasAllocator::free(const Tile& tile) {
+        if (tile.size == 0) { return; }
+        assert([&]{ return tile.size == getTileSize(tile.size) && tile.x % tile.size == 0 && tile.y % tile.size == 0; },
+            "Invalid shadow atlas tile");
+        freeArea += static_cast<uint64>(tile.size) * tile.size;
+        auto level = getLevel(tile.size);
+        auto x = tile.x / tile.size;
+        auto y = tile.y / tile.size;
+        // Merge the four siblings while they are all free
+        while (level > 0) {
+            const auto tilesPerRow = 1u << level;
+            const auto x0 = x & ~1u;
+            const auto y0 = y & ~1u;
+            auto& tiles = freeTiles[level];
+            auto siblingsFree = true;
+            for (auto i = 0u; i < 4 && siblingsFree; i++) {
+                const auto sx = x0 + (i & 1);
+                const auto sy = y0 + (i >> 1);
+                if (sx != x || sy != y) {
+                    siblingsFree = tiles.contains(sy * tilesPerRow + sx);
+                }
+            }
+            if (!siblingsFree) { break; }
+            for (auto i = 0u; i < 4; i++) {
+                tiles.erase((y0 + (i >> 1)) * tilesPerRow + x0 + (i & 1));
+            }
+            x = x0 / 2;
+            y = y0 / 2;
+            level -= 1;
+        }
+        assert([&]{ return !freeTiles[level].contains(y * (1u << level) + x); }, "Shadow atlas tile freed twice");
+        freeTiles[level].insert(y * (1u << level) + x);
+    }
+
+    void ShadowAtlasAllocator::fit(std::vector<Request>& requests) const {
+        const auto capacity = static_cast<uint64>(size) * size;
+        auto area = uint64{0};
+        for (auto& request : requests) {
+            request.size = getTileSize(request.size);
+            area += static_cast<uint64>(request.size) * request.size;
+        }
+        while (area > capacity) {
+            // Least important request above the minimum size, the largest one on equal importance
+            auto reduced = -1;
+            for (auto i = 0; i < requests.size(); i++) {
+                const auto& request = requests[i];
+                if (request.size <= minTileSize) { continue; }
+                if (reduced == -1 ||
+                    request.priority < requests[reduced].priority ||
+                    (request.priority == requests[reduced].priority && request.size >= requests[reduced].size)) {
+                    reduced = i;
+                }
+            }
+            if (reduced == -1) { break; }
+            const auto tileSize = requests[reduced].size;
+            area -= static_cast<uint64>(tileSize) * tileSize * 3 / 4;
+            requests[reduced].size = tileSize / 2;
+        }
+        // Not enough room even for the smallest tiles
+        while (area > capacity) {
+            auto dropped = -1;
+            for (auto i = 0; i < requests.size(); i++) {
+                if (requests[i].size != 0 && (dropped == -1 || requests[i].priority <= requests[dropped].priority)) {
+                    dropped = i;
+                }
+            }
+            area -= static_cast<uint64>(requests[dropped].size) * requests[dropped].size;
+            requests[dropped].size = 0;
+        }
+    }
+
+}
@@ -0,0 +1,112 @@
+/*
+ * Copyright (c) 2025-present Henri Michelon
+ *
+ * This software is released under the MIT License.
+ * https://opensource.org/licenses/MIT
+*/
+export module lysa.shadow_atlas_allocator;
+
+import lysa.math;
+
+export namespace lysa {
+
+    /**
+     * Quadtree allocator of the square tiles of a shadow atlas.
+     *
+     * The atlas is a square of power of two size. A free tile is split in four tiles of half
+     * its size until a tile of the requested size is available, and four free sibling tiles
+     * are merged back when freed. Tiles are power of two squares between the minimum tile
+     * size and the atlas size, the smallest free position is always used first.
+     *
+     * Power of two squares allocated by decreasing size in an empty atlas never fail while
+     * their total area fits in the atlas : fit() uses this to reduce a list of requests to
+     * the memory budget, before any allocation.
+     *
+     * The allocator does not depend on the GPU.
+     */
+    class ShadowAtlasAllocator {
+    public:
+        /**
+         * Position and size of a tile in the atlas, in texels. A size of 0 is no tile.
+         */
+        struct Tile {
+            uint32 x{0};
+            uint32 y{0};
+            uint32 size{0};
+
+            friend bool operator==(const Tile&, const Tile&) = default;
+        };
+
+        /**
+         * Tile wanted for a shadow map.
+         */
+        struct Request {
+            /** Wanted size of the tile in texels */
+            uint32 size{0};
+            /** Importance of the shadow map, the less important lose resolution first */
+            float priority{0.0f};
+        };
+
+        /**
+         * Creates an empty atlas.
+         * @param size Size of the atlas in texels, rounded up to a power of two
+         * @param minTileSize Size of the smallest tiles in texels, rounded up to a power of two
+         */
+        ShadowAtlasAllocator(uint32 size, uint32 minTileSize);
+
+        /**
+         * Allocates a tile.
+         * @param size Size of the tile in texels, rounded up to a power of two and to the minimum tile size
+         * @return The tile, or a tile of size 0 if the atlas has no free tile of this size
+         */
+        Tile allocate(uint32 size);
+
+        /**
+         * Releases a tile returned by allocate().
+         * @param tile The tile, ignored if its size is 0
+         */
+        void free(const Tile& tile);
+
+        /**
+         * Releases all the tiles.
+         */
+        void clear();
+
+        /**
+         * Reduces the sizes of requests until their total area fits in the atlas.
+         *
+         * The sizes are first rounded up to a power of two between the minimum tile size and
+         * the atlas size. While the requests do not fit, the largest tile of the least
+         * important requests is halved. When all of them are at the minimum size the least
+         * important requests are dropped (size set to 0), the last one first.
+         * @param requests Requests to update
+         */
+        void fit(std::vector<Request>& requests) const;
+
+        /**
+         * Rounds a tile size up to a power of two between the minimum tile size and the atlas size.
+         */
+        uint32 getTileSize(uint32 size) const;
+
+        /** Returns the size of the atlas in texels. */
+        auto getSize() const { return size; }
+
+        /** Returns the size of the smallest tiles in texels. */
+        auto getMinTileSize() const { return minTileSize; }
+
+        /** Returns the number of free texels. */
+        auto getFreeArea() const { return freeArea; }
+
+    private:
+        const uint32 size;
+        const uint32 minTileSize;
+        // Number of levels of the tree, the level 0 is the whole atlas
+        const uint32 levelsCount;
+        // Free tiles of each level, by position : y * tiles per row + x, in tiles of the level
+        std::vector<std::set<uint32>> freeTiles;
+        uint64 freeArea{0};
+
+        uint32 getLevel(uint32 tileSize) const;
+    };
+
+}
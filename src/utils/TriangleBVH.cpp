@@ -0,0 +1,260 @@
+/*
+ * Copyright (c) 2025-present Henri Michelon
+ *
+ * This software is released under the MIT License.
+ * https://opensource.org/licenses/MIT
+*/
+module lysa.triangle_bvh;
+
+namespace lysa {
+
+    TriangleBVH::TriangleBVH(
+        const std::vector<float3>& positions,
+        const std::vector<uint32>& indices,
+        const std::vector<std::pair<uint32, uint32>>& surfaces) {
+        const auto trianglesCount = static_cast<uint32>(indices.size() / 3);
+        triangleSurfaces.resize(trianglesCount, 0);
+        for (auto surfaceIndex = 0; surfaceIndex < surfaces.size(); surfaceIndex++) {
+            const auto& [firstIndex, indexCount] = surfaces[surfaceIndex];
+            const auto last = std::min((firstIndex + indexCount) / 3, trianglesCount);
+            for (auto triangle = firstIndex / 3; triangle < last; triangle++) {
+                triangleSurfaces[triangle] = surfaceIndex;
+            }
+        }
+
+        auto triangles = std::vector<BuildTriangle>(trianglesCount);
+        for (auto i = 0; i < trianglesCount; i++) {
+            const auto& v0 = positions[indices[i * 3 + 0]];
+            const auto& v1 = positions[indices[i * 3 + 1]];
+            const auto& v2 = positions[indices[i * 3 + 2]];
+            triangles[i].aabb = AABB{lysa::min(v0, lysa::min(v1, v2)), lysa::max(v0, lysa::max(v1, v2))};
+            triangles[i].center = triangles[i].aabb.getCenter();
+            triangles[i].index = i;
+        }
+
+        if (trianglesCount == 0) {
+            // Empty leaf, never hit
+            nodes.push_back({ .aabb = {}, .index = 0, .leaf = true });
+            packets.push_back({});
+            return;
+        }
+        nodes.reserve(2 * (trianglesCount / TRIANGLES_PER_LEAF + 1));
+        packets.reserve(trianglesCount / TRIANGLES_PER_LEAF + 1);
+        build(positions, indices, triangles.data(), trianglesCount, 0);
+    }
+
+    void TriangleBVH::build(
+        const std::vector<float3>& positions,
+        const std::vector<uint32>& indices,
+        BuildTriangle* triangles,
+        const uint32 count,
+        const int depth) {
+        const auto nodeIndex = static_cast<uint32>(nodes.size());
+        nodes.push_back({});
+        auto aabb = triangles[0].aabb;
+        auto centersBounds = AABB{triangles[0].center, triangles[0].center};
+        for (auto i = 1; i < count; i++) {
+            aabb = aabb.merge(triangles[i].aabb);
+            centersBounds = AABB{lysa::min(centersBounds.min, triangles[i].center), lysa::max(centersBounds.max, triangles[i].center)};
+        }
+        nodes[nodeIndex].aabb = aabb;
+
+        if (count <= TRIANGLES_PER_LEAF) {
+            auto packet = Packet{};
+            float v0x[4]{}, v0y[4]{}, v0z[4]{};
+            float e1x[4]{}, e1y[4]{}, e1z[4]{};
+            float e2x[4]{}, e2y[4]{}, e2z[4]{};
+            for (auto i = 0; i < count; i++) {
+                const auto index = triangles[i].index;
+                const auto& v0 = positions[indices[index * 3 + 0]];
+                const float3 e1 = positions[indices[index * 3 + 1]] - v0;
+                const float3 e2 = positions[indices[index * 3 + 2]] - v0;
+                v0x[i] = v0.x; v0y[i] = v0.y; v0z[i] = v0.z;
+                e1x[i] = e1.x; e1y[i] = e1.y; e1z[i] = e1.z;
+                e2x[i] = e2.x; e2y[i] = e2.y; e2z[i] = e2.z;
+                packet.triangles[i] = index;
+            }
+            // Unused lanes are degenerated triangles, rejected by the determinant test
+            packet.v0x = float4{v0x[0], v0x[1], v0x[2], v0x[3]};
+            packet.v0y = float4{v0y[0], v0y[1], v0y[2], v0y[3]};
+            packet.v0z = float4{v0z[0], v0z[1], v0z[2], v0z[3]};
+            packet.e1x = float4{e1x[0], e1x[1], e1x[2], e1x[3]};
+            packet.e1y = float4{e1y[0], e1y[1], e1y[2], e1y[3]};
+            packet.e1z = float4{e1z[0], e1z[1], e1z[2], e1z[3]};
+            packet.e2x = float4{e2x[0], e2x[1], e2x[2], e2x[3]};
+            packet.e2y = float4{e2y[0], e2y[1], e2y[2], e2y[3]};
+            packet.e2z = float4{e2z[0], e2z[1], e2z[2], e2z[3]};
+            packet.count = count;
+            nodes[nodeIndex].leaf = true;
+            nodes[nodeIndex].index = static_cast<uint32>(packets.size());
+            packets.push_back(packet);
+            return;
+        }
+
+        const float3 extent = centersBounds.max - centersBounds.min;
+        auto bestAxis = -1;
+        auto bestSplit = 0;
+        auto bestCost = std::numeric_limits<float>::max();
+        if (depth < MAX_BUILD_DEPTH) {
+            for (auto axis = 0; axis < 3; axis++) {
+                if (extent.f32[axis] <= 0.0f) { continue; }
+                const auto scale = BINS_COUNT / extent.f32[axis];
+                struct Bin {
+                    AABB aabb;
+                    uint32 count{0};
+                } bins[BINS_COUNT];
+                for (auto i = 0; i < count; i++) {
+                    const auto bin = std::min(
+                        BINS_COUNT - 1,
+                        static_cast<int>((triangles[i].center.f32[axis] - centersBounds.min.f32[axis]) * scale));
+                    bins[bin].aabb = bins[bin].count == 0 ? triangles[i].aabb : bins[bin].aabb.merge(triangles[i].aabb);
+                    bins[bin].count += 1;
+                }
+                float rightCosts[BINS_COUNT];
+                auto rightAABB = AABB{};
+                auto rightCount = 0u;
+                for (auto i = BINS_COUNT - 1; i > 0; i--) {
+                    if (bins[i].count > 0) {
+                        rightAABB = rightCount == 0 ? bins[i].aabb : rightAABB.merge(bins[i].aabb);
+                        rightCount += bins[i].count;
+                    }
+                    rightCosts[i] = rightCount == 0 ? 0.0f : rightAABB.getSurfaceArea() * rightCount;
+                }
+                auto leftAABB = AABB{};
+                auto leftCount = 0u;
+                for (auto i = 0; i < BINS_COUNT - 1; i++) {
+                    if (bins[i].count > 0) {
+                        leftAABB = leftCount == 0 ? bins[i].aabb : leftAABB.merge(bins[i].aabb);
+                        leftCount += bins[i].count;
+                    }
+                    if (leftCount == 0 || leftCount == count) { continue; }
+                    const auto cost = leftAABB.getSurfaceArea() * leftCount + rightCosts[i + 1];
+                    if (cost < bestCost) {
+                        bestCost = cost;
+                        bestAxis = axis;
+                        bestSplit = i + 1;
+                    }
+                }
+            }
+        }
+
+        auto middle = count / 2;
+        if (bestAxis != -1) {
+            const auto scale = BINS_COUNT / extent.f32[bestAxis];
+            const auto minimum = centersBounds.min.f32[bestAxis];
+            const auto* pivot = std::partition(triangles, triangles + count, [&](const BuildTriangle& triangle) {
+                const auto bin = std::min(
+                    BINS_COUNT - 1,
+                    static_cast<int>((triangle.center.f32[bestAxis] - minimum) * scale));
+                return bin < bestSplit;
+            });
+            middle = static_cast<uint32>(pivot - triangles);
+        } else {
+            // All the centers are at the same place or the tree is too deep : median split
+            const auto axis = extent.f32[0] > extent.f32[1] ?
+                (extent.f32[0] > extent.f32[2] ? 0 : 2) :
+                (extent.f32[1] > extent.f32[2] ? 1 : 2);
+            std::nth_element(triangles, triangles + middle, triangles + count,
+                [&](const BuildTriangle& a, const BuildTriangle& b) {
+                return a.center.f32[axis] < b.center.f32[axis];
+            });
+        }
+
+        build(positions, indices, triangles, middle, depth + 1);
+        nodes[nodeIndex].index = static_cast<uint32>(nodes.size());
+        build(positions, indices, triangles + middle, count - middle, depth + 1);
+    }
+
+    std::optional<TriangleHit> TriangleBVH::raycast(const Ray& ray, const float maxDistance) const {
+        auto hit = std::optional<TriangleHit>{};
+        auto currentMax = maxDistance;
+        const float3 invDirection = 1.0f / ray.direction;
+        float distance;
+        if (!BVH::intersects(ray.origin, invDirection, nodes[0].aabb, currentMax, distance)) {
+            return hit;
+        }
+        uint32 stack[MAX_BUILD_DEPTH * 2];
+        float stackDistances[MAX_BUILD_DEPTH * 2];
+        auto stackSize = 0;
+        stack[stackSize] = 0;
+        stackDistances[stackSize++] = distance;
+        while (stackSize > 0) {
+            stackSize -= 1;
+            if (stackDistances[stackSize] > currentMax) { continue; }
+            const auto index = stack[stackSize];
+            const auto& node = nodes[index];
+            if (node.leaf) {
+                intersects(packets[node.index], ray, currentMax, hit);
+                continue;
+            }
+            const auto child1 = index + 1;
+            const auto child2 = node.index;
+            float distance1, distance2;
+            const auto hit1 = BVH::intersects(ray.origin, invDirection, nodes[child1].aabb, currentMax, distance1);
+            const auto hit2 = BVH::intersects(ray.origin, invDirection, nodes[child2].aabb, currentMax, distance2);
+            // Push the farthest first to visit the nearest first
+            if (hit1 && hit2) {
+                const auto nearFirst = distance1 < distance2;
+                stack[stackSize] = nearFirst ? child2 : child1;
+                stackDistances[stackSize++] = nearFirst ? distance2 : distance1;
+                stack[stackSize] = nearFirst ? child1 : child2;
+                stackDistances[stackSize++] = nearFirst ? distance1 : distance2;
+            } else if (hit1) {
+                stack[stackSize] = child1;
+                stackDistances[stackSize++] = distance1;
+            } else if (hit2) {
+                stack[stackSize] = child2;
+                stackDistances[stackSize++] = distance2;
+            }
+        }
+        return hit;
+    }
+
+    // Möller–Trumbore, four triangles at a time
+    void TriangleBVH::intersects(
+        const Packet& packet,
+        const Ray& ray,
+        float& maxDistance,
+        std::optional<TriangleHit>& hit) const {
+        constexpr auto EPSILON = 1e-8f;
+        const auto dx = float4(ray.direction.x);
+        const auto dy = float4(ray.direction.y);
+        const auto dz = float4(ray.direction.z);
+        // p = cross(direction, e2)
+        const float4 px = dy * packet.e2z - dz * packet.e2y;
+        const float4 py = dz * packet.e2x - dx * packet.e2z;
+        const float4 pz = dx * packet.e2y - dy * packet.e2x;
+        const float4 determinant = packet.e1x * px + packet.e1y * py + packet.e1z * pz;
+        const float4 invDeterminant = 1.0f / determinant;
+        // s = origin - v0
+        const float4 sx = float4(ray.origin.x) - packet.v0x;
+        const float4 sy = float4(ray.origin.y) - packet.v0y;
+        const float4 sz = float4(ray.origin.z) - packet.v0z;
+        const float4 u = (sx * px + sy * py + sz * pz) * invDeterminant;
+        // q = cross(s, e1)
+        const float4 qx = sy * packet.e1z - sz * packet.e1y;
+        const float4 qy = sz * packet.e1x - sx * packet.e1z;
+        const float4 qz = sx * packet.e1y - sy * packet.e1x;
+        const float4 v = (dx * qx + dy * qy + dz * qz) * invDeterminant;
+        const float4 t = (packet.e2x * qx + packet.e2y * qy + packet.e2z * qz) * invDeterminant;
+        // Comparisons give 1.0 or 0.0 per lane
+        const float4 mask =
+            (abs(determinant) > EPSILON) *
+            (u >= 0.0f) * (v >= 0.0f) * ((u + v) <= 1.0f) *
+            (t >= 0.0f) * (t < maxDistance);
+        if (!any(mask)) { return; }
+        for (auto lane = 0; lane < packet.count; lane++) {
+            if (mask.f32[lane] != 0.0f && t.f32[lane] < maxDistance) {
+                maxDistance = t.f32[lane];
+                const auto triangle = packet.triangles[lane];
+                hit = TriangleHit{
+                    .distance = maxDistance,
+                    .surfaceIndex = triangleSurfaces[triangle],
+                    .triangleIndex = triangle,
+                    .barycentrics = float2{u.f32[lane], v.f32[lane]},
+                };
+            }
+        }
+    }
+
+}
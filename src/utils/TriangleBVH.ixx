@@ -0,0 +1,127 @@
+/*
+ * Copyright (c) 2025-present Henri Michelon
+ *
+ * This software is released under the MIT License.
+ * https://opensource.org/licenses/MIT
+*/
+export module lysa.triangle_bvh;
+
+import lysa.aabb;
+import lysa.bvh;
+import lysa.math;
+
+export namespace lysa {
+
+    /**
+     * Result of a ray cast against the triangles of a mesh.
+     */
+    struct TriangleHit {
+        /** Distance along the ray, in units of the ray direction length. */
+        float distance{0.0f};
+        /** Index of the mesh surface containing the triangle. */
+        uint32 surfaceIndex{0};
+        /** Index of the triangle in the mesh, the vertices indices are at 3 * triangleIndex in the indices. */
+        uint32 triangleIndex{0};
+        /**
+         * Barycentric coordinates (u, v) of the hit point, the weights of the second and third
+         * vertices of the triangle. The weight of the first vertex is 1 - u - v.
+         */
+        float2 barycentrics{};
+    };
+
+    /**
+     * Static bounding volume hierarchy of the triangles of a mesh, for precise ray casting.
+     *
+     * The tree is built once using a binned SAH build from the CPU copy of the vertices and
+     * indices. Leaves contain up to four triangles stored in a structure-of-arrays layout
+     * tested in one pass with SIMD instructions (Möller–Trumbore). The tree does not keep
+     * references to the mesh data and must be rebuilt if the vertices or indices change.
+     */
+    class TriangleBVH {
+    public:
+        /** Maximum number of triangles per leaf, the SIMD width of the ray/triangle test. */
+        static constexpr uint32 TRIANGLES_PER_LEAF{4};
+
+        /**
+         * Builds the tree.
+         * @param positions Vertices positions
+         * @param indices Triangles vertices indices, three per triangle
+         * @param surfaces First index and number of indices for each surface
+         */
+        TriangleBVH(
+            const std::vector<float3>& positions,
+            const std::vector<uint32>& indices,
+            const std::vector<std::pair<uint32, uint32>>& surfaces);
+
+        /**
+         * Returns the closest triangle hit by a ray. The ray direction does not need to be
+         * normalized, the hit distance is expressed in units of the direction length.
+         * @param ray Ray in the mesh local space
+         * @param maxDistance Maximum distance along the ray
+         */
+        std::optional<TriangleHit> raycast(const Ray& ray, float maxDistance = std::numeric_limits<float>::max()) const;
+
+        /**
+         * Returns the number of triangles in the tree.
+         */
+        auto getTrianglesCount() const { return static_cast<uint32>(triangleSurfaces.size()); }
+
+        /**
+         * Returns the number of nodes in the tree.
+         */
+        auto getNodesCount() const { return static_cast<uint32>(nodes.size()); }
+
+        /**
+         * Returns the local space AABB of the triangles.
+         */
+        const AABB& getAABB() const { return nodes.front().aabb; }
+
+    private:
+        /* Number of bins per axis used by the SAH build. */
+        static constexpr int BINS_COUNT{16};
+        /* Maximum depth of the SAH build before falling back to median splits. */
+        static constexpr int MAX_BUILD_DEPTH{64};
+
+        /*
+         * Node of the flattened tree. The first child of an internal node is stored right
+         * after its parent, the second child index is in `index`. For a leaf, `index` is
+         * the index of the triangles packet.
+         */
+        struct Node {
+            AABB aabb;
+            uint32 index{0};
+            bool leaf{false};
+        };
+
+        /* Up to four triangles in SoA layout : first vertex and two edges. */
+        struct Packet {
+            float4 v0x, v0y, v0z;
+            float4 e1x, e1y, e1z;
+            float4 e2x, e2y, e2z;
+            uint32 triangles[TRIANGLES_PER_LEAF];
+            uint32 count{0};
+        };
+
+        /* Triangle data used during the build only. */
+        struct BuildTriangle {
+            AABB aabb;
+            float3 center;
+            uint32 index;
+        };
+
+        std::vector<Node> nodes;
+        std::vector<Packet> packets;
+        /* Surface index of each triangle. */
+        std::vector<uint32> triangleSurfaces;
+
+        void build(
+            const std::vector<float3>& positions,
+            const std::vector<uint32>& indices,
+            BuildTriangle* triangles,
+            uint32 count,
+            int depth);
+
+        void intersects(const Packet& packet, const Ray& ray, float& maxDistance, std::optional<TriangleHit>& hit) const;
+    };
+
+}
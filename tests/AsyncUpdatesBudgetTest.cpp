@@ -0,0 +1,189 @@
+/*
+ * Copyright (c) 2025-present Henri Michelon
+ *
+ * This software is released under the MIT License.
+ * https://opensource.org/licenses/MIT
+*/
+import std;
+import lysa.async_updates_budget;
+import lysa.types;
+
+using namespace lysa;
+
+namespace {
+
+    using Operation = AsyncUpdatesBudget::Operation;
+    using Pending = AsyncUpdatesBudget::Pending;
+
+    constexpr auto FRAME{16.0f};
+
+    uint32 failures{0};
+
+    void check(const bool condition, const std::string& message,
+               const std::source_location location = std::source_location::current()) {
+        if (!condition) {
+            std::println(std::cerr, "{}:{}: {}", location.file_name(), location.line(), message);
+            failures += 1;
+        }
+    }
+
+    // Operations queued by the test, processed with a simulated clock in microseconds
+    struct Queue {
+        struct Item {
+            uint32 id;
+            float priority;
+            float queued;
+            uint32 cost;
+        };
+        std::vector<Item> items;
+        float now{0.0f};
+        // Simulated time of one cost unit, in microseconds
+        float unitTime{10.0f};
+
+        // Processes one frame, returns the identifiers of the processed operations in order
+        std::vector<uint32> frame(AsyncUpdatesBudget& budget, float& elapsed) {
+            auto pending = std::vector<Pending>{};
+            for (auto i = 0u; i < items.size(); i++) {
+                pending.push_back({ i, items[i].priority, (now - items[i].queued) / 1000.0f, items[i].cost });
+            }
+            auto processed = std::vector<uint32>{};
+            auto done = std::vector<bool>(items.size(), false);
+            budget.begin();
+            const auto remaining = budget.processQueue(
+                pending, Operation::ADD, elapsed,
+                [&](const uint32 index) {
+                    processed.push_back(items[index].id);
+                    done[index] = true;
+                    now += unitTime * static_cast<float>(items[index].cost);
+                },
+                [&] { return now; });
+            auto kept = std::vector<Item>{};
+            for (auto i = 0u; i < items.size(); i++) {
+                if (!done[i]) { kept.push_back(items[i]); }
+            }
+            items = kept;
+            check(remaining == items.size(), "processQueue() returns the number of operations still queued");
+            budget.end(elapsed, remaining);
+            return processed;
+        }
+    };
+
+    // Lowest priority first, then the oldest operation first
+    void ordering() {
+        auto budget = AsyncUpdatesBudget{1'000'000.0f, 10.0f, 0.0f};
+        auto queue = Queue{};
+        queue.now = 10'000.0f;
+        queue.items = {
+            { 0, 2.0f, 9000.0f, 1 },
+            { 1, 1.0f, 8000.0f, 1 },
+            { 2, 3.0f, 1000.0f, 1 },
+            { 3, 1.0f, 5000.0f, 1 },
+            { 4, 2.0f, 2000.0f, 1 },
+            { 5, 0.0f, 9500.0f, 1 },
+            { 6, 1.0f, 7000.0f, 1 },
+        };
+        auto elapsed = 0.0f;
+        const auto order = queue.frame(budget, elapsed);
+        check(order == std::vector<uint32>{5, 3, 6, 1, 4, 0, 2}, "processed by priority then by queuing time");
+        check(queue.items.empty(), "everything processed in a large budget");
+
+        // Without priority : queuing order
+        queue.items = { { 0, 0.0f, 300.0f, 1 }, { 1, 0.0f, 100.0f, 1 }, { 2, 0.0f, 200.0f, 1 } };
+        queue.now = 1000.0f;
+        elapsed = 0.0f;
+        check(queue.frame(budget, elapsed) == std::vector<uint32>{1, 2, 0}, "same priorities processed in the queuing order");
+
+        // The aging moves an old operation before the newer ones with a better priority
+        auto aging = AsyncUpdatesBudget{1'000'000.0f, 10.0f, 10.0f};
+        check(aging.getAgedPriority({ 0, 5.0f, 200.0f, 1 }) == 3.0f, "priority decreased by 10 per second of waiting");
+        queue.items = { { 0, 1.0f, 900'000.0f, 1 }, { 1, 5.0f, 0.0f, 1 }, { 2, 4.0f, 900'000.0f, 1 } };
+        queue.now = 1'000'000.0f;
+        elapsed = 0.0f;
+        check(queue.frame(aging, elapsed) == std::vector<uint32>{1, 0, 2}, "the operation waiting for one second goes first");
+    }
+
+    // The operations are processed while their estimated time fits in the budget
+    void budgetRespected() {
+        auto budget = AsyncUpdatesBudget{200.0f, 10.0f, 0.0f};
+        auto queue = Queue{};
+        for (auto i = 0u; i < 1000; i++) {
+            queue.items.push_back({ i, 0.0f, 0.0f, 1 + i % 4 });
+        }
+        auto overBudget = 0;
+        auto frames = 0;
+        while (!queue.items.empty() && frames < 1000) {
+            auto elapsed = 0.0f;
+            const auto processed = queue.frame(budget, elapsed);
+            overBudget += elapsed > budget.getBudget() ? 1 : 0;
+            check(!processed.empty(), "the queue progresses each frame");
+            queue.now += FRAME * 1000.0f;
+            frames += 1;
+        }
+        check(queue.items.empty(), "the queue is emptied");
+        check(overBudget == 0, std::format("{} frames over the budget", overBudget));
+        // 1000 operations of 2.5 units of 10 us in frames of 200 us
+        check(frames >= 125 && frames <= 160, std::format("{} frames to process 25 ms of operations in 200 us per frame", frames));
+
+        // The time already spent in the frame is part of the budget
+        queue.items = { { 0, 0.0f, 0.0f, 2 }, { 1, 0.0f, 0.0f, 2 }, { 2, 0.0f, 0.0f, 2 } };
+        auto elapsed = 150.0f;
+        budget.begin();
+        auto pending = std::vector<Pending>{ { 0, 0.0f, 0.0f, 2 }, { 1, 0.0f, 0.0f, 2 }, { 2, 0.0f, 0.0f, 2 } };
+        auto count = 0;
+        const auto remaining = budget.processQueue(pending, Operation::ADD, elapsed,
+            [&](uint32) { count += 1; queue.now += 20.0f; }, [&] { return queue.now; });
+        check(count == 2 && remaining == 1, "150 us spent in the frame leave room for two operations of 20 us");
+        check(elapsed == 190.0f, "the time spent is added to elapsed");
+
+        // The first operation of a frame is processed even when larger than the budget
+        auto small = AsyncUpdatesBudget{5.0f, 10.0f, 0.0f};
+        queue.items = { { 0, 0.0f, 0.0f, 10 }, { 1, 0.0f, 0.0f, 10 } };
+        elapsed = 0.0f;
+        check(queue.frame(small, elapsed).size() == 1, "one operation per frame with a budget smaller than one operation");
+        const auto statistics = small.getStatistics();
+        check(statistics.processed == 1 && statistics.queueLength == 1, "statistics of the frame");
+        check(statistics.addUnitCost == 10.0f, "estimated unit cost of the additions");
+    }
+
+    // Each frame queues more operations with a good priority than the budget can process
+    uint32 framesToProcessLowPriority(const float aging) {
+        auto budget = AsyncUpdatesBudget{100.0f, 10.0f, aging};
+        auto queue = Queue{};
+        queue.items.push_back({ 0, 50.0f, 0.0f, 1 });
+        auto next = 1u;
+        for (auto frame = 0u; frame < 2000; frame++) {
+            for (auto i = 0; i < 15; i++) {
+                queue.items.push_back({ next++, static_cast<float>(i % 5), queue.now, 1 });
+            }
+            auto elapsed = 0.0f;
+            const auto processed = queue.frame(budget, elapsed);
+            if (std::ranges::find(processed, 0u) != processed.end()) {
+                return frame;
+            }
+            queue.now += FRAME * 1000.0f;
+        }
+        return std::numeric_limits<uint32>::max();
+    }
+
+    void noStarvation() {
+        check(framesToProcessLowPriority(0.0f) == std::numeric_limits<uint32>::max(),
+              "without aging the low priority operation is starved");
+        // 50 priority units at 10 per second : at least 5 seconds (312 frames of 16 ms) to go before
+        // the new operations, then the older operations with a better aged priority go first
+        const auto frames = framesToProcessLowPriority(10.0f);
+        check(frames >= 312 && frames < 500, std::format("low priority operation processed after {} frames", frames));
+        check(framesToProcessLowPriority(100.0f) < frames, "a faster aging reduces the waiting");
+    }
+
+}
+
+int main() {
+    ordering();
+    budgetRespected();
+    noStarvation();
+    if (failures > 0) {
+        std::println(std::cerr, "{} checks failed", failures);
+        return 1;
+    }
+    return 0;
+}
@@ -0,0 +1,335 @@
+/*
+ * Copyright (c) 2025-present Henri Michelon
+ *
+ * This software is released under the MIT License.
+ * https://opensource.org/licenses/MIT
+*/
+import std;
+import lysa.aabb;
+import lysa.bvh;
+import lysa.frustum;
+import lysa.math;
+import lysa.triangle_bvh;
+
+using namespace lysa;
+
+namespace {
+
+    uint32 failures{0};
+
+    void check(const bool condition, const std::string& message,
+               const std::source_location location = std::source_location::current()) {
+        if (!condition) {
+            std::println(std::cerr, "{}:{}: {}", location.file_name(), location.line(), message);
+            failures += 1;
+        }
+    }
+
+    constexpr auto WORLD_SIZE{100.0f};
+
+    // Objects of the tree with the index of each one as user data
+    struct Objects {
+        BVH tree;
+        std::vector<int32> proxies;
+        std::vector<bool> alive;
+    };
+
+    AABB createBox(std::mt19937& random) {
+        auto position = std::uniform_real_distribution{0.0f, WORLD_SIZE};
+        auto extent = std::uniform_real_distribution{0.25f, 2.0f};
+        const auto center = float3{position(random), position(random), position(random)};
+        const auto half = float3{extent(random), extent(random), extent(random)};
+        return AABB{center - half, center + half};
+    }
+
+    void insert(Objects& objects, const AABB& box) {
+        const auto index = objects.proxies.size();
+        objects.proxies.push_back(objects.tree.insert(box, reinterpret_cast<const void*>(index)));
+        objects.alive.push_back(true);
+    }
+
+    std::set<size_t> toSet(const std::vector<const void*>& userData) {
+        auto result = std::set<size_t>{};
+        for (const auto* data : userData) {
+            result.insert(reinterpret_cast<size_t>(data));
+        }
+        return result;
+    }
+
+    // Objects whose fat AABB passes a test, the queries report the fat AABBs
+    template<typename Test>
+    std::set<size_t> bruteForce(const Objects& objects, Test&& test) {
+        auto result = std::set<size_t>{};
+        for (auto i = 0; i < objects.proxies.size(); i++) {
+            if (objects.alive[i] && test(objects.tree.getFatAABB(objects.proxies[i]))) {
+                result.insert(i);
+            }
+        }
+        return result;
+    }
+
+    // Same test as the BVH : the box corner the farthest along the normal of each plane
+    bool isInFrustum(const AABB& box, const Frustum::Plane planes[6]) {
+        for (auto i = 0; i < 6; i++) {
+            const float4& plane = planes[i].data;
+            const float3 normal = plane.xyz;
+            const float3 positive = select(normal >= 0.0f, box.max, box.min);
+            if (static_cast<float>(dot(normal, positive)) + static_cast<float>(plane.w) < 0.0f) {
+                return false;
+            }
+        }
+        return true;
+    }
+
+    void checkQueries(const Objects& objects, std::mt19937& random, const std::string& step) {
+        auto position = std::uniform_real_distribution{0.0f, WORLD_SIZE};
+        auto direction = std::uniform_real_distribution{-1.0f, 1.0f};
+        auto radius = std::uniform_real_distribution{1.0f, 10.0f};
+        auto mismatches = std::array<uint32, 5>{};
+        for (auto i = 0; i < 50; i++) {
+            const auto query = createBox(random);
+            auto found = std::vector<const void*>{};
+            objects.tree.queryAABB(query, [&](const void* userData) { found.push_back(userData); return true; });
+            mismatches[0] += toSet(found) != bruteForce(objects, [&](const AABB& box) { return box.intersects(query); });
+
+            const auto center = float3{position(random), position(random), position(random)};
+            const auto r = radius(random);
+            found.clear();
+            objects.tree.querySphere(center, r, [&](const void* userData) { found.push_back(userData); return true; });
+            mismatches[1] += toSet(found) != bruteForce(objects, [&](const AABB& box) {
+                return BVH::distanceSquared(box, center) <= r * r;
+            });
+
+            Frustum::Plane planes[6];
+            const auto eye = float3{position(random), position(random), position(random)};
+            const auto target = float3{position(random), position(random), position(random)};
+            Frustum::extractPlanes(planes, mul(look_at(eye, target, AXIS_UP), perspective(radians(60.0f), 1.5f, 0.1f, 50.0f)));
+            found.clear();
+            objects.tree.queryFrustum(planes, [&](const void* userData) { found.push_back(userData); return true; });
+            mismatches[2] += toSet(found) != bruteForce(objects, [&](const AABB& box) { return isInFrustum(box, planes); });
+
+            // All the objects hit, then the closest one
+            const auto ray = Ray{eye, float3{direction(random), direction(random), direction(random)}};
+            const float3 invDirection = 1.0f / ray.direction;
+            found.clear();
+            objects.tree.raycast(ray, WORLD_SIZE, [&](const void* userData, const float maxDistance) {
+                found.push_back(userData);
+                return maxDistance;
+            });
+            auto closest = std::numeric_limits<float>::max();
+            mismatches[3] += toSet(found) != bruteForce(objects, [&](const AABB& box) {
+                float distance;
+                if (!BVH::intersects(ray.origin, invDirection, box, WORLD_SIZE, distance)) { return false; }
+                closest = std::min(closest, distance);
+                return true;
+            });
+            auto nearest = std::numeric_limits<float>::max();
+            objects.tree.raycast(ray, WORLD_SIZE, [&](const void* userData, const float maxDistance) {
+                const auto index = reinterpret_cast<size_t>(userData);
+                float distance;
+                if (!BVH::intersects(ray.origin, invDirection, objects.tree.getFatAABB(objects.proxies[index]), maxDistance, distance)) {
+                    return maxDistance;
+                }
+                nearest = std::min(nearest, distance);
+                return distance;
+            });
+            mismatches[4] += nearest != closest;
+        }
+        check(mismatches[0] == 0, std::format("{} : {} AABB queries differ from the brute force", step, mismatches[0]));
+        check(mismatches[1] == 0, std::format("{} : {} sphere queries differ from the brute force", step, mismatches[1]));
+        check(mismatches[2] == 0, std::format("{} : {} frustum queries differ from the brute force", step, mismatches[2]));
+        check(mismatches[3] == 0, std::format("{} : {} ray casts differ from the brute force", step, mismatches[3]));
+        check(mismatches[4] == 0, std::format("{} : {} closest hits differ from the brute force", step, mismatches[4]));
+    }
+
+    void queriesMatchTheBruteForce() {
+        auto random = std::mt19937{42};
+        auto objects = Objects{};
+        for (auto i = 0; i < 2000; i++) {
+            insert(objects, createBox(random));
+        }
+        checkQueries(objects, random, "after the insertions");
+
+        // Small moves stay in the fat AABBs, large ones refit the tree
+        auto index = std::uniform_int_distribution<size_t>{0, objects.proxies.size() - 1};
+        auto move = std::uniform_real_distribution{-5.0f, 5.0f};
+        for (auto i = 0; i < 1000; i++) {
+            const auto object = index(random);
+            if (!objects.alive[object]) { continue; }
+            const auto& box = objects.tree.getFatAABB(objects.proxies[object]);
+            const auto offset = float3{move(random), move(random), move(random)};
+            objects.tree.update(objects.proxies[object], AABB{box.min + 0.1f + offset, box.max - 0.1f + offset});
+        }
+        checkQueries(objects, random, "after the updates");
+
+        for (auto i = 0; i < 500; i++) {
+            const auto object = index(random);
+            if (!objects.alive[object]) { continue; }
+            objects.tree.remove(objects.proxies[object]);
+            objects.alive[object] = false;
+        }
+        for (auto i = 0; i < 500; i++) {
+            insert(objects, createBox(random));
+        }
+        const auto alive = std::ranges::count(objects.alive, true);
+        check(objects.tree.getProxyCount() == alive, "proxy count after the removals and insertions");
+        checkQueries(objects, random, "after the removals and insertions");
+
+        objects.tree.rebuild();
+        check(objects.tree.getRefitCount() == 0, "refit count reset by the rebuild");
+        check(objects.tree.getProxyCount() == alive, "proxy count kept by the rebuild");
+        checkQueries(objects, random, "after the rebuild");
+    }
+
+    // Ray parallel to a slab with the origin on one of its planes : 0 * inf is NaN
+    void raysOnTheSlabPlanes() {
+        const auto box = AABB{float3{0.0f}, float3{1.0f}};
+        for (const auto x : { 0.0f, 0.5f, 1.0f }) {
+            for (const auto& [origin, direction] : {
+                std::pair{float3{x, 0.0f, -1.0f}, AXIS_Z},
+                std::pair{float3{x, 1.0f, 2.0f}, -AXIS_Z},
+                std::pair{float3{x, -1.0f, 0.0f}, AXIS_Y} }) {
+                const float3 invDirection = 1.0f / direction;
+                float distance;
+                check(BVH::intersects(origin, invDirection, box, 10.0f, distance), std::format("ray on x = {} hits the box", x));
+                check(distance == 1.0f, std::format("ray on x = {} enters the box at 1", x));
+            }
+        }
+        const float3 invDirection = 1.0f / AXIS_Z;
+        float distance;
+        check(!BVH::intersects(float3{1.5f, 0.5f, -1.0f}, invDirection, box, 10.0f, distance), "parallel ray outside the slab");
+        check(!BVH::intersects(float3{-0.5f, 0.5f, -1.0f}, invDirection, box, 10.0f, distance), "parallel ray outside the slab");
+        check(!BVH::intersects(float3{0.5f, 0.5f, -1.0f}, invDirection, box, 0.5f, distance), "box after the maximum distance");
+        check(BVH::intersects(float3{0.5f, 0.5f, 0.5f}, invDirection, box, 10.0f, distance) && distance == 0.0f, "origin inside the box");
+
+        // Objects sharing the planes of the ray
+        auto tree = BVH{0.0f};
+        for (auto i = 0; i < 16; i++) {
+            const auto x = static_cast<float>(i);
+            tree.insert(AABB{float3{x, 0.0f, 0.0f}, float3{x + 1.0f, 1.0f, 1.0f}}, reinterpret_cast<const void*>(static_cast<size_t>(i)));
+        }
+        for (auto i = 0; i <= 16; i++) {
+            auto hits = 0;
+            tree.raycast(Ray{float3{static_cast<float>(i), 1.0f, -1.0f}, AXIS_Z}, 10.0f, [&](const void*, const float maxDistance) {
+                hits += 1;
+                return maxDistance;
+            });
+            check(hits == (i == 0 || i == 16 ? 1 : 2), std::format("ray on x = {} hits the boxes sharing the plane", i));
+        }
+    }
+
+    struct Mesh {
+        std::vector<float3> positions;
+        std::vector<uint32> indices;
+        std::vector<std::pair<uint32, uint32>> surfaces;
+    };
+
+    // Möller–Trumbore, one triangle at a time
+    std::optional<float> intersect(const Ray& ray, const float3& v0, const float3& v1, const float3& v2) {
+        const float3 edge1 = v1 - v0;
+        const float3 edge2 = v2 - v0;
+        const float3 p = cross(ray.direction, edge2);
+        const float determinant = dot(edge1, p);
+        if (std::fabs(determinant) < 1e-8f) { return std::nullopt; }
+        const auto invDeterminant = 1.0f / determinant;
+        const float3 t = ray.origin - v0;
+        const float u = dot(t, p) * invDeterminant;
+        if (u < 0.0f || u > 1.0f) { return std::nullopt; }
+        const float3 q = cross(t, edge1);
+        const float v = dot(ray.direction, q) * invDeterminant;
+        if (v < 0.0f || u + v > 1.0f) { return std::nullopt; }
+        const float distance = dot(edge2, q) * invDeterminant;
+        if (distance < 0.0f) { return std::nullopt; }
+        return distance;
+    }
+
+    std::optional<std::pair<float, uint32>> raycast(const Mesh& mesh, const Ray& ray) {
+        auto closest = std::optional<std::pair<float, uint32>>{};
+        for (auto i = 0; i < mesh.indices.size(); i += 3) {
+            const auto distance = intersect(
+                ray,
+                mesh.positions[mesh.indices[i]],
+                mesh.positions[mesh.indices[i + 1]],
+                mesh.positions[mesh.indices[i + 2]]);
+            if (distance && (!closest || *distance < closest->first)) {
+                closest = std::pair{*distance, static_cast<uint32>(i / 3)};
+            }
+        }
+        return closest;
+    }
+
+    void triangleRaycastsMatchTheBruteForce() {
+        auto random = std::mt19937{42};
+        auto position = std::uniform_real_distribution{-10.0f, 10.0f};
+        auto offset = std::uniform_real_distribution{-1.0f, 1.0f};
+        auto mesh = Mesh{};
+        for (auto i = 0u; i < 1000; i++) {
+            const auto center = float3{position(random), position(random), position(random)};
+            for (auto vertex = 0; vertex < 3; vertex++) {
+                mesh.positions.push_back(center + float3{offset(random), offset(random), offset(random)});
+                mesh.indices.push_back(i * 3 + vertex);
+            }
+        }
+        mesh.surfaces = { { 0, 1500 }, { 1500, 1500 } };
+        const auto tree = TriangleBVH{mesh.positions, mesh.indices, mesh.surfaces};
+        check(tree.getTrianglesCount() == 1000, "triangles count");
+
+        auto mismatches = 0;
+        auto hits = 0;
+        for (auto i = 0; i < 1000; i++) {
+            const auto origin = float3{position(random), position(random), position(random)} * 1.5f;
+            const auto ray = Ray{origin, float3{position(random), position(random), position(random)} - origin};
+            const auto expected = raycast(mesh, ray);
+            const auto hit = tree.raycast(ray);
+            hits += hit ? 1 : 0;
+            if (expected.has_value() != hit.has_value() ||
+                (expected && (std::fabs(expected->first - hit->distance) > 1e-4f * expected->first ||
+                              hit->surfaceIndex != (expected->second < 500 ? 0 : 1)))) {
+                mismatches += 1;
+            }
+        }
+        check(mismatches == 0, std::format("{} triangle ray casts differ from the brute force", mismatches));
+        check(hits > 0, "some rays hit the triangles");
+    }
+
+    // Vertical rays on the edges of a flat grid, parallel to the planes of the nodes
+    void triangleRaycastsOnTheNodesPlanes() {
+        constexpr auto SIZE{16u};
+        auto mesh = Mesh{};
+        for (auto z = 0u; z <= SIZE; z++) {
+            for (auto x = 0u; x <= SIZE; x++) {
+                mesh.positions.push_back(float3{static_cast<float>(x) * 0.25f, 0.0f, static_cast<float>(z) * 0.25f});
+            }
+        }
+        for (auto z = 0u; z < SIZE; z++) {
+            for (auto x = 0u; x < SIZE; x++) {
+                const auto i = z * (SIZE + 1) + x;
+                mesh.indices.insert(mesh.indices.end(), { i, i + SIZE + 1, i + 1, i + 1, i + SIZE + 1, i + SIZE + 2 });
+            }
+        }
+        mesh.surfaces = { { 0, static_cast<uint32>(mesh.indices.size()) } };
+        const auto tree = TriangleBVH{mesh.positions, mesh.indices, mesh.surfaces};
+        auto misses = 0;
+        for (auto z = 0u; z <= SIZE * 2; z++) {
+            for (auto x = 0u; x <= SIZE * 2; x++) {
+                const auto origin = float3{static_cast<float>(x) * 0.125f, 1.0f, static_cast<float>(z) * 0.125f};
+                const auto hit = tree.raycast(Ray{origin, AXIS_DOWN});
+                misses += (!hit || hit->distance != 1.0f) ? 1 : 0;
+            }
+        }
+        check(misses == 0, std::format("{} vertical rays on the grid missed", misses));
+    }
+
+}
+
+int main() {
+    queriesMatchTheBruteForce();
+    raysOnTheSlabPlanes();
+    triangleRaycastsMatchTheBruteForce();
+    triangleRaycastsOnTheNodesPlanes();
+    if (failures > 0) {
+        std::println(std::cerr, "{} checks failed", failures);
+        return 1;
+    }
+    return 0;
+}
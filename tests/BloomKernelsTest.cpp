@@ -0,0 +1,148 @@
+/*
+ * Copyright (c) 2025-present Henri Michelon
+ *
+ * This software is released under the MIT License.
+ * https://opensource.org/licenses/MIT
+*/
+import std;
+import lysa.types;
+
+using namespace lysa;
+
+namespace {
+
+// Kernels of the bloom shaders, the arrays compiled by the shaders
+#include "../src/shaders/postprocess/bloom_kernels.inc.slang"
+
+    uint32 failures{0};
+
+    void check(const bool condition, const std::string& message,
+               const std::source_location location = std::source_location::current()) {
+        if (!condition) {
+            std::println(std::cerr, "{}:{}: {}", location.file_name(), location.line(), message);
+            failures += 1;
+        }
+    }
+
+    struct Tap {
+        float x;
+        float y;
+        float weight;
+    };
+
+    // Weight of each of the 13 fetches of the downsampling without the Karis average,
+    // "Next Generation Post Processing in Call of Duty: Advanced Warfare", Jimenez 2014
+    const auto DOWNSAMPLE_REFERENCE = std::vector<Tap>{
+        {-2.0f, -2.0f, 1.0f / 32.0f}, { 0.0f, -2.0f, 1.0f / 16.0f}, { 2.0f, -2.0f, 1.0f / 32.0f},
+        {-1.0f, -1.0f, 1.0f / 8.0f }, { 1.0f, -1.0f, 1.0f / 8.0f },
+        {-2.0f,  0.0f, 1.0f / 16.0f}, { 0.0f,  0.0f, 1.0f / 8.0f }, { 2.0f,  0.0f, 1.0f / 16.0f},
+        {-1.0f,  1.0f, 1.0f / 8.0f }, { 1.0f,  1.0f, 1.0f / 8.0f },
+        {-2.0f,  2.0f, 1.0f / 32.0f}, { 0.0f,  2.0f, 1.0f / 16.0f}, { 2.0f,  2.0f, 1.0f / 32.0f},
+    };
+
+    // 3x3 tent : 1 2 1 / 2 4 2 / 1 2 1 divided by 16
+    const auto UPSAMPLE_REFERENCE = std::vector<Tap>{
+        {-1.0f, -1.0f, 1.0f / 16.0f}, { 0.0f, -1.0f, 2.0f / 16.0f}, { 1.0f, -1.0f, 1.0f / 16.0f},
+        {-1.0f,  0.0f, 2.0f / 16.0f}, { 0.0f,  0.0f, 4.0f / 16.0f}, { 1.0f,  0.0f, 2.0f / 16.0f},
+        {-1.0f,  1.0f, 1.0f / 16.0f}, { 0.0f,  1.0f, 2.0f / 16.0f}, { 1.0f,  1.0f, 1.0f / 16.0f},
+    };
+
+    // Weight of each downsampling fetch : the weights of its boxes divided by the 4 fetches of a box
+    std::vector<Tap> getDownsampleTaps() {
+        auto taps = std::vector<Tap>{};
+        for (auto fetch = 0; fetch < BLOOM_DOWNSAMPLE_FETCHES; fetch++) {
+            taps.push_back({BLOOM_DOWNSAMPLE_OFFSETS[fetch][0], BLOOM_DOWNSAMPLE_OFFSETS[fetch][1], 0.0f});
+        }
+        for (auto box = 0; box < BLOOM_DOWNSAMPLE_BOXES; box++) {
+            for (const auto fetch : BLOOM_DOWNSAMPLE_BOX_FETCHES[box]) {
+                taps[fetch].weight += BLOOM_DOWNSAMPLE_BOX_WEIGHTS[box] / 4.0f;
+            }
+        }
+        return taps;
+    }
+
+    std::vector<Tap> getUpsampleTaps() {
+        auto taps = std::vector<Tap>{};
+        for (auto fetch = 0; fetch < BLOOM_UPSAMPLE_FETCHES; fetch++) {
+            taps.push_back({BLOOM_UPSAMPLE_OFFSETS[fetch][0], BLOOM_UPSAMPLE_OFFSETS[fetch][1], BLOOM_UPSAMPLE_WEIGHTS[fetch]});
+        }
+        return taps;
+    }
+
+    float sum(const std::vector<Tap>& taps) {
+        auto result = 0.0f;
+        for (const auto& tap : taps) { result += tap.weight; }
+        return result;
+    }
+
+    // Weight at an offset, -1 without fetch at the offset
+    float weightAt(const std::vector<Tap>& taps, const float x, const float y) {
+        for (const auto& tap : taps) {
+            if (tap.x == x && tap.y == y) { return tap.weight; }
+        }
+        return -1.0f;
+    }
+
+    // Same fetches with the same weights, in any order
+    bool isSame(const std::vector<Tap>& taps, const std::vector<Tap>& reference) {
+        if (taps.size() != reference.size()) { return false; }
+        for (const auto& tap : reference) {
+            if (weightAt(taps, tap.x, tap.y) != tap.weight) { return false; }
+        }
+        return true;
+    }
+
+    // Symmetric around both axes and the diagonal
+    bool isSymmetric(const std::vector<Tap>& taps) {
+        for (const auto& tap : taps) {
+            if (weightAt(taps, -tap.x, tap.y) != tap.weight ||
+                weightAt(taps, tap.x, -tap.y) != tap.weight ||
+                weightAt(taps, tap.y, tap.x) != tap.weight) {
+                return false;
+            }
+        }
+        return true;
+    }
+
+    void downsample() {
+        const auto taps = getDownsampleTaps();
+        auto boxWeights = 0.0f;
+        for (const auto weight : BLOOM_DOWNSAMPLE_BOX_WEIGHTS) { boxWeights += weight; }
+        check(boxWeights == 1.0f, "boxes weights sum to 1");
+        check(sum(taps) == 1.0f, "fetches weights sum to 1");
+        check(isSymmetric(taps), "symmetric downsampling");
+        check(isSame(taps, DOWNSAMPLE_REFERENCE), "reference downsampling weights");
+
+        // Each box is a square of 4 fetches, the inner one around the center
+        for (auto box = 0; box < BLOOM_DOWNSAMPLE_BOXES; box++) {
+            auto minX = 10.0f, maxX = -10.0f, minY = 10.0f, maxY = -10.0f, centerX = 0.0f, centerY = 0.0f;
+            for (const auto fetch : BLOOM_DOWNSAMPLE_BOX_FETCHES[box]) {
+                const auto x = BLOOM_DOWNSAMPLE_OFFSETS[fetch][0];
+                const auto y = BLOOM_DOWNSAMPLE_OFFSETS[fetch][1];
+                minX = std::min(minX, x); maxX = std::max(maxX, x);
+                minY = std::min(minY, y); maxY = std::max(maxY, y);
+                centerX += x / 4.0f; centerY += y / 4.0f;
+            }
+            check(maxX - minX == 2.0f && maxY - minY == 2.0f, std::format("box {} is a square of 4x4 texels", box));
+            check((centerX == 0.0f && centerY == 0.0f) == (box == 0), std::format("box {} centered on the inner box only", box));
+        }
+    }
+
+    void upsample() {
+        const auto taps = getUpsampleTaps();
+        check(sum(taps) == 1.0f, "upsampling weights sum to 1");
+        check(isSymmetric(taps), "symmetric upsampling");
+        check(isSame(taps, UPSAMPLE_REFERENCE), "reference tent weights");
+    }
+
+}
+
+int main() {
+    downsample();
+    upsample();
+    if (failures > 0) {
+        std::println(std::cerr, "{} checks failed", failures);
+        return 1;
+    }
+    return 0;
+}
@@ -0,0 +1,111 @@
+/*
+ * Copyright (c) 2025-present Henri Michelon
+ *
+ * This software is released under the MIT License.
+ * https://opensource.org/licenses/MIT
+*/
+import std;
+import lysa.buffer_capacity;
+import lysa.math;
+
+using namespace lysa;
+
+namespace {
+
+    uint32 failures{0};
+
+    void check(const bool condition, const std::string& message,
+               const std::source_location location = std::source_location::current()) {
+        if (!condition) {
+            std::println(std::cerr, "{}:{}: {}", location.file_name(), location.line(), message);
+            failures += 1;
+        }
+    }
+
+    void growsOnOverflow() {
+        auto capacity = BufferCapacity{1 << 20};
+        check(capacity.get() == 0, "empty before the first update");
+        check(capacity.update(0), "first update allocates");
+        check(capacity.get() == 64, "minimum capacity");
+        check(!capacity.update(64), "count equal to the capacity fits");
+        check(capacity.update(65), "count above the capacity grows");
+        check(capacity.get() == 128, "power of two above the count plus the headroom");
+        check(capacity.update(1000), "large growth in one update");
+        check(capacity.get() == 2048, "1000 + 25% rounded to 2048");
+    }
+
+    void growsToTheMaximum() {
+        auto capacity = BufferCapacity{100};
+        capacity.update(90);
+        check(capacity.get() == 100, "capacity clamped to the maximum");
+        check(!capacity.update(100), "maximum count fits");
+    }
+
+    void shrinksAfterTheDelay() {
+        const auto configuration = BufferCapacityConfiguration{};
+        auto capacity = BufferCapacity{1 << 20, configuration};
+        capacity.update(1000);
+        check(capacity.get() == 2048, "initial capacity");
+        for (auto i = 1u; i < configuration.shrinkDelay; i++) {
+            check(!capacity.update(100), "no shrink before the delay");
+        }
+        check(capacity.get() == 2048, "capacity kept during the delay");
+        check(capacity.update(100), "shrinks at the end of the delay");
+        check(capacity.get() == 128, "100 + 25% rounded to 128");
+    }
+
+    void delayRestartsAboveTheThreshold() {
+        const auto configuration = BufferCapacityConfiguration{};
+        auto capacity = BufferCapacity{1 << 20, configuration};
+        capacity.update(1000);
+        for (auto i = 1u; i < configuration.shrinkDelay; i++) {
+            capacity.update(100);
+        }
+        // 512 is a quarter of 2048 : not under the threshold
+        check(!capacity.update(512), "count at the threshold");
+        for (auto i = 1u; i < configuration.shrinkDelay; i++) {
+            check(!capacity.update(100), "the delay restarted");
+        }
+        check(capacity.get() == 2048, "capacity kept");
+    }
+
+    void noOscillationAtTheThreshold() {
+        const auto configuration = BufferCapacityConfiguration{};
+        for (const auto& [low, high] : { std::pair{127u, 129u}, std::pair{60u, 70u}, std::pair{511u, 513u} }) {
+            auto capacity = BufferCapacity{1 << 20, configuration};
+            capacity.update(high);
+            const auto initial = capacity.get();
+            auto changes = 0;
+            for (auto i = 0u; i < configuration.shrinkDelay * 10; i++) {
+                changes += capacity.update(i % 2 == 0 ? low : high) ? 1 : 0;
+            }
+            check(changes == 0, std::format("count oscillating between {} and {} reallocates", low, high));
+            check(capacity.get() == initial, "capacity unchanged");
+        }
+        // After a shrink the new capacity leaves room for the count to oscillate
+        auto capacity = BufferCapacity{1 << 20, configuration};
+        capacity.update(1000);
+        for (auto i = 0u; i < configuration.shrinkDelay; i++) {
+            capacity.update(200);
+        }
+        const auto shrunk = capacity.get();
+        check(shrunk == 256, "200 + 25% rounded to 256");
+        for (auto i = 0u; i < configuration.shrinkDelay * 10; i++) {
+            check(!capacity.update(i % 2 == 0 ? 200 : 250), "stable after the shrink");
+        }
+    }
+
+}
+
+int main() {
+    growsOnOverflow();
+    growsToTheMaximum();
+    shrinksAfterTheDelay();
+    delayRestartsAboveTheThreshold();
+    noOscillationAtTheThreshold();
+    if (failures > 0) {
+        std::println(std::cerr, "{} checks failed", failures);
+        return 1;
+    }
+    return 0;
+}
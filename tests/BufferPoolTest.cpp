@@ -0,0 +1,124 @@
+/*
+ * Copyright (c) 2025-present Henri Michelon
+ *
+ * This software is released under the MIT License.
+ * https://opensource.org/licenses/MIT
+*/
+import std;
+import vireo;
+import lysa.math;
+import lysa.memory;
+
+using namespace lysa;
+
+// The pool creates real buffers : the test needs a Vulkan device, a software driver
+// like lavapipe is enough. Skipped when there is none.
+constexpr auto SKIPPED{77};
+
+namespace {
+
+    uint32 failures{0};
+
+    void check(const bool condition, const std::string& message,
+               const std::source_location location = std::source_location::current()) {
+        if (!condition) {
+            std::println(std::cerr, "{}:{}: {}", location.file_name(), location.line(), message);
+            failures += 1;
+        }
+    }
+
+    void roundsToPowersOfTwo(const std::shared_ptr<vireo::Vireo>& vireo) {
+        auto pool = BufferPool{vireo, 2, 1 << 20};
+        auto buffer = pool.acquire(vireo::BufferType::STORAGE, 1000, "test");
+        check(buffer != nullptr, "buffer created");
+        check(pool.getAllocatedSize() == 1024, "size rounded to 1024");
+        pool.release(0, buffer);
+        check(buffer == nullptr, "released pointer reset");
+    }
+
+    void reusesAfterTheFramesInFlight(const std::shared_ptr<vireo::Vireo>& vireo) {
+        constexpr auto framesInFlight = 3u;
+        auto pool = BufferPool{vireo, framesInFlight, 1 << 20};
+
+        pool.recycle(0);
+        auto buffer = pool.acquire(vireo::BufferType::STORAGE, 1024, "test");
+        const auto* released = buffer.get();
+        pool.release(0, buffer);
+
+        // Still read by the frames in flight submitted before the next use of index 0
+        auto others = std::vector<std::shared_ptr<vireo::Buffer>>{};
+        for (auto frame = 0u; frame < framesInFlight; frame++) {
+            pool.recycle(frame);
+            check(pool.getFreeSize() == 0, std::format("released buffer reusable at frame {}", frame));
+            others.push_back(pool.acquire(vireo::BufferType::STORAGE, 1024, "test"));
+            check(others.back().get() != released, std::format("released buffer reused at frame {}", frame));
+        }
+
+        // Next frame using index 0 : the frame that released the buffer has completed
+        pool.recycle(0);
+        check(pool.getFreeSize() == 1024, "released buffer back in the pool");
+        auto reused = pool.acquire(vireo::BufferType::STORAGE, 1000, "test");
+        check(reused.get() == released, "released buffer reused");
+        check(pool.getFreeSize() == 0, "reused buffer out of the pool");
+        pool.release(0, reused);
+    }
+
+    void recyclesOncePerFrame(const std::shared_ptr<vireo::Vireo>& vireo) {
+        auto pool = BufferPool{vireo, 2, 1 << 20};
+        pool.recycle(0);
+        auto buffer = pool.acquire(vireo::BufferType::STORAGE, 1024, "test");
+        pool.release(0, buffer);
+        // The buffer released during the frame is still used by this frame
+        pool.recycle(0);
+        check(pool.getFreeSize() == 0, "second recycle of the same frame ignored");
+    }
+
+    void reusesOnlyTheSameType(const std::shared_ptr<vireo::Vireo>& vireo) {
+        auto pool = BufferPool{vireo, 1, 1 << 20};
+        auto buffer = pool.acquire(vireo::BufferType::STORAGE, 1024, "test");
+        const auto* released = buffer.get();
+        pool.release(0, buffer);
+        pool.recycle(0);
+        auto uniform = pool.acquire(vireo::BufferType::UNIFORM, 1024, "test");
+        check(uniform.get() != released, "buffer reused with another type");
+        auto larger = pool.acquire(vireo::BufferType::STORAGE, 2048, "test");
+        check(larger.get() != released, "buffer reused with another size");
+        check(pool.getFreeSize() == 1024, "released buffer still in the pool");
+    }
+
+    void destroysAboveTheBudget(const std::shared_ptr<vireo::Vireo>& vireo) {
+        auto pool = BufferPool{vireo, 1, 4096};
+        auto small = pool.acquire(vireo::BufferType::STORAGE, 1024, "test");
+        auto large = pool.acquire(vireo::BufferType::STORAGE, 8192, "test");
+        check(pool.getAllocatedSize() == 1024 + 8192, "allocated size");
+        pool.release(0, small);
+        pool.release(0, large);
+        pool.recycle(0);
+        check(pool.getFreeSize() == 1024, "largest buffer destroyed");
+        check(pool.getAllocatedSize() == 1024, "allocated size without the destroyed buffer");
+    }
+
+}
+
+int main() {
+    auto vireo = std::shared_ptr<vireo::Vireo>{};
+    try {
+        vireo = vireo::Vireo::create(vireo::Backend::VULKAN, [](vireo::DebugLevel, const std::string&) {});
+    } catch (const std::exception& e) {
+        std::println(std::cerr, "No Vulkan device : {}", e.what());
+        return SKIPPED;
+    }
+    if (!vireo) {
+        return SKIPPED;
+    }
+    roundsToPowersOfTwo(vireo);
+    reusesAfterTheFramesInFlight(vireo);
+    recyclesOncePerFrame(vireo);
+    reusesOnlyTheSameType(vireo);
+    destroysAboveTheBudget(vireo);
+    if (failures > 0) {
+        std::println(std::cerr, "{} checks failed", failures);
+        return 1;
+    }
+    return 0;
+}
@@ -0,0 +1,204 @@
+/*
+ * Copyright (c) 2025-present Henri Michelon
+ *
+ * This software is released under the MIT License.
+ * https://opensource.org/licenses/MIT
+*/
+import std;
+import lysa.aabb;
+import lysa.culling_view;
+import lysa.math;
+
+using namespace lysa;
+
+namespace {
+
+    uint32 failures{0};
+
+    void check(const bool condition, const std::string& message,
+               const std::source_location location = std::source_location::current()) {
+        if (!condition) {
+            std::println(std::cerr, "{}:{}: {}", location.file_name(), location.line(), message);
+            failures += 1;
+        }
+    }
+
+    std::array<float3, 8> getCorners(const AABB& aabb) {
+        auto corners = std::array<float3, 8>{};
+        for (auto i = 0; i < 8; i++) {
+            corners[i] = float3{
+                static_cast<float>((i & 1) ? aabb.max.x : aabb.min.x),
+                static_cast<float>((i & 2) ? aabb.max.y : aabb.min.y),
+                static_cast<float>((i & 4) ? aabb.max.z : aabb.min.z)};
+        }
+        return corners;
+    }
+
+    // -1 if the box is outside of a clipping plane, 1 if it is inside all of them, 0 if it crosses one
+    int32 getReference(const AABB& aabb, const float4x4& viewProjection) {
+        auto inside = 0;
+        auto outside = std::array<int32, 6>{};
+        for (const auto& corner : getCorners(aabb)) {
+            const float4 clip = mul(float4{corner, 1.0f}, viewProjection);
+            const float x = clip.x;
+            const float y = clip.y;
+            const float z = clip.z;
+            const float w = clip.w;
+            const auto planes = std::array{ x < -w, x > w, y < -w, y > w, z < 0.0f, z > w };
+            auto cornerInside = true;
+            for (auto plane = 0; plane < 6; plane++) {
+                if (planes[plane]) {
+                    outside[plane] += 1;
+                    cornerInside = false;
+                }
+            }
+            inside += cornerInside ? 1 : 0;
+        }
+        if (std::ranges::any_of(outside, [](const int32 count) { return count == 8; })) { return -1; }
+        return inside == 8 ? 1 : 0;
+    }
+
+    std::vector<AABB> createBoxes(std::mt19937& random) {
+        auto position = std::uniform_real_distribution{-60.0f, 60.0f};
+        auto extent = std::uniform_real_distribution{0.1f, 4.0f};
+        auto boxes = std::vector<AABB>(5000);
+        for (auto& box : boxes) {
+            const auto center = float3{position(random), position(random) * 0.25f, position(random)};
+            const auto half = float3{extent(random), extent(random), extent(random)};
+            box = AABB{center - half, center + half};
+        }
+        return boxes;
+    }
+
+    // Two cameras at the same place looking in opposite directions : each view
+    // gets its own results, checked against the clip space corners of the boxes
+    void viewsOfTwoCameras() {
+        auto random = std::mt19937{42};
+        const auto boxes = createBoxes(random);
+        const auto projection = perspective(radians(75.0f), 16.0f / 9.0f, 0.1f, 50.0f);
+        const auto viewProjections = std::array{
+            mul(float4x4::identity(), projection),
+            mul(look_at(float3{0.0f}, float3{0.0f, 0.0f, 1.0f}, AXIS_UP), projection),
+            mul(look_at(float3{5.0f, 2.0f, 0.0f}, float3{20.0f, 2.0f, 0.0f}, AXIS_UP), projection),
+        };
+        auto views = std::vector<CullingView>{};
+        for (const auto& viewProjection : viewProjections) {
+            views.push_back(CullingView{viewProjection, CullingView::TYPE_CAMERA});
+        }
+        for (auto index = 0; index < views.size(); index++) {
+            auto culled = 0;
+            auto wrong = 0;
+            for (const auto& box : boxes) {
+                const auto reference = getReference(box, viewProjections[index]);
+                const auto visible = views[index].isVisible(box, true, true, false, false);
+                culled += visible ? 0 : 1;
+                wrong += (reference == 1 && !visible) || (reference == -1 && visible) ? 1 : 0;
+            }
+            check(wrong == 0, std::format("{} boxes of the view {} differ from the clip space reference", wrong, index));
+            check(culled > 0 && culled < boxes.size(), std::format("the view {} culls some of the boxes", index));
+        }
+
+        const auto front = AABB{float3{-1.0f, -1.0f, -11.0f}, float3{1.0f, 1.0f, -9.0f}};
+        const auto back = AABB{float3{-1.0f, -1.0f, 9.0f}, float3{1.0f, 1.0f, 11.0f}};
+        check(views[0].isVisible(front, true, true, false, false), "the box in front of the first camera is visible");
+        check(!views[0].isVisible(back, true, true, false, false), "the box behind the first camera is culled");
+        check(!views[1].isVisible(front, true, true, false, false), "the box behind the second camera is culled");
+        check(views[1].isVisible(back, true, true, false, false), "the box in front of the second camera is visible");
+    }
+
+    // Each camera view reads its own range of the occlusion bits
+    void occlusionOfTwoCameras() {
+        constexpr auto WORDS{4u};
+        auto bits = std::vector<uint32>(WORDS * 2);
+        const auto occlude = [&](const uint32 offset, const uint32 index) {
+            bits[offset + index / 32] |= 1u << (index % 32);
+        };
+        const auto box = AABB{float3{-1.0f, -1.0f, -11.0f}, float3{1.0f, 1.0f, -9.0f}};
+        const auto viewProjection = perspective(radians(75.0f), 1.0f, 0.1f, 50.0f);
+        auto first = CullingView{viewProjection, CullingView::TYPE_CAMERA};
+        auto second = CullingView{viewProjection, CullingView::TYPE_CAMERA};
+        first.occlusionOffset = 0;
+        second.occlusionOffset = WORDS;
+        occlude(first.occlusionOffset, 3);
+        occlude(second.occlusionOffset, 40);
+        occlude(first.occlusionOffset, 127);
+        occlude(second.occlusionOffset, 127);
+
+        check(first.isOccluded(bits, 3) && !second.isOccluded(bits, 3), "instance 3 occluded for the first camera only");
+        check(!first.isOccluded(bits, 40) && second.isOccluded(bits, 40), "instance 40 occluded for the second camera only");
+        check(first.isOccluded(bits, 127) && second.isOccluded(bits, 127), "instance 127 occluded for both cameras");
+        check(!first.isOccluded(bits, 4) && !second.isOccluded(bits, 4), "instance 4 visible for both cameras");
+        check(first.isVisible(box, true, true, first.isOccluded(bits, 40), false) &&
+              !second.isVisible(box, true, true, second.isOccluded(bits, 40), false),
+              "the occlusion of a camera does not hide the instance in the other view");
+
+        auto none = CullingView{viewProjection, CullingView::TYPE_CAMERA};
+        check(none.occlusionOffset == CullingView::NO_OCCLUSION, "views have no occlusion bits by default");
+        check(!none.isOccluded(bits, 3), "a view without occlusion bits never occludes");
+        auto shadow = CullingView{viewProjection, CullingView::TYPE_SHADOW};
+        shadow.occlusionOffset = 0;
+        check(!shadow.isOccluded(bits, 3), "the shadow views ignore the occlusion bits");
+        check(!first.isOccluded(bits, WORDS * 32 * 2), "instances after the bits are not occluded");
+    }
+
+    void flagsOfTheViewTypes() {
+        const auto box = AABB{float3{-1.0f, -1.0f, -11.0f}, float3{1.0f, 1.0f, -9.0f}};
+        const auto viewProjection = perspective(radians(75.0f), 1.0f, 0.1f, 50.0f);
+        const auto camera = CullingView{viewProjection, CullingView::TYPE_CAMERA};
+        const auto shadow = CullingView{viewProjection, CullingView::TYPE_SHADOW};
+        const auto shadowStatic = CullingView{viewProjection, CullingView::TYPE_SHADOW_STATIC};
+        const auto shadowDynamic = CullingView{viewProjection, CullingView::TYPE_SHADOW_DYNAMIC};
+
+        check(!camera.isVisible(box, false, true, false, false), "hidden instances are culled");
+        check(camera.isVisible(box, true, false, false, false), "the camera draws the instances without shadows");
+        check(!camera.isVisible(box, true, true, true, false), "the camera culls the occluded instances");
+        check(shadow.isVisible(box, true, true, true, false), "the shadow views draw the occluded instances");
+        check(!shadow.isVisible(box, true, false, false, false), "the shadow views cull the instances without shadows");
+        check(shadowStatic.isVisible(box, true, true, false, true) && !shadowStatic.isVisible(box, true, true, false, false),
+              "the static shadow views draw the static instances only");
+        check(!shadowDynamic.isVisible(box, true, true, false, true) && shadowDynamic.isVisible(box, true, true, false, false),
+              "the dynamic shadow views draw the non-static instances only");
+    }
+
+    void facesOfTheCubeViews() {
+        const auto view = CullingView::cube(float3{0.0f, 0.0f, 0.0f}, 10.0f, CullingView::TYPE_SHADOW_CUBE);
+        const auto dynamic = CullingView::cube(float3{0.0f, 0.0f, 0.0f}, 10.0f, CullingView::TYPE_SHADOW_CUBE_DYNAMIC);
+        const auto box = [](const float3& center, const float half) {
+            return AABB{center - half, center + half};
+        };
+        check(view.isCube() && dynamic.isCube(), "cube map views");
+        check(view.getCubeFacesMask(box(float3{5.0f, 0.0f, 0.0f}, 1.0f)) == 0b000001, "+X face only");
+        check(view.getCubeFacesMask(box(float3{-5.0f, 0.0f, 0.0f}, 1.0f)) == 0b000010, "-X face only");
+        check(view.getCubeFacesMask(box(float3{0.0f, 5.0f, 0.0f}, 1.0f)) == 0b000100, "+Y face only");
+        check(view.getCubeFacesMask(box(float3{0.0f, 0.0f, -5.0f}, 1.0f)) == 0b100000, "-Z face only");
+        check(view.getCubeFacesMask(box(float3{5.0f, 5.0f, 0.0f}, 1.0f)) == 0b000101, "box on the +X +Y edge");
+        check(view.getCubeFacesMask(box(float3{0.0f, 0.0f, 0.0f}, 1.0f)) == 0b111111, "box around the light");
+        check(view.getCubeFacesMask(box(float3{20.0f, 0.0f, 0.0f}, 1.0f)) == 0, "box out of range");
+        check(view.getCubeFacesMask(box(float3{10.5f, 0.0f, 0.0f}, 1.0f)) == 0b000001, "box crossing the range");
+        check(!view.isVisible(box(float3{20.0f, 0.0f, 0.0f}, 1.0f), true, true, false, false), "out of range is culled");
+        check(view.isVisible(box(float3{5.0f, 0.0f, 0.0f}, 1.0f), true, true, false, true), "static in the cube view");
+        check(!dynamic.isVisible(box(float3{5.0f, 0.0f, 0.0f}, 1.0f), true, true, false, true),
+              "static instances are in the faces caches");
+    }
+
+    // The views are uploaded as is to the `CullingView` structure of the culling shaders
+    void memoryLayout() {
+        check(sizeof(CullingView) == 112, "CullingView is 112 bytes");
+        check(offsetof(CullingView, type) == 96, "type after the six planes");
+        check(offsetof(CullingView, occlusionOffset) == 100, "occlusionOffset after the type");
+    }
+
+}
+
+int main() {
+    viewsOfTwoCameras();
+    occlusionOfTwoCameras();
+    flagsOfTheViewTypes();
+    facesOfTheCubeViews();
+    memoryLayout();
+    if (failures > 0) {
+        std::println(std::cerr, "{} checks failed", failures);
+        return 1;
+    }
+    return 0;
+}
@@ -0,0 +1,127 @@
+/*
+ * Copyright (c) 2025-present Henri Michelon
+ *
+ * This software is released under the MIT License.
+ * https://opensource.org/licenses/MIT
+*/
+import std;
+import lysa.aabb;
+import lysa.depth_pyramid;
+import lysa.math;
+
+using namespace lysa;
+
+namespace {
+
+    uint32 failures{0};
+
+    void check(const bool condition, const std::string& message,
+               const std::source_location location = std::source_location::current()) {
+        if (!condition) {
+            std::println(std::cerr, "{}:{}: {}", location.file_name(), location.line(), message);
+            failures += 1;
+        }
+    }
+
+    std::vector<float> createDepth(const uint32 width, const uint32 height, std::mt19937& random) {
+        auto value = std::uniform_real_distribution{0.0f, 1.0f};
+        auto depth = std::vector<float>(width * height);
+        for (auto& d : depth) {
+            d = value(random);
+        }
+        return depth;
+    }
+
+    void layoutOfOddSizes() {
+        const auto pyramid = DepthPyramid{7, 5};
+        check(pyramid.getLevelsCount() == 3, "7x5 reduced to 4x3, 2x2 and 1x1");
+        const auto& levels = pyramid.getLevels();
+        check(levels[0].width == 4 && levels[0].height == 3 && levels[0].offset == 0, "level 0 of 7x5");
+        check(levels[1].width == 2 && levels[1].height == 2 && levels[1].offset == 12, "level 1 of 7x5");
+        check(levels[2].width == 1 && levels[2].height == 1 && levels[2].offset == 16, "level 2 of 7x5");
+        check(pyramid.getSize() == 17, "texels of all the levels of 7x5");
+
+        const auto column = DepthPyramid{1, 9};
+        check(column.getLevelsCount() == 4, "1x9 reduced to 1x5, 1x3, 1x2 and 1x1");
+        check(column.getLevels().back().width == 1 && column.getLevels().back().height == 1, "last level of 1x9");
+
+        const auto pixel = DepthPyramid{1, 1};
+        check(pixel.getLevelsCount() == 1 && pixel.getSize() == 1, "1x1 has a single level");
+    }
+
+    // Each texel of the level L is the farthest depth of the (2^(L+1))² pixels block at the
+    // same position, clamped to the depth buffer for the last rows and columns of odd sizes
+    void reductionOfOddSizes() {
+        auto random = std::mt19937{42};
+        for (const auto& [width, height] : {
+            std::pair{37u, 23u}, std::pair{64u, 64u}, std::pair{1u, 9u}, std::pair{17u, 1u}, std::pair{1u, 1u} }) {
+            const auto depth = createDepth(width, height, random);
+            auto pyramid = DepthPyramid{width, height};
+            pyramid.build(depth);
+            auto mismatches = 0;
+            for (auto index = 0u; index < pyramid.getLevelsCount(); index++) {
+                const auto& level = pyramid.getLevels()[index];
+                const auto block = 2u << index;
+                for (auto y = 0u; y < level.height; y++) {
+                    for (auto x = 0u; x < level.width; x++) {
+                        auto expected = 0.0f;
+                        for (auto py = y * block; py < std::min((y + 1) * block, height); py++) {
+                            for (auto px = x * block; px < std::min((x + 1) * block, width); px++) {
+                                expected = std::max(expected, depth[py * width + px]);
+                            }
+                        }
+                        mismatches += pyramid.get(index, x, y) != expected ? 1 : 0;
+                    }
+                }
+            }
+            check(mismatches == 0, std::format("{} texels of {}x{} differ from the farthest depth of their block", mismatches, width, height));
+            const auto& last = pyramid.getLevels().back();
+            check(last.width == 1 && last.height == 1, std::format("{}x{} reduced to one texel", width, height));
+            check(pyramid.get(pyramid.getLevelsCount() - 1, 0, 0) == std::ranges::max(depth),
+                  std::format("last level of {}x{} is the farthest depth", width, height));
+        }
+    }
+
+    // Camera at the origin looking down -Z in front of a wall at 10 units
+    void occlusionOfBoxes() {
+        constexpr auto WIDTH{101u};
+        constexpr auto HEIGHT{67u};
+        const auto view = float4x4::identity();
+        const auto projection = perspective(radians(60.0f), static_cast<float>(WIDTH) / HEIGHT, 0.1f, 100.0f);
+        const float4 wall = mul(float4{0.0f, 0.0f, -10.0f, 1.0f}, projection);
+        const float wallDepth = wall.z / wall.w;
+        auto depth = std::vector<float>(WIDTH * HEIGHT, wallDepth);
+        auto pyramid = DepthPyramid{WIDTH, HEIGHT};
+        pyramid.build(depth);
+        const auto viewport = float4{0.0f, 0.0f, static_cast<float>(WIDTH), static_cast<float>(HEIGHT)};
+
+        check(pyramid.isOccluded(AABB{float3{-1.0f, -1.0f, -22.0f}, float3{1.0f, 1.0f, -20.0f}}, view, projection, viewport),
+              "box behind the wall is occluded");
+        check(!pyramid.isOccluded(AABB{float3{-1.0f, -1.0f, -6.0f}, float3{1.0f, 1.0f, -4.0f}}, view, projection, viewport),
+              "box in front of the wall is visible");
+        check(!pyramid.isOccluded(AABB{float3{-1.0f, -1.0f, -12.0f}, float3{1.0f, 1.0f, -8.0f}}, view, projection, viewport),
+              "box crossing the wall is visible");
+        check(!pyramid.isOccluded(AABB{float3{-1.0f, -1.0f, -20.0f}, float3{1.0f, 1.0f, 1.0f}}, view, projection, viewport),
+              "box crossing the camera plane is visible");
+
+        // A hole in the wall of a single pixel at the center of the screen
+        depth[(HEIGHT / 2) * WIDTH + WIDTH / 2] = 1.0f;
+        pyramid.build(depth);
+        check(!pyramid.isOccluded(AABB{float3{-1.0f, -1.0f, -22.0f}, float3{1.0f, 1.0f, -20.0f}}, view, projection, viewport),
+              "box behind a hole of the wall is visible");
+        check(pyramid.isOccluded(AABB{float3{8.0f, 3.0f, -22.0f}, float3{10.0f, 5.0f, -20.0f}}, view, projection, viewport),
+              "box behind the wall away from the hole is occluded");
+    }
+
+}
+
+int main() {
+    layoutOfOddSizes();
+    reductionOfOddSizes();
+    occlusionOfBoxes();
+    if (failures > 0) {
+        std::println(std::cerr, "{} checks failed", failures);
+        return 1;
+    }
+    return 0;
+}
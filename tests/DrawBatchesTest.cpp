@@ -0,0 +1,205 @@
+/*
+ * Copyright (c) 2025-present Henri Michelon
+ *
+ * This software is released under the MIT License.
+ * https://opensource.org/licenses/MIT
+*/
+import std;
+import lysa.draw_batches;
+import lysa.types;
+
+using namespace lysa;
+
+namespace {
+
+    using Command = DrawBatches::Command;
+
+    uint32 failures{0};
+
+    void check(const bool condition, const std::string& message,
+               const std::source_location location = std::source_location::current()) {
+        if (!condition) {
+            std::println(std::cerr, "{}:{}: {}", location.file_name(), location.line(), message);
+            failures += 1;
+        }
+    }
+
+    struct Surface {
+        uint32 meshSurfaceIndex;
+        uint32 materialIndex;
+        uint32 indexCount;
+        uint32 firstIndex;
+        int32  vertexOffset;
+    };
+
+    // Adds one draw command per surface, the instance index being the position in the list
+    std::vector<Command> addCommands(DrawBatches& batches, const std::vector<Surface>& surfaces) {
+        auto commands = std::vector<Command>{};
+        for (const auto& surface : surfaces) {
+            const auto id = static_cast<uint32>(commands.size());
+            batches.add(surface.meshSurfaceIndex, surface.materialIndex, id,
+                surface.indexCount, surface.firstIndex, surface.vertexOffset);
+            commands.push_back({
+                .instanceIndex = id,
+                .indexCount = surface.indexCount,
+                .instanceCount = 1,
+                .firstIndex = surface.firstIndex,
+                .vertexOffset = surface.vertexOffset,
+                .firstInstance = id,
+            });
+        }
+        batches.updateRanges();
+        return commands;
+    }
+
+    // The output draws exactly the culled commands, each one with the indices of its mesh surface
+    void checkCompaction(const DrawBatches& batches, const std::vector<Command>& culled, const std::string& step) {
+        auto output = std::vector<Command>{};
+        auto instanceIndices = std::vector<uint32>{};
+        batches.compact(culled, output, instanceIndices);
+
+        auto culledCommands = std::unordered_map<uint32, const Command*>{};
+        for (const auto& command : culled) {
+            culledCommands[command.instanceIndex] = &command;
+        }
+        auto drawn = std::multiset<uint32>{};
+        auto wrongCommands = 0;
+        auto wrongInstances = 0;
+        for (const auto& command : output) {
+            wrongCommands += (command.instanceIndex & DrawBatches::INDIRECT_INSTANCE) == 0 ||
+                command.firstInstance != command.instanceIndex ||
+                command.instanceCount == 0 ||
+                command.instanceCount > batches.getMaxInstancesPerBatch() ? 1 : 0;
+            const auto first = command.instanceIndex & ~DrawBatches::INDIRECT_INSTANCE;
+            for (auto i = 0u; i < command.instanceCount; i++) {
+                const auto instance = instanceIndices[first + i];
+                const auto it = culledCommands.find(instance);
+                wrongInstances += it == culledCommands.end() ||
+                    it->second->indexCount != command.indexCount ||
+                    it->second->firstIndex != command.firstIndex ||
+                    it->second->vertexOffset != command.vertexOffset ? 1 : 0;
+                drawn.insert(instance);
+            }
+        }
+        auto expected = std::multiset<uint32>{};
+        for (const auto& command : culled) {
+            expected.insert(command.instanceIndex);
+        }
+        check(wrongCommands == 0, std::format("{}: {} output commands are not instanced draws of a batch", step, wrongCommands));
+        check(wrongInstances == 0, std::format("{}: {} instances drawn with another mesh surface", step, wrongInstances));
+        check(drawn == expected, std::format("{}: {} instances drawn for {} culled commands", step, drawn.size(), expected.size()));
+    }
+
+    // The draw commands are batched by mesh surface and material only
+    void batchingKey() {
+        auto batches = DrawBatches{};
+        const auto commands = addCommands(batches, {
+            { 0, 0, 36, 0, 0 },
+            { 0, 0, 36, 0, 0 },
+            { 0, 1, 36, 0, 0 },     // same surface, other material
+            { 1, 0, 72, 36, 24 },   // other surface, same material
+            { 0, 1, 36, 0, 0 },
+            { 1, 0, 72, 36, 24 },
+            { 0, 0, 36, 0, 0 },
+        });
+        const auto& list = batches.getBatches();
+        const auto& instanceBatches = batches.getInstanceBatches();
+        check(list.size() == 3, std::format("{} batches instead of 3", list.size()));
+        check(instanceBatches == std::vector<uint32>{0, 0, 1, 2, 1, 2, 0}, "batch of each draw command");
+        check(list[0].instancesCount == 3 && list[1].instancesCount == 2 && list[2].instancesCount == 2, "draw commands per batch");
+        check(list[2].indexCount == 72 && list[2].firstIndex == 36 && list[2].vertexOffset == 24, "indices of the mesh surface of a batch");
+        check(list[0].firstInstance == 0 && list[1].firstInstance == 3 && list[2].firstInstance == 5, "contiguous ranges of the batches");
+        check(batches.getInstancesCount() == 7, "one instance index per draw command");
+
+        checkCompaction(batches, commands, "all visible");
+        auto output = std::vector<Command>{};
+        auto instanceIndices = std::vector<uint32>{};
+        batches.compact(commands, output, instanceIndices);
+        check(output.size() == 3, "one draw per batch");
+        check(instanceIndices == std::vector<uint32>{0, 1, 6, 2, 4, 3, 5}, "instances gathered in the ranges of their batch");
+
+        // Only the batches with visible instances are drawn
+        const auto culled = std::vector{commands[3], commands[6]};
+        checkCompaction(batches, culled, "two visible");
+        batches.compact(culled, output, instanceIndices);
+        check(output.size() == 2, "batch without visible instance not drawn");
+        batches.compact({}, output, instanceIndices);
+        check(output.empty(), "nothing drawn when everything is culled");
+
+        batches.clear();
+        check(batches.getBatches().empty() && batches.getInstanceBatches().empty() && batches.getInstancesCount() == 0,
+              "clear() removes the batches");
+        addCommands(batches, { { 1, 0, 72, 36, 24 } });
+        check(batches.getBatches().size() == 1 && batches.getBatches()[0].firstInstance == 0, "batches rebuilt after clear()");
+    }
+
+    // The draw commands after the maximum of a batch go to a new batch of the same surface
+    void instancesCountOverflow() {
+        auto batches = DrawBatches{4};
+        auto surfaces = std::vector<Surface>{};
+        for (auto i = 0; i < 10; i++) {
+            surfaces.push_back({ 0, 0, 36, 0, 0 });
+            if (i % 3 == 0) {
+                surfaces.push_back({ 1, 0, 72, 36, 24 });
+            }
+        }
+        const auto commands = addCommands(batches, surfaces);
+        const auto& list = batches.getBatches();
+        auto counts = std::vector<uint32>{};
+        for (const auto& batch : list) {
+            counts.push_back(batch.instancesCount);
+        }
+        check(counts == std::vector<uint32>{4, 4, 4, 2}, "10 draws of a surface split in 4, 4 and 2, 4 draws of the other one");
+        check(list[2].indexCount == 36 && list[3].indexCount == 36 && list[1].indexCount == 72, "split batches of the same surface");
+        check(list[0].firstInstance == 0 && list[1].firstInstance == 4 && list[2].firstInstance == 8 && list[3].firstInstance == 12,
+              "ranges of the split batches");
+        checkCompaction(batches, commands, "split batches");
+        auto output = std::vector<Command>{};
+        auto instanceIndices = std::vector<uint32>{};
+        batches.compact(commands, output, instanceIndices);
+        check(output.size() == 4, "one draw per split batch");
+
+        check(DrawBatches{0}.getMaxInstancesPerBatch() == 1, "batches of at least one draw command");
+        check(DrawBatches{}.getMaxInstancesPerBatch() == DrawBatches::MAX_INSTANCES_PER_BATCH, "default maximum");
+    }
+
+    // Foliage-like pipeline : a few meshes and materials, many instances, random culling
+    void randomCulling() {
+        auto random = std::mt19937{42};
+        auto surface = std::uniform_int_distribution{0u, 5u};
+        auto material = std::uniform_int_distribution{0u, 2u};
+        auto visible = std::bernoulli_distribution{0.4};
+        auto batches = DrawBatches{500};
+        auto surfaces = std::vector<Surface>{};
+        for (auto i = 0; i < 20000; i++) {
+            const auto index = surface(random);
+            surfaces.push_back({ index, material(random), 36 * (index + 1), 1000 * index, static_cast<int32>(100 * index) });
+        }
+        const auto commands = addCommands(batches, surfaces);
+        check(batches.getBatches().size() >= 20000 / 500, "batches split at 500 draw commands");
+        check(std::ranges::all_of(batches.getBatches(), [](const auto& batch) { return batch.instancesCount <= 500; }),
+              "no batch larger than the maximum");
+        for (auto round = 0; round < 10; round++) {
+            auto culled = std::vector<Command>{};
+            for (const auto& command : commands) {
+                if (visible(random)) {
+                    culled.push_back(command);
+                }
+            }
+            std::ranges::shuffle(culled, random);
+            checkCompaction(batches, culled, std::format("round {}", round));
+        }
+    }
+
+}
+
+int main() {
+    batchingKey();
+    instancesCountOverflow();
+    randomCulling();
+    if (failures > 0) {
+        std::println(std::cerr, "{} checks failed", failures);
+        return 1;
+    }
+    return 0;
+}
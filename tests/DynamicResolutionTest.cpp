@@ -0,0 +1,165 @@
+/*
+ * Copyright (c) 2025-present Henri Michelon
+ *
+ * This software is released under the MIT License.
+ * https://opensource.org/licenses/MIT
+*/
+import std;
+import vireo;
+import lysa.renderers.dynamic_resolution;
+import lysa.types;
+
+using namespace lysa;
+
+namespace {
+
+    constexpr auto TARGET{1000.0 / 60.0};
+
+    uint32 failures{0};
+
+    void check(const bool condition, const std::string& message,
+               const std::source_location location = std::source_location::current()) {
+        if (!condition) {
+            std::println(std::cerr, "{}:{}: {}", location.file_name(), location.line(), message);
+            failures += 1;
+        }
+    }
+
+    bool near(const float a, const float b) {
+        return std::fabs(a - b) < 1.0e-4f;
+    }
+
+    DynamicResolutionConfiguration createConfig() {
+        auto config = DynamicResolutionConfiguration{};
+        config.enabled = true;
+        config.targetFrameTime = TARGET;
+        return config;
+    }
+
+    // Simulated GPU bound frames : the frame time is proportional to the number of pixels
+    // Returns the number of scale changes
+    uint32 run(DynamicResolution& controller, const double fullScaleFrameTime, const uint32 framesCount) {
+        auto changes = 0u;
+        for (auto i = 0u; i < framesCount; i++) {
+            const auto scale = static_cast<double>(controller.getScale());
+            if (controller.update(fullScaleFrameTime * scale * scale)) {
+                changes += 1;
+            }
+        }
+        return changes;
+    }
+
+    // The scale reaches the largest step under the target frame time and stays there
+    void convergence() {
+        const auto interval = createConfig().adjustmentInterval;
+        auto controller = DynamicResolution{createConfig()};
+        check(near(controller.getScale(), 1.0f), "starts at the maximum scale");
+        // 30 ms at full scale : 0.70 gives 14.7 ms, 0.75 gives 16.9 ms
+        const auto changes = run(controller, 30.0, interval);
+        check(changes == 1 && near(controller.getScale(), 0.70f), "estimated scale reached in one change");
+        check(run(controller, 30.0, 1000) == 0, "stable once converged");
+        check(near(controller.getScale(), 0.70f), "largest scale under the target frame time");
+        check(std::fabs(controller.getAverageFrameTime() - 30.0 * 0.7 * 0.7) < 0.01, "average of the frames at the scale");
+
+        // A lighter scene raises the scale by one step per adjustment interval, up to the maximum
+        check(run(controller, 10.0, interval) == 1 && near(controller.getScale(), 0.75f), "one step up in one interval");
+        run(controller, 10.0, 1000);
+        check(near(controller.getScale(), 1.0f), "back to the maximum scale");
+    }
+
+    // The scale does not change between the adjustments nor in the headroom band
+    void hysteresis() {
+        const auto config = createConfig();
+        auto controller = DynamicResolution{config};
+        auto changed = false;
+        for (auto i = 1u; i < config.adjustmentInterval; i++) {
+            changed |= controller.update(25.0);
+        }
+        check(!changed && near(controller.getScale(), 1.0f), "no change before the adjustment interval");
+        check(controller.update(25.0), "change at the adjustment interval");
+        const auto scale = controller.getScale();
+        check(near(scale, 0.8f), "scale of the slow frames");
+        check(std::fabs(controller.getAverageFrameTime() - 25.0 * 0.8 * 0.8) < 0.01, "frame time estimated at the new scale");
+        // Still over the target : the frame times do not follow the scale
+        changed = false;
+        for (auto i = 1u; i < config.adjustmentInterval; i++) {
+            changed |= controller.update(25.0);
+        }
+        check(!changed && near(controller.getScale(), scale), "no change before the next adjustment interval");
+        check(controller.update(25.0) && controller.getScale() < scale, "change at the next adjustment interval");
+
+        // Between targetFrameTime * headroom and targetFrameTime the scale is kept
+        auto steady = DynamicResolution{config};
+        run(steady, TARGET * 1.5, 1000);
+        const auto steadyScale = steady.getScale();
+        auto changes = 0u;
+        for (auto i = 0u; i < 1000; i++) {
+            // Frame times alternating around the middle of the band
+            const auto frameTime = TARGET * (i % 2 == 0 ? 0.88 : 0.98);
+            if (steady.update(frameTime)) { changes += 1; }
+        }
+        check(changes == 0 && near(steady.getScale(), steadyScale), "no change in the headroom band");
+
+        // The smoothing ignores a single spike
+        for (auto i = 0u; i < config.adjustmentInterval * 2; i++) {
+            const auto frameTime = i == config.adjustmentInterval ? TARGET * 1.5 : TARGET * 0.9;
+            if (steady.update(frameTime)) { changes += 1; }
+        }
+        check(changes == 0, "no change for one slow frame");
+    }
+
+    // The scale stays between the minimum and maximum scales, on multiples of the step
+    void clamping() {
+        auto config = createConfig();
+        config.minScale = 0.5f;
+        config.maxScale = 0.9f;
+        config.scaleStep = 0.1f;
+        auto controller = DynamicResolution{config};
+        check(near(controller.getScale(), 0.9f) && near(controller.getMaxScale(), 0.9f), "starts at the maximum scale");
+        run(controller, 1000.0, 1000);
+        check(near(controller.getScale(), 0.5f), "clamped to the minimum scale");
+        run(controller, 1.0, 1000);
+        check(near(controller.getScale(), 0.9f), "clamped to the maximum scale");
+
+        // Scales which are not multiples of the step are rounded inside the range
+        config.minScale = 0.33f;
+        config.maxScale = 0.97f;
+        config.scaleStep = 0.25f;
+        auto rounded = DynamicResolution{config};
+        check(near(rounded.getMaxScale(), 0.75f) && near(rounded.getScale(), 0.75f), "maximum scale rounded down to a step");
+        run(rounded, 1000.0, 1000);
+        check(near(rounded.getScale(), 0.5f), "minimum scale rounded up to a step");
+    }
+
+    // The attachments are allocated at the maximum scale, the rendered extent follows the scale
+    void extents() {
+        const auto extent = vireo::Extent{1920, 1080};
+        auto config = createConfig();
+        config.maxScale = 0.8f;
+        auto controller = DynamicResolution{config};
+        const auto maxExtent = controller.getMaxExtent(extent);
+        check(maxExtent.width == 1536 && maxExtent.height == 864, "extent of the attachments");
+        run(controller, 40.0, 1000);
+        const auto renderExtent = controller.getExtent(extent);
+        check(renderExtent.width < maxExtent.width && renderExtent.height < maxExtent.height, "rendered part smaller than the attachments");
+        check(controller.getMaxExtent(extent).width == maxExtent.width, "attachments kept when the scale changes");
+
+        const auto odd = DynamicResolution::scale(vireo::Extent{101, 3}, 0.5f);
+        check(odd.width == 51 && odd.height == 2, "rounded to the nearest pixel");
+        const auto tiny = DynamicResolution::scale(vireo::Extent{1, 1}, 0.1f);
+        check(tiny.width == 1 && tiny.height == 1, "at least one pixel");
+    }
+
+}
+
+int main() {
+    convergence();
+    hysteresis();
+    clamping();
+    extents();
+    if (failures > 0) {
+        std::println(std::cerr, "{} checks failed", failures);
+        return 1;
+    }
+    return 0;
+}
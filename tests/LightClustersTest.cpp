@@ -0,0 +1,205 @@
+/*
+ * Copyright (c) 2025-present Henri Michelon
+ *
+ * This software is released under the MIT License.
+ * https://opensource.org/licenses/MIT
+*/
+import std;
+import lysa.light_clusters;
+import lysa.math;
+
+using namespace lysa;
+
+namespace {
+
+    constexpr auto NEAR{0.1f};
+    constexpr auto FAR{100.0f};
+
+    uint32 failures{0};
+
+    void check(const bool condition, const std::string& message,
+               const std::source_location location = std::source_location::current()) {
+        if (!condition) {
+            std::println(std::cerr, "{}:{}: {}", location.file_name(), location.line(), message);
+            failures += 1;
+        }
+    }
+
+    uint32 getCluster(const uint32 x, const uint32 y, const uint32 slice) {
+        return (slice * LightClusters::TILES_Y + y) * LightClusters::TILES_X + x;
+    }
+
+    float getSliceNear(const uint32 slice) {
+        return NEAR * std::pow(FAR / NEAR, static_cast<float>(slice) / LightClusters::SLICES);
+    }
+
+    // View space position at a distance of the camera plane on the line of a NDC position
+    float3 getViewPosition(const float2& ndc, const float depth, const float4x4& inverseProjection) {
+        const float4 nearPoint = mul(float4{ndc, 0.0f, 1.0f}, inverseProjection);
+        const float4 farPoint = mul(float4{ndc, 1.0f, 1.0f}, inverseProjection);
+        const float3 start = nearPoint.xyz / nearPoint.w;
+        const float3 end = farPoint.xyz / farPoint.w;
+        const float t = (-depth - start.z) / (end.z - start.z);
+        return start + (end - start) * t;
+    }
+
+    bool contains(const LightClusters& clusters, const uint32 cluster, const uint32 light) {
+        for (auto i = 0u; i < clusters.getLightsCount(cluster); i++) {
+            if (clusters.getLight(cluster, i) == light) { return true; }
+        }
+        return false;
+    }
+
+    // The cluster of a position contains it, whatever the tile or slice
+    void indexAgreesWithBounds() {
+        auto random = std::mt19937{42};
+        auto ndc = std::uniform_real_distribution{-0.999f, 0.999f};
+        auto exponent = std::uniform_real_distribution{0.001f, 0.999f};
+        const auto projection = perspective(radians(75.0f), 16.0f / 9.0f, NEAR, FAR);
+        const auto inverseProjection = inverse(projection);
+        auto outside = 0;
+        for (auto i = 0; i < 5000; i++) {
+            const auto position = float2{ndc(random), ndc(random)};
+            const auto depth = NEAR * std::pow(FAR / NEAR, exponent(random));
+            const auto cluster = LightClusters::getClusterIndex(position, depth, NEAR, FAR);
+            const auto x = cluster % LightClusters::TILES_X;
+            const auto y = (cluster / LightClusters::TILES_X) % LightClusters::TILES_Y;
+            const auto slice = cluster / (LightClusters::TILES_X * LightClusters::TILES_Y);
+            float3 min, max;
+            LightClusters::getClusterBounds(x, y, slice, inverseProjection, NEAR, FAR, min, max);
+            const float3 point = getViewPosition(position, depth, inverseProjection);
+            const float3 toNearest = clamp(point, min, max) - point;
+            outside += static_cast<float>(dot(toNearest, toNearest)) > 1e-6f * depth * depth ? 1 : 0;
+        }
+        check(outside == 0, std::format("{} positions outside the bounds of their cluster", outside));
+
+        check(LightClusters::getClusterIndex(float2{-1.0f, -1.0f}, NEAR, NEAR, FAR) == 0, "first cluster at the near plane");
+        check(LightClusters::getClusterIndex(float2{1.0f, 1.0f}, FAR, NEAR, FAR) == LightClusters::COUNT - 1,
+              "last cluster at the far plane");
+        check(LightClusters::getClusterIndex(float2{-2.0f, 3.0f}, NEAR * 0.5f, NEAR, FAR) == getCluster(0, LightClusters::TILES_Y - 1, 0),
+              "positions out of the frustum clamped to the border clusters");
+        check(LightClusters::getClusterIndex(float2{0.0f, 0.0f}, getSliceNear(10) * 1.001f, NEAR, FAR) ==
+              getCluster(LightClusters::TILES_X / 2, LightClusters::TILES_Y / 2, 10), "depth just after the start of a slice");
+    }
+
+    // A small light on the plane between two tiles or two slices lights both clusters, not the next ones
+    void lightsOnClustersBoundaries() {
+        const auto projection = perspective(radians(75.0f), 16.0f / 9.0f, NEAR, FAR);
+        const auto inverseProjection = inverse(projection);
+        const auto tileWidth = 2.0f / LightClusters::TILES_X;
+        const auto tileHeight = 2.0f / LightClusters::TILES_Y;
+        const auto sliceDepth = std::sqrt(getSliceNear(10) * getSliceNear(11));
+        const auto range = 0.001f;
+
+        // Between the tiles 7 and 8 of the slice 10
+        const auto betweenTiles = getViewPosition(float2{-1.0f + 8 * tileWidth, -1.0f + 4.5f * tileHeight}, sliceDepth, inverseProjection);
+        // Between the tiles 4 and 5 of the slice 10
+        const auto betweenRows = getViewPosition(float2{-1.0f + 2.5f * tileWidth, -1.0f + 5 * tileHeight}, sliceDepth, inverseProjection);
+        // Between the slices 10 and 11 of the tile 3, 2
+        const auto betweenSlices = getViewPosition(float2{-1.0f + 3.5f * tileWidth, -1.0f + 2.5f * tileHeight}, getSliceNear(11), inverseProjection);
+        // At the center of the cluster 12, 6, 15
+        const auto inside = getViewPosition(
+            float2{-1.0f + 12.5f * tileWidth, -1.0f + 6.5f * tileHeight},
+            std::sqrt(getSliceNear(15) * getSliceNear(16)),
+            inverseProjection);
+
+        auto clusters = LightClusters{};
+        clusters.build(
+            { float4{betweenTiles, range}, float4{betweenRows, range}, float4{betweenSlices, range}, float4{inside, range} },
+            float4x4::identity(), projection, NEAR, FAR);
+
+        check(contains(clusters, getCluster(7, 4, 10), 0) && contains(clusters, getCluster(8, 4, 10), 0),
+              "light between two tiles in both clusters");
+        check(!contains(clusters, getCluster(6, 4, 10), 0) && !contains(clusters, getCluster(9, 4, 10), 0),
+              "light between two tiles not in the next tiles");
+        check(!contains(clusters, getCluster(7, 4, 8), 0) && !contains(clusters, getCluster(8, 4, 12), 0),
+              "light between two tiles not in the other slices");
+        check(contains(clusters, getCluster(2, 4, 10), 1) && contains(clusters, getCluster(2, 5, 10), 1),
+              "light between two rows in both clusters");
+        check(!contains(clusters, getCluster(2, 3, 10), 1) && !contains(clusters, getCluster(2, 6, 10), 1),
+              "light between two rows not in the next rows");
+        check(contains(clusters, getCluster(3, 2, 10), 2) && contains(clusters, getCluster(3, 2, 11), 2),
+              "light between two slices in both clusters");
+        check(!contains(clusters, getCluster(3, 2, 9), 2) && !contains(clusters, getCluster(3, 2, 12), 2),
+              "light between two slices not in the next slices");
+        check(contains(clusters, getCluster(12, 6, 15), 3), "light inside a cluster");
+        check(!contains(clusters, getCluster(10, 6, 15), 3) && !contains(clusters, getCluster(12, 6, 13), 3),
+              "light inside a cluster not in the far clusters");
+
+        // Each light is in the cluster given by its position
+        const auto positions = std::array{betweenTiles, betweenRows, betweenSlices, inside};
+        auto wrong = 0;
+        for (auto i = 0u; i < positions.size(); i++) {
+            const auto& position = positions[i];
+            const float4 clip = mul(float4{position, 1.0f}, projection);
+            const auto cluster = LightClusters::getClusterIndex(clip.xy / clip.w, -static_cast<float>(position.z), NEAR, FAR);
+            wrong += contains(clusters, cluster, i) ? 0 : 1;
+        }
+        check(wrong == 0, std::format("{} lights not in the cluster of their position", wrong));
+
+        // Same lights seen from a moved camera
+        const auto eye = float3{3.0f, 1.0f, 4.0f};
+        const auto view = look_at(eye, eye + float3{0.0f, 0.0f, -1.0f}, AXIS_UP);
+        auto moved = LightClusters{};
+        moved.build(
+            { float4{positions[0] + eye, range}, float4{positions[1] + eye, range}, float4{positions[2] + eye, range}, float4{positions[3] + eye, range} },
+            view, projection, NEAR, FAR);
+        auto differences = 0;
+        for (auto cluster = 0u; cluster < LightClusters::COUNT; cluster++) {
+            differences += clusters.getLightsCount(cluster) != moved.getLightsCount(cluster) ? 1 : 0;
+        }
+        check(differences == 0, std::format("{} clusters differ with the lights in world space", differences));
+    }
+
+    // Directional lights are in all the clusters, the empty slots in none of them
+    void directionalAndEmptyLights() {
+        const auto projection = perspective(radians(60.0f), 1.0f, NEAR, FAR);
+        auto clusters = LightClusters{};
+        clusters.build(
+            { float4{0.0f, 0.0f, -10.0f, 0.0f}, float4{0.0f, 0.0f, 0.0f, -1.0f}, float4{0.0f, 0.0f, -10.0f, 0.0f},
+              float4{0.0f, 0.0f, -10.0f, 1.0f}, float4{5.0f, 5.0f, 5.0f, -1.0f} },
+            float4x4::identity(), projection, NEAR, FAR);
+        check(clusters.getData().size() == LightClusters::COUNT * LightClusters::CLUSTER_STRIDE, "size of the clusters array");
+        auto withoutDirectional = 0;
+        auto withEmpty = 0;
+        auto withPoint = 0;
+        for (auto cluster = 0u; cluster < LightClusters::COUNT; cluster++) {
+            const auto count = clusters.getLightsCount(cluster);
+            withoutDirectional += count < 2 || clusters.getLight(cluster, 0) != 1 || clusters.getLight(cluster, count - 1) != 4 ? 1 : 0;
+            withEmpty += contains(clusters, cluster, 0) || contains(clusters, cluster, 2) ? 1 : 0;
+            withPoint += contains(clusters, cluster, 3) ? 1 : 0;
+        }
+        check(withoutDirectional == 0, std::format("{} clusters without the directional lights in order", withoutDirectional));
+        check(withEmpty == 0, std::format("{} clusters with an empty slot", withEmpty));
+        check(withPoint > 0 && withPoint < LightClusters::COUNT / 10, "the point light is in a few clusters");
+    }
+
+    // The lights after MAX_LIGHTS_PER_CLUSTER are ignored
+    void clusterCapacity() {
+        const auto projection = perspective(radians(60.0f), 1.0f, NEAR, FAR);
+        auto lights = std::vector<float4>(LightClusters::MAX_LIGHTS_PER_CLUSTER + 45, float4{0.0f, 0.0f, 0.0f, -1.0f});
+        lights[10].w = 0.0f;
+        auto clusters = LightClusters{};
+        clusters.build(lights, float4x4::identity(), projection, NEAR, FAR);
+        auto wrong = 0;
+        for (auto cluster = 0u; cluster < LightClusters::COUNT; cluster++) {
+            wrong += clusters.getLightsCount(cluster) != LightClusters::MAX_LIGHTS_PER_CLUSTER ? 1 : 0;
+            wrong += clusters.getLight(cluster, 10) != 11 ? 1 : 0;
+            wrong += clusters.getLight(cluster, LightClusters::MAX_LIGHTS_PER_CLUSTER - 1) != LightClusters::MAX_LIGHTS_PER_CLUSTER ? 1 : 0;
+        }
+        check(wrong == 0, std::format("{} clusters not capped to the first {} lights", wrong, LightClusters::MAX_LIGHTS_PER_CLUSTER));
+    }
+
+}
+
+int main() {
+    indexAgreesWithBounds();
+    lightsOnClustersBoundaries();
+    directionalAndEmptyLights();
+    clusterCapacity();
+    if (failures > 0) {
+        std::println(std::cerr, "{} checks failed", failures);
+        return 1;
+    }
+    return 0;
+}
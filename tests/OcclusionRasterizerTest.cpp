@@ -0,0 +1,211 @@
+/*
+ * Copyright (c) 2025-present Henri Michelon
+ *
+ * This software is released under the MIT License.
+ * https://opensource.org/licenses/MIT
+*/
+import std;
+import lysa.aabb;
+import lysa.math;
+import lysa.occlusion_rasterizer;
+
+using namespace lysa;
+
+namespace {
+
+    constexpr auto WIDTH{64u};
+    constexpr auto HEIGHT{32u};
+
+    uint32 failures{0};
+
+    void check(const bool condition, const std::string& message,
+               const std::source_location location = std::source_location::current()) {
+        if (!condition) {
+            std::println(std::cerr, "{}:{}: {}", location.file_name(), location.line(), message);
+            failures += 1;
+        }
+    }
+
+    bool near(const float a, const float b) {
+        return std::fabs(a - b) < 1.0e-4f;
+    }
+
+    // Quad of two triangles, counterclockwise when seen from +Z
+    struct Quad {
+        std::vector<float3> positions;
+        std::vector<uint32> indices{ 0, 1, 2, 0, 2, 3 };
+
+        Quad(const float minX, const float minY, const float maxX, const float maxY, const float z) :
+            Quad(minX, minY, maxX, maxY, z, z) {}
+
+        // Depth going from zLeft on the left side to zRight on the right side
+        Quad(const float minX, const float minY, const float maxX, const float maxY, const float zLeft, const float zRight) :
+            positions{
+                float3{minX, minY, zLeft}, float3{maxX, minY, zRight},
+                float3{maxX, maxY, zRight}, float3{minX, maxY, zLeft} } {}
+    };
+
+    // With an identity view projection the world coordinates are the normalized device coordinates
+    void render(OcclusionRasterizer& rasterizer, const std::vector<Quad>& quads,
+                const float4x4& transform = float4x4::identity()) {
+        rasterizer.begin(float4x4::identity());
+        for (const auto& quad : quads) {
+            rasterizer.renderOccluder(quad.positions, quad.indices, transform);
+        }
+        rasterizer.end();
+    }
+
+    bool allDepths(const OcclusionRasterizer& rasterizer, const float value) {
+        for (auto y = 0u; y < rasterizer.getHeight(); y++) {
+            for (auto x = 0u; x < rasterizer.getWidth(); x++) {
+                if (!near(rasterizer.getDepth(x, y), value)) { return false; }
+            }
+        }
+        return true;
+    }
+
+    // The depth buffer is rounded up to whole tiles and cleared to the far plane
+    void creation() {
+        const auto rasterizer = OcclusionRasterizer{61, 30};
+        check(rasterizer.getWidth() == 64 && rasterizer.getHeight() == 32, "size rounded up to the tiles");
+        check(allDepths(rasterizer, 1.0f), "cleared to the far plane");
+        const auto tiny = OcclusionRasterizer{0, 0};
+        check(tiny.getWidth() == OcclusionRasterizer::TILE_WIDTH &&
+              tiny.getHeight() == OcclusionRasterizer::TILE_HEIGHT, "at least one tile");
+    }
+
+    // A quad covering the screen hides the boxes behind it only
+    void fullScreenOccluder() {
+        auto rasterizer = OcclusionRasterizer{WIDTH, HEIGHT};
+        render(rasterizer, { Quad{-2.0f, -2.0f, 2.0f, 2.0f, 0.5f} });
+        check(allDepths(rasterizer, 0.5f), "depth of the quad in all the pixels");
+        check(rasterizer.getStatistics().trianglesRasterized == 2, "two triangles rasterized");
+        check(rasterizer.isOccluded(AABB{float3{-0.5f, -0.5f, 0.6f}, float3{0.5f, 0.5f, 0.9f}}), "box behind the quad");
+        check(rasterizer.isOccluded(AABB{float3{-0.01f, -0.01f, 0.6f}, float3{0.01f, 0.01f, 0.7f}}), "box smaller than a tile");
+        check(rasterizer.isOccluded(AABB{float3{-3.0f, -3.0f, 0.6f}, float3{3.0f, 3.0f, 0.9f}}), "box larger than the screen");
+        check(!rasterizer.isOccluded(AABB{float3{-0.5f, -0.5f, 0.2f}, float3{0.5f, 0.5f, 0.3f}}), "box in front of the quad");
+        check(!rasterizer.isOccluded(AABB{float3{-0.5f, -0.5f, 0.4f}, float3{0.5f, 0.5f, 0.8f}}), "box crossing the quad");
+        check(!rasterizer.isOccluded(AABB{float3{1.5f, -0.5f, 0.6f}, float3{2.0f, 0.5f, 0.9f}}), "box outside of the screen");
+
+        // Both faces are rasterized
+        auto backFace = Quad{-2.0f, -2.0f, 2.0f, 2.0f, 0.5f};
+        backFace.indices = { 0, 2, 1, 0, 3, 2 };
+        rasterizer.begin(float4x4::identity());
+        rasterizer.renderOccluder(backFace.positions, backFace.indices, float4x4::identity());
+        rasterizer.end();
+        check(allDepths(rasterizer, 0.5f), "back faces rasterized");
+
+        // The transform of the occluder is applied
+        render(rasterizer, { Quad{-2.0f, -2.0f, 2.0f, 2.0f, 0.0f} }, float4x4::translation(float3{0.0f, 0.0f, 0.25f}));
+        check(allDepths(rasterizer, 0.25f), "occluder transform");
+
+        // The next frame starts from a cleared buffer
+        rasterizer.begin(float4x4::identity());
+        rasterizer.end();
+        check(allDepths(rasterizer, 1.0f), "cleared by begin()");
+        check(rasterizer.getStatistics().trianglesRasterized == 0, "statistics cleared by begin()");
+        check(!rasterizer.isOccluded(AABB{float3{-0.5f, -0.5f, 0.6f}, float3{0.5f, 0.5f, 0.9f}}), "nothing hidden without occluders");
+    }
+
+    // A box is hidden only if all the pixels it touches are nearer
+    void partialOccluder() {
+        auto rasterizer = OcclusionRasterizer{WIDTH, HEIGHT};
+        // Left half of the screen, pixel columns 0 to 31, minus the eroded column
+        render(rasterizer, { Quad{-2.0f, -2.0f, 0.0f, 2.0f, 0.5f} });
+        check(near(rasterizer.getDepth(30, 10), 0.5f) && near(rasterizer.getDepth(31, 10), 1.0f), "edge of the quad eroded");
+        check(rasterizer.isOccluded(AABB{float3{-0.9f, -0.5f, 0.6f}, float3{-0.1f, 0.5f, 0.9f}}), "box behind the quad");
+        check(!rasterizer.isOccluded(AABB{float3{0.1f, -0.5f, 0.6f}, float3{0.9f, 0.5f, 0.9f}}), "box beside the quad");
+        check(!rasterizer.isOccluded(AABB{float3{-0.5f, -0.5f, 0.6f}, float3{0.1f, 0.5f, 0.9f}}), "box partially behind the quad");
+        // Top half of the screen, pixel rows 0 to 15, minus the eroded row
+        render(rasterizer, { Quad{-2.0f, 0.0f, 2.0f, 2.0f, 0.5f} });
+        check(near(rasterizer.getDepth(10, 14), 0.5f) && near(rasterizer.getDepth(10, 15), 1.0f), "bottom of the quad eroded");
+
+        // A quad in front of another one : the nearest depth is kept
+        render(rasterizer, { Quad{-2.0f, -2.0f, 2.0f, 2.0f, 0.8f}, Quad{-2.0f, -2.0f, 0.0f, 2.0f, 0.3f} });
+        check(near(rasterizer.getDepth(10, 10), 0.3f) && near(rasterizer.getDepth(50, 10), 0.8f), "nearest depth kept");
+        check(rasterizer.isOccluded(AABB{float3{-0.9f, -0.5f, 0.4f}, float3{-0.1f, 0.5f, 0.5f}}), "box between the quads, left side");
+        check(!rasterizer.isOccluded(AABB{float3{0.1f, -0.5f, 0.4f}, float3{0.9f, 0.5f, 0.5f}}), "box between the quads, right side");
+        check(rasterizer.isOccluded(AABB{float3{0.1f, -0.5f, 0.85f}, float3{0.9f, 0.5f, 0.9f}}), "box behind both quads");
+    }
+
+    // The pixels are written only when they and their neighbors are covered, with the farthest
+    // depth of the pixels
+    void conservativeRasterization() {
+        auto rasterizer = OcclusionRasterizer{WIDTH, HEIGHT};
+        // Edges inside the pixels : the centers of the pixel columns 8 to 23 are covered
+        const auto pixelWidth = 2.0f / WIDTH;
+        render(rasterizer, { Quad{-1.0f + 7.6f * pixelWidth, -2.0f, -1.0f + 24.4f * pixelWidth, 2.0f, 0.5f} });
+        check(near(rasterizer.getDepth(7, 10), 1.0f) && near(rasterizer.getDepth(24, 10), 1.0f), "partially covered pixels not written");
+        check(near(rasterizer.getDepth(8, 10), 1.0f) && near(rasterizer.getDepth(23, 10), 1.0f), "coverage eroded by one pixel");
+        check(near(rasterizer.getDepth(9, 10), 0.5f) && near(rasterizer.getDepth(22, 10), 0.5f), "inner pixels written");
+
+        // Thinner than a pixel : nothing written
+        render(rasterizer, { Quad{-1.0f + 8.2f * pixelWidth, -2.0f, -1.0f + 8.8f * pixelWidth, 2.0f, 0.5f} });
+        check(allDepths(rasterizer, 1.0f), "occluder thinner than a pixel");
+        check(rasterizer.getStatistics().trianglesRasterized == 2, "thin triangles rasterized");
+
+        // Sloped quad, from 0.25 on the left side of the screen to 0.75 on the right side : the
+        // farthest depth is on the right side of the right neighbor
+        render(rasterizer, { Quad{-2.0f, -2.0f, 2.0f, 2.0f, 0.0f, 1.0f} });
+        auto farthest = true;
+        for (auto x = 0u; x < WIDTH; x++) {
+            const auto right = 0.25f + 0.5f * static_cast<float>(x + 2) / WIDTH;
+            farthest &= near(rasterizer.getDepth(x, 10), right);
+        }
+        check(farthest, "farthest depth of the pixels");
+        // The farthest depth of the pixels is never farther than the triangle
+        render(rasterizer, { Quad{-2.0f, -2.0f, 2.0f, 2.0f, 0.5f, 0.5001f} });
+        check(rasterizer.getDepth(WIDTH - 1, 10) <= 0.5001f, "clamped to the farthest vertex");
+    }
+
+    // The triangles which can't be rasterized are counted
+    void skippedTriangles() {
+        auto rasterizer = OcclusionRasterizer{WIDTH, HEIGHT};
+        // Vertex in front of the near plane
+        auto crossing = Quad{-2.0f, -2.0f, 2.0f, 2.0f, 0.5f};
+        crossing.positions[0].z = -2.0f;
+        render(rasterizer, { crossing });
+        check(rasterizer.getStatistics().trianglesSkipped == 2 &&
+              rasterizer.getStatistics().trianglesRasterized == 0, "triangles crossing the near plane");
+        check(allDepths(rasterizer, 1.0f), "nothing written for the skipped triangles");
+
+        render(rasterizer, { Quad{2.0f, 2.0f, 3.0f, 3.0f, 0.5f} });
+        check(rasterizer.getStatistics().trianglesSkipped == 2, "triangles outside of the screen");
+
+        auto degenerated = Quad{-2.0f, -2.0f, 2.0f, 2.0f, 0.5f};
+        degenerated.indices = { 0, 1, 1 };
+        render(rasterizer, { degenerated });
+        check(rasterizer.getStatistics().trianglesSkipped == 1, "degenerated triangle");
+    }
+
+    // A wall in front of a perspective camera
+    void perspectiveCamera() {
+        auto rasterizer = OcclusionRasterizer{WIDTH, HEIGHT};
+        const auto view = look_at(float3{0.0f, 0.0f, 0.0f}, float3{0.0f, 0.0f, -1.0f}, AXIS_UP);
+        const auto projection = perspective(radians(60.0f), static_cast<float>(WIDTH) / HEIGHT, 0.1f, 100.0f);
+        rasterizer.begin(mul(view, projection));
+        const auto wall = Quad{-2.0f, -2.0f, 2.0f, 2.0f, -5.0f};
+        rasterizer.renderOccluder(wall.positions, wall.indices, float4x4::identity());
+        rasterizer.end();
+        check(rasterizer.getStatistics().trianglesRasterized == 2, "wall rasterized");
+        check(rasterizer.isOccluded(AABB{float3{-0.5f, -0.5f, -10.0f}, float3{0.5f, 0.5f, -9.0f}}), "box behind the wall");
+        check(!rasterizer.isOccluded(AABB{float3{-0.5f, -0.5f, -4.0f}, float3{0.5f, 0.5f, -3.0f}}), "box in front of the wall");
+        check(!rasterizer.isOccluded(AABB{float3{5.0f, -0.5f, -10.0f}, float3{6.0f, 0.5f, -9.0f}}), "box beside the wall");
+        check(!rasterizer.isOccluded(AABB{float3{-0.5f, -0.5f, -10.0f}, float3{0.5f, 0.5f, 1.0f}}), "box around the camera");
+    }
+
+}
+
+int main() {
+    creation();
+    fullScreenOccluder();
+    partialOccluder();
+    conservativeRasterization();
+    skippedTriangles();
+    perspectiveCamera();
+    if (failures > 0) {
+        std::println(std::cerr, "{} checks failed", failures);
+        return 1;
+    }
+    return 0;
+}
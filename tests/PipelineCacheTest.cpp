@@ -0,0 +1,167 @@
+/*
+ * Copyright (c) 2025-present Henri Michelon
+ *
+ * This software is released under the MIT License.
+ * https://opensource.org/licenses/MIT
+*/
+import std;
+import lysa.pipeline_cache;
+import lysa.types;
+
+using namespace lysa;
+
+namespace {
+
+    using Device = PipelineCache::Device;
+    using Status = PipelineCache::Status;
+
+    uint32 failures{0};
+
+    void check(const bool condition, const std::string& message,
+               const std::source_location location = std::source_location::current()) {
+        if (!condition) {
+            std::println(std::cerr, "{}:{}: {}", location.file_name(), location.line(), message);
+            failures += 1;
+        }
+    }
+
+    const auto DEVICE = Device{
+        .vendorID = 0x10de,
+        .deviceID = 0x2684,
+        .driverVersion = 0x8a4c8000,
+        .pipelineCacheUUID = { 1, 2, 3, 4, 5, 6, 7, 8, 9, 10, 11, 12, 13, 14, 15, 16 },
+    };
+
+    // Pipeline cache blob of a driver : VkPipelineCacheHeaderVersionOne then the driver data
+    std::vector<char> createBlob(const Device& device, const uint32 dataSize, const uint32 headerSize = 32, const uint32 headerVersion = 1) {
+        auto blob = std::vector<char>(32 + dataSize);
+        const auto header = std::array{ headerSize, headerVersion, device.vendorID, device.deviceID };
+        std::memcpy(blob.data(), header.data(), sizeof(header));
+        std::memcpy(blob.data() + sizeof(header), device.pipelineCacheUUID.data(), PipelineCache::UUID_SIZE);
+        for (auto i = 32u; i < blob.size(); i++) {
+            blob[i] = static_cast<char>(i * 7);
+        }
+        return blob;
+    }
+
+    std::vector<char> readFile(const std::filesystem::path& path) {
+        auto file = std::ifstream(path, std::ios::binary);
+        return { std::istreambuf_iterator<char>(file), std::istreambuf_iterator<char>() };
+    }
+
+    void writeFile(const std::filesystem::path& path, const std::vector<char>& content) {
+        auto file = std::ofstream(path, std::ios::binary | std::ios::trunc);
+        file.write(content.data(), static_cast<std::streamsize>(content.size()));
+    }
+
+    // The Vulkan header of a blob identifies the device
+    void blobValidation() {
+        check(PipelineCache::isValid(createBlob(DEVICE, 1000), DEVICE), "blob of the device");
+        check(PipelineCache::isValid(createBlob(DEVICE, 0), DEVICE), "blob without pipelines");
+        check(!PipelineCache::isValid({}, DEVICE), "empty blob");
+        check(!PipelineCache::isValid(std::vector<char>(31), DEVICE), "blob smaller than the header");
+        check(!PipelineCache::isValid(createBlob(DEVICE, 100, 16), DEVICE), "header size smaller than the header");
+        check(!PipelineCache::isValid(createBlob(DEVICE, 100, 200), DEVICE), "header size larger than the blob");
+        check(!PipelineCache::isValid(createBlob(DEVICE, 100, 32, 2), DEVICE), "unknown header version");
+        auto other = DEVICE;
+        other.vendorID = 0x1002;
+        check(!PipelineCache::isValid(createBlob(other, 100), DEVICE), "blob of another vendor");
+        other = DEVICE;
+        other.deviceID += 1;
+        check(!PipelineCache::isValid(createBlob(other, 100), DEVICE), "blob of another device");
+        other = DEVICE;
+        other.pipelineCacheUUID[15] = 0;
+        check(!PipelineCache::isValid(createBlob(other, 100), DEVICE), "blob of another pipeline cache UUID");
+    }
+
+    // A saved blob is given back to the same device and driver only
+    void saveAndLoad(const std::filesystem::path& directory) {
+        const auto path = directory / "pipelines.cache";
+        auto cold = PipelineCache{path, DEVICE};
+        check(cold.getStatus() == Status::MISSING && cold.getData().empty(), "no file on the first run");
+        const auto blob = createBlob(DEVICE, 5000);
+        cold.setColdTimes(12.0, 345.0);
+        check(cold.save(blob), "blob of the device saved");
+        check(!std::filesystem::exists(path.string() + ".tmp"), "temporary file renamed");
+
+        const auto warm = PipelineCache{path, DEVICE};
+        check(warm.getStatus() == Status::LOADED, "file loaded on the next run");
+        check(warm.getData() == blob, "same blob loaded");
+        check(warm.getColdShadersLoadTime() == 12.0 && warm.getColdStartupTime() == 345.0, "times of the cold run kept");
+
+        // Another driver version or UUID does not get the blob
+        auto newDriver = DEVICE;
+        newDriver.driverVersion += 1;
+        const auto afterUpdate = PipelineCache{path, newDriver};
+        check(afterUpdate.getStatus() == Status::OTHER_DEVICE && afterUpdate.getData().empty(), "blob of another driver version rejected");
+        auto otherUUID = DEVICE;
+        otherUUID.pipelineCacheUUID[0] = 0;
+        check(PipelineCache{path, otherUUID}.getStatus() == Status::OTHER_DEVICE, "blob of another pipeline cache UUID rejected");
+
+        // The next save of the new driver replaces the file
+        auto updated = PipelineCache{path, newDriver};
+        auto otherVendor = DEVICE;
+        otherVendor.vendorID = 0x1002;
+        check(!updated.save(createBlob(otherVendor, 100)), "blob of another device not saved");
+        check(PipelineCache{path, DEVICE}.getStatus() == Status::LOADED, "file kept when the blob is rejected");
+        check(updated.save(createBlob(newDriver, 100)), "blob of the new driver saved");
+        check(PipelineCache{path, newDriver}.getStatus() == Status::LOADED, "file of the new driver loaded");
+        check(PipelineCache{path, DEVICE}.getStatus() == Status::OTHER_DEVICE, "file of the new driver rejected by the previous one");
+
+        check(!PipelineCache{{}, DEVICE}.save(blob), "nothing saved without a file");
+    }
+
+    // Truncated or modified files are ignored
+    void corruptedFiles(const std::filesystem::path& directory) {
+        const auto path = directory / "pipelines.cache";
+        auto cache = PipelineCache{path, DEVICE};
+        check(cache.save(createBlob(DEVICE, 2000)), "blob saved");
+        const auto content = readFile(path);
+
+        auto truncated = content;
+        truncated.resize(content.size() - 10);
+        writeFile(path, truncated);
+        check(PipelineCache{path, DEVICE}.getStatus() == Status::CORRUPTED, "truncated blob");
+        truncated.resize(10);
+        writeFile(path, truncated);
+        check(PipelineCache{path, DEVICE}.getStatus() == Status::CORRUPTED, "truncated header");
+
+        auto longer = content;
+        longer.push_back(0);
+        writeFile(path, longer);
+        check(PipelineCache{path, DEVICE}.getStatus() == Status::CORRUPTED, "data after the blob");
+
+        auto modified = content;
+        modified[content.size() - 100] ^= 1;
+        writeFile(path, modified);
+        const auto rejected = PipelineCache{path, DEVICE};
+        check(rejected.getStatus() == Status::CORRUPTED && rejected.getData().empty(), "modified blob");
+
+        auto badMagic = content;
+        badMagic[0] = 'X';
+        writeFile(path, badMagic);
+        check(PipelineCache{path, DEVICE}.getStatus() == Status::CORRUPTED, "bad magic");
+
+        writeFile(path, {});
+        check(PipelineCache{path, DEVICE}.getStatus() == Status::CORRUPTED, "empty file");
+
+        writeFile(path, content);
+        check(PipelineCache{path, DEVICE}.getStatus() == Status::LOADED, "original file loaded");
+    }
+
+}
+
+int main() {
+    const auto directory = std::filesystem::temp_directory_path() / "lysa_pipeline_cache_test";
+    std::filesystem::remove_all(directory);
+    std::filesystem::create_directories(directory);
+    blobValidation();
+    saveAndLoad(directory);
+    corruptedFiles(directory);
+    std::filesystem::remove_all(directory);
+    if (failures > 0) {
+        std::println(std::cerr, "{} checks failed", failures);
+        return 1;
+    }
+    return 0;
+}
@@ -0,0 +1,158 @@
+/*
+ * Copyright (c) 2025-present Henri Michelon
+ *
+ * This software is released under the MIT License.
+ * https://opensource.org/licenses/MIT
+*/
+import std;
+import vireo;
+import lysa.log;
+import lysa.renderers.pipeline_manifest;
+import lysa.resources.material;
+import lysa.types;
+
+using namespace lysa;
+
+namespace {
+
+    uint32 failures{0};
+
+    void check(const bool condition, const std::string& message,
+               const std::source_location location = std::source_location::current()) {
+        if (!condition) {
+            std::println(std::cerr, "{}:{}: {}", location.file_name(), location.line(), message);
+            failures += 1;
+        }
+    }
+
+    // Value of a cull mode in the manifest
+    uint32 value(const vireo::CullMode cullMode) {
+        return static_cast<uint32>(cullMode);
+    }
+
+    bool equals(const MaterialPipeline& a, const MaterialPipeline& b) {
+        return a.pipelineId == b.pipelineId &&
+               a.type == b.type &&
+               a.transparency == b.transparency &&
+               a.cullMode == b.cullMode &&
+               a.vertFileName == b.vertFileName &&
+               a.fragFileName == b.fragFileName;
+    }
+
+    const auto STANDARD_PIPELINE = MaterialPipeline{
+        .pipelineId = 12,
+        .type = Material::STANDARD,
+        .transparency = Transparency::DISABLED,
+        .cullMode = vireo::CullMode::BACK,
+    };
+
+    const auto TRANSPARENT_PIPELINE = MaterialPipeline{
+        .pipelineId = 3,
+        .type = Material::STANDARD,
+        .transparency = Transparency::ALPHA,
+        .cullMode = vireo::CullMode::NONE,
+    };
+
+    const auto SHADER_PIPELINE = MaterialPipeline{
+        .pipelineId = 40,
+        .type = Material::SHADER,
+        .transparency = Transparency::DISABLED,
+        .cullMode = vireo::CullMode::FRONT,
+        .vertFileName = "",
+        .fragFileName = "my shaders/\"water\" surface",
+    };
+
+    PipelineManifest read(const std::string& content) {
+        auto stream = std::istringstream{content};
+        return PipelineManifest::read(stream, "test");
+    }
+
+    // One entry per pipeline id, ordered by pipeline id
+    void pipelines() {
+        auto manifest = PipelineManifest{};
+        check(manifest.empty(), "empty manifest");
+        check(manifest.add(STANDARD_PIPELINE) && manifest.add(SHADER_PIPELINE) && manifest.add(TRANSPARENT_PIPELINE), "pipelines added");
+        auto duplicate = STANDARD_PIPELINE;
+        duplicate.cullMode = vireo::CullMode::NONE;
+        check(!manifest.add(duplicate), "pipeline id already listed");
+        check(manifest.getPipelinesCount() == 3, "pipelines count");
+        const auto listed = manifest.getPipelines();
+        check(listed.size() == 3 &&
+              equals(listed[0], TRANSPARENT_PIPELINE) && equals(listed[1], STANDARD_PIPELINE) && equals(listed[2], SHADER_PIPELINE),
+              "ordered by pipeline id, first one kept");
+
+        auto other = PipelineManifest{};
+        other.add(duplicate);
+        other.add(MaterialPipeline{ .pipelineId = 7 });
+        manifest.merge(other);
+        check(manifest.getPipelinesCount() == 4, "missing pipelines merged");
+        check(equals(manifest.getPipelines()[2], STANDARD_PIPELINE), "listed pipelines kept by the merge");
+    }
+
+    // A written manifest is read back with the same pipelines
+    void writeAndRead() {
+        auto manifest = PipelineManifest{};
+        manifest.add(STANDARD_PIPELINE);
+        manifest.add(TRANSPARENT_PIPELINE);
+        manifest.add(SHADER_PIPELINE);
+        auto stream = std::ostringstream{};
+        manifest.write(stream);
+        const auto content = stream.str();
+        check(content.starts_with("# Lysa pipelines manifest 1\n"), "header line");
+        check(content.contains(std::format("3 0 1 {} \"-\" \"-\"\n", value(vireo::CullMode::NONE))), "default shaders written as -");
+
+        const auto loaded = read(content).getPipelines();
+        check(loaded.size() == 3 &&
+              equals(loaded[0], TRANSPARENT_PIPELINE) && equals(loaded[1], STANDARD_PIPELINE) && equals(loaded[2], SHADER_PIPELINE),
+              "same pipelines read back");
+        check(read("").empty(), "empty stream");
+    }
+
+    // The malformed lines are ignored, the other lines are read
+    void malformedLines() {
+        const auto none = value(vireo::CullMode::NONE);
+        const auto manifest = read(std::format(
+            "# comment\n"
+            "\n"
+            "1 0 0 {0} \"-\" \"-\"\n"
+            "2 2 0 {0} \"-\" \"-\"\n"
+            "3 0 2 {0} \"-\" \"-\"\n"
+            "4 0 0 1000 \"-\" \"-\"\n"
+            "5 0 0 {0} \"-\"\n"
+            "six 0 0 {0} \"-\" \"-\"\n"
+            "7 1 0 {1} \"a.vert\" \"b c.frag\"\n"
+            "1 1 1 {0} \"-\" \"-\"\n",
+            none, value(vireo::CullMode::BACK)));
+        const auto loaded = manifest.getPipelines();
+        check(loaded.size() == 2, "only the valid lines read");
+        check(loaded.size() == 2 && loaded[0].pipelineId == 1 && loaded[0].type == Material::STANDARD, "first line of a pipeline id kept");
+        check(loaded.size() == 2 && loaded[1].pipelineId == 7 &&
+              loaded[1].type == Material::SHADER &&
+              loaded[1].cullMode == vireo::CullMode::BACK &&
+              loaded[1].vertFileName == "a.vert" &&
+              loaded[1].fragFileName == "b c.frag", "quoted shader file names");
+    }
+
+    // The manifest of an assets pack is saved next to it
+    void paths() {
+        check(PipelineManifest::getPath("app://scene.assets") == "app://scene.pipelines", "assets pack extension replaced");
+        check(PipelineManifest::getPath("app://scene") == "app://scene.pipelines", "extension added");
+        check(PipelineManifest::getPath("app://scene.assets.bak") == "app://scene.assets.bak.pipelines", "other extension kept");
+    }
+
+}
+
+int main() {
+    // The malformed lines are logged
+    Log::init(LoggingConfiguration{});
+    pipelines();
+    writeAndRead();
+    malformedLines();
+    paths();
+    Log::shutdown();
+    if (failures > 0) {
+        std::println(std::cerr, "{} checks failed", failures);
+        return 1;
+    }
+    return 0;
+}
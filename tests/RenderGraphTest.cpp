@@ -0,0 +1,179 @@
+/*
+ * Copyright (c) 2025-present Henri Michelon
+ *
+ * This software is released under the MIT License.
+ * https://opensource.org/licenses/MIT
+*/
+import std;
+import lysa.render_graph;
+import lysa.types;
+
+using namespace lysa;
+
+namespace {
+
+    using State = RenderGraph::State;
+    using Barrier = RenderGraph::Barrier;
+
+    uint32 failures{0};
+
+    void check(const bool condition, const std::string& message,
+               const std::source_location location = std::source_location::current()) {
+        if (!condition) {
+            std::println(std::cerr, "{}:{}: {}", location.file_name(), location.line(), message);
+            failures += 1;
+        }
+    }
+
+    RenderGraph::Attachment color(const std::string& name, const uint32 format = 1, const uint32 width = 1920) {
+        return { .name = name, .format = format, .width = width, .height = 1080, .pixelSize = 4 };
+    }
+
+    bool hasBarrier(const std::vector<Barrier>& barriers, const uint32 attachment, const State before, const State after) {
+        return std::ranges::any_of(barriers, [&](const Barrier& barrier) {
+            return barrier.attachment == attachment && barrier.before == before && barrier.after == after;
+        });
+    }
+
+    std::vector<uint32> getPasses(const RenderGraph::Compiled& compiled) {
+        auto passes = std::vector<uint32>{};
+        for (const auto& pass : compiled.passes) {
+            passes.push_back(pass.pass);
+        }
+        return passes;
+    }
+
+    // A chain of post-processing passes : each one reads the output of the previous one
+    void chainAliasing() {
+        auto graph = RenderGraph{};
+        const auto input = graph.addAttachment({ .name = "color", .imported = true,
+            .initialState = State::RENDER_TARGET_COLOR, .finalState = State::UNDEFINED });
+        auto current = input;
+        auto outputs = std::vector<uint32>{};
+        for (auto i = 0; i < 5; i++) {
+            auto description = color(std::format("effect {}", i));
+            // The last one is sampled after the graph
+            description.finalState = i == 4 ? State::SHADER_READ : State::UNDEFINED;
+            const auto output = graph.addAttachment(description);
+            const auto pass = graph.addPass(std::format("effect {}", i));
+            graph.read(pass, current);
+            graph.write(pass, output);
+            outputs.push_back(output);
+            current = output;
+        }
+        graph.addOutput(current);
+        const auto& compiled = graph.compile();
+
+        check(compiled.passes.size() == 5, "all the passes of the chain kept");
+        check(compiled.attachmentSlots[input] == RenderGraph::INVALID_INDEX, "imported attachment not aliased");
+        // Each attachment lives from its pass to the next one : two physical attachments are enough
+        check(compiled.report.transientCount == 5 && compiled.report.physicalCount == 2, "5 attachments aliased on 2");
+        check(compiled.report.transientSize == 5 * 1920 * 1080 * 4 && compiled.report.aliasedSize == 2 * 1920 * 1080 * 4,
+              "memory report of the aliasing");
+        auto overlapping = 0;
+        for (auto i = 0; i + 1 < outputs.size(); i++) {
+            overlapping += compiled.attachmentSlots[outputs[i]] == compiled.attachmentSlots[outputs[i + 1]] ? 1 : 0;
+        }
+        check(overlapping == 0, "the input and the output of a pass are not aliased");
+        check(compiled.attachmentSlots[outputs[0]] == compiled.attachmentSlots[outputs[2]] &&
+              compiled.attachmentSlots[outputs[2]] == compiled.attachmentSlots[outputs[4]],
+              "the attachments of the even passes share a physical attachment");
+        check(compiled.slots.size() == 2 && compiled.slots[0] == outputs[0] && compiled.slots[1] == outputs[1],
+              "each physical attachment described by its first attachment");
+
+        // Barriers : the first use of a physical attachment starts from its state at the end of the frame
+        const auto& first = compiled.passes[0].barriers;
+        check(hasBarrier(first, input, State::RENDER_TARGET_COLOR, State::SHADER_READ), "input read after its initial state");
+        check(first.size() == 2 && std::ranges::any_of(first, [&](const Barrier& barrier) {
+            return barrier.attachment == outputs[0] && barrier.first && barrier.before == State::SHADER_READ &&
+                barrier.after == State::RENDER_TARGET_COLOR;
+        }), "first use of a physical attachment from its state at the end of the frame");
+        const auto& third = compiled.passes[2].barriers;
+        check(hasBarrier(third, outputs[1], State::RENDER_TARGET_COLOR, State::SHADER_READ) &&
+              hasBarrier(third, outputs[2], State::SHADER_READ, State::RENDER_TARGET_COLOR),
+              "aliased attachment goes from the read of the previous pass to the write");
+        check(std::ranges::none_of(third, [](const Barrier& barrier) { return barrier.first; }), "only one first barrier per physical attachment");
+        check(hasBarrier(compiled.finalBarriers, input, State::SHADER_READ, State::UNDEFINED), "imported attachment left in its final state");
+        check(hasBarrier(compiled.finalBarriers, outputs[4], State::RENDER_TARGET_COLOR, State::SHADER_READ),
+              "output left in its final state");
+        check(compiled.finalBarriers.size() == 2, "final barriers of the input and the output only");
+    }
+
+    // The lifetimes follow the kept passes and the outputs live until the end of the frame
+    void lifetimes() {
+        auto graph = RenderGraph{};
+        const auto a = graph.addAttachment(color("a"));
+        const auto b = graph.addAttachment(color("b"));
+        const auto c = graph.addAttachment(color("c"));
+        const auto d = graph.addAttachment(color("d"));
+        const auto other = graph.addAttachment(color("other format", 2));
+        const auto small = graph.addAttachment(color("other size", 1, 960));
+        const auto p0 = graph.addPass("write a");
+        graph.write(p0, a);
+        const auto p1 = graph.addPass("a to b");
+        graph.read(p1, a);
+        graph.write(p1, b);
+        const auto p2 = graph.addPass("write other format and size");
+        graph.write(p2, other);
+        graph.write(p2, small);
+        const auto p3 = graph.addPass("b to c");
+        graph.read(p3, b);
+        graph.read(p3, other);
+        graph.read(p3, small);
+        graph.write(p3, c);
+        const auto p4 = graph.addPass("c to d");
+        graph.read(p4, c);
+        graph.write(p4, d);
+        graph.addOutput(b);
+        graph.addOutput(d);
+        const auto& compiled = graph.compile();
+
+        check(getPasses(compiled) == std::vector{p0, p1, p2, p3, p4}, "all passes kept");
+        // a : p0-p1, b : p1-end (output), c : p3-p4, d : p4-end
+        check(compiled.attachmentSlots[c] == compiled.attachmentSlots[a], "c reuses a, free after p1");
+        check(compiled.attachmentSlots[b] != compiled.attachmentSlots[c] && compiled.attachmentSlots[b] != compiled.attachmentSlots[d],
+              "an output is never reused");
+        check(compiled.attachmentSlots[d] != compiled.attachmentSlots[c] && compiled.attachmentSlots[d] != compiled.attachmentSlots[a],
+              "d written while c is read");
+        check(compiled.attachmentSlots[other] != compiled.attachmentSlots[a] && compiled.attachmentSlots[small] != compiled.attachmentSlots[a],
+              "attachments of another format or size not aliased");
+        check(compiled.report.physicalCount == 5, "a and c aliased, the other ones not");
+    }
+
+    // The passes whose writes are not used are culled, with their attachments
+    void culling() {
+        auto graph = RenderGraph{};
+        const auto imported = graph.addAttachment({ .name = "swap chain", .imported = true });
+        const auto used = graph.addAttachment(color("used"));
+        const auto unused = graph.addAttachment(color("unused"));
+        const auto p0 = graph.addPass("unused");
+        graph.write(p0, unused);
+        const auto p1 = graph.addPass("used");
+        graph.write(p1, used);
+        const auto p2 = graph.addPass("overlay", true);
+        graph.read(p2, used);
+        const auto p3 = graph.addPass("write imported");
+        graph.read(p3, used);
+        graph.write(p3, imported);
+        const auto& compiled = graph.compile();
+        check(getPasses(compiled) == std::vector{p1, p2, p3}, "pass writing an unused attachment culled");
+        check(compiled.report.culledPassesCount == 1, "one culled pass");
+        check(compiled.attachmentSlots[unused] == RenderGraph::INVALID_INDEX, "attachment of a culled pass not allocated");
+        check(compiled.report.transientCount == 1, "one used transient attachment");
+        check(&graph.compile() == &compiled && graph.isCompiled(), "compilation kept until the declaration changes");
+        graph.addPass("new");
+        check(!graph.isCompiled(), "a new pass invalidates the compilation");
+    }
+
+}
+
+int main() {
+    chainAliasing();
+    lifetimes();
+    culling();
+    if (failures > 0) {
+        std::println(std::cerr, "{} checks failed", failures);
+        return 1;
+    }
+    return 0;
+}
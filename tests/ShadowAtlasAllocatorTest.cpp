@@ -0,0 +1,231 @@
+/*
+ * Copyright (c) 2025-present Henri Michelon
+ *
+ * This software is released under the MIT License.
+ * https://opensource.org/licenses/MIT
+*/
+import std;
+import lysa.shadow_atlas_allocator;
+import lysa.types;
+
+using namespace lysa;
+
+namespace {
+
+    using Tile = ShadowAtlasAllocator::Tile;
+    using Request = ShadowAtlasAllocator::Request;
+
+    uint32 failures{0};
+
+    void check(const bool condition, const std::string& message,
+               const std::source_location location = std::source_location::current()) {
+        if (!condition) {
+            std::println(std::cerr, "{}:{}: {}", location.file_name(), location.line(), message);
+            failures += 1;
+        }
+    }
+
+    bool overlaps(const Tile& a, const Tile& b) {
+        return a.x < b.x + b.size && b.x < a.x + a.size && a.y < b.y + b.size && b.y < a.y + a.size;
+    }
+
+    // Tiles inside the atlas, aligned on their size, without overlap and matching the free area
+    void checkTiles(const ShadowAtlasAllocator& allocator, const std::vector<Tile>& tiles, const std::string& step) {
+        auto invalid = 0;
+        auto overlapping = 0;
+        auto area = uint64{0};
+        for (auto i = 0; i < tiles.size(); i++) {
+            const auto& tile = tiles[i];
+            invalid += tile.size == 0 || tile.x % tile.size != 0 || tile.y % tile.size != 0 ||
+                tile.x + tile.size > allocator.getSize() || tile.y + tile.size > allocator.getSize() ? 1 : 0;
+            for (auto j = i + 1; j < tiles.size(); j++) {
+                overlapping += overlaps(tile, tiles[j]) ? 1 : 0;
+            }
+            area += static_cast<uint64>(tile.size) * tile.size;
+        }
+        const auto total = static_cast<uint64>(allocator.getSize()) * allocator.getSize();
+        check(invalid == 0, std::format("{}: {} tiles outside the atlas or not aligned", step, invalid));
+        check(overlapping == 0, std::format("{}: {} overlapping tiles", step, overlapping));
+        check(area + allocator.getFreeArea() == total, std::format("{}: free area of {} allocated texels", step, area));
+    }
+
+    void sizesRounding() {
+        const auto allocator = ShadowAtlasAllocator{1000, 50};
+        check(allocator.getSize() == 1024 && allocator.getMinTileSize() == 64, "sizes rounded up to powers of two");
+        check(allocator.getTileSize(1) == 64, "tiles at least of the minimum size");
+        check(allocator.getTileSize(100) == 128, "tile size rounded up");
+        check(allocator.getTileSize(256) == 256, "power of two tile size kept");
+        check(allocator.getTileSize(5000) == 1024, "tiles at most of the atlas size");
+    }
+
+    void allocateAndFree() {
+        auto allocator = ShadowAtlasAllocator{1024, 64};
+        const auto first = allocator.allocate(512);
+        const auto second = allocator.allocate(512);
+        const auto third = allocator.allocate(200);
+        check(first == Tile{0, 0, 512}, "first tile at the top left");
+        check(second == Tile{512, 0, 512}, "second tile on the right of the first one");
+        check(third == Tile{0, 512, 256}, "third tile split from the next free position");
+        checkTiles(allocator, {first, second, third}, "three tiles");
+
+        allocator.free(second);
+        allocator.free(first);
+        allocator.free(third);
+        check(allocator.getFreeArea() == 1024u * 1024u, "everything freed");
+        check(allocator.allocate(1024) == Tile{0, 0, 1024}, "the freed tiles are merged back to the whole atlas");
+
+        allocator.clear();
+        check(allocator.getFreeArea() == 1024u * 1024u, "clear() frees everything");
+        allocator.free(Tile{});
+        check(allocator.getFreeArea() == 1024u * 1024u, "freeing an empty tile does nothing");
+    }
+
+    void fullAtlas() {
+        auto allocator = ShadowAtlasAllocator{1024, 64};
+        auto tiles = std::vector<Tile>{};
+        for (auto i = 0; i < 4; i++) {
+            tiles.push_back(allocator.allocate(512));
+        }
+        checkTiles(allocator, tiles, "full atlas");
+        check(allocator.getFreeArea() == 0, "no free texel");
+        check(allocator.allocate(64).size == 0, "no tile when the atlas is full");
+        check(allocator.getFreeArea() == 0, "a failed allocation does not change the free area");
+
+        // The smallest free position is reused first
+        allocator.free(tiles[3]);
+        allocator.free(tiles[1]);
+        check(allocator.allocate(512) == tiles[1], "the freed tile with the smallest position is reused");
+        check(allocator.allocate(512) == tiles[3], "the other freed tile is reused");
+        check(allocator.allocate(512).size == 0, "full again");
+
+        // A freed large tile is split for the smaller ones
+        allocator.free(tiles[2]);
+        const auto small = allocator.allocate(64);
+        check(small == Tile{0, 512, 64}, "small tile at the top left of the freed tile");
+        check(allocator.allocate(512).size == 0, "the split tile is not available for a large tile");
+    }
+
+    void fragmentation() {
+        auto allocator = ShadowAtlasAllocator{1024, 64};
+        auto tiles = std::vector<Tile>{};
+        for (auto i = 0; i < 256; i++) {
+            tiles.push_back(allocator.allocate(64));
+        }
+        check(std::ranges::all_of(tiles, [](const Tile& tile) { return tile.size == 64; }), "256 tiles of 64 texels");
+        checkTiles(allocator, tiles, "tiles of the minimum size");
+
+        // One tile of each 2x2 block stays allocated : half of the atlas is free but no
+        // 128 texels tile is available
+        auto kept = std::vector<Tile>{};
+        for (const auto& tile : tiles) {
+            if ((tile.x / 64) % 2 == 0 && (tile.y / 64) % 2 == 0) {
+                kept.push_back(tile);
+            } else {
+                allocator.free(tile);
+            }
+        }
+        checkTiles(allocator, kept, "fragmented atlas");
+        check(allocator.getFreeArea() == 1024u * 1024u * 3 / 4, "three quarters of the atlas free");
+        check(allocator.allocate(128).size == 0, "no 128 texels tile in the fragmented atlas");
+        const auto reused = allocator.allocate(64);
+        check(reused.size == 64, "the freed tiles of the minimum size are reused");
+        allocator.free(reused);
+
+        for (const auto& tile : kept) {
+            allocator.free(tile);
+        }
+        check(allocator.getFreeArea() == 1024u * 1024u, "everything freed");
+        check(allocator.allocate(1024).size == 1024, "all the tiles merged back");
+    }
+
+    // Random allocations and releases never give overlapping tiles, and the tiles are merged back
+    void randomAllocations() {
+        auto random = std::mt19937{42};
+        auto size = std::uniform_int_distribution{1u, 600u};
+        auto allocator = ShadowAtlasAllocator{2048, 32};
+        auto tiles = std::vector<Tile>{};
+        auto failed = 0;
+        for (auto round = 0; round < 50; round++) {
+            for (auto i = 0; i < 40; i++) {
+                const auto tile = allocator.allocate(size(random));
+                if (tile.size == 0) {
+                    failed += 1;
+                } else {
+                    tiles.push_back(tile);
+                }
+            }
+            std::ranges::shuffle(tiles, random);
+            for (auto i = 0; i < tiles.size() / 2; i++) {
+                allocator.free(tiles.back());
+                tiles.pop_back();
+            }
+            checkTiles(allocator, tiles, std::format("round {}", round));
+        }
+        check(failed > 0, "the random allocations fill the atlas");
+        for (const auto& tile : tiles) {
+            allocator.free(tile);
+        }
+        check(allocator.allocate(2048).size == 2048, "all the random tiles merged back");
+    }
+
+    // fit() evicts the least important requests when the atlas is full
+    void fitEviction() {
+        const auto allocator = ShadowAtlasAllocator{1024, 64};
+        auto requests = std::vector<Request>{};
+        for (auto i = 0; i < 8; i++) {
+            requests.push_back({ .size = 1024, .priority = static_cast<float>(i) });
+        }
+        allocator.fit(requests);
+        auto area = uint64{0};
+        for (auto i = 0; i < requests.size(); i++) {
+            area += static_cast<uint64>(requests[i].size) * requests[i].size;
+            if (i > 0) {
+                check(requests[i].size >= requests[i - 1].size, "the most important requests keep the largest tiles");
+            }
+        }
+        check(area <= 1024u * 1024u, "the reduced requests fit in the atlas");
+        check(requests.back().size == 512, "the most important request keeps a quarter of the atlas");
+
+        // Allocated by decreasing size the reduced requests never fail
+        auto sorted = requests;
+        std::ranges::sort(sorted, std::greater{}, &Request::size);
+        auto atlas = ShadowAtlasAllocator{1024, 64};
+        auto tiles = std::vector<Tile>{};
+        for (const auto& request : sorted) {
+            tiles.push_back(atlas.allocate(request.size));
+        }
+        checkTiles(atlas, tiles, "fitted requests");
+
+        // 20 requests of the minimum size in room for 16 : the 4 least important are dropped
+        const auto small = ShadowAtlasAllocator{256, 64};
+        auto many = std::vector<Request>{};
+        for (auto i = 0; i < 20; i++) {
+            many.push_back({ .size = 256, .priority = static_cast<float>((i * 7) % 20) });
+        }
+        small.fit(many);
+        auto dropped = 0;
+        auto wrong = 0;
+        for (const auto& request : many) {
+            dropped += request.size == 0 ? 1 : 0;
+            wrong += (request.size == 0) != (request.priority < 4.0f) ? 1 : 0;
+            wrong += request.size != 0 && request.size != 64 ? 1 : 0;
+        }
+        check(dropped == 4, std::format("{} requests dropped instead of 4", dropped));
+        check(wrong == 0, "the least important requests are dropped, the other ones reduced to the minimum size");
+    }
+
+}
+
+int main() {
+    sizesRounding();
+    allocateAndFree();
+    fullAtlas();
+    fragmentation();
+    randomAllocations();
+    fitEviction();
+    if (failures > 0) {
+        std::println(std::cerr, "{} checks failed", failures);
+        return 1;
+    }
+    return 0;
+}